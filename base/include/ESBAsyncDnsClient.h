@@ -0,0 +1,242 @@
+#ifndef ESB_ASYNC_DNS_CLIENT_H
+#define ESB_ASYNC_DNS_CLIENT_H
+
+#ifndef ESB_DNS_CLIENT_H
+#include <ESBDnsClient.h>
+#endif
+
+#ifndef ESB_DNS_CACHE_H
+#include <ESBDnsCache.h>
+#endif
+
+#ifndef ESB_MULTIPLEXED_SOCKET_H
+#include <ESBMultiplexedSocket.h>
+#endif
+
+#define ESB_DNS_SUFFIX "-dns"
+#define ESB_DNS_SUFFIX_SIZE 5
+#define ESB_DNS_MAX_UDP_SIZE 512
+#define ESB_DNS_DEFAULT_TIMEOUT_MSEC 1000
+#define ESB_DNS_DEFAULT_ATTEMPTS 3
+
+#ifndef ESB_DNS_MIN_SOURCE_PORT
+#define ESB_DNS_MIN_SOURCE_PORT 1024
+#endif
+
+#ifndef ESB_DNS_BIND_ATTEMPTS
+#define ESB_DNS_BIND_ATTEMPTS 8
+#endif
+
+namespace ESB {
+
+/** A DnsClient that resolves hostnames to IPv4 addresses without blocking.  It sends UDP queries to a single
+ * resolver and calls back when the answers arrive.  Answers are kept in a DnsCache that can be shared by the clients
+ * of many multiplexers, and concurrent lookups of the same hostname share a single query.  Queries are retried after a
+ * timeout.
+ *
+ * To make answers hard to spoof, every query has an id from a cryptographic random number generator and its own
+ * socket bound to a random source port.  The query sockets are watched by an epoll descriptor that runs in the
+ * SocketMultiplexer.
+ *
+ * All functions must be called from the multiplexer's thread.  The client adds itself to the multiplexer on its first
+ * cache miss.
+ *
+ *  @ingroup network
+ */
+class AsyncDnsClient : public DnsClient, public MultiplexedSocket {
+ public:
+  /** Constructor.
+   *
+   * @param namePrefix The name prefix for logging
+   * @param multiplexer The multiplexer whose thread will use this client
+   * @param cache The cache to use.  May be shared with other clients.
+   * @param resolver The address of the recursive resolver to query
+   * @param timeoutMsec The time to wait for an answer before sending the query again
+   * @param attempts The number of times to send a query before giving up
+   * @param allocator The allocator to use for queries
+   */
+  AsyncDnsClient(const char *namePrefix, SocketMultiplexer &multiplexer, DnsCache &cache, const SocketAddress &resolver,
+                 UInt32 timeoutMsec = ESB_DNS_DEFAULT_TIMEOUT_MSEC, UInt32 attempts = ESB_DNS_DEFAULT_ATTEMPTS,
+                 Allocator &allocator = SystemAllocator::Instance());
+
+  virtual ~AsyncDnsClient();
+
+  /** Read the first nameserver from resolv.conf.
+   *
+   * @param address Set to the nameserver's address on port 53
+   * @param path The path of resolv.conf
+   * @return ESB_SUCCESS if successful, ESB_CANNOT_FIND if there is no IPv4 nameserver, another error code otherwise.
+   */
+  static Error SystemResolver(SocketAddress &address, const char *path = "/etc/resolv.conf");
+
+  /** The number of hostnames with a query in flight.
+   *
+   * @return The number of queries in flight
+   */
+  inline UInt32 pendingLookups() const { return _queries.size(); }
+
+  //
+  // ESB::DnsClient
+  //
+
+  /** Resolve a hostname from the cache.  On a cache miss a query is started, if one is not already in flight, and
+   * ESB_AGAIN is returned so the caller can try again later.
+   */
+  virtual Error resolve(SocketAddress &address, const char *hostname, UInt16 port = 0, bool isSecure = false);
+
+  virtual Error resolve(SocketAddress &address, const char *hostname, UInt16 port, bool isSecure, Callback &callback);
+
+  virtual void cancel(Callback &callback);
+
+  //
+  // ESB::MultiplexedSocket
+  //
+
+  virtual bool permanent();
+  virtual bool wantAccept();
+  virtual bool wantConnect();
+  virtual bool wantRead();
+  virtual bool wantWrite();
+  virtual Error handleAccept();
+  virtual Error handleConnect();
+  virtual Error handleReadable();
+  virtual Error handleWritable();
+  virtual void handleError(Error error);
+  virtual void handleRemoteClose();
+  virtual void handleIdle();
+  virtual void handleRemove();
+  virtual SOCKET socketDescriptor() const;
+  virtual CleanupHandler *cleanupHandler();
+  virtual const void *key() const;
+  virtual const char *name() const;
+  virtual void markDead();
+  virtual bool dead() const;
+
+  /** Format a query for a hostname's A records.
+   *
+   * @param hostname The hostname
+   * @param id The query id
+   * @param packet The buffer to format the query into
+   * @param size The size of packet in bytes
+   * @return The size of the query in bytes or -1 if the hostname is invalid or the buffer is too small.
+   */
+  static int FormatQuery(const char *hostname, UInt16 id, unsigned char *packet, UInt32 size);
+
+  /** Parse the answer to a query.
+   *
+   * @param packet The answer
+   * @param size The size of the answer in bytes
+   * @param id The id of the query
+   * @param hostname The hostname of the query
+   * @param address Set to the first IPv4 address for the hostname in network byte order if successful
+   * @param ttl Set to the number of seconds the result may be cached for
+   * @return ESB_SUCCESS if the hostname was resolved, ESB_CANNOT_FIND if the hostname has no IPv4 addresses,
+   * ESB_CANNOT_PARSE if the packet is not an answer to the query (it should be ignored), another error code if the
+   * resolver failed the query.
+   */
+  static Error ParseResponse(const unsigned char *packet, UInt32 size, UInt16 id, const char *hostname,
+                             UInt32 *address, UInt32 *ttl);
+
+ private:
+  // The hostname is stored right after the query
+  class Query : public EmbeddedListElement {
+   public:
+    Query(UInt16 id)
+        : EmbeddedListElement(), _id(id), _socket(INVALID_SOCKET), _attempts(0U), _deadline(), _callbacks() {}
+
+    virtual ~Query() {}
+
+    virtual CleanupHandler *cleanupHandler() { return NULL; }
+
+    inline const char *hostname() const { return (const char *)(this + 1); }
+
+    UInt16 _id;
+    SOCKET _socket;
+    UInt32 _attempts;
+    Date _deadline;
+    EmbeddedList _callbacks;
+
+    ESB_DEFAULT_FUNCS(Query);
+  };
+
+  // Wakes the client up when the oldest query times out
+  class RetryTimer : public MultiplexedSocket {
+   public:
+    RetryTimer(AsyncDnsClient &client);
+
+    virtual ~RetryTimer();
+
+    Error open();
+
+    void close();
+
+    Error arm(UInt32 delayMsec);
+
+    virtual bool permanent();
+    virtual bool wantAccept();
+    virtual bool wantConnect();
+    virtual bool wantRead();
+    virtual bool wantWrite();
+    virtual Error handleAccept();
+    virtual Error handleConnect();
+    virtual Error handleReadable();
+    virtual Error handleWritable();
+    virtual void handleError(Error error);
+    virtual void handleRemoteClose();
+    virtual void handleIdle();
+    virtual void handleRemove();
+    virtual SOCKET socketDescriptor() const;
+    virtual CleanupHandler *cleanupHandler();
+    virtual const void *key() const;
+    virtual const char *name() const;
+    virtual void markDead();
+    virtual bool dead() const;
+
+   private:
+    AsyncDnsClient &_client;
+    SOCKET _timerFd;
+    bool _dead;
+
+    ESB_DEFAULT_FUNCS(RetryTimer);
+  };
+
+  Error open();
+
+  void close();
+
+  Error start(const char *hostname, Query **query);
+
+  Error openSocket(Query *query);
+
+  Error send(Query *query);
+
+  void retry();
+
+  void scheduleRetry();
+
+  void complete(Query *query, Error result, UInt32 address);
+
+  void destroy(Query *query);
+
+  static void SetAddress(SocketAddress &address, UInt32 ip, UInt16 port, bool isSecure);
+
+  SocketMultiplexer &_multiplexer;
+  DnsCache &_cache;
+  SocketAddress _resolver;
+  const UInt32 _timeoutMsec;
+  const UInt32 _attempts;
+  Allocator &_allocator;
+  SOCKET _epollDescriptor;
+  bool _dead;
+  DnsCache::HostnameComparator _comparator;
+  Map _queries;
+  EmbeddedList _deadlines;  // earliest deadline first
+  RetryTimer _retryTimer;
+  char _name[ESB_NAME_PREFIX_SIZE + ESB_DNS_SUFFIX_SIZE];
+
+  ESB_DEFAULT_FUNCS(AsyncDnsClient);
+};
+
+}  // namespace ESB
+
+#endif
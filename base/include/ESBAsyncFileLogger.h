@@ -0,0 +1,227 @@
+#ifndef ESB_ASYNC_FILE_LOGGER_H
+#define ESB_ASYNC_FILE_LOGGER_H
+
+#ifndef ESB_LOGGER_H
+#include <ESBLogger.h>
+#endif
+
+#ifndef ESB_THREAD_H
+#include <ESBThread.h>
+#endif
+
+#ifndef ESB_MUTEX_H
+#include <ESBMutex.h>
+#endif
+
+#ifndef ESB_SHARED_INT_H
+#include <ESBSharedInt.h>
+#endif
+
+#ifndef ESB_MAP_H
+#include <ESBMap.h>
+#endif
+
+#ifndef ESB_LOG_RECORD_H
+#include <ESBLogRecord.h>
+#endif
+
+#ifndef ESB_SYSTEM_ALLOCATOR_H
+#include <ESBSystemAllocator.h>
+#endif
+
+#ifndef ESB_SYSTEM_TIME_SOURCE_H
+#include <ESBSystemTimeSource.h>
+#endif
+
+#ifdef HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
+#if !defined HAVE_GCC_ATOMIC_INTRINSICS
+#error "AsyncFileLogger needs __atomic intrinsics or equivalent"
+#endif
+
+#ifndef ESB_ASYNC_LOGGER_MAX_THREADS
+#define ESB_ASYNC_LOGGER_MAX_THREADS 256
+#endif
+
+#ifndef ESB_ASYNC_LOGGER_MAX_MESSAGE
+#define ESB_ASYNC_LOGGER_MAX_MESSAGE 2048
+#endif
+
+namespace ESB {
+
+/** AsyncFileLogger formats log messages on the calling thread but writes them to a file on its own thread, so logging
+ *  never waits on the file or on stdio's lock.  Each thread that logs gets a private single-producer, single-consumer
+ *  ring buffer that it appends formatted messages to without locks.  The writer thread drains every ring with one
+ *  fwrite per contiguous run of messages and flushes the file once per pass.  Each thread's messages are written in
+ *  order, but messages from different threads may be interleaved out of order.
+ *
+ *  When a thread's ring is full the message is either dropped and counted, or, if the logger blocks when full, the
+ *  thread drains the rings itself before retrying.  Messages of Critical or greater severity are never dropped and
+ *  are written and flushed before log() returns.  flush() also drains the rings, so it can be called from the signal
+ *  handler before a crash.
+ *
+ *  In DEFERRED and BINARY output modes the calling thread only captures the format string and arguments as a
+ *  LogRecord.  DEFERRED formats the records on the writer thread, and BINARY writes the records themselves to the file
+ *  to be formatted later by the log-decoder tool.  Both require format strings with static storage duration, which
+ *  the ESB_LOG_* macros always pass.
+ *
+ *  Call start() to start the writer thread.  The destructor stops and joins it if it is still running.  Without the
+ *  writer thread messages are only written when a ring fills or the logger is flushed.  Rings are kept until the logger
+ *  is destroyed, and threads beyond the first ESB_ASYNC_LOGGER_MAX_THREADS write directly to the file under a lock.
+ *
+ *  @ingroup log
+ */
+class AsyncFileLogger : public Logger, public Thread {
+ public:
+  typedef enum {
+    TEXT = 0,     /**< Format on the calling thread and write text */
+    DEFERRED = 1, /**< Capture arguments on the calling thread, format on the writer thread, and write text */
+    BINARY = 2    /**< Capture arguments on the calling thread and write LogRecords */
+  } Output;
+
+  /** Constructor
+   *
+   * @param file All log messages will be written to this file handle.
+   * @param severity Messages with a severity greater than or equal to this severity level will be logged
+   * @param source The time source for log message timestamps
+   * @param ringSize The size in bytes of each thread's ring buffer.  Rounded up to a power of 2 that can hold at least
+   *  two messages.
+   * @param blockWhenFull If true threads wait for space in a full ring, otherwise messages are dropped
+   * @param idleMilliSeconds How long the writer thread sleeps when there is nothing to write
+   * @param output How messages are passed to the writer thread and written to the file
+   * @param allocator The allocator for ring buffers.  Must be thread-safe.
+   */
+  AsyncFileLogger(FILE *file = stdout, Severity severity = Logger::Warning,
+                  TimeSource &source = SystemTimeSource::Instance(), UInt32 ringSize = 1U << 18,
+                  bool blockWhenFull = false, UInt32 idleMilliSeconds = 10U, Output output = TEXT,
+                  Allocator &allocator = SystemAllocator::Instance());
+
+  /** Destructor.  Writes any messages still in the ring buffers.
+   */
+  virtual ~AsyncFileLogger();
+
+  /** Start the writer thread.
+   *
+   *  @return ESB_SUCCESS if the writer thread was started, another error code otherwise.
+   */
+  Error start();
+
+  /** Wait for the writer thread to exit after stop() is called.
+   *
+   *  @return ESB_SUCCESS if the writer thread was joined, another error code otherwise.
+   */
+  Error join();
+
+  virtual bool isLoggable(Severity severity);
+
+  virtual void setSeverity(Severity severity);
+
+  virtual Error log(Severity severity, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+  virtual void flush();
+
+  virtual UInt32 now();
+
+  /** Get the number of messages dropped because a ring buffer was full.
+   *
+   * @return The number of dropped messages
+   */
+  inline UInt32 dropped() const { return _dropped.get(); }
+
+  /** Get the number of ring buffers, one per thread that has logged.
+   *
+   * @return The number of ring buffers
+   */
+  inline UInt32 rings() const { return __atomic_load_n(&_ringCount, __ATOMIC_ACQUIRE); }
+
+ protected:
+  virtual void run();
+
+ private:
+  // Written by one producer thread and read by whichever thread holds _writeLock.  The cursors run freely and wrap
+  // around the power of 2 capacity, and each is on its own cache line so the producer and consumer do not contend.
+  // The messages are stored right after the ring.
+  struct Ring {
+    UInt32 _tail;
+    unsigned char _producerPad[ESB_CACHE_LINE_SIZE - sizeof(UInt32)];
+    UInt32 _head;
+    unsigned char _consumerPad[ESB_CACHE_LINE_SIZE - sizeof(UInt32)];
+  };
+
+  // Orders keys by their addresses
+  class AddressComparator : public Comparator {
+   public:
+    AddressComparator() {}
+
+    virtual ~AddressComparator() {}
+
+    virtual int compare(const void *first, const void *second) const {
+      return first < second ? -1 : (first > second ? 1 : 0);
+    }
+
+    ESB_DEFAULT_FUNCS(AddressComparator);
+  };
+
+  Ring *currentRing();
+
+  Error enqueue(Ring *ring, Severity severity, const void *message, UInt32 length);
+
+  bool push(Ring *ring, const void *message, UInt32 length);
+
+  // Must hold _writeLock
+  UInt32 drain();
+
+  // Must hold _writeLock
+  UInt32 drain(Ring *ring);
+
+  // Must hold _writeLock
+  UInt32 drainRecords(Ring *ring);
+
+  // Must hold _writeLock
+  void copy(const Ring *ring, UInt32 position, void *destination, UInt32 length) const;
+
+  // Must hold _writeLock
+  void writeRecord(const unsigned char *record);
+
+  // Must hold _writeLock
+  void writeText(const char *message, UInt32 length);
+
+  // Must hold _writeLock
+  void writeHeader();
+
+  void write(const char *message, UInt32 length);
+
+  const UInt32 _id;
+  const UInt32 _ringSize;
+  const UInt32 _idleMilliSeconds;
+  const bool _blockWhenFull;
+  const Output _output;
+  bool _started;
+  bool _wroteHeader;
+  Severity _severity;
+  UInt32 _ringCount;
+  UInt32 _reportedDrops;
+  TimeSource &_timeSource;
+  Allocator &_allocator;
+  SharedInt _dropped;
+  Mutex _registerLock;
+  Mutex _writeLock;
+#ifdef HAVE_FILE_T
+  FILE *_file;
+#else
+#error "FILE * or equivalent is required"
+#endif
+  Ring *_rings[ESB_ASYNC_LOGGER_MAX_THREADS];
+  AddressComparator _formatComparator;
+  Map _formats;  // format strings already written to a BINARY file
+  unsigned char _record[ESB_ASYNC_LOGGER_MAX_MESSAGE];
+  char _text[ESB_ASYNC_LOGGER_MAX_MESSAGE];
+
+  ESB_DEFAULT_FUNCS(AsyncFileLogger);
+};
+
+}  // namespace ESB
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef ESB_CIDR_TABLE_H
+#define ESB_CIDR_TABLE_H
+
+#ifndef ESB_CONFIG_H
+#include <ESBConfig.h>
+#endif
+
+#ifndef ESB_SYSTEM_ALLOCATOR_H
+#include <ESBSystemAllocator.h>
+#endif
+
+namespace ESB {
+
+/** Maps IPv4 addresses to the value of the longest matching prefix (CIDR block) among those inserted.
+ *
+ *  The prefixes are inserted up front and build() expands them into a three level multibit trie with strides of 16, 8
+ *  and 8 bits (a DIR-16-8-8 table).  Every entry holds either a value or the offset of a 256 entry chunk for the next
+ *  8 bits, and shorter prefixes are copied into the chunks below them, so find() is at most three dependent loads with
+ *  no comparisons.  The first level is 256 KB and each /16 or /24 that contains longer prefixes adds a 1 KB chunk, so
+ *  memory grows with how scattered the prefixes are: 100k /24s that all fall in different /16s take about 100 MB.
+ *
+ *  A built table never changes, so any number of threads may call find() on it without locks.  IPv6 will need a table
+ *  of its own with more levels.
+ *
+ *  @ingroup util
+ */
+class CidrTable {
+ public:
+  /** The largest value a prefix can map to.
+   */
+  static const UInt32 MaxValue = 0x7FFFFFFEU;
+
+  /** Constructor.
+   *
+   * @param allocator The allocator to use for the table.  Defaults to malloc.
+   */
+  CidrTable(Allocator &allocator = SystemAllocator::Instance());
+
+  virtual ~CidrTable();
+
+  /** Add a prefix.  Bits of the address past the prefix length are ignored.
+   *
+   * @param address The prefix's address in host byte order
+   * @param length The prefix length, 0 to 32
+   * @param value The value to return for addresses whose longest matching prefix is this one, at most MaxValue.
+   * @return ESB_SUCCESS if successful, ESB_INVALID_ARGUMENT if the length or value is out of range, ESB_INVALID_STATE
+   * if the table has been built, ESB_OUT_OF_MEMORY if the prefix could not be stored.
+   */
+  Error insert(UInt32 address, UInt32 length, UInt32 value);
+
+  /** Add a prefix written as e.g. "10.0.0.0/8".  An address without a length is a /32.
+   *
+   * @param cidr The prefix
+   * @param value The value to return for addresses whose longest matching prefix is this one, at most MaxValue.
+   * @return ESB_SUCCESS if successful, ESB_CANNOT_PARSE if the prefix is malformed, another error code otherwise.
+   */
+  Error insert(const char *cidr, UInt32 value);
+
+  /** Build the table from the inserted prefixes.  No more prefixes can be inserted afterwards.
+   *
+   * @return ESB_SUCCESS if successful, ESB_UNIQUENESS_VIOLATION if a prefix was inserted twice, ESB_INVALID_STATE if
+   * the table has already been built, ESB_OVERFLOW if the prefixes need more chunks than can be addressed,
+   * ESB_OUT_OF_MEMORY if the table could not be allocated.
+   */
+  Error build();
+
+  /** Find the value of the longest prefix matching an address.
+   *
+   * @param address The address in host byte order
+   * @param value Will be set to the value
+   * @return ESB_SUCCESS if a prefix matched, ESB_CANNOT_FIND if none did or the table has not been built.
+   */
+  inline Error find(UInt32 address, UInt32 *value) const {
+    if (!_table) {
+      return ESB_CANNOT_FIND;
+    }
+
+    UInt32 entry = _table[address >> 16];
+    if (entry & Chunk) {
+      entry = _table[(entry & ~Chunk) + ((address >> 8) & 0xFFU)];
+      if (entry & Chunk) {
+        entry = _table[(entry & ~Chunk) + (address & 0xFFU)];
+      }
+    }
+
+    if (Empty == entry) {
+      return ESB_CANNOT_FIND;
+    }
+
+    *value = entry;
+    return ESB_SUCCESS;
+  }
+
+  /** Parse a prefix written as e.g. "10.0.0.0/8".  An address without a length is a /32.
+   *
+   * @param cidr The prefix
+   * @param address Will be set to the address in host byte order
+   * @param length Will be set to the prefix length
+   * @return ESB_SUCCESS if successful, ESB_CANNOT_PARSE if the prefix is malformed.
+   */
+  static Error Parse(const char *cidr, UInt32 *address, UInt32 *length);
+
+  inline bool isBuilt() const { return NULL != _table; }
+
+  /** Get the number of prefixes inserted.
+   *
+   * @return The number of prefixes
+   */
+  inline UInt32 size() const { return _size; }
+
+  /** Get the number of 256 entry chunks below the first level.
+   *
+   * @return The number of chunks, or 0 if the table has not been built.
+   */
+  inline UInt32 chunks() const { return _chunks; }
+
+ private:
+  struct Prefix {
+    UInt32 address;
+    UInt32 length;
+    UInt32 value;
+  };
+
+  static const UInt32 Chunk = 0x80000000U;
+  static const UInt32 Empty = 0x7FFFFFFFU;
+
+  static int ComparePrefixes(const void *a, const void *b);
+
+  // The offset of the chunk below an entry, created and filled with the entry's value if there is none yet
+  static UInt32 ChunkBelow(UInt32 *entry, UInt32 *table, UInt32 *nextChunk);
+
+  UInt32 _size;
+  UInt32 _capacity;
+  UInt32 _chunks;
+  Prefix *_prefixes;  // freed by build()
+  UInt32 *_table;     // the first level followed by the chunks
+  Allocator &_allocator;
+
+  ESB_DEFAULT_FUNCS(CidrTable);
+};
+
+}  // namespace ESB
+
+#endif
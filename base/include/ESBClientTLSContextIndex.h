@@ -5,6 +5,10 @@
 #include <ESBTLSContextIndex.h>
 #endif
 
+#ifndef ESB_TLS_SESSION_CACHE_H
+#include <ESBTLSSessionCache.h>
+#endif
+
 namespace ESB {
 
 /**
@@ -12,6 +16,8 @@ namespace ESB {
  */
 class ClientTLSContextIndex : public TLSContextIndex {
  public:
+  static const UInt32 DefaultMaxSessions = 10000;
+
   /**
    * Construct a new TLS Context Index.
    *
@@ -19,8 +25,11 @@ class ClientTLSContextIndex : public TLSContextIndex {
    * @param numLocks Number of locks for internal hash table.  If 0, no locking.  Else, more locks -> more memory, less
    * contention.
    * @param allocator The allocator to use for allocating internal buckets and nodes.
+   * @param maxSessions The maximum number of TLS sessions to cache for resumption by new connections.  0 disables
+   * session resumption.  The session cache is split into numLocks shards.
    */
-  ClientTLSContextIndex(UInt32 numBuckets, UInt32 numLocks, Allocator &allocator);
+  ClientTLSContextIndex(UInt32 numBuckets, UInt32 numLocks, Allocator &allocator,
+                        UInt32 maxSessions = DefaultMaxSessions);
 
   virtual ~ClientTLSContextIndex();
 
@@ -41,10 +50,21 @@ class ClientTLSContextIndex : public TLSContextIndex {
    */
   inline TLSContextPointer &defaultContext() { return _defaultContext; }
 
+  /**
+   * Get the cache that client connections using this index's contexts resume sessions from.
+   *
+   * @return The session cache
+   */
+  inline TLSSessionCache &sessionCache() { return _sessionCache; }
+
   virtual void clear();
 
+ protected:
+  virtual Error initializeContext(TLSContext &context);
+
  private:
   TLSContextPointer _defaultContext;
+  TLSSessionCache _sessionCache;
 
   ESB_DEFAULT_FUNCS(ClientTLSContextIndex);
 };
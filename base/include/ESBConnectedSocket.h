@@ -17,6 +17,10 @@
 #include <ESBBuffer.h>
 #endif
 
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
+
 #define ESB_SOCK_FLAG_NEW (1 << 0)
 #define ESB_SOCK_FLAG_CONNECTING (1 << 1)
 #define ESB_SOCK_FLAG_CONNECTED (1 << 2)
@@ -154,6 +158,35 @@ class ConnectedSocket : public Socket {
    */
   SSize send(Buffer *buffer);
 
+  /** Send up to all of the bytes in a sequence of caller supplied buffers,
+   *  in order, with as few system calls as possible.  This method returns
+   *  the number of bytes actually sent, which may end in the middle of any
+   *  of the buffers.  If a negative number is returned, than an error has
+   *  occured and the caller should call getLastError.
+   *
+   *  @param segments The buffers to send.
+   *  @param segmentCount The number of buffers.
+   *  @return The number of bytes sent.
+   *  @see TCPSocket::getLastError to get the last error on the socket.
+   */
+  virtual SSize send(const struct iovec *segments, int segmentCount);
+
+  /** Send up to all of the used space in a buffer followed by up to all of
+   *  a caller supplied buffer with one vectored send.  Bytes sent from the
+   *  buffer are consumed as with send(Buffer *).  This method returns the
+   *  total number of bytes sent, so the number of caller supplied bytes
+   *  sent is anything in excess of the buffer's readable bytes.  If a
+   *  negative number is returned, than an error has occured and the caller
+   *  should call getLastError.
+   *
+   *  @param buffer The buffer to send first.
+   *  @param data The caller supplied bytes to send after the buffer.
+   *  @param dataSize The number of caller supplied bytes.
+   *  @return The number of bytes sent.
+   *  @see TCPSocket::getLastError to get the last error on the socket.
+   */
+  SSize send(Buffer *buffer, const char *data, Size dataSize);
+
   /**
    * Determine whether the socket impl needs to receive more data to make progress (e.g., to complete a TLS handshake)
    *
@@ -168,6 +201,15 @@ class ConnectedSocket : public Socket {
    */
   virtual bool wantWrite();
 
+  /**
+   * Make progress on any handshake the socket impl must complete before it can carry data (e.g., a TLS handshake).
+   * Connections that do not need one are always ready.
+   *
+   * @return ESB_SUCCESS if the handshake is complete, ESB_AGAIN if it should be called again once wantRead() or
+   * wantWrite() is satisfied, another error code otherwise.
+   */
+  virtual Error handshake();
+
   /** Get the number of bytes of data that could be read from this socket.
    *
    *  @return The number of bytes that could be read or SOCKET_ERROR if
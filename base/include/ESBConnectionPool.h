@@ -21,14 +21,113 @@
 #include <ESBClientTLSContextIndex.h>
 #endif
 
+#ifndef ESB_MAP_H
+#include <ESBMap.h>
+#endif
+
+#ifndef ESB_MUTEX_H
+#include <ESBMutex.h>
+#endif
+
+#ifndef ESB_READ_WRITE_LOCK_H
+#include <ESBReadWriteLock.h>
+#endif
+
+#define ESB_CONNECTION_POOL_MAX_DESTINATIONS 1024
+
 namespace ESB {
 
 /** A connection pool that can optionally be shared by multiple threads.
+ *
+ *  Pools can also be owned by one thread each and joined into a Group.  A pool in a group keeps its idle connections
+ * to itself and reuses them without any locking.  Only on a miss does it look at the connections other pools in the
+ * group have handed off.  An owner hands off the next connection it releases, instead of keeping it, only after a
+ * thief found nothing to take.  Handed off connections are guarded by a lock that is only ever attempted, so neither
+ * owners nor thieves wait for each other.
  *
  *  @ingroup network
  */
 class ConnectionPool {
  public:
+  /** A set of per-thread connection pools that may steal idle connections from each other.
+   */
+  class Group {
+   public:
+    /** Constructor.
+     *
+     * @param maxPools The maximum number of pools in the group, typically the number of threads.
+     * @param allocator The allocator to use for the group's pool table and every grouped pool's connections.  A stolen
+     * connection is recycled by the thief and may outlive the pool that created it, so this must be thread-safe and
+     * outlive every pool in the group.
+     */
+    Group(UInt32 maxPools, Allocator &allocator = SystemAllocator::Instance());
+
+    virtual ~Group();
+
+    /** The number of pools currently in the group.
+     *
+     * @return The number of pools
+     */
+    inline UInt32 size() const { return _size; }
+
+    inline Allocator &allocator() const { return _allocator; }
+
+    /** Sum the acquisition counters of every pool in the group.  Only blocks while a pool is joining or leaving.
+     *
+     * @param hits Connections reused from the same pool will be written here
+     * @param misses New connections will be written here
+     * @param steals Connections reused from another pool in the group will be written here
+     */
+    void counters(UInt64 *hits, UInt64 *misses, UInt64 *steals) const;
+
+   private:
+    friend class ConnectionPool;
+
+    Error attach(ConnectionPool *pool);
+
+    void detach(ConnectionPool *pool);
+
+    ConnectedSocket *steal(ConnectionPool *thief, const SocketKey &key);
+
+    const UInt32 _maxPools;
+    UInt32 _size;
+    ConnectionPool **_pools;
+    mutable ReadWriteLock _lock;
+    Allocator &_allocator;
+
+    ESB_DEFAULT_FUNCS(Group);
+  };
+
+  /** Acquisition counters for one destination.
+   */
+  class Counters {
+   public:
+    Counters(const SocketAddress &peerAddress) : _peerAddress(peerAddress), _hits(0U), _misses(0U), _steals(0U) {}
+
+    virtual ~Counters() {}
+
+    inline const SocketAddress &peerAddress() const { return _peerAddress; }
+
+    /** Connections reused from this pool */
+    inline UInt32 hits() const { return _hits; }
+
+    /** New connections */
+    inline UInt32 misses() const { return _misses; }
+
+    /** Connections reused from another pool in the group */
+    inline UInt32 steals() const { return _steals; }
+
+   private:
+    friend class ConnectionPool;
+
+    const SocketAddress _peerAddress;
+    UInt32 _hits;
+    UInt32 _misses;
+    UInt32 _steals;
+
+    ESB_DEFAULT_FUNCS(Counters);
+  };
+
   /** Constructor.
    *
    * @param namePrefix connected sockets created by this pool will have names prefixed by this string
@@ -36,9 +135,12 @@ class ConnectionPool {
    * @param numLocks more locks, less contention, more memory.  if 0, no internal locking will be performed
    * @param contextIndex map of fqdn wildcards to TLS contexts - a TLS context appropriate for the TLSSocket will be
    * borrowed from this index.
+   * @param allocator The allocator to use for connections.  Pools in a group use the group's allocator instead.
+   * @param group If not NULL, the pool joins this group.  The pool must then only be used by one thread, and
+   * numLocks should be 0.
    */
   ConnectionPool(const char *namePrefix, UInt32 numBuckets, UInt32 numLocks, ClientTLSContextIndex &contextIndex,
-                 Allocator &allocator = SystemAllocator::Instance());
+                 Allocator &allocator = SystemAllocator::Instance(), Group *group = NULL);
 
   /** Destructor.  No cleanup handlers are called
    */
@@ -70,18 +172,55 @@ class ConnectionPool {
   Error acquireTLSSocket(const char *fqdn, const SocketAddress &peerAddress, ConnectedSocket **connection,
                          bool *reused);
 
+  /** Create a new connection to a peer without looking in the connection pool first, e.g., to open connections ahead
+   * of demand.  Does not count as a hit or a miss.  The caller should release() the connection when done with it.
+   *
+   * @param fqdn The DNS name of the peer.  Only used for TLS connections.
+   * @param peerAddress The peer address.  Its transport type selects a clear text or TLS connection.
+   * @param connection On success, will be set to an establishing connection to the peer address.
+   * @return ESB_SUCCESS if successful, another error code otherwise.
+   */
+  Error connectSocket(const char *fqdn, const SocketAddress &peerAddress, ConnectedSocket **connection);
+
+  /** Count the idle connections to a peer in the connection pool.
+   *
+   * @param fqdn The DNS name of the peer.  Only used for TLS connections.
+   * @param peerAddress The peer address
+   * @return The number of idle connections that acquireClearSocket() or acquireTLSSocket() could reuse
+   */
+  UInt32 idleSockets(const char *fqdn, const SocketAddress &peerAddress);
+
+  /** Close and destroy the least recently used idle connections to a peer until no more than maxIdle remain.
+   *
+   * @param fqdn The DNS name of the peer.  Only used for TLS connections.
+   * @param peerAddress The peer address
+   * @param maxIdle The number of idle connections to keep
+   * @return The number of connections closed
+   */
+  UInt32 retireSockets(const char *fqdn, const SocketAddress &peerAddress, UInt32 maxIdle);
+
   /** Return a connection to the connection pool
    *
    *  @param connection The connection to return to the connection pool
    */
   void release(ConnectedSocket *connection);
 
-  inline int size() const { return _activeSockets.size(); }
+  inline int size() const { return _activeSockets.size() + _lendableSockets.size(); }
 
   inline int hits() const { return _hits.get(); }
 
   inline int misses() const { return _misses.get(); }
 
+  inline int steals() const { return _steals.get(); }
+
+  /** Get the counters of a destination.  Only the first ESB_CONNECTION_POOL_MAX_DESTINATIONS destinations are
+   * tracked.
+   *
+   * @param peerAddress The destination
+   * @return The destination's counters or NULL if the destination has not been seen or is not tracked.
+   */
+  const Counters *destinationCounters(const SocketAddress &peerAddress);
+
  private:
   // Callbacks for the hash table-based connection pool
   class SocketAddressCallbacks : public ESB::EmbeddedMapCallbacks {
@@ -98,13 +237,50 @@ class ConnectionPool {
     ESB_DEFAULT_FUNCS(SocketAddressCallbacks);
   };
 
+  class SocketAddressComparator : public Comparator {
+   public:
+    SocketAddressComparator() {}
+
+    virtual ~SocketAddressComparator() {}
+
+    virtual int compare(const void *first, const void *second) const;
+
+    ESB_DEFAULT_FUNCS(SocketAddressComparator);
+  };
+
+  ConnectedSocket *acquire(const SocketKey &key);
+
+  ConnectedSocket *lend(const SocketKey &key);
+
+  bool handOff(ConnectedSocket *connection);
+
+  UInt32 idleSockets(const SocketKey &key);
+
+  Error findContext(const char *fqdn, TLSContextPointer &context);
+
+  Error createClearSocket(const SocketAddress &peerAddress, ConnectedSocket **connection);
+
+  Error createTLSSocket(const char *fqdn, const SocketAddress &peerAddress, TLSContextPointer &context,
+                        ConnectedSocket **connection);
+
+  Counters *counters(const SocketAddress &peerAddress);
+
   const char *_prefix;
   Allocator &_allocator;
+  Allocator &_socketAllocator;
   ClientTLSContextIndex &_contextIndex;
+  Group *_group;
+  UInt32 _nextVictim;
   SharedInt _hits;
   SharedInt _misses;
+  SharedInt _steals;
+  SharedInt _wanted;  // Set by thieves that found nothing, cleared by the owner when it hands off a connection
   SocketAddressCallbacks _callbacks;
   SharedEmbeddedMap _activeSockets;
+  SharedEmbeddedMap _lendableSockets;
+  Mutex _lock;  // Guards _lendableSockets
+  SocketAddressComparator _comparator;
+  Map _destinations;
   EmbeddedList _deconstructedClearSockets;
   EmbeddedList _deconstructedTLSSockets;
 
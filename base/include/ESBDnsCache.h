@@ -0,0 +1,149 @@
+#ifndef ESB_DNS_CACHE_H
+#define ESB_DNS_CACHE_H
+
+#ifndef ESB_MAP_H
+#include <ESBMap.h>
+#endif
+
+#ifndef ESB_EMBEDDED_LIST_H
+#include <ESBEmbeddedList.h>
+#endif
+
+#ifndef ESB_MUTEX_H
+#include <ESBMutex.h>
+#endif
+
+#ifndef ESB_SHARED_INT_H
+#include <ESBSharedInt.h>
+#endif
+
+#ifndef ESB_DATE_H
+#include <ESBDate.h>
+#endif
+
+namespace ESB {
+
+/** A cache of hostname to IPv4 address lookups that can be shared by many threads.  Entries for successful lookups
+ * live as long as the TTL of the DNS records they came from, up to a limit.  Entries for failed lookups live for a
+ * shorter time so a bad hostname does not cost a round trip to the resolver on every request.  When the cache is full
+ * the oldest entry is evicted.
+ *
+ *  @ingroup network
+ */
+class DnsCache {
+ public:
+  /** Constructor.
+   *
+   * @param maxEntries The maximum number of hostnames to cache.  0 disables caching.
+   * @param maxTtlSeconds The longest time to cache a successful lookup, regardless of its TTL.
+   * @param negativeTtlSeconds The longest time to cache a failed lookup, regardless of its TTL.
+   * @param allocator The allocator to use for entries.  Must be thread-safe.
+   */
+  DnsCache(UInt32 maxEntries, UInt32 maxTtlSeconds, UInt32 negativeTtlSeconds,
+           Allocator &allocator = SystemAllocator::Instance());
+
+  virtual ~DnsCache();
+
+  /** Find an unexpired entry for a hostname.  Hostnames are case-insensitive.
+   *
+   * @param hostname The hostname
+   * @param now The current time
+   * @param result Set to ESB_SUCCESS for a successful lookup, otherwise the error the lookup failed with.
+   * @param address Set to the IPv4 address in network byte order for a successful lookup.
+   * @return true if an entry was found, false if the hostname must be looked up.
+   */
+  bool find(const char *hostname, const Date &now, Error *result, UInt32 *address);
+
+  /** Cache a successful lookup.
+   *
+   * @param hostname The hostname
+   * @param address The IPv4 address in network byte order
+   * @param ttlSeconds The TTL of the DNS records.  0 means do not cache.
+   * @param now The current time
+   * @return ESB_SUCCESS if successful or nothing had to be cached, another error code otherwise.
+   */
+  inline Error insert(const char *hostname, UInt32 address, UInt32 ttlSeconds, const Date &now) {
+    return insert(hostname, ESB_SUCCESS, address, MIN(ttlSeconds, _maxTtlSeconds), now);
+  }
+
+  /** Cache a failed lookup.
+   *
+   * @param hostname The hostname
+   * @param result The error the lookup failed with (e.g., ESB_CANNOT_FIND if the hostname does not exist).
+   * @param ttlSeconds The negative TTL from the resolver's response.  0 means do not cache.
+   * @param now The current time
+   * @return ESB_SUCCESS if successful or nothing had to be cached, another error code otherwise.
+   */
+  inline Error insertNegative(const char *hostname, Error result, UInt32 ttlSeconds, const Date &now) {
+    assert(ESB_SUCCESS != result);
+    return insert(hostname, result, 0U, MIN(ttlSeconds, _negativeTtlSeconds), now);
+  }
+
+  /** Remove every entry.
+   */
+  void clear();
+
+  /** Get the number of cached hostnames, including expired entries that have not been found since they expired.
+   *
+   * @return The number of cached hostnames
+   */
+  UInt32 size();
+
+  inline UInt32 hits() const { return _hits.get(); }
+
+  inline UInt32 misses() const { return _misses.get(); }
+
+  /** Compares hostnames case-insensitively.
+   */
+  class HostnameComparator : public Comparator {
+   public:
+    HostnameComparator() {}
+
+    virtual ~HostnameComparator() {}
+
+    virtual int compare(const void *first, const void *second) const;
+
+    ESB_DEFAULT_FUNCS(HostnameComparator);
+  };
+
+ private:
+  // The hostname is stored right after the entry
+  class Entry : public EmbeddedListElement {
+   public:
+    Entry(Error result, UInt32 address, const Date &expires)
+        : EmbeddedListElement(), _result(result), _address(address), _expires(expires) {}
+
+    virtual ~Entry() {}
+
+    virtual CleanupHandler *cleanupHandler() { return NULL; }
+
+    inline const char *hostname() const { return (const char *)(this + 1); }
+
+    Error _result;
+    UInt32 _address;
+    Date _expires;
+
+    ESB_DEFAULT_FUNCS(Entry);
+  };
+
+  Error insert(const char *hostname, Error result, UInt32 address, UInt32 ttlSeconds, const Date &now);
+
+  void destroy(Entry *entry);
+
+  const UInt32 _maxEntries;
+  const UInt32 _maxTtlSeconds;
+  const UInt32 _negativeTtlSeconds;
+  Allocator &_allocator;
+  SharedInt _hits;
+  SharedInt _misses;
+  Mutex _lock;
+  HostnameComparator _comparator;
+  Map _entries;
+  EmbeddedList _age;  // oldest first
+
+  ESB_DEFAULT_FUNCS(DnsCache);
+};
+
+}  // namespace ESB
+
+#endif
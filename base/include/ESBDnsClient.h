@@ -5,16 +5,83 @@
 #include <ESBSocketAddress.h>
 #endif
 
+#ifndef ESB_EMBEDDED_LIST_ELEMENT_H
+#include <ESBEmbeddedListElement.h>
+#endif
+
 namespace ESB {
 
 class DnsClient {
  public:
+  /** Receives the result of a lookup that could not complete without blocking.
+   */
+  class Callback : public EmbeddedListElement {
+   public:
+    Callback();
+
+    virtual ~Callback();
+
+    /** Called in the thread that started the lookup once it completes.  The callback is no longer referenced by the
+     * DnsClient when this is called, so it may be destroyed or reused.
+     *
+     * @param result ESB_SUCCESS if the hostname was resolved, another error code otherwise.
+     * @param address The resolved address with the port and transport type passed to resolve().  Only valid if
+     * successful.
+     */
+    virtual void resolved(Error result, const SocketAddress &address) = 0;
+
+    virtual CleanupHandler *cleanupHandler();
+
+    //
+    // For DnsClient implementations: the port and transport type to resolve to and the lookup being waited on.
+    //
+
+    inline UInt16 port() const { return _port; }
+
+    inline bool isSecure() const { return _isSecure; }
+
+    inline void setTarget(UInt16 port, bool isSecure) {
+      _port = port;
+      _isSecure = isSecure;
+    }
+
+    inline void *lookup() const { return _lookup; }
+
+    inline void setLookup(void *lookup) { _lookup = lookup; }
+
+   private:
+    UInt16 _port;
+    bool _isSecure;
+    void *_lookup;
+
+    ESB_DISABLE_AUTO_COPY(Callback);
+  };
+
   DnsClient();
 
   virtual ~DnsClient();
 
   virtual Error resolve(SocketAddress &address, const char *hostname, UInt16 port = 0, bool isSecure = false) = 0;
 
+  /** Resolve a hostname without blocking if the implementation supports it.  The default implementation blocks.
+   *
+   * @param address Set to the resolved address if the lookup completes right away
+   * @param hostname The hostname to resolve
+   * @param port The port of the resolved address
+   * @param isSecure The transport type of the resolved address
+   * @param callback Called with the result if this returns ESB_INPROGRESS.  Must not be destroyed until it is called
+   * or passed to cancel().
+   * @return ESB_SUCCESS if address was resolved right away, ESB_INPROGRESS if callback will be called with the result
+   * later, another error code otherwise.
+   */
+  virtual Error resolve(SocketAddress &address, const char *hostname, UInt16 port, bool isSecure, Callback &callback);
+
+  /** Stop a lookup from calling a callback.  Does nothing if the callback is not waiting for a lookup.
+   *
+   * @param callback A callback passed to a resolve() call that returned ESB_INPROGRESS
+   */
+  virtual void cancel(Callback &callback);
+
   ESB_DEFAULT_FUNCS(DnsClient);
 };
 
@@ -58,6 +58,10 @@ class EmbeddedMapBase {
 
   EmbeddedMapElement *remove(ESB::UInt32 bucket, const void *key);
 
+  EmbeddedMapElement *removeLast(ESB::UInt32 bucket, const void *key);
+
+  UInt32 count(ESB::UInt32 bucket, const void *key);
+
   inline void removeElement(ESB::UInt32 bucket, EmbeddedMapElement *element) {
     if (_buckets) {
       _buckets[bucket].remove(element);
@@ -21,8 +21,12 @@
 #include <ESBNullLock.h>
 #endif
 
-#ifndef ESB_FLAT_TIMING_WHEEL_H
-#include <ESBFlatTimingWheel.h>
+#ifndef ESB_EVENT_LOOP_COUNTERS_H
+#include <ESBEventLoopCounters.h>
+#endif
+
+#ifndef ESB_HIERARCHICAL_TIMING_WHEEL_H
+#include <ESBHierarchicalTimingWheel.h>
 #endif
 
 #ifdef HAVE_SYS_EPOLL_H
@@ -87,6 +91,12 @@ class EpollMultiplexer : public SocketMultiplexer {
    */
   virtual Error removeMultiplexedSocket(MultiplexedSocket *socket);
 
+  virtual Error addTimer(Timer *timer, UInt32 delayMsec);
+
+  virtual Error updateTimer(Timer *timer, UInt32 delayMsec);
+
+  virtual Error removeTimer(Timer *timer);
+
   /** Run the multiplexer's event loop until shutdown.
    *
    * @return If true, caller should destroy the command with the CleanupHandler.
@@ -112,6 +122,21 @@ class EpollMultiplexer : public SocketMultiplexer {
    */
   virtual bool isRunning() const;
 
+  virtual const EventLoopCounters *eventLoopCounters() const;
+
+  /** Get the number of epoll_ctl(EPOLL_CTL_MOD) calls issued to change a socket's readiness events of interest.
+   *
+   * @return The number of interest updates that reached the kernel.
+   */
+  inline UInt64 interestUpdates() const { return _interestUpdates; }
+
+  /** Get the number of epoll_ctl(EPOLL_CTL_MOD) calls skipped because a socket's readiness events of interest had not
+   * changed since they were last registered.
+   *
+   * @return The number of avoided interest updates.
+   */
+  inline UInt64 avoidedInterestUpdates() const { return _avoidedInterestUpdates; }
+
  private:
   /** Destroy the multiplexer
    *
@@ -128,9 +153,9 @@ class EpollMultiplexer : public SocketMultiplexer {
    */
   void checkIdleSockets();
 
-  struct DescriptorState {
-    int _interests;
-  };
+  /** Call the handlers of any expired timers
+   */
+  void checkTimers();
 
   int _epollDescriptor;
   const UInt32 _idleTimeoutMsec;
@@ -140,14 +165,17 @@ class EpollMultiplexer : public SocketMultiplexer {
 #else
 #error "struct epoll_event is required"
 #endif
-  struct DescriptorState *_eventCache;
   ESB::SharedInt *_isRunning;
   Allocator &_allocator;
+  UInt64 _interestUpdates;
+  UInt64 _avoidedInterestUpdates;
   SharedInt _activeSocketCount;
   EmbeddedList _activeSockets;
   EmbeddedList _deadSockets;
-  FlatTimingWheel _timingWheel;
+  HierarchicalTimingWheel _timingWheel;
+  HierarchicalTimingWheel _timers;
   char _namePrefix[ESB_NAME_PREFIX_SIZE];
+  EventLoopCounters _counters;
 
   ESB_DEFAULT_FUNCS(EpollMultiplexer);
 };
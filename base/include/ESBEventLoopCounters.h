@@ -0,0 +1,182 @@
+#ifndef ESB_EVENT_LOOP_COUNTERS_H
+#define ESB_EVENT_LOOP_COUNTERS_H
+
+#ifndef ESB_HISTOGRAM_PERFORMANCE_COUNTER_H
+#include <ESBHistogramPerformanceCounter.h>
+#endif
+
+/** A single handler call that keeps the event loop busy for longer than this many microseconds is logged along with
+ *  the socket that made it.
+ */
+#ifndef ESB_EVENT_LOOP_STALL_USEC
+#define ESB_EVENT_LOOP_STALL_USEC 100000U
+#endif
+
+namespace ESB {
+
+/** Counters that describe a socket multiplexer's event loop: how long it sleeps waiting for events, how many events
+ *  each wakeup delivers, how long the handlers take, and how often the kernel reports readiness that no handler
+ *  wanted.
+ *
+ *  Only the multiplexer's thread records.  Any thread may read, and readers racing with the recording thread may see
+ *  slightly stale values.
+ *
+ *  @ingroup network
+ */
+class EventLoopCounters {
+ public:
+  /** Constructor.
+   *
+   * @param name A prefix for the counters' names, usually the multiplexer's name.  It must outlive the counters.
+   */
+  EventLoopCounters(const char *name);
+
+  virtual ~EventLoopCounters();
+
+  /** Record a return from the system call that waits for events.
+   *
+   * @param start When the loop started waiting
+   * @param stop When the wait returned
+   * @param events The number of events the wait returned, 0 if it timed out
+   */
+  void recordWait(const Date &start, const Date &stop, UInt32 events);
+
+  /** Record the time the loop spent handling one batch of events, from the wakeup until it waits again.
+   *
+   * @param start When the wait returned
+   * @param stop When the loop started waiting again
+   */
+  void recordBusy(const Date &start, const Date &stop);
+
+  /** Record the time spent in MultiplexedSocket::handleAccept() for one readiness event.
+   *
+   * @param start When the handler was called
+   * @param stop When the handler returned
+   * @param socketName The socket's name, logged if the handler stalled the loop
+   */
+  inline void recordAccept(const Date &start, const Date &stop, const char *socketName) {
+    recordHandler(_accept, start, stop, socketName);
+  }
+
+  /** Record the time spent in MultiplexedSocket::handleConnect().
+   *
+   * @param start When the handler was called
+   * @param stop When the handler returned
+   * @param socketName The socket's name, logged if the handler stalled the loop
+   */
+  inline void recordConnect(const Date &start, const Date &stop, const char *socketName) {
+    recordHandler(_connect, start, stop, socketName);
+  }
+
+  /** Record the time spent in MultiplexedSocket::handleReadable().
+   *
+   * @param start When the handler was called
+   * @param stop When the handler returned
+   * @param socketName The socket's name, logged if the handler stalled the loop
+   */
+  inline void recordReadable(const Date &start, const Date &stop, const char *socketName) {
+    recordHandler(_readable, start, stop, socketName);
+  }
+
+  /** Record the time spent in MultiplexedSocket::handleWritable().
+   *
+   * @param start When the handler was called
+   * @param stop When the handler returned
+   * @param socketName The socket's name, logged if the handler stalled the loop
+   */
+  inline void recordWritable(const Date &start, const Date &stop, const char *socketName) {
+    recordHandler(_writable, start, stop, socketName);
+  }
+
+  /** Record the time spent destroying the sockets removed during one batch of events.
+   *
+   * @param start When cleanup started
+   * @param stop When cleanup finished
+   */
+  inline void recordCleanup(const Date &start, const Date &stop) { _cleanup.record(start, stop); }
+
+  /** Count a readable event delivered to a connected socket that did not want to read.
+   */
+  inline void countSpuriousReadable() { Increment(&_spuriousReadable); }
+
+  /** Count a writable event delivered to a connected socket that had nothing to send.  Readiness is level-triggered,
+   *  so a socket whose registered interests lag behind its state will keep waking the loop until they are updated.
+   */
+  inline void countSpuriousWritable() { Increment(&_spuriousWritable); }
+
+  inline const HistogramPerformanceCounter &wait() const { return _wait; }
+  inline const HistogramPerformanceCounter &busy() const { return _busy; }
+  inline const HistogramPerformanceCounter &accept() const { return _accept; }
+  inline const HistogramPerformanceCounter &connect() const { return _connect; }
+  inline const HistogramPerformanceCounter &readable() const { return _readable; }
+  inline const HistogramPerformanceCounter &writable() const { return _writable; }
+  inline const HistogramPerformanceCounter &cleanup() const { return _cleanup; }
+
+  /** Get the number of times the wait for events returned, including timeouts.
+   *
+   * @return The number of wakeups
+   */
+  inline UInt64 wakeups() const { return __atomic_load_n(&_wakeups, __ATOMIC_RELAXED); }
+
+  /** Get the total number of events delivered by all wakeups.
+   *
+   * @return The number of events
+   */
+  inline UInt64 events() const { return __atomic_load_n(&_events, __ATOMIC_RELAXED); }
+
+  /** Get the largest number of events delivered by a single wakeup.
+   *
+   * @return The largest batch of events
+   */
+  inline UInt64 maxEvents() const { return __atomic_load_n(&_maxEvents, __ATOMIC_RELAXED); }
+
+  inline UInt64 spuriousReadable() const { return __atomic_load_n(&_spuriousReadable, __ATOMIC_RELAXED); }
+
+  inline UInt64 spuriousWritable() const { return __atomic_load_n(&_spuriousWritable, __ATOMIC_RELAXED); }
+
+  /** Get a moving average of the time the loop spent handling each batch of events.  This is roughly how long a new
+   *  event waits before the loop gets to it.
+   *
+   * @return The exponentially weighted moving average of the busy time in microseconds
+   */
+  inline UInt64 lagMicroSeconds() const { return __atomic_load_n(&_lagMicroSeconds, __ATOMIC_RELAXED); }
+
+  /** Get the number of handler calls that kept the loop busy for longer than ESB_EVENT_LOOP_STALL_USEC.
+   *
+   * @return The number of stalls
+   */
+  inline UInt64 stalls() const { return __atomic_load_n(&_stalls, __ATOMIC_RELAXED); }
+
+  void log(Logger &logger, Logger::Severity severity = Logger::Severity::Debug) const;
+
+ private:
+  // Only the owning thread writes, so a relaxed load and store is enough and avoids a locked instruction.
+  static inline void Increment(UInt64 *value, UInt64 delta = 1U) {
+    __atomic_store_n(value, __atomic_load_n(value, __ATOMIC_RELAXED) + delta, __ATOMIC_RELAXED);
+  }
+
+  void recordHandler(HistogramPerformanceCounter &counter, const Date &start, const Date &stop,
+                     const char *socketName);
+
+  const char *_name;
+  UInt64 _wakeups;
+  UInt64 _events;
+  UInt64 _maxEvents;
+  UInt64 _spuriousReadable;
+  UInt64 _spuriousWritable;
+  UInt64 _stalls;
+  UInt64 _lagMicroSeconds;
+  HistogramPerformanceCounter _wait;
+  HistogramPerformanceCounter _busy;
+  HistogramPerformanceCounter _accept;
+  HistogramPerformanceCounter _connect;
+  HistogramPerformanceCounter _readable;
+  HistogramPerformanceCounter _writable;
+  HistogramPerformanceCounter _cleanup;
+
+  ESB_DEFAULT_FUNCS(EventLoopCounters);
+};
+
+}  // namespace ESB
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef ESB_HIERARCHICAL_TIMING_WHEEL_H
+#define ESB_HIERARCHICAL_TIMING_WHEEL_H
+
+#ifndef ESB_EMBEDDED_LIST_H
+#include <ESBEmbeddedList.h>
+#endif
+
+#ifndef ESB_TIMER_H
+#include <ESBTimer.h>
+#endif
+
+#ifndef ESB_SYSTEM_ALLOCATOR_H
+#include <ESBSystemAllocator.h>
+#endif
+
+#ifndef ESB_DATE_H
+#include <ESBDate.h>
+#endif
+
+#define ESB_TIMING_WHEEL_SLOT_BITS 6
+#define ESB_TIMING_WHEEL_SLOTS (1 << ESB_TIMING_WHEEL_SLOT_BITS)
+#define ESB_TIMING_WHEEL_LEVELS ((32 + ESB_TIMING_WHEEL_SLOT_BITS - 1) / ESB_TIMING_WHEEL_SLOT_BITS)
+
+namespace ESB {
+
+/** A hierarchical timing wheel with the same interface and semantics as FlatTimingWheel.  Timers are kept in a few
+ * levels of 64 slots each, and a level's slot is only redistributed to the levels below it when the wheel reaches it,
+ * so memory use is independent of the number of ticks and expiration is O(1) amortized.  Per-level occupancy bitmaps
+ * let nextExpired() skip empty slots instead of scanning them.  See "Hashed and Hierarchical Timing Wheels: Data
+ * Structures for the Efficient Implementation of a Timer Facility" by Varghese et al.
+ *
+ *  @ingroup util
+ */
+class HierarchicalTimingWheel {
+ public:
+  /** Constructor.
+   *
+   * @param ticks The maximum delay in ticks.  Unlike FlatTimingWheel this does not affect memory usage.
+   * @param tickMilliSeconds The resolution of the timing wheel
+   * @param now The current time
+   * @param allocator The allocator to use for the slots
+   */
+  HierarchicalTimingWheel(UInt32 ticks, UInt32 tickMilliSeconds, const Date &now,
+                          Allocator &allocator = SystemAllocator::Instance());
+
+  /** Destructor.
+   */
+  virtual ~HierarchicalTimingWheel();
+
+  /** Insert/schedule a timer.  O(1).
+   *
+   *  NB: both underflows and overflows can unexpectedly occur if remove() is not called frequently enough.  Only
+   * remove() advances the timing wheel's view of the current time.
+   *
+   *  @param timer The timer to activate after a delay.
+   *  @param delayMilliSeconds the milliseconds to wait before executing the command
+   *  @param now The current time
+   *  @return ESB_SUCCESS if successful, ESB_OVERFLOW if delay too far into the future, ESB_UNDERFLOW if delay has
+   * already expired - caller should act like the timer just expired.
+   */
+  Error insert(Timer *timer, UInt32 delayMilliSeconds, const Date &now);
+
+  /** Update a scheduled timer.  O(1) but corruption will occur if the timer is not in the timing wheel.
+   *
+   *  @param timer The timer to activate after a delay.
+   *  @param delayMilliSeconds the milliseconds to wait before executing the command
+   *  @param now The current time
+   *  @return ESB_SUCCESS if successful, ESB_OVERFLOW if delay too far into the future, ESB_UNDERFLOW if delay has
+   * already past - caller should act like the timer just expired and the timer will be removed as a side effect.
+   */
+  Error update(Timer *timer, UInt32 delayMilliSeconds, const Date &now);
+
+  /**
+   * Remove/cancel a timer.  O(1) but corruption will occur if the timer is not in the timing wheel.
+   *
+   * @param timer The timer to remove/cancel.
+   * @return ESB_SUCCESS if successful, another error code otherwise.  Always succeeds unless timer is NULL.
+   */
+  Error remove(Timer *timer);
+
+  /**
+   * Remove an expired timer from the timing wheel.  Caller should keep calling this until it returns null.  O(1)
+   * amortized.
+   *
+   * @param now The current time
+   * @return A timer which has expired, or NULL if there are no more expired timers.
+   */
+  Timer *nextExpired(const Date &now);
+
+  /**
+   * Remove all timers from the timing wheel, calling their cleanup handlers in the process.
+   */
+  void clear();
+
+  inline UInt32 maxDelayMilliSeconds() { return _tickMilliSeconds * _maxTicks; }
+
+ private:
+  inline UInt32 ticks(Date date) const {
+    UInt32 ticks = date.seconds() * 1000 / _tickMilliSeconds;
+    ticks += date.microSeconds() / 1000 / _tickMilliSeconds;
+    return ticks;
+  }
+
+  inline static UInt32 Index(UInt32 tick, UInt32 level) {
+    return (tick >> (level * ESB_TIMING_WHEEL_SLOT_BITS)) & (ESB_TIMING_WHEEL_SLOTS - 1);
+  }
+
+  void add(Timer *timer);
+
+  void unlink(Timer *timer);
+
+  UInt32 level(UInt32 tick) const;
+
+  const Date _start;
+  const UInt32 _tickMilliSeconds;
+  const UInt32 _maxTicks;
+  UInt32 _currentTick;  // relative to _start, and in ticks.  Same meaning as FlatTimingWheel's.
+  UInt32 _wheelTick;    // the tick the levels are laid out around.  Runs ahead of _currentTick while draining a slot.
+  UInt64 _occupied[ESB_TIMING_WHEEL_LEVELS];
+  EmbeddedList *_timers;  // ESB_TIMING_WHEEL_LEVELS * ESB_TIMING_WHEEL_SLOTS
+  Allocator &_allocator;
+
+  ESB_DEFAULT_FUNCS(HierarchicalTimingWheel);
+};
+
+}  // namespace ESB
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef ESB_HISTOGRAM_PERFORMANCE_COUNTER_H
+#define ESB_HISTOGRAM_PERFORMANCE_COUNTER_H
+
+#ifndef ESB_PERFORMANCE_COUNTER_H
+#include <ESBPerformanceCounter.h>
+#endif
+
+#ifndef ESB_SYSTEM_ALLOCATOR_H
+#include <ESBSystemAllocator.h>
+#endif
+
+/** Each power of two range of latencies is split into this many linear buckets (as a power of two), so percentiles are
+ *  accurate to within 1 / 2^ESB_HISTOGRAM_SUB_BUCKET_BITS of the true value.
+ */
+#ifndef ESB_HISTOGRAM_SUB_BUCKET_BITS
+#define ESB_HISTOGRAM_SUB_BUCKET_BITS 5
+#endif
+
+/** The max number of per-thread shards.  Threads beyond this share shards.
+ */
+#ifndef ESB_HISTOGRAM_MAX_SHARDS
+#define ESB_HISTOGRAM_MAX_SHARDS 16
+#endif
+
+#define ESB_HISTOGRAM_SUB_BUCKETS (1U << ESB_HISTOGRAM_SUB_BUCKET_BITS)
+#define ESB_HISTOGRAM_BUCKETS ((32U - ESB_HISTOGRAM_SUB_BUCKET_BITS + 1U) * ESB_HISTOGRAM_SUB_BUCKETS)
+
+namespace ESB {
+
+/** A PerformanceCounter that keeps a log-linear (HDR-style) histogram of latencies in microseconds so it can report
+ *  percentiles as well as the mean, min, and max.  Latencies up to 2^32 microseconds are recorded, longer latencies
+ *  are recorded as 2^32 - 1.
+ *
+ *  Recording is lock-free: each thread records into its own shard with relaxed atomics, and reads merge the shards.
+ *  Shards are allocated the first time a thread records.  Reads racing with records may see a slightly stale but
+ *  otherwise consistent view.
+ *
+ *  @ingroup util
+ */
+class HistogramPerformanceCounter : public PerformanceCounter {
+ public:
+  /**
+   * Create a new counter with a dynamically determined window.
+   *
+   * @param name The counter's name
+   * @param shards The number of shards to spread recording threads across.  1 is appropriate if the caller already
+   *  serializes calls to record().
+   * @param allocator The source of the shards' memory
+   */
+  HistogramPerformanceCounter(const char *name, UInt32 shards = ESB_HISTOGRAM_MAX_SHARDS,
+                              Allocator &allocator = SystemAllocator::Instance());
+
+  /**
+   * Create a new counter with a pre-defined window.
+   *
+   * @param name The counter's name
+   * @param windowStart the start time of the counter's window
+   * @param windowStop The stop time of the counter's window
+   * @param shards The number of shards to spread recording threads across.  1 is appropriate if the caller already
+   *  serializes calls to record().
+   * @param allocator The source of the shards' memory
+   */
+  HistogramPerformanceCounter(const char *name, const Date &windowStart, const Date &windowStop, UInt32 shards = 1U,
+                              Allocator &allocator = SystemAllocator::Instance());
+
+  virtual ~HistogramPerformanceCounter();
+
+  inline const char *name() const { return _name; }
+
+  inline const Date &windowStart() const { return _windowStart; }
+
+  inline const Date &windowStop() const { return _windowStop; }
+
+  double queriesPerSec() const;
+
+  virtual UInt32 queries() const;
+
+  double meanMSec() const;
+
+  double minMSec() const;
+
+  double maxMSec() const;
+
+  /**
+   * Get the latency at a percentile.  This is the highest latency in the percentile's bucket, so it may overstate the
+   * true latency by up to 1 / 2^ESB_HISTOGRAM_SUB_BUCKET_BITS, but it never exceeds the max.
+   *
+   * @param percentile The percentile in the range [0, 100], e.g., 99.9
+   * @return The latency in milliseconds, or 0 if nothing has been recorded.
+   */
+  double percentileMSec(double percentile) const;
+
+  virtual void record(const Date &start, const Date &stop);
+
+  /**
+   * Record a latency.
+   *
+   * @param microSeconds The latency in microseconds.
+   */
+  void record(UInt64 microSeconds);
+
+  virtual void log(Logger &logger, Logger::Severity severity) const;
+
+  virtual void snapshot(Snapshot *snapshot) const;
+
+  /**
+   * Get the bucket that records a latency.
+   *
+   * @param microSeconds The latency in microseconds.
+   * @return The index of the bucket, always less than ESB_HISTOGRAM_BUCKETS.
+   */
+  static UInt32 BucketIndex(UInt64 microSeconds);
+
+  /**
+   * Get the highest latency a bucket records.
+   *
+   * @param index The index of the bucket
+   * @return The highest latency in microseconds.
+   */
+  static UInt64 BucketValue(UInt32 index);
+
+ private:
+  typedef struct {
+    UInt64 _n;
+    UInt64 _sumMicroSeconds;
+    UInt64 _minMicroSeconds;
+    UInt64 _maxMicroSeconds;
+    UInt32 _counts[ESB_HISTOGRAM_BUCKETS];
+  } Shard;
+
+  typedef struct {
+    UInt64 _n;
+    UInt64 _sumMicroSeconds;
+    UInt64 _minMicroSeconds;
+    UInt64 _maxMicroSeconds;
+    UInt64 _counts[ESB_HISTOGRAM_BUCKETS];
+  } Summary;
+
+  Shard *shard();
+
+  void merge(Summary *summary) const;
+
+  double queriesPerSec(UInt64 queries) const;
+
+  static double Percentile(const Summary &summary, double percentile);
+
+  const char *_name;
+  const Date _windowStart;
+  const Date _windowStop;
+  const UInt32 _shardCount;
+  UInt64 _firstRecordMicroSeconds;
+  Shard *_shards[ESB_HISTOGRAM_MAX_SHARDS];
+  Allocator &_allocator;
+
+  ESB_DEFAULT_FUNCS(HistogramPerformanceCounter);
+};
+
+}  // namespace ESB
+
+#endif
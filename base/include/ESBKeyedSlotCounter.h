@@ -0,0 +1,111 @@
+#ifndef ESB_KEYED_SLOT_COUNTER_H
+#define ESB_KEYED_SLOT_COUNTER_H
+
+#ifndef ESB_CONFIG_H
+#include <ESBConfig.h>
+#endif
+
+#ifndef ESB_SYSTEM_ALLOCATOR_H
+#include <ESBSystemAllocator.h>
+#endif
+
+#if !defined HAVE_GCC_ATOMIC_INTRINSICS
+#error "KeyedSlotCounter needs __atomic intrinsics or equivalent"
+#endif
+
+/** A key is looked up in this many consecutive slots, 8 per cache line.
+ */
+#ifndef ESB_KEYED_SLOT_COUNTER_PROBES
+#define ESB_KEYED_SLOT_COUNTER_PROBES 16U
+#endif
+
+namespace ESB {
+
+/** Counts the slots each key, e.g. each client IPv4 address, has in use against a per key limit.  Meant for small
+ *  limits like a handful of connections per client, where counts must be exact.
+ *
+ *  Every entry is a single word holding the key and its count, so acquiring and releasing is one compare and swap with
+ *  no locks and no allocation.  A key lives in one of ESB_KEYED_SLOT_COUNTER_PROBES entries and an entry whose count
+ *  drops to 0 can be taken over by another key.  Entries with slots in use are never evicted: if every entry a new key
+ *  could use is busy, the key is let through uncounted and untracked() is incremented.  Callers must not release slots
+ *  that were not tracked, or they would return slots another acquisition of the key took after an entry freed up.
+ *
+ *  Two threads adding the same key at once can each take over a different free entry.  A thread that takes over an
+ *  entry, or brings one back from 0, then looks for another entry with the key in use.  If it finds one, it returns
+ *  its slots and tries again, so a key is only counted in two entries, and can only exceed its limit, in between.
+ *
+ *  @ingroup util
+ */
+class KeyedSlotCounter {
+ public:
+  /** Constructor.
+   *
+   * @param limit The maximum number of slots each key may have in use at once
+   * @param maxKeys The number of keys the table can hold, rounded up to a power of 2.
+   * @param allocator The allocator to use for the table.  Defaults to malloc.
+   */
+  KeyedSlotCounter(UInt32 limit, UInt32 maxKeys, Allocator &allocator = SystemAllocator::Instance());
+
+  virtual ~KeyedSlotCounter();
+
+  /** Take slots for a key.
+   *
+   * @param key The key, e.g. an IPv4 address
+   * @param slots The number of slots to take
+   * @param tracked If not NULL, set to false if the key could not be tracked and its slots must not be released, true
+   * otherwise.
+   * @return ESB_SUCCESS if the slots were taken or the key could not be tracked, ESB_OVERFLOW if that would exceed the
+   * key's limit and no slots were taken, ESB_OUT_OF_MEMORY if the table could not be allocated.
+   */
+  Error acquire(UInt32 key, UInt32 slots, bool *tracked = NULL);
+
+  /** Return slots taken by acquire().  Only release slots that acquire() tracked.
+   *
+   * @param key The key
+   * @param slots The number of slots to return
+   */
+  void release(UInt32 key, UInt32 slots);
+
+  /** Get the number of slots a key has in use.
+   *
+   * @param key The key
+   * @return The number of slots in use
+   */
+  UInt32 inUse(UInt32 key) const;
+
+  /** Get the number of keys the table can hold.
+   *
+   * @return The capacity or 0 if the table could not be allocated.
+   */
+  inline UInt32 capacity() const { return _entries ? _size : 0U; }
+
+  inline UInt32 limit() const { return _limit; }
+
+  /** Get the number of acquisitions let through because there was no free entry for their key.  A high rate suggests
+   *  the table is too small for the number of active clients.
+   *
+   * @return The number of untracked acquisitions
+   */
+  inline UInt64 untracked() const { return __atomic_load_n(&_untracked, __ATOMIC_RELAXED); }
+
+ private:
+  // The first entry for the hashed key with slots in use, else the first with nothing in use
+  UInt64 *find(UInt32 hash) const;
+
+  // Whether an entry other than this one has the hashed key in use
+  bool duplicated(const UInt64 *entry, UInt32 hash) const;
+
+  const UInt32 _limit;
+  const UInt32 _size;
+  UInt64 _untracked;
+  unsigned char *_block;
+  // The hashed key in the high 32 bits, the count in the low 32 bits
+  UInt64 *_entries;
+  Allocator &_allocator;
+
+  ESB_DEFAULT_FUNCS(KeyedSlotCounter);
+};
+
+}  // namespace ESB
+
+#endif
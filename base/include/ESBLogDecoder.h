@@ -0,0 +1,78 @@
+#ifndef ESB_LOG_DECODER_H
+#define ESB_LOG_DECODER_H
+
+#ifndef ESB_LOG_RECORD_H
+#include <ESBLogRecord.h>
+#endif
+
+#ifndef ESB_MAP_H
+#include <ESBMap.h>
+#endif
+
+#ifndef ESB_SYSTEM_ALLOCATOR_H
+#include <ESBSystemAllocator.h>
+#endif
+
+#ifdef HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
+namespace ESB {
+
+/** LogDecoder formats a file of LogRecords written by an AsyncFileLogger in BINARY output mode back into text.  A file
+ *  may hold the records of several processes one after another, each starting with a Header record that resets the
+ *  format strings seen so far.
+ *
+ *  @ingroup log
+ */
+class LogDecoder {
+ public:
+  /** Constructor
+   *
+   * @param allocator The allocator for format strings
+   */
+  LogDecoder(Allocator &allocator = SystemAllocator::Instance());
+
+  virtual ~LogDecoder();
+
+  /** Decode every record in a file.
+   *
+   * @param input The LogRecords are read from here
+   * @param output The formatted messages are written here
+   * @return ESB_SUCCESS if the whole file was decoded, ESB_CANNOT_PARSE if it has a malformed or truncated record or
+   *  does not start with a Header record, another error code otherwise.
+   */
+  Error decode(FILE *input, FILE *output);
+
+  /** Decode one record.
+   *
+   * @param record The record
+   * @param output The formatted message, if any, is written here
+   * @return ESB_SUCCESS if the record was decoded, ESB_CANNOT_FIND if it refers to an undefined format string,
+   *  ESB_CANNOT_PARSE if it is malformed, another error code otherwise.
+   */
+  Error decode(const unsigned char *record, FILE *output);
+
+  /** Forget every format string.
+   */
+  void clear();
+
+ private:
+  // A format string and its id, stored in one allocation and keyed by the id
+  struct FormatEntry {
+    UInt64 _id;
+    char _format[];
+  };
+
+  Allocator &_allocator;
+  LogRecord::IdComparator _comparator;
+  Map _formats;
+  unsigned char _record[ESB_LOG_RECORD_MAX_SIZE];
+  char _text[ESB_LOG_RECORD_MAX_SIZE];
+
+  ESB_DEFAULT_FUNCS(LogDecoder);
+};
+
+}  // namespace ESB
+
+#endif
@@ -0,0 +1,158 @@
+#ifndef ESB_LOG_RECORD_H
+#define ESB_LOG_RECORD_H
+
+#ifndef ESB_COMMON_H
+#include <ESBCommon.h>
+#endif
+
+#ifndef ESB_COMPARATOR_H
+#include <ESBComparator.h>
+#endif
+
+#if defined HAVE_STDARG_H
+#include <stdarg.h>
+#else
+#error "Need stdarg.h or equivalent"
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#define ESB_LOG_RECORD_HEADER_SIZE 3
+#define ESB_LOG_RECORD_MAX_SIZE ESB_UINT16_MAX
+
+namespace ESB {
+
+/** LogRecords are compact binary log messages that capture a printf-style format string and its arguments instead of
+ *  the formatted text, so formatting can be done later by another thread or by the log-decoder tool.  Capturing costs
+ *  a scan of the format string and a copy of the arguments.  Strings are copied into the record, everything else is
+ *  stored as 8 bytes.  Arguments that cannot be captured (%n, wide characters and strings, long doubles) are left to
+ *  the caller to format as a Text record.
+ *
+ *  Every record starts with a one byte kind and its two byte size including that header, both in host byte order:
+ *  <ul>
+ *      <li> Header.  Starts the records written by one process.
+ *      <li> Format.  Defines a format string and the id Arguments records refer to it by.
+ *      <li> Arguments.  A format string id followed by the message's arguments.  Within a process the id is the format
+ *           string's address, so format strings must have static storage duration.
+ *      <li> Text.  An already formatted message.
+ *  </ul>
+ *
+ *  @ingroup log
+ */
+class LogRecord {
+ public:
+  typedef enum { Header = 'H', Format = 'F', Arguments = 'A', Text = 'T' } Kind;
+
+  /** Encode a Header record.
+   *
+   * @param record The record will be written here
+   * @param capacity The size of record in bytes
+   * @return The size of the record, or 0 if it does not fit
+   */
+  static UInt32 EncodeHeader(unsigned char *record, UInt32 capacity);
+
+  /** Encode a Format record.
+   *
+   * @param record The record will be written here
+   * @param capacity The size of record in bytes
+   * @param format The format string.  Its address is the id.
+   * @return The size of the record, or 0 if it does not fit
+   */
+  static UInt32 EncodeFormat(unsigned char *record, UInt32 capacity, const char *format);
+
+  /** Capture a format string and its arguments as an Arguments record.
+   *
+   * @param record The record will be written here
+   * @param capacity The size of record in bytes
+   * @param format A printf-style format string with static storage duration
+   * @param args The arguments.  This is consumed.
+   * @return The size of the record, or 0 if it does not fit or an argument cannot be captured
+   */
+  static UInt32 EncodeArguments(unsigned char *record, UInt32 capacity, const char *format, va_list args);
+
+  /** Encode a Text record.
+   *
+   * @param record The record will be written here
+   * @param capacity The size of record in bytes
+   * @param text The formatted message
+   * @param length The length of the formatted message.  Truncated if it does not fit.
+   * @return The size of the record
+   */
+  static UInt32 EncodeText(unsigned char *record, UInt32 capacity, const char *text, UInt32 length);
+
+  /** Format an Arguments record.
+   *
+   * @param buffer The formatted message will be written here and NULL terminated
+   * @param capacity The size of buffer in bytes.  The message is truncated if it does not fit.
+   * @param format The format string the record was encoded with
+   * @param record The Arguments record
+   * @return The length of the formatted message, or -1 if the record does not match the format
+   */
+  static int Render(char *buffer, UInt32 capacity, const char *format, const unsigned char *record);
+
+  inline static Kind RecordKind(const unsigned char *record) { return (Kind)record[0]; }
+
+  inline static UInt32 RecordSize(const unsigned char *record) {
+    UInt16 size = 0;
+    memcpy(&size, record + 1, sizeof(size));
+    return size;
+  }
+
+  /** Get the format string id of a Format or Arguments record.
+   *
+   * @param record The record
+   * @return The id
+   */
+  inline static UInt64 FormatId(const unsigned char *record) {
+    UInt64 id = 0;
+    memcpy(&id, record + ESB_LOG_RECORD_HEADER_SIZE, sizeof(id));
+    return id;
+  }
+
+  /** Get the format string of a Format record.  It is not NULL terminated.
+   *
+   * @param record The Format record
+   * @param length The length of the format string will be written here
+   * @return The format string
+   */
+  inline static const char *FormatString(const unsigned char *record, UInt32 *length) {
+    *length = RecordSize(record) - ESB_LOG_RECORD_HEADER_SIZE - sizeof(UInt64);
+    return (const char *)record + ESB_LOG_RECORD_HEADER_SIZE + sizeof(UInt64);
+  }
+
+  /** Get the message of a Text record.  It is not NULL terminated.
+   *
+   * @param record The Text record
+   * @param length The length of the message will be written here
+   * @return The message
+   */
+  inline static const char *TextString(const unsigned char *record, UInt32 *length) {
+    *length = RecordSize(record) - ESB_LOG_RECORD_HEADER_SIZE;
+    return (const char *)record + ESB_LOG_RECORD_HEADER_SIZE;
+  }
+
+  /** Orders format string ids, for maps keyed by a pointer to a UInt64 id.
+   */
+  class IdComparator : public Comparator {
+   public:
+    IdComparator() {}
+
+    virtual ~IdComparator() {}
+
+    virtual int compare(const void *first, const void *second) const;
+
+    ESB_DEFAULT_FUNCS(IdComparator);
+  };
+
+ private:
+  // Not implemented
+  LogRecord();
+
+  ESB_DISABLE_AUTO_COPY(LogRecord);
+};
+
+}  // namespace ESB
+
+#endif
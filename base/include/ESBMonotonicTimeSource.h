@@ -0,0 +1,64 @@
+#ifndef ESB_MONOTONIC_TIME_SOURCE_H
+#define ESB_MONOTONIC_TIME_SOURCE_H
+
+#ifndef ESB_TIME_SOURCE_H
+#include <ESBTimeSource.h>
+#endif
+
+namespace ESB {
+
+/** A microsecond resolution TimeSource that never jumps when the wall clock is set.  It reads the monotonic clock and
+ *  adds the wall clock time at startup, so its dates look like wall clock dates but only move forward.
+ *
+ *  A thread that calls update() caches the time and now() returns the cached time until the thread calls update()
+ *  again, so event loops can read the clock once per iteration and every other read is free.  Threads that never call
+ *  update() read the clock on every call to now().
+ *
+ *  @ingroup util
+ */
+class MonotonicTimeSource : public TimeSource {
+ public:
+  /** Constructor */
+  static inline MonotonicTimeSource &Instance() { return _Instance; }
+
+  /** Destructor. */
+  virtual ~MonotonicTimeSource();
+
+  /** Get the time cached by the calling thread, or the current time if the calling thread does not cache it.
+   *
+   *  @return date object set to the current or cached time.
+   */
+  virtual Date now();
+
+  /** Read the clock and cache the time for the calling thread.
+   *
+   *  @return date object set to the current time.
+   */
+  Date update();
+
+  /** Stop caching the time for the calling thread.
+   */
+  void reset();
+
+  /** Read the clock without caching.
+   *
+   *  @return date object set to the current time.
+   */
+  Date read() const;
+
+ private:
+  //  Disabled
+  MonotonicTimeSource();
+
+  static UInt64 MonotonicMicroSeconds();
+
+  const UInt64 _basis;  // wall clock at startup minus the monotonic clock at startup, in microseconds
+
+  static MonotonicTimeSource _Instance;
+
+  ESB_DEFAULT_FUNCS(MonotonicTimeSource);
+};
+
+}  // namespace ESB
+
+#endif
@@ -39,6 +39,31 @@ class MultiplexedSocket : public EmbeddedMapElement {
 
   inline Timer &timer() { return _timer; }
 
+  /** Get the readiness events last registered with the socket multiplexer.  The multiplexer uses this to skip
+   * redundant kernel calls when the socket's interests have not changed.
+   *
+   * @return The registered readiness events, or 0 if the socket is not registered.
+   */
+  inline UInt32 registeredInterests() const { return _registeredInterests; }
+
+  /** Record the readiness events registered with the socket multiplexer.  Only the multiplexer should call this.
+   *
+   * @param interests The registered readiness events
+   */
+  inline void setRegisteredInterests(UInt32 interests) { _registeredInterests = interests; }
+
+  /** Get the opaque handle the socket multiplexer assigned when the socket was added.
+   *
+   * @return The multiplexer-specific registration handle
+   */
+  inline UInt32 registration() const { return _registration; }
+
+  /** Record the opaque handle assigned by the socket multiplexer.  Only the multiplexer should call this.
+   *
+   * @param registration The multiplexer-specific registration handle
+   */
+  inline void setRegistration(UInt32 registration) { _registration = registration; }
+
   /**
    * Should the socket be kept open indefinitely or should it be closed when inactive/idle?
    *
@@ -180,6 +205,8 @@ class MultiplexedSocket : public EmbeddedMapElement {
 
  private:
   Timer _timer;
+  UInt32 _registeredInterests;
+  UInt32 _registration;
 
   ESB_DEFAULT_FUNCS(MultiplexedSocket);
 };
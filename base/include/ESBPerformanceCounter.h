@@ -17,6 +17,19 @@ namespace ESB {
 
 class PerformanceCounter : public EmbeddedListElement {
  public:
+  /**
+   * A point in time summary of a counter, e.g., for export to a metrics system.
+   */
+  typedef struct {
+    UInt64 _queries;      /**< Queries recorded since the counter was created */
+    double _sumMSec;      /**< Sum of the latencies of those queries */
+    bool _hasPercentiles; /**< False if the counter does not track percentiles */
+    double _p50MSec;      /**< Latency percentiles over the counter's most recent window */
+    double _p90MSec;
+    double _p99MSec;
+    double _p999MSec;
+  } Snapshot;
+
   PerformanceCounter();
 
   virtual ~PerformanceCounter();
@@ -27,6 +40,13 @@ class PerformanceCounter : public EmbeddedListElement {
 
   virtual void log(Logger &logger, Logger::Severity severity = Logger::Severity::Debug) const = 0;
 
+  /**
+   * Summarize the counter without blocking threads that record into it for longer than it takes to read it.
+   *
+   * @param snapshot The summary will be written here
+   */
+  virtual void snapshot(Snapshot *snapshot) const = 0;
+
   virtual CleanupHandler *cleanupHandler();
 
   ESB_DEFAULT_FUNCS(PerformanceCounter);
@@ -0,0 +1,122 @@
+#ifndef ESB_RATE_LIMITER_H
+#define ESB_RATE_LIMITER_H
+
+#ifndef ESB_CONFIG_H
+#include <ESBConfig.h>
+#endif
+
+#ifndef ESB_SYSTEM_ALLOCATOR_H
+#include <ESBSystemAllocator.h>
+#endif
+
+#ifndef ESB_DATE_H
+#include <ESBDate.h>
+#endif
+
+#if !defined HAVE_GCC_ATOMIC_INTRINSICS
+#error "RateLimiter needs __atomic intrinsics or equivalent"
+#endif
+
+/** A key is looked up in this many consecutive slots, 4 per cache line, before an older key is evicted.
+ */
+#ifndef ESB_RATE_LIMITER_PROBES
+#define ESB_RATE_LIMITER_PROBES 8U
+#endif
+
+namespace ESB {
+
+/** A fixed size table of token buckets shared by all threads, for limiting the rate of connections or requests from
+ *  millions of distinct clients.  Each key may take up to limit tokens per window, and may take all of them at once.
+ *
+ *  Each bucket is a single word holding the time its tokens will be fully replenished (the generic cell rate
+ *  algorithm), so taking tokens is one compare and swap with no locks and no allocation.  The table is split into
+ *  shards by key hash, each with its own eviction hand, and a key lives in one of ESB_RATE_LIMITER_PROBES slots in its
+ *  shard.  When they are all taken by other keys, a key whose bucket is full is replaced first since forgetting it
+ *  loses nothing.  Otherwise a CLOCK sweep gives every recently used key a second chance before replacing it.
+ *
+ *  Buckets are approximate under races: a key being replaced while another thread takes its tokens can briefly see the
+ *  old key's bucket.
+ *
+ *  @ingroup util
+ */
+class RateLimiter {
+ public:
+  /** Constructor.
+   *
+   * @param limit The number of tokens each key may take per window
+   * @param windowMicroSeconds The window
+   * @param maxKeys The number of keys the table can hold, rounded up to a power of 2.  Least recently used keys are
+   * evicted beyond this.
+   * @param shards The number of shards, rounded up to a power of 2.  Typically one per core.
+   * @param allocator The allocator to use for the table.  Defaults to malloc.
+   */
+  RateLimiter(UInt32 limit, UInt64 windowMicroSeconds, UInt32 maxKeys, UInt32 shards,
+              Allocator &allocator = SystemAllocator::Instance());
+
+  virtual ~RateLimiter();
+
+  /** Take tokens from a key's bucket.
+   *
+   * @param key The key, e.g. an IPv4 address
+   * @param tokens The number of tokens to take
+   * @param now The current time from MonotonicTimeSource.  Buckets store the time they refill at, so a wall clock
+   * that is set back would stop every key until it catches up.
+   * @return ESB_SUCCESS if the key had enough tokens, ESB_OVERFLOW if it did not and no tokens were taken,
+   * ESB_OUT_OF_MEMORY if the table could not be allocated.
+   */
+  Error acquire(UInt64 key, UInt32 tokens, const Date &now);
+
+  /** Get the number of keys the table can hold.
+   *
+   * @return The capacity or 0 if the table could not be allocated.
+   */
+  inline UInt32 capacity() const { return _slots ? _shardCount * _shardSize : 0U; }
+
+  inline UInt32 shards() const { return _slots ? _shardCount : 0U; }
+
+  inline UInt32 limit() const { return _limit; }
+
+  /** Get the number of keys replaced while their buckets were still refilling.  A high rate suggests the table is too
+   *  small for the number of active clients.
+   *
+   * @return The number of evictions
+   */
+  UInt64 evictions() const;
+
+ private:
+  // The state is the time in nanoseconds when the bucket will be full, shifted left by 1 with the CLOCK reference bit
+  // in bit 0.  An unused slot has key 0 and state 0, which is a full bucket.
+  struct Slot {
+    UInt64 _key;
+    UInt64 _state;
+  };
+
+  // Written by any thread that has to evict from the shard
+  struct Shard {
+    UInt32 _hand;
+    UInt64 _evictions;
+  };
+
+  inline Shard *shardAt(UInt32 index) const { return (Shard *)(_shards + index * _shardHeaderSize); }
+
+  Slot *find(UInt64 key, UInt64 now);
+
+  Slot *evict(UInt32 shard, UInt32 start, UInt64 key, UInt64 now);
+
+  const UInt32 _limit;
+  const UInt64 _intervalNanoSeconds;
+  const UInt64 _windowNanoSeconds;
+  const UInt32 _shardCount;
+  const UInt32 _shardSize;
+  const UInt32 _shardHeaderSize;
+  unsigned char *_block;
+  unsigned char *_shards;
+  Slot *_slots;
+  Allocator &_allocator;
+
+  ESB_DEFAULT_FUNCS(RateLimiter);
+};
+
+}  // namespace ESB
+
+#endif
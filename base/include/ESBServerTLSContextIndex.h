@@ -14,6 +14,8 @@ namespace ESB {
  */
 class ServerTLSContextIndex : public TLSContextIndex {
  public:
+  static const UInt32 DefaultTicketKeyLifetimeSeconds = 3600;
+
   /**
    * Construct a new TLS Context Index.
    *
@@ -21,8 +23,11 @@ class ServerTLSContextIndex : public TLSContextIndex {
    * @param numLocks Number of locks for internal hash table.  If 0, no locking.  Else, more locks -> more memory, less
    * contention.
    * @param allocator The allocator to use for allocating internal buckets and nodes.
+   * @param ticketKeyLifetimeSeconds How long each session ticket key is used before the default context generates a
+   * new one.  0 disables session tickets, leaving clients to resume sessions by session id.
    */
-  ServerTLSContextIndex(UInt32 numBuckets, UInt32 numLocks, Allocator &allocator);
+  ServerTLSContextIndex(UInt32 numBuckets, UInt32 numLocks, Allocator &allocator,
+                        UInt32 ticketKeyLifetimeSeconds = DefaultTicketKeyLifetimeSeconds);
 
   virtual ~ServerTLSContextIndex();
 
@@ -49,6 +54,7 @@ class ServerTLSContextIndex : public TLSContextIndex {
 
  private:
   TLSContextPointer _defaultContext;
+  UInt32 _ticketKeyLifetimeSeconds;
 
   ESB_DEFAULT_FUNCS(ServerTLSContextIndex);
 };
@@ -34,6 +34,13 @@ class ServerTLSSocket : public TLSSocket {
   virtual const SocketAddress &peerAddress() const;
   virtual const void *key() const;
 
+  /**
+   * Get the index of TLS contexts used in SNI serving
+   *
+   * @return The server TLS context index
+   */
+  inline ServerTLSContextIndex &contextIndex() { return _contextIndex; }
+
  protected:
   virtual Error startHandshake();
 
@@ -0,0 +1,170 @@
+#ifndef ESB_SHARDED_BUFFER_POOL_H
+#define ESB_SHARDED_BUFFER_POOL_H
+
+#ifndef ESB_BUFFER_H
+#include <ESBBuffer.h>
+#endif
+
+#ifndef ESB_SYSTEM_ALLOCATOR_H
+#include <ESBSystemAllocator.h>
+#endif
+
+#ifndef ESB_EMBEDDED_LIST_H
+#include <ESBEmbeddedList.h>
+#endif
+
+#ifndef ESB_SHARED_INT_H
+#include <ESBSharedInt.h>
+#endif
+
+#if !defined HAVE_GCC_ATOMIC_INTRINSICS
+#error "ShardedBufferPool needs __atomic intrinsics or equivalent"
+#endif
+
+namespace ESB {
+
+/** A pool of equally sized Buffers shared by several threads.  Each thread owns a shard with a private cache of free
+ * buffers that it can use without synchronization.  A buffer always returns to the shard that allocated it: if a
+ * thread releases a buffer that belongs to another shard, the buffer is pushed onto that shard's lock-free return
+ * stack and the owning thread takes it back the next time its cache runs dry.  The total number of buffers across
+ * all shards can be capped, and a shard that hits the cap takes over the buffers waiting on other shards' return
+ * stacks before it gives up.
+ *
+ * acquireBuffer() and releaseBuffer() may only be called for a given shard by the thread that owns that shard.  The
+ * allocator must be thread-safe.
+ *
+ *  @ingroup util
+ */
+class ShardedBufferPool {
+ public:
+  /** Constructor.
+   *
+   * @param bufferSize The size in bytes of each individual buffer
+   * @param shards The number of shards, typically one per thread.
+   * @param maxBuffers The maximum number of buffers, in use or cached, across all shards.  0 for infinite.
+   * @param maxCachedBuffers The maximum number of free buffers each shard keeps.  Buffers released beyond this are
+   * freed.  0 for infinite.
+   * @param allocator The allocator to use to allocate buffers and shards.  Must be thread-safe.  Defaults to malloc.
+   */
+  ShardedBufferPool(UInt32 bufferSize, UInt32 shards, UInt32 maxBuffers = 0, UInt32 maxCachedBuffers = 0,
+                    Allocator &allocator = SystemAllocator::Instance());
+
+  /** Destructor.  Frees all cached and returned buffers.  Every buffer must have been released first.
+   */
+  virtual ~ShardedBufferPool();
+
+  /** Get a buffer from a shard's cache, taking back buffers released by other threads if the cache is empty.  If
+   * neither has a buffer, allocate a new buffer, or at the pool's maximum size take over the free buffers on another
+   * shard's return stack.
+   *
+   * @param shard The caller's shard
+   * @return A buffer or NULL if the pool is at its maximum size with no free buffer to take over, or a new buffer
+   * could not be allocated.
+   */
+  Buffer *acquireBuffer(UInt32 shard);
+
+  /** Return a buffer to the pool.  Buffers from other shards are sent home, buffers from this shard are cached or
+   * freed if the shard's cache is full.
+   *
+   * @param shard The caller's shard
+   * @param buffer The buffer to return to the pool
+   */
+  void releaseBuffer(UInt32 shard, Buffer *buffer);
+
+  /** Get the number of shards.
+   *
+   * @return The number of shards or 0 if the shards could not be allocated.
+   */
+  inline UInt32 shards() const { return _shards ? _shardCount : 0U; }
+
+  inline UInt32 bufferSize() const { return _bufferSize; }
+
+  /** Get the number of buffers currently allocated across all shards, whether in use or cached.
+   *
+   * @return The number of allocated buffers
+   */
+  inline UInt32 buffers() const { return _buffers.get(); }
+
+  /** Get the largest number of buffers that have been allocated at the same time.
+   *
+   * @return The high watermark
+   */
+  inline UInt32 highWatermark() const { return __atomic_load_n(&_highWatermark, __ATOMIC_RELAXED); }
+
+  /** Get the number of free buffers in a shard's cache.  Only exact when called by the shard's owner.
+   *
+   * @param shard The shard
+   * @return The number of cached buffers
+   */
+  UInt32 cachedBuffers(UInt32 shard) const;
+
+  /** Get the number of buffers that have been released by a thread other than the one that allocated them.
+   *
+   * @return The number of cross-shard releases
+   */
+  inline UInt32 remoteReleases() const { return _remoteReleases.get(); }
+
+  /** Get the number of acquisitions that were satisfied by a cached or returned buffer.
+   *
+   * @return The number of acquisitions that did not allocate
+   */
+  UInt64 hits() const;
+
+  /** Get the number of acquisitions that had to allocate a new buffer or take over another shard's buffers, or that
+   * failed because the pool was full.
+   *
+   * @return The number of acquisitions that did not find a free buffer
+   */
+  UInt64 misses() const;
+
+ private:
+  // Written by the owning thread except for _returned which any thread may push onto.  Counters are read by other
+  // threads, so they are always accessed atomically.
+  struct Shard {
+    EmbeddedList _cache;
+    UInt32 _cached;
+    UInt64 _hits;
+    UInt64 _misses;
+    EmbeddedListElement *volatile _returned;
+  };
+
+  // Precedes every buffer so releaseBuffer() can find the buffer's home.
+  struct Header {
+    UInt32 _shard;
+  };
+
+  inline Shard *shardAt(UInt32 index) const { return (Shard *)(_shards + index * _shardSize); }
+
+  static inline UInt32 Cached(const Shard *shard) { return __atomic_load_n(&shard->_cached, __ATOMIC_RELAXED); }
+
+  static inline void SetCached(Shard *shard, UInt32 cached) {
+    __atomic_store_n(&shard->_cached, cached, __ATOMIC_RELAXED);
+  }
+
+  static inline void Count(UInt64 *counter) {
+    __atomic_store_n(counter, __atomic_load_n(counter, __ATOMIC_RELAXED) + 1U, __ATOMIC_RELAXED);
+  }
+
+  void takeReturned(Shard *shard);
+  Buffer *reclaimReturned(UInt32 index);
+  void cacheBuffer(Shard *shard, Buffer *buffer);
+  void destroyBuffer(Buffer *buffer);
+
+  const UInt32 _bufferSize;
+  const UInt32 _shardCount;
+  const UInt32 _shardSize;
+  const UInt32 _maxBuffers;
+  const UInt32 _maxCachedBuffers;
+  unsigned char *_shardBlock;
+  unsigned char *_shards;
+  Allocator &_allocator;
+  SharedInt _buffers;
+  volatile UInt32 _highWatermark;
+  SharedInt _remoteReleases;
+
+  ESB_DEFAULT_FUNCS(ShardedBufferPool);
+};
+
+}  // namespace ESB
+
+#endif
@@ -71,6 +71,22 @@ class SharedEmbeddedMap : public EmbeddedMapBase {
    */
   EmbeddedMapElement *remove(const void *key);
 
+  /** Remove the value that was inserted or found the longest time ago for a key.  O(n) in the number of values that
+   * share the key's bucket.
+   *
+   *  @param key The key of to remove.
+   *  @return The value associated with the last occurrence of the key, or NULL
+   * if the key couldn't be found.
+   */
+  EmbeddedMapElement *removeLast(const void *key);
+
+  /** Count the values associated with a key.  O(n) in the number of values that share the key's bucket.
+   *
+   *  @param key The key
+   *  @return The number of values associated with the key
+   */
+  UInt32 count(const void *key);
+
   /** Find a value in the map given its key.  O(1).
    *
    *  @param key The key of the key/value pair to find.
@@ -57,6 +57,8 @@ class SimplePerformanceCounter : public PerformanceCounter {
 
   virtual void log(Logger &logger, Logger::Severity severity) const;
 
+  virtual void snapshot(Snapshot *snapshot) const;
+
  private:
   double queriesPerSecNoLock() const;
 
@@ -0,0 +1,97 @@
+#ifndef ESB_SIZE_CLASS_BUFFER_POOL_H
+#define ESB_SIZE_CLASS_BUFFER_POOL_H
+
+#ifndef ESB_SHARDED_BUFFER_POOL_H
+#include <ESBShardedBufferPool.h>
+#endif
+
+#ifndef ESB_LOGGER_H
+#include <ESBLogger.h>
+#endif
+
+#define ESB_MAX_BUFFER_SIZE_CLASSES 8
+
+namespace ESB {
+
+/** A set of ShardedBufferPools with different buffer sizes.  Size class 0 has the smallest buffers.  Callers pick a
+ * size class when they acquire a buffer and the pool finds the size class of a released buffer from its capacity.
+ * Each size class is capped on its own, so the pool can hold up to sizeClasses() times the per class cap.
+ *
+ *  @ingroup util
+ */
+class SizeClassBufferPool {
+ public:
+  /** Constructor.
+   *
+   * @param bufferSizes The size in bytes of the buffers in each size class in strictly ascending order
+   * @param sizeClasses The number of size classes, at most ESB_MAX_BUFFER_SIZE_CLASSES
+   * @param shards The number of shards, typically one per thread.
+   * @param maxBuffersPerClass The maximum number of buffers, in use or cached, in each size class.  0 for infinite.
+   * @param maxCachedBuffers The maximum number of free buffers each shard keeps in each size class.  0 for infinite.
+   * @param allocator The allocator to use to allocate buffers and pools.  Must be thread-safe.  Defaults to malloc.
+   */
+  SizeClassBufferPool(const UInt32 *bufferSizes, UInt32 sizeClasses, UInt32 shards, UInt32 maxBuffersPerClass = 0,
+                      UInt32 maxCachedBuffers = 0, Allocator &allocator = SystemAllocator::Instance());
+
+  /** Destructor.  Every buffer must have been released first.
+   */
+  virtual ~SizeClassBufferPool();
+
+  /** Get a buffer from a size class.  See ShardedBufferPool::acquireBuffer().
+   *
+   * @param shard The caller's shard
+   * @param sizeClass The size class.  Larger values are clamped to the largest size class.
+   * @return A buffer or NULL if the size class is at its maximum size or a new buffer could not be allocated.
+   */
+  Buffer *acquireBuffer(UInt32 shard, UInt32 sizeClass);
+
+  /** Return a buffer to the size class it was acquired from.  See ShardedBufferPool::releaseBuffer().  A buffer that
+   * matches no size class is assumed to come from Buffer::Create() with this pool's allocator and is destroyed.
+   *
+   * @param shard The caller's shard
+   * @param buffer The buffer to return to the pool
+   */
+  void releaseBuffer(UInt32 shard, Buffer *buffer);
+
+  /** Get the number of size classes.
+   *
+   * @return The number of size classes or 0 if the pools could not be allocated.
+   */
+  inline UInt32 sizeClasses() const { return _sizeClasses; }
+
+  /** Get the size of the buffers in a size class.
+   *
+   * @param sizeClass The size class.  Larger values are clamped to the largest size class.
+   * @return The buffer size in bytes or 0 if there are no size classes.
+   */
+  inline UInt32 bufferSize(UInt32 sizeClass) const {
+    return 0 == _sizeClasses ? 0U : _pools[MIN(sizeClass, _sizeClasses - 1)]->bufferSize();
+  }
+
+  /** Get the pool behind a size class for its statistics.
+   *
+   * @param sizeClass The size class
+   * @return The pool or NULL if there is no such size class
+   */
+  inline const ShardedBufferPool *pool(UInt32 sizeClass) const {
+    return sizeClass < _sizeClasses ? _pools[sizeClass] : NULL;
+  }
+
+  /** Log each size class's occupancy and hit rate.
+   *
+   * @param logger The logger
+   * @param severity The severity to log at
+   */
+  void log(Logger &logger, Logger::Severity severity) const;
+
+ private:
+  UInt32 _sizeClasses;
+  Allocator &_allocator;
+  ShardedBufferPool *_pools[ESB_MAX_BUFFER_SIZE_CLASSES];
+
+  ESB_DEFAULT_FUNCS(SizeClassBufferPool);
+};
+
+}  // namespace ESB
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef ESB_SLOT_COUNTER_H
+#define ESB_SLOT_COUNTER_H
+
+#ifndef ESB_CONFIG_H
+#include <ESBConfig.h>
+#endif
+
+#ifndef ESB_SYSTEM_ALLOCATOR_H
+#include <ESBSystemAllocator.h>
+#endif
+
+#if !defined HAVE_GCC_ATOMIC_INTRINSICS
+#error "SlotCounter needs __atomic intrinsics or equivalent"
+#endif
+
+/** Each shard leases limit / (shards * ESB_SLOT_COUNTER_LEASE_FRACTION) slots at a time.  Limits too small to give
+ *  every shard a lease of at least one slot are counted strictly.
+ */
+#ifndef ESB_SLOT_COUNTER_LEASE_FRACTION
+#define ESB_SLOT_COUNTER_LEASE_FRACTION 16U
+#endif
+
+namespace ESB {
+
+/** Counts slots in use, e.g. open connections, against a limit shared by all threads.
+ *
+ *  In strict mode every acquire and release is a compare and swap on one shared count.  Otherwise each thread works
+ *  on its own shard, which leases a batch of slots from the shared count and hands out and takes back slots from its
+ *  lease without touching the shared count's cache line.  A shard holding more than two leases returns all but one.
+ *  When the shared count runs dry, the leases of every shard are reconciled back into it before giving up, so the
+ *  limit is never exceeded and slots parked in idle shards do not cause spurious rejections.
+ *
+ *  Slots may be released by a different thread than the one that acquired them.  Releasing slots that were never
+ *  acquired raises the limit.
+ *
+ *  @ingroup util
+ */
+class SlotCounter {
+ public:
+  /** Constructor.
+   *
+   * @param limit The maximum number of slots in use at once
+   * @param shards The number of shards, typically one per thread.  Threads beyond this share shards.
+   * @param strict If true, count every slot on the shared count instead of leasing them to shards.
+   * @param allocator The allocator to use for the shards.  Defaults to malloc.
+   */
+  SlotCounter(UInt32 limit, UInt32 shards, bool strict = false, Allocator &allocator = SystemAllocator::Instance());
+
+  virtual ~SlotCounter();
+
+  /** Take slots.
+   *
+   * @param slots The number of slots to take
+   * @return ESB_SUCCESS if the slots were taken, ESB_OVERFLOW if that would exceed the limit and no slots were taken,
+   * ESB_OUT_OF_MEMORY if the shards could not be allocated.
+   */
+  Error acquire(UInt32 slots);
+
+  /** Return slots taken by acquire().
+   *
+   * @param slots The number of slots to return
+   */
+  void release(UInt32 slots);
+
+  /** Return every shard's unused lease to the shared count.  Safe to call from any thread at any time.
+   */
+  void reconcile();
+
+  /** Get the number of slots in use.  Exact when no other thread is acquiring or releasing.
+   *
+   * @return The number of slots in use
+   */
+  UInt32 inUse() const;
+
+  inline UInt32 limit() const { return _limit; }
+
+  /** Get the number of slots a shard leases at a time.
+   *
+   * @return The lease size, or 0 if slots are counted strictly.
+   */
+  inline UInt32 lease() const { return _lease; }
+
+  inline bool isStrict() const { return 0U == _lease; }
+
+  inline UInt32 shards() const { return _block ? _shardCount : 0U; }
+
+ private:
+  // Written only by the threads that map to the shard, except when reconciling
+  struct Shard {
+    UInt32 _available;
+  };
+
+  inline UInt32 *availableAt(UInt32 index) const {
+    return &((Shard *)(_shards + (index + 1U) * _shardSize))->_available;
+  }
+
+  // The calling thread's shard
+  UInt32 *localAvailable() const;
+
+  bool take(UInt32 slots);
+
+  const UInt32 _limit;
+  const UInt32 _shardCount;
+  const UInt32 _shardSize;
+  const UInt32 _lease;
+  unsigned char *_block;
+  // The shared count lives alone on the first cache line, followed by one cache line per shard
+  unsigned char *_shards;
+  Allocator &_allocator;
+
+  ESB_DEFAULT_FUNCS(SlotCounter);
+};
+
+}  // namespace ESB
+
+#endif
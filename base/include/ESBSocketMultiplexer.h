@@ -12,6 +12,8 @@
 namespace ESB {
 
 class MultiplexedSocket;
+class Timer;
+class EventLoopCounters;
 
 /** A command that delegates i/o readiness events to multiple
  * MultiplexedSockets.  The command can be run in the current thread of
@@ -50,6 +52,34 @@ class SocketMultiplexer : public Command {
    */
   virtual Error removeMultiplexedSocket(MultiplexedSocket *socket) = 0;
 
+  /** Schedule a timer.  Timer::handleExpiration() will be called from the multiplexer's thread once the delay has
+   * passed.  Timers are checked at least once a second, more often when the multiplexer is busy.  Must be called from
+   * the multiplexer's thread.
+   *
+   * @param timer The timer to schedule.  It must not already be scheduled.
+   * @param delayMsec The delay in milliseconds
+   * @return ESB_SUCCESS if successful, ESB_UNDERFLOW if the delay is too short to schedule (act like the timer just
+   * expired), ESB_OVERFLOW if the delay is too long, another error code otherwise.
+   */
+  virtual Error addTimer(Timer *timer, UInt32 delayMsec) = 0;
+
+  /** Reschedule a timer, scheduling it if it is not already scheduled.  Must be called from the multiplexer's thread.
+   *
+   * @param timer The timer to reschedule.
+   * @param delayMsec The new delay in milliseconds
+   * @return ESB_SUCCESS if successful, ESB_UNDERFLOW if the delay is too short to schedule (the timer is removed and
+   * the caller should act like the timer just expired), ESB_OVERFLOW if the delay is too long, another error code
+   * otherwise.
+   */
+  virtual Error updateTimer(Timer *timer, UInt32 delayMsec) = 0;
+
+  /** Cancel a scheduled timer.  Must be called from the multiplexer's thread.
+   *
+   * @param timer The timer to cancel
+   * @return ESB_SUCCESS if successful, ESB_INVALID_ARGUMENT if the timer is not scheduled, another error code otherwise.
+   */
+  virtual Error removeTimer(Timer *timer) = 0;
+
   /** Get the number of sockets this multiplexer is currently handling.
    *
    * @return the number of sockets this multiplexer is currently handling.
@@ -69,6 +99,13 @@ class SocketMultiplexer : public Command {
    */
   virtual bool isRunning() const = 0;
 
+  /** Get the counters that describe this multiplexer's event loop.  Safe to call from any thread while the multiplexer
+   * exists.
+   *
+   * @return The event loop counters, or NULL if this multiplexer does not keep them.
+   */
+  virtual const EventLoopCounters *eventLoopCounters() const;
+
   ESB_DISABLE_AUTO_COPY(SocketMultiplexer);
 };
 
@@ -0,0 +1,124 @@
+#ifndef ESB_SOCKET_SPLICER_H
+#define ESB_SOCKET_SPLICER_H
+
+#ifndef ESB_SOCKET_TYPE_H
+#include <ESBSocketType.h>
+#endif
+
+#ifndef ESB_COMMON_H
+#include <ESBCommon.h>
+#endif
+
+#ifndef ESB_ERROR_H
+#include <ESBError.h>
+#endif
+
+#ifndef ESB_SOCKET_SPLICER_IDLE_PIPES
+#define ESB_SOCKET_SPLICER_IDLE_PIPES 32
+#endif
+
+namespace ESB {
+
+/** Moves bytes from one socket to another through a kernel pipe so they are never copied into user space.
+ *
+ *  Bytes are first spliced from the source socket into the pipe with fill() and then from the pipe into the
+ *  destination socket with drain().  Bytes that could not be drained because the destination socket's send buffer is
+ *  full stay in the pipe until the next drain() call.  The pipe is created lazily on the first fill(), or taken from a
+ *  PipePool if the splicer has one.
+ *
+ *  Only cleartext sockets can be spliced.
+ *
+ *  @ingroup network
+ */
+class SocketSplicer {
+ public:
+  /** Idle pipes kept by one thread so short-lived splicers do not create and close a pipe each.  Not thread-safe.
+   */
+  class PipePool {
+   public:
+    /** Constructor
+     */
+    PipePool();
+
+    /** Destructor.  Closes the idle pipes.
+     */
+    virtual ~PipePool();
+
+    /** Get the number of idle pipes.
+     *
+     * @return The number of idle pipes
+     */
+    inline UInt32 size() const { return _size; }
+
+   private:
+    friend class SocketSplicer;
+
+    bool acquire(int pipe[2]);
+
+    bool release(int pipe[2]);
+
+    UInt32 _size;
+    int _pipes[ESB_SOCKET_SPLICER_IDLE_PIPES][2];
+
+    ESB_DEFAULT_FUNCS(PipePool);
+  };
+
+  /** Constructor
+   *
+   * @param pool If not NULL, the pipe is taken from and returned to this pool, which must outlive the splicer.
+   */
+  SocketSplicer(PipePool *pool = NULL);
+
+  /** Destructor.  Returns an empty pipe to the pool if there is room, otherwise closes the pipe, discarding any bytes
+   * still in it.
+   */
+  virtual ~SocketSplicer();
+
+  /** Determine whether the platform supports splicing.
+   *
+   * @return true if splicing is supported, false otherwise.
+   */
+  static bool Supported();
+
+  /**
+   * Move up to maxBytes from the source socket into the pipe.
+   *
+   * @param source The socket descriptor to read from
+   * @param maxBytes Move no more than this many bytes
+   * @param bytesFilled The number of bytes moved into the pipe
+   * @return ESB_SUCCESS if 1+ bytes were moved, ESB_AGAIN if the source socket has no data or the pipe is full,
+   * ESB_CLOSED if the peer closed the source socket, another error code otherwise.
+   */
+  Error fill(SOCKET source, UInt64 maxBytes, UInt64 *bytesFilled);
+
+  /**
+   * Move as many bytes as possible from the pipe into the destination socket.
+   *
+   * @param destination The socket descriptor to write to
+   * @param bytesDrained The number of bytes moved out of the pipe
+   * @return ESB_SUCCESS if the pipe was emptied, ESB_AGAIN if the destination socket's send buffer filled up before the
+   * pipe was emptied, another error code otherwise.
+   */
+  Error drain(SOCKET destination, UInt64 *bytesDrained);
+
+  /** Get the number of bytes moved into the pipe but not yet moved out of it.
+   *
+   * @return The number of bytes in the pipe
+   */
+  inline UInt64 buffered() const { return _buffered; }
+
+ private:
+  Error open();
+
+  static void Close(int pipe[2]);
+
+  PipePool *_pool;
+  int _pipe[2];
+  UInt64 _buffered;
+
+  ESB_DEFAULT_FUNCS(SocketSplicer);
+};
+
+}  // namespace ESB
+
+#endif
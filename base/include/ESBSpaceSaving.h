@@ -0,0 +1,139 @@
+#ifndef ESB_SPACE_SAVING_H
+#define ESB_SPACE_SAVING_H
+
+#ifndef ESB_CONFIG_H
+#include <ESBConfig.h>
+#endif
+
+#ifndef ESB_SYSTEM_ALLOCATOR_H
+#include <ESBSystemAllocator.h>
+#endif
+
+namespace ESB {
+
+/** Finds the most frequent keys in a stream using a fixed number of counters, no matter how many distinct keys the
+ *  stream has (the Space-Saving algorithm of Metwally, Agrawal and El Abbadi).
+ *
+ *  Every key seen is counted.  When all counters are taken, a new key replaces a key with the smallest count and
+ *  inherits that count as its error.  A key's count never underestimates how often it was seen and count - error never
+ *  overestimates it, so any key seen more than total() / capacity() times is always tracked.
+ *
+ *  Counters are kept in a list of buckets of equal count (the Stream-Summary), so adding 1 to a key and finding a key
+ *  with the smallest count are O(1), and a hash index finds a key's counter in O(1).  All memory is allocated up front.
+ *
+ *  Not thread-safe.
+ *
+ *  @ingroup util
+ */
+class SpaceSaving {
+ public:
+  /** Constructor.
+   *
+   * @param capacity The number of keys to track
+   * @param allocator The allocator to use for the counters.  Defaults to malloc.
+   */
+  SpaceSaving(UInt32 capacity, Allocator &allocator = SystemAllocator::Instance());
+
+  virtual ~SpaceSaving();
+
+  /** Count occurrences of a key.
+   *
+   * @param key The key
+   * @param weight The number of occurrences.  Adding w at once costs O(number of distinct counts passed), at most w.
+   * @param error Extra uncertainty to add to the key's error, for keys counted elsewhere.  Usually 0.
+   * @return count - error for the key afterwards, a lower bound on its occurrences, or 0 if the counters could not be
+   * allocated.
+   */
+  UInt64 add(UInt64 key, UInt64 weight = 1U, UInt64 error = 0U);
+
+  /** Look up a key.
+   *
+   * @param key The key
+   * @param count Will be set to the key's count
+   * @param error Will be set to how much the count may overestimate the key's occurrences
+   * @return ESB_SUCCESS if the key is tracked, ESB_CANNOT_FIND otherwise.
+   */
+  Error find(UInt64 key, UInt64 *count, UInt64 *error) const;
+
+  /** Add every key of another summary to this one.  Counts and errors are summed, so count - error remains a lower
+   *  bound on each key's occurrences in both streams together.
+   *
+   * @param other The other summary
+   */
+  void merge(const SpaceSaving &other);
+
+  /** Forget every key.
+   */
+  void clear();
+
+  /** Get the smallest count, which bounds the occurrences of every key that is not tracked.
+   *
+   * @return The smallest count, or 0 if there are free counters
+   */
+  inline UInt64 minimum() const { return _size < _capacity ? 0U : _buckets[_head].count; }
+
+  inline UInt64 total() const { return _total; }
+
+  inline UInt32 size() const { return _size; }
+
+  /** Get the number of keys that can be tracked.
+   *
+   * @return The capacity or 0 if the counters could not be allocated.
+   */
+  inline UInt32 capacity() const { return _block ? _capacity : 0U; }
+
+  // Counters are numbered 0 to size() - 1 in no particular order
+
+  inline UInt64 key(UInt32 counter) const { return _counters[counter].key; }
+
+  inline UInt64 count(UInt32 counter) const { return _buckets[_counters[counter].bucket].count; }
+
+  inline UInt64 error(UInt32 counter) const { return _counters[counter].error; }
+
+ private:
+  struct Counter {
+    UInt64 key;
+    UInt64 error;
+    UInt32 bucket;
+    UInt32 prev;  // counters in the same bucket
+    UInt32 next;
+  };
+
+  struct Bucket {
+    UInt64 count;
+    UInt32 head;  // first counter
+    UInt32 prev;  // buckets in ascending order of count, or the free list
+    UInt32 next;
+  };
+
+  UInt32 lookup(UInt64 key) const;
+
+  void index(UInt32 counter);
+
+  void unindex(UInt64 key);
+
+  void increment(UInt32 counter, UInt64 weight);
+
+  // Link an unlinked counter into the bucket for count, searching forward from bucket from (or the first bucket)
+  void place(UInt32 counter, UInt64 count, UInt32 from);
+
+  void freeBucket(UInt32 bucket);
+
+  const UInt32 _capacity;
+  const UInt32 _indexMask;
+  UInt32 _size;
+  UInt32 _head;  // the bucket with the smallest count
+  UInt32 _free;  // free buckets
+  UInt64 _total;
+  unsigned char *_block;
+  Counter *_counters;
+  Bucket *_buckets;
+  UInt32 *_index;  // 1 + counter, or 0 if empty
+  Allocator &_allocator;
+
+  ESB_DEFAULT_FUNCS(SpaceSaving);
+};
+
+}  // namespace ESB
+
+#endif
@@ -13,10 +13,40 @@
 #include <ESBSmartPointer.h>
 #endif
 
+#ifndef ESB_SHARED_INT_H
+#include <ESBSharedInt.h>
+#endif
+
+#ifndef ESB_READ_WRITE_LOCK_H
+#include <ESBReadWriteLock.h>
+#endif
+
+#ifndef ESB_DATE_H
+#include <ESBDate.h>
+#endif
+
 #include <openssl/ssl.h>
 
+// OpenSSL 3 deprecates HMAC_CTX, so session ticket MACs are keyed through EVP_MAC there
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#define ESB_TLS_TICKET_EVP_MAC
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#else
+#include <openssl/hmac.h>
+#endif
+
+#define ESB_TLS_TICKET_KEYS 3
+#define ESB_TLS_TICKET_KEY_NAME_SIZE 16
+
 namespace ESB {
 
+#ifdef ESB_TLS_TICKET_EVP_MAC
+typedef EVP_MAC_CTX TLSTicketMacContext;
+#else
+typedef HMAC_CTX TLSTicketMacContext;
+#endif
+
 class X509Certificate {
  public:
   X509Certificate();
@@ -48,6 +78,7 @@ class X509Certificate {
 };
 
 class TLSContextPointer;
+class TLSSessionCache;
 
 class TLSContext : public ReferenceCount {
  public:
@@ -133,13 +164,84 @@ class TLSContext : public ReferenceCount {
 
   inline SSL_CTX *rawContext() { return _context; }
 
+  /**
+   * Get the cache client connections using this context resume sessions from.
+   *
+   * @return The session cache or NULL if sessions are not cached
+   */
+  inline TLSSessionCache *sessionCache() { return _sessionCache; }
+
+  /**
+   * Set the cache client connections using this context resume sessions from.  Must be called before the context is
+   * used.
+   *
+   * @param cache The session cache or NULL to not cache sessions
+   */
+  inline void setSessionCache(TLSSessionCache *cache) { _sessionCache = cache; }
+
+  /**
+   * Issue session tickets encrypted with keys held by this context.  A new key is generated every lifetimeSeconds and
+   * tickets encrypted with the previous ESB_TLS_TICKET_KEYS - 1 keys are still accepted, though clients presenting
+   * them are issued a new ticket.  A key is retired ESB_TLS_TICKET_KEYS * lifetimeSeconds after it was generated even
+   * if no new tickets were issued in the meantime.  Must be called before the context is used.
+   *
+   * @param lifetimeSeconds How long each key is used to encrypt new tickets.
+   * @return ESB_SUCCESS if successful, another error code otherwise.
+   */
+  Error enableTicketKeyRotation(UInt32 lifetimeSeconds);
+
+  /**
+   * Prepare to encrypt or decrypt a session ticket.  Has the semantics of the callback passed to
+   * SSL_CTX_set_tlsext_ticket_key_evp_cb() (SSL_CTX_set_tlsext_ticket_key_cb() before OpenSSL 3).
+   *
+   * @param name The ticket key's name, filled in when encrypting
+   * @param iv The initialization vector, filled in when encrypting
+   * @param cipher The cipher context to initialize with the ticket key
+   * @param hmac The MAC context to initialize with the ticket key
+   * @param encrypt true when issuing a ticket, false when a client presents one
+   * @return 1 if successful, 2 if successful but the client should be issued a new ticket, 0 if the ticket was
+   * encrypted with an unknown or retired key, -1 on error.
+   */
+  int ticketKey(unsigned char *name, unsigned char *iv, EVP_CIPHER_CTX *cipher, TLSTicketMacContext *hmac,
+                bool encrypt);
+
+  /**
+   * Count a completed handshake.
+   *
+   * @param resumed true if a previous session was resumed, false for a full handshake
+   */
+  inline void countHandshake(bool resumed) { resumed ? _resumedHandshakes.inc() : _fullHandshakes.inc(); }
+
+  inline UInt32 fullHandshakes() const { return _fullHandshakes.get(); }
+
+  inline UInt32 resumedHandshakes() const { return _resumedHandshakes.get(); }
+
  private:
   TLSContext(CleanupHandler *handler, SSL_CTX *context, PeerVerification verifyPeerCertificate);
 
+  class TicketKey {
+   public:
+    unsigned char _name[ESB_TLS_TICKET_KEY_NAME_SIZE];
+    unsigned char _cipherKey[32];  // AES-256-CBC
+    unsigned char _hmacKey[32];    // HMAC-SHA256
+    UInt32 _created;               // seconds
+  };
+
+  Error rotateTicketKey(const Date &now);
+
   CleanupHandler *_cleanupHandler;
   SSL_CTX *_context;
   X509Certificate _certificate;
   PeerVerification _verifyPeerCertificate;
+  TLSSessionCache *_sessionCache;
+  SharedInt _fullHandshakes;
+  SharedInt _resumedHandshakes;
+  ReadWriteLock _ticketKeyLock;
+  UInt32 _ticketKeyLifetime;
+  UInt32 _ticketKeyExpires;
+  UInt32 _ticketKeyCount;
+  UInt32 _currentTicketKey;
+  TicketKey _ticketKeys[ESB_TLS_TICKET_KEYS];
 
   ESB_DEFAULT_FUNCS(TLSContext);
 };
@@ -131,6 +131,15 @@ class TLSContextIndex {
   // TODO support removing and updating contexts.  Need to work out what key to use and how to expose clobbered fqdn to
   // SAN associations when maskSanConflicts == true.
 
+ protected:
+  /**
+   * Configure a newly created TLS context before it is indexed or used.
+   *
+   * @param context The new context
+   * @return ESB_SUCCESS if successful, another error code otherwise.  The context will not be indexed on failure.
+   */
+  virtual Error initializeContext(TLSContext &context);
+
  private:
   class TLSContextCleanupHandler : public CleanupHandler {
    public:
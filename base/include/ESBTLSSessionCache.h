@@ -0,0 +1,181 @@
+#ifndef ESB_TLS_SESSION_CACHE_H
+#define ESB_TLS_SESSION_CACHE_H
+
+#ifndef ESB_MAP_H
+#include <ESBMap.h>
+#endif
+
+#ifndef ESB_EMBEDDED_LIST_H
+#include <ESBEmbeddedList.h>
+#endif
+
+#ifndef ESB_MUTEX_H
+#include <ESBMutex.h>
+#endif
+
+#ifndef ESB_SHARED_INT_H
+#include <ESBSharedInt.h>
+#endif
+
+#ifndef ESB_SOCKET_ADDRESS_H
+#include <ESBSocketAddress.h>
+#endif
+
+#ifndef ESB_DATE_H
+#include <ESBDate.h>
+#endif
+
+#include <openssl/ssl.h>
+
+namespace ESB {
+
+/** A cache of client TLS sessions that can be shared by many threads, so new connections to a peer can resume a
+ * previous session instead of doing a full handshake.  Sessions are keyed by the fqdn they were negotiated for and the
+ * peer's address.  The cache is split into shards, each with its own lock, and each shard evicts its least recently
+ * used session when full.
+ *
+ * A session is resumed until it expires, becomes unresumable, or the peer issues a newer one.  RFC 8446 section C.4
+ * suggests TLS 1.3 sessions be used only once, which the TLS library enforces by marking them unresumable after use,
+ * so servers should issue a replacement whenever they resume one.
+ *
+ *  @ingroup network
+ */
+class TLSSessionCache {
+ public:
+  /** Constructor.
+   *
+   * @param maxSessions The maximum number of sessions to cache.  0 disables caching.
+   * @param numShards The number of independently locked shards.  More shards -> less contention.
+   * @param allocator The allocator to use for entries.  Must be thread-safe.
+   */
+  TLSSessionCache(UInt32 maxSessions, UInt32 numShards, Allocator &allocator = SystemAllocator::Instance());
+
+  virtual ~TLSSessionCache();
+
+  /** Find an unexpired, resumable session for a peer.  Hostnames are case-insensitive.
+   *
+   * @param fqdn The fqdn the session was negotiated for
+   * @param peer The peer's address
+   * @param now The current time
+   * @return A session the caller must free with SSL_SESSION_free(), or NULL if there is none.
+   */
+  SSL_SESSION *find(const char *fqdn, const SocketAddress &peer, const Date &now);
+
+  /** Cache a session, replacing any session already cached for the peer.
+   *
+   * @param fqdn The fqdn the session was negotiated for
+   * @param peer The peer's address
+   * @param session The session.  If successful the cache takes ownership of the caller's reference.
+   * @return ESB_SUCCESS if the session was cached, ESB_INVALID_STATE if caching is disabled, another error code
+   * otherwise.
+   */
+  Error insert(const char *fqdn, const SocketAddress &peer, SSL_SESSION *session);
+
+  /** Remove every session.
+   */
+  void clear();
+
+  /** Get the number of cached sessions, including expired sessions that have not been found since they expired.
+   *
+   * @return The number of cached sessions
+   */
+  UInt32 size();
+
+  /** Get the maximum number of cached sessions, a multiple of the number of shards.
+   *
+   * @return The maximum number of cached sessions or 0 if caching is disabled
+   */
+  inline UInt32 maxSessions() const { return _maxSessionsPerShard * _numShards; }
+
+  inline UInt32 hits() const { return _hits.get(); }
+
+  inline UInt32 misses() const { return _misses.get(); }
+
+  inline UInt32 evictions() const { return _evictions.get(); }
+
+  /** Count a completed handshake by a connection that looked for a session to resume in this cache.  A hit does not
+   * guarantee a resumed handshake since the peer can still refuse the session.
+   *
+   * @param resumed true if a previous session was resumed, false for a full handshake
+   */
+  inline void countHandshake(bool resumed) { resumed ? _resumedHandshakes.inc() : _fullHandshakes.inc(); }
+
+  inline UInt32 fullHandshakes() const { return _fullHandshakes.get(); }
+
+  inline UInt32 resumedHandshakes() const { return _resumedHandshakes.get(); }
+
+ private:
+  class Key {
+   public:
+    Key(const char *fqdn, const SocketAddress *peer) : _fqdn(fqdn), _peer(peer) {}
+
+    const char *_fqdn;
+    const SocketAddress *_peer;
+
+    ESB_DISABLE_AUTO_COPY(Key);
+  };
+
+  // Compares Keys case-insensitively
+  class KeyComparator : public Comparator {
+   public:
+    KeyComparator() {}
+
+    virtual ~KeyComparator() {}
+
+    virtual int compare(const void *first, const void *second) const;
+
+    ESB_DEFAULT_FUNCS(KeyComparator);
+  };
+
+  // The fqdn is stored right after the entry
+  class Entry : public EmbeddedListElement {
+   public:
+    Entry(const SocketAddress &peer, SSL_SESSION *session)
+        : EmbeddedListElement(), _peer(peer), _key((const char *)(this + 1), &_peer), _session(session) {}
+
+    virtual ~Entry() {}
+
+    virtual CleanupHandler *cleanupHandler() { return NULL; }
+
+    SocketAddress _peer;
+    Key _key;
+    SSL_SESSION *_session;
+
+    ESB_DEFAULT_FUNCS(Entry);
+  };
+
+  class Shard {
+   public:
+    Shard(Comparator &comparator, Allocator &allocator)
+        : _lock(), _entries(comparator, NullLock::Instance(), allocator), _age() {}
+
+    virtual ~Shard() {}
+
+    Mutex _lock;
+    Map _entries;       // Key -> Entry
+    EmbeddedList _age;  // least recently used first
+
+    ESB_DEFAULT_FUNCS(Shard);
+  };
+
+  Shard &shard(const char *fqdn, const SocketAddress &peer);
+
+  void destroy(Shard &shard, Entry *entry);
+
+  const UInt32 _maxSessionsPerShard;
+  const UInt32 _numShards;
+  Allocator &_allocator;
+  SharedInt _hits;
+  SharedInt _misses;
+  SharedInt _evictions;
+  SharedInt _fullHandshakes;
+  SharedInt _resumedHandshakes;
+  KeyComparator _comparator;
+  Shard *_shards;
+
+  ESB_DEFAULT_FUNCS(TLSSessionCache);
+};
+
+}  // namespace ESB
+
+#endif
@@ -9,6 +9,9 @@
 
 #define ESB_DEFAULT_CA_BUNDLE_PATH "/etc/ssl/certs/ca-certificates.crt"
 
+// The maximum plaintext payload of a single TLS record
+#define ESB_TLS_MAX_RECORD_SIZE 16384
+
 #define ESB_TLS_FLAG_ESTABLISHED (ESB_SOCK_FLAG_MAX << 1)
 #define ESB_TLS_FLAG_DEAD (ESB_SOCK_FLAG_MAX << 2)
 #define ESB_TLS_FLAG_WANT_READ (ESB_SOCK_FLAG_MAX << 3)
@@ -48,14 +51,26 @@ class TLSSocket : public ConnectedSocket {
   virtual bool secure() const;
   virtual SSize receive(char *buffer, Size bufferSize);
   virtual SSize send(const char *buffer, Size bufferSize);
+  virtual SSize send(const struct iovec *segments, int segmentCount);
   virtual bool wantRead();
   virtual bool wantWrite();
+  virtual Error handshake();
+
+  /**
+   * Get the ex_data index under which TLS sockets store themselves in their SSL objects, so OpenSSL callbacks can find
+   * the socket a handshake belongs to.
+   *
+   * @return The ex_data index
+   */
+  static int ExDataIndex();
 
  protected:
   virtual Error startHandshake() = 0;
 
   SSL *_ssl;
   BIO *_bio;
+  // Length of the write that last blocked.  OpenSSL has already encrypted it, so it must be retried with this length.
+  Size _pendingWrite;
 
   ESB_DISABLE_AUTO_COPY(TLSSocket);
 };
@@ -47,20 +47,30 @@ class TimeSeries : public PerformanceCounter {
   inline const char *name() const { return _name; }
 
   /**
-   * Get a list of SimplePerformanceCounters.  There will be one counter in
+   * Get a list of HistogramPerformanceCounters.  There will be one counter in
    * the list per window that actually had observations.
    *
-   * @return The list of SimplePerformanceCounters.
+   * @return The list of HistogramPerformanceCounters.
    */
   inline const EmbeddedList *counters() const { return &_list; }
 
   virtual void log(Logger &logger, Logger::Severity severity) const;
 
+  /**
+   * Summarize the time series.  Queries and latencies are totals since the time series was created and percentiles are
+   * taken from the most recent complete window.
+   *
+   * @param snapshot The summary will be written here
+   */
+  virtual void snapshot(Snapshot *snapshot) const;
+
  private:
   UInt16 _currentWindows;
   const UInt16 _maxWindows;
   const UInt16 _windowSizeSec;
   const char *_name;
+  UInt64 _totalQueries;
+  UInt64 _totalMicroSeconds;
   mutable Mutex _lock;
   EmbeddedList _list;
   Allocator &_allocator;
@@ -34,6 +34,11 @@ class Timer : public EmbeddedListElement {
 
   inline void setContext(void *context) { _context = context; }
 
+  /** Called by a SocketMultiplexer when a timer added with SocketMultiplexer::addTimer() expires.  The timer is no
+   * longer in the multiplexer and may be added again.  Does nothing by default.
+   */
+  virtual void handleExpiration();
+
   virtual CleanupHandler *cleanupHandler() { return NULL; }
 
  private:
@@ -0,0 +1,116 @@
+#ifndef ESB_TOP_N_LIMITER_H
+#define ESB_TOP_N_LIMITER_H
+
+#ifndef ESB_SPACE_SAVING_H
+#include <ESBSpaceSaving.h>
+#endif
+
+#ifndef ESB_MUTEX_H
+#include <ESBMutex.h>
+#endif
+
+#ifndef ESB_DATE_H
+#include <ESBDate.h>
+#endif
+
+#if !defined HAVE_GCC_ATOMIC_INTRINSICS
+#error "TopNLimiter needs __atomic intrinsics or equivalent"
+#endif
+
+namespace ESB {
+
+/** Catches the keys, e.g. client IPv4 addresses, that take a grossly disproportionate share of the traffic without
+ *  tracking every key.  A key is non-conforming once it is known to have taken more than threshold slots in a window.
+ *
+ *  Each thread counts into its own shard, a SpaceSaving summary of the top n keys, behind a lock that only threads
+ *  sharing the shard contend for.  Once per window the first thread to notice the window has ended merges every shard
+ *  into one summary, clears the shards, and hands the keys over the threshold back to every shard.  Those keys stay
+ *  non-conforming for the next window.  Between merges a key is also non-conforming as soon as a single shard has seen
+ *  it exceed the threshold.
+ *
+ *  Only count - error is compared against the threshold, so a key is never wrongly found non-conforming, but a key
+ *  spread across shards may only be caught at the end of the window.  Memory is bounded by n and the number of shards.
+ *  A merge can take O(shards * n * n) in the worst case, so n is best kept in the hundreds.
+ *
+ *  @ingroup util
+ */
+class TopNLimiter {
+ public:
+  /** Constructor.
+   *
+   * @param n The number of keys each summary tracks
+   * @param threshold The number of slots a key may take per window
+   * @param windowMicroSeconds The window
+   * @param shards The number of shards, typically one per thread.  Threads beyond this share shards.
+   * @param allocator The allocator to use for the summaries.  Defaults to malloc.
+   */
+  TopNLimiter(UInt32 n, UInt64 threshold, UInt64 windowMicroSeconds, UInt32 shards,
+              Allocator &allocator = SystemAllocator::Instance());
+
+  virtual ~TopNLimiter();
+
+  /** Count slots taken by a key.
+   *
+   * @param key The key, e.g. an IPv4 address
+   * @param slots The number of slots to take
+   * @param now The current time from MonotonicTimeSource.  Windows end at a fixed time, so a wall clock that is set
+   * back would stretch the current window.
+   * @return ESB_SUCCESS if the key is conforming, ESB_OVERFLOW if it is over the threshold, ESB_OUT_OF_MEMORY if the
+   * summaries could not be allocated.  The slots are counted either way.
+   */
+  Error acquire(UInt64 key, UInt32 slots, const Date &now);
+
+  /** End the current window now: merge and clear the shards and find the keys over the threshold.
+   */
+  void merge();
+
+  inline UInt32 n() const { return _n; }
+
+  inline UInt64 threshold() const { return _threshold; }
+
+  inline UInt32 shards() const { return _shards ? _shardCount : 0U; }
+
+  /** Get the number of keys found over the threshold by the last merge.
+   *
+   * @return The number of keys
+   */
+  inline UInt32 heavyHitters() const { return __atomic_load_n(&_heavyHitters, __ATOMIC_RELAXED); }
+
+ private:
+  struct Shard {
+    Shard(UInt32 n, UInt64 *heavy, Allocator &allocator) : _lock(), _summary(n, allocator), _heavy(heavy) {}
+
+    Mutex _lock;
+    SpaceSaving _summary;
+    // Keys over the threshold in the last window.  0 is an empty slot.
+    UInt64 *_heavy;
+
+    ESB_DEFAULT_FUNCS(Shard);
+  };
+
+  inline Shard *shardAt(UInt32 index) const { return (Shard *)(_shards + index * _shardSize); }
+
+  bool isHeavy(const Shard *shard, UInt64 key) const;
+
+  void mergeShards();
+
+  const UInt32 _n;
+  const UInt64 _threshold;
+  const UInt64 _windowMicroSeconds;
+  const UInt32 _shardCount;
+  const UInt32 _shardSize;
+  const UInt32 _heavyMask;
+  UInt32 _heavyHitters;
+  UInt64 _nextMerge;
+  Mutex _mergeLock;
+  SpaceSaving _merged;
+  unsigned char *_block;
+  unsigned char *_shards;
+  Allocator &_allocator;
+
+  ESB_DEFAULT_FUNCS(TopNLimiter);
+};
+
+}  // namespace ESB
+
+#endif
@@ -0,0 +1,262 @@
+#ifndef ESB_URING_MULTIPLEXER_H
+#define ESB_URING_MULTIPLEXER_H
+
+#ifndef ESB_SOCKET_MULTIPLEXER_H
+#include <ESBSocketMultiplexer.h>
+#endif
+
+#ifndef ESB_SHARED_INT_H
+#include <ESBSharedInt.h>
+#endif
+
+#ifndef ESB_SYSTEM_ALLOCATOR_H
+#include <ESBSystemAllocator.h>
+#endif
+
+#ifndef ESB_EMBEDDED_LIST_H
+#include <ESBEmbeddedList.h>
+#endif
+
+#ifndef ESB_EVENT_LOOP_COUNTERS_H
+#include <ESBEventLoopCounters.h>
+#endif
+
+#ifndef ESB_HIERARCHICAL_TIMING_WHEEL_H
+#include <ESBHierarchicalTimingWheel.h>
+#endif
+
+#ifdef HAVE_IO_URING
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#endif
+
+namespace ESB {
+
+/** A linux io_uring-based implementation of SocketMultiplexer.
+ *
+ * Only readiness notification goes through the ring.  Interests are registered as one-shot IORING_OP_POLL_ADD
+ * requests, and registrations, re-registrations and removals are queued in the submission ring and submitted together
+ * with the wait for completions.  MultiplexedSockets still make their own accept, connect, recv and send calls, one
+ * system call each, so the handler contract and the cost of socket I/O are the same as with the EpollMultiplexer.
+ *
+ * @ingroup thread
+ */
+class UringMultiplexer : public SocketMultiplexer {
+ public:
+  /** Constructor.
+   *
+   * @param maxSockets The maximum number of sockets the multiplexer will
+   *  handle. When this limit is hit, the multiplexer will stop accepting
+   *  new connections from any listening sockets and reject any application
+   *  requests to add new sockets.
+   * @param allocator Internal storage will be allocated using this allocator.
+   */
+  UringMultiplexer(const char *namePrefix, UInt32 idleTimeoutMsec, UInt32 maxSockets,
+                   Allocator &allocator = SystemAllocator::Instance());
+
+  /** Destructor.
+   */
+  virtual ~UringMultiplexer();
+
+  /** Determine whether the running kernel lets this process create an io_uring instance that sizes its completion
+   *  ring on request and never drops completions.
+   *
+   * @return true if io_uring can be used, false otherwise.
+   */
+  static bool Available();
+
+  /** Return an optional handler that can destroy the multiplexer.
+   *
+   * @return A handler to destroy the element or NULL if the element should not
+   * be destroyed.
+   */
+  virtual CleanupHandler *cleanupHandler();
+
+  /** Get the name of the multiplexer.  This name can be used in logging
+   * messages, etc.
+   *
+   * @return The multiplexer's name
+   */
+  virtual const char *name() const;
+
+  /** Add a new multiplexed socket to the socket multiplexer
+   *
+   * @param socket The multiplexed socket
+   * @return ESB_SUCCESS if successful, ESB_OVERFLOW if the maxSockets limit has
+   *  been reached, another error code otherwise.
+   */
+  virtual Error addMultiplexedSocket(MultiplexedSocket *socket);
+
+  /** Keep socket in the multiplexer and socket list, but possibly change the readiness
+   *  events of interest.  This does not modify the _activeSocketCount.
+   *
+   * @param socket The multiplexedSocket
+   */
+  virtual Error updateMultiplexedSocket(MultiplexedSocket *socket);
+
+  /** Remove a multiplexed socket from the socket multiplexer
+   *
+   * @param socket The multiplexed socket to remove
+   */
+  virtual Error removeMultiplexedSocket(MultiplexedSocket *socket);
+
+  virtual Error addTimer(Timer *timer, UInt32 delayMsec);
+
+  virtual Error updateTimer(Timer *timer, UInt32 delayMsec);
+
+  virtual Error removeTimer(Timer *timer);
+
+  /** Run the multiplexer's event loop until shutdown.
+   *
+   * @return If true, caller should destroy the command with the CleanupHandler.
+   */
+  virtual bool run(SharedInt *isRunning);
+
+  /** Get the number of sockets this multiplexer is currently handling.
+   *
+   * @return the number of sockets this multiplexer is currently handling.
+   */
+  virtual int currentSockets() const;
+
+  /** Get the maximum number of sockets this multiplexer can handle.
+   *
+   * @return the maximum number of sockets this multiplexer can handle.
+   */
+  virtual int maximumSockets() const;
+
+  /** Determine whether this multiplexer has been shutdown.
+   *
+   * @return true if the multiplexer should still run, false if it has been
+   *   told to shutdown.
+   */
+  virtual bool isRunning() const;
+
+  virtual const EventLoopCounters *eventLoopCounters() const;
+
+  /** Get the number of submission queue entries handed to the kernel.
+   *
+   * @return The number of submitted requests
+   */
+  inline UInt64 submissions() const { return _submissions; }
+
+  /** Get the number of io_uring_enter system calls made.
+   *
+   * @return The number of io_uring_enter calls
+   */
+  inline UInt64 enters() const { return _enters; }
+
+  /** Get the number of re-registrations skipped because a socket's readiness events of interest had not changed.
+   *
+   * @return The number of avoided interest updates.
+   */
+  inline UInt64 avoidedInterestUpdates() const { return _avoidedInterestUpdates; }
+
+ private:
+  /** Destroy the multiplexer
+   *
+   */
+  void destroy();
+
+  /** Unmap the rings and close the io_uring descriptor
+   */
+  void closeRing();
+
+  /** Periodically check for any idle sockets and close them
+   */
+  void checkIdleSockets();
+
+  /** Call the handlers of any expired timers
+   */
+  void checkTimers();
+
+  /** Get the next free submission queue entry, submitting queued entries to the kernel if the ring is full.
+   *
+   * @return A zeroed submission queue entry or NULL if the ring is still full.
+   */
+  struct io_uring_sqe *acquireSubmission();
+
+  /** Submit all queued submission queue entries and optionally wait for completions.
+   *
+   * @param minCompletions Block until at least this many completions are available.
+   * @return ESB_SUCCESS if successful, another error code otherwise.
+   */
+  Error submit(UInt32 minCompletions);
+
+  /** Copy all available completions into the _events array.
+   *
+   * @return The number of completions that still refer to registered sockets.
+   */
+  UInt32 reap();
+
+  /** Queue a one-shot poll request for the socket's current readiness events of interest.
+   *
+   * @param socket The socket
+   * @return ESB_SUCCESS if successful, another error code otherwise.
+   */
+  Error arm(MultiplexedSocket *socket);
+
+  /** Queue the cancellation of the socket's outstanding poll request, if any.
+   *
+   * @param socket The socket
+   * @return ESB_SUCCESS if successful, another error code otherwise.
+   */
+  Error disarm(MultiplexedSocket *socket);
+
+  struct Registration {
+    MultiplexedSocket *_socket;
+    UInt32 _generation;
+    UInt32 _next;
+    bool _armed;
+  };
+
+  struct Event {
+    MultiplexedSocket *_socket;
+    UInt32 _events;
+  };
+
+  int _ringDescriptor;
+  const UInt32 _idleTimeoutMsec;
+  const UInt32 _maxSockets;
+  UInt32 _sqEntries;
+  UInt32 _cqEntries;
+  UInt32 _sqeTail;
+  UInt32 _freeRegistration;
+  void *_sqRing;
+  UWord _sqRingSize;
+  void *_cqRing;
+  UWord _cqRingSize;
+  struct io_uring_sqe *_sqes;
+  UInt32 *_sqHead;
+  UInt32 *_sqTail;
+  UInt32 *_sqMask;
+  UInt32 *_sqArray;
+  UInt32 *_cqHead;
+  UInt32 *_cqTail;
+  UInt32 *_cqMask;
+  struct io_uring_cqe *_cqes;
+  struct Event *_events;
+  struct Registration *_registrations;
+  bool _timeoutArmed;
+  struct __kernel_timespec _timeout;
+  ESB::SharedInt *_isRunning;
+  Allocator &_allocator;
+  UInt64 _submissions;
+  UInt64 _enters;
+  UInt64 _avoidedInterestUpdates;
+  SharedInt _activeSocketCount;
+  EmbeddedList _activeSockets;
+  EmbeddedList _deadSockets;
+  HierarchicalTimingWheel _timingWheel;
+  HierarchicalTimingWheel _timers;
+  char _namePrefix[ESB_NAME_PREFIX_SIZE];
+  EventLoopCounters _counters;
+
+  ESB_DEFAULT_FUNCS(UringMultiplexer);
+};
+
+}  // namespace ESB
+
+#endif
+
+#endif
@@ -0,0 +1,995 @@
+#ifndef ESB_ASYNC_DNS_CLIENT_H
+#include <ESBAsyncDnsClient.h>
+#endif
+
+#ifndef ESB_SOCKET_H
+#include <ESBSocket.h>
+#endif
+
+#ifndef ESB_TIME_H
+#include <ESBTime.h>
+#endif
+
+#ifndef ESB_LOGGER_H
+#include <ESBLogger.h>
+#endif
+
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+
+#ifdef HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+
+#ifdef HAVE_ARPA_INET_H
+#include <arpa/inet.h>
+#endif
+
+#ifdef HAVE_SYS_TIMERFD_H
+#include <sys/timerfd.h>
+#endif
+
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <openssl/rand.h>
+
+#define DNS_HEADER_SIZE 12
+#define DNS_MAX_NAME_SIZE 255
+#define DNS_MAX_LABEL_SIZE 63
+#define DNS_MAX_POINTERS 16
+#define DNS_MAX_CNAMES 8
+#define DNS_TYPE_A 1
+#define DNS_TYPE_CNAME 5
+#define DNS_TYPE_SOA 6
+#define DNS_CLASS_IN 1
+#define DNS_RCODE_NXDOMAIN 3
+#define DNS_MAX_EVENTS 16
+
+namespace ESB {
+
+static inline UInt16 ReadUInt16(const unsigned char *p) { return ((UInt16)p[0] << 8) | p[1]; }
+
+static inline UInt32 ReadUInt32(const unsigned char *p) {
+  return ((UInt32)p[0] << 24) | ((UInt32)p[1] << 16) | ((UInt32)p[2] << 8) | p[3];
+}
+
+// Decode a possibly compressed name at *offset into a dotted name without the trailing dot.  Advances *offset past
+// the name as it appears in the packet.
+static bool ReadName(const unsigned char *packet, UInt32 size, UInt32 *offset, char *name, UInt32 nameSize) {
+  UInt32 position = *offset;
+  UInt32 length = 0U;
+  UInt32 pointers = 0U;
+  bool jumped = false;
+
+  while (true) {
+    if (position >= size) {
+      return false;
+    }
+
+    const UInt32 label = packet[position];
+
+    if (0 == label) {
+      if (!jumped) {
+        *offset = position + 1;
+      }
+      break;
+    }
+
+    if (0xC0 == (label & 0xC0)) {
+      if (position + 1 >= size || ++pointers > DNS_MAX_POINTERS) {
+        return false;
+      }
+      if (!jumped) {
+        *offset = position + 2;
+        jumped = true;
+      }
+      position = ((label & 0x3F) << 8) | packet[position + 1];
+      continue;
+    }
+
+    if (label > DNS_MAX_LABEL_SIZE || position + 1 + label > size) {
+      return false;
+    }
+
+    if (length + (0 < length ? 1 : 0) + label + 1 > nameSize) {
+      return false;
+    }
+
+    if (0 < length) {
+      name[length++] = '.';
+    }
+    memcpy(name + length, packet + position + 1, label);
+    length += label;
+    position += 1 + label;
+  }
+
+  name[length] = 0;
+  return true;
+}
+
+// Compare a decoded name to a hostname that may have a trailing dot
+static bool SameName(const char *name, const char *hostname) {
+  UInt32 length = strlen(hostname);
+  if (0 < length && '.' == hostname[length - 1]) {
+    --length;
+  }
+  return strlen(name) == length && 0 == strncasecmp(name, hostname, length);
+}
+
+static bool SkipName(const unsigned char *packet, UInt32 size, UInt32 *offset) {
+  char name[DNS_MAX_NAME_SIZE + 1];
+  return ReadName(packet, size, offset, name, sizeof(name));
+}
+
+// Drop a hostname's trailing dot, so it matches the decoded question name of its answer and shares queries and cache
+// entries with the same hostname without the dot.  Returns NULL if the hostname is only a dot or too long.
+static const char *TrimHostname(const char *hostname, char *buffer, UInt32 size) {
+  const UInt32 length = strlen(hostname);
+  if (0 == length || '.' != hostname[length - 1]) {
+    return hostname;
+  }
+  if (1 == length || length > size) {
+    return NULL;
+  }
+  memcpy(buffer, hostname, length - 1);
+  buffer[length - 1] = 0;
+  return buffer;
+}
+
+// Query ids and source ports must not be predictable, so they come from the TLS library's CSPRNG and not Rand.
+static Error SecureRandom(void *buffer, UInt32 size) {
+  if (1 != RAND_bytes((unsigned char *)buffer, size)) {
+    ESB_LOG_ERROR("Cannot generate random bytes");
+    return ESB_OTHER_ERROR;
+  }
+  return ESB_SUCCESS;
+}
+
+AsyncDnsClient::AsyncDnsClient(const char *namePrefix, SocketMultiplexer &multiplexer, DnsCache &cache,
+                               const SocketAddress &resolver, UInt32 timeoutMsec, UInt32 attempts,
+                               Allocator &allocator)
+    : DnsClient(),
+      MultiplexedSocket(),
+      _multiplexer(multiplexer),
+      _cache(cache),
+      _resolver(resolver),
+      _timeoutMsec(MAX(timeoutMsec, 1U)),
+      _attempts(MAX(attempts, 1U)),
+      _allocator(allocator),
+      _epollDescriptor(INVALID_SOCKET),
+      _dead(false),
+      _comparator(),
+      _queries(_comparator),
+      _deadlines(),
+      _retryTimer(*this) {
+  snprintf(_name, sizeof(_name), "%s%s", namePrefix, ESB_DNS_SUFFIX);
+  _name[sizeof(_name) - 1] = 0;
+}
+
+AsyncDnsClient::~AsyncDnsClient() {
+  for (Query *query = (Query *)_deadlines.removeFirst(); query; query = (Query *)_deadlines.removeFirst()) {
+    destroy(query);
+  }
+  _queries.clear();
+  close();
+}
+
+Error AsyncDnsClient::SystemResolver(SocketAddress &address, const char *path) {
+  if (!path) {
+    return ESB_NULL_POINTER;
+  }
+
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    Error error = LastError();
+    ESB_LOG_WARNING_ERRNO(error, "Cannot open %s", path);
+    return error;
+  }
+
+  char line[256];
+  char server[64];
+  Error error = ESB_CANNOT_FIND;
+
+  while (fgets(line, sizeof(line), file)) {
+    if (1 != sscanf(line, " nameserver %63s", server)) {
+      continue;
+    }
+    struct in_addr ip;
+    if (1 != inet_pton(AF_INET, server, &ip)) {
+      continue;  // IPv6 nameservers are not supported
+    }
+    SetAddress(address, ip.s_addr, 53, false);
+    address.setType(SocketAddress::UDP);
+    error = ESB_SUCCESS;
+    break;
+  }
+
+  fclose(file);
+  return error;
+}
+
+Error AsyncDnsClient::resolve(SocketAddress &address, const char *hostname, UInt16 port, bool isSecure) {
+  if (!hostname) {
+    return ESB_NULL_POINTER;
+  }
+
+  char trimmed[DNS_MAX_NAME_SIZE + 1];
+  hostname = TrimHostname(hostname, trimmed, sizeof(trimmed));
+  if (!hostname) {
+    return ESB_INVALID_ARGUMENT;
+  }
+
+  struct in_addr ip;
+  if (1 == inet_pton(AF_INET, hostname, &ip)) {
+    SetAddress(address, ip.s_addr, port, isSecure);
+    return ESB_SUCCESS;
+  }
+
+  Error result = ESB_SUCCESS;
+  UInt32 cached = 0U;
+  if (_cache.find(hostname, Time::Instance().now(), &result, &cached)) {
+    if (ESB_SUCCESS == result) {
+      SetAddress(address, cached, port, isSecure);
+    }
+    return result;
+  }
+
+  if (!_queries.find(hostname)) {
+    Query *query = NULL;
+    Error error = start(hostname, &query);
+    if (ESB_SUCCESS != error) {
+      return error;
+    }
+  }
+
+  return ESB_AGAIN;
+}
+
+Error AsyncDnsClient::resolve(SocketAddress &address, const char *hostname, UInt16 port, bool isSecure,
+                              Callback &callback) {
+  if (!hostname) {
+    return ESB_NULL_POINTER;
+  }
+
+  if (callback.lookup()) {
+    return ESB_IN_USE;
+  }
+
+  char trimmed[DNS_MAX_NAME_SIZE + 1];
+  hostname = TrimHostname(hostname, trimmed, sizeof(trimmed));
+  if (!hostname) {
+    return ESB_INVALID_ARGUMENT;
+  }
+
+  struct in_addr ip;
+  if (1 == inet_pton(AF_INET, hostname, &ip)) {
+    SetAddress(address, ip.s_addr, port, isSecure);
+    return ESB_SUCCESS;
+  }
+
+  Error result = ESB_SUCCESS;
+  UInt32 cached = 0U;
+  if (_cache.find(hostname, Time::Instance().now(), &result, &cached)) {
+    if (ESB_SUCCESS == result) {
+      SetAddress(address, cached, port, isSecure);
+    }
+    return result;
+  }
+
+  Query *query = (Query *)_queries.find(hostname);
+  if (!query) {
+    Error error = start(hostname, &query);
+    if (ESB_SUCCESS != error) {
+      return error;
+    }
+  }
+
+  callback.setTarget(port, isSecure);
+  callback.setLookup(query);
+  query->_callbacks.addLast(&callback);
+  return ESB_INPROGRESS;
+}
+
+void AsyncDnsClient::cancel(Callback &callback) {
+  Query *query = (Query *)callback.lookup();
+  if (!query) {
+    return;
+  }
+
+  // The query keeps running so its answer is cached for later lookups.
+  query->_callbacks.remove(&callback);
+  callback.setLookup(NULL);
+}
+
+int AsyncDnsClient::FormatQuery(const char *hostname, UInt16 id, unsigned char *packet, UInt32 size) {
+  if (!hostname || !packet || DNS_HEADER_SIZE > size) {
+    return -1;
+  }
+
+  memset(packet, 0, DNS_HEADER_SIZE);
+  packet[0] = id >> 8;
+  packet[1] = id & 0xFF;
+  packet[2] = 0x01;  // recursion desired
+  packet[5] = 1;     // one question
+
+  UInt32 position = DNS_HEADER_SIZE;
+  const char *label = hostname;
+
+  while (*label) {
+    const char *dot = strchr(label, '.');
+    const UInt32 length = dot ? dot - label : strlen(label);
+
+    if (0 == length || DNS_MAX_LABEL_SIZE < length) {
+      return -1;
+    }
+    if (position + 1 + length + 1 - DNS_HEADER_SIZE > DNS_MAX_NAME_SIZE || position + 1 + length + 1 + 4 > size) {
+      return -1;
+    }
+
+    packet[position++] = length;
+    memcpy(packet + position, label, length);
+    position += length;
+
+    if (!dot) {
+      break;
+    }
+    label = dot + 1;
+  }
+
+  if (DNS_HEADER_SIZE == position || position + 5 > size) {
+    return -1;
+  }
+
+  packet[position++] = 0;
+  packet[position++] = 0;
+  packet[position++] = DNS_TYPE_A;
+  packet[position++] = 0;
+  packet[position++] = DNS_CLASS_IN;
+
+  return position;
+}
+
+Error AsyncDnsClient::ParseResponse(const unsigned char *packet, UInt32 size, UInt16 id, const char *hostname,
+                                    UInt32 *address, UInt32 *ttl) {
+  if (!packet || !hostname || !address || !ttl) {
+    return ESB_NULL_POINTER;
+  }
+
+  if (DNS_HEADER_SIZE > size || ReadUInt16(packet) != id || !(packet[2] & 0x80) || 1 != ReadUInt16(packet + 4)) {
+    return ESB_CANNOT_PARSE;
+  }
+
+  const bool truncated = packet[2] & 0x02;
+  const UInt32 rcode = packet[3] & 0x0F;
+  const UInt32 answers = ReadUInt16(packet + 6);
+  const UInt32 authorities = ReadUInt16(packet + 8);
+
+  char name[DNS_MAX_NAME_SIZE + 1];
+  UInt32 offset = DNS_HEADER_SIZE;
+
+  if (!ReadName(packet, size, &offset, name, sizeof(name)) || offset + 4 > size || !SameName(name, hostname) ||
+      DNS_TYPE_A != ReadUInt16(packet + offset) || DNS_CLASS_IN != ReadUInt16(packet + offset + 2)) {
+    return ESB_CANNOT_PARSE;
+  }
+  offset += 4;
+
+  if (0 != rcode && DNS_RCODE_NXDOMAIN != rcode) {
+    return ESB_OTHER_ERROR;  // e.g., SERVFAIL or REFUSED
+  }
+
+  const UInt32 answerOffset = offset;
+  char target[DNS_MAX_NAME_SIZE + 1];
+  strcpy(target, name);
+  *ttl = UINT32_MAX;
+
+  // Follow the CNAME chain from the question to an A record.  The TTL of the answer is the shortest in the chain.
+  for (UInt32 hops = 0; DNS_RCODE_NXDOMAIN != rcode && hops <= DNS_MAX_CNAMES; ++hops) {
+    bool followed = false;
+    offset = answerOffset;
+
+    for (UInt32 i = 0; i < answers; ++i) {
+      if (!ReadName(packet, size, &offset, name, sizeof(name)) || offset + 10 > size) {
+        return ESB_CANNOT_PARSE;
+      }
+
+      const UInt32 type = ReadUInt16(packet + offset);
+      const UInt32 klass = ReadUInt16(packet + offset + 2);
+      const UInt32 recordTtl = ReadUInt32(packet + offset + 4);
+      const UInt32 length = ReadUInt16(packet + offset + 8);
+      offset += 10;
+
+      if (offset + length > size) {
+        return ESB_CANNOT_PARSE;
+      }
+
+      if (DNS_CLASS_IN == klass && 0 == strcasecmp(name, target)) {
+        if (DNS_TYPE_A == type && 4 == length) {
+          memcpy(address, packet + offset, 4);
+          *ttl = MIN(*ttl, recordTtl);
+          return ESB_SUCCESS;
+        }
+        if (DNS_TYPE_CNAME == type) {
+          UInt32 cnameOffset = offset;
+          if (!ReadName(packet, size, &cnameOffset, target, sizeof(target))) {
+            return ESB_CANNOT_PARSE;
+          }
+          *ttl = MIN(*ttl, recordTtl);
+          followed = true;
+          break;
+        }
+      }
+
+      offset += length;
+    }
+
+    if (!followed) {
+      break;
+    }
+  }
+
+  if (truncated) {
+    // There is no TCP fallback, so a truncated answer without an A record is a failure that should not be cached.
+    return ESB_OTHER_ERROR;
+  }
+
+  // The hostname does not exist or has no A records.  Per RFC 2308 the negative TTL comes from the SOA record in the
+  // authority section and failures without one are not cached.
+  offset = answerOffset;
+  for (UInt32 i = 0; i < answers; ++i) {
+    if (!SkipName(packet, size, &offset) || offset + 10 > size) {
+      return ESB_CANNOT_PARSE;
+    }
+    offset += 10 + ReadUInt16(packet + offset + 8);
+  }
+
+  *ttl = 0U;
+  for (UInt32 i = 0; i < authorities; ++i) {
+    if (!SkipName(packet, size, &offset) || offset + 10 > size) {
+      return ESB_CANNOT_PARSE;
+    }
+
+    const UInt32 type = ReadUInt16(packet + offset);
+    const UInt32 recordTtl = ReadUInt32(packet + offset + 4);
+    const UInt32 length = ReadUInt16(packet + offset + 8);
+    offset += 10;
+
+    if (offset + length > size) {
+      return ESB_CANNOT_PARSE;
+    }
+
+    if (DNS_TYPE_SOA == type && 22 <= length) {
+      // The SOA MINIMUM field is the last 4 bytes of its rdata
+      *ttl = MIN(recordTtl, ReadUInt32(packet + offset + length - 4));
+      break;
+    }
+
+    offset += length;
+  }
+
+  return ESB_CANNOT_FIND;
+}
+
+Error AsyncDnsClient::open() {
+  if (INVALID_SOCKET != _epollDescriptor) {
+    return ESB_SUCCESS;
+  }
+
+  _epollDescriptor = epoll_create1(EPOLL_CLOEXEC);
+  if (INVALID_SOCKET == _epollDescriptor) {
+    Error error = LastError();
+    ESB_LOG_ERROR_ERRNO(error, "[%s] cannot create dns epoll descriptor", _name);
+    return error;
+  }
+
+  Error error = _retryTimer.open();
+  if (ESB_SUCCESS != error) {
+    close();
+    return error;
+  }
+
+  _dead = false;
+
+  error = _multiplexer.addMultiplexedSocket(this);
+  if (ESB_SUCCESS != error) {
+    ESB_LOG_ERROR_ERRNO(error, "[%s] cannot add dns socket to multiplexer", _name);
+    close();
+    return error;
+  }
+
+  error = _multiplexer.addMultiplexedSocket(&_retryTimer);
+  if (ESB_SUCCESS != error) {
+    ESB_LOG_ERROR_ERRNO(error, "[%s] cannot add dns timer to multiplexer", _name);
+    _multiplexer.removeMultiplexedSocket(this);
+    close();
+    return error;
+  }
+
+  ESB_LOG_DEBUG("[%s] opened dns socket", _name);
+  return ESB_SUCCESS;
+}
+
+void AsyncDnsClient::close() {
+  if (INVALID_SOCKET != _epollDescriptor) {
+    ::close(_epollDescriptor);
+    _epollDescriptor = INVALID_SOCKET;
+  }
+  _retryTimer.close();
+}
+
+Error AsyncDnsClient::start(const char *hostname, Query **query) {
+  const UInt32 length = strlen(hostname);
+  if (0 == length || DNS_MAX_NAME_SIZE < length) {
+    return ESB_INVALID_ARGUMENT;
+  }
+
+  Error error = open();
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  UInt16 id = 0;
+  error = SecureRandom(&id, sizeof(id));
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  unsigned char *block = NULL;
+  error = _allocator.allocate(sizeof(Query) + length + 1, (void **)&block);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  Query *q = new (block) Query(id);
+  memcpy(block + sizeof(Query), hostname, length + 1);
+
+  error = openSocket(q);
+  if (ESB_SUCCESS != error) {
+    destroy(q);
+    return error;
+  }
+
+  error = _queries.insert(q->hostname(), q);
+  if (ESB_SUCCESS != error) {
+    destroy(q);
+    return error;
+  }
+
+  error = send(q);
+  if (ESB_SUCCESS != error) {
+    _queries.remove(q->hostname());
+    destroy(q);
+    return error;
+  }
+
+  *query = q;
+  return ESB_SUCCESS;
+}
+
+Error AsyncDnsClient::openSocket(Query *query) {
+  SOCKET fd = socket(AF_INET, SOCK_DGRAM, 0);
+  if (INVALID_SOCKET == fd) {
+    Error error = LastError();
+    ESB_LOG_ERROR_ERRNO(error, "[%s] cannot create dns socket", _name);
+    return error;
+  }
+
+  Error error = Socket::SetBlocking(fd, false);
+  if (ESB_SUCCESS != error) {
+    ESB_LOG_ERROR_ERRNO(error, "[%s] cannot make dns socket non-blocking", _name);
+    Socket::Close(fd);
+    return error;
+  }
+
+  // If every random port is taken, connect() binds one the kernel chooses instead
+  SocketAddress::Address local;
+  memset(&local, 0, sizeof(local));
+  local.sin_family = AF_INET;
+  for (UInt32 i = 0; i < ESB_DNS_BIND_ATTEMPTS; ++i) {
+    UInt16 port = 0;
+    if (ESB_SUCCESS != SecureRandom(&port, sizeof(port))) {
+      break;
+    }
+    local.sin_port = htons(ESB_DNS_MIN_SOURCE_PORT + port % (65536U - ESB_DNS_MIN_SOURCE_PORT));
+    if (0 == bind(fd, (sockaddr *)&local, sizeof(local))) {
+      break;
+    }
+    error = LastError();
+    if (EADDRINUSE != error) {
+      ESB_LOG_DEBUG_ERRNO(error, "[%s] cannot bind dns socket to a random port", _name);
+      break;
+    }
+  }
+
+  if (SOCKET_ERROR == ::connect(fd, (sockaddr *)_resolver.primitiveAddress(), sizeof(SocketAddress::Address))) {
+    error = LastError();
+    ESB_LOG_ERROR_ERRNO(error, "[%s] cannot connect dns socket", _name);
+    Socket::Close(fd);
+    return error;
+  }
+
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = EPOLLIN;
+  event.data.ptr = query;
+  if (0 != epoll_ctl(_epollDescriptor, EPOLL_CTL_ADD, fd, &event)) {
+    error = LastError();
+    ESB_LOG_ERROR_ERRNO(error, "[%s] cannot watch dns socket", _name);
+    Socket::Close(fd);
+    return error;
+  }
+
+  query->_socket = fd;
+  return ESB_SUCCESS;
+}
+
+Error AsyncDnsClient::send(Query *query) {
+  unsigned char packet[ESB_DNS_MAX_UDP_SIZE];
+  const int size = FormatQuery(query->hostname(), query->_id, packet, sizeof(packet));
+  if (0 > size) {
+    ESB_LOG_DEBUG("[%s] invalid hostname %s", _name, query->hostname());
+    return ESB_INVALID_ARGUMENT;
+  }
+
+  if (0 < query->_attempts) {
+    _deadlines.remove(query);
+  }
+
+  // All queries share one timeout so the list stays ordered by deadline.
+  ++query->_attempts;
+  query->_deadline = Time::Instance().now() + Date(_timeoutMsec / 1000, _timeoutMsec % 1000 * 1000);
+  _deadlines.addLast(query);
+
+  if (0 > ::send(query->_socket, packet, size, 0)) {
+    // Let the retry timer send it again
+    ESB_LOG_DEBUG_ERRNO(LastError(), "[%s] cannot send query for %s", _name, query->hostname());
+  } else {
+    ESB_LOG_DEBUG("[%s] sent query %u for %s (attempt %u)", _name, query->_id, query->hostname(), query->_attempts);
+  }
+
+  if (_deadlines.first() == query) {
+    scheduleRetry();
+  }
+
+  return ESB_SUCCESS;
+}
+
+void AsyncDnsClient::retry() {
+  const Date now = Time::Instance().now();
+
+  while (!_deadlines.isEmpty()) {
+    Query *query = (Query *)_deadlines.first();
+    if (query->_deadline > now) {
+      break;
+    }
+
+    if (query->_attempts >= _attempts) {
+      ESB_LOG_INFO("[%s] query for %s timed out", _name, query->hostname());
+      complete(query, ESB_TIMEOUT, 0U);
+    } else {
+      send(query);
+    }
+  }
+
+  scheduleRetry();
+}
+
+void AsyncDnsClient::scheduleRetry() {
+  if (_deadlines.isEmpty()) {
+    _retryTimer.arm(0U);
+    return;
+  }
+
+  const Date now = Time::Instance().now();
+  const Date &deadline = ((Query *)_deadlines.first())->_deadline;
+
+  if (deadline <= now) {
+    _retryTimer.arm(1U);
+    return;
+  }
+
+  const Date delay = deadline - now;
+  _retryTimer.arm(MAX(delay.seconds() * 1000U + delay.microSeconds() / 1000U, 1U));
+}
+
+void AsyncDnsClient::complete(Query *query, Error result, UInt32 address) {
+  _queries.remove(query->hostname());
+  const bool first = _deadlines.first() == query;
+  _deadlines.remove(query);
+  if (first) {
+    scheduleRetry();
+  }
+
+  // Callbacks may start or cancel lookups, including for this hostname.
+  for (Callback *callback = (Callback *)query->_callbacks.removeFirst(); callback;
+       callback = (Callback *)query->_callbacks.removeFirst()) {
+    callback->setLookup(NULL);
+    SocketAddress resolved;
+    if (ESB_SUCCESS == result) {
+      SetAddress(resolved, address, callback->port(), callback->isSecure());
+    }
+    callback->resolved(result, resolved);
+  }
+
+  destroy(query);
+}
+
+void AsyncDnsClient::destroy(Query *query) {
+  for (Callback *callback = (Callback *)query->_callbacks.removeFirst(); callback;
+       callback = (Callback *)query->_callbacks.removeFirst()) {
+    callback->setLookup(NULL);
+  }
+  if (INVALID_SOCKET != query->_socket) {
+    // Closing the socket also stops the epoll descriptor from watching it
+    Socket::Close(query->_socket);
+    query->_socket = INVALID_SOCKET;
+  }
+  query->~Query();
+  _allocator.deallocate(query);
+}
+
+void AsyncDnsClient::SetAddress(SocketAddress &address, UInt32 ip, UInt16 port, bool isSecure) {
+  memset(address.primitiveAddress(), 0, sizeof(SocketAddress::Address));
+  address.primitiveAddress()->sin_family = AF_INET;
+  address.primitiveAddress()->sin_addr.s_addr = ip;
+  address.primitiveAddress()->sin_port = htons(port);
+  address.setType(isSecure ? SocketAddress::TLS : SocketAddress::TCP);
+}
+
+bool AsyncDnsClient::permanent() { return true; }
+
+bool AsyncDnsClient::wantAccept() { return false; }
+
+bool AsyncDnsClient::wantConnect() { return false; }
+
+bool AsyncDnsClient::wantRead() { return true; }
+
+bool AsyncDnsClient::wantWrite() { return false; }
+
+Error AsyncDnsClient::handleAccept() {
+  ESB_LOG_ERROR("[%s] dns sockets cannot handle accept", _name);
+  return ESB_INVALID_STATE;  // remove from multiplexer
+}
+
+Error AsyncDnsClient::handleConnect() {
+  ESB_LOG_ERROR("[%s] dns sockets cannot handle connect", _name);
+  return ESB_INVALID_STATE;  // remove from multiplexer
+}
+
+Error AsyncDnsClient::handleReadable() {
+  struct epoll_event events[DNS_MAX_EVENTS];
+  unsigned char packet[ESB_DNS_MAX_UDP_SIZE];
+  char hostname[DNS_MAX_NAME_SIZE + 1];
+
+  const int numEvents = epoll_wait(_epollDescriptor, events, DNS_MAX_EVENTS, 0);
+  if (0 > numEvents) {
+    const Error error = LastError();
+    if (ESB_INTR != error) {
+      ESB_LOG_WARNING_ERRNO(error, "[%s] cannot wait for dns responses", _name);
+    }
+    return ESB_AGAIN;  // keep in multiplexer
+  }
+
+  // Only completing a query destroys it, and each query appears at most once in the events
+  for (int i = 0; i < numEvents && !_dead; ++i) {
+    Query *query = (Query *)events[i].data.ptr;
+
+    while (true) {
+      const SSize size = recv(query->_socket, packet, sizeof(packet), 0);
+
+      if (0 > size) {
+        const Error error = LastError();
+        if (ESB_AGAIN != error) {
+          // e.g., the resolver is not listening.  The error is consumed by this recv, so stop here instead of
+          // spinning and let the query time out.
+          ESB_LOG_WARNING_ERRNO(error, "[%s] cannot receive dns response", _name);
+        }
+        break;
+      }
+
+      UInt32 offset = DNS_HEADER_SIZE;
+      if (DNS_HEADER_SIZE > size || !ReadName(packet, size, &offset, hostname, sizeof(hostname))) {
+        ESB_LOG_DEBUG("[%s] ignoring malformed dns response", _name);
+        continue;
+      }
+
+      if (query->_id != ReadUInt16(packet) || !SameName(hostname, query->hostname())) {
+        ESB_LOG_DEBUG("[%s] ignoring unexpected dns response for %s", _name, hostname);
+        continue;
+      }
+
+      UInt32 address = 0U;
+      UInt32 ttl = 0U;
+      const Error result = ParseResponse(packet, size, query->_id, query->hostname(), &address, &ttl);
+      const Date now = Time::Instance().now();
+
+      switch (result) {
+        case ESB_CANNOT_PARSE:
+          ESB_LOG_DEBUG("[%s] ignoring malformed dns response for %s", _name, query->hostname());
+          continue;
+        case ESB_SUCCESS:
+          _cache.insert(query->hostname(), address, ttl, now);
+          break;
+        case ESB_CANNOT_FIND:
+          _cache.insertNegative(query->hostname(), result, ttl, now);
+          break;
+        default:
+          break;
+      }
+
+      if (ESB_DEBUG_LOGGABLE) {
+        char presentation[ESB_IPV6_PRESENTATION_SIZE];
+        inet_ntop(AF_INET, &address, presentation, sizeof(presentation));
+        ESB_LOG_DEBUG("[%s] resolved %s to %s ttl %u (%d)", _name, query->hostname(),
+                      ESB_SUCCESS == result ? presentation : "nothing", ttl, result);
+      }
+
+      complete(query, result, address);
+      break;
+    }
+  }
+
+  return ESB_AGAIN;  // keep in multiplexer
+}
+
+Error AsyncDnsClient::handleWritable() {
+  ESB_LOG_ERROR("[%s] dns sockets cannot handle writable", _name);
+  return ESB_INVALID_STATE;  // remove from multiplexer
+}
+
+void AsyncDnsClient::handleError(Error error) {
+  ESB_LOG_WARNING_ERRNO(error, "[%s] dns socket had error: %d", _name, error);
+}
+
+void AsyncDnsClient::handleRemoteClose() { ESB_LOG_ERROR("[%s] dns sockets cannot handle remote close", _name); }
+
+void AsyncDnsClient::handleIdle() { ESB_LOG_ERROR("[%s] dns sockets cannot handle idle event", _name); }
+
+void AsyncDnsClient::handleRemove() {
+  ESB_LOG_NOTICE("[%s] dns socket removed from multiplexer", _name);
+
+  // The multiplexer is shutting down, so waiters are dropped without being called back.
+  for (Query *query = (Query *)_deadlines.removeFirst(); query; query = (Query *)_deadlines.removeFirst()) {
+    destroy(query);
+  }
+  _queries.clear();
+
+  if (INVALID_SOCKET != _epollDescriptor) {
+    ::close(_epollDescriptor);
+    _epollDescriptor = INVALID_SOCKET;
+  }
+}
+
+SOCKET AsyncDnsClient::socketDescriptor() const { return _epollDescriptor; }
+
+CleanupHandler *AsyncDnsClient::cleanupHandler() { return NULL; }
+
+const void *AsyncDnsClient::key() const { return _name; }
+
+const char *AsyncDnsClient::name() const { return _name; }
+
+void AsyncDnsClient::markDead() { _dead = true; }
+
+bool AsyncDnsClient::dead() const { return _dead; }
+
+AsyncDnsClient::RetryTimer::RetryTimer(AsyncDnsClient &client)
+    : MultiplexedSocket(), _client(client), _timerFd(INVALID_SOCKET), _dead(false) {}
+
+AsyncDnsClient::RetryTimer::~RetryTimer() { close(); }
+
+Error AsyncDnsClient::RetryTimer::open() {
+  if (INVALID_SOCKET != _timerFd) {
+    return ESB_SUCCESS;
+  }
+
+#ifdef HAVE_TIMERFD_CREATE
+  _timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+#else
+  // to implement on plaforms without timerfd, use a kqueue timer or the multiplexer's idle timer
+#error "timerfd_create() or equivalent is required"
+#endif
+
+  if (0 > _timerFd) {
+    Error error = LastError();
+    ESB_LOG_ERROR_ERRNO(error, "[%s] cannot create timer fd", _client.name());
+    _timerFd = INVALID_SOCKET;
+    return error;
+  }
+
+  _dead = false;
+  return ESB_SUCCESS;
+}
+
+void AsyncDnsClient::RetryTimer::close() {
+  if (INVALID_SOCKET != _timerFd) {
+    ::close(_timerFd);
+    _timerFd = INVALID_SOCKET;
+  }
+}
+
+Error AsyncDnsClient::RetryTimer::arm(UInt32 delayMsec) {
+  if (INVALID_SOCKET == _timerFd) {
+    return ESB_INVALID_STATE;
+  }
+
+  struct itimerspec spec;
+  memset(&spec, 0, sizeof(spec));
+  spec.it_value.tv_sec = delayMsec / 1000;
+  spec.it_value.tv_nsec = delayMsec % 1000 * 1000000L;
+
+  if (0 != timerfd_settime(_timerFd, 0, &spec, NULL)) {
+    Error error = LastError();
+    ESB_LOG_ERROR_ERRNO(error, "[%s] cannot arm timer fd", _client.name());
+    return error;
+  }
+
+  return ESB_SUCCESS;
+}
+
+bool AsyncDnsClient::RetryTimer::permanent() { return true; }
+
+bool AsyncDnsClient::RetryTimer::wantAccept() { return false; }
+
+bool AsyncDnsClient::RetryTimer::wantConnect() { return false; }
+
+bool AsyncDnsClient::RetryTimer::wantRead() { return true; }
+
+bool AsyncDnsClient::RetryTimer::wantWrite() { return false; }
+
+Error AsyncDnsClient::RetryTimer::handleAccept() { return ESB_INVALID_STATE; }
+
+Error AsyncDnsClient::RetryTimer::handleConnect() { return ESB_INVALID_STATE; }
+
+Error AsyncDnsClient::RetryTimer::handleReadable() {
+  UInt64 expirations = 0;
+  if (0 > ::read(_timerFd, &expirations, sizeof(expirations))) {
+    Error error = LastError();
+    if (ESB_AGAIN != error) {
+      ESB_LOG_ERROR_ERRNO(error, "[%s] cannot read timer fd", _client.name());
+    }
+    return ESB_AGAIN;  // keep in multiplexer
+  }
+
+  _client.retry();
+  return ESB_AGAIN;  // keep in multiplexer
+}
+
+Error AsyncDnsClient::RetryTimer::handleWritable() { return ESB_INVALID_STATE; }
+
+void AsyncDnsClient::RetryTimer::handleError(Error error) {
+  ESB_LOG_WARNING_ERRNO(error, "[%s] dns timer had error: %d", _client.name(), error);
+}
+
+void AsyncDnsClient::RetryTimer::handleRemoteClose() {}
+
+void AsyncDnsClient::RetryTimer::handleIdle() {}
+
+void AsyncDnsClient::RetryTimer::handleRemove() { close(); }
+
+SOCKET AsyncDnsClient::RetryTimer::socketDescriptor() const { return _timerFd; }
+
+CleanupHandler *AsyncDnsClient::RetryTimer::cleanupHandler() { return NULL; }
+
+const void *AsyncDnsClient::RetryTimer::key() const { return this; }
+
+const char *AsyncDnsClient::RetryTimer::name() const { return _client.name(); }
+
+void AsyncDnsClient::RetryTimer::markDead() { _dead = true; }
+
+bool AsyncDnsClient::RetryTimer::dead() const { return _dead; }
+
+}  // namespace ESB
@@ -0,0 +1,455 @@
+#ifndef ESB_ASYNC_FILE_LOGGER_H
+#include <ESBAsyncFileLogger.h>
+#endif
+
+#ifndef ESB_WRITE_SCOPE_LOCK_H
+#include <ESBWriteScopeLock.h>
+#endif
+
+#if defined HAVE_STDARG_H
+#include <stdarg.h>
+#else
+#error "Need stdarg.h or equivalent"
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#else
+#error "Need string.h or equivalent"
+#endif
+
+#ifndef ESB_ASYNC_LOGGER_FLUSH_ATTEMPTS
+#define ESB_ASYNC_LOGGER_FLUSH_ATTEMPTS 1000
+#endif
+
+namespace ESB {
+
+static SharedInt NextLoggerId;
+
+#ifdef HAVE_THREAD_LOCAL_STORAGE
+// The ring of the logger that the calling thread last logged to
+static __thread UInt32 CurrentLoggerId = 0;
+static __thread void *CurrentRing = NULL;
+#else
+#error "__thread or equivalent is required"
+#endif
+
+// Format a message, truncating it to a whole line if it is too long
+static int FormatMessage(char *message, UInt32 size, const char *format, va_list args) {
+#ifdef HAVE_VSNPRINTF
+  int length = vsnprintf(message, size, format, args);
+#else
+#error "vsnprintf or equivalent is required"
+#endif
+
+  if (length >= (int)size) {
+    length = size - 1;
+    message[length - 1] = '\n';
+  }
+
+  return length;
+}
+
+static UInt32 RingSize(UInt32 ringSize) {
+  UInt32 size = 2 * ESB_ASYNC_LOGGER_MAX_MESSAGE;
+  while (size < ringSize && size < (1U << 31)) {
+    size <<= 1;
+  }
+  return size;
+}
+
+AsyncFileLogger::AsyncFileLogger(FILE *file, Severity severity, TimeSource &source, UInt32 ringSize,
+                                 bool blockWhenFull, UInt32 idleMilliSeconds, Output output, Allocator &allocator)
+    : Logger(),
+      Thread(),
+      _id(NextLoggerId.inc()),
+      _ringSize(RingSize(ringSize)),
+      _idleMilliSeconds(idleMilliSeconds),
+      _blockWhenFull(blockWhenFull),
+      _output(output),
+      _started(false),
+      _wroteHeader(false),
+      _severity(severity),
+      _ringCount(0U),
+      _reportedDrops(0U),
+      _timeSource(source),
+      _allocator(allocator),
+      _dropped(),
+      _registerLock(),
+      _writeLock(),
+      _file(file),
+      _formatComparator(),
+      _formats(_formatComparator, NullLock::Instance(), allocator) {
+  memset(_rings, 0, sizeof(_rings));
+}
+
+AsyncFileLogger::~AsyncFileLogger() {
+  if (_started) {
+    stop();
+    join();
+  }
+
+  {
+    WriteScopeLock lock(_writeLock);
+    drain();
+  }
+
+  for (UInt32 i = 0; i < _ringCount; ++i) {
+    _allocator.deallocate(_rings[i]);
+    _rings[i] = NULL;
+  }
+}
+
+Error AsyncFileLogger::start() {
+  if (_started) {
+    return ESB_INVALID_STATE;
+  }
+
+  Error error = Thread::start();
+  if (ESB_SUCCESS == error) {
+    _started = true;
+  }
+  return error;
+}
+
+Error AsyncFileLogger::join() {
+  if (!_started) {
+    return ESB_INVALID_STATE;
+  }
+
+  Error error = Thread::join();
+  if (ESB_SUCCESS == error) {
+    _started = false;
+  }
+  return error;
+}
+
+bool AsyncFileLogger::isLoggable(Severity severity) { return !(severity > _severity); }
+
+void AsyncFileLogger::setSeverity(Severity severity) { _severity = severity; }
+
+Error AsyncFileLogger::log(Severity severity, const char *format, ...) {
+  if (!format) {
+    return ESB_NULL_POINTER;
+  }
+
+  if (severity > _severity) {
+    return ESB_SUCCESS;
+  }
+
+  Ring *ring = currentRing();
+  va_list vaList;
+
+#if !defined HAVE_VA_START || !defined HAVE_VA_END
+#error "va_start and va_end or equivalent is required"
+#endif
+
+  if (TEXT == _output || !ring) {
+    char message[ESB_ASYNC_LOGGER_MAX_MESSAGE];
+    va_start(vaList, format);
+    int length = FormatMessage(message, sizeof(message), format, vaList);
+    va_end(vaList);
+
+    if (0 > length) {
+      return ESB_INVALID_ARGUMENT;
+    }
+
+    if (!ring) {
+      write(message, length);
+      return ESB_SUCCESS;
+    }
+
+    return enqueue(ring, severity, message, length);
+  }
+
+  unsigned char record[ESB_ASYNC_LOGGER_MAX_MESSAGE];
+  va_start(vaList, format);
+  UInt32 size = LogRecord::EncodeArguments(record, sizeof(record), format, vaList);
+  va_end(vaList);
+
+  if (0 == size) {
+    // Arguments that cannot be captured or do not fit are formatted now
+    char message[ESB_ASYNC_LOGGER_MAX_MESSAGE - ESB_LOG_RECORD_HEADER_SIZE];
+    va_start(vaList, format);
+    int length = FormatMessage(message, sizeof(message), format, vaList);
+    va_end(vaList);
+
+    if (0 > length) {
+      return ESB_INVALID_ARGUMENT;
+    }
+
+    size = LogRecord::EncodeText(record, sizeof(record), message, length);
+  }
+
+  return enqueue(ring, severity, record, size);
+}
+
+Error AsyncFileLogger::enqueue(Ring *ring, Severity severity, const void *message, UInt32 length) {
+  while (!push(ring, message, length)) {
+    if (!_blockWhenFull && Critical < severity) {
+      _dropped.inc();
+      return ESB_OVERFLOW;
+    }
+
+    // Wait for the writer thread to finish its pass, then make room by draining the rings on this thread
+    WriteScopeLock lock(_writeLock);
+    drain();
+  }
+
+  if (Critical >= severity) {
+    flush();
+  }
+
+  return ESB_SUCCESS;
+}
+
+void AsyncFileLogger::flush() {
+  // Give up eventually so a thread that crashed while writing cannot deadlock the signal handler
+  for (UInt32 attempts = 0; ESB_SUCCESS != _writeLock.writeAttempt(); ++attempts) {
+    if (ESB_ASYNC_LOGGER_FLUSH_ATTEMPTS <= attempts) {
+      return;
+    }
+    Thread::Yield();
+  }
+
+  drain();
+  _writeLock.writeRelease();
+}
+
+UInt32 AsyncFileLogger::now() { return _timeSource.now().seconds(); }
+
+void AsyncFileLogger::run() {
+  while (isRunning()) {
+    UInt32 bytes = 0;
+
+    {
+      WriteScopeLock lock(_writeLock);
+      bytes = drain();
+    }
+
+    if (0 == bytes) {
+      Thread::Sleep((long)_idleMilliSeconds);
+    }
+  }
+
+  WriteScopeLock lock(_writeLock);
+  drain();
+}
+
+AsyncFileLogger::Ring *AsyncFileLogger::currentRing() {
+  if (CurrentLoggerId == _id) {
+    return (Ring *)CurrentRing;
+  }
+
+  Ring *ring = NULL;
+
+  {
+    WriteScopeLock lock(_registerLock);
+    const UInt32 count = _ringCount;
+
+    if (ESB_ASYNC_LOGGER_MAX_THREADS > count &&
+        ESB_SUCCESS == _allocator.allocate(sizeof(Ring) + _ringSize, (void **)&ring)) {
+      memset(ring, 0, sizeof(Ring));
+      _rings[count] = ring;
+      __atomic_store_n(&_ringCount, count + 1, __ATOMIC_RELEASE);
+    } else {
+      // This thread will write directly to the file
+      ring = NULL;
+    }
+  }
+
+  CurrentLoggerId = _id;
+  CurrentRing = ring;
+  return ring;
+}
+
+bool AsyncFileLogger::push(Ring *ring, const void *message, UInt32 length) {
+  const UInt32 tail = ring->_tail;
+  const UInt32 head = __atomic_load_n(&ring->_head, __ATOMIC_ACQUIRE);
+
+  if (_ringSize - (tail - head) < length) {
+    return false;
+  }
+
+  unsigned char *data = (unsigned char *)(ring + 1);
+  const UInt32 offset = tail & (_ringSize - 1);
+  const UInt32 first = MIN(length, _ringSize - offset);
+
+  memcpy(data + offset, message, first);
+  memcpy(data, (const unsigned char *)message + first, length - first);
+
+  // Publish the whole message at once so the writer never sees part of one
+  __atomic_store_n(&ring->_tail, tail + length, __ATOMIC_RELEASE);
+  return true;
+}
+
+UInt32 AsyncFileLogger::drain() {
+  UInt32 bytes = 0;
+  const UInt32 count = rings();
+
+  for (UInt32 i = 0; i < count; ++i) {
+    bytes += drain(_rings[i]);
+  }
+
+  const UInt32 dropped = _dropped.get();
+  if (dropped != _reportedDrops) {
+    char notice[ESB_ASYNC_LOGGER_MAX_MESSAGE];
+#ifdef HAVE_SNPRINTF
+    int length = snprintf(notice, sizeof(notice), ESB_WARNING_LOG_PREFIX "dropped %u log messages" ESB_LOG_SUFFIX,
+                          now(), Thread::CurrentThreadId(), dropped - _reportedDrops);
+#else
+#error "snprintf or equivalent is required"
+#endif
+    if (0 < length) {
+      length = MIN(length, (int)sizeof(notice) - 1);
+      writeText(notice, length);
+      bytes += length;
+    }
+    _reportedDrops = dropped;
+  }
+
+  if (0 < bytes) {
+#ifdef HAVE_FFLUSH
+    fflush(_file);
+#else
+#error "fflush or equivalent is required"
+#endif
+  }
+
+  return bytes;
+}
+
+UInt32 AsyncFileLogger::drain(Ring *ring) {
+  if (TEXT != _output) {
+    return drainRecords(ring);
+  }
+
+  const UInt32 head = ring->_head;
+  const UInt32 tail = __atomic_load_n(&ring->_tail, __ATOMIC_ACQUIRE);
+  const UInt32 length = tail - head;
+
+  if (0 == length) {
+    return 0;
+  }
+
+  const unsigned char *data = (const unsigned char *)(ring + 1);
+  const UInt32 offset = head & (_ringSize - 1);
+  const UInt32 first = MIN(length, _ringSize - offset);
+
+#ifdef HAVE_FWRITE
+  fwrite(data + offset, 1, first, _file);
+  if (first < length) {
+    fwrite(data, 1, length - first, _file);
+  }
+#else
+#error "fwrite or equivalent is required"
+#endif
+
+  __atomic_store_n(&ring->_head, tail, __ATOMIC_RELEASE);
+  return length;
+}
+
+UInt32 AsyncFileLogger::drainRecords(Ring *ring) {
+  const UInt32 tail = __atomic_load_n(&ring->_tail, __ATOMIC_ACQUIRE);
+  UInt32 head = ring->_head;
+
+  while (head != tail) {
+    copy(ring, head, _record, ESB_LOG_RECORD_HEADER_SIZE);
+    const UInt32 size = LogRecord::RecordSize(_record);
+    assert(ESB_LOG_RECORD_HEADER_SIZE <= size && sizeof(_record) >= size && tail - head >= size);
+    copy(ring, head + ESB_LOG_RECORD_HEADER_SIZE, _record + ESB_LOG_RECORD_HEADER_SIZE,
+         size - ESB_LOG_RECORD_HEADER_SIZE);
+    writeRecord(_record);
+    head += size;
+  }
+
+  const UInt32 length = tail - ring->_head;
+  __atomic_store_n(&ring->_head, tail, __ATOMIC_RELEASE);
+  return length;
+}
+
+void AsyncFileLogger::copy(const Ring *ring, UInt32 position, void *destination, UInt32 length) const {
+  const unsigned char *data = (const unsigned char *)(ring + 1);
+  const UInt32 offset = position & (_ringSize - 1);
+  const UInt32 first = MIN(length, _ringSize - offset);
+
+  memcpy(destination, data + offset, first);
+  memcpy((unsigned char *)destination + first, data, length - first);
+}
+
+void AsyncFileLogger::writeRecord(const unsigned char *record) {
+  UInt32 length = 0;
+
+  if (LogRecord::Text == LogRecord::RecordKind(record)) {
+    const char *text = LogRecord::TextString(record, &length);
+    writeText(text, length);
+    return;
+  }
+
+  assert(LogRecord::Arguments == LogRecord::RecordKind(record));
+  const char *format = (const char *)(UWord)LogRecord::FormatId(record);
+
+  if (DEFERRED == _output) {
+    int result = LogRecord::Render(_text, sizeof(_text), format, record);
+    if (0 < result) {
+      if (result == (int)sizeof(_text) - 1) {
+        _text[result - 1] = '\n';
+      }
+      fwrite(_text, 1, result, _file);
+    }
+    return;
+  }
+
+  if (!_formats.find(format)) {
+    // Define each format string before the first record that uses it
+    unsigned char definition[ESB_ASYNC_LOGGER_MAX_MESSAGE];
+    length = LogRecord::EncodeFormat(definition, sizeof(definition), format);
+    if (0 == length || ESB_SUCCESS != _formats.insert(format, (void *)format)) {
+      int result = LogRecord::Render(_text, sizeof(_text), format, record);
+      if (0 < result) {
+        writeText(_text, result);
+      }
+      return;
+    }
+    writeHeader();
+    fwrite(definition, 1, length, _file);
+  }
+
+  fwrite(record, 1, LogRecord::RecordSize(record), _file);
+}
+
+void AsyncFileLogger::writeText(const char *message, UInt32 length) {
+  if (BINARY != _output) {
+    fwrite(message, 1, length, _file);
+    return;
+  }
+
+  unsigned char record[ESB_ASYNC_LOGGER_MAX_MESSAGE];
+  const UInt32 size = LogRecord::EncodeText(record, sizeof(record), message, length);
+  writeHeader();
+  fwrite(record, 1, size, _file);
+}
+
+void AsyncFileLogger::writeHeader() {
+  if (_wroteHeader) {
+    return;
+  }
+
+  unsigned char header[ESB_LOG_RECORD_HEADER_SIZE + 16];
+  const UInt32 size = LogRecord::EncodeHeader(header, sizeof(header));
+  fwrite(header, 1, size, _file);
+  _wroteHeader = true;
+}
+
+void AsyncFileLogger::write(const char *message, UInt32 length) {
+  WriteScopeLock lock(_writeLock);
+
+#if defined HAVE_FWRITE && defined HAVE_FFLUSH
+  writeText(message, length);
+  fflush(_file);
+#else
+#error "fwrite and fflush or equivalent is required"
+#endif
+}
+
+}  // namespace ESB
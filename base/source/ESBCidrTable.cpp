@@ -0,0 +1,274 @@
+#ifndef ESB_CIDR_TABLE_H
+#include <ESBCidrTable.h>
+#endif
+
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#ifdef HAVE_NETINET_IN_H
+#include <netinet/in.h>
+#endif
+
+#ifdef HAVE_ARPA_INET_H
+#include <arpa/inet.h>
+#endif
+
+#define ESB_CIDR_TABLE_MIN_CAPACITY 16U
+
+namespace ESB {
+
+const UInt32 CidrTable::MaxValue;
+const UInt32 CidrTable::Chunk;
+const UInt32 CidrTable::Empty;
+
+static inline UInt32 Mask(UInt32 length) { return 0U == length ? 0U : ESB_UINT32_MAX << (32U - length); }
+
+// By address, then by length, so every prefix comes after all of the prefixes that contain it
+int CidrTable::ComparePrefixes(const void *a, const void *b) {
+  const Prefix *left = (const Prefix *)a;
+  const Prefix *right = (const Prefix *)b;
+
+  if (left->address != right->address) {
+    return left->address < right->address ? -1 : 1;
+  }
+
+  if (left->length != right->length) {
+    return left->length < right->length ? -1 : 1;
+  }
+
+  return 0;
+}
+
+CidrTable::CidrTable(Allocator &allocator)
+    : _size(0U), _capacity(0U), _chunks(0U), _prefixes(NULL), _table(NULL), _allocator(allocator) {}
+
+CidrTable::~CidrTable() {
+  if (_prefixes) {
+    _allocator.deallocate(_prefixes);
+    _prefixes = NULL;
+  }
+
+  if (_table) {
+    _allocator.deallocate(_table);
+    _table = NULL;
+  }
+}
+
+Error CidrTable::Parse(const char *cidr, UInt32 *address, UInt32 *length) {
+  if (!cidr || !address || !length) {
+    return ESB_NULL_POINTER;
+  }
+
+  const char *slash = strchr(cidr, '/');
+  const Size size = slash ? slash - cidr : strlen(cidr);
+  char buffer[16];
+
+  if (0U == size || sizeof(buffer) <= size) {
+    return ESB_CANNOT_PARSE;
+  }
+
+  memcpy(buffer, cidr, size);
+  buffer[size] = 0;
+
+  UInt32 prefixLength = 32U;
+
+  if (slash) {
+    const char *digits = slash + 1;
+    if (!*digits || 2 < strlen(digits)) {
+      return ESB_CANNOT_PARSE;
+    }
+
+    prefixLength = 0U;
+    for (const char *digit = digits; *digit; ++digit) {
+      if ('0' > *digit || '9' < *digit) {
+        return ESB_CANNOT_PARSE;
+      }
+      prefixLength = prefixLength * 10U + (*digit - '0');
+    }
+
+    if (32U < prefixLength) {
+      return ESB_CANNOT_PARSE;
+    }
+  }
+
+#if defined HAVE_INET_PTON && defined HAVE_NTOHL
+  struct in_addr in;
+  if (1 != inet_pton(AF_INET, buffer, &in)) {
+    return ESB_CANNOT_PARSE;
+  }
+
+  *address = ntohl(in.s_addr);
+#else
+#error "inet_pton and ntohl or equivalent are required."
+#endif
+
+  *length = prefixLength;
+  return ESB_SUCCESS;
+}
+
+Error CidrTable::insert(const char *cidr, UInt32 value) {
+  UInt32 address = 0U;
+  UInt32 length = 0U;
+
+  Error error = Parse(cidr, &address, &length);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  return insert(address, length, value);
+}
+
+Error CidrTable::insert(UInt32 address, UInt32 length, UInt32 value) {
+  if (32U < length || MaxValue < value) {
+    return ESB_INVALID_ARGUMENT;
+  }
+
+  if (_table) {
+    return ESB_INVALID_STATE;
+  }
+
+  if (_size == _capacity) {
+    const UInt32 capacity = _capacity ? _capacity * 2U : ESB_CIDR_TABLE_MIN_CAPACITY;
+    if (capacity < _capacity) {
+      return ESB_OUT_OF_MEMORY;
+    }
+
+    Prefix *prefixes = NULL;
+    Error error = _allocator.allocate(capacity * sizeof(Prefix), (void **)&prefixes);
+    if (ESB_SUCCESS != error) {
+      return error;
+    }
+
+    if (_prefixes) {
+      memcpy(prefixes, _prefixes, _size * sizeof(Prefix));
+      _allocator.deallocate(_prefixes);
+    }
+
+    _prefixes = prefixes;
+    _capacity = capacity;
+  }
+
+  Prefix &prefix = _prefixes[_size++];
+  prefix.address = address & Mask(length);
+  prefix.length = length;
+  prefix.value = value;
+  return ESB_SUCCESS;
+}
+
+Error CidrTable::build() {
+  if (_table) {
+    return ESB_INVALID_STATE;
+  }
+
+  if (0U < _size) {
+    qsort(_prefixes, _size, sizeof(Prefix), ComparePrefixes);
+  }
+
+  // Count the /16s and /24s that need a chunk.  Prefixes in the same /16 or /24 are adjacent once sorted.
+
+  UInt32 chunks = 0U;
+  bool first16 = true;
+  bool first24 = true;
+  UInt32 last16 = 0U;
+  UInt32 last24 = 0U;
+
+  for (UInt32 i = 0; i < _size; ++i) {
+    const Prefix &prefix = _prefixes[i];
+
+    if (0U < i && prefix.address == _prefixes[i - 1].address && prefix.length == _prefixes[i - 1].length) {
+      return ESB_UNIQUENESS_VIOLATION;
+    }
+
+    if (16U < prefix.length && (first16 || last16 != prefix.address >> 16)) {
+      first16 = false;
+      last16 = prefix.address >> 16;
+      ++chunks;
+    }
+
+    if (24U < prefix.length && (first24 || last24 != prefix.address >> 8)) {
+      first24 = false;
+      last24 = prefix.address >> 8;
+      ++chunks;
+    }
+  }
+
+  // Chunks are addressed by their offset in the table, which must fit below the Chunk bit
+  if ((Chunk - 65536U) / 256U < chunks) {
+    return ESB_OVERFLOW;
+  }
+
+  UInt32 *table = NULL;
+  Error error = _allocator.allocate(((Size)chunks + 256U) * 256U * sizeof(UInt32), (void **)&table);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  for (UInt32 i = 0; i < 65536U; ++i) {
+    table[i] = Empty;
+  }
+
+  // Painting in sorted order overwrites each prefix with the more specific prefixes inside it, and a chunk created
+  // below an entry already holds every shorter prefix covering it.
+
+  UInt32 nextChunk = 65536U;
+
+  for (UInt32 i = 0; i < _size; ++i) {
+    const Prefix &prefix = _prefixes[i];
+    UInt32 *level = table;
+    UInt32 first = 0U;
+    UInt32 count = 0U;
+
+    if (16U >= prefix.length) {
+      first = prefix.address >> 16;
+      count = 1U << (16U - prefix.length);
+    } else {
+      level = table + ChunkBelow(table + (prefix.address >> 16), table, &nextChunk);
+
+      if (24U >= prefix.length) {
+        first = (prefix.address >> 8) & 0xFFU;
+        count = 1U << (24U - prefix.length);
+      } else {
+        level = table + ChunkBelow(level + ((prefix.address >> 8) & 0xFFU), table, &nextChunk);
+        first = prefix.address & 0xFFU;
+        count = 1U << (32U - prefix.length);
+      }
+    }
+
+    for (UInt32 j = first; j < first + count; ++j) {
+      level[j] = prefix.value;
+    }
+  }
+
+  if (_prefixes) {
+    _allocator.deallocate(_prefixes);
+    _prefixes = NULL;
+  }
+
+  _capacity = 0U;
+  _chunks = chunks;
+  _table = table;
+  return ESB_SUCCESS;
+}
+
+UInt32 CidrTable::ChunkBelow(UInt32 *entry, UInt32 *table, UInt32 *nextChunk) {
+  if (*entry & Chunk) {
+    return *entry & ~Chunk;
+  }
+
+  const UInt32 chunk = *nextChunk;
+  *nextChunk += 256U;
+
+  for (UInt32 i = 0; i < 256U; ++i) {
+    table[chunk + i] = *entry;
+  }
+
+  *entry = Chunk | chunk;
+  return chunk;
+}
+
+}  // namespace ESB
@@ -2,17 +2,63 @@
 #include <ESBClientTLSContextIndex.h>
 #endif
 
+#ifndef ESB_CLIENT_TLS_SOCKET_H
+#include <ESBClientTLSSocket.h>
+#endif
+
 #ifndef ESB_LOGGER_H
 #include <ESBLogger.h>
 #endif
 
 namespace ESB {
 
-ClientTLSContextIndex::ClientTLSContextIndex(UInt32 numBuckets, UInt32 numLocks, Allocator &allocator)
-    : TLSContextIndex(numBuckets, numLocks, allocator), _defaultContext(NULL) {}
+ClientTLSContextIndex::ClientTLSContextIndex(UInt32 numBuckets, UInt32 numLocks, Allocator &allocator,
+                                             UInt32 maxSessions)
+    : TLSContextIndex(numBuckets, numLocks, allocator),
+      _defaultContext(NULL),
+      _sessionCache(maxSessions, numLocks, allocator) {}
 
 ClientTLSContextIndex::~ClientTLSContextIndex() {}
 
+/**
+ * This callback is invoked whenever a server issues a session, which for TLS 1.3 happens after the handshake.  It
+ * caches the session so the next connection to the same server can resume it.
+ */
+static int new_session_callback(SSL *ssl, SSL_SESSION *session) {
+  assert(ssl);
+  assert(session);
+  if (!ssl || !session) {
+    ESB_LOG_ERROR_ERRNO(ESB_INVALID_STATE, "New session callback not passed all arguments");
+    return 0;
+  }
+
+  ClientTLSSocket *socket = (ClientTLSSocket *)SSL_get_ex_data(ssl, TLSSocket::ExDataIndex());
+  if (!socket || socket->context().isNull() || !socket->context()->sessionCache()) {
+    return 0;
+  }
+
+  Error error = socket->context()->sessionCache()->insert(socket->fqdn(), socket->peerAddress(), session);
+  if (ESB_SUCCESS != error) {
+    ESB_LOG_DEBUG_ERRNO(error, "[%s] cannot cache TLS session", socket->name());
+    return 0;
+  }
+
+  // The cache now owns the session's reference
+  return 1;
+}
+
+Error ClientTLSContextIndex::initializeContext(TLSContext &context) {
+  if (0 == _sessionCache.maxSessions()) {
+    return ESB_SUCCESS;
+  }
+
+  // Sessions are only stored in _sessionCache, which is keyed by the server's address as well as its name
+  SSL_CTX_set_session_cache_mode(context.rawContext(), SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+  SSL_CTX_sess_set_new_cb(context.rawContext(), new_session_callback);
+  context.setSessionCache(&_sessionCache);
+  return ESB_SUCCESS;
+}
+
 Error ClientTLSContextIndex::indexDefaultContext(const TLSContext::Params &params) {
   if (!_defaultContext.isNull()) {
     return ESB_UNIQUENESS_VIOLATION;
@@ -32,6 +78,7 @@ Error ClientTLSContextIndex::indexDefaultContext(const TLSContext::Params &param
 void ClientTLSContextIndex::clear() {
   TLSContextIndex::clear();
   _defaultContext = NULL;
+  _sessionCache.clear();
 }
 
 }  // namespace ESB
@@ -2,10 +2,18 @@
 #include <ESBClientTLSSocket.h>
 #endif
 
+#ifndef ESB_TLS_SESSION_CACHE_H
+#include <ESBTLSSessionCache.h>
+#endif
+
 #ifndef ESB_LOGGER_H
 #include <ESBLogger.h>
 #endif
 
+#ifndef ESB_TIME_H
+#include <ESBTime.h>
+#endif
+
 #include <openssl/err.h>
 #include <openssl/x509_vfy.h>
 #include <openssl/x509v3.h>
@@ -100,6 +108,27 @@ Error ClientTLSSocket::startHandshake() {
       ESB_LOG_TLS_ERROR("[%s] cannot set SNI for '%s'", name(), _fqdn);
       return ESB_GENERAL_TLS_ERROR;
     }
+
+    // Lets the new session callback cache sessions the server issues for this fqdn and address
+    if (1 != SSL_set_ex_data(_ssl, ExDataIndex(), this)) {
+      SSL_free(_ssl);  // this also frees _bio
+      _bio = NULL;
+      _ssl = NULL;
+      ESB_LOG_TLS_ERROR("[%s] cannot associate socket with SSL context", name());
+      return ESB_GENERAL_TLS_ERROR;
+    }
+
+    // Try to resume a previous session with the server instead of doing a full handshake
+    TLSSessionCache *cache = _context->sessionCache();
+    if (cache) {
+      SSL_SESSION *session = cache->find(_fqdn, _peerAddress, Time::Instance().now());
+      if (session) {
+        if (1 != SSL_set_session(_ssl, session)) {
+          ESB_LOG_TLS_INFO("[%s] cannot resume TLS session for '%s'", name(), _fqdn);
+        }
+        SSL_SESSION_free(session);
+      }
+    }
   }
 
   int ret = SSL_connect(_ssl);
@@ -123,7 +152,12 @@ Error ClientTLSSocket::startHandshake() {
     }
   }
 
-  ESB_LOG_DEBUG("[%s] client TLS handshake successful", name());
+  const bool resumed = SSL_session_reused(_ssl);
+  _context->countHandshake(resumed);
+  if (_context->sessionCache()) {
+    _context->sessionCache()->countHandshake(resumed);
+  }
+  ESB_LOG_DEBUG("[%s] client TLS handshake successful (%s)", name(), resumed ? "resumed" : "full");
 
   _flags |= ESB_TLS_FLAG_ESTABLISHED;
   _flags &= ~ESB_TLS_FLAG_WANT_READ;
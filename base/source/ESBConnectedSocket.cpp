@@ -255,6 +255,65 @@ SSize ConnectedSocket::send(Buffer *buffer) {
   return size;
 }
 
+SSize ConnectedSocket::send(const struct iovec *segments, int segmentCount) {
+#if defined HAVE_WRITEV
+  return writev(_sockFd, segments, segmentCount);
+#else
+  SSize total = 0;
+
+  for (int i = 0; i < segmentCount; ++i) {
+    SSize size = send((const char *)segments[i].iov_base, segments[i].iov_len);
+
+    if (0 >= size) {
+      return 0 < total ? total : size;
+    }
+
+    total += size;
+
+    if (size < (SSize)segments[i].iov_len) {
+      break;
+    }
+  }
+
+  return total;
+#endif
+}
+
+SSize ConnectedSocket::send(Buffer *buffer, const char *data, Size dataSize) {
+  struct iovec segments[2];
+  const Size buffered = buffer->readable();
+  int segmentCount = 0;
+
+  if (0 < buffered) {
+    segments[segmentCount].iov_base = buffer->buffer() + buffer->readPosition();
+    segments[segmentCount].iov_len = buffered;
+    ++segmentCount;
+  }
+
+  if (0 < dataSize) {
+    segments[segmentCount].iov_base = (void *)data;
+    segments[segmentCount].iov_len = dataSize;
+    ++segmentCount;
+  }
+
+  if (0 == segmentCount) {
+    return 0;
+  }
+
+  SSize size = send(segments, segmentCount);
+
+  if (0 >= size) {
+    return size;
+  }
+
+  if (0 < buffered) {
+    buffer->setReadPosition(buffer->readPosition() + MIN((Size)size, buffered));
+    buffer->compact();
+  }
+
+  return size;
+}
+
 int ConnectedSocket::bytesReadable() { return BytesReadable(_sockFd); }
 
 int ConnectedSocket::BytesReadable(SOCKET socketDescriptor) {
@@ -291,4 +350,6 @@ bool ConnectedSocket::wantRead() { return false; }
 
 bool ConnectedSocket::wantWrite() { return false; }
 
+Error ConnectedSocket::handshake() { return connected() ? ESB_SUCCESS : ESB_INVALID_STATE; }
+
 }  // namespace ESB
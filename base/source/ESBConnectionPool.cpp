@@ -14,33 +14,171 @@
 #include <ESBClearSocket.h>
 #endif
 
+#ifndef ESB_READ_SCOPE_LOCK_H
+#include <ESBReadScopeLock.h>
+#endif
+
+#ifndef ESB_WRITE_SCOPE_LOCK_H
+#include <ESBWriteScopeLock.h>
+#endif
+
 namespace ESB {
 
 ConnectionPool::ConnectionPool(const char *prefix, UInt32 numBuckets, UInt32 numLocks,
-                               ClientTLSContextIndex &contextIndex, Allocator &allocator)
+                               ClientTLSContextIndex &contextIndex, Allocator &allocator, Group *group)
     : _prefix(prefix),
       _allocator(allocator),
+      _socketAllocator(group ? group->allocator() : allocator),
       _contextIndex(contextIndex),
+      _group(NULL),
+      _nextVictim(0U),
       _hits(0),
       _misses(0),
-      _callbacks(allocator),
-      _activeSockets(_callbacks, numBuckets, numLocks, allocator) {}
+      _steals(0),
+      _wanted(0),
+      _callbacks(_socketAllocator),
+      _activeSockets(_callbacks, numBuckets, numLocks, allocator),
+      _lendableSockets(_callbacks, group ? numBuckets : 1U, 0U, allocator),
+      _lock(),
+      _comparator(),
+      _destinations(_comparator, NullLock::Instance(), allocator) {
+  if (group) {
+    Error error = group->attach(this);
+    if (ESB_SUCCESS == error) {
+      _group = group;
+    } else {
+      ESB_LOG_WARNING_ERRNO(error, "[%s] cannot join connection pool group", _prefix);
+    }
+  }
+}
 
-ConnectionPool::~ConnectionPool() { clear(); }
+ConnectionPool::~ConnectionPool() {
+  if (_group) {
+    _group->detach(this);
+    _group = NULL;
+  }
+  clear();
+}
 
 void ConnectionPool::clear() {
+  {
+    WriteScopeLock lock(_lock);
+    _lendableSockets.clear();
+  }
+
   for (EmbeddedListElement *e = _deconstructedClearSockets.removeFirst(); e;
        e = _deconstructedClearSockets.removeFirst()) {
-    _allocator.deallocate(e);
+    _socketAllocator.deallocate(e);
   }
   for (EmbeddedListElement *e = _deconstructedTLSSockets.removeFirst(); e; e = _deconstructedTLSSockets.removeFirst()) {
-    _allocator.deallocate(e);
+    _socketAllocator.deallocate(e);
   }
   _activeSockets.clear();
   _hits.set(0);
   _misses.set(0);
+  _steals.set(0);
+
+  for (MapIterator it = _destinations.minimumIterator(); !it.isNull(); ++it) {
+    Counters *counters = (Counters *)it.value();
+    counters->~Counters();
+    _allocator.deallocate(counters);
+  }
+  _destinations.clear();
+}
+
+const ConnectionPool::Counters *ConnectionPool::destinationCounters(const SocketAddress &peerAddress) {
+  return (const Counters *)_destinations.find(&peerAddress);
+}
+
+ConnectionPool::Counters *ConnectionPool::counters(const SocketAddress &peerAddress) {
+  Counters *counters = (Counters *)_destinations.find(&peerAddress);
+  if (counters || ESB_CONNECTION_POOL_MAX_DESTINATIONS <= _destinations.size()) {
+    return counters;
+  }
+
+  counters = new (_allocator) Counters(peerAddress);
+  if (!counters) {
+    return NULL;
+  }
+
+  Error error = _destinations.insert(&counters->_peerAddress, counters);
+  if (ESB_SUCCESS != error) {
+    counters->~Counters();
+    _allocator.deallocate(counters);
+    return NULL;
+  }
+
+  return counters;
+}
+
+ConnectedSocket *ConnectionPool::acquire(const SocketKey &key) {
+  Counters *counters = this->counters(key._peerAddress);
+  ConnectedSocket *socket = (ConnectedSocket *)_activeSockets.remove(&key);
+
+  if (!socket && _group) {
+    // Take back a connection this pool handed off that no thief has taken yet
+    socket = lend(key);
+  }
+
+  if (socket) {
+    _hits.inc();
+    if (counters) {
+      ++counters->_hits;
+    }
+    return socket;
+  }
+
+  if (_group) {
+    socket = _group->steal(this, key);
+    if (socket) {
+      _steals.inc();
+      if (counters) {
+        ++counters->_steals;
+      }
+      return socket;
+    }
+  }
+
+  _misses.inc();
+  if (counters) {
+    ++counters->_misses;
+  }
+  return NULL;
+}
+
+ConnectedSocket *ConnectionPool::lend(const SocketKey &key) {
+  if (0 == _lendableSockets.size() || ESB_SUCCESS != _lock.writeAttempt()) {
+    return NULL;
+  }
+
+  ConnectedSocket *socket = (ConnectedSocket *)_lendableSockets.remove(&key);
+  _lock.writeRelease();
+  return socket;
 }
 
+bool ConnectionPool::handOff(ConnectedSocket *connection) {
+  if (0 == _wanted.get() || ESB_SUCCESS != _lock.writeAttempt()) {
+    return false;
+  }
+
+  Error error = _lendableSockets.insert(connection);
+  _lock.writeRelease();
+  if (ESB_SUCCESS != error) {
+    return false;
+  }
+
+  _wanted.set(0);
+  return true;
+}
+
+class TLSKey {
+ public:
+  TLSKey(const char *fqdn, TLSContextPointer &context) : _fqdn(fqdn), _context(context) {}
+
+  const char *_fqdn;
+  TLSContextPointer &_context;
+};
+
 Error ConnectionPool::acquireClearSocket(const SocketAddress &peerAddress, ConnectedSocket **connection, bool *reused) {
   if (!connection || !reused) {
     return ESB_NULL_POINTER;
@@ -55,112 +193,228 @@ Error ConnectionPool::acquireClearSocket(const SocketAddress &peerAddress, Conne
 
   {
     SocketKey key(peerAddress, SocketKey::CLEAR_KEY, NULL);
-    socket = (ClearSocket *)_activeSockets.remove(&key);
+    socket = (ClearSocket *)acquire(key);
   }
 
   if (socket) {
     assert(0 == socket->peerAddress().compare(peerAddress));
-    _hits.inc();
     *reused = true;
     *connection = socket;
     return ESB_SUCCESS;
   }
 
-  _misses.inc();
+  Error error = createClearSocket(peerAddress, connection);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
 
-  {
-    ClearSocket *memory = (ClearSocket *)_deconstructedClearSockets.removeLast();
-    if (memory) {
-      socket = new (memory) ClearSocket(peerAddress, _prefix);
-    } else {
-      socket = new (_allocator) ClearSocket(peerAddress, _prefix);
-    }
+  *reused = false;
+  return ESB_SUCCESS;
+}
+
+Error ConnectionPool::acquireTLSSocket(const char *fqdn, const SocketAddress &peerAddress, ConnectedSocket **connection,
+                                       bool *reused) {
+  if (!connection || !reused) {
+    return ESB_NULL_POINTER;
   }
 
-  if (!socket) {
-    if (ESB_ERROR_LOGGABLE) {
-      char presentationAddress[ESB_IPV6_PRESENTATION_SIZE];
-      peerAddress.presentationAddress(presentationAddress, sizeof(presentationAddress));
-      ESB_LOG_ERROR_ERRNO(ESB_OUT_OF_MEMORY, "cannot connect to [%s:%u]", presentationAddress, peerAddress.port());
-    }
-    return ESB_OUT_OF_MEMORY;
+  assert(SocketAddress::TLS == peerAddress.type());
+  if (SocketAddress::TLS != peerAddress.type()) {
+    return ESB_INVALID_ARGUMENT;
   }
 
-  Error error = socket->connect();
+  TLSContextPointer context;
+  Error error = findContext(fqdn, context);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  ClientTLSSocket *socket = NULL;
+
+  {
+    TLSKey tlsKey(fqdn, context);
+    SocketKey key(peerAddress, SocketKey::TLS_KEY, &tlsKey);
+    socket = (ClientTLSSocket *)acquire(key);
+  }
+
+  if (socket) {
+    assert(0 == socket->peerAddress().compare(peerAddress));
+    *reused = true;
+    *connection = socket;
+    return ESB_SUCCESS;
+  }
 
+  error = createTLSSocket(fqdn, peerAddress, context, connection);
   if (ESB_SUCCESS != error) {
-    ESB_LOG_DEBUG_ERRNO(error, "[%s] cannot connect to peer", socket->name());
-    socket->~ClearSocket();
-    _deconstructedClearSockets.addLast(socket);
-    *connection = NULL;
     return error;
   }
 
   *reused = false;
-  *connection = socket;
   return ESB_SUCCESS;
 }
 
-class TLSKey {
- public:
-  TLSKey(const char *fqdn, TLSContextPointer &context) : _fqdn(fqdn), _context(context) {}
+Error ConnectionPool::connectSocket(const char *fqdn, const SocketAddress &peerAddress, ConnectedSocket **connection) {
+  if (!connection) {
+    return ESB_NULL_POINTER;
+  }
 
-  const char *_fqdn;
-  TLSContextPointer &_context;
-};
+  switch (peerAddress.type()) {
+    case SocketAddress::TCP:
+      return createClearSocket(peerAddress, connection);
+    case SocketAddress::TLS: {
+      if (!fqdn) {
+        return ESB_NULL_POINTER;
+      }
+      TLSContextPointer context;
+      Error error = findContext(fqdn, context);
+      if (ESB_SUCCESS != error) {
+        return error;
+      }
+      return createTLSSocket(fqdn, peerAddress, context, connection);
+    }
+    default:
+      return ESB_INVALID_ARGUMENT;
+  }
+}
 
-Error ConnectionPool::acquireTLSSocket(const char *fqdn, const SocketAddress &peerAddress, ConnectedSocket **connection,
-                                       bool *reused) {
-  if (!connection || !reused) {
-    return ESB_NULL_POINTER;
+UInt32 ConnectionPool::idleSockets(const char *fqdn, const SocketAddress &peerAddress) {
+  switch (peerAddress.type()) {
+    case SocketAddress::TCP: {
+      SocketKey key(peerAddress, SocketKey::CLEAR_KEY, NULL);
+      return idleSockets(key);
+    }
+    case SocketAddress::TLS: {
+      TLSContextPointer context;
+      if (!fqdn || ESB_SUCCESS != findContext(fqdn, context)) {
+        return 0U;
+      }
+      TLSKey tlsKey(fqdn, context);
+      SocketKey key(peerAddress, SocketKey::TLS_KEY, &tlsKey);
+      return idleSockets(key);
+    }
+    default:
+      return 0U;
   }
+}
 
-  assert(SocketAddress::TLS == peerAddress.type());
-  if (SocketAddress::TLS != peerAddress.type()) {
-    return ESB_INVALID_ARGUMENT;
+UInt32 ConnectionPool::idleSockets(const SocketKey &key) {
+  UInt32 idle = _activeSockets.count(&key);
+
+  // Handed off connections are skipped while a thief is looking at them
+  if (0 < _lendableSockets.size() && ESB_SUCCESS == _lock.writeAttempt()) {
+    idle += _lendableSockets.count(&key);
+    _lock.writeRelease();
   }
 
+  return idle;
+}
+
+UInt32 ConnectionPool::retireSockets(const char *fqdn, const SocketAddress &peerAddress, UInt32 maxIdle) {
   TLSContextPointer context;
-  ESB::Error error = _contextIndex.matchContext(fqdn, context);
+  TLSKey tlsKey(fqdn, context);
+  SocketKey clearKey(peerAddress, SocketKey::CLEAR_KEY, NULL);
+  SocketKey secureKey(peerAddress, SocketKey::TLS_KEY, &tlsKey);
+  SocketKey *key = NULL;
+
+  switch (peerAddress.type()) {
+    case SocketAddress::TCP:
+      key = &clearKey;
+      break;
+    case SocketAddress::TLS:
+      if (!fqdn || ESB_SUCCESS != findContext(fqdn, context)) {
+        return 0U;
+      }
+      key = &secureKey;
+      break;
+    default:
+      return 0U;
+  }
+
+  UInt32 idle = idleSockets(*key);
+  UInt32 retired = 0U;
+
+  for (; idle > maxIdle; --idle) {
+    // The least recently used connection is the one most likely to have been closed by the peer
+    ConnectedSocket *socket = (ConnectedSocket *)_activeSockets.removeLast(key);
+    if (!socket && 0 < _lendableSockets.size() && ESB_SUCCESS == _lock.writeAttempt()) {
+      socket = (ConnectedSocket *)_lendableSockets.removeLast(key);
+      _lock.writeRelease();
+    }
+    if (!socket) {
+      break;
+    }
+    ESB_LOG_DEBUG("[%s] retiring idle connection", socket->name());
+    socket->close();
+    release(socket);
+    ++retired;
+  }
+
+  return retired;
+}
+
+Error ConnectionPool::findContext(const char *fqdn, TLSContextPointer &context) {
+  Error error = _contextIndex.matchContext(fqdn, context);
   switch (error) {
     case ESB_SUCCESS:
-      break;
+      return ESB_SUCCESS;
     case ESB_CANNOT_FIND:
       context = _contextIndex.defaultContext();
       if (context.isNull()) {
         ESB_LOG_WARNING("cannot find TLS client context for %s", fqdn);
         return ESB_CANNOT_FIND;
       }
-      break;
+      return ESB_SUCCESS;
     default:
       ESB_LOG_WARNING_ERRNO(error, "cannot find TLS client context for %s", fqdn);
       return error;
   }
+}
 
-  ClientTLSSocket *socket = NULL;
+Error ConnectionPool::createClearSocket(const SocketAddress &peerAddress, ConnectedSocket **connection) {
+  ClearSocket *socket = NULL;
 
   {
-    TLSKey tlsKey(fqdn, context);
-    SocketKey key(peerAddress, SocketKey::TLS_KEY, &tlsKey);
-    socket = (ClientTLSSocket *)_activeSockets.remove(&key);
+    ClearSocket *memory = (ClearSocket *)_deconstructedClearSockets.removeLast();
+    if (memory) {
+      socket = new (memory) ClearSocket(peerAddress, _prefix);
+    } else {
+      socket = new (_socketAllocator) ClearSocket(peerAddress, _prefix);
+    }
   }
 
-  if (socket) {
-    assert(0 == socket->peerAddress().compare(peerAddress));
-    _hits.inc();
-    *reused = true;
-    *connection = socket;
-    return ESB_SUCCESS;
+  if (!socket) {
+    if (ESB_ERROR_LOGGABLE) {
+      char presentationAddress[ESB_IPV6_PRESENTATION_SIZE];
+      peerAddress.presentationAddress(presentationAddress, sizeof(presentationAddress));
+      ESB_LOG_ERROR_ERRNO(ESB_OUT_OF_MEMORY, "cannot connect to [%s:%u]", presentationAddress, peerAddress.port());
+    }
+    return ESB_OUT_OF_MEMORY;
   }
 
-  _misses.inc();
+  Error error = socket->connect();
+
+  if (ESB_SUCCESS != error) {
+    ESB_LOG_DEBUG_ERRNO(error, "[%s] cannot connect to peer", socket->name());
+    socket->~ClearSocket();
+    _deconstructedClearSockets.addLast(socket);
+    *connection = NULL;
+    return error;
+  }
+
+  *connection = socket;
+  return ESB_SUCCESS;
+}
+
+Error ConnectionPool::createTLSSocket(const char *fqdn, const SocketAddress &peerAddress, TLSContextPointer &context,
+                                      ConnectedSocket **connection) {
+  ClientTLSSocket *socket = NULL;
 
   {
     ClientTLSSocket *memory = (ClientTLSSocket *)_deconstructedTLSSockets.removeLast();
     if (memory) {
       socket = new (memory) ClientTLSSocket(fqdn, peerAddress, _prefix, context);
     } else {
-      socket = new (_allocator) ClientTLSSocket(fqdn, peerAddress, _prefix, context);
+      socket = new (_socketAllocator) ClientTLSSocket(fqdn, peerAddress, _prefix, context);
     }
   }
 
@@ -173,7 +427,7 @@ Error ConnectionPool::acquireTLSSocket(const char *fqdn, const SocketAddress &pe
     return ESB_OUT_OF_MEMORY;
   }
 
-  error = socket->connect();
+  Error error = socket->connect();
 
   if (ESB_SUCCESS != error) {
     ESB_LOG_DEBUG_ERRNO(error, "[%s] cannot connect to peer", socket->name());
@@ -183,7 +437,6 @@ Error ConnectionPool::acquireTLSSocket(const char *fqdn, const SocketAddress &pe
     return error;
   }
 
-  *reused = false;
   *connection = socket;
   return ESB_SUCCESS;
 }
@@ -207,6 +460,10 @@ void ConnectionPool::release(ConnectedSocket *connection) {
       }
     }
 
+    if (_group && handOff(connection)) {
+      return;
+    }
+
     Error error = _activeSockets.insert(connection);
     if (ESB_SUCCESS == error) {
       return;
@@ -227,7 +484,7 @@ void ConnectionPool::release(ConnectedSocket *connection) {
       _deconstructedTLSSockets.addLast(connection);
       break;
     default:
-      _allocator.deallocate(connection);
+      _socketAllocator.deallocate(connection);
   }
 }
 
@@ -336,6 +593,94 @@ UInt64 ConnectionPool::SocketAddressCallbacks::hash(const void *k) const {
   }
 }
 
+int ConnectionPool::SocketAddressComparator::compare(const void *first, const void *second) const {
+  return ((const SocketAddress *)first)->compare(*(const SocketAddress *)second);
+}
+
+ConnectionPool::Group::Group(UInt32 maxPools, Allocator &allocator)
+    : _maxPools(maxPools), _size(0U), _pools(NULL), _lock(), _allocator(allocator) {
+  Error error = _allocator.allocate(_maxPools * sizeof(ConnectionPool *), (void **)&_pools);
+  if (ESB_SUCCESS != error) {
+    // _pools will be checked in later functions
+    _pools = NULL;
+  }
+}
+
+ConnectionPool::Group::~Group() {
+  if (_pools) {
+    _allocator.deallocate(_pools);
+    _pools = NULL;
+  }
+}
+
+Error ConnectionPool::Group::attach(ConnectionPool *pool) {
+  WriteScopeLock lock(_lock);
+
+  if (!_pools) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  if (_size >= _maxPools) {
+    return ESB_OVERFLOW;
+  }
+
+  _pools[_size++] = pool;
+  return ESB_SUCCESS;
+}
+
+void ConnectionPool::Group::detach(ConnectionPool *pool) {
+  WriteScopeLock lock(_lock);
+
+  for (UInt32 i = 0; i < _size; ++i) {
+    if (_pools[i] == pool) {
+      _pools[i] = _pools[--_size];
+      return;
+    }
+  }
+}
+
+void ConnectionPool::Group::counters(UInt64 *hits, UInt64 *misses, UInt64 *steals) const {
+  ReadScopeLock lock(_lock);
+
+  *hits = *misses = *steals = 0U;
+  for (UInt32 i = 0; i < _size; ++i) {
+    *hits += _pools[i]->hits();
+    *misses += _pools[i]->misses();
+    *steals += _pools[i]->steals();
+  }
+}
+
+ConnectedSocket *ConnectionPool::Group::steal(ConnectionPool *thief, const SocketKey &key) {
+  ReadScopeLock lock(_lock);
+
+  if (2 > _size) {
+    return NULL;
+  }
+
+  // Start at a different victim each time so no one pool is drained first
+  const UInt32 start = thief->_nextVictim++;
+  for (UInt32 i = 0; i < _size; ++i) {
+    ConnectionPool *victim = _pools[(start + i) % _size];
+    if (victim == thief) {
+      continue;
+    }
+    ConnectedSocket *socket = victim->lend(key);
+    if (socket) {
+      return socket;
+    }
+  }
+
+  // Ask the other owners to hand off the next connection they release
+  for (UInt32 i = 0; i < _size; ++i) {
+    ConnectionPool *victim = _pools[i];
+    if (victim != thief && 0 == victim->_wanted.get()) {
+      victim->_wanted.set(1);
+    }
+  }
+
+  return NULL;
+}
+
 void ConnectionPool::SocketAddressCallbacks::cleanup(ESB::EmbeddedMapElement *element) {
   ConnectedSocket *connection = (ConnectedSocket *)element;
   connection->close();
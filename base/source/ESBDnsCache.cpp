@@ -0,0 +1,128 @@
+#ifndef ESB_DNS_CACHE_H
+#include <ESBDnsCache.h>
+#endif
+
+#ifndef ESB_WRITE_SCOPE_LOCK_H
+#include <ESBWriteScopeLock.h>
+#endif
+
+namespace ESB {
+
+DnsCache::DnsCache(UInt32 maxEntries, UInt32 maxTtlSeconds, UInt32 negativeTtlSeconds, Allocator &allocator)
+    : _maxEntries(maxEntries),
+      _maxTtlSeconds(maxTtlSeconds),
+      _negativeTtlSeconds(negativeTtlSeconds),
+      _allocator(allocator),
+      _hits(),
+      _misses(),
+      _lock(),
+      _comparator(),
+      _entries(_comparator, NullLock::Instance(), _allocator),
+      _age() {}
+
+DnsCache::~DnsCache() { clear(); }
+
+bool DnsCache::find(const char *hostname, const Date &now, Error *result, UInt32 *address) {
+  if (!hostname || !result || !address) {
+    return false;
+  }
+
+  WriteScopeLock lock(_lock);
+
+  Entry *entry = (Entry *)_entries.find(hostname);
+  if (!entry) {
+    _misses.inc();
+    return false;
+  }
+
+  if (entry->_expires <= now) {
+    destroy(entry);
+    _misses.inc();
+    return false;
+  }
+
+  _hits.inc();
+  *result = entry->_result;
+  *address = entry->_address;
+  return true;
+}
+
+void DnsCache::clear() {
+  WriteScopeLock lock(_lock);
+
+  for (Entry *entry = (Entry *)_age.first(); entry; entry = (Entry *)_age.first()) {
+    destroy(entry);
+  }
+
+  assert(0 == _entries.size());
+}
+
+UInt32 DnsCache::size() {
+  WriteScopeLock lock(_lock);
+  return _entries.size();
+}
+
+Error DnsCache::insert(const char *hostname, Error result, UInt32 address, UInt32 ttlSeconds, const Date &now) {
+  if (!hostname) {
+    return ESB_NULL_POINTER;
+  }
+
+  if (0 == _maxEntries || 0 == ttlSeconds) {
+    return ESB_SUCCESS;
+  }
+
+  const Size length = strlen(hostname);
+  if (ESB_MAX_HOSTNAME < length) {
+    return ESB_INVALID_ARGUMENT;
+  }
+
+  WriteScopeLock lock(_lock);
+
+  Entry *entry = (Entry *)_entries.find(hostname);
+  if (entry) {
+    // Another thread looked up the same hostname
+    entry->_result = result;
+    entry->_address = address;
+    entry->_expires = now + ttlSeconds;
+    _age.remove(entry);
+    _age.addLast(entry);
+    return ESB_SUCCESS;
+  }
+
+  if (_entries.size() >= _maxEntries) {
+    destroy((Entry *)_age.first());
+  }
+
+  unsigned char *block = NULL;
+  Error error = _allocator.allocate(sizeof(Entry) + length + 1, (void **)&block);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  entry = new (block) Entry(result, address, now + ttlSeconds);
+  memcpy(block + sizeof(Entry), hostname, length + 1);
+
+  error = _entries.insert(entry->hostname(), entry);
+  if (ESB_SUCCESS != error) {
+    entry->~Entry();
+    _allocator.deallocate(block);
+    return error;
+  }
+
+  _age.addLast(entry);
+  return ESB_SUCCESS;
+}
+
+void DnsCache::destroy(Entry *entry) {
+  assert(entry);
+  _entries.remove(entry->hostname());
+  _age.remove(entry);
+  entry->~Entry();
+  _allocator.deallocate(entry);
+}
+
+int DnsCache::HostnameComparator::compare(const void *first, const void *second) const {
+  return strcasecmp((const char *)first, (const char *)second);
+}
+
+}  // namespace ESB
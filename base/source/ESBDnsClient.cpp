@@ -5,4 +5,15 @@
 namespace ESB {
 DnsClient::DnsClient() {}
 DnsClient::~DnsClient() {}
+
+Error DnsClient::resolve(SocketAddress &address, const char *hostname, UInt16 port, bool isSecure,
+                         Callback &callback) {
+  return resolve(address, hostname, port, isSecure);
+}
+
+void DnsClient::cancel(Callback &callback) {}
+
+DnsClient::Callback::Callback() : EmbeddedListElement(), _port(0U), _isSecure(false), _lookup(NULL) {}
+DnsClient::Callback::~Callback() {}
+CleanupHandler *DnsClient::Callback::cleanupHandler() { return NULL; }
 }  // namespace ESB
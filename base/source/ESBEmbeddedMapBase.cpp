@@ -95,6 +95,39 @@ EmbeddedMapElement *EmbeddedMapBase::remove(ESB::UInt32 bucket, const void *key)
   return NULL;
 }
 
+EmbeddedMapElement *EmbeddedMapBase::removeLast(ESB::UInt32 bucket, const void *key) {
+  if (!_buckets) {
+    return NULL;
+  }
+
+  EmbeddedMapElement *elem = (EmbeddedMapElement *)_buckets[bucket].last();
+  for (; elem; elem = (EmbeddedMapElement *)elem->previous()) {
+    if (0 == _callbacks.compare(key, elem->key())) {
+      _buckets[bucket].remove(elem);
+      _numElements.dec();
+      return elem;
+    }
+  }
+
+  return NULL;
+}
+
+UInt32 EmbeddedMapBase::count(ESB::UInt32 bucket, const void *key) {
+  if (!_buckets) {
+    return 0U;
+  }
+
+  UInt32 count = 0U;
+  for (EmbeddedMapElement *elem = (EmbeddedMapElement *)_buckets[bucket].first(); elem;
+       elem = (EmbeddedMapElement *)elem->next()) {
+    if (0 == _callbacks.compare(key, elem->key())) {
+      ++count;
+    }
+  }
+
+  return count;
+}
+
 bool EmbeddedMapBase::validate(double *chiSquared) const {
   double expectedLength = ((double)_numElements.get()) / _numBuckets;
   double sum = 0.0;
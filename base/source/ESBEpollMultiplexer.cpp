@@ -18,6 +18,10 @@
 #include <ESBLogger.h>
 #endif
 
+#ifndef ESB_MONOTONIC_TIME_SOURCE_H
+#include <ESBMonotonicTimeSource.h>
+#endif
+
 #ifndef ESB_ERROR_H
 #include <ESBError.h>
 #endif
@@ -71,6 +75,25 @@ namespace ESB {
 static const UInt32 MAX_TIMEOUT_MSEC = 30 * 60 * 1000;  // 30 min
 static const UInt32 MIN_TIMEOUT_MSEC = 10;              // 10 msec
 
+static UInt32 Interests(MultiplexedSocket *socket) {
+  UInt32 interests = EPOLLERR;
+
+  if (socket->wantAccept()) {
+    interests |= EPOLLIN;
+  } else if (socket->wantConnect()) {
+    interests |= EPOLLIN | EPOLLOUT | EPOLLHUP;
+  } else {
+    if (socket->wantWrite()) {
+      interests |= EPOLLOUT | EPOLLHUP;
+    }
+    if (socket->wantRead()) {
+      interests |= EPOLLIN | EPOLLHUP;
+    }
+  }
+
+  return interests;
+}
+
 EpollMultiplexer::EpollMultiplexer(const char *namePrefix, UInt32 idleTimeoutMsec, UInt32 maxSockets,
                                    Allocator &allocator)
     : SocketMultiplexer(),
@@ -78,12 +101,17 @@ EpollMultiplexer::EpollMultiplexer(const char *namePrefix, UInt32 idleTimeoutMse
       _idleTimeoutMsec(0 == idleTimeoutMsec ? 0 : MIN(MAX(idleTimeoutMsec, MIN_TIMEOUT_MSEC), MAX_TIMEOUT_MSEC)),
       _maxSockets(MAX(maxSockets, 1)),
       _events(NULL),
-      _eventCache(NULL),
       _allocator(allocator),
+      _interestUpdates(0),
+      _avoidedInterestUpdates(0),
       _activeSocketCount(),
       _activeSockets(),
       _deadSockets(),
-      _timingWheel(MAX_TIMEOUT_MSEC * 2 / MIN_TIMEOUT_MSEC, MIN_TIMEOUT_MSEC, Time::Instance().now(), _allocator) {
+      _timingWheel(MAX_TIMEOUT_MSEC * 2 / MIN_TIMEOUT_MSEC, MIN_TIMEOUT_MSEC, MonotonicTimeSource::Instance().now(),
+                   _allocator),
+      _timers(MAX_TIMEOUT_MSEC * 2 / MIN_TIMEOUT_MSEC, MIN_TIMEOUT_MSEC, MonotonicTimeSource::Instance().now(),
+              _allocator),
+      _counters(_namePrefix) {
   strncpy(_namePrefix, namePrefix, sizeof(_namePrefix));
   _namePrefix[sizeof(_namePrefix) - 1] = 0;
 
@@ -103,19 +131,6 @@ EpollMultiplexer::EpollMultiplexer(const char *namePrefix, UInt32 idleTimeoutMse
     ESB_LOG_CRITICAL_ERRNO(ESB_OUT_OF_MEMORY, "[%s] cannot create %d epoll_events", name(), _maxSockets);
     return;
   }
-
-  error = _allocator.allocate(sizeof(struct DescriptorState) * _maxSockets, (void **)&_eventCache);
-  if (ESB_SUCCESS != error) {
-    close(_epollDescriptor);
-    _epollDescriptor = INVALID_SOCKET;
-    _allocator.deallocate(_events);
-    // _events will be checked in later functions
-    _events = NULL;
-    ESB_LOG_CRITICAL_ERRNO(ESB_OUT_OF_MEMORY, "[%s] cannot create %d DescriptorStates", name(), _maxSockets);
-    return;
-  }
-
-  memset(_eventCache, 0, sizeof(struct DescriptorState) * _maxSockets);
 }
 
 EpollMultiplexer::~EpollMultiplexer() {
@@ -128,11 +143,6 @@ EpollMultiplexer::~EpollMultiplexer() {
     _allocator.deallocate(_events);
     _events = NULL;
   }
-
-  if (_eventCache) {
-    _allocator.deallocate(_eventCache);
-    _eventCache = NULL;
-  }
 }
 
 CleanupHandler *EpollMultiplexer::cleanupHandler() { return NULL; }
@@ -155,20 +165,8 @@ Error EpollMultiplexer::addMultiplexedSocket(MultiplexedSocket *socket) {
 
   struct epoll_event event;
   memset(&event, 0, sizeof(event));
-  event.events = EPOLLERR | EPOLLET;
-
-  if (socket->wantAccept()) {
-    event.events |= EPOLLIN;
-  } else if (socket->wantConnect()) {
-    event.events |= EPOLLIN | EPOLLOUT | EPOLLHUP;
-  } else {
-    if (socket->wantWrite()) {
-      event.events |= EPOLLOUT | EPOLLHUP;
-    }
-    if (socket->wantRead()) {
-      event.events |= EPOLLIN | EPOLLHUP;
-    }
-  }
+  // Registered level-triggered, as every later EPOLL_CTL_MOD is, so the cached interests match what Interests() returns
+  event.events = Interests(socket);
 
   int currentSocketCount = _activeSocketCount.inc();
 
@@ -179,7 +177,7 @@ Error EpollMultiplexer::addMultiplexedSocket(MultiplexedSocket *socket) {
   }
 
   if (0 < _idleTimeoutMsec && !socket->permanent()) {
-    Error error = _timingWheel.insert(&socket->timer(), _idleTimeoutMsec, Time::Instance().now());
+    Error error = _timingWheel.insert(&socket->timer(), _idleTimeoutMsec, MonotonicTimeSource::Instance().now());
     if (ESB_SUCCESS != error) {
       ESB_LOG_ERROR_ERRNO(error, "[%s] cannot add socket to timing wheel", socket->name());
       _activeSocketCount.dec();
@@ -207,7 +205,7 @@ Error EpollMultiplexer::addMultiplexedSocket(MultiplexedSocket *socket) {
     return error;
   }
 
-  _eventCache[fd]._interests = event.events;
+  socket->setRegisteredInterests(event.events);
 
   ESB_LOG_DEBUG("[%s] added socket", socket->name());
   return ESB_SUCCESS;
@@ -229,36 +227,31 @@ Error EpollMultiplexer::updateMultiplexedSocket(MultiplexedSocket *socket) {
     return ESB_INVALID_ARGUMENT;
   }
 
-  struct epoll_event event;
-  memset(&event, 0, sizeof(event));
-  event.events = EPOLLERR;
+  const UInt32 interests = Interests(socket);
 
-  if (socket->wantAccept()) {
-    event.events |= EPOLLIN;
-  } else if (socket->wantConnect()) {
-    event.events |= EPOLLIN | EPOLLOUT | EPOLLHUP;
-  } else {
-    if (socket->wantWrite()) {
-      event.events |= EPOLLOUT | EPOLLHUP;
-    }
-    if (socket->wantRead()) {
-      event.events |= EPOLLIN | EPOLLHUP;
-    }
+  // Most handled events leave the socket's interests untouched, so only go to the kernel when they change.
+
+  if (socket->registeredInterests() == interests) {
+    ++_avoidedInterestUpdates;
+    return ESB_SUCCESS;
   }
 
+  struct epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = interests;
   event.data.ptr = socket;
 
-  if (_eventCache[fd]._interests != event.events) {
-    if (0 != epoll_ctl(_epollDescriptor, EPOLL_CTL_MOD, fd, &event)) {
-      Error error = LastError();
-      ESB_LOG_ERROR_ERRNO(error, "[%s] cannot update socket", socket->name());
-      return error;
-    }
-    _eventCache[fd]._interests = event.events;
-    ESB_LOG_DEBUG("[%s] updated socket. wantRead=%s, wantWrite=%s", socket->name(),
-                  socket->wantRead() ? "true" : "false", socket->wantWrite() ? "true" : "false");
+  if (0 != epoll_ctl(_epollDescriptor, EPOLL_CTL_MOD, fd, &event)) {
+    Error error = LastError();
+    ESB_LOG_ERROR_ERRNO(error, "[%s] cannot update socket", socket->name());
+    return error;
   }
 
+  ++_interestUpdates;
+  socket->setRegisteredInterests(interests);
+  ESB_LOG_DEBUG("[%s] updated socket. wantRead=%s, wantWrite=%s", socket->name(), socket->wantRead() ? "true" : "false",
+                socket->wantWrite() ? "true" : "false");
+
   return ESB_SUCCESS;
 }
 
@@ -284,7 +277,7 @@ Error EpollMultiplexer::removeMultiplexedSocket(MultiplexedSocket *socket) {
     return error;
   }
 
-  memset(&_eventCache[fd], 0, sizeof(struct DescriptorState));
+  socket->setRegisteredInterests(0);
 
   _activeSockets.remove(socket);
   assert(_activeSockets.validate());
@@ -311,6 +304,7 @@ void EpollMultiplexer::destroy() {
   }
 
   _timingWheel.clear();
+  _timers.clear();
   _deadSockets.clear();
   _activeSockets.clear();
 
@@ -328,11 +322,6 @@ void EpollMultiplexer::destroy() {
     _events = NULL;
   }
 
-  if (_eventCache) {
-    _allocator.deallocate(_eventCache);
-    _eventCache = NULL;
-  }
-
   ESB_LOG_DEBUG("[%s] destroyed", name());
 }
 
@@ -350,10 +339,25 @@ bool EpollMultiplexer::run(SharedInt *isRunning) {
   int errorCount = 0;
   _isRunning = isRunning;
 
+  // When the loop last woke up.  Every iteration reads the clock just before and just after waiting.
+  Date wakeup = MonotonicTimeSource::Instance().update();
+
   while (_isRunning->get()) {
     checkIdleSockets();
+    checkTimers();
+
+    const Date sleep = MonotonicTimeSource::Instance().read();
+    _counters.recordBusy(wakeup, sleep);
+
     int numEvents = epoll_wait(_epollDescriptor, _events, _maxSockets, MIN(_idleTimeoutMsec, 1000));
 
+    // Read the clock once per iteration.  Everything else on this thread uses the cached time.
+    wakeup = MonotonicTimeSource::Instance().update();
+
+    if (0 <= numEvents) {
+      _counters.recordWait(sleep, wakeup, numEvents);
+    }
+
     if (0 == numEvents) {
       // Timeout
       continue;
@@ -373,6 +377,7 @@ bool EpollMultiplexer::run(SharedInt *isRunning) {
         _events = NULL;
         close(_epollDescriptor);
         _epollDescriptor = INVALID_SOCKET;
+        MonotonicTimeSource::Instance().reset();
         return false;
       }
 
@@ -416,7 +421,7 @@ bool EpollMultiplexer::run(SharedInt *isRunning) {
       }
     }
 
-    Date now = Time::Instance().now();
+    Date now = MonotonicTimeSource::Instance().now();
 
     // Now take action
 
@@ -456,6 +461,7 @@ bool EpollMultiplexer::run(SharedInt *isRunning) {
           socket->handleError(error);
           keepInMultiplexer = false;
         } else if (_events[i].events & EPOLLIN) {
+          const Date start = MonotonicTimeSource::Instance().read();
           while (keepInMultiplexer) {
             ESB::Error error = socket->handleAccept();
             if (ESB_AGAIN == error) {
@@ -467,6 +473,7 @@ bool EpollMultiplexer::run(SharedInt *isRunning) {
               break;
             }
           }
+          _counters.recordAccept(start, MonotonicTimeSource::Instance().read(), socket->name());
         } else {
           ESB_LOG_WARNING("[%s] listening socket unknown event %d", socket->name(), _events[i].events);
         }
@@ -511,12 +518,16 @@ bool EpollMultiplexer::run(SharedInt *isRunning) {
             socket->handleRemoteClose();
           } else {
             ESB_LOG_INFO("[%s] socket connected", socket->name());
+            const Date start = MonotonicTimeSource::Instance().read();
             ESB::Error error = socket->handleConnect();
+            _counters.recordConnect(start, MonotonicTimeSource::Instance().read(), socket->name());
             keepInMultiplexer = ESB_AGAIN == error || ESB_PAUSE == error;
           }
         } else if (_events[i].events & EPOLLOUT) {
           ESB_LOG_INFO("[%s] socket connected", socket->name());
+          const Date start = MonotonicTimeSource::Instance().read();
           ESB::Error error = socket->handleConnect();
+          _counters.recordConnect(start, MonotonicTimeSource::Instance().read(), socket->name());
           keepInMultiplexer = ESB_AGAIN == error || ESB_PAUSE == error;
         } else {
           ESB_LOG_WARNING("[%s] connecting socket unknown event %d", socket->name(), _events[i].events);
@@ -553,14 +564,27 @@ bool EpollMultiplexer::run(SharedInt *isRunning) {
           socket->handleRemoteClose();
         } else {
           // TODO consider swapping these - drain first, then fill.
-          if (socket->wantRead() && (_events[i].events & EPOLLIN)) {
-            ESB::Error error = socket->handleReadable();
-            keepInMultiplexer = ESB_AGAIN == error || ESB_PAUSE == error;
+          if (_events[i].events & EPOLLIN) {
+            if (socket->wantRead()) {
+              const Date start = MonotonicTimeSource::Instance().read();
+              ESB::Error error = socket->handleReadable();
+              _counters.recordReadable(start, MonotonicTimeSource::Instance().read(), socket->name());
+              keepInMultiplexer = ESB_AGAIN == error || ESB_PAUSE == error;
+            } else {
+              _counters.countSpuriousReadable();
+            }
           }
 
-          if (keepInMultiplexer && socket->wantWrite() && (_events[i].events & EPOLLOUT)) {
-            ESB::Error error = socket->handleWritable();
-            keepInMultiplexer = ESB_AGAIN == error || ESB_PAUSE == error;
+          // A socket registered for writes that has nothing to send will keep waking the loop up
+          if (keepInMultiplexer && (_events[i].events & EPOLLOUT)) {
+            if (socket->wantWrite()) {
+              const Date start = MonotonicTimeSource::Instance().read();
+              ESB::Error error = socket->handleWritable();
+              _counters.recordWritable(start, MonotonicTimeSource::Instance().read(), socket->name());
+              keepInMultiplexer = ESB_AGAIN == error || ESB_PAUSE == error;
+            } else {
+              _counters.countSpuriousWritable();
+            }
           }
         }
       }
@@ -592,17 +616,24 @@ bool EpollMultiplexer::run(SharedInt *isRunning) {
       }
     }
 
-    for (MultiplexedSocket *socket = (MultiplexedSocket *)_deadSockets.removeFirst(); socket;
-         socket = (MultiplexedSocket *)_deadSockets.removeFirst()) {
-      CleanupHandler *cleanupHandler = socket->cleanupHandler();
-      if (cleanupHandler) {
-        cleanupHandler->destroy(socket);
+    if (!_deadSockets.isEmpty()) {
+      const Date start = MonotonicTimeSource::Instance().read();
+      for (MultiplexedSocket *socket = (MultiplexedSocket *)_deadSockets.removeFirst(); socket;
+           socket = (MultiplexedSocket *)_deadSockets.removeFirst()) {
+        CleanupHandler *cleanupHandler = socket->cleanupHandler();
+        if (cleanupHandler) {
+          cleanupHandler->destroy(socket);
+        }
       }
+      _counters.recordCleanup(start, MonotonicTimeSource::Instance().read());
     }
   }
 
-  ESB_LOG_NOTICE("[%s] multiplexer thread stopped", name());
+  ESB_LOG_NOTICE("[%s] multiplexer thread stopped, interest updates: %lu, avoided interest updates: %lu", name(),
+                 _interestUpdates, _avoidedInterestUpdates);
+  _counters.log(Logger::Instance(), Logger::Notice);
   destroy();
+  MonotonicTimeSource::Instance().reset();
   return false;
 }
 
@@ -612,8 +643,10 @@ int EpollMultiplexer::maximumSockets() const { return _maxSockets; }
 
 bool EpollMultiplexer::isRunning() const { return _isRunning && _isRunning->get(); }
 
+const EventLoopCounters *EpollMultiplexer::eventLoopCounters() const { return &_counters; }
+
 void EpollMultiplexer::checkIdleSockets() {
-  Date now = Time::Instance().now();
+  Date now = MonotonicTimeSource::Instance().now();
 
   for (Timer *timer = _timingWheel.nextExpired(now); timer; timer = _timingWheel.nextExpired(now)) {
     MultiplexedSocket *socket = (MultiplexedSocket *)timer->context();
@@ -627,6 +660,24 @@ void EpollMultiplexer::checkIdleSockets() {
   }
 }
 
+void EpollMultiplexer::checkTimers() {
+  Date now = MonotonicTimeSource::Instance().now();
+
+  for (Timer *timer = _timers.nextExpired(now); timer; timer = _timers.nextExpired(now)) {
+    timer->handleExpiration();
+  }
+}
+
+Error EpollMultiplexer::addTimer(Timer *timer, UInt32 delayMsec) {
+  return _timers.insert(timer, delayMsec, MonotonicTimeSource::Instance().now());
+}
+
+Error EpollMultiplexer::updateTimer(Timer *timer, UInt32 delayMsec) {
+  return _timers.update(timer, delayMsec, MonotonicTimeSource::Instance().now());
+}
+
+Error EpollMultiplexer::removeTimer(Timer *timer) { return _timers.remove(timer); }
+
 const char *EpollMultiplexer::name() const { return _namePrefix; }
 
 }  // namespace ESB
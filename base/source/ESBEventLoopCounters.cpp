@@ -0,0 +1,97 @@
+#ifndef ESB_EVENT_LOOP_COUNTERS_H
+#include <ESBEventLoopCounters.h>
+#endif
+
+#ifndef ESB_LOGGER_H
+#include <ESBLogger.h>
+#endif
+
+namespace ESB {
+
+EventLoopCounters::EventLoopCounters(const char *name)
+    : _name(name),
+      _wakeups(0U),
+      _events(0U),
+      _maxEvents(0U),
+      _spuriousReadable(0U),
+      _spuriousWritable(0U),
+      _stalls(0U),
+      _lagMicroSeconds(0U),
+      _wait("EVENT LOOP WAIT", 1U),
+      _busy("EVENT LOOP BUSY", 1U),
+      _accept("EVENT LOOP ACCEPT HANDLER", 1U),
+      _connect("EVENT LOOP CONNECT HANDLER", 1U),
+      _readable("EVENT LOOP READABLE HANDLER", 1U),
+      _writable("EVENT LOOP WRITABLE HANDLER", 1U),
+      _cleanup("EVENT LOOP CLEANUP", 1U) {}
+
+EventLoopCounters::~EventLoopCounters() {}
+
+void EventLoopCounters::recordWait(const Date &start, const Date &stop, UInt32 events) {
+  _wait.record(start, stop);
+  Increment(&_wakeups);
+
+  if (0U == events) {
+    return;
+  }
+
+  Increment(&_events, events);
+
+  if (events > _maxEvents) {
+    __atomic_store_n(&_maxEvents, events, __ATOMIC_RELAXED);
+  }
+}
+
+void EventLoopCounters::recordBusy(const Date &start, const Date &stop) {
+  _busy.record(start, stop);
+
+  UInt64 microSeconds = 0U;
+  if (start < stop) {
+    const Date diff(stop - start);
+    microSeconds = diff.seconds() * ESB_UINT64_C(1000000) + diff.microSeconds();
+  }
+
+  // Each batch moves the average 1/8th of the way, so it forgets a burst after a few dozen iterations
+  const UInt64 lag = __atomic_load_n(&_lagMicroSeconds, __ATOMIC_RELAXED);
+  __atomic_store_n(&_lagMicroSeconds, lag - lag / 8U + microSeconds / 8U, __ATOMIC_RELAXED);
+}
+
+void EventLoopCounters::recordHandler(HistogramPerformanceCounter &counter, const Date &start, const Date &stop,
+                                      const char *socketName) {
+  if (!(start < stop)) {
+    counter.record(0U);
+    return;
+  }
+
+  const Date diff(stop - start);
+  const UInt64 microSeconds = diff.seconds() * ESB_UINT64_C(1000000) + diff.microSeconds();
+  counter.record(microSeconds);
+
+  if (ESB_EVENT_LOOP_STALL_USEC < microSeconds) {
+    Increment(&_stalls);
+    ESB_LOG_WARNING("[%s] %s stalled the event loop for %lu msec", socketName, counter.name(),
+                    (unsigned long)(microSeconds / 1000U));
+  }
+}
+
+void EventLoopCounters::log(Logger &logger, Logger::Severity severity) const {
+  const UInt64 wakeups = this->wakeups();
+  const UInt64 events = this->events();
+
+  ESB_LOG(logger, severity,
+          "[%s] EVENT LOOP: WAKEUPS=%lu, EVENTS=%lu, MEAN EVENTS/WAKEUP=%.2lf, MAX EVENTS/WAKEUP=%lu, SPURIOUS "
+          "READABLE=%lu, SPURIOUS WRITABLE=%lu, STALLS=%lu",
+          _name, (unsigned long)wakeups, (unsigned long)events, 0U == wakeups ? 0.0 : events / (double)wakeups,
+          (unsigned long)maxEvents(), (unsigned long)spuriousReadable(), (unsigned long)spuriousWritable(),
+          (unsigned long)stalls());
+
+  _wait.log(logger, severity);
+  _busy.log(logger, severity);
+  _accept.log(logger, severity);
+  _connect.log(logger, severity);
+  _readable.log(logger, severity);
+  _writable.log(logger, severity);
+  _cleanup.log(logger, severity);
+}
+
+}  // namespace ESB
@@ -0,0 +1,239 @@
+#ifndef ESB_HIERARCHICAL_TIMING_WHEEL_H
+#include <ESBHierarchicalTimingWheel.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+namespace ESB {
+
+HierarchicalTimingWheel::HierarchicalTimingWheel(UInt32 ticks, UInt32 tickMilliSeconds, const Date &now,
+                                                 Allocator &allocator)
+    : _start(now),
+      _tickMilliSeconds(tickMilliSeconds),
+      _maxTicks(ticks),
+      _currentTick(0U),
+      _wheelTick(0U),
+      _allocator(allocator) {
+  memset(_occupied, 0, sizeof(_occupied));
+
+  Error error =
+      _allocator.allocate(ESB_TIMING_WHEEL_LEVELS * ESB_TIMING_WHEEL_SLOTS * sizeof(EmbeddedList), (void **)&_timers);
+  if (ESB_SUCCESS != error) {
+    // _timers will be checked in later functions
+    _timers = NULL;
+    return;
+  }
+
+  for (UInt32 i = 0; i < ESB_TIMING_WHEEL_LEVELS * ESB_TIMING_WHEEL_SLOTS; ++i) {
+    new (&_timers[i]) EmbeddedList();
+  }
+}
+
+HierarchicalTimingWheel::~HierarchicalTimingWheel() {
+  clear();
+
+  if (_timers) {
+    for (UInt32 i = 0; i < ESB_TIMING_WHEEL_LEVELS * ESB_TIMING_WHEEL_SLOTS; ++i) {
+      _timers[i].~EmbeddedList();
+    }
+    _allocator.deallocate(_timers);
+  }
+}
+
+void HierarchicalTimingWheel::clear() {
+  if (!_timers) {
+    return;
+  }
+
+  for (UInt32 i = 0; i < ESB_TIMING_WHEEL_LEVELS * ESB_TIMING_WHEEL_SLOTS; ++i) {
+    while (true) {
+      Timer *timer = (Timer *)_timers[i].removeFirst();
+      if (!timer) {
+        break;
+      }
+      timer->remove();
+      if (timer->cleanupHandler()) {
+        timer->cleanupHandler()->destroy(timer);
+      }
+    }
+  }
+
+  memset(_occupied, 0, sizeof(_occupied));
+}
+
+Error HierarchicalTimingWheel::insert(Timer *timer, UInt32 delayMilliSeconds, const Date &now) {
+  if (!timer) {
+    return ESB_NULL_POINTER;
+  }
+
+  if (!_timers) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  assert(!timer->inTimingWheel());
+  if (timer->inTimingWheel()) {
+    return ESB_INVALID_ARGUMENT;
+  }
+
+  UInt32 nowTick = ticks(now - _start);
+  UInt32 delayTicks = delayMilliSeconds / _tickMilliSeconds;
+
+  if (nowTick + delayTicks <= _currentTick) {
+    return ESB_UNDERFLOW;
+  }
+
+  if (nowTick + delayTicks >= _currentTick + _maxTicks) {
+    return ESB_OVERFLOW;
+  }
+
+  timer->setTick(nowTick + delayTicks);
+  add(timer);
+  return ESB_SUCCESS;
+}
+
+Error HierarchicalTimingWheel::remove(Timer *timer) {
+  if (!timer) {
+    return ESB_NULL_POINTER;
+  }
+
+  if (!timer->inTimingWheel()) {
+    return ESB_INVALID_ARGUMENT;
+  }
+
+  if (!_timers) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  unlink(timer);
+  timer->remove();
+  return ESB_SUCCESS;
+}
+
+Error HierarchicalTimingWheel::update(Timer *timer, UInt32 delayMilliSeconds, const Date &now) {
+  if (!timer) {
+    return ESB_NULL_POINTER;
+  }
+
+  if (!_timers) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  if (!timer->inTimingWheel()) {
+    return insert(timer, delayMilliSeconds, now);
+  }
+
+  UInt32 nowTick = ticks(now - _start);
+  UInt32 delayTicks = delayMilliSeconds / _tickMilliSeconds;
+
+  if (nowTick + delayTicks <= _currentTick) {
+    unlink(timer);
+    timer->remove();
+    return ESB_UNDERFLOW;
+  }
+
+  if (nowTick + delayTicks >= _currentTick + _maxTicks) {
+    return ESB_OVERFLOW;
+  }
+
+  if (nowTick + delayTicks == (UInt32)timer->tick()) {
+    return ESB_SUCCESS;
+  }
+
+  unlink(timer);
+  timer->setTick(nowTick + delayTicks);
+  add(timer);
+  return ESB_SUCCESS;
+}
+
+Timer *HierarchicalTimingWheel::nextExpired(const Date &now) {
+  if (!_timers) {
+    return NULL;
+  }
+
+  UInt32 nowTick = ticks(now - _start);
+  if (nowTick == _currentTick) {
+    return NULL;
+  }
+
+  while (true) {
+    // The lowest occupied level holds the next event: either expired timers (level 0) or a slot that must be
+    // redistributed to the levels below it because the wheel has reached it.
+    UInt32 level = 0;
+    UInt64 occupied = 0;
+    for (; level < ESB_TIMING_WHEEL_LEVELS; ++level) {
+      occupied = _occupied[level] & (~0ULL << Index(_wheelTick, level));
+      if (occupied) {
+        break;
+      }
+    }
+
+    if (ESB_TIMING_WHEEL_LEVELS == level) {
+      break;
+    }
+
+    const UInt32 index = __builtin_ctzll(occupied);
+    const UInt32 shift = level * ESB_TIMING_WHEEL_SLOT_BITS;
+    const UInt32 tick = (((_wheelTick >> shift) & ~(ESB_TIMING_WHEEL_SLOTS - 1)) | index) << shift;
+
+    if (tick > nowTick) {
+      break;
+    }
+
+    _wheelTick = tick;
+    EmbeddedList &slot = _timers[level * ESB_TIMING_WHEEL_SLOTS + index];
+
+    if (0 == level) {
+      Timer *timer = (Timer *)slot.removeFirst();
+      assert(timer);
+      if (slot.isEmpty()) {
+        _occupied[0] &= ~(1ULL << index);
+        _currentTick = tick;
+      }
+      timer->remove();
+      return timer;
+    }
+
+    _occupied[level] &= ~(1ULL << index);
+    for (Timer *timer = (Timer *)slot.removeFirst(); timer; timer = (Timer *)slot.removeFirst()) {
+      add(timer);
+    }
+  }
+
+  // Nothing else can expire before nowTick, so the slots can be laid out around it without redistributing any.
+  if (nowTick > _wheelTick) {
+    _wheelTick = nowTick;
+  }
+  _currentTick = nowTick;
+  return NULL;
+}
+
+UInt32 HierarchicalTimingWheel::level(UInt32 tick) const {
+  const UInt32 diff = tick ^ _wheelTick;
+  return diff ? (31 - __builtin_clz(diff)) / ESB_TIMING_WHEEL_SLOT_BITS : 0;
+}
+
+void HierarchicalTimingWheel::add(Timer *timer) {
+  // Timers that are already due wait in the current slot
+  const UInt32 tick = MAX((UInt32)timer->tick(), _wheelTick);
+  const UInt32 level = this->level(tick);
+  const UInt32 index = Index(tick, level);
+
+  _timers[level * ESB_TIMING_WHEEL_SLOTS + index].addLast(timer);
+  _occupied[level] |= 1ULL << index;
+}
+
+void HierarchicalTimingWheel::unlink(Timer *timer) {
+  const UInt32 tick = MAX((UInt32)timer->tick(), _wheelTick);
+  const UInt32 level = this->level(tick);
+  const UInt32 index = Index(tick, level);
+  EmbeddedList &slot = _timers[level * ESB_TIMING_WHEEL_SLOTS + index];
+
+  slot.remove(timer);
+  if (slot.isEmpty()) {
+    _occupied[level] &= ~(1ULL << index);
+  }
+}
+
+}  // namespace ESB
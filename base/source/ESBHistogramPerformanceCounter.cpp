@@ -0,0 +1,321 @@
+#ifndef ESB_HISTOGRAM_PERFORMANCE_COUNTER_H
+#include <ESBHistogramPerformanceCounter.h>
+#endif
+
+#ifndef ESB_SHARED_INT_H
+#include <ESBSharedInt.h>
+#endif
+
+#ifndef ESB_MONOTONIC_TIME_SOURCE_H
+#include <ESBMonotonicTimeSource.h>
+#endif
+
+namespace ESB {
+
+#ifdef HAVE_THREAD_LOCAL_STORAGE
+// 1 + the calling thread's position in the order threads first recorded into any histogram, or 0 if it never has
+static __thread UInt32 ThreadIndex = 0;
+#else
+#error "__thread or equivalent is required"
+#endif
+
+static SharedInt ThreadCount;
+
+static inline UInt64 MicroSeconds(const Date &date) {
+  return date.seconds() * ESB_UINT64_C(1000000) + date.microSeconds();
+}
+
+HistogramPerformanceCounter::HistogramPerformanceCounter(const char *name, UInt32 shards, Allocator &allocator)
+    : PerformanceCounter(),
+      _name(name),
+      _windowStart(),
+      _windowStop(),
+      _shardCount(MAX(1U, MIN(shards, ESB_HISTOGRAM_MAX_SHARDS))),
+      _firstRecordMicroSeconds(0U),
+      _allocator(allocator) {
+  memset(_shards, 0, sizeof(_shards));
+}
+
+HistogramPerformanceCounter::HistogramPerformanceCounter(const char *name, const Date &windowStart,
+                                                         const Date &windowStop, UInt32 shards, Allocator &allocator)
+    : PerformanceCounter(),
+      _name(name),
+      _windowStart(windowStart),
+      _windowStop(windowStop),
+      _shardCount(MAX(1U, MIN(shards, ESB_HISTOGRAM_MAX_SHARDS))),
+      _firstRecordMicroSeconds(0U),
+      _allocator(allocator) {
+  memset(_shards, 0, sizeof(_shards));
+}
+
+HistogramPerformanceCounter::~HistogramPerformanceCounter() {
+  for (UInt32 i = 0; i < _shardCount; ++i) {
+    if (_shards[i]) {
+      _allocator.deallocate(_shards[i]);
+      _shards[i] = NULL;
+    }
+  }
+}
+
+UInt32 HistogramPerformanceCounter::BucketIndex(UInt64 microSeconds) {
+  if (microSeconds > ESB_UINT32_MAX) {
+    microSeconds = ESB_UINT32_MAX;
+  }
+
+  if (microSeconds < 2 * ESB_HISTOGRAM_SUB_BUCKETS) {
+    return microSeconds;
+  }
+
+  // Each power of two range above 2 * ESB_HISTOGRAM_SUB_BUCKETS is split into ESB_HISTOGRAM_SUB_BUCKETS buckets
+  const UInt32 shift = 63 - __builtin_clzll(microSeconds) - ESB_HISTOGRAM_SUB_BUCKET_BITS;
+  return (shift + 1) * ESB_HISTOGRAM_SUB_BUCKETS + (microSeconds >> shift) - ESB_HISTOGRAM_SUB_BUCKETS;
+}
+
+UInt64 HistogramPerformanceCounter::BucketValue(UInt32 index) {
+  if (index < 2 * ESB_HISTOGRAM_SUB_BUCKETS) {
+    return index;
+  }
+
+  const UInt32 shift = index / ESB_HISTOGRAM_SUB_BUCKETS - 1;
+  const UInt64 subBucket = index % ESB_HISTOGRAM_SUB_BUCKETS + ESB_HISTOGRAM_SUB_BUCKETS;
+  return ((subBucket + 1) << shift) - 1;
+}
+
+void HistogramPerformanceCounter::record(const Date &start, const Date &stop) {
+  record(start < stop ? MicroSeconds(stop - start) : 0U);
+}
+
+void HistogramPerformanceCounter::record(UInt64 microSeconds) {
+  Shard *shard = this->shard();
+  if (!shard) {
+    return;
+  }
+
+  if (0 == __atomic_load_n(&_firstRecordMicroSeconds, __ATOMIC_RELAXED)) {
+    UInt64 expected = 0U;
+    __atomic_compare_exchange_n(&_firstRecordMicroSeconds, &expected,
+                                MicroSeconds(MonotonicTimeSource::Instance().now()), false, __ATOMIC_RELAXED,
+                                __ATOMIC_RELAXED);
+  }
+
+  if (microSeconds > ESB_UINT32_MAX) {
+    microSeconds = ESB_UINT32_MAX;
+  }
+
+  __atomic_add_fetch(&shard->_counts[BucketIndex(microSeconds)], 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&shard->_sumMicroSeconds, microSeconds, __ATOMIC_RELAXED);
+
+  for (UInt64 min = __atomic_load_n(&shard->_minMicroSeconds, __ATOMIC_RELAXED); microSeconds < min;) {
+    if (__atomic_compare_exchange_n(&shard->_minMicroSeconds, &min, microSeconds, true, __ATOMIC_RELAXED,
+                                    __ATOMIC_RELAXED)) {
+      break;
+    }
+  }
+
+  for (UInt64 max = __atomic_load_n(&shard->_maxMicroSeconds, __ATOMIC_RELAXED); microSeconds > max;) {
+    if (__atomic_compare_exchange_n(&shard->_maxMicroSeconds, &max, microSeconds, true, __ATOMIC_RELAXED,
+                                    __ATOMIC_RELAXED)) {
+      break;
+    }
+  }
+
+  // Incremented last so readers never see more queries than latencies
+  __atomic_add_fetch(&shard->_n, 1, __ATOMIC_RELEASE);
+}
+
+HistogramPerformanceCounter::Shard *HistogramPerformanceCounter::shard() {
+  if (0 == ThreadIndex) {
+    ThreadIndex = ThreadCount.inc();
+  }
+
+  Shard **slot = &_shards[(ThreadIndex - 1) % _shardCount];
+  Shard *shard = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+  if (shard) {
+    return shard;
+  }
+
+  Error error = _allocator.allocate(sizeof(Shard), (void **)&shard);
+  if (ESB_SUCCESS != error) {
+    return NULL;
+  }
+
+  memset(shard, 0, sizeof(Shard));
+  shard->_minMicroSeconds = ESB_UINT64_MAX;
+
+  Shard *expected = NULL;
+  if (__atomic_compare_exchange_n(slot, &expected, shard, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    return shard;
+  }
+
+  // Another thread sharing this slot installed its shard first
+  _allocator.deallocate(shard);
+  return expected;
+}
+
+void HistogramPerformanceCounter::merge(Summary *summary) const {
+  memset(summary, 0, sizeof(Summary));
+  summary->_minMicroSeconds = ESB_UINT64_MAX;
+
+  for (UInt32 i = 0; i < _shardCount; ++i) {
+    const Shard *shard = __atomic_load_n(&_shards[i], __ATOMIC_ACQUIRE);
+    if (!shard) {
+      continue;
+    }
+
+    const UInt64 n = __atomic_load_n(&shard->_n, __ATOMIC_ACQUIRE);
+    if (0 == n) {
+      continue;
+    }
+
+    summary->_n += n;
+    summary->_sumMicroSeconds += __atomic_load_n(&shard->_sumMicroSeconds, __ATOMIC_RELAXED);
+    const UInt64 min = __atomic_load_n(&shard->_minMicroSeconds, __ATOMIC_RELAXED);
+    const UInt64 max = __atomic_load_n(&shard->_maxMicroSeconds, __ATOMIC_RELAXED);
+    summary->_minMicroSeconds = MIN(summary->_minMicroSeconds, min);
+    summary->_maxMicroSeconds = MAX(summary->_maxMicroSeconds, max);
+
+    for (UInt32 j = 0; j < ESB_HISTOGRAM_BUCKETS; ++j) {
+      summary->_counts[j] += __atomic_load_n(&shard->_counts[j], __ATOMIC_RELAXED);
+    }
+  }
+
+  if (0 == summary->_n) {
+    summary->_minMicroSeconds = 0U;
+  }
+}
+
+double HistogramPerformanceCounter::Percentile(const Summary &summary, double percentile) {
+  if (0 == summary._n) {
+    return 0.0;
+  }
+
+  percentile = MAX(0.0, MIN(percentile, 100.0));
+  UInt64 target = (UInt64)(percentile / 100.0 * summary._n + 0.5);
+  if (0 == target) {
+    target = 1;
+  }
+
+  UInt64 seen = 0U;
+  for (UInt32 i = 0; i < ESB_HISTOGRAM_BUCKETS; ++i) {
+    seen += summary._counts[i];
+    if (seen >= target) {
+      return MAX(summary._minMicroSeconds, MIN(BucketValue(i), summary._maxMicroSeconds)) / 1000.0;
+    }
+  }
+
+  // Only reachable if a record races with the merge
+  return summary._maxMicroSeconds / 1000.0;
+}
+
+double HistogramPerformanceCounter::queriesPerSec(UInt64 queries) const {
+  if (0 == queries) {
+    return 0.0;
+  }
+
+  UInt64 windowMicroSeconds = 0U;
+
+  if (0 == _windowStop.seconds() && 0 == _windowStop.microSeconds()) {
+    const UInt64 now = MicroSeconds(MonotonicTimeSource::Instance().now());
+    const UInt64 first = __atomic_load_n(&_firstRecordMicroSeconds, __ATOMIC_RELAXED);
+    windowMicroSeconds = now > first ? now - first : 0U;
+  } else {
+    windowMicroSeconds = MicroSeconds(_windowStop - _windowStart);
+  }
+
+  if (0 == windowMicroSeconds) {
+    return 0.0;
+  }
+
+  return queries / (windowMicroSeconds / 1000000.0);
+}
+
+double HistogramPerformanceCounter::queriesPerSec() const { return queriesPerSec(queries()); }
+
+UInt32 HistogramPerformanceCounter::queries() const {
+  UInt64 queries = 0U;
+
+  for (UInt32 i = 0; i < _shardCount; ++i) {
+    const Shard *shard = __atomic_load_n(&_shards[i], __ATOMIC_ACQUIRE);
+    if (shard) {
+      queries += __atomic_load_n(&shard->_n, __ATOMIC_ACQUIRE);
+    }
+  }
+
+  return queries > ESB_UINT32_MAX ? ESB_UINT32_MAX : queries;
+}
+
+double HistogramPerformanceCounter::meanMSec() const {
+  UInt64 n = 0U;
+  UInt64 sum = 0U;
+
+  for (UInt32 i = 0; i < _shardCount; ++i) {
+    const Shard *shard = __atomic_load_n(&_shards[i], __ATOMIC_ACQUIRE);
+    if (shard) {
+      n += __atomic_load_n(&shard->_n, __ATOMIC_ACQUIRE);
+      sum += __atomic_load_n(&shard->_sumMicroSeconds, __ATOMIC_RELAXED);
+    }
+  }
+
+  return 0 == n ? 0.0 : sum / 1000.0 / n;
+}
+
+double HistogramPerformanceCounter::minMSec() const {
+  UInt64 min = ESB_UINT64_MAX;
+
+  for (UInt32 i = 0; i < _shardCount; ++i) {
+    const Shard *shard = __atomic_load_n(&_shards[i], __ATOMIC_ACQUIRE);
+    if (shard) {
+      min = MIN(min, __atomic_load_n(&shard->_minMicroSeconds, __ATOMIC_RELAXED));
+    }
+  }
+
+  return ESB_UINT64_MAX == min ? 0.0 : min / 1000.0;
+}
+
+double HistogramPerformanceCounter::maxMSec() const {
+  UInt64 max = 0U;
+
+  for (UInt32 i = 0; i < _shardCount; ++i) {
+    const Shard *shard = __atomic_load_n(&_shards[i], __ATOMIC_ACQUIRE);
+    if (shard) {
+      max = MAX(max, __atomic_load_n(&shard->_maxMicroSeconds, __ATOMIC_RELAXED));
+    }
+  }
+
+  return max / 1000.0;
+}
+
+double HistogramPerformanceCounter::percentileMSec(double percentile) const {
+  Summary summary;
+  merge(&summary);
+  return Percentile(summary, percentile);
+}
+
+void HistogramPerformanceCounter::snapshot(Snapshot *snapshot) const {
+  Summary summary;
+  merge(&summary);
+
+  snapshot->_queries = summary._n;
+  snapshot->_sumMSec = summary._sumMicroSeconds / 1000.0;
+  snapshot->_hasPercentiles = true;
+  snapshot->_p50MSec = Percentile(summary, 50.0);
+  snapshot->_p90MSec = Percentile(summary, 90.0);
+  snapshot->_p99MSec = Percentile(summary, 99.0);
+  snapshot->_p999MSec = Percentile(summary, 99.9);
+}
+
+void HistogramPerformanceCounter::log(Logger &logger, Logger::Severity severity) const {
+  Summary summary;
+  merge(&summary);
+
+  const double meanMSec = 0 == summary._n ? 0.0 : summary._sumMicroSeconds / 1000.0 / summary._n;
+
+  ESB_LOG(logger, severity,
+          "%s: QPS=%.2lf, N=%lu, LATENCY MSEC MEAN=%.2lf, MIN=%.2lf, P50=%.2lf, P90=%.2lf, P99=%.2lf, P99.9=%.2lf, "
+          "MAX=%.2lf",
+          _name, queriesPerSec(summary._n), (unsigned long)summary._n, meanMSec, summary._minMicroSeconds / 1000.0,
+          Percentile(summary, 50.0), Percentile(summary, 90.0), Percentile(summary, 99.0), Percentile(summary, 99.9),
+          summary._maxMicroSeconds / 1000.0);
+}
+
+}  // namespace ESB
@@ -0,0 +1,210 @@
+#ifndef ESB_KEYED_SLOT_COUNTER_H
+#include <ESBKeyedSlotCounter.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+namespace ESB {
+
+static UInt32 RoundUpToPowerOf2(UInt32 value) {
+  UInt32 power = 1U;
+  while (power < value && power < (1U << 31)) {
+    power <<= 1;
+  }
+  return power;
+}
+
+// A bijection, so distinct keys never share a hash.  Its low bits pick the key's entries.
+static UInt32 HashKey(UInt32 key) {
+  key ^= key >> 16;
+  key *= 0x85ebca6bU;
+  key ^= key >> 13;
+  key *= 0xc2b2ae35U;
+  key ^= key >> 16;
+  return key;
+}
+
+// Once the count reaches 0 the entry is free for any key, so it can change owners under us
+static void ReturnSlots(UInt64 *entry, UInt32 hash, UInt32 slots) {
+  UInt64 current = __atomic_load_n(entry, __ATOMIC_RELAXED);
+
+  while ((UInt32)(current >> 32) == hash && 0U < (UInt32)current) {
+    const UInt64 next = current - MIN((UInt32)current, slots);
+    if (__atomic_compare_exchange_n(entry, &current, next, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      return;
+    }
+  }
+}
+
+KeyedSlotCounter::KeyedSlotCounter(UInt32 limit, UInt32 maxKeys, Allocator &allocator)
+    : _limit(limit),
+      _size(MAX(RoundUpToPowerOf2(maxKeys), RoundUpToPowerOf2(ESB_KEYED_SLOT_COUNTER_PROBES))),
+      _untracked(0U),
+      _block(NULL),
+      _entries(NULL),
+      _allocator(allocator) {
+  const Size size = (Size)_size * sizeof(UInt64);
+
+  Error error = _allocator.allocate(size + ESB_CACHE_LINE_SIZE, (void **)&_block);
+  if (ESB_SUCCESS != error) {
+    // _entries will be checked in later functions
+    _block = NULL;
+    return;
+  }
+
+  // An entry of 0 is key hash 0 with nothing in use, which any key may take over
+  _entries = (UInt64 *)ESB_ALIGN((UWord)_block, ESB_CACHE_LINE_SIZE);
+  memset(_entries, 0, size);
+}
+
+KeyedSlotCounter::~KeyedSlotCounter() {
+  if (_block) {
+    _allocator.deallocate(_block);
+    _block = NULL;
+    _entries = NULL;
+  }
+}
+
+Error KeyedSlotCounter::acquire(UInt32 key, UInt32 slots, bool *tracked) {
+  if (!_entries) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  if (slots > _limit) {
+    return ESB_OVERFLOW;
+  }
+
+  if (tracked) {
+    *tracked = true;
+  }
+
+  const UInt32 hash = HashKey(key);
+
+  for (UInt32 attempt = 0; attempt < ESB_KEYED_SLOT_COUNTER_PROBES; ++attempt) {
+    UInt64 *entry = find(hash);
+
+    if (entry) {
+      UInt64 current = __atomic_load_n(entry, __ATOMIC_RELAXED);
+
+      while ((UInt32)(current >> 32) == hash) {
+        if ((UInt32)current + slots > _limit) {
+          return ESB_OVERFLOW;
+        }
+        if (__atomic_compare_exchange_n(entry, &current, current + slots, true, __ATOMIC_SEQ_CST,
+                                        __ATOMIC_RELAXED)) {
+          // Bringing an entry back from 0 races with other threads taking over a free entry for the key
+          if (0U < (UInt32)current || !duplicated(entry, hash)) {
+            return ESB_SUCCESS;
+          }
+          ReturnSlots(entry, hash, slots);
+          break;
+        }
+      }
+
+      // Another key took the entry over after its count dropped to 0, or the key is counted elsewhere
+      continue;
+    }
+
+    // Take over the first entry with nothing in use
+    const UInt32 start = hash & (_size - 1U);
+    bool busy = true;
+
+    for (UInt32 i = 0; i < ESB_KEYED_SLOT_COUNTER_PROBES; ++i) {
+      entry = _entries + ((start + i) & (_size - 1U));
+      UInt64 current = __atomic_load_n(entry, __ATOMIC_RELAXED);
+
+      if (0U == (UInt32)current) {
+        busy = false;
+        if (__atomic_compare_exchange_n(entry, &current, ((UInt64)hash << 32) | slots, false, __ATOMIC_SEQ_CST,
+                                        __ATOMIC_RELAXED)) {
+          if (!duplicated(entry, hash)) {
+            return ESB_SUCCESS;
+          }
+          // Another thread added this key to another entry at the same time, so join it
+          ReturnSlots(entry, hash, slots);
+        }
+        // Lost the race, perhaps to another thread adding this key, so look again
+        break;
+      }
+    }
+
+    if (busy) {
+      break;
+    }
+  }
+
+  __atomic_add_fetch(&_untracked, 1U, __ATOMIC_RELAXED);
+  if (tracked) {
+    *tracked = false;
+  }
+  return ESB_SUCCESS;
+}
+
+void KeyedSlotCounter::release(UInt32 key, UInt32 slots) {
+  if (!_entries || 0U == slots) {
+    return;
+  }
+
+  const UInt32 hash = HashKey(key);
+  UInt64 *entry = find(hash);
+  if (entry) {
+    ReturnSlots(entry, hash, slots);
+  }
+}
+
+UInt32 KeyedSlotCounter::inUse(UInt32 key) const {
+  if (!_entries) {
+    return 0U;
+  }
+
+  const UInt32 hash = HashKey(key);
+  const UInt64 *entry = find(hash);
+  if (!entry) {
+    return 0U;
+  }
+
+  const UInt64 current = __atomic_load_n(entry, __ATOMIC_RELAXED);
+  return (UInt32)(current >> 32) == hash ? (UInt32)current : 0U;
+}
+
+UInt64 *KeyedSlotCounter::find(UInt32 hash) const {
+  const UInt32 start = hash & (_size - 1U);
+  UInt64 *unused = NULL;
+
+  for (UInt32 i = 0; i < ESB_KEYED_SLOT_COUNTER_PROBES; ++i) {
+    UInt64 *entry = _entries + ((start + i) & (_size - 1U));
+    const UInt64 current = __atomic_load_n(entry, __ATOMIC_RELAXED);
+    if ((UInt32)(current >> 32) == hash) {
+      if (0U < (UInt32)current) {
+        return entry;
+      }
+      if (!unused) {
+        unused = entry;
+      }
+    }
+  }
+
+  return unused;
+}
+
+bool KeyedSlotCounter::duplicated(const UInt64 *entry, UInt32 hash) const {
+  const UInt32 start = hash & (_size - 1U);
+
+  for (UInt32 i = 0; i < ESB_KEYED_SLOT_COUNTER_PROBES; ++i) {
+    const UInt64 *other = _entries + ((start + i) & (_size - 1U));
+    if (other == entry) {
+      continue;
+    }
+    // Sequentially consistent, so of two threads that each just added the key, at least one sees the other
+    const UInt64 current = __atomic_load_n(other, __ATOMIC_SEQ_CST);
+    if ((UInt32)(current >> 32) == hash && 0U < (UInt32)current) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+}  // namespace ESB
@@ -0,0 +1,138 @@
+#ifndef ESB_LOG_DECODER_H
+#include <ESBLogDecoder.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#else
+#error "Need string.h or equivalent"
+#endif
+
+namespace ESB {
+
+LogDecoder::LogDecoder(Allocator &allocator)
+    : _allocator(allocator), _comparator(), _formats(_comparator, NullLock::Instance(), allocator) {}
+
+LogDecoder::~LogDecoder() { clear(); }
+
+void LogDecoder::clear() {
+  for (MapIterator it = _formats.minimumIterator(); !it.isNull(); it = it.next()) {
+    _allocator.deallocate(it.value());
+  }
+  _formats.clear();
+}
+
+Error LogDecoder::decode(FILE *input, FILE *output) {
+  if (!input || !output) {
+    return ESB_NULL_POINTER;
+  }
+
+#if !defined HAVE_FREAD || !defined HAVE_FWRITE || !defined HAVE_FERROR
+#error "fread, fwrite, and ferror or equivalent is required"
+#endif
+
+  bool first = true;
+
+  while (true) {
+    const Size bytes = fread(_record, 1, ESB_LOG_RECORD_HEADER_SIZE, input);
+    if (0 == bytes) {
+      return ferror(input) ? ESB_OTHER_ERROR : ESB_SUCCESS;
+    }
+
+    if (ESB_LOG_RECORD_HEADER_SIZE != bytes) {
+      return ESB_CANNOT_PARSE;
+    }
+
+    if (first && LogRecord::Header != LogRecord::RecordKind(_record)) {
+      return ESB_CANNOT_PARSE;
+    }
+    first = false;
+
+    const UInt32 size = LogRecord::RecordSize(_record);
+    if (ESB_LOG_RECORD_HEADER_SIZE > size) {
+      return ESB_CANNOT_PARSE;
+    }
+
+    const Size remaining = size - ESB_LOG_RECORD_HEADER_SIZE;
+    if (remaining != fread(_record + ESB_LOG_RECORD_HEADER_SIZE, 1, remaining, input)) {
+      return ESB_CANNOT_PARSE;
+    }
+
+    const Error error = decode(_record, output);
+    if (ESB_SUCCESS != error) {
+      return error;
+    }
+  }
+}
+
+Error LogDecoder::decode(const unsigned char *record, FILE *output) {
+  if (!record || !output) {
+    return ESB_NULL_POINTER;
+  }
+
+  UInt32 length = 0;
+
+  switch (LogRecord::RecordKind(record)) {
+    case LogRecord::Header:
+      // A new process reuses the addresses of the last one's format strings
+      clear();
+      return ESB_SUCCESS;
+    case LogRecord::Format: {
+      if (ESB_LOG_RECORD_HEADER_SIZE + sizeof(UInt64) > LogRecord::RecordSize(record)) {
+        return ESB_CANNOT_PARSE;
+      }
+      const char *format = LogRecord::FormatString(record, &length);
+      FormatEntry *entry = NULL;
+      Error error = _allocator.allocate(sizeof(FormatEntry) + length + 1, (void **)&entry);
+      if (ESB_SUCCESS != error) {
+        return error;
+      }
+      entry->_id = LogRecord::FormatId(record);
+      memcpy(entry->_format, format, length);
+      entry->_format[length] = 0;
+
+      // A redefined id replaces the old format string
+      MapIterator it = _formats.findIterator(entry);
+      if (!it.isNull()) {
+        void *old = it.value();
+        error = _formats.erase(&it);
+        if (ESB_SUCCESS != error) {
+          _allocator.deallocate(entry);
+          return error;
+        }
+        _allocator.deallocate(old);
+      }
+
+      error = _formats.insert(entry, entry);
+      if (ESB_SUCCESS != error) {
+        _allocator.deallocate(entry);
+      }
+      return error;
+    }
+    case LogRecord::Arguments: {
+      if (ESB_LOG_RECORD_HEADER_SIZE + sizeof(UInt64) > LogRecord::RecordSize(record)) {
+        return ESB_CANNOT_PARSE;
+      }
+      const UInt64 id = LogRecord::FormatId(record);
+      const FormatEntry *entry = (const FormatEntry *)_formats.find(&id);
+      if (!entry) {
+        return ESB_CANNOT_FIND;
+      }
+      const int result = LogRecord::Render(_text, sizeof(_text), entry->_format, record);
+      if (0 > result) {
+        return ESB_CANNOT_PARSE;
+      }
+      fwrite(_text, 1, result, output);
+      return ESB_SUCCESS;
+    }
+    case LogRecord::Text: {
+      const char *text = LogRecord::TextString(record, &length);
+      fwrite(text, 1, length, output);
+      return ESB_SUCCESS;
+    }
+    default:
+      return ESB_CANNOT_PARSE;
+  }
+}
+
+}  // namespace ESB
@@ -0,0 +1,49 @@
+#ifndef ESB_LOG_DECODER_H
+#include <ESBLogDecoder.h>
+#endif
+
+#ifndef ESB_ERROR_H
+#include <ESBError.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+
+// Formats the LogRecords written by an AsyncFileLogger in BINARY output mode.  Usage: log-decoder [file]
+
+int main(int argc, char **argv) {
+  if (2 < argc || (2 == argc && 0 == strcmp("-h", argv[1]))) {
+    fprintf(stderr, "usage: %s [file]\n", argv[0]);
+    return ESB_INVALID_ARGUMENT;
+  }
+
+  FILE *input = stdin;
+  if (2 == argc && 0 != strcmp("-", argv[1])) {
+    input = fopen(argv[1], "rb");
+    if (!input) {
+      fprintf(stderr, "Cannot open %s: %s\n", argv[1], strerror(errno));
+      return ESB_OTHER_ERROR;
+    }
+  }
+
+  ESB::LogDecoder decoder;
+  ESB::Error error = decoder.decode(input, stdout);
+  fflush(stdout);
+
+  if (ESB_SUCCESS != error) {
+    char buffer[100];
+    ESB::DescribeError(error, buffer, sizeof(buffer));
+    fprintf(stderr, "Cannot decode %s: %s\n", 2 == argc ? argv[1] : "stdin", buffer);
+  }
+
+  if (stdin != input) {
+    fclose(input);
+  }
+
+  return error;
+}
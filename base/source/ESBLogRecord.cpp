@@ -0,0 +1,562 @@
+#ifndef ESB_LOG_RECORD_H
+#include <ESBLogRecord.h>
+#endif
+
+#ifdef HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
+#ifdef HAVE_STDDEF_H
+#include <stddef.h>
+#endif
+
+#ifdef HAVE_STDINT_H
+#include <stdint.h>
+#endif
+
+#define ESB_LOG_RECORD_MAGIC "ESBLG1"
+#define ESB_LOG_RECORD_MAX_SPEC 32
+
+namespace ESB {
+
+// One printf conversion specification, e.g. "%-*.3lu"
+class LogSpecification {
+ public:
+  typedef enum {
+    NoLength,
+    CharLength,
+    ShortLength,
+    LongLength,
+    LongLongLength,
+    SizeLength,
+    MaxLength,
+    PtrDiffLength,
+    LongDoubleLength
+  } LengthModifier;
+
+  LogSpecification()
+      : _flags(NULL),
+        _flagsLength(0),
+        _width(NULL),
+        _widthLength(0),
+        _precision(NULL),
+        _precisionLength(0),
+        _starWidth(false),
+        _starPrecision(false),
+        _length(NoLength),
+        _conversion(0) {}
+
+  // Parse the specification after a '%' and return the character following it
+  const char *parse(const char *p) {
+    _flags = p;
+    while ('-' == *p || '+' == *p || ' ' == *p || '#' == *p || '0' == *p || '\'' == *p) {
+      ++p;
+    }
+    _flagsLength = p - _flags;
+
+    if ('*' == *p) {
+      _starWidth = true;
+      ++p;
+    } else {
+      _width = p;
+      while ('0' <= *p && '9' >= *p) {
+        ++p;
+      }
+      _widthLength = p - _width;
+    }
+
+    if ('.' == *p) {
+      ++p;
+      if ('*' == *p) {
+        _starPrecision = true;
+        ++p;
+      } else {
+        _precision = p;
+        while ('0' <= *p && '9' >= *p) {
+          ++p;
+        }
+        _precisionLength = p - _precision;
+      }
+    }
+
+    switch (*p) {
+      case 'h':
+        ++p;
+        _length = 'h' == *p ? (++p, CharLength) : ShortLength;
+        break;
+      case 'l':
+        ++p;
+        _length = 'l' == *p ? (++p, LongLongLength) : LongLength;
+        break;
+      case 'q':
+        ++p;
+        _length = LongLongLength;
+        break;
+      case 'z':
+        ++p;
+        _length = SizeLength;
+        break;
+      case 'j':
+        ++p;
+        _length = MaxLength;
+        break;
+      case 't':
+        ++p;
+        _length = PtrDiffLength;
+        break;
+      case 'L':
+        ++p;
+        _length = LongDoubleLength;
+        break;
+      default:
+        break;
+    }
+
+    _conversion = *p;
+    return *p ? p + 1 : p;
+  }
+
+  // -1 if there is no precision or it comes from an argument
+  int staticPrecision() const {
+    if (!_precision) {
+      return -1;
+    }
+    int precision = 0;
+    for (UInt32 i = 0; i < _precisionLength; ++i) {
+      precision = precision * 10 + _precision[i] - '0';
+    }
+    return precision;
+  }
+
+  // Rewrite the specification with arguments for '*' and the given length modifier
+  bool render(char *spec, UInt32 size, int width, int precision, const char *length) const {
+    UInt32 used = 0;
+    spec[used++] = '%';
+    if (used + _flagsLength >= size) {
+      return false;
+    }
+    memcpy(spec + used, _flags, _flagsLength);
+    used += _flagsLength;
+
+    int result = 0;
+    if (_starWidth) {
+      result = snprintf(spec + used, size - used, "%d", width);
+    } else if (_widthLength) {
+      result = snprintf(spec + used, size - used, "%.*s", (int)_widthLength, _width);
+    }
+    if (0 > result || (UInt32)result >= size - used) {
+      return false;
+    }
+    used += result;
+
+    result = 0;
+    if (_starPrecision) {
+      // A negative precision is taken as if it were omitted
+      result = 0 > precision ? 0 : snprintf(spec + used, size - used, ".%d", precision);
+    } else if (_precision) {
+      result = snprintf(spec + used, size - used, ".%.*s", (int)_precisionLength, _precision);
+    }
+    if (0 > result || (UInt32)result >= size - used) {
+      return false;
+    }
+    used += result;
+
+    result = snprintf(spec + used, size - used, "%s%c", length, _conversion);
+    return 0 <= result && (UInt32)result < size - used;
+  }
+
+  inline bool starWidth() const { return _starWidth; }
+  inline bool starPrecision() const { return _starPrecision; }
+  inline LengthModifier length() const { return _length; }
+  inline char conversion() const { return _conversion; }
+
+ private:
+  const char *_flags;
+  UInt32 _flagsLength;
+  const char *_width;
+  UInt32 _widthLength;
+  const char *_precision;
+  UInt32 _precisionLength;
+  bool _starWidth;
+  bool _starPrecision;
+  LengthModifier _length;
+  char _conversion;
+};
+
+// Appends arguments to a record being encoded
+class LogRecordWriter {
+ public:
+  LogRecordWriter(unsigned char *record, UInt32 capacity, UInt32 used)
+      : _record(record), _capacity(capacity), _used(used) {}
+
+  inline bool put(const void *value, UInt32 size) {
+    if (_used + size > _capacity) {
+      return false;
+    }
+    memcpy(_record + _used, value, size);
+    _used += size;
+    return true;
+  }
+
+  inline bool putUInt64(UInt64 value) { return put(&value, sizeof(value)); }
+
+  inline bool putInt64(Int64 value) { return put(&value, sizeof(value)); }
+
+  inline bool putDouble(double value) { return put(&value, sizeof(value)); }
+
+  bool putString(const char *value, int precision) {
+    if (!value) {
+      value = "(null)";
+    }
+    UInt32 length = 0;
+    if (0 > precision) {
+      length = strlen(value);
+    } else {
+      while (length < (UInt32)precision && value[length]) {
+        ++length;
+      }
+    }
+    if (ESB_UINT16_MAX <= length) {
+      return false;
+    }
+    const UInt16 size = length;
+    const char terminator = 0;
+    return put(&size, sizeof(size)) && put(value, length) && put(&terminator, 1);
+  }
+
+  inline UInt32 used() const { return _used; }
+
+ private:
+  unsigned char *_record;
+  const UInt32 _capacity;
+  UInt32 _used;
+};
+
+// Reads arguments from an encoded record
+class LogRecordReader {
+ public:
+  LogRecordReader(const unsigned char *record, UInt32 size, UInt32 used) : _record(record), _size(size), _used(used) {}
+
+  inline bool get(void *value, UInt32 size) {
+    if (_used + size > _size) {
+      return false;
+    }
+    memcpy(value, _record + _used, size);
+    _used += size;
+    return true;
+  }
+
+  bool getString(const char **value) {
+    UInt16 length = 0;
+    if (!get(&length, sizeof(length)) || _used + length + 1 > _size || 0 != _record[_used + length]) {
+      return false;
+    }
+    *value = (const char *)_record + _used;
+    _used += length + 1;
+    return true;
+  }
+
+ private:
+  const unsigned char *_record;
+  const UInt32 _size;
+  UInt32 _used;
+};
+
+static void WriteHeader(unsigned char *record, LogRecord::Kind kind, UInt32 size) {
+  const UInt16 size16 = size;
+  record[0] = kind;
+  memcpy(record + 1, &size16, sizeof(size16));
+}
+
+UInt32 LogRecord::EncodeHeader(unsigned char *record, UInt32 capacity) {
+  const UInt32 size = ESB_LOG_RECORD_HEADER_SIZE + sizeof(ESB_LOG_RECORD_MAGIC) - 1;
+  if (!record || size > capacity) {
+    return 0;
+  }
+  WriteHeader(record, Header, size);
+  memcpy(record + ESB_LOG_RECORD_HEADER_SIZE, ESB_LOG_RECORD_MAGIC, sizeof(ESB_LOG_RECORD_MAGIC) - 1);
+  return size;
+}
+
+UInt32 LogRecord::EncodeFormat(unsigned char *record, UInt32 capacity, const char *format) {
+  if (!record || !format) {
+    return 0;
+  }
+  const UInt32 length = strlen(format);
+  const UInt32 size = ESB_LOG_RECORD_HEADER_SIZE + sizeof(UInt64) + length;
+  if (size > capacity || ESB_LOG_RECORD_MAX_SIZE < size) {
+    return 0;
+  }
+  const UInt64 id = (UWord)format;
+  WriteHeader(record, Format, size);
+  memcpy(record + ESB_LOG_RECORD_HEADER_SIZE, &id, sizeof(id));
+  memcpy(record + ESB_LOG_RECORD_HEADER_SIZE + sizeof(id), format, length);
+  return size;
+}
+
+UInt32 LogRecord::EncodeArguments(unsigned char *record, UInt32 capacity, const char *format, va_list args) {
+  if (!record || !format) {
+    return 0;
+  }
+
+  LogRecordWriter writer(record, MIN(capacity, ESB_LOG_RECORD_MAX_SIZE), ESB_LOG_RECORD_HEADER_SIZE);
+  if (!writer.putUInt64((UWord)format)) {
+    return 0;
+  }
+
+  for (const char *p = format; *p;) {
+    if ('%' != *p++) {
+      continue;
+    }
+    if ('%' == *p) {
+      ++p;
+      continue;
+    }
+
+    LogSpecification spec;
+    p = spec.parse(p);
+
+    if (spec.starWidth() && !writer.putInt64(va_arg(args, int))) {
+      return 0;
+    }
+
+    int precision = spec.staticPrecision();
+    if (spec.starPrecision()) {
+      precision = va_arg(args, int);
+      if (!writer.putInt64(precision)) {
+        return 0;
+      }
+    }
+
+    bool success = false;
+
+    switch (spec.conversion()) {
+      case 'd':
+      case 'i':
+        switch (spec.length()) {
+          case LogSpecification::NoLength:
+          case LogSpecification::CharLength:
+          case LogSpecification::ShortLength:
+            success = writer.putInt64(va_arg(args, int));
+            break;
+          case LogSpecification::LongLength:
+            success = writer.putInt64(va_arg(args, long));
+            break;
+          case LogSpecification::LongLongLength:
+            success = writer.putInt64(va_arg(args, long long));
+            break;
+          case LogSpecification::SizeLength:
+            success = writer.putInt64(va_arg(args, SSize));
+            break;
+          case LogSpecification::MaxLength:
+            success = writer.putInt64(va_arg(args, intmax_t));
+            break;
+          case LogSpecification::PtrDiffLength:
+            success = writer.putInt64(va_arg(args, ptrdiff_t));
+            break;
+          default:
+            break;
+        }
+        break;
+      case 'u':
+      case 'o':
+      case 'x':
+      case 'X':
+        switch (spec.length()) {
+          case LogSpecification::NoLength:
+          case LogSpecification::CharLength:
+          case LogSpecification::ShortLength:
+            success = writer.putUInt64(va_arg(args, unsigned int));
+            break;
+          case LogSpecification::LongLength:
+            success = writer.putUInt64(va_arg(args, unsigned long));
+            break;
+          case LogSpecification::LongLongLength:
+            success = writer.putUInt64(va_arg(args, unsigned long long));
+            break;
+          case LogSpecification::SizeLength:
+            success = writer.putUInt64(va_arg(args, size_t));
+            break;
+          case LogSpecification::MaxLength:
+            success = writer.putUInt64(va_arg(args, uintmax_t));
+            break;
+          case LogSpecification::PtrDiffLength:
+            success = writer.putUInt64(va_arg(args, ptrdiff_t));
+            break;
+          default:
+            break;
+        }
+        break;
+      case 'c':
+        success = LogSpecification::NoLength == spec.length() && writer.putInt64(va_arg(args, int));
+        break;
+      case 'e':
+      case 'E':
+      case 'f':
+      case 'F':
+      case 'g':
+      case 'G':
+      case 'a':
+      case 'A':
+        success = LogSpecification::LongDoubleLength != spec.length() && writer.putDouble(va_arg(args, double));
+        break;
+      case 's':
+        success =
+            LogSpecification::NoLength == spec.length() && writer.putString(va_arg(args, const char *), precision);
+        break;
+      case 'p':
+        success = writer.putUInt64((UWord)va_arg(args, void *));
+        break;
+      default:
+        // %n, %m, wide characters, and anything else
+        break;
+    }
+
+    if (!success) {
+      return 0;
+    }
+  }
+
+  WriteHeader(record, Arguments, writer.used());
+  return writer.used();
+}
+
+UInt32 LogRecord::EncodeText(unsigned char *record, UInt32 capacity, const char *text, UInt32 length) {
+  if (!record || !text || ESB_LOG_RECORD_HEADER_SIZE > capacity) {
+    return 0;
+  }
+  length = MIN(length, MIN(capacity, ESB_LOG_RECORD_MAX_SIZE) - ESB_LOG_RECORD_HEADER_SIZE);
+  WriteHeader(record, Text, ESB_LOG_RECORD_HEADER_SIZE + length);
+  memcpy(record + ESB_LOG_RECORD_HEADER_SIZE, text, length);
+  return ESB_LOG_RECORD_HEADER_SIZE + length;
+}
+
+int LogRecord::Render(char *buffer, UInt32 capacity, const char *format, const unsigned char *record) {
+  if (!buffer || 0 == capacity || !format || !record || Arguments != RecordKind(record)) {
+    return -1;
+  }
+
+  LogRecordReader reader(record, RecordSize(record), ESB_LOG_RECORD_HEADER_SIZE + sizeof(UInt64));
+  UInt32 used = 0;
+  buffer[0] = 0;
+
+  for (const char *p = format; *p;) {
+    if ('%' != *p || '%' == p[1]) {
+      if (used + 1 < capacity) {
+        buffer[used++] = *p;
+      }
+      p += '%' == *p ? 2 : 1;
+      continue;
+    }
+
+    LogSpecification spec;
+    p = spec.parse(p + 1);
+
+    Int64 width = 0;
+    Int64 precision = -1;
+    if ((spec.starWidth() && !reader.get(&width, sizeof(width))) ||
+        (spec.starPrecision() && !reader.get(&precision, sizeof(precision)))) {
+      return -1;
+    }
+
+    char specification[ESB_LOG_RECORD_MAX_SPEC];
+    char *out = buffer + used;
+    const UInt32 available = capacity - used;
+    int result = 0;
+
+    switch (spec.conversion()) {
+      case 'd':
+      case 'i': {
+        Int64 value = 0;
+        if (!reader.get(&value, sizeof(value)) ||
+            !spec.render(specification, sizeof(specification), width, precision, "ll")) {
+          return -1;
+        }
+        if (LogSpecification::CharLength == spec.length()) {
+          value = (signed char)value;
+        } else if (LogSpecification::ShortLength == spec.length()) {
+          value = (short)value;
+        }
+        result = snprintf(out, available, specification, (long long)value);
+        break;
+      }
+      case 'u':
+      case 'o':
+      case 'x':
+      case 'X': {
+        UInt64 value = 0;
+        if (!reader.get(&value, sizeof(value)) ||
+            !spec.render(specification, sizeof(specification), width, precision, "ll")) {
+          return -1;
+        }
+        if (LogSpecification::CharLength == spec.length()) {
+          value = (unsigned char)value;
+        } else if (LogSpecification::ShortLength == spec.length()) {
+          value = (unsigned short)value;
+        }
+        result = snprintf(out, available, specification, (unsigned long long)value);
+        break;
+      }
+      case 'c': {
+        Int64 value = 0;
+        if (!reader.get(&value, sizeof(value)) ||
+            !spec.render(specification, sizeof(specification), width, precision, "")) {
+          return -1;
+        }
+        result = snprintf(out, available, specification, (int)value);
+        break;
+      }
+      case 'e':
+      case 'E':
+      case 'f':
+      case 'F':
+      case 'g':
+      case 'G':
+      case 'a':
+      case 'A': {
+        double value = 0;
+        if (!reader.get(&value, sizeof(value)) ||
+            !spec.render(specification, sizeof(specification), width, precision, "")) {
+          return -1;
+        }
+        result = snprintf(out, available, specification, value);
+        break;
+      }
+      case 's': {
+        const char *value = NULL;
+        if (!reader.getString(&value) || !spec.render(specification, sizeof(specification), width, precision, "")) {
+          return -1;
+        }
+        result = snprintf(out, available, specification, value);
+        break;
+      }
+      case 'p': {
+        UInt64 value = 0;
+        if (!reader.get(&value, sizeof(value)) ||
+            !spec.render(specification, sizeof(specification), width, precision, "")) {
+          return -1;
+        }
+        result = snprintf(out, available, specification, (void *)(UWord)value);
+        break;
+      }
+      default:
+        return -1;
+    }
+
+    if (0 > result) {
+      return -1;
+    }
+    used += MIN((UInt32)result, available - 1);
+  }
+
+  buffer[used] = 0;
+  return used;
+}
+
+int LogRecord::IdComparator::compare(const void *first, const void *second) const {
+  const UInt64 a = *(const UInt64 *)first;
+  const UInt64 b = *(const UInt64 *)second;
+  return a < b ? -1 : (a > b ? 1 : 0);
+}
+
+}  // namespace ESB
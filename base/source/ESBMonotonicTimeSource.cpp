@@ -0,0 +1,62 @@
+#ifndef ESB_MONOTONIC_TIME_SOURCE_H
+#include <ESBMonotonicTimeSource.h>
+#endif
+
+#ifndef ESB_SYSTEM_TIME_SOURCE_H
+#include <ESBSystemTimeSource.h>
+#endif
+
+#ifdef HAVE_TIME_H
+#include <time.h>
+#endif
+
+namespace ESB {
+
+#ifdef HAVE_THREAD_LOCAL_STORAGE
+// The time in microseconds that the calling thread last cached, or 0 if it does not cache the time
+static __thread UInt64 CachedMicroSeconds = 0;
+#else
+#error "__thread or equivalent is required"
+#endif
+
+static inline Date ToDate(UInt64 microSeconds) {
+  return Date((UInt32)(microSeconds / ESB_UINT64_C(1000000)), (UInt32)(microSeconds % ESB_UINT64_C(1000000)));
+}
+
+static inline UInt64 WallClockMicroSeconds() {
+  const Date now = SystemTimeSource::Now();
+  return now.seconds() * ESB_UINT64_C(1000000) + now.microSeconds();
+}
+
+MonotonicTimeSource MonotonicTimeSource::_Instance;
+
+MonotonicTimeSource::MonotonicTimeSource() : _basis(WallClockMicroSeconds() - MonotonicMicroSeconds()) {}
+
+MonotonicTimeSource::~MonotonicTimeSource() {}
+
+Date MonotonicTimeSource::now() {
+  const UInt64 cached = CachedMicroSeconds;
+  return ToDate(cached ? cached : _basis + MonotonicMicroSeconds());
+}
+
+Date MonotonicTimeSource::update() {
+  CachedMicroSeconds = _basis + MonotonicMicroSeconds();
+  return ToDate(CachedMicroSeconds);
+}
+
+void MonotonicTimeSource::reset() { CachedMicroSeconds = 0; }
+
+Date MonotonicTimeSource::read() const { return ToDate(_basis + MonotonicMicroSeconds()); }
+
+UInt64 MonotonicTimeSource::MonotonicMicroSeconds() {
+#if defined HAVE_CLOCK_GETTIME && defined HAVE_CLOCK_MONOTONIC && defined HAVE_TIMESPEC_T
+  // Served from the vDSO on Linux, so this does not enter the kernel
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * ESB_UINT64_C(1000000) + ts.tv_nsec / 1000;
+#else
+#error "clock_gettime(CLOCK_MONOTONIC) or equivalent is required"
+#endif
+}
+
+}  // namespace ESB
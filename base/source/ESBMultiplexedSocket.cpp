@@ -3,6 +3,6 @@
 #endif
 
 namespace ESB {
-MultiplexedSocket::MultiplexedSocket() : _timer(this) {}
+MultiplexedSocket::MultiplexedSocket() : _timer(this), _registeredInterests(0), _registration(0) {}
 MultiplexedSocket::~MultiplexedSocket() {}
 }  // namespace ESB
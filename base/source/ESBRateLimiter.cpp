@@ -0,0 +1,196 @@
+#ifndef ESB_RATE_LIMITER_H
+#include <ESBRateLimiter.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+namespace ESB {
+
+static UInt32 RoundUpToPowerOf2(UInt32 value) {
+  UInt32 power = 1U;
+  while (power < value && power < (1U << 31)) {
+    power <<= 1;
+  }
+  return power;
+}
+
+// A bijection, so distinct keys never share a hash.  0 marks an unused slot, so the key that hashes to 0 shares a
+// slot with the one that hashes to 1.
+static UInt64 HashKey(UInt64 key) {
+  key ^= key >> 30;
+  key *= ESB_UINT64_C(0xbf58476d1ce4e5b9);
+  key ^= key >> 27;
+  key *= ESB_UINT64_C(0x94d049bb133111eb);
+  key ^= key >> 31;
+  return key ? key : 1U;
+}
+
+RateLimiter::RateLimiter(UInt32 limit, UInt64 windowMicroSeconds, UInt32 maxKeys, UInt32 shards, Allocator &allocator)
+    : _limit(limit),
+      _intervalNanoSeconds(0U == limit ? 1U : MAX(windowMicroSeconds * 1000U / limit, 1U)),
+      _windowNanoSeconds(windowMicroSeconds * 1000U),
+      _shardCount(RoundUpToPowerOf2(MAX(shards, 1U))),
+      _shardSize(MAX(RoundUpToPowerOf2(maxKeys) / _shardCount, RoundUpToPowerOf2(ESB_RATE_LIMITER_PROBES))),
+      _shardHeaderSize(ESB_ALIGN(sizeof(Shard), ESB_CACHE_LINE_SIZE)),
+      _block(NULL),
+      _shards(NULL),
+      _slots(NULL),
+      _allocator(allocator) {
+  // Shard headers are cache line aligned so evicting threads do not contend for each other's lines, and the slots
+  // follow them so a probe sequence spans as few lines as possible.
+  const Size headersSize = _shardCount * _shardHeaderSize;
+  const Size slotsSize = (Size)_shardCount * _shardSize * sizeof(Slot);
+
+  Error error = _allocator.allocate(headersSize + slotsSize + ESB_CACHE_LINE_SIZE, (void **)&_block);
+  if (ESB_SUCCESS != error) {
+    // _slots will be checked in later functions
+    _block = NULL;
+    return;
+  }
+
+  _shards = (unsigned char *)ESB_ALIGN((UWord)_block, ESB_CACHE_LINE_SIZE);
+  _slots = (Slot *)(_shards + headersSize);
+  memset(_shards, 0, headersSize + slotsSize);
+}
+
+RateLimiter::~RateLimiter() {
+  if (_block) {
+    _allocator.deallocate(_block);
+    _block = NULL;
+    _shards = NULL;
+    _slots = NULL;
+  }
+}
+
+Error RateLimiter::acquire(UInt64 key, UInt32 tokens, const Date &now) {
+  if (!_slots) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  if (tokens > _limit) {
+    return ESB_OVERFLOW;
+  }
+
+  const UInt64 nowNanoSeconds = (UInt64)now.seconds() * ESB_UINT64_C(1000000000) + now.microSeconds() * 1000U;
+  Slot *slot = find(HashKey(key), nowNanoSeconds);
+
+  if (!slot) {
+    // Every candidate slot changed under us several times.  Rather than spin, let this one through.
+    return ESB_SUCCESS;
+  }
+
+  const UInt64 cost = _intervalNanoSeconds * tokens;
+  UInt64 state = __atomic_load_n(&slot->_state, __ATOMIC_RELAXED);
+
+  while (true) {
+    UInt64 full = state >> 1;
+    if (full < nowNanoSeconds) {
+      full = nowNanoSeconds;
+    }
+
+    const UInt64 next = full + cost;
+
+    if (next - nowNanoSeconds > _windowNanoSeconds) {
+      if (!(state & 1U)) {
+        __atomic_compare_exchange_n(&slot->_state, &state, state | 1U, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+      }
+      return ESB_OVERFLOW;
+    }
+
+    if (__atomic_compare_exchange_n(&slot->_state, &state, (next << 1) | 1U, true, __ATOMIC_RELAXED,
+                                    __ATOMIC_RELAXED)) {
+      return ESB_SUCCESS;
+    }
+  }
+}
+
+RateLimiter::Slot *RateLimiter::find(UInt64 key, UInt64 now) {
+  const UInt32 shard = (UInt32)(key >> 32) & (_shardCount - 1U);
+  const UInt32 start = (UInt32)key & (_shardSize - 1U);
+  Slot *slots = _slots + (Size)shard * _shardSize;
+
+  for (UInt32 attempt = 0; attempt < ESB_RATE_LIMITER_PROBES; ++attempt) {
+    for (UInt32 i = 0; i < ESB_RATE_LIMITER_PROBES; ++i) {
+      Slot *slot = slots + ((start + i) & (_shardSize - 1U));
+      UInt64 current = __atomic_load_n(&slot->_key, __ATOMIC_RELAXED);
+
+      if (current == key) {
+        return slot;
+      }
+
+      // Slots are never emptied, so the first unused slot ends the search
+      if (0U == current) {
+        if (__atomic_compare_exchange_n(&slot->_key, &current, key, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED) ||
+            current == key) {
+          return slot;
+        }
+      }
+    }
+
+    Slot *slot = evict(shard, start, key, now);
+    if (slot) {
+      return slot;
+    }
+  }
+
+  return NULL;
+}
+
+RateLimiter::Slot *RateLimiter::evict(UInt32 shard, UInt32 start, UInt64 key, UInt64 now) {
+  Slot *slots = _slots + (Size)shard * _shardSize;
+
+  // A key whose bucket has refilled is indistinguishable from a new key, so it can be replaced without evicting anyone
+  for (UInt32 i = 0; i < ESB_RATE_LIMITER_PROBES; ++i) {
+    Slot *slot = slots + ((start + i) & (_shardSize - 1U));
+    if ((__atomic_load_n(&slot->_state, __ATOMIC_RELAXED) >> 1) > now) {
+      continue;
+    }
+
+    UInt64 current = __atomic_load_n(&slot->_key, __ATOMIC_RELAXED);
+    if (__atomic_compare_exchange_n(&slot->_key, &current, key, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      return slot;
+    }
+  }
+
+  // CLOCK: clear the reference bits of recently used keys and replace the first key that was not used since its bit
+  // was last cleared.  Two passes find a victim unless every key is used again in between.
+  Shard *header = shardAt(shard);
+  const UInt32 hand = __atomic_load_n(&header->_hand, __ATOMIC_RELAXED);
+
+  for (UInt32 i = 0; i < 2U * ESB_RATE_LIMITER_PROBES; ++i) {
+    Slot *slot = slots + ((start + (hand + i) % ESB_RATE_LIMITER_PROBES) & (_shardSize - 1U));
+    UInt64 state = __atomic_load_n(&slot->_state, __ATOMIC_RELAXED);
+
+    if (state & 1U) {
+      __atomic_compare_exchange_n(&slot->_state, &state, state & ~(UInt64)1U, false, __ATOMIC_RELAXED,
+                                  __ATOMIC_RELAXED);
+      continue;
+    }
+
+    UInt64 current = __atomic_load_n(&slot->_key, __ATOMIC_RELAXED);
+    if (__atomic_compare_exchange_n(&slot->_key, &current, key, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      __atomic_store_n(&slot->_state, 0U, __ATOMIC_RELAXED);
+      __atomic_store_n(&header->_hand, hand + i + 1U, __ATOMIC_RELAXED);
+      __atomic_fetch_add(&header->_evictions, 1U, __ATOMIC_RELAXED);
+      return slot;
+    }
+  }
+
+  return NULL;
+}
+
+UInt64 RateLimiter::evictions() const {
+  if (!_slots) {
+    return 0U;
+  }
+
+  UInt64 evictions = 0U;
+  for (UInt32 i = 0; i < _shardCount; ++i) {
+    evictions += __atomic_load_n(&shardAt(i)->_evictions, __ATOMIC_RELAXED);
+  }
+  return evictions;
+}
+
+}  // namespace ESB
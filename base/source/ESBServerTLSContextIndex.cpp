@@ -2,14 +2,21 @@
 #include <ESBServerTLSContextIndex.h>
 #endif
 
+#ifndef ESB_SERVER_TLS_SOCKET_H
+#include <ESBServerTLSSocket.h>
+#endif
+
 #ifndef ESB_LOGGER_H
 #include <ESBLogger.h>
 #endif
 
 namespace ESB {
 
-ServerTLSContextIndex::ServerTLSContextIndex(UInt32 numBuckets, UInt32 numLocks, Allocator &allocator)
-    : TLSContextIndex(numBuckets, numLocks, allocator), _defaultContext(NULL) {}
+ServerTLSContextIndex::ServerTLSContextIndex(UInt32 numBuckets, UInt32 numLocks, Allocator &allocator,
+                                             UInt32 ticketKeyLifetimeSeconds)
+    : TLSContextIndex(numBuckets, numLocks, allocator),
+      _defaultContext(NULL),
+      _ticketKeyLifetimeSeconds(ticketKeyLifetimeSeconds) {}
 
 ServerTLSContextIndex::~ServerTLSContextIndex() {}
 
@@ -80,6 +87,30 @@ static int tlsext_servername_callback(SSL *ssl, int *ad, void *arg) {
   return SSL_TLSEXT_ERR_OK;
 }
 
+/**
+ * This callback is invoked to encrypt every session ticket issued and to decrypt every session ticket presented.  It
+ * is always invoked on the default context, even if the SNI callback swapped in another context, so tickets are
+ * protected by the default context's keys.
+ */
+static int tlsext_ticket_key_callback(SSL *ssl, unsigned char *name, unsigned char *iv, EVP_CIPHER_CTX *cipher,
+                                      TLSTicketMacContext *hmac, int encrypt) {
+  assert(ssl);
+  if (!ssl) {
+    ESB_LOG_ERROR_ERRNO(ESB_INVALID_STATE, "Ticket key callback not passed all arguments");
+    return -1;
+  }
+
+  ServerTLSSocket *socket = (ServerTLSSocket *)SSL_get_ex_data(ssl, TLSSocket::ExDataIndex());
+  if (!socket || socket->contextIndex().defaultContext().isNull()) {
+    return -1;
+  }
+
+  const int result = socket->contextIndex().defaultContext()->ticketKey(name, iv, cipher, hmac, encrypt);
+
+  // TLS 1.3 clients may use a ticket only once, so always issue a replacement when one is accepted
+  return !encrypt && 1 == result && TLS1_3_VERSION <= SSL_version(ssl) ? 2 : result;
+}
+
 Error ServerTLSContextIndex::indexDefaultContext(const TLSContext::Params &params) {
   if (!_defaultContext.isNull()) {
     return ESB_UNIQUENESS_VIOLATION;
@@ -100,6 +131,24 @@ Error ServerTLSContextIndex::indexDefaultContext(const TLSContext::Params &param
     return ESB_GENERAL_TLS_ERROR;
   }
 
+  if (0 == _ticketKeyLifetimeSeconds) {
+    SSL_CTX_set_options(_defaultContext->rawContext(), SSL_OP_NO_TICKET);
+    return ESB_SUCCESS;
+  }
+
+  error = _defaultContext->enableTicketKeyRotation(_ticketKeyLifetimeSeconds);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+#ifdef ESB_TLS_TICKET_EVP_MAC
+  if (0 >= SSL_CTX_set_tlsext_ticket_key_evp_cb(_defaultContext->rawContext(), tlsext_ticket_key_callback)) {
+#else
+  if (0 >= SSL_CTX_set_tlsext_ticket_key_cb(_defaultContext->rawContext(), tlsext_ticket_key_callback)) {
+#endif
+    return ESB_GENERAL_TLS_ERROR;
+  }
+
   return ESB_SUCCESS;
 }
 
@@ -36,6 +36,15 @@ Error ServerTLSSocket::startHandshake() {
     }
     SSL_set_bio(_ssl, _bio, _bio);
 
+    // Lets the ticket key callback find the default context's session ticket keys
+    if (1 != SSL_set_ex_data(_ssl, ExDataIndex(), this)) {
+      SSL_free(_ssl);  // this also frees _bio
+      _bio = NULL;
+      _ssl = NULL;
+      ESB_LOG_TLS_ERROR("[%s] cannot associate socket with SSL context", name());
+      return ESB_GENERAL_TLS_ERROR;
+    }
+
     TLSContext::PeerVerification verification = _contextIndex.defaultContext()->verifyPeerCertificate();
     switch (verification) {
       case TLSContext::VERIFY_NONE:
@@ -75,7 +84,9 @@ Error ServerTLSSocket::startHandshake() {
     }
   }
 
-  ESB_LOG_DEBUG("[%s] server TLS handshake successful", name());
+  const bool resumed = SSL_session_reused(_ssl);
+  _contextIndex.defaultContext()->countHandshake(resumed);
+  ESB_LOG_DEBUG("[%s] server TLS handshake successful (%s)", name(), resumed ? "resumed" : "full");
 
   _flags |= ESB_TLS_FLAG_ESTABLISHED;
   _flags &= ~ESB_TLS_FLAG_WANT_READ;
@@ -0,0 +1,228 @@
+#ifndef ESB_SHARDED_BUFFER_POOL_H
+#include <ESBShardedBufferPool.h>
+#endif
+
+namespace ESB {
+
+#define ESB_BUFFER_HEADER_SIZE (ESB_WORD_ALIGN(sizeof(ShardedBufferPool::Header)))
+#define ESB_BUFFER_HEADER(buffer) ((ShardedBufferPool::Header *)((unsigned char *)(buffer)-ESB_BUFFER_HEADER_SIZE))
+
+ShardedBufferPool::ShardedBufferPool(UInt32 bufferSize, UInt32 shards, UInt32 maxBuffers, UInt32 maxCachedBuffers,
+                                     Allocator &allocator)
+    : _bufferSize(bufferSize),
+      _shardCount(MAX(shards, 1U)),
+      _shardSize(ESB_ALIGN(sizeof(Shard), ESB_CACHE_LINE_SIZE)),
+      _maxBuffers(maxBuffers),
+      _maxCachedBuffers(maxCachedBuffers),
+      _shardBlock(NULL),
+      _shards(NULL),
+      _allocator(allocator),
+      _buffers(),
+      _highWatermark(0U),
+      _remoteReleases() {
+  // Shards are cache line aligned so threads do not contend for each other's lines
+  Error error = _allocator.allocate(_shardCount * _shardSize + ESB_CACHE_LINE_SIZE, (void **)&_shardBlock);
+  if (ESB_SUCCESS != error) {
+    // _shards will be checked in later functions
+    _shardBlock = NULL;
+    return;
+  }
+
+  _shards = (unsigned char *)ESB_ALIGN((UWord)_shardBlock, ESB_CACHE_LINE_SIZE);
+
+  for (UInt32 i = 0; i < _shardCount; ++i) {
+    Shard *shard = shardAt(i);
+    new (&shard->_cache) EmbeddedList();
+    SetCached(shard, 0U);
+    shard->_hits = 0U;
+    shard->_misses = 0U;
+    shard->_returned = NULL;
+  }
+}
+
+ShardedBufferPool::~ShardedBufferPool() {
+  if (!_shards) {
+    return;
+  }
+
+  for (UInt32 i = 0; i < _shardCount; ++i) {
+    Shard *shard = shardAt(i);
+    takeReturned(shard);
+
+    for (Buffer *buffer = (Buffer *)shard->_cache.removeFirst(); buffer;
+         buffer = (Buffer *)shard->_cache.removeFirst()) {
+      SetCached(shard, Cached(shard) - 1U);
+      destroyBuffer(buffer);
+    }
+
+    assert(0 == Cached(shard));
+    shard->_cache.~EmbeddedList();
+  }
+
+  assert(0 == _buffers.get());
+  _allocator.deallocate(_shardBlock);
+  _shardBlock = NULL;
+  _shards = NULL;
+}
+
+Buffer *ShardedBufferPool::acquireBuffer(UInt32 index) {
+  if (!_shards || index >= _shardCount) {
+    return NULL;
+  }
+
+  Shard *shard = shardAt(index);
+
+  if (0 == Cached(shard)) {
+    takeReturned(shard);
+  }
+
+  Buffer *buffer = (Buffer *)shard->_cache.removeLast();
+  if (buffer) {
+    SetCached(shard, Cached(shard) - 1U);
+    Count(&shard->_hits);
+    return buffer;
+  }
+
+  Count(&shard->_misses);
+
+  const UInt32 buffers = _buffers.inc();
+
+  if (0 < _maxBuffers && buffers > _maxBuffers) {
+    _buffers.dec();
+    return reclaimReturned(index);
+  }
+
+  for (UInt32 highWatermark = __atomic_load_n(&_highWatermark, __ATOMIC_RELAXED); buffers > highWatermark;) {
+    if (__atomic_compare_exchange_n(&_highWatermark, &highWatermark, buffers, true, __ATOMIC_RELAXED,
+                                    __ATOMIC_RELAXED)) {
+      break;
+    }
+  }
+
+  unsigned char *block = NULL;
+  Error error = _allocator.allocate(ESB_BUFFER_HEADER_SIZE + ESB_BUFFER_OVERHEAD + _bufferSize, (void **)&block);
+  if (ESB_SUCCESS != error) {
+    _buffers.dec();
+    return NULL;
+  }
+
+  Header *header = (Header *)block;
+  header->_shard = index;
+  return new (block + ESB_BUFFER_HEADER_SIZE)
+      Buffer(block + ESB_BUFFER_HEADER_SIZE + ESB_BUFFER_OVERHEAD, _bufferSize);
+}
+
+void ShardedBufferPool::releaseBuffer(UInt32 index, Buffer *buffer) {
+  assert(buffer);
+  assert(_shards);
+  if (!buffer || !_shards) {
+    return;
+  }
+
+  const Header *header = ESB_BUFFER_HEADER(buffer);
+  assert(header->_shard < _shardCount);
+  Shard *home = shardAt(header->_shard);
+
+  buffer->clear();
+
+  if (header->_shard != index) {
+    // Send it home.  Buffers are only ever removed from the stack by taking the whole stack at once, so a plain
+    // compare and swap push cannot suffer from ABA.
+    _remoteReleases.inc();
+    EmbeddedListElement *head = __atomic_load_n(&home->_returned, __ATOMIC_RELAXED);
+    do {
+      buffer->setNext(head);
+    } while (!__atomic_compare_exchange_n(&home->_returned, &head, buffer, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    return;
+  }
+
+  cacheBuffer(home, buffer);
+}
+
+UInt32 ShardedBufferPool::cachedBuffers(UInt32 index) const {
+  if (!_shards || index >= _shardCount) {
+    return 0U;
+  }
+
+  return Cached(shardAt(index));
+}
+
+UInt64 ShardedBufferPool::hits() const {
+  UInt64 hits = 0U;
+
+  for (UInt32 i = 0; _shards && i < _shardCount; ++i) {
+    hits += __atomic_load_n(&shardAt(i)->_hits, __ATOMIC_RELAXED);
+  }
+
+  return hits;
+}
+
+UInt64 ShardedBufferPool::misses() const {
+  UInt64 misses = 0U;
+
+  for (UInt32 i = 0; _shards && i < _shardCount; ++i) {
+    misses += __atomic_load_n(&shardAt(i)->_misses, __ATOMIC_RELAXED);
+  }
+
+  return misses;
+}
+
+void ShardedBufferPool::takeReturned(Shard *shard) {
+  EmbeddedListElement *next = NULL;
+
+  for (EmbeddedListElement *element = __atomic_exchange_n(&shard->_returned, NULL, __ATOMIC_ACQUIRE); element;
+       element = next) {
+    next = element->next();
+    element->setNext(NULL);
+    cacheBuffer(shard, (Buffer *)element);
+  }
+}
+
+// Any thread may take a whole return stack, and nothing reads the header of a free buffer, so the buffers can move
+// to the caller's shard.  The caller's own cache and return stack are empty or it would not be here.
+Buffer *ShardedBufferPool::reclaimReturned(UInt32 index) {
+  Shard *shard = shardAt(index);
+
+  for (UInt32 i = 1; i < _shardCount; ++i) {
+    EmbeddedListElement *element =
+        __atomic_exchange_n(&shardAt((index + i) % _shardCount)->_returned, NULL, __ATOMIC_ACQUIRE);
+
+    if (!element) {
+      continue;
+    }
+
+    Buffer *buffer = (Buffer *)element;
+    EmbeddedListElement *next = element->next();
+    element->setNext(NULL);
+    ESB_BUFFER_HEADER(buffer)->_shard = index;
+
+    for (element = next; element; element = next) {
+      next = element->next();
+      element->setNext(NULL);
+      ESB_BUFFER_HEADER(element)->_shard = index;
+      cacheBuffer(shard, (Buffer *)element);
+    }
+
+    return buffer;
+  }
+
+  return NULL;
+}
+
+void ShardedBufferPool::cacheBuffer(Shard *shard, Buffer *buffer) {
+  if (0 < _maxCachedBuffers && Cached(shard) >= _maxCachedBuffers) {
+    destroyBuffer(buffer);
+    return;
+  }
+
+  shard->_cache.addLast(buffer);
+  SetCached(shard, Cached(shard) + 1U);
+}
+
+void ShardedBufferPool::destroyBuffer(Buffer *buffer) {
+  buffer->~Buffer();
+  _allocator.deallocate(ESB_BUFFER_HEADER(buffer));
+  _buffers.dec();
+}
+
+}  // namespace ESB
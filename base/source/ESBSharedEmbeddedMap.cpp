@@ -68,6 +68,34 @@ EmbeddedMapElement *SharedEmbeddedMap::remove(const void *key) {
   return EmbeddedMapBase::remove(bucket, key);
 }
 
+EmbeddedMapElement *SharedEmbeddedMap::removeLast(const void *key) {
+  if (!key) {
+    return NULL;
+  }
+
+  if (0 < _numBucketLocks && !_bucketLocks) {
+    return NULL;
+  }
+
+  UInt32 bucket = EmbeddedMapBase::bucket(key);
+  WriteScopeLock lock(bucketLock(bucket));
+  return EmbeddedMapBase::removeLast(bucket, key);
+}
+
+UInt32 SharedEmbeddedMap::count(const void *key) {
+  if (!key) {
+    return 0U;
+  }
+
+  if (0 < _numBucketLocks && !_bucketLocks) {
+    return 0U;
+  }
+
+  UInt32 bucket = EmbeddedMapBase::bucket(key);
+  WriteScopeLock lock(bucketLock(bucket));
+  return EmbeddedMapBase::count(bucket, key);
+}
+
 const EmbeddedMapElement *SharedEmbeddedMap::find(const void *key) {
   if (!key) {
     return NULL;
@@ -10,6 +10,10 @@
 #include <ESBWriteScopeLock.h>
 #endif
 
+#ifndef ESB_MONOTONIC_TIME_SOURCE_H
+#include <ESBMonotonicTimeSource.h>
+#endif
+
 namespace ESB {
 
 SimplePerformanceCounter::SimplePerformanceCounter(const char *name)
@@ -33,7 +37,7 @@ double SimplePerformanceCounter::queriesPerSecNoLock() const {
   Date window;
 
   if (0 == _windowStop.seconds() && 0 == _windowStop.microSeconds()) {
-    window = ESB::Time::Instance().now() - _windowStart;
+    window = ESB::MonotonicTimeSource::Instance().now() - _windowStart;
   } else {
     window = _windowStop - _windowStart;
   }
@@ -51,7 +55,7 @@ void SimplePerformanceCounter::record(const Date &start, const Date &stop) {
     WriteScopeLock lock(_lock);
 
     if (0 == _windowStart.seconds() && 0 == _windowStart.microSeconds()) {
-      _windowStart = ESB::Time::Instance().now();
+      _windowStart = ESB::MonotonicTimeSource::Instance().now();
     }
 
     _latencyMsec.add(diffMSec);
@@ -84,6 +88,14 @@ void SimplePerformanceCounter::log(Logger &logger, Logger::Severity severity) co
           _name, qps, queries, meanMSec, varianceMSec, minMSec, maxMSec);
 }
 
+void SimplePerformanceCounter::snapshot(Snapshot *snapshot) const {
+  memset(snapshot, 0, sizeof(Snapshot));
+
+  ReadScopeLock lock(_lock);
+  snapshot->_queries = _latencyMsec.n();
+  snapshot->_sumMSec = _latencyMsec.mean() * _latencyMsec.n();
+}
+
 UInt32 SimplePerformanceCounter::queries() const {
   ReadScopeLock lock(_lock);
   return _latencyMsec.n();
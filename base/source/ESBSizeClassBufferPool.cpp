@@ -0,0 +1,88 @@
+#ifndef ESB_SIZE_CLASS_BUFFER_POOL_H
+#include <ESBSizeClassBufferPool.h>
+#endif
+
+namespace ESB {
+
+SizeClassBufferPool::SizeClassBufferPool(const UInt32 *bufferSizes, UInt32 sizeClasses, UInt32 shards,
+                                         UInt32 maxBuffersPerClass, UInt32 maxCachedBuffers, Allocator &allocator)
+    : _sizeClasses(0U), _allocator(allocator) {
+  memset(_pools, 0, sizeof(_pools));
+
+  assert(bufferSizes);
+  assert(0 < sizeClasses && ESB_MAX_BUFFER_SIZE_CLASSES >= sizeClasses);
+  if (!bufferSizes || ESB_MAX_BUFFER_SIZE_CLASSES < sizeClasses) {
+    // sizeClasses() will be checked by callers
+    return;
+  }
+
+  for (UInt32 i = 0; i < sizeClasses; ++i) {
+    // Released buffers are matched to their size class by capacity, so sizes must be unique
+    if (0 < i && bufferSizes[i - 1] >= bufferSizes[i]) {
+      break;
+    }
+
+    _pools[i] =
+        new (_allocator) ShardedBufferPool(bufferSizes[i], shards, maxBuffersPerClass, maxCachedBuffers, _allocator);
+    if (!_pools[i]) {
+      break;
+    }
+
+    if (0 == _pools[i]->shards()) {
+      _pools[i]->~ShardedBufferPool();
+      _allocator.deallocate(_pools[i]);
+      _pools[i] = NULL;
+      break;
+    }
+
+    ++_sizeClasses;
+  }
+}
+
+SizeClassBufferPool::~SizeClassBufferPool() {
+  for (UInt32 i = 0; i < _sizeClasses; ++i) {
+    _pools[i]->~ShardedBufferPool();
+    _allocator.deallocate(_pools[i]);
+    _pools[i] = NULL;
+  }
+  _sizeClasses = 0U;
+}
+
+Buffer *SizeClassBufferPool::acquireBuffer(UInt32 shard, UInt32 sizeClass) {
+  if (0 == _sizeClasses) {
+    return NULL;
+  }
+
+  return _pools[MIN(sizeClass, _sizeClasses - 1)]->acquireBuffer(shard);
+}
+
+void SizeClassBufferPool::releaseBuffer(UInt32 shard, Buffer *buffer) {
+  assert(buffer);
+  if (!buffer) {
+    return;
+  }
+
+  for (UInt32 i = 0; i < _sizeClasses; ++i) {
+    if (_pools[i]->bufferSize() == buffer->capacity()) {
+      _pools[i]->releaseBuffer(shard, buffer);
+      return;
+    }
+  }
+
+  ESB_LOG_WARNING("Destroying %u byte buffer that does not belong to any size class", buffer->capacity());
+  Buffer::Destroy(_allocator, buffer);
+}
+
+void SizeClassBufferPool::log(Logger &logger, Logger::Severity severity) const {
+  for (UInt32 i = 0; i < _sizeClasses; ++i) {
+    const UInt64 hits = _pools[i]->hits();
+    const UInt64 misses = _pools[i]->misses();
+
+    ESB_LOG(logger, severity,
+            "BUFFER SIZE CLASS %u (%u bytes): %u buffers, %u high watermark, %lu acquisitions, %.2f%% hit rate", i,
+            _pools[i]->bufferSize(), _pools[i]->buffers(), _pools[i]->highWatermark(), hits + misses,
+            0 < hits + misses ? 100.0 * hits / (hits + misses) : 0.0);
+  }
+}
+
+}  // namespace ESB
@@ -0,0 +1,163 @@
+#ifndef ESB_SLOT_COUNTER_H
+#include <ESBSlotCounter.h>
+#endif
+
+#ifndef ESB_SHARED_INT_H
+#include <ESBSharedInt.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+namespace ESB {
+
+#ifdef HAVE_THREAD_LOCAL_STORAGE
+// 1 + the calling thread's position in the order threads first used any slot counter, or 0 if it never has
+static __thread UInt32 ThreadIndex = 0;
+#else
+#error "__thread or equivalent is required"
+#endif
+
+static SharedInt ThreadCount;
+
+SlotCounter::SlotCounter(UInt32 limit, UInt32 shards, bool strict, Allocator &allocator)
+    : _limit(limit),
+      _shardCount(MAX(shards, 1U)),
+      _shardSize(ESB_ALIGN(sizeof(Shard), ESB_CACHE_LINE_SIZE)),
+      _lease(strict ? 0U : limit / (_shardCount * ESB_SLOT_COUNTER_LEASE_FRACTION)),
+      _block(NULL),
+      _shards(NULL),
+      _allocator(allocator) {
+  const Size size = (_shardCount + 1U) * _shardSize;
+
+  Error error = _allocator.allocate(size + ESB_CACHE_LINE_SIZE, (void **)&_block);
+  if (ESB_SUCCESS != error) {
+    // _block will be checked in later functions
+    _block = NULL;
+    return;
+  }
+
+  _shards = (unsigned char *)ESB_ALIGN((UWord)_block, ESB_CACHE_LINE_SIZE);
+  memset(_shards, 0, size);
+  *(UInt32 *)_shards = limit;
+}
+
+SlotCounter::~SlotCounter() {
+  if (_block) {
+    _allocator.deallocate(_block);
+    _block = NULL;
+    _shards = NULL;
+  }
+}
+
+Error SlotCounter::acquire(UInt32 slots) {
+  if (!_block) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  if (slots > _limit) {
+    return ESB_OVERFLOW;
+  }
+
+  if (_lease) {
+    UInt32 *available = localAvailable();
+    UInt32 current = __atomic_load_n(available, __ATOMIC_RELAXED);
+
+    while (current >= slots) {
+      if (__atomic_compare_exchange_n(available, &current, current - slots, true, __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED)) {
+        return ESB_SUCCESS;
+      }
+    }
+
+    // Take these slots and a fresh lease from the shared count in one go
+    if (take(slots + _lease)) {
+      __atomic_add_fetch(available, _lease, __ATOMIC_RELAXED);
+      return ESB_SUCCESS;
+    }
+  }
+
+  if (take(slots)) {
+    return ESB_SUCCESS;
+  }
+
+  if (!_lease) {
+    return ESB_OVERFLOW;
+  }
+
+  // The free slots may all be parked in other shards' leases
+  reconcile();
+  return take(slots) ? ESB_SUCCESS : ESB_OVERFLOW;
+}
+
+void SlotCounter::release(UInt32 slots) {
+  if (!_block || 0U == slots) {
+    return;
+  }
+
+  if (!_lease) {
+    __atomic_add_fetch((UInt32 *)_shards, slots, __ATOMIC_RELAXED);
+    return;
+  }
+
+  UInt32 *available = localAvailable();
+  UInt32 current = __atomic_add_fetch(available, slots, __ATOMIC_RELAXED);
+
+  // Keep one lease for the next acquire and return the rest
+  while (current > 2U * _lease) {
+    if (__atomic_compare_exchange_n(available, &current, _lease, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      __atomic_add_fetch((UInt32 *)_shards, current - _lease, __ATOMIC_RELAXED);
+      return;
+    }
+  }
+}
+
+void SlotCounter::reconcile() {
+  if (!_block || !_lease) {
+    return;
+  }
+
+  for (UInt32 i = 0; i < _shardCount; ++i) {
+    const UInt32 available = __atomic_exchange_n(availableAt(i), 0U, __ATOMIC_RELAXED);
+    if (available) {
+      __atomic_add_fetch((UInt32 *)_shards, available, __ATOMIC_RELAXED);
+    }
+  }
+}
+
+UInt32 SlotCounter::inUse() const {
+  if (!_block) {
+    return 0U;
+  }
+
+  UInt64 available = __atomic_load_n((UInt32 *)_shards, __ATOMIC_RELAXED);
+  for (UInt32 i = 0; _lease && i < _shardCount; ++i) {
+    available += __atomic_load_n(availableAt(i), __ATOMIC_RELAXED);
+  }
+
+  return available < _limit ? _limit - (UInt32)available : 0U;
+}
+
+UInt32 *SlotCounter::localAvailable() const {
+  if (0 == ThreadIndex) {
+    ThreadIndex = ThreadCount.inc();
+  }
+
+  return availableAt((ThreadIndex - 1U) % _shardCount);
+}
+
+bool SlotCounter::take(UInt32 slots) {
+  UInt32 *shared = (UInt32 *)_shards;
+  UInt32 current = __atomic_load_n(shared, __ATOMIC_RELAXED);
+
+  while (current >= slots) {
+    if (__atomic_compare_exchange_n(shared, &current, current - slots, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+}  // namespace ESB
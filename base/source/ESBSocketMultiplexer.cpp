@@ -12,4 +12,6 @@ SocketMultiplexer::SocketMultiplexer() {}
 
 SocketMultiplexer::~SocketMultiplexer() {}
 
+const EventLoopCounters *SocketMultiplexer::eventLoopCounters() const { return NULL; }
+
 }  // namespace ESB
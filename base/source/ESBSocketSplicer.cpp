@@ -0,0 +1,187 @@
+#ifndef ESB_SOCKET_SPLICER_H
+#include <ESBSocketSplicer.h>
+#endif
+
+#ifndef ESB_LOGGER_H
+#include <ESBLogger.h>
+#endif
+
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+namespace ESB {
+
+// Never ask the kernel to move more than this in a single splice call.
+static const UInt64 MAX_SPLICE_SIZE = 1024 * 1024;
+
+SocketSplicer::PipePool::PipePool() : _size(0U) {}
+
+SocketSplicer::PipePool::~PipePool() {
+  while (0U < _size) {
+    Close(_pipes[--_size]);
+  }
+}
+
+bool SocketSplicer::PipePool::acquire(int pipe[2]) {
+  if (0U == _size) {
+    return false;
+  }
+
+  --_size;
+  pipe[0] = _pipes[_size][0];
+  pipe[1] = _pipes[_size][1];
+  return true;
+}
+
+bool SocketSplicer::PipePool::release(int pipe[2]) {
+  if (ESB_SOCKET_SPLICER_IDLE_PIPES <= _size) {
+    return false;
+  }
+
+  _pipes[_size][0] = pipe[0];
+  _pipes[_size][1] = pipe[1];
+  ++_size;
+  return true;
+}
+
+SocketSplicer::SocketSplicer(PipePool *pool) : _pool(pool), _buffered(0) {
+  _pipe[0] = INVALID_SOCKET;
+  _pipe[1] = INVALID_SOCKET;
+}
+
+SocketSplicer::~SocketSplicer() {
+  if (INVALID_SOCKET == _pipe[0]) {
+    return;
+  }
+
+  // Bytes left in the pipe would be spliced into the next user's destination
+  if (0 == _buffered && _pool && _pool->release(_pipe)) {
+    return;
+  }
+
+  Close(_pipe);
+}
+
+void SocketSplicer::Close(int pipe[2]) {
+  for (int i = 0; i < 2; ++i) {
+    if (INVALID_SOCKET != pipe[i]) {
+#ifdef HAVE_CLOSE
+      close(pipe[i]);
+#else
+#error "close() or equivalent is required"
+#endif
+      pipe[i] = INVALID_SOCKET;
+    }
+  }
+}
+
+bool SocketSplicer::Supported() {
+#if defined HAVE_SPLICE && defined HAVE_PIPE2 && defined HAVE_SPLICE_F_NONBLOCK
+  return true;
+#else
+  return false;
+#endif
+}
+
+Error SocketSplicer::open() {
+  if (INVALID_SOCKET != _pipe[0]) {
+    return ESB_SUCCESS;
+  }
+
+  if (_pool && _pool->acquire(_pipe)) {
+    return ESB_SUCCESS;
+  }
+
+#if defined HAVE_SPLICE && defined HAVE_PIPE2 && defined HAVE_SPLICE_F_NONBLOCK
+  if (0 != pipe2(_pipe, O_NONBLOCK | O_CLOEXEC)) {
+    Error error = LastError();
+    _pipe[0] = INVALID_SOCKET;
+    _pipe[1] = INVALID_SOCKET;
+    ESB_LOG_WARNING_ERRNO(error, "Cannot create splice pipe");
+    return error;
+  }
+
+  return ESB_SUCCESS;
+#else
+  return ESB_OPERATION_NOT_SUPPORTED;
+#endif
+}
+
+Error SocketSplicer::fill(SOCKET source, UInt64 maxBytes, UInt64 *bytesFilled) {
+  if (!bytesFilled) {
+    return ESB_NULL_POINTER;
+  }
+
+  *bytesFilled = 0;
+
+  if (INVALID_SOCKET == source || 0 == maxBytes) {
+    return ESB_INVALID_ARGUMENT;
+  }
+
+  Error error = open();
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+#if defined HAVE_SPLICE && defined HAVE_PIPE2 && defined HAVE_SPLICE_F_NONBLOCK
+  SSize result =
+      splice(source, NULL, _pipe[1], NULL, MIN(maxBytes, MAX_SPLICE_SIZE), SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+  if (0 > result) {
+    return LastError();
+  }
+
+  if (0 == result) {
+    return ESB_CLOSED;
+  }
+
+  *bytesFilled = result;
+  _buffered += result;
+  return ESB_SUCCESS;
+#else
+  return ESB_OPERATION_NOT_SUPPORTED;
+#endif
+}
+
+Error SocketSplicer::drain(SOCKET destination, UInt64 *bytesDrained) {
+  if (!bytesDrained) {
+    return ESB_NULL_POINTER;
+  }
+
+  *bytesDrained = 0;
+
+  if (INVALID_SOCKET == destination) {
+    return ESB_INVALID_ARGUMENT;
+  }
+
+#if defined HAVE_SPLICE && defined HAVE_PIPE2 && defined HAVE_SPLICE_F_NONBLOCK
+  while (0 < _buffered) {
+    SSize result =
+        splice(_pipe[0], NULL, destination, NULL, MIN(_buffered, MAX_SPLICE_SIZE), SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+    if (0 > result) {
+      return LastError();
+    }
+
+    if (0 == result) {
+      // The pipe claims to be empty while we think it still holds data
+      return ESB_INVALID_STATE;
+    }
+
+    assert((UInt64)result <= _buffered);
+    _buffered -= result;
+    *bytesDrained += result;
+  }
+
+  return ESB_SUCCESS;
+#else
+  return 0 == _buffered ? ESB_SUCCESS : ESB_OPERATION_NOT_SUPPORTED;
+#endif
+}
+
+}  // namespace ESB
@@ -0,0 +1,254 @@
+#ifndef ESB_SPACE_SAVING_H
+#include <ESBSpaceSaving.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+namespace ESB {
+
+static UInt32 RoundUpToPowerOf2(UInt32 value) {
+  UInt32 power = 1U;
+  while (power < value && power < (1U << 31)) {
+    power <<= 1;
+  }
+  return power;
+}
+
+static inline UInt32 HashKey(UInt64 key) {
+  key ^= key >> 33;
+  key *= ESB_UINT64_C(0xff51afd7ed558ccd);
+  key ^= key >> 33;
+  return (UInt32)key;
+}
+
+SpaceSaving::SpaceSaving(UInt32 capacity, Allocator &allocator)
+    : _capacity(MAX(capacity, 1U)),
+      // At most half full so probe sequences stay short
+      _indexMask(RoundUpToPowerOf2(2U * _capacity) - 1U),
+      _size(0U),
+      _head(ESB_UINT32_MAX),
+      _free(ESB_UINT32_MAX),
+      _total(0U),
+      _block(NULL),
+      _counters(NULL),
+      _buckets(NULL),
+      _index(NULL),
+      _allocator(allocator) {
+  // A counter moving up may need a new bucket before its old one is freed, so there is one more bucket than counters
+  const Size countersSize = _capacity * sizeof(Counter);
+  const Size bucketsSize = (_capacity + 1U) * sizeof(Bucket);
+  const Size indexSize = (_indexMask + 1U) * sizeof(UInt32);
+
+  Error error = _allocator.allocate(countersSize + bucketsSize + indexSize, (void **)&_block);
+  if (ESB_SUCCESS != error) {
+    // _block will be checked in later functions
+    _block = NULL;
+    return;
+  }
+
+  _counters = (Counter *)_block;
+  _buckets = (Bucket *)(_block + countersSize);
+  _index = (UInt32 *)(_block + countersSize + bucketsSize);
+  clear();
+}
+
+SpaceSaving::~SpaceSaving() {
+  if (_block) {
+    _allocator.deallocate(_block);
+    _block = NULL;
+    _counters = NULL;
+    _buckets = NULL;
+    _index = NULL;
+  }
+}
+
+void SpaceSaving::clear() {
+  if (!_block) {
+    return;
+  }
+
+  _size = 0U;
+  _head = ESB_UINT32_MAX;
+  _total = 0U;
+  memset(_index, 0, (_indexMask + 1U) * sizeof(UInt32));
+
+  for (UInt32 i = 0; i <= _capacity; ++i) {
+    _buckets[i].next = i < _capacity ? i + 1U : ESB_UINT32_MAX;
+  }
+  _free = 0U;
+}
+
+UInt64 SpaceSaving::add(UInt64 key, UInt64 weight, UInt64 error) {
+  if (!_block) {
+    return 0U;
+  }
+
+  UInt32 counter = lookup(key);
+
+  if (ESB_UINT32_MAX != counter) {
+    _counters[counter].error += error;
+    if (weight) {
+      increment(counter, weight);
+    }
+  } else if (_size < _capacity) {
+    counter = _size++;
+    _counters[counter].key = key;
+    _counters[counter].error = error;
+    index(counter);
+    place(counter, weight, ESB_UINT32_MAX);
+  } else {
+    // Replace a key with the smallest count, which the new key inherits as its error
+    counter = _buckets[_head].head;
+    const UInt64 minimum = _buckets[_head].count;
+    unindex(_counters[counter].key);
+    _counters[counter].key = key;
+    _counters[counter].error = minimum + error;
+    index(counter);
+    if (weight) {
+      increment(counter, weight);
+    }
+  }
+
+  _total += weight;
+
+  const UInt64 count = _buckets[_counters[counter].bucket].count;
+  return count > _counters[counter].error ? count - _counters[counter].error : 0U;
+}
+
+Error SpaceSaving::find(UInt64 key, UInt64 *count, UInt64 *error) const {
+  if (!count || !error) {
+    return ESB_NULL_POINTER;
+  }
+
+  const UInt32 counter = _block ? lookup(key) : ESB_UINT32_MAX;
+  if (ESB_UINT32_MAX == counter) {
+    return ESB_CANNOT_FIND;
+  }
+
+  *count = _buckets[_counters[counter].bucket].count;
+  *error = _counters[counter].error;
+  return ESB_SUCCESS;
+}
+
+void SpaceSaving::merge(const SpaceSaving &other) {
+  for (UInt32 i = 0; i < other.size(); ++i) {
+    add(other.key(i), other.count(i), other.error(i));
+  }
+}
+
+UInt32 SpaceSaving::lookup(UInt64 key) const {
+  for (UInt32 i = HashKey(key) & _indexMask; _index[i]; i = (i + 1U) & _indexMask) {
+    if (_counters[_index[i] - 1U].key == key) {
+      return _index[i] - 1U;
+    }
+  }
+  return ESB_UINT32_MAX;
+}
+
+void SpaceSaving::index(UInt32 counter) {
+  UInt32 i = HashKey(_counters[counter].key) & _indexMask;
+  while (_index[i]) {
+    i = (i + 1U) & _indexMask;
+  }
+  _index[i] = counter + 1U;
+}
+
+void SpaceSaving::unindex(UInt64 key) {
+  UInt32 i = HashKey(key) & _indexMask;
+  while (_counters[_index[i] - 1U].key != key) {
+    i = (i + 1U) & _indexMask;
+  }
+
+  // Linear probing deletion: shift back later entries that would otherwise be cut off from their home slot
+  _index[i] = 0U;
+  for (UInt32 j = (i + 1U) & _indexMask; _index[j]; j = (j + 1U) & _indexMask) {
+    const UInt32 home = HashKey(_counters[_index[j] - 1U].key) & _indexMask;
+    if (((j - home) & _indexMask) >= ((j - i) & _indexMask)) {
+      _index[i] = _index[j];
+      _index[j] = 0U;
+      i = j;
+    }
+  }
+}
+
+void SpaceSaving::increment(UInt32 counter, UInt64 weight) {
+  Counter &c = _counters[counter];
+  const UInt32 bucket = c.bucket;
+
+  if (ESB_UINT32_MAX != c.prev) {
+    _counters[c.prev].next = c.next;
+  } else {
+    _buckets[bucket].head = c.next;
+  }
+  if (ESB_UINT32_MAX != c.next) {
+    _counters[c.next].prev = c.prev;
+  }
+
+  // The old bucket still marks where to start looking
+  place(counter, _buckets[bucket].count + weight, bucket);
+
+  if (ESB_UINT32_MAX == _buckets[bucket].head) {
+    freeBucket(bucket);
+  }
+}
+
+void SpaceSaving::place(UInt32 counter, UInt64 count, UInt32 from) {
+  UInt32 prev = from;
+  UInt32 next = ESB_UINT32_MAX == from ? _head : _buckets[from].next;
+
+  while (ESB_UINT32_MAX != next && _buckets[next].count < count) {
+    prev = next;
+    next = _buckets[next].next;
+  }
+
+  UInt32 target = next;
+
+  if (ESB_UINT32_MAX == next || _buckets[next].count != count) {
+    target = _free;
+    _free = _buckets[target].next;
+
+    Bucket &b = _buckets[target];
+    b.count = count;
+    b.head = ESB_UINT32_MAX;
+    b.prev = prev;
+    b.next = next;
+
+    if (ESB_UINT32_MAX == prev) {
+      _head = target;
+    } else {
+      _buckets[prev].next = target;
+    }
+    if (ESB_UINT32_MAX != next) {
+      _buckets[next].prev = target;
+    }
+  }
+
+  Counter &c = _counters[counter];
+  c.bucket = target;
+  c.prev = ESB_UINT32_MAX;
+  c.next = _buckets[target].head;
+  if (ESB_UINT32_MAX != c.next) {
+    _counters[c.next].prev = counter;
+  }
+  _buckets[target].head = counter;
+}
+
+void SpaceSaving::freeBucket(UInt32 bucket) {
+  Bucket &b = _buckets[bucket];
+
+  if (ESB_UINT32_MAX == b.prev) {
+    _head = b.next;
+  } else {
+    _buckets[b.prev].next = b.next;
+  }
+  if (ESB_UINT32_MAX != b.next) {
+    _buckets[b.next].prev = b.prev;
+  }
+
+  b.next = _free;
+  _free = bucket;
+}
+
+}  // namespace ESB
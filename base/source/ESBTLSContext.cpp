@@ -10,7 +10,20 @@
 #include <ESBTLSSocket.h>
 #endif
 
+#ifndef ESB_READ_SCOPE_LOCK_H
+#include <ESBReadScopeLock.h>
+#endif
+
+#ifndef ESB_WRITE_SCOPE_LOCK_H
+#include <ESBWriteScopeLock.h>
+#endif
+
+#ifndef ESB_TIME_H
+#include <ESBTime.h>
+#endif
+
 #include <openssl/err.h>
+#include <openssl/rand.h>
 #include <openssl/x509v3.h>
 
 namespace ESB {
@@ -147,6 +160,9 @@ Error TLSContext::Create(TLSContextPointer &pointer, const Params &params, TLSCo
     return ESB_OUT_OF_MEMORY;
   }
 
+  // TLS sockets retry writes that would block from buffers that may have moved (e.g., compacted send buffers)
+  SSL_CTX_set_mode(context, SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+
   X509 *certificate = NULL;
 
   if (params.privateKeyPath() && params.certificatePath()) {
@@ -184,6 +200,15 @@ Error TLSContext::Create(TLSContextPointer &pointer, const Params &params, TLSCo
     SSL_CTX_set_verify_depth(context, params.maxVerifyDepth());
   }
 
+  // Sessions can only be resumed on contexts with the same session id context.  OpenSSL also refuses to resume
+  // sessions on servers that verify client certificates if it is not set.
+  static const unsigned char SessionIdContext[] = "ESB";
+  if (1 != SSL_CTX_set_session_id_context(context, SessionIdContext, sizeof(SessionIdContext) - 1)) {
+    ESB_LOG_TLS_ERROR("Cannot set TLS session id context");
+    SSL_CTX_free(context);
+    return ESB_GENERAL_TLS_ERROR;
+  }
+
   // TODO use  int SSL_CTX_set_cipher_list(SSL_CTX *ctx, const char *str);
 
   pointer = new (memory) TLSContext(cleanupHandler, context, params.verifyPeerCertificate());
@@ -206,13 +231,127 @@ Error TLSContext::Create(TLSContextPointer &pointer, const Params &params, TLSCo
 }
 
 TLSContext::TLSContext(CleanupHandler *handler, SSL_CTX *contex, PeerVerification verifyPeerCertificate)
-    : _cleanupHandler(handler), _context(contex), _certificate(), _verifyPeerCertificate(verifyPeerCertificate) {}
+    : _cleanupHandler(handler),
+      _context(contex),
+      _certificate(),
+      _verifyPeerCertificate(verifyPeerCertificate),
+      _sessionCache(NULL),
+      _fullHandshakes(),
+      _resumedHandshakes(),
+      _ticketKeyLock(),
+      _ticketKeyLifetime(0U),
+      _ticketKeyExpires(0U),
+      _ticketKeyCount(0U),
+      _currentTicketKey(0U) {}
 
 TLSContext::~TLSContext() {
   if (_context) {
     SSL_CTX_free(_context);
     _context = NULL;
   }
+  OPENSSL_cleanse(_ticketKeys, sizeof(_ticketKeys));
+}
+
+Error TLSContext::enableTicketKeyRotation(UInt32 lifetimeSeconds) {
+  if (0 == lifetimeSeconds) {
+    return ESB_INVALID_ARGUMENT;
+  }
+
+  WriteScopeLock lock(_ticketKeyLock);
+  _ticketKeyLifetime = lifetimeSeconds;
+  return rotateTicketKey(Time::Instance().now());
+}
+
+Error TLSContext::rotateTicketKey(const Date &now) {
+  const UInt32 next = 0 == _ticketKeyCount ? 0U : (_currentTicketKey + 1) % ESB_TLS_TICKET_KEYS;
+  TicketKey &key = _ticketKeys[next];
+
+  if (1 != RAND_bytes(key._name, sizeof(key._name)) || 1 != RAND_bytes(key._cipherKey, sizeof(key._cipherKey)) ||
+      1 != RAND_bytes(key._hmacKey, sizeof(key._hmacKey))) {
+    ESB_LOG_TLS_ERROR("Cannot generate TLS session ticket key");
+    return ESB_GENERAL_TLS_ERROR;
+  }
+
+  key._created = now.seconds();
+  _currentTicketKey = next;
+  _ticketKeyCount = MIN(_ticketKeyCount + 1, ESB_TLS_TICKET_KEYS);
+  _ticketKeyExpires = now.seconds() + _ticketKeyLifetime;
+  return ESB_SUCCESS;
+}
+
+int TLSContext::ticketKey(unsigned char *name, unsigned char *iv, EVP_CIPHER_CTX *cipher, TLSTicketMacContext *hmac,
+                          bool encrypt) {
+  TicketKey key;
+  bool renew = false;
+
+  if (encrypt) {
+    const Date now = Time::Instance().now();
+    bool expired = false;
+
+    {
+      ReadScopeLock lock(_ticketKeyLock);
+      if (0 == _ticketKeyCount) {
+        return -1;
+      }
+      expired = now.seconds() >= _ticketKeyExpires;
+      if (!expired) {
+        key = _ticketKeys[_currentTicketKey];
+      }
+    }
+
+    if (expired) {
+      WriteScopeLock lock(_ticketKeyLock);
+      // Another thread may have rotated the key while this one waited for the lock
+      if (now.seconds() >= _ticketKeyExpires && ESB_SUCCESS != rotateTicketKey(now)) {
+        return -1;
+      }
+      key = _ticketKeys[_currentTicketKey];
+    }
+
+    if (1 != RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc()))) {
+      OPENSSL_cleanse(&key, sizeof(key));
+      return -1;
+    }
+    memcpy(name, key._name, sizeof(key._name));
+  } else {
+    // Keys only rotate when tickets are issued, so a server that resumes every session must check expiry here too
+    const Date now = Time::Instance().now();
+    ReadScopeLock lock(_ticketKeyLock);
+    UInt32 i = 0;
+    for (; i < _ticketKeyCount; ++i) {
+      if (0 == memcmp(name, _ticketKeys[i]._name, sizeof(_ticketKeys[i]._name))) {
+        break;
+      }
+    }
+    if (i == _ticketKeyCount ||
+        now.seconds() >= (UInt64)_ticketKeys[i]._created + (UInt64)ESB_TLS_TICKET_KEYS * _ticketKeyLifetime) {
+      // Encrypted with a retired key or by another server, fall back to a full handshake
+      return 0;
+    }
+    key = _ticketKeys[i];
+    // A new ticket is encrypted with a fresh key if the current one has expired
+    renew = i != _currentTicketKey || now.seconds() >= _ticketKeyExpires;
+  }
+
+#ifdef ESB_TLS_TICKET_EVP_MAC
+  OSSL_PARAM macParams[2];
+  macParams[0] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, (char *)"SHA256", 0);
+  macParams[1] = OSSL_PARAM_construct_end();
+#endif
+
+  int result = renew ? 2 : 1;
+  if (1 != (encrypt ? EVP_EncryptInit_ex(cipher, EVP_aes_256_cbc(), NULL, key._cipherKey, iv)
+                    : EVP_DecryptInit_ex(cipher, EVP_aes_256_cbc(), NULL, key._cipherKey, iv)) ||
+#ifdef ESB_TLS_TICKET_EVP_MAC
+      1 != EVP_MAC_init(hmac, key._hmacKey, sizeof(key._hmacKey), macParams)) {
+#else
+      1 != HMAC_Init_ex(hmac, key._hmacKey, sizeof(key._hmacKey), EVP_sha256(), NULL)) {
+#endif
+    result = -1;
+  }
+
+  OPENSSL_cleanse(&key, sizeof(key));
+  return result;
 }
 
 TLSContext::Params &TLSContext::Params::reset() {
@@ -17,6 +17,8 @@ TLSContextIndex::~TLSContextIndex() {
   }
 }
 
+Error TLSContextIndex::initializeContext(TLSContext &context) { return ESB_SUCCESS; }
+
 void TLSContextIndex::TLSContextCleanupHandler::destroy(Object *object) {
   TLSContext *context = (TLSContext *)object;
   context->~TLSContext();
@@ -39,6 +41,11 @@ Error TLSContextIndex::indexContext(const TLSContext::Params &params, TLSContext
     return error;
   }
 
+  error = initializeContext(*pointer);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
   if (out) {
     *out = pointer;
   }
@@ -0,0 +1,208 @@
+#ifndef ESB_TLS_SESSION_CACHE_H
+#include <ESBTLSSessionCache.h>
+#endif
+
+#ifndef ESB_WRITE_SCOPE_LOCK_H
+#include <ESBWriteScopeLock.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+namespace ESB {
+
+TLSSessionCache::TLSSessionCache(UInt32 maxSessions, UInt32 numShards, Allocator &allocator)
+    : _maxSessionsPerShard(0 == maxSessions ? 0U : MAX(1U, maxSessions / MAX(1U, numShards))),
+      _numShards(MAX(1U, numShards)),
+      _allocator(allocator),
+      _hits(),
+      _misses(),
+      _evictions(),
+      _fullHandshakes(),
+      _resumedHandshakes(),
+      _comparator(),
+      _shards(NULL) {
+  if (0 == _maxSessionsPerShard) {
+    return;
+  }
+
+  Error error = _allocator.allocate(_numShards * sizeof(Shard), (void **)&_shards);
+  if (ESB_SUCCESS != error) {
+    // _shards will be checked in later functions
+    _shards = NULL;
+    return;
+  }
+
+  for (UInt32 i = 0; i < _numShards; ++i) {
+    new (&_shards[i]) Shard(_comparator, _allocator);
+  }
+}
+
+TLSSessionCache::~TLSSessionCache() {
+  if (!_shards) {
+    return;
+  }
+
+  clear();
+
+  for (UInt32 i = 0; i < _numShards; ++i) {
+    _shards[i].~Shard();
+  }
+  _allocator.deallocate(_shards);
+}
+
+SSL_SESSION *TLSSessionCache::find(const char *fqdn, const SocketAddress &peer, const Date &now) {
+  if (!fqdn || !_shards) {
+    return NULL;
+  }
+
+  Shard &shard = this->shard(fqdn, peer);
+  const Key key(fqdn, &peer);
+  WriteScopeLock lock(shard._lock);
+
+  Entry *entry = (Entry *)shard._entries.find(&key);
+  if (!entry) {
+    _misses.inc();
+    return NULL;
+  }
+
+  SSL_SESSION *session = entry->_session;
+
+  // Sessions become unresumable if a connection that used them was not shut down cleanly
+  if (!SSL_SESSION_is_resumable(session) ||
+      (UInt64)SSL_SESSION_get_time(session) + SSL_SESSION_get_timeout(session) <= (UInt64)now.seconds()) {
+    destroy(shard, entry);
+    _misses.inc();
+    return NULL;
+  }
+
+  _hits.inc();
+  shard._age.remove(entry);
+  shard._age.addLast(entry);
+  SSL_SESSION_up_ref(session);
+  return session;
+}
+
+Error TLSSessionCache::insert(const char *fqdn, const SocketAddress &peer, SSL_SESSION *session) {
+  if (!fqdn || !session) {
+    return ESB_NULL_POINTER;
+  }
+
+  if (0 == _maxSessionsPerShard) {
+    return ESB_INVALID_STATE;
+  }
+
+  if (!_shards) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  const Size length = strlen(fqdn);
+  if (ESB_MAX_HOSTNAME < length) {
+    return ESB_INVALID_ARGUMENT;
+  }
+
+  Shard &shard = this->shard(fqdn, peer);
+  const Key key(fqdn, &peer);
+  WriteScopeLock lock(shard._lock);
+
+  Entry *entry = (Entry *)shard._entries.find(&key);
+  if (entry) {
+    // A newer session for the same peer, e.g. a TLS 1.3 server's second ticket
+    SSL_SESSION_free(entry->_session);
+    entry->_session = session;
+    shard._age.remove(entry);
+    shard._age.addLast(entry);
+    return ESB_SUCCESS;
+  }
+
+  if (shard._entries.size() >= _maxSessionsPerShard) {
+    destroy(shard, (Entry *)shard._age.first());
+    _evictions.inc();
+  }
+
+  unsigned char *block = NULL;
+  Error error = _allocator.allocate(sizeof(Entry) + length + 1, (void **)&block);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  memcpy(block + sizeof(Entry), fqdn, length + 1);
+  entry = new (block) Entry(peer, session);
+
+  error = shard._entries.insert(&entry->_key, entry);
+  if (ESB_SUCCESS != error) {
+    entry->~Entry();
+    _allocator.deallocate(block);
+    return error;
+  }
+
+  shard._age.addLast(entry);
+  return ESB_SUCCESS;
+}
+
+void TLSSessionCache::clear() {
+  if (!_shards) {
+    return;
+  }
+
+  for (UInt32 i = 0; i < _numShards; ++i) {
+    Shard &shard = _shards[i];
+    WriteScopeLock lock(shard._lock);
+
+    for (Entry *entry = (Entry *)shard._age.first(); entry; entry = (Entry *)shard._age.first()) {
+      destroy(shard, entry);
+    }
+
+    assert(0 == shard._entries.size());
+  }
+}
+
+UInt32 TLSSessionCache::size() {
+  if (!_shards) {
+    return 0U;
+  }
+
+  UInt32 size = 0U;
+  for (UInt32 i = 0; i < _numShards; ++i) {
+    WriteScopeLock lock(_shards[i]._lock);
+    size += _shards[i]._entries.size();
+  }
+  return size;
+}
+
+TLSSessionCache::Shard &TLSSessionCache::shard(const char *fqdn, const SocketAddress &peer) {
+  // FNV-1a over the lowercased fqdn, mixed with the peer's address
+  UInt64 hash = 14695981039346656037ULL;
+  for (const char *p = fqdn; *p; ++p) {
+    const unsigned char c = *p;
+    hash ^= 'A' <= c && 'Z' >= c ? c + ('a' - 'A') : c;
+    hash *= 1099511628211ULL;
+  }
+  hash ^= peer.hash();
+  hash *= 1099511628211ULL;
+  return _shards[(hash >> 32) % _numShards];
+}
+
+void TLSSessionCache::destroy(Shard &shard, Entry *entry) {
+  assert(entry);
+  shard._entries.remove(&entry->_key);
+  shard._age.remove(entry);
+  SSL_SESSION_free(entry->_session);
+  entry->~Entry();
+  _allocator.deallocate(entry);
+}
+
+int TLSSessionCache::KeyComparator::compare(const void *first, const void *second) const {
+  const Key *a = (const Key *)first;
+  const Key *b = (const Key *)second;
+
+  int result = a->_peer->compare(*b->_peer);
+  if (0 != result) {
+    return result;
+  }
+
+  return strcasecmp(a->_fqdn, b->_fqdn);
+}
+
+}  // namespace ESB
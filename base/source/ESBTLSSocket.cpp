@@ -10,6 +10,10 @@
 #include <errno.h>
 #endif
 
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
 #include <openssl/err.h>
 #include <openssl/ssl.h>
 
@@ -28,15 +32,20 @@ class TLSInitializer {
 static TLSInitializer Initializer;
 
 TLSSocket::TLSSocket(const Socket::State &acceptState, const char *namePrefix)
-    : ConnectedSocket(acceptState, namePrefix), _ssl(NULL), _bio(NULL) {}
+    : ConnectedSocket(acceptState, namePrefix), _ssl(NULL), _bio(NULL), _pendingWrite(0) {}
 
 TLSSocket::TLSSocket(const char *namePrefix, bool isBlocking)
-    : ConnectedSocket(namePrefix, isBlocking), _ssl(NULL), _bio(NULL) {}
+    : ConnectedSocket(namePrefix, isBlocking), _ssl(NULL), _bio(NULL), _pendingWrite(0) {}
 
 TLSSocket::~TLSSocket() { close(); }
 
 bool TLSSocket::secure() const { return true; }
 
+int TLSSocket::ExDataIndex() {
+  static const int Index = SSL_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+  return Index;
+}
+
 void TLSSocket::close() {
   if (_ssl) {
     if (_flags & ESB_TLS_FLAG_ESTABLISHED) {
@@ -54,6 +63,7 @@ void TLSSocket::close() {
   }
 
   _flags &= ~ESB_TLS_FLAG_ALL;
+  _pendingWrite = 0;
   ConnectedSocket::close();
 }
 
@@ -115,9 +125,24 @@ SSize TLSSocket::send(const char *buffer, Size bufferSize) {
 
   assert(ESB_TLS_FLAG_ESTABLISHED & _flags);
 
+  //
+  // A write that blocked must be retried with the same bytes and length.  The caller still holds those bytes at the
+  // start of what it offers (maybe moved and with more after them), so only that much is offered to OpenSSL again.
+  //
+
+  if (0 < _pendingWrite) {
+    assert(_pendingWrite <= bufferSize);
+    if (bufferSize < _pendingWrite) {
+      errno = ESB_INVALID_STATE;
+      return -1;
+    }
+    bufferSize = _pendingWrite;
+  }
+
   int ret = SSL_write(_ssl, buffer, bufferSize);
   if (0 < ret) {
     ESB_LOG_DEBUG("[%s] wrote %d TLS bytes", name(), ret);
+    _pendingWrite = 0;
     return ret;
   }
 
@@ -126,6 +151,7 @@ SSize TLSSocket::send(const char *buffer, Size bufferSize) {
       ESB_LOG_DEBUG("[%s] peer closed TLS connection", name());
       return 0;
     case SSL_ERROR_WANT_WRITE:
+      _pendingWrite = bufferSize;
       errno = ESB_AGAIN;
       return -1;
     case SSL_ERROR_SYSCALL:
@@ -139,6 +165,93 @@ SSize TLSSocket::send(const char *buffer, Size bufferSize) {
   }
 }
 
+SSize TLSSocket::send(const struct iovec *segments, int segmentCount) {
+  //
+  // SSL_write has no vectored variant and emits at least one record per call, so small segments (e.g., headers and
+  // chunk framing) are coalesced into full records before they are written.  Segments that can fill a record on their
+  // own are written directly a record at a time.  Either way the record's length only depends on the bytes offered,
+  // so a write that blocked is offered again with the same length even though the record buffer is a temporary.
+  //
+
+  char record[ESB_TLS_MAX_RECORD_SIZE];
+  Size recordSize = 0;
+  Size limit = sizeof(record);
+  SSize total = 0;
+
+  if (0 < _pendingWrite) {
+    // Larger writes can only be repeated from a single segment
+    if (sizeof(record) < _pendingWrite && (0 >= segmentCount || segments[0].iov_len < _pendingWrite)) {
+      errno = ESB_INVALID_STATE;
+      return -1;
+    }
+    limit = _pendingWrite;
+  }
+
+  for (int i = 0; i < segmentCount; ++i) {
+    const char *data = (const char *)segments[i].iov_base;
+    Size remaining = segments[i].iov_len;
+
+    while (0 < remaining) {
+      if (0 == recordSize && limit <= remaining) {
+        SSize sent = send(data, limit);
+        if (0 >= sent) {
+          return 0 < total ? total : sent;
+        }
+        total += sent;
+        if ((Size)sent < limit) {
+          return total;
+        }
+        data += sent;
+        remaining -= sent;
+        limit = sizeof(record);
+        continue;
+      }
+
+      Size size = MIN(limit - recordSize, remaining);
+      memcpy(record + recordSize, data, size);
+      recordSize += size;
+      data += size;
+      remaining -= size;
+
+      if (limit == recordSize) {
+        SSize sent = send(record, recordSize);
+        if (0 >= sent) {
+          return 0 < total ? total : sent;
+        }
+        total += sent;
+        if ((Size)sent < recordSize) {
+          return total;
+        }
+        recordSize = 0;
+        limit = sizeof(record);
+      }
+    }
+  }
+
+  if (0 < recordSize) {
+    SSize sent = send(record, recordSize);
+    if (0 >= sent) {
+      return 0 < total ? total : sent;
+    }
+    total += sent;
+  }
+
+  return total;
+}
+
+Error TLSSocket::handshake() {
+  if (ESB_TLS_FLAG_DEAD & _flags) {
+    return ESB_INVALID_STATE;
+  }
+
+  if (ESB_TLS_FLAG_ESTABLISHED & _flags) {
+    return ESB_SUCCESS;
+  }
+
+  _flags &= ~(ESB_TLS_FLAG_WANT_READ | ESB_TLS_FLAG_WANT_WRITE);
+  return startHandshake();
+}
+
 bool TLSSocket::wantRead() { return _flags & ESB_TLS_FLAG_WANT_READ; }
 
 bool TLSSocket::wantWrite() { return _flags & ESB_TLS_FLAG_WANT_WRITE; }
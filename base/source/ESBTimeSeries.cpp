@@ -10,8 +10,12 @@
 #include <ESBReadScopeLock.h>
 #endif
 
-#ifndef ESB_SIMPLE_PERFORMANCE_COUNTER_H
-#include <ESBSimplePerformanceCounter.h>
+#ifndef ESB_HISTOGRAM_PERFORMANCE_COUNTER_H
+#include <ESBHistogramPerformanceCounter.h>
+#endif
+
+#ifndef ESB_MONOTONIC_TIME_SOURCE_H
+#include <ESBMonotonicTimeSource.h>
 #endif
 
 #ifndef ESB_LOGGER_H
@@ -30,25 +34,27 @@ TimeSeries::TimeSeries(const char *name, UInt16 maxWindows, UInt16 windowSizeSec
       _maxWindows(maxWindows),
       _windowSizeSec(windowSizeSec),
       _name(name),
+      _totalQueries(0U),
+      _totalMicroSeconds(0U),
       _lock(),
       _list(),
       _allocator(allocator) {}
 
 TimeSeries::~TimeSeries() {
-  SimplePerformanceCounter *previous = 0;
-  SimplePerformanceCounter *current = (SimplePerformanceCounter *)_list.first();
+  HistogramPerformanceCounter *previous = 0;
+  HistogramPerformanceCounter *current = (HistogramPerformanceCounter *)_list.first();
 
   while (current) {
     previous = current;
-    current = (SimplePerformanceCounter *)current->next();
-    previous->~SimplePerformanceCounter();
+    current = (HistogramPerformanceCounter *)current->next();
+    previous->~HistogramPerformanceCounter();
     _allocator.deallocate(previous);
   }
 }
 
 void TimeSeries::record(const Date &start, const Date &stop) {
   WriteScopeLock lock(_lock);
-  SimplePerformanceCounter *counter = (SimplePerformanceCounter *)_list.last();
+  HistogramPerformanceCounter *counter = (HistogramPerformanceCounter *)_list.last();
 
   if (!counter || counter->windowStop() < stop) {
     // We're in a new window.
@@ -57,13 +63,13 @@ void TimeSeries::record(const Date &start, const Date &stop) {
     Date windowStop(windowStart.seconds() + _windowSizeSec, 0);
 
     if (_currentWindows >= _maxWindows) {
-      counter = (SimplePerformanceCounter *)_list.removeFirst();
+      counter = (HistogramPerformanceCounter *)_list.removeFirst();
       assert(counter);
       // reuse the oldest counter's memory for the new counter.
-      counter->~SimplePerformanceCounter();
-      counter = new (counter) SimplePerformanceCounter(_name, windowStart, windowStop);
+      counter->~HistogramPerformanceCounter();
+      counter = new (counter) HistogramPerformanceCounter(_name, windowStart, windowStop, 1U, _allocator);
     } else {
-      counter = new (_allocator) SimplePerformanceCounter(_name, windowStart, windowStop);
+      counter = new (_allocator) HistogramPerformanceCounter(_name, windowStart, windowStop, 1U, _allocator);
       if (!counter) {
         ESB_LOG_WARNING("Cannot allocate memory for new window");
         return;
@@ -75,6 +81,12 @@ void TimeSeries::record(const Date &start, const Date &stop) {
   }
 
   counter->record(start, stop);
+
+  ++_totalQueries;
+  if (start < stop) {
+    const Date diff(stop - start);
+    _totalMicroSeconds += diff.seconds() * ESB_UINT64_C(1000000) + diff.microSeconds();
+  }
 }
 
 UInt32 TimeSeries::queries() const {
@@ -82,19 +94,40 @@ UInt32 TimeSeries::queries() const {
 
   UInt32 queries = 0;
 
-  for (const SimplePerformanceCounter *counter = (const SimplePerformanceCounter *)_list.first(); counter;
-       counter = (const SimplePerformanceCounter *)counter->next()) {
+  for (const HistogramPerformanceCounter *counter = (const HistogramPerformanceCounter *)_list.first(); counter;
+       counter = (const HistogramPerformanceCounter *)counter->next()) {
     queries += counter->queries();
   }
 
   return queries;
 }
 
+void TimeSeries::snapshot(Snapshot *snapshot) const {
+  const Date now(MonotonicTimeSource::Instance().now());
+  ReadScopeLock lock(_lock);
+
+  const HistogramPerformanceCounter *window = (const HistogramPerformanceCounter *)_list.last();
+  if (window && now < window->windowStop() && window->previous()) {
+    // The last window is still filling up
+    window = (const HistogramPerformanceCounter *)window->previous();
+  }
+
+  if (window) {
+    window->snapshot(snapshot);
+  } else {
+    memset(snapshot, 0, sizeof(Snapshot));
+    snapshot->_hasPercentiles = true;
+  }
+
+  snapshot->_queries = _totalQueries;
+  snapshot->_sumMSec = _totalMicroSeconds / 1000.0;
+}
+
 void TimeSeries::log(Logger &logger, Logger::Severity severity) const {
   ReadScopeLock lock(_lock);
 
-  for (SimplePerformanceCounter *counter = (SimplePerformanceCounter *)_list.first(); counter;
-       counter = (SimplePerformanceCounter *)counter->next()) {
+  for (HistogramPerformanceCounter *counter = (HistogramPerformanceCounter *)_list.first(); counter;
+       counter = (HistogramPerformanceCounter *)counter->next()) {
     counter->log(logger, severity);
   }
 }
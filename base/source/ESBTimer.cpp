@@ -10,4 +10,6 @@ Timer::Timer(void *context) : _tick(-1), _context(context) {}
 
 Timer::~Timer() {}
 
+void Timer::handleExpiration() {}
+
 }  // namespace ESB
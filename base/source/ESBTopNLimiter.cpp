@@ -0,0 +1,199 @@
+#ifndef ESB_TOP_N_LIMITER_H
+#include <ESBTopNLimiter.h>
+#endif
+
+#ifndef ESB_SHARED_INT_H
+#include <ESBSharedInt.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+namespace ESB {
+
+#ifdef HAVE_THREAD_LOCAL_STORAGE
+// 1 + the calling thread's position in the order threads first used any top n limiter, or 0 if it never has
+static __thread UInt32 ThreadIndex = 0;
+#else
+#error "__thread or equivalent is required"
+#endif
+
+static SharedInt ThreadCount;
+
+static UInt32 RoundUpToPowerOf2(UInt32 value) {
+  UInt32 power = 1U;
+  while (power < value && power < (1U << 31)) {
+    power <<= 1;
+  }
+  return power;
+}
+
+// A bijection, so distinct keys never share a hash.  0 marks an unused slot, so the key that hashes to 0 shares a
+// slot with the one that hashes to 1.
+static UInt64 HashKey(UInt64 key) {
+  key ^= key >> 30;
+  key *= ESB_UINT64_C(0xbf58476d1ce4e5b9);
+  key ^= key >> 27;
+  key *= ESB_UINT64_C(0x94d049bb133111eb);
+  key ^= key >> 31;
+  return key ? key : 1U;
+}
+
+TopNLimiter::TopNLimiter(UInt32 n, UInt64 threshold, UInt64 windowMicroSeconds, UInt32 shards, Allocator &allocator)
+    : _n(MAX(n, 1U)),
+      _threshold(threshold),
+      _windowMicroSeconds(MAX(windowMicroSeconds, 1U)),
+      _shardCount(MAX(shards, 1U)),
+      _shardSize(ESB_ALIGN(sizeof(Shard), ESB_CACHE_LINE_SIZE)),
+      _heavyMask(RoundUpToPowerOf2(2U * _n) - 1U),
+      _heavyHitters(0U),
+      _nextMerge(0U),
+      _mergeLock(),
+      _merged(_n, allocator),
+      _block(NULL),
+      _shards(NULL),
+      _allocator(allocator) {
+  const Size shardsSize = _shardCount * _shardSize;
+  const Size heavySize = (Size)_shardCount * (_heavyMask + 1U) * sizeof(UInt64);
+
+  if (0U == _merged.capacity()) {
+    return;
+  }
+
+  Error error = _allocator.allocate(shardsSize + heavySize + ESB_CACHE_LINE_SIZE, (void **)&_block);
+  if (ESB_SUCCESS != error) {
+    // _shards will be checked in later functions
+    _block = NULL;
+    return;
+  }
+
+  unsigned char *shardsStart = (unsigned char *)ESB_ALIGN((UWord)_block, ESB_CACHE_LINE_SIZE);
+  UInt64 *heavy = (UInt64 *)(shardsStart + shardsSize);
+  memset(heavy, 0, heavySize);
+
+  bool allocated = true;
+  for (UInt32 i = 0; i < _shardCount; ++i) {
+    Shard *shard = new (shardsStart + i * _shardSize) Shard(_n, heavy + (Size)i * (_heavyMask + 1U), _allocator);
+    allocated = allocated && 0U < shard->_summary.capacity();
+  }
+
+  _shards = shardsStart;
+
+  if (!allocated) {
+    for (UInt32 i = 0; i < _shardCount; ++i) {
+      shardAt(i)->~Shard();
+    }
+    _allocator.deallocate(_block);
+    _block = NULL;
+    _shards = NULL;
+  }
+}
+
+TopNLimiter::~TopNLimiter() {
+  if (_block) {
+    for (UInt32 i = 0; i < _shardCount; ++i) {
+      shardAt(i)->~Shard();
+    }
+    _allocator.deallocate(_block);
+    _block = NULL;
+    _shards = NULL;
+  }
+}
+
+Error TopNLimiter::acquire(UInt64 key, UInt32 slots, const Date &now) {
+  if (!_shards) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  const UInt64 nowMicroSeconds = (UInt64)now.seconds() * ESB_UINT64_C(1000000) + now.microSeconds();
+  UInt64 nextMerge = __atomic_load_n(&_nextMerge, __ATOMIC_RELAXED);
+
+  if (0U == nextMerge) {
+    __atomic_compare_exchange_n(&_nextMerge, &nextMerge, nowMicroSeconds + _windowMicroSeconds, false,
+                                __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+  } else if (nowMicroSeconds >= nextMerge && ESB_SUCCESS == _mergeLock.writeAttempt()) {
+    // Whoever gets here first ends the window, everyone else carries on counting
+    if (nowMicroSeconds >= __atomic_load_n(&_nextMerge, __ATOMIC_RELAXED)) {
+      __atomic_store_n(&_nextMerge, nowMicroSeconds + _windowMicroSeconds, __ATOMIC_RELAXED);
+      mergeShards();
+    }
+    _mergeLock.writeRelease();
+  }
+
+  if (0 == ThreadIndex) {
+    ThreadIndex = ThreadCount.inc();
+  }
+
+  Shard *shard = shardAt((ThreadIndex - 1U) % _shardCount);
+
+  shard->_lock.writeAcquire();
+  const UInt64 seen = shard->_summary.add(key, slots);
+  const bool heavy = seen > _threshold || isHeavy(shard, key);
+  shard->_lock.writeRelease();
+
+  return heavy ? ESB_OVERFLOW : ESB_SUCCESS;
+}
+
+void TopNLimiter::merge() {
+  if (!_shards) {
+    return;
+  }
+
+  _mergeLock.writeAcquire();
+  mergeShards();
+  _mergeLock.writeRelease();
+}
+
+void TopNLimiter::mergeShards() {
+  _merged.clear();
+
+  for (UInt32 i = 0; i < _shardCount; ++i) {
+    Shard *shard = shardAt(i);
+    shard->_lock.writeAcquire();
+    _merged.merge(shard->_summary);
+    shard->_summary.clear();
+    shard->_lock.writeRelease();
+  }
+
+  UInt32 heavyHitters = 0U;
+  for (UInt32 i = 0; i < _merged.size(); ++i) {
+    heavyHitters += _merged.count(i) - _merged.error(i) > _threshold ? 1U : 0U;
+  }
+  __atomic_store_n(&_heavyHitters, heavyHitters, __ATOMIC_RELAXED);
+
+  for (UInt32 i = 0; i < _shardCount; ++i) {
+    Shard *shard = shardAt(i);
+    shard->_lock.writeAcquire();
+    memset(shard->_heavy, 0, (_heavyMask + 1U) * sizeof(UInt64));
+
+    for (UInt32 j = 0; j < _merged.size(); ++j) {
+      if (_merged.count(j) - _merged.error(j) <= _threshold) {
+        continue;
+      }
+
+      const UInt64 hash = HashKey(_merged.key(j));
+      UInt32 slot = (UInt32)hash & _heavyMask;
+      while (shard->_heavy[slot] && shard->_heavy[slot] != hash) {
+        slot = (slot + 1U) & _heavyMask;
+      }
+      shard->_heavy[slot] = hash;
+    }
+
+    shard->_lock.writeRelease();
+  }
+}
+
+bool TopNLimiter::isHeavy(const Shard *shard, UInt64 key) const {
+  const UInt64 hash = HashKey(key);
+
+  for (UInt32 slot = (UInt32)hash & _heavyMask; shard->_heavy[slot]; slot = (slot + 1U) & _heavyMask) {
+    if (shard->_heavy[slot] == hash) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+}  // namespace ESB
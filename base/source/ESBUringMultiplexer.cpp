@@ -0,0 +1,936 @@
+#ifndef ESB_URING_MULTIPLEXER_H
+#include <ESBUringMultiplexer.h>
+#endif
+
+#ifdef HAVE_IO_URING
+
+#ifndef ESB_LOGGER_H
+#include <ESBLogger.h>
+#endif
+
+#ifndef ESB_MONOTONIC_TIME_SOURCE_H
+#include <ESBMonotonicTimeSource.h>
+#endif
+
+#ifndef ESB_ERROR_H
+#include <ESBError.h>
+#endif
+
+#ifndef ESB_CONNECTED_SOCKET_H
+#include <ESBConnectedSocket.h>
+#endif
+
+#ifndef ESB_MULTIPLEXED_SOCKET_H
+#include <ESBMultiplexedSocket.h>
+#endif
+
+#ifndef ESB_TYPES_H
+#include <ESBTypes.h>
+#endif
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#ifdef HAVE_SYS_SYSCALL_H
+#include <sys/syscall.h>
+#endif
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+
+#ifdef HAVE_POLL_H
+#include <poll.h>
+#endif
+
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+
+#ifndef HAVE_MMAP
+#error "mmap() or equivalent is required"
+#endif
+
+#ifndef HAVE_MUNMAP
+#error "munmap() or equivalent is required"
+#endif
+
+#ifndef HAVE_CLOSE
+#error "close() or equivalent is required"
+#endif
+
+#ifndef HAVE_MEMSET
+#error "memset() or equivalent is required"
+#endif
+
+namespace ESB {
+
+static const UInt32 MAX_TIMEOUT_MSEC = 30 * 60 * 1000;  // 30 min
+static const UInt32 MIN_TIMEOUT_MSEC = 10;              // 10 msec
+static const UInt32 MAX_RING_ENTRIES = 4096;
+static const UInt32 MAX_COMPLETION_ENTRIES = 65536;  // the kernel's limit, twice its submission limit
+static const UInt64 TIMEOUT_USER_DATA = ESB_UINT64_MAX;
+static const UInt64 IGNORE_USER_DATA = ESB_UINT64_MAX - 1;
+
+static inline int IoUringSetup(UInt32 entries, struct io_uring_params *params) {
+  return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static inline int IoUringEnter(int ringDescriptor, UInt32 toSubmit, UInt32 minComplete, UInt32 flags) {
+  return (int)syscall(__NR_io_uring_enter, ringDescriptor, toSubmit, minComplete, flags, NULL, 0);
+}
+
+static inline UInt64 UserData(UInt32 registration, UInt32 generation) {
+  return (((UInt64)generation) << 32) | registration;
+}
+
+static UInt32 Interests(MultiplexedSocket *socket) {
+  UInt32 interests = POLLERR;
+
+  if (socket->wantAccept()) {
+    interests |= POLLIN;
+  } else if (socket->wantConnect()) {
+    interests |= POLLIN | POLLOUT | POLLHUP;
+  } else {
+    if (socket->wantWrite()) {
+      interests |= POLLOUT | POLLHUP;
+    }
+    if (socket->wantRead()) {
+      interests |= POLLIN | POLLHUP;
+    }
+  }
+
+  return interests;
+}
+
+UringMultiplexer::UringMultiplexer(const char *namePrefix, UInt32 idleTimeoutMsec, UInt32 maxSockets,
+                                   Allocator &allocator)
+    : SocketMultiplexer(),
+      _ringDescriptor(INVALID_SOCKET),
+      _idleTimeoutMsec(0 == idleTimeoutMsec ? 0 : MIN(MAX(idleTimeoutMsec, MIN_TIMEOUT_MSEC), MAX_TIMEOUT_MSEC)),
+      _maxSockets(MAX(maxSockets, 1)),
+      _sqEntries(0),
+      _cqEntries(0),
+      _sqeTail(0),
+      _freeRegistration(0),
+      _sqRing(MAP_FAILED),
+      _sqRingSize(0),
+      _cqRing(MAP_FAILED),
+      _cqRingSize(0),
+      _sqes((struct io_uring_sqe *)MAP_FAILED),
+      _sqHead(NULL),
+      _sqTail(NULL),
+      _sqMask(NULL),
+      _sqArray(NULL),
+      _cqHead(NULL),
+      _cqTail(NULL),
+      _cqMask(NULL),
+      _cqes(NULL),
+      _events(NULL),
+      _registrations(NULL),
+      _timeoutArmed(false),
+      _isRunning(NULL),
+      _allocator(allocator),
+      _submissions(0),
+      _enters(0),
+      _avoidedInterestUpdates(0),
+      _activeSocketCount(),
+      _activeSockets(),
+      _deadSockets(),
+      _timingWheel(MAX_TIMEOUT_MSEC * 2 / MIN_TIMEOUT_MSEC, MIN_TIMEOUT_MSEC, MonotonicTimeSource::Instance().now(),
+                   _allocator),
+      _timers(MAX_TIMEOUT_MSEC * 2 / MIN_TIMEOUT_MSEC, MIN_TIMEOUT_MSEC, MonotonicTimeSource::Instance().now(),
+              _allocator),
+      _counters(_namePrefix) {
+  strncpy(_namePrefix, namePrefix, sizeof(_namePrefix));
+  _namePrefix[sizeof(_namePrefix) - 1] = 0;
+
+  // Wake up at least once a second to expire idle sockets, even if nothing else is happening.
+  const UInt32 waitMsec = 0 == _idleTimeoutMsec ? 1000 : MIN(_idleTimeoutMsec, 1000);
+  _timeout.tv_sec = waitMsec / 1000;
+  _timeout.tv_nsec = (waitMsec % 1000) * 1000000L;
+
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+
+  // Every socket keeps a poll outstanding and a removal can complete both the poll and the remove, so size the
+  // completion ring for two completions per socket instead of the default of two per submission entry.
+  const UInt32 sqEntries = MIN(_maxSockets, MAX_RING_ENTRIES);
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = MIN(MAX(sqEntries, _maxSockets) * 2, MAX_COMPLETION_ENTRIES);
+
+  _ringDescriptor = IoUringSetup(sqEntries, &params);
+  if (0 > _ringDescriptor) {
+    _ringDescriptor = INVALID_SOCKET;
+    ESB_LOG_CRITICAL_ERRNO(LastError(), "[%s] cannot create io_uring descriptor", name());
+    return;
+  }
+
+  // Past MAX_COMPLETION_ENTRIES the ring can still fill, and without NODROP the kernel would silently drop the poll
+  // completions of the sockets that did not fit.
+  if (!(params.features & IORING_FEAT_NODROP)) {
+    ESB_LOG_CRITICAL("[%s] io_uring cannot buffer completion overflows", name());
+    closeRing();
+    return;
+  }
+
+  _sqEntries = params.sq_entries;
+  _cqEntries = params.cq_entries;
+  _sqRingSize = params.sq_off.array + params.sq_entries * sizeof(UInt32);
+  _cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    _sqRingSize = MAX(_sqRingSize, _cqRingSize);
+    _cqRingSize = _sqRingSize;
+  }
+
+  _sqRing = mmap(0, _sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringDescriptor, IORING_OFF_SQ_RING);
+  if (MAP_FAILED == _sqRing) {
+    ESB_LOG_CRITICAL_ERRNO(LastError(), "[%s] cannot map io_uring submission ring", name());
+    closeRing();
+    return;
+  }
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    _cqRing = _sqRing;
+  } else {
+    _cqRing =
+        mmap(0, _cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, _ringDescriptor, IORING_OFF_CQ_RING);
+    if (MAP_FAILED == _cqRing) {
+      ESB_LOG_CRITICAL_ERRNO(LastError(), "[%s] cannot map io_uring completion ring", name());
+      closeRing();
+      return;
+    }
+  }
+
+  _sqes = (struct io_uring_sqe *)mmap(0, params.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                                      MAP_SHARED | MAP_POPULATE, _ringDescriptor, IORING_OFF_SQES);
+  if (MAP_FAILED == _sqes) {
+    ESB_LOG_CRITICAL_ERRNO(LastError(), "[%s] cannot map io_uring submission entries", name());
+    closeRing();
+    return;
+  }
+
+  _sqHead = (UInt32 *)((char *)_sqRing + params.sq_off.head);
+  _sqTail = (UInt32 *)((char *)_sqRing + params.sq_off.tail);
+  _sqMask = (UInt32 *)((char *)_sqRing + params.sq_off.ring_mask);
+  _sqArray = (UInt32 *)((char *)_sqRing + params.sq_off.array);
+  _cqHead = (UInt32 *)((char *)_cqRing + params.cq_off.head);
+  _cqTail = (UInt32 *)((char *)_cqRing + params.cq_off.tail);
+  _cqMask = (UInt32 *)((char *)_cqRing + params.cq_off.ring_mask);
+  _cqes = (struct io_uring_cqe *)((char *)_cqRing + params.cq_off.cqes);
+  _sqeTail = *_sqTail;
+
+  Error error = _allocator.allocate(sizeof(struct Event) * _cqEntries, (void **)&_events);
+  if (ESB_SUCCESS != error) {
+    _events = NULL;
+    closeRing();
+    ESB_LOG_CRITICAL_ERRNO(ESB_OUT_OF_MEMORY, "[%s] cannot create %u io_uring events", name(), _cqEntries);
+    return;
+  }
+
+  error = _allocator.allocate(sizeof(struct Registration) * _maxSockets, (void **)&_registrations);
+  if (ESB_SUCCESS != error) {
+    _registrations = NULL;
+    _allocator.deallocate(_events);
+    // _events will be checked in later functions
+    _events = NULL;
+    closeRing();
+    ESB_LOG_CRITICAL_ERRNO(ESB_OUT_OF_MEMORY, "[%s] cannot create %u registrations", name(), _maxSockets);
+    return;
+  }
+
+  for (UInt32 i = 0; i < _maxSockets; ++i) {
+    _registrations[i]._socket = NULL;
+    _registrations[i]._generation = 0;
+    _registrations[i]._next = i + 1;
+    _registrations[i]._armed = false;
+  }
+}
+
+UringMultiplexer::~UringMultiplexer() {
+  closeRing();
+
+  if (_events) {
+    _allocator.deallocate(_events);
+    _events = NULL;
+  }
+
+  if (_registrations) {
+    _allocator.deallocate(_registrations);
+    _registrations = NULL;
+  }
+}
+
+bool UringMultiplexer::Available() {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = 2;
+
+  int ringDescriptor = IoUringSetup(1, &params);
+  if (0 > ringDescriptor) {
+    return false;
+  }
+
+  close(ringDescriptor);
+  return params.features & IORING_FEAT_NODROP;
+}
+
+CleanupHandler *UringMultiplexer::cleanupHandler() { return NULL; }
+
+void UringMultiplexer::closeRing() {
+  if (MAP_FAILED != (void *)_sqes) {
+    munmap(_sqes, _sqEntries * sizeof(struct io_uring_sqe));
+    _sqes = (struct io_uring_sqe *)MAP_FAILED;
+  }
+
+  if (MAP_FAILED != _cqRing && _cqRing != _sqRing) {
+    munmap(_cqRing, _cqRingSize);
+  }
+  _cqRing = MAP_FAILED;
+
+  if (MAP_FAILED != _sqRing) {
+    munmap(_sqRing, _sqRingSize);
+    _sqRing = MAP_FAILED;
+  }
+
+  if (INVALID_SOCKET != _ringDescriptor) {
+    close(_ringDescriptor);
+    _ringDescriptor = INVALID_SOCKET;
+  }
+}
+
+struct io_uring_sqe *UringMultiplexer::acquireSubmission() {
+  if (_sqeTail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE) >= _sqEntries) {
+    // The submission ring is full, hand what we have to the kernel without waiting for completions.
+    submit(0);
+    if (_sqeTail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE) >= _sqEntries) {
+      return NULL;
+    }
+  }
+
+  const UInt32 index = _sqeTail & *_sqMask;
+  struct io_uring_sqe *sqe = &_sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+  _sqArray[index] = index;
+  ++_sqeTail;
+  return sqe;
+}
+
+Error UringMultiplexer::submit(UInt32 minCompletions) {
+  __atomic_store_n(_sqTail, _sqeTail, __ATOMIC_RELEASE);
+  const UInt32 toSubmit = _sqeTail - __atomic_load_n(_sqHead, __ATOMIC_ACQUIRE);
+
+  if (0 == toSubmit && 0 == minCompletions) {
+    return ESB_SUCCESS;
+  }
+
+  ++_enters;
+  int result = IoUringEnter(_ringDescriptor, toSubmit, minCompletions, 0 < minCompletions ? IORING_ENTER_GETEVENTS : 0);
+  if (0 > result) {
+    return LastError();
+  }
+
+  _submissions += result;
+  return ESB_SUCCESS;
+}
+
+UInt32 UringMultiplexer::reap() {
+  UInt32 head = *_cqHead;
+  const UInt32 tail = __atomic_load_n(_cqTail, __ATOMIC_ACQUIRE);
+  UInt32 numEvents = 0;
+
+  for (; head != tail && numEvents < _cqEntries; ++head) {
+    const struct io_uring_cqe *cqe = &_cqes[head & *_cqMask];
+
+    if (TIMEOUT_USER_DATA == cqe->user_data) {
+      _timeoutArmed = false;
+      continue;
+    }
+
+    if (IGNORE_USER_DATA == cqe->user_data) {
+      continue;
+    }
+
+    const UInt32 index = (UInt32)(cqe->user_data & 0xFFFFFFFF);
+    const UInt32 generation = (UInt32)(cqe->user_data >> 32);
+
+    assert(index < _maxSockets);
+    if (index >= _maxSockets) {
+      continue;
+    }
+
+    Registration &registration = _registrations[index];
+
+    if (!registration._socket || registration._generation != generation) {
+      // A poll request that was cancelled or superseded after it completed.
+      continue;
+    }
+
+    registration._armed = false;
+
+    if (0 > cqe->res) {
+      if (-ECANCELED == cqe->res) {
+        continue;
+      }
+      ESB_LOG_DEBUG_ERRNO(ConvertError(-cqe->res), "[%s] poll request failed", registration._socket->name());
+      _events[numEvents]._events = POLLERR;
+    } else {
+      _events[numEvents]._events = cqe->res;
+    }
+
+    _events[numEvents]._socket = registration._socket;
+    ++numEvents;
+  }
+
+  __atomic_store_n(_cqHead, head, __ATOMIC_RELEASE);
+  return numEvents;
+}
+
+Error UringMultiplexer::arm(MultiplexedSocket *socket) {
+  Registration &registration = _registrations[socket->registration()];
+  assert(!registration._armed);
+
+  struct io_uring_sqe *sqe = acquireSubmission();
+  if (!sqe) {
+    return ESB_OVERFLOW;
+  }
+
+  const UInt32 interests = Interests(socket);
+
+  sqe->opcode = IORING_OP_POLL_ADD;
+  sqe->fd = socket->socketDescriptor();
+  sqe->poll32_events = interests;
+  sqe->user_data = UserData(socket->registration(), registration._generation);
+
+  registration._armed = true;
+  socket->setRegisteredInterests(interests);
+  return ESB_SUCCESS;
+}
+
+Error UringMultiplexer::disarm(MultiplexedSocket *socket) {
+  Registration &registration = _registrations[socket->registration()];
+
+  if (!registration._armed) {
+    return ESB_SUCCESS;
+  }
+
+  struct io_uring_sqe *sqe = acquireSubmission();
+  if (!sqe) {
+    return ESB_OVERFLOW;
+  }
+
+  sqe->opcode = IORING_OP_POLL_REMOVE;
+  sqe->fd = -1;
+  sqe->addr = UserData(socket->registration(), registration._generation);
+  sqe->user_data = IGNORE_USER_DATA;
+
+  // Any completion for the old poll request, including the cancellation itself, will now be ignored.
+  registration._armed = false;
+  ++registration._generation;
+  socket->setRegisteredInterests(0);
+  return ESB_SUCCESS;
+}
+
+Error UringMultiplexer::addMultiplexedSocket(MultiplexedSocket *socket) {
+  if (!_events) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  if (!socket) {
+    return ESB_NULL_POINTER;
+  }
+
+  SOCKET fd = socket->socketDescriptor();
+
+  assert(INVALID_SOCKET != fd);
+  if (INVALID_SOCKET == fd) {
+    return ESB_INVALID_ARGUMENT;
+  }
+
+  int currentSocketCount = _activeSocketCount.inc();
+
+  if ((UInt32)currentSocketCount > _maxSockets || _freeRegistration >= _maxSockets) {
+    ESB_LOG_ERROR("[%s] Cannot add socket: at limit of %d sockets", socket->name(), _maxSockets);
+    _activeSocketCount.dec();
+    return ESB_OVERFLOW;
+  }
+
+  if (0 < _idleTimeoutMsec && !socket->permanent()) {
+    Error error = _timingWheel.insert(&socket->timer(), _idleTimeoutMsec, MonotonicTimeSource::Instance().now());
+    if (ESB_SUCCESS != error) {
+      ESB_LOG_ERROR_ERRNO(error, "[%s] cannot add socket to timing wheel", socket->name());
+      _activeSocketCount.dec();
+      return error;
+    }
+    assert(socket->timer().inTimingWheel());
+  } else {
+    assert(!socket->timer().inTimingWheel());
+  }
+
+  const UInt32 index = _freeRegistration;
+  Registration &registration = _registrations[index];
+  _freeRegistration = registration._next;
+  registration._socket = socket;
+  registration._armed = false;
+  ++registration._generation;
+  socket->setRegistration(index);
+
+  _activeSockets.addLast(socket);
+  assert(_activeSockets.validate());
+
+  Error error = arm(socket);
+  if (ESB_SUCCESS != error) {
+    ESB_LOG_ERROR_ERRNO(error, "[%s] cannot add socket", socket->name());
+    _activeSockets.remove(socket);
+    assert(_activeSockets.validate());
+    registration._socket = NULL;
+    registration._next = _freeRegistration;
+    _freeRegistration = index;
+    if (socket->timer().inTimingWheel()) {
+      _timingWheel.remove(&socket->timer());
+    }
+    _activeSocketCount.dec();
+    return error;
+  }
+
+  ESB_LOG_DEBUG("[%s] added socket", socket->name());
+  return ESB_SUCCESS;
+}
+
+Error UringMultiplexer::updateMultiplexedSocket(MultiplexedSocket *socket) {
+  if (!_events) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  if (!socket) {
+    return ESB_NULL_POINTER;
+  }
+
+  assert(INVALID_SOCKET != socket->socketDescriptor());
+  if (INVALID_SOCKET == socket->socketDescriptor()) {
+    return ESB_INVALID_ARGUMENT;
+  }
+
+  assert(socket->registration() < _maxSockets);
+  assert(_registrations[socket->registration()]._socket == socket);
+
+  // Poll requests are one-shot, so a socket that just received an event always needs a new one.  A socket whose
+  // request is still outstanding only needs a new one if its interests changed.
+
+  if (_registrations[socket->registration()]._armed) {
+    if (socket->registeredInterests() == Interests(socket)) {
+      ++_avoidedInterestUpdates;
+      return ESB_SUCCESS;
+    }
+
+    Error error = disarm(socket);
+    if (ESB_SUCCESS != error) {
+      ESB_LOG_ERROR_ERRNO(error, "[%s] cannot update socket", socket->name());
+      return error;
+    }
+  }
+
+  Error error = arm(socket);
+  if (ESB_SUCCESS != error) {
+    ESB_LOG_ERROR_ERRNO(error, "[%s] cannot update socket", socket->name());
+    return error;
+  }
+
+  ESB_LOG_DEBUG("[%s] updated socket. wantRead=%s, wantWrite=%s", socket->name(), socket->wantRead() ? "true" : "false",
+                socket->wantWrite() ? "true" : "false");
+  return ESB_SUCCESS;
+}
+
+Error UringMultiplexer::removeMultiplexedSocket(MultiplexedSocket *socket) {
+  if (!_events) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  if (!socket) {
+    return ESB_NULL_POINTER;
+  }
+
+  assert(INVALID_SOCKET != socket->socketDescriptor());
+  if (INVALID_SOCKET == socket->socketDescriptor()) {
+    return ESB_INVALID_ARGUMENT;
+  }
+
+  assert(socket->registration() < _maxSockets);
+  assert(_registrations[socket->registration()]._socket == socket);
+
+  // The cancellation is submitted with the next batch.  Until then the kernel keeps its own reference to the socket
+  // so the descriptor can be safely closed and reused in the meantime.
+
+  Error error = disarm(socket);
+  if (ESB_SUCCESS != error) {
+    ESB_LOG_ERROR_ERRNO(error, "[%s] cannot remove socket", socket->name());
+    return error;
+  }
+
+  const UInt32 index = socket->registration();
+  Registration &registration = _registrations[index];
+  registration._socket = NULL;
+  ++registration._generation;
+  registration._next = _freeRegistration;
+  _freeRegistration = index;
+
+  _activeSockets.remove(socket);
+  assert(_activeSockets.validate());
+  if (socket->timer().inTimingWheel()) {
+    _timingWheel.remove(&socket->timer());
+    assert(!socket->timer().inTimingWheel());
+  }
+  _activeSocketCount.dec();
+  _deadSockets.addLast(socket);
+  socket->markDead();
+
+  ESB_LOG_DEBUG("[%s] removed socket", socket->name());
+  socket->handleRemove();
+
+  return ESB_SUCCESS;
+}
+
+void UringMultiplexer::destroy() {
+  ESB_LOG_DEBUG("[%s] destroying", name());
+
+  for (MultiplexedSocket *socket = (MultiplexedSocket *)_activeSockets.first(); socket;
+       socket = (MultiplexedSocket *)_activeSockets.first()) {
+    removeMultiplexedSocket(socket);
+  }
+
+  _timingWheel.clear();
+  _timers.clear();
+  _deadSockets.clear();
+  _activeSockets.clear();
+
+#ifndef NDEBUG
+  assert(_activeSocketCount.get() == (UInt32)_activeSockets.size());
+#endif
+
+  // Closing the ring cancels every outstanding request.
+  closeRing();
+
+  if (_events) {
+    _allocator.deallocate(_events);
+    _events = NULL;
+  }
+
+  if (_registrations) {
+    _allocator.deallocate(_registrations);
+    _registrations = NULL;
+  }
+
+  ESB_LOG_DEBUG("[%s] destroyed", name());
+}
+
+bool UringMultiplexer::run(SharedInt *isRunning) {
+  if (!_events) {
+    return false;
+  }
+
+  if (!isRunning) {
+    return false;
+  }
+
+  ESB_LOG_NOTICE("[%s] multiplexer thread started", name());
+
+  int errorCount = 0;
+  _isRunning = isRunning;
+
+  // When the loop last woke up.  Every iteration reads the clock just before and just after waiting.
+  Date wakeup = MonotonicTimeSource::Instance().update();
+
+  while (_isRunning->get()) {
+    checkIdleSockets();
+    checkTimers();
+
+    if (!_timeoutArmed) {
+      struct io_uring_sqe *sqe = acquireSubmission();
+      if (sqe) {
+        sqe->opcode = IORING_OP_TIMEOUT;
+        sqe->fd = -1;
+        sqe->addr = (UInt64)&_timeout;
+        sqe->len = 1;
+        sqe->user_data = TIMEOUT_USER_DATA;
+        _timeoutArmed = true;
+      }
+    }
+
+    // Submit every registration change queued by the last batch of handlers and wait for the next batch of events in
+    // the same system call.
+
+    const Date sleep = MonotonicTimeSource::Instance().read();
+    _counters.recordBusy(wakeup, sleep);
+
+    Error error = submit(1);
+
+    if (ESB_SUCCESS != error && ESB_INTR != error && ESB_AGAIN != error) {
+      ESB_LOG_ERROR_ERRNO(error, "[%s] error in io_uring_enter", name());
+
+      if (errorCount >= 10) {
+        ESB_LOG_CRITICAL("[%s] too many errors in io_uring_enter, exiting", name());
+        destroy();
+        MonotonicTimeSource::Instance().reset();
+        return false;
+      }
+
+      ++errorCount;
+    }
+
+    // Read the clock once per iteration.  Everything else on this thread uses the cached time.
+    wakeup = MonotonicTimeSource::Instance().update();
+
+    const UInt32 numEvents = reap();
+    _counters.recordWait(sleep, wakeup, numEvents);
+
+    if (0 == numEvents) {
+      continue;
+    }
+
+    // Dump a description of all events that will be processed in this loop before taking any action.
+
+    if (ESB_DEBUG_LOGGABLE) {
+      ESB_LOG_DEBUG("[%s] processing %u events", name(), numEvents);
+
+      for (UInt32 i = 0; i < numEvents; ++i) {
+        ESB_LOG_DEBUG("[%s] socket event 0x%x", _events[i]._socket->name(), _events[i]._events);
+      }
+    }
+
+    Date now = MonotonicTimeSource::Instance().now();
+
+    // Now take action
+
+    errorCount = 0;
+
+    for (UInt32 i = 0; i < numEvents; ++i) {
+      bool keepInMultiplexer = true;
+      MultiplexedSocket *socket = _events[i]._socket;
+      const UInt32 events = _events[i]._events;
+
+      if (socket->dead()) {
+        continue;
+      }
+
+      SOCKET fd = socket->socketDescriptor();
+      if (INVALID_SOCKET == fd) {
+        ESB_LOG_CRITICAL_ERRNO(ESB_INVALID_STATE, "[%s] received io_uring event after close", socket->name());
+        ESB::Logger::Instance().flush();
+      }
+      assert(INVALID_SOCKET != fd);
+
+      //
+      // Handle Listening Socket.  Same rules as the EpollMultiplexer.
+      //
+
+      if (socket->wantAccept()) {
+        if (events & POLLERR) {
+          ESB::Error error = Socket::LastSocketError(fd);
+          ESB_LOG_ERROR_ERRNO(error, "[%s] listening socket error", socket->name());
+          socket->handleError(error);
+          keepInMultiplexer = false;
+        } else if (events & POLLIN) {
+          const Date start = MonotonicTimeSource::Instance().read();
+          while (keepInMultiplexer) {
+            ESB::Error error = socket->handleAccept();
+            if (ESB_AGAIN == error) {
+              continue;
+            } else if (ESB_SUCCESS == error) {
+              break;
+            } else {
+              keepInMultiplexer = false;
+              break;
+            }
+          }
+          _counters.recordAccept(start, MonotonicTimeSource::Instance().read(), socket->name());
+        } else {
+          ESB_LOG_WARNING("[%s] listening socket unknown event %u", socket->name(), events);
+        }
+      }
+
+      //
+      //  Handle Connecting Socket
+      //
+
+      else if (socket->wantConnect()) {
+        if (events & POLLERR) {
+          ESB::Error error = Socket::LastSocketError(fd);
+          ESB_LOG_INFO_ERRNO(error, "[%s] connecting socket error", socket->name());
+          keepInMultiplexer = false;
+          socket->handleError(error);
+        } else if (events & POLLHUP) {
+          ESB_LOG_INFO("[%s] connected socket remote close", socket->name());
+          keepInMultiplexer = false;
+          socket->handleRemoteClose();
+        } else if (events & POLLIN) {
+          int bytesReadable = ConnectedSocket::BytesReadable(fd);
+
+          if (0 > bytesReadable) {
+            ESB::Error error = Socket::LastSocketError(fd);
+            ESB_LOG_INFO_ERRNO(error, "[%s] connecting socket error", socket->name());
+            keepInMultiplexer = false;
+            socket->handleError(error);
+          } else if (0 == bytesReadable) {
+            ESB_LOG_INFO("[%s] connecting socket remote close", socket->name());
+            keepInMultiplexer = false;
+            socket->handleRemoteClose();
+          } else {
+            ESB_LOG_INFO("[%s] socket connected", socket->name());
+            const Date start = MonotonicTimeSource::Instance().read();
+            ESB::Error error = socket->handleConnect();
+            _counters.recordConnect(start, MonotonicTimeSource::Instance().read(), socket->name());
+            keepInMultiplexer = ESB_AGAIN == error || ESB_PAUSE == error;
+          }
+        } else if (events & POLLOUT) {
+          ESB_LOG_INFO("[%s] socket connected", socket->name());
+          const Date start = MonotonicTimeSource::Instance().read();
+          ESB::Error error = socket->handleConnect();
+          _counters.recordConnect(start, MonotonicTimeSource::Instance().read(), socket->name());
+          keepInMultiplexer = ESB_AGAIN == error || ESB_PAUSE == error;
+        } else {
+          ESB_LOG_WARNING("[%s] connecting socket unknown event %u", socket->name(), events);
+        }
+      }
+
+      //
+      //  Handle Connected Socket
+      //
+
+      else {
+        if (events & POLLERR) {
+          ESB::Error error = Socket::LastSocketError(fd);
+          ESB_LOG_INFO_ERRNO(error, "[%s] socket error", socket->name());
+          keepInMultiplexer = false;
+          socket->handleError(error);
+        } else if (events & POLLHUP) {
+          ESB_LOG_INFO("[%s] socket remote close", socket->name());
+          keepInMultiplexer = false;
+          socket->handleRemoteClose();
+        } else {
+          if (events & POLLIN) {
+            if (socket->wantRead()) {
+              const Date start = MonotonicTimeSource::Instance().read();
+              ESB::Error error = socket->handleReadable();
+              _counters.recordReadable(start, MonotonicTimeSource::Instance().read(), socket->name());
+              keepInMultiplexer = ESB_AGAIN == error || ESB_PAUSE == error;
+            } else {
+              _counters.countSpuriousReadable();
+            }
+          }
+
+          if (keepInMultiplexer && (events & POLLOUT)) {
+            if (socket->wantWrite()) {
+              const Date start = MonotonicTimeSource::Instance().read();
+              ESB::Error error = socket->handleWritable();
+              _counters.recordWritable(start, MonotonicTimeSource::Instance().read(), socket->name());
+              keepInMultiplexer = ESB_AGAIN == error || ESB_PAUSE == error;
+            } else {
+              _counters.countSpuriousWritable();
+            }
+          }
+        }
+      }
+
+      if (!keepInMultiplexer) {
+        removeMultiplexedSocket(socket);
+        continue;
+      }
+
+      assert(INVALID_SOCKET != socket->socketDescriptor());
+
+      if (socket->permanent() || 0 == _idleTimeoutMsec) {
+        updateMultiplexedSocket(socket);
+        continue;
+      }
+
+      ESB::Error error = _timingWheel.update(&socket->timer(), _idleTimeoutMsec, now);
+      switch (error) {
+        case ESB_SUCCESS:
+          updateMultiplexedSocket(socket);
+          break;
+        case ESB_UNDERFLOW:
+          socket->handleIdle();
+          removeMultiplexedSocket(socket);
+          break;
+        default:
+          ESB_LOG_ERROR_ERRNO(error, "[%s] cannot update timing wheel", socket->name());
+          removeMultiplexedSocket(socket);
+      }
+    }
+
+    if (!_deadSockets.isEmpty()) {
+      const Date start = MonotonicTimeSource::Instance().read();
+      for (MultiplexedSocket *socket = (MultiplexedSocket *)_deadSockets.removeFirst(); socket;
+           socket = (MultiplexedSocket *)_deadSockets.removeFirst()) {
+        CleanupHandler *cleanupHandler = socket->cleanupHandler();
+        if (cleanupHandler) {
+          cleanupHandler->destroy(socket);
+        }
+      }
+      _counters.recordCleanup(start, MonotonicTimeSource::Instance().read());
+    }
+  }
+
+  ESB_LOG_NOTICE("[%s] multiplexer thread stopped, io_uring_enter calls: %lu, submissions: %lu, avoided interest "
+                 "updates: %lu",
+                 name(), _enters, _submissions, _avoidedInterestUpdates);
+  _counters.log(Logger::Instance(), Logger::Notice);
+  destroy();
+  MonotonicTimeSource::Instance().reset();
+  return false;
+}
+
+int UringMultiplexer::currentSockets() const { return _activeSocketCount.get(); }
+
+int UringMultiplexer::maximumSockets() const { return _maxSockets; }
+
+bool UringMultiplexer::isRunning() const { return _isRunning && _isRunning->get(); }
+
+const EventLoopCounters *UringMultiplexer::eventLoopCounters() const { return &_counters; }
+
+void UringMultiplexer::checkIdleSockets() {
+  Date now = MonotonicTimeSource::Instance().now();
+
+  for (Timer *timer = _timingWheel.nextExpired(now); timer; timer = _timingWheel.nextExpired(now)) {
+    MultiplexedSocket *socket = (MultiplexedSocket *)timer->context();
+    assert(socket);
+    if (!socket) {
+      continue;
+    }
+    assert(!socket->timer().inTimingWheel());
+    socket->handleIdle();
+    removeMultiplexedSocket(socket);
+  }
+}
+
+void UringMultiplexer::checkTimers() {
+  Date now = MonotonicTimeSource::Instance().now();
+
+  for (Timer *timer = _timers.nextExpired(now); timer; timer = _timers.nextExpired(now)) {
+    timer->handleExpiration();
+  }
+}
+
+Error UringMultiplexer::addTimer(Timer *timer, UInt32 delayMsec) {
+  return _timers.insert(timer, delayMsec, MonotonicTimeSource::Instance().now());
+}
+
+Error UringMultiplexer::updateTimer(Timer *timer, UInt32 delayMsec) {
+  return _timers.update(timer, delayMsec, MonotonicTimeSource::Instance().now());
+}
+
+Error UringMultiplexer::removeTimer(Timer *timer) { return _timers.remove(timer); }
+
+const char *UringMultiplexer::name() const { return _namePrefix; }
+
+}  // namespace ESB
+
+#endif
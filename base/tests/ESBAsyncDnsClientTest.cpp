@@ -0,0 +1,420 @@
+#ifndef ESB_ASYNC_DNS_CLIENT_H
+#include <ESBAsyncDnsClient.h>
+#endif
+
+#ifndef ESB_TIME_H
+#include <ESBTime.h>
+#endif
+
+#include <gtest/gtest.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace ESB;
+
+// Records the sockets the client adds so the test can deliver their events
+class FakeMultiplexer : public SocketMultiplexer {
+ public:
+  FakeMultiplexer() : _count(0) {}
+  virtual ~FakeMultiplexer() {}
+
+  virtual Error addMultiplexedSocket(MultiplexedSocket *socket) {
+    if (2 <= _count) return ESB_OVERFLOW;
+    _sockets[_count++] = socket;
+    return ESB_SUCCESS;
+  }
+  virtual Error updateMultiplexedSocket(MultiplexedSocket *socket) { return ESB_SUCCESS; }
+  virtual Error removeMultiplexedSocket(MultiplexedSocket *socket) { return ESB_SUCCESS; }
+  virtual Error addTimer(Timer *timer, UInt32 delayMsec) { return ESB_OPERATION_NOT_SUPPORTED; }
+  virtual Error updateTimer(Timer *timer, UInt32 delayMsec) { return ESB_OPERATION_NOT_SUPPORTED; }
+  virtual Error removeTimer(Timer *timer) { return ESB_OPERATION_NOT_SUPPORTED; }
+  virtual int currentSockets() const { return _count; }
+  virtual int maximumSockets() const { return 2; }
+  virtual bool isRunning() const { return true; }
+  virtual const char *name() const { return "fake"; }
+  virtual bool run(SharedInt *isRunning) { return false; }
+  virtual CleanupHandler *cleanupHandler() { return NULL; }
+
+  // Wait for any socket to become readable and deliver the event
+  bool poll(int timeoutMsec) {
+    struct pollfd fds[2];
+    for (int i = 0; i < _count; ++i) {
+      fds[i].fd = _sockets[i]->socketDescriptor();
+      fds[i].events = POLLIN;
+      fds[i].revents = 0;
+    }
+    if (0 >= ::poll(fds, _count, timeoutMsec)) return false;
+    for (int i = 0; i < _count; ++i) {
+      if (fds[i].revents & POLLIN) _sockets[i]->handleReadable();
+    }
+    return true;
+  }
+
+ private:
+  MultiplexedSocket *_sockets[2];
+  int _count;
+};
+
+class RecordingCallback : public DnsClient::Callback {
+ public:
+  RecordingCallback() : _calls(0), _result(ESB_SUCCESS), _address() {}
+  virtual ~RecordingCallback() {}
+
+  virtual void resolved(Error result, const SocketAddress &address) {
+    ++_calls;
+    _result = result;
+    _address = address;
+  }
+
+  int _calls;
+  Error _result;
+  SocketAddress _address;
+};
+
+class AsyncDnsClientTest : public ::testing::Test {
+ public:
+  AsyncDnsClientTest() : _resolverFd(-1), _resolver(), _cache(100, 300, 30), _multiplexer() {}
+
+  virtual void SetUp() {
+    _resolverFd = socket(AF_INET, SOCK_DGRAM, 0);
+    ASSERT_LE(0, _resolverFd);
+    SocketAddress::Address *address = _resolver.primitiveAddress();
+    address->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address->sin_port = 0;
+    ASSERT_EQ(0, bind(_resolverFd, (sockaddr *)address, sizeof(*address)));
+    socklen_t length = sizeof(*address);
+    ASSERT_EQ(0, getsockname(_resolverFd, (sockaddr *)address, &length));
+  }
+
+  virtual void TearDown() { close(_resolverFd); }
+
+ protected:
+  // Receive a query at the stub resolver.  Returns its size or 0 if none arrives in time.
+  int receiveQuery(unsigned char *packet, int size, int timeoutMsec = 1000) {
+    struct pollfd fd = {_resolverFd, POLLIN, 0};
+    if (0 >= poll(&fd, 1, timeoutMsec)) return 0;
+    socklen_t length = sizeof(_client);
+    int result = recvfrom(_resolverFd, packet, size, 0, (sockaddr *)&_client, &length);
+    return 0 < result ? result : 0;
+  }
+
+  // Answer a query with an rcode and up to one A record
+  void answer(const unsigned char *query, int size, int rcode, const char *ip, UInt32 ttl) {
+    unsigned char packet[ESB_DNS_MAX_UDP_SIZE];
+    memcpy(packet, query, size);
+    packet[2] |= 0x80;  // response
+    packet[3] = 0x80 | rcode;
+    int position = size;
+    if (ip) {
+      packet[7] = 1;
+      const unsigned char record[] = {0xC0, 0x0C, 0, 1, 0, 1, (unsigned char)(ttl >> 24), (unsigned char)(ttl >> 16),
+                                      (unsigned char)(ttl >> 8), (unsigned char)ttl, 0, 4};
+      memcpy(packet + position, record, sizeof(record));
+      position += sizeof(record);
+      inet_pton(AF_INET, ip, packet + position);
+      position += 4;
+    } else {
+      // An SOA record in the authority section gives the negative TTL
+      packet[9] = 1;
+      const unsigned char record[] = {0xC0, 0x0C, 0, 6, 0, 1, 0, 0, 0, 60, 0, 22, 0, 0, 0, 0, 0, 1,
+                                      0,    0,    0, 2, 0, 0, 0, 3, 0, 0,  0, 4,  0, 0, 0, 0};
+      memcpy(packet + position, record, sizeof(record));
+      packet[position + sizeof(record) - 1] = (unsigned char)ttl;  // SOA minimum
+      position += sizeof(record);
+    }
+    ASSERT_EQ(position, sendto(_resolverFd, packet, position, 0, (sockaddr *)&_client, sizeof(_client)));
+  }
+
+  int _resolverFd;
+  SocketAddress _resolver;
+  struct sockaddr_in _client;
+  DnsCache _cache;
+  FakeMultiplexer _multiplexer;
+};
+
+TEST_F(AsyncDnsClientTest, ResolvesAndCaches) {
+  AsyncDnsClient client("test", _multiplexer, _cache, _resolver);
+  RecordingCallback callback;
+  SocketAddress address;
+
+  ASSERT_EQ(ESB_INPROGRESS, client.resolve(address, "www.example.com", 8080, true, callback));
+  EXPECT_EQ(1, client.pendingLookups());
+
+  unsigned char query[ESB_DNS_MAX_UDP_SIZE];
+  int size = receiveQuery(query, sizeof(query));
+  ASSERT_LT(0, size);
+  answer(query, size, 0, "10.1.2.3", 60);
+
+  ASSERT_TRUE(_multiplexer.poll(1000));
+  EXPECT_EQ(1, callback._calls);
+  EXPECT_EQ(ESB_SUCCESS, callback._result);
+  EXPECT_EQ(8080, callback._address.port());
+  EXPECT_EQ(SocketAddress::TLS, callback._address.type());
+  char presentation[ESB_IPV6_PRESENTATION_SIZE];
+  callback._address.presentationAddress(presentation, sizeof(presentation));
+  EXPECT_STREQ("10.1.2.3", presentation);
+  EXPECT_EQ(0, client.pendingLookups());
+
+  // The second lookup is answered from the cache without a query
+  RecordingCallback callback2;
+  ASSERT_EQ(ESB_SUCCESS, client.resolve(address, "WWW.example.com", 80, false, callback2));
+  EXPECT_EQ(80, address.port());
+  EXPECT_EQ(SocketAddress::TCP, address.type());
+  EXPECT_EQ(0, callback2._calls);
+  EXPECT_EQ(1U, _cache.hits());
+  EXPECT_EQ(0, receiveQuery(query, sizeof(query), 50));
+}
+
+TEST_F(AsyncDnsClientTest, CoalescesLookups) {
+  AsyncDnsClient client("test", _multiplexer, _cache, _resolver);
+  RecordingCallback callbacks[3];
+  SocketAddress address;
+
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(ESB_INPROGRESS, client.resolve(address, "api.example.com", 443 + i, false, callbacks[i]));
+  }
+  EXPECT_EQ(1, client.pendingLookups());
+
+  unsigned char query[ESB_DNS_MAX_UDP_SIZE];
+  int size = receiveQuery(query, sizeof(query));
+  ASSERT_LT(0, size);
+  EXPECT_EQ(0, receiveQuery(query + size, sizeof(query) - size, 50));
+
+  // A canceled callback is not called but the others are
+  client.cancel(callbacks[1]);
+  answer(query, size, 0, "192.168.0.1", 30);
+  ASSERT_TRUE(_multiplexer.poll(1000));
+
+  EXPECT_EQ(1, callbacks[0]._calls);
+  EXPECT_EQ(0, callbacks[1]._calls);
+  EXPECT_EQ(1, callbacks[2]._calls);
+  EXPECT_EQ(443, callbacks[0]._address.port());
+  EXPECT_EQ(445, callbacks[2]._address.port());
+}
+
+TEST_F(AsyncDnsClientTest, CachesFailures) {
+  AsyncDnsClient client("test", _multiplexer, _cache, _resolver);
+  RecordingCallback callback;
+  SocketAddress address;
+
+  ASSERT_EQ(ESB_INPROGRESS, client.resolve(address, "missing.example.com", 80, false, callback));
+  unsigned char query[ESB_DNS_MAX_UDP_SIZE];
+  int size = receiveQuery(query, sizeof(query));
+  ASSERT_LT(0, size);
+  answer(query, size, 3, NULL, 10);
+  ASSERT_TRUE(_multiplexer.poll(1000));
+
+  EXPECT_EQ(1, callback._calls);
+  EXPECT_EQ(ESB_CANNOT_FIND, callback._result);
+  EXPECT_EQ(ESB_CANNOT_FIND, client.resolve(address, "missing.example.com", 80, false, callback));
+  EXPECT_EQ(1, callback._calls);
+
+  // Server failures are not cached
+  RecordingCallback callback2;
+  ASSERT_EQ(ESB_INPROGRESS, client.resolve(address, "broken.example.com", 80, false, callback2));
+  size = receiveQuery(query, sizeof(query));
+  ASSERT_LT(0, size);
+  answer(query, size, 2, NULL, 10);
+  ASSERT_TRUE(_multiplexer.poll(1000));
+  EXPECT_EQ(ESB_OTHER_ERROR, callback2._result);
+  EXPECT_EQ(ESB_AGAIN, client.resolve(address, "broken.example.com"));
+}
+
+TEST_F(AsyncDnsClientTest, ReceiveErrorLeavesLookupPending) {
+  AsyncDnsClient client("test", _multiplexer, _cache, _resolver);
+  RecordingCallback callback;
+  SocketAddress address;
+
+  // Nothing listens on the resolver's port, so the query is refused and the error is reported on the client's socket
+  close(_resolverFd);
+  _resolverFd = -1;
+
+  ASSERT_EQ(ESB_INPROGRESS, client.resolve(address, "www.example.com", 80, false, callback));
+  ASSERT_TRUE(_multiplexer.poll(1000));
+  EXPECT_EQ(0, callback._calls);
+  EXPECT_EQ(1, client.pendingLookups());
+}
+
+TEST_F(AsyncDnsClientTest, RetriesThenTimesOut) {
+  AsyncDnsClient client("test", _multiplexer, _cache, _resolver, 50, 2);
+  RecordingCallback callback;
+  SocketAddress address;
+  const Date start = Time::Instance().now();
+
+  ASSERT_EQ(ESB_INPROGRESS, client.resolve(address, "slow.example.com", 80, false, callback));
+
+  unsigned char first[ESB_DNS_MAX_UDP_SIZE];
+  unsigned char second[ESB_DNS_MAX_UDP_SIZE];
+  ASSERT_LT(0, receiveQuery(first, sizeof(first)));
+
+  while (0 == callback._calls && Time::Instance().now() < start + 5) {
+    _multiplexer.poll(100);
+  }
+
+  EXPECT_EQ(1, callback._calls);
+  EXPECT_EQ(ESB_TIMEOUT, callback._result);
+  EXPECT_EQ(0, client.pendingLookups());
+
+  // The query was sent twice with the same id
+  ASSERT_LT(0, receiveQuery(second, sizeof(second)));
+  EXPECT_EQ(0, memcmp(first, second, 2));
+  EXPECT_EQ(0, receiveQuery(second, sizeof(second), 50));
+}
+
+TEST_F(AsyncDnsClientTest, IgnoresMismatchedAnswers) {
+  AsyncDnsClient client("test", _multiplexer, _cache, _resolver);
+  RecordingCallback callback;
+  SocketAddress address;
+
+  ASSERT_EQ(ESB_INPROGRESS, client.resolve(address, "www.example.com", 80, false, callback));
+  unsigned char query[ESB_DNS_MAX_UDP_SIZE];
+  int size = receiveQuery(query, sizeof(query));
+  ASSERT_LT(0, size);
+
+  query[1] ^= 0xFF;  // wrong id
+  answer(query, size, 0, "10.0.0.1", 60);
+  _multiplexer.poll(1000);
+  EXPECT_EQ(0, callback._calls);
+
+  query[1] ^= 0xFF;
+  answer(query, size, 0, "10.0.0.2", 60);
+  ASSERT_TRUE(_multiplexer.poll(1000));
+  EXPECT_EQ(1, callback._calls);
+  char presentation[ESB_IPV6_PRESENTATION_SIZE];
+  callback._address.presentationAddress(presentation, sizeof(presentation));
+  EXPECT_STREQ("10.0.0.2", presentation);
+}
+
+TEST_F(AsyncDnsClientTest, TrailingDot) {
+  AsyncDnsClient client("test", _multiplexer, _cache, _resolver);
+  RecordingCallback callback;
+  RecordingCallback callback2;
+  SocketAddress address;
+
+  // Both spellings share one query
+  ASSERT_EQ(ESB_INPROGRESS, client.resolve(address, "www.example.com.", 80, false, callback));
+  ASSERT_EQ(ESB_INPROGRESS, client.resolve(address, "www.example.com", 80, false, callback2));
+  EXPECT_EQ(1, client.pendingLookups());
+
+  unsigned char query[ESB_DNS_MAX_UDP_SIZE];
+  int size = receiveQuery(query, sizeof(query));
+  ASSERT_LT(0, size);
+  answer(query, size, 0, "10.0.0.3", 60);
+  ASSERT_TRUE(_multiplexer.poll(1000));
+  EXPECT_EQ(1, callback._calls);
+  EXPECT_EQ(ESB_SUCCESS, callback._result);
+  EXPECT_EQ(1, callback2._calls);
+  EXPECT_EQ(0, client.pendingLookups());
+
+  EXPECT_EQ(ESB_SUCCESS, client.resolve(address, "www.example.com.", 80, false, callback));
+  EXPECT_EQ(ESB_INVALID_ARGUMENT, client.resolve(address, ".", 80, false, callback));
+}
+
+TEST_F(AsyncDnsClientTest, SeparateSourcePorts) {
+  AsyncDnsClient client("test", _multiplexer, _cache, _resolver);
+  RecordingCallback callbacks[2];
+  SocketAddress address;
+
+  ASSERT_EQ(ESB_INPROGRESS, client.resolve(address, "a.example.com", 80, false, callbacks[0]));
+  ASSERT_EQ(ESB_INPROGRESS, client.resolve(address, "b.example.com", 80, false, callbacks[1]));
+
+  unsigned char queries[2][ESB_DNS_MAX_UDP_SIZE];
+  int sizes[2];
+  struct sockaddr_in clients[2];
+  for (int i = 0; i < 2; ++i) {
+    sizes[i] = receiveQuery(queries[i], sizeof(queries[i]));
+    ASSERT_LT(0, sizes[i]);
+    clients[i] = _client;
+  }
+  EXPECT_NE(clients[0].sin_port, clients[1].sin_port);
+
+  // Each answer goes back to the port its query came from
+  for (int i = 1; i >= 0; --i) {
+    _client = clients[i];
+    answer(queries[i], sizes[i], 0, "10.0.0.4", 60);
+  }
+  while (_multiplexer.poll(100) && 2 > callbacks[0]._calls + callbacks[1]._calls) {
+  }
+  EXPECT_EQ(1, callbacks[0]._calls);
+  EXPECT_EQ(1, callbacks[1]._calls);
+  EXPECT_EQ(0, client.pendingLookups());
+}
+
+TEST_F(AsyncDnsClientTest, Literals) {
+  AsyncDnsClient client("test", _multiplexer, _cache, _resolver);
+  RecordingCallback callback;
+  SocketAddress address;
+
+  ASSERT_EQ(ESB_SUCCESS, client.resolve(address, "127.0.0.1", 8443, true, callback));
+  EXPECT_EQ(8443, address.port());
+  EXPECT_EQ(0, callback._calls);
+  EXPECT_EQ(0, _multiplexer.currentSockets());
+}
+
+TEST(AsyncDnsClient, FollowsCnames) {
+  unsigned char packet[ESB_DNS_MAX_UDP_SIZE];
+  int size = AsyncDnsClient::FormatQuery("www.example.com", 0x1234, packet, sizeof(packet));
+  ASSERT_EQ(12 + 17 + 4, size);
+
+  packet[2] |= 0x80;
+  packet[7] = 2;
+  // www.example.com CNAME cdn.example.com (ttl 300), cdn.example.com A 1.2.3.4 (ttl 20)
+  const unsigned char records[] = {0xC0, 0x0C, 0, 5, 0, 1, 0, 0, 1, 44, 0, 6, 3, 'c', 'd', 'n', 0xC0, 16,
+                                   0xC0, 45,   0, 1, 0, 1, 0, 0, 0, 20, 0, 4, 1, 2,   3,   4};
+  memcpy(packet + size, records, sizeof(records));
+  size += sizeof(records);
+
+  UInt32 address = 0U;
+  UInt32 ttl = 0U;
+  ASSERT_EQ(ESB_SUCCESS, AsyncDnsClient::ParseResponse(packet, size, 0x1234, "www.example.com.", &address, &ttl));
+  EXPECT_EQ(htonl(0x01020304), address);
+  EXPECT_EQ(20U, ttl);
+
+  EXPECT_EQ(ESB_CANNOT_PARSE, AsyncDnsClient::ParseResponse(packet, size, 0x1235, "www.example.com", &address, &ttl));
+  EXPECT_EQ(ESB_CANNOT_PARSE, AsyncDnsClient::ParseResponse(packet, size, 0x1234, "example.com", &address, &ttl));
+  EXPECT_EQ(ESB_CANNOT_PARSE, AsyncDnsClient::ParseResponse(packet, size - 3, 0x1234, "www.example.com", &address,
+                                                            &ttl));
+}
+
+TEST(AsyncDnsClient, RejectsInvalidHostnames) {
+  unsigned char packet[ESB_DNS_MAX_UDP_SIZE];
+  EXPECT_EQ(-1, AsyncDnsClient::FormatQuery("", 1, packet, sizeof(packet)));
+  EXPECT_EQ(-1, AsyncDnsClient::FormatQuery("a..b", 1, packet, sizeof(packet)));
+  EXPECT_EQ(-1, AsyncDnsClient::FormatQuery("www.example.com", 1, packet, 20));
+  EXPECT_LT(0, AsyncDnsClient::FormatQuery("localhost.", 1, packet, sizeof(packet)));
+}
+
+TEST(DnsCache, ExpiresAndEvicts) {
+  DnsCache cache(2, 60, 5);
+  const Date now = Time::Instance().now();
+  Error result = ESB_SUCCESS;
+  UInt32 address = 0U;
+
+  ASSERT_EQ(ESB_SUCCESS, cache.insert("a.example.com", 1U, 3600, now));
+  ASSERT_EQ(ESB_SUCCESS, cache.insertNegative("b.example.com", ESB_CANNOT_FIND, 3600, now));
+  EXPECT_EQ(2U, cache.size());
+
+  // TTLs are clamped to the configured maximums
+  EXPECT_TRUE(cache.find("A.EXAMPLE.COM", now + 59, &result, &address));
+  EXPECT_EQ(ESB_SUCCESS, result);
+  EXPECT_EQ(1U, address);
+  EXPECT_TRUE(cache.find("b.example.com", now + 4, &result, &address));
+  EXPECT_EQ(ESB_CANNOT_FIND, result);
+  EXPECT_FALSE(cache.find("b.example.com", now + 6, &result, &address));
+  EXPECT_EQ(1U, cache.size());
+
+  // The oldest entry is evicted when full
+  ASSERT_EQ(ESB_SUCCESS, cache.insert("c.example.com", 3U, 60, now));
+  ASSERT_EQ(ESB_SUCCESS, cache.insert("d.example.com", 4U, 60, now));
+  EXPECT_EQ(2U, cache.size());
+  EXPECT_FALSE(cache.find("a.example.com", now, &result, &address));
+  EXPECT_TRUE(cache.find("d.example.com", now, &result, &address));
+
+  // A TTL of 0 is not cached
+  ASSERT_EQ(ESB_SUCCESS, cache.insert("e.example.com", 5U, 0, now));
+  EXPECT_FALSE(cache.find("e.example.com", now, &result, &address));
+  EXPECT_EQ(3U, cache.hits());
+  EXPECT_EQ(3U, cache.misses());
+}
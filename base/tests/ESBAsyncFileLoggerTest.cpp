@@ -0,0 +1,222 @@
+#ifndef ESB_ASYNC_FILE_LOGGER_H
+#include <ESBAsyncFileLogger.h>
+#endif
+
+#ifndef ESB_LOG_DECODER_H
+#include <ESBLogDecoder.h>
+#endif
+
+#include <gtest/gtest.h>
+
+using namespace ESB;
+
+#define MESSAGES_PER_THREAD 1000
+#define THREADS 4
+
+static UInt32 CountLines(FILE *file, const char *needle = NULL) {
+  char line[ESB_ASYNC_LOGGER_MAX_MESSAGE];
+  UInt32 lines = 0;
+
+  rewind(file);
+  while (fgets(line, sizeof(line), file)) {
+    if (!needle || strstr(line, needle)) {
+      ++lines;
+    }
+  }
+
+  return lines;
+}
+
+TEST(AsyncFileLogger, WritesWhenFlushed) {
+  FILE *file = tmpfile();
+  ASSERT_TRUE(file);
+
+  {
+    AsyncFileLogger logger(file, Logger::Info);
+    ASSERT_EQ(ESB_SUCCESS, logger.log(Logger::Info, "first %d\n", 1));
+    ASSERT_EQ(ESB_SUCCESS, logger.log(Logger::Warning, "second %d\n", 2));
+    ASSERT_EQ(ESB_SUCCESS, logger.log(Logger::Debug, "not logged\n"));
+    ASSERT_EQ(1, logger.rings());
+
+    // Nothing is written until the rings are drained
+    ASSERT_EQ(0, CountLines(file));
+    logger.flush();
+    ASSERT_EQ(2, CountLines(file));
+  }
+
+  fclose(file);
+}
+
+TEST(AsyncFileLogger, DropsWhenFull) {
+  FILE *file = tmpfile();
+  ASSERT_TRUE(file);
+  char padding[100];
+  memset(padding, 'x', sizeof(padding) - 1);
+  padding[sizeof(padding) - 1] = 0;
+
+  {
+    AsyncFileLogger logger(file, Logger::Info, SystemTimeSource::Instance(), 0, false);
+    for (int i = 0; i < 100; ++i) {
+      logger.log(Logger::Info, "%d %s\n", i, padding);
+    }
+
+    ASSERT_LT(0, logger.dropped());
+    ASSERT_GT(100, logger.dropped());
+
+    // Critical messages are never dropped and are written right away
+    ASSERT_EQ(ESB_SUCCESS, logger.log(Logger::Critical, "critical\n"));
+    ASSERT_EQ(1, CountLines(file, "critical"));
+    ASSERT_EQ(1, CountLines(file, "dropped"));
+    ASSERT_EQ(100 - logger.dropped() + 2, CountLines(file));
+  }
+
+  fclose(file);
+}
+
+TEST(AsyncFileLogger, BlocksWhenFull) {
+  FILE *file = tmpfile();
+  ASSERT_TRUE(file);
+  char padding[100];
+  memset(padding, 'x', sizeof(padding) - 1);
+  padding[sizeof(padding) - 1] = 0;
+
+  {
+    AsyncFileLogger logger(file, Logger::Info, SystemTimeSource::Instance(), 0, true);
+    for (int i = 0; i < 100; ++i) {
+      ASSERT_EQ(ESB_SUCCESS, logger.log(Logger::Info, "%d %s\n", i, padding));
+    }
+
+    ASSERT_EQ(0, logger.dropped());
+    logger.flush();
+    ASSERT_EQ(100, CountLines(file));
+  }
+
+  fclose(file);
+}
+
+static void ReadAll(FILE *file, char *buffer, UInt32 size) {
+  rewind(file);
+  const Size bytes = fread(buffer, 1, size - 1, file);
+  buffer[bytes] = 0;
+}
+
+TEST(AsyncFileLogger, Deferred) {
+  FILE *file = tmpfile();
+  ASSERT_TRUE(file);
+
+  {
+    AsyncFileLogger logger(file, Logger::Info, SystemTimeSource::Instance(), 0, false, 10, AsyncFileLogger::DEFERRED);
+    ASSERT_EQ(ESB_SUCCESS, logger.log(Logger::Info, "%s %d %.1f\n", "deferred", 1, 2.5));
+    // Formatted on the calling thread because %n cannot be captured
+    int count = 0;
+    ASSERT_EQ(ESB_SUCCESS, logger.log(Logger::Info, "text%n %d\n", &count, 2));
+    ASSERT_EQ(0, CountLines(file));
+    logger.flush();
+  }
+
+  char buffer[1024];
+  ReadAll(file, buffer, sizeof(buffer));
+  ASSERT_STREQ("deferred 1 2.5\ntext 2\n", buffer);
+  fclose(file);
+}
+
+TEST(AsyncFileLogger, Binary) {
+  FILE *file = tmpfile();
+  ASSERT_TRUE(file);
+
+  {
+    AsyncFileLogger logger(file, Logger::Info, SystemTimeSource::Instance(), 0, false, 10, AsyncFileLogger::BINARY);
+    for (int i = 0; i < 3; ++i) {
+      ASSERT_EQ(ESB_SUCCESS, logger.log(Logger::Info, "binary %d %s\n", i, "message"));
+    }
+    int count = 0;
+    ASSERT_EQ(ESB_SUCCESS, logger.log(Logger::Info, "text%n\n", &count));
+    logger.flush();
+  }
+
+  // Each format string is written once
+  char buffer[1024];
+  rewind(file);
+  const Size bytes = fread(buffer, 1, sizeof(buffer), file);
+  UInt32 formats = 0;
+  for (const char *p = buffer; p + 6 <= buffer + bytes; ++p) {
+    if (0 == memcmp(p, "binary", 6)) {
+      ++formats;
+    }
+  }
+  ASSERT_EQ(1U, formats);
+
+  FILE *output = tmpfile();
+  ASSERT_TRUE(output);
+  rewind(file);
+  LogDecoder decoder;
+  ASSERT_EQ(ESB_SUCCESS, decoder.decode(file, output));
+  ReadAll(output, buffer, sizeof(buffer));
+  ASSERT_STREQ("binary 0 message\nbinary 1 message\nbinary 2 message\ntext\n", buffer);
+
+  fclose(output);
+  fclose(file);
+}
+
+class LoggingThread : public Thread {
+ public:
+  LoggingThread(AsyncFileLogger &logger, int id) : _logger(logger), _id(id) {}
+
+  virtual ~LoggingThread() {}
+
+ protected:
+  virtual void run() {
+    for (int i = 0; i < MESSAGES_PER_THREAD; ++i) {
+      _logger.log(Logger::Info, "thread %d message %d\n", _id, i);
+    }
+  }
+
+ private:
+  AsyncFileLogger &_logger;
+  int _id;
+};
+
+TEST(AsyncFileLogger, WriterThread) {
+  FILE *file = tmpfile();
+  ASSERT_TRUE(file);
+
+  {
+    AsyncFileLogger logger(file, Logger::Info, SystemTimeSource::Instance(), 0, true, 1);
+    ASSERT_EQ(ESB_SUCCESS, logger.start());
+
+    LoggingThread first(logger, 0), second(logger, 1), third(logger, 2), fourth(logger, 3);
+    LoggingThread *threads[THREADS] = {&first, &second, &third, &fourth};
+    for (int i = 0; i < THREADS; ++i) {
+      ASSERT_EQ(ESB_SUCCESS, threads[i]->start());
+    }
+
+    for (int i = 0; i < THREADS; ++i) {
+      ASSERT_EQ(ESB_SUCCESS, threads[i]->join());
+    }
+
+    logger.stop();
+    ASSERT_EQ(ESB_SUCCESS, logger.join());
+    ASSERT_EQ(THREADS, logger.rings());
+    ASSERT_EQ(0, logger.dropped());
+  }
+
+  // Every message is whole and each thread's messages are in order
+  int next[THREADS];
+  memset(next, 0, sizeof(next));
+  char line[ESB_ASYNC_LOGGER_MAX_MESSAGE];
+  UInt32 lines = 0;
+
+  rewind(file);
+  while (fgets(line, sizeof(line), file)) {
+    int thread = -1;
+    int message = -1;
+    ASSERT_EQ(2, sscanf(line, "thread %d message %d\n", &thread, &message));
+    ASSERT_LE(0, thread);
+    ASSERT_GT(THREADS, thread);
+    ASSERT_EQ(next[thread]++, message);
+    ++lines;
+  }
+
+  ASSERT_EQ(THREADS * MESSAGES_PER_THREAD, lines);
+  fclose(file);
+}
@@ -0,0 +1,173 @@
+#ifndef ESB_CIDR_TABLE_H
+#include <ESBCidrTable.h>
+#endif
+
+#ifndef ESB_RAND_H
+#include <ESBRand.h>
+#endif
+
+#include <gtest/gtest.h>
+
+using namespace ESB;
+
+// The value of the longest matching prefix, or ESB_UINT32_MAX if none matched
+static UInt32 Find(const CidrTable &table, UInt32 address) {
+  UInt32 value = 0U;
+  return ESB_SUCCESS == table.find(address, &value) ? value : ESB_UINT32_MAX;
+}
+
+static UInt32 Find(const CidrTable &table, const char *address) {
+  UInt32 ip = 0U;
+  UInt32 length = 0U;
+  EXPECT_EQ(ESB_SUCCESS, CidrTable::Parse(address, &ip, &length));
+  return Find(table, ip);
+}
+
+TEST(CidrTable, Parse) {
+  UInt32 address = 0U;
+  UInt32 length = 0U;
+
+  EXPECT_EQ(ESB_SUCCESS, CidrTable::Parse("10.1.2.3/8", &address, &length));
+  EXPECT_EQ(0x0A010203U, address);
+  EXPECT_EQ(8U, length);
+  EXPECT_EQ(ESB_SUCCESS, CidrTable::Parse("192.168.0.1", &address, &length));
+  EXPECT_EQ(0xC0A80001U, address);
+  EXPECT_EQ(32U, length);
+  EXPECT_EQ(ESB_SUCCESS, CidrTable::Parse("0.0.0.0/0", &address, &length));
+  EXPECT_EQ(0U, address);
+  EXPECT_EQ(0U, length);
+
+  EXPECT_EQ(ESB_CANNOT_PARSE, CidrTable::Parse("10.0.0.0/33", &address, &length));
+  EXPECT_EQ(ESB_CANNOT_PARSE, CidrTable::Parse("10.0.0.0/", &address, &length));
+  EXPECT_EQ(ESB_CANNOT_PARSE, CidrTable::Parse("10.0.0.0/x", &address, &length));
+  EXPECT_EQ(ESB_CANNOT_PARSE, CidrTable::Parse("10.0.0/8", &address, &length));
+  EXPECT_EQ(ESB_CANNOT_PARSE, CidrTable::Parse("/8", &address, &length));
+  EXPECT_EQ(ESB_CANNOT_PARSE, CidrTable::Parse("::1/128", &address, &length));
+}
+
+TEST(CidrTable, LongestMatch) {
+  CidrTable table;
+
+  // Inserted out of order on purpose
+  EXPECT_EQ(ESB_SUCCESS, table.insert("10.1.2.200", 5));
+  EXPECT_EQ(ESB_SUCCESS, table.insert("10.1.2.128/25", 4));
+  EXPECT_EQ(ESB_SUCCESS, table.insert("10.0.0.0/8", 1));
+  EXPECT_EQ(ESB_SUCCESS, table.insert("10.1.2.0/24", 3));
+  EXPECT_EQ(ESB_SUCCESS, table.insert("10.1.0.0/16", 2));
+  EXPECT_EQ(ESB_SUCCESS, table.insert("10.1.128.0/17", 6));
+  EXPECT_EQ(ESB_SUCCESS, table.insert("172.16.0.0/12", 7));
+  EXPECT_EQ(7U, table.size());
+
+  EXPECT_EQ(ESB_UINT32_MAX, Find(table, "10.1.2.3"));
+  EXPECT_EQ(ESB_SUCCESS, table.build());
+  EXPECT_TRUE(table.isBuilt());
+  // One chunk for 10.1/16 and one for 10.1.2/24
+  EXPECT_EQ(2U, table.chunks());
+
+  EXPECT_EQ(1U, Find(table, "10.0.0.1"));
+  EXPECT_EQ(1U, Find(table, "10.255.255.255"));
+  EXPECT_EQ(2U, Find(table, "10.1.0.0"));
+  EXPECT_EQ(2U, Find(table, "10.1.127.255"));
+  EXPECT_EQ(3U, Find(table, "10.1.2.0"));
+  EXPECT_EQ(3U, Find(table, "10.1.2.127"));
+  EXPECT_EQ(4U, Find(table, "10.1.2.128"));
+  EXPECT_EQ(4U, Find(table, "10.1.2.199"));
+  EXPECT_EQ(5U, Find(table, "10.1.2.200"));
+  EXPECT_EQ(4U, Find(table, "10.1.2.201"));
+  EXPECT_EQ(2U, Find(table, "10.1.3.0"));
+  EXPECT_EQ(6U, Find(table, "10.1.128.0"));
+  EXPECT_EQ(6U, Find(table, "10.1.255.255"));
+  EXPECT_EQ(7U, Find(table, "172.16.0.1"));
+  EXPECT_EQ(7U, Find(table, "172.31.255.255"));
+  EXPECT_EQ(ESB_UINT32_MAX, Find(table, "172.32.0.0"));
+  EXPECT_EQ(ESB_UINT32_MAX, Find(table, "9.255.255.255"));
+  EXPECT_EQ(ESB_UINT32_MAX, Find(table, "11.0.0.0"));
+}
+
+TEST(CidrTable, DefaultRoute) {
+  CidrTable table;
+
+  EXPECT_EQ(ESB_SUCCESS, table.insert("0.0.0.0/0", 0));
+  EXPECT_EQ(ESB_SUCCESS, table.insert("255.255.255.255", CidrTable::MaxValue));
+  EXPECT_EQ(ESB_SUCCESS, table.build());
+
+  EXPECT_EQ(0U, Find(table, "0.0.0.0"));
+  EXPECT_EQ(0U, Find(table, "127.0.0.1"));
+  EXPECT_EQ(0U, Find(table, "255.255.255.254"));
+  EXPECT_EQ(CidrTable::MaxValue, Find(table, "255.255.255.255"));
+}
+
+TEST(CidrTable, Errors) {
+  CidrTable table;
+
+  EXPECT_EQ(ESB_INVALID_ARGUMENT, table.insert(0U, 33U, 1U));
+  EXPECT_EQ(ESB_INVALID_ARGUMENT, table.insert(0U, 8U, CidrTable::MaxValue + 1U));
+  EXPECT_EQ(ESB_CANNOT_PARSE, table.insert("10.0.0.0.0/8", 1U));
+
+  // Host bits are ignored, so these are the same prefix
+  EXPECT_EQ(ESB_SUCCESS, table.insert("10.0.0.0/8", 1U));
+  EXPECT_EQ(ESB_SUCCESS, table.insert("10.1.2.3/8", 2U));
+  EXPECT_EQ(ESB_UNIQUENESS_VIOLATION, table.build());
+  EXPECT_FALSE(table.isBuilt());
+
+  CidrTable empty;
+  EXPECT_EQ(ESB_SUCCESS, empty.build());
+  EXPECT_EQ(ESB_UINT32_MAX, Find(empty, "10.0.0.1"));
+  EXPECT_EQ(ESB_INVALID_STATE, empty.insert("10.0.0.0/8", 1U));
+  EXPECT_EQ(ESB_INVALID_STATE, empty.build());
+}
+
+// Compare against a linear search over random prefixes, weighted towards long ones so lots of chunks are created
+TEST(CidrTable, Random) {
+  const UInt32 numPrefixes = 5000U;
+  UInt32 addresses[numPrefixes];
+  UInt32 lengths[numPrefixes];
+  CidrTable table;
+  Rand rand(42);
+
+  for (UInt32 i = 0; i < numPrefixes; ++i) {
+    // A few /8s so random prefixes overlap
+    const UInt32 length = rand.generate(0U, 3U) ? rand.generate(9U, 32U) : rand.generate(1U, 8U);
+    const UInt32 address = (rand.generate(10U, 13U) << 24) | rand.generate(0U, 0xFFFFFFU);
+    const UInt32 mask = ESB_UINT32_MAX << (32U - length);
+
+    addresses[i] = address & mask;
+    lengths[i] = length;
+    for (UInt32 j = 0; j < i; ++j) {
+      if (addresses[j] == addresses[i] && lengths[j] == lengths[i]) {
+        lengths[i] = 0U;  // a duplicate, skipped
+        break;
+      }
+    }
+    if (lengths[i]) {
+      ASSERT_EQ(ESB_SUCCESS, table.insert(addresses[i], lengths[i], i));
+    }
+  }
+
+  ASSERT_EQ(ESB_SUCCESS, table.build());
+
+  for (UInt32 n = 0; n < 20000U; ++n) {
+    // Mostly addresses inside a random prefix so the deeper levels are exercised
+    UInt32 address = rand.generate(0U, ESB_UINT32_MAX);
+    if (rand.generate(0U, 3U)) {
+      const UInt32 i = rand.generate(0U, numPrefixes - 1U);
+      if (lengths[i]) {
+        address = addresses[i] | (address & ~(ESB_UINT32_MAX << (32U - lengths[i])));
+      }
+    }
+
+    UInt32 expected = ESB_UINT32_MAX;
+    UInt32 longest = 0U;
+    for (UInt32 i = 0; i < numPrefixes; ++i) {
+      if (0U == lengths[i] || longest >= lengths[i]) {
+        continue;
+      }
+      if ((address & (ESB_UINT32_MAX << (32U - lengths[i]))) == addresses[i]) {
+        expected = i;
+        longest = lengths[i];
+      }
+    }
+
+    ASSERT_EQ(expected, Find(table, address)) << "address " << address;
+  }
+}
@@ -29,3 +29,28 @@ TEST_F(ClearSocketTest, EchoMessage) {
     ASSERT_TRUE(0 == strcmp(_message, buffer));
   }
 }
+
+TEST_F(ClearSocketTest, EchoVectoredMessage) {
+  ClearSocket client(_server.clearAddress(), "Test", true);
+
+  Error error = client.connect();
+  ASSERT_EQ(ESB_SUCCESS, error);
+  ASSERT_TRUE(client.connected());
+
+  struct iovec segments[3];
+  segments[0].iov_base = _message;
+  segments[0].iov_len = 10;
+  segments[1].iov_base = _message + 10;
+  segments[1].iov_len = 1;
+  segments[2].iov_base = _message + 11;
+  segments[2].iov_len = sizeof(_message) - 11;
+
+  ConnectedSocket &socket = client;
+  SSize result = socket.send(segments, 3);
+  ASSERT_EQ(result, sizeof(_message));
+
+  char buffer[sizeof(_message)];
+  result = client.receive(buffer, sizeof(buffer));
+  ASSERT_EQ(result, sizeof(buffer));
+  ASSERT_TRUE(0 == strcmp(_message, buffer));
+}
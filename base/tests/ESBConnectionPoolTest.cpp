@@ -10,6 +10,10 @@
 #include <ESBClientTLSSocket.h>
 #endif
 
+#ifndef ESB_DISCARD_ALLOCATOR_H
+#include <ESBDiscardAllocator.h>
+#endif
+
 using namespace ESB;
 
 class ConnectionPoolTest : public SocketTest {
@@ -107,6 +111,177 @@ TEST_F(ConnectionPoolTest, AcquireRelease) {
   destroyConnection(connection);
 }
 
+TEST_F(ConnectionPoolTest, StealFromGroup) {
+  ConnectionPool::Group group(2);
+  ConnectionPool owner("Owner", 41, 0, _clientContexts, SystemAllocator::Instance(), &group);
+  ConnectionPool thief("Thief", 41, 0, _clientContexts, SystemAllocator::Instance(), &group);
+  ConnectedSocket *connection = NULL;
+  ConnectedSocket *other = NULL;
+  bool reused = false;
+
+  ASSERT_EQ(2, group.size());
+
+  Error error = owner.acquireClearSocket(_server.clearAddress(), &connection, &reused);
+
+  ASSERT_EQ(ESB_SUCCESS, error);
+  ASSERT_FALSE(reused);
+  ASSERT_EQ(1, owner.misses());
+
+  useConnection(connection);
+  owner.release(connection);
+  ASSERT_EQ(1, owner.size());
+
+  // Nobody asked for it, so the owner kept its idle connection to itself
+  error = thief.acquireClearSocket(_server.clearAddress(), &other, &reused);
+
+  ASSERT_EQ(ESB_SUCCESS, error);
+  ASSERT_FALSE(reused);
+  ASSERT_EQ(1, thief.misses());
+  ASSERT_EQ(0, thief.steals());
+  ASSERT_EQ(1, owner.size());
+
+  // The owner still reuses it, then hands it off to the thief that found nothing
+  error = owner.acquireClearSocket(_server.clearAddress(), &connection, &reused);
+
+  ASSERT_EQ(ESB_SUCCESS, error);
+  ASSERT_TRUE(reused);
+  ASSERT_EQ(1, owner.hits());
+
+  useConnection(connection);
+  owner.release(connection);
+  ASSERT_EQ(1, owner.size());
+
+  error = thief.acquireClearSocket(_server.clearAddress(), &connection, &reused);
+
+  ASSERT_EQ(ESB_SUCCESS, error);
+  ASSERT_TRUE(reused);
+  ASSERT_TRUE(connection->connected());
+  ASSERT_EQ(0, owner.size());
+  ASSERT_EQ(0, thief.hits());
+  ASSERT_EQ(1, thief.misses());
+  ASSERT_EQ(1, thief.steals());
+
+  const ConnectionPool::Counters *counters = thief.destinationCounters(_server.clearAddress());
+  ASSERT_TRUE(counters);
+  ASSERT_EQ(0U, counters->hits());
+  ASSERT_EQ(1U, counters->misses());
+  ASSERT_EQ(1U, counters->steals());
+
+  // The demand was answered, so the thief keeps what it releases
+  useConnection(connection);
+  thief.release(connection);
+  useConnection(other);
+  thief.release(other);
+  ASSERT_EQ(2, thief.size());
+  ASSERT_EQ(0, owner.size());
+}
+
+TEST_F(ConnectionPoolTest, OwnerTakesBackHandedOffConnection) {
+  ConnectionPool::Group group(2);
+  ConnectionPool owner("Owner", 41, 0, _clientContexts, SystemAllocator::Instance(), &group);
+  ConnectionPool thief("Thief", 41, 0, _clientContexts, SystemAllocator::Instance(), &group);
+  ConnectedSocket *connection = NULL;
+  ConnectedSocket *other = NULL;
+  bool reused = false;
+
+  ASSERT_EQ(ESB_SUCCESS, owner.acquireClearSocket(_server.clearAddress(), &connection, &reused));
+  ASSERT_EQ(ESB_SUCCESS, thief.acquireClearSocket(_server.clearAddress(), &other, &reused));
+  ASSERT_EQ(1, thief.misses());
+
+  useConnection(connection);
+  owner.release(connection);
+  ASSERT_EQ(1, owner.size());
+  ASSERT_EQ(1, owner.idleSockets(NULL, _server.clearAddress()));
+
+  ASSERT_EQ(ESB_SUCCESS, owner.acquireClearSocket(_server.clearAddress(), &connection, &reused));
+  ASSERT_TRUE(reused);
+  ASSERT_EQ(1, owner.hits());
+  ASSERT_EQ(0, owner.size());
+
+  useConnection(connection);
+  owner.release(connection);
+  useConnection(other);
+  thief.release(other);
+  ASSERT_EQ(1, owner.size());
+  ASSERT_EQ(1, thief.size());
+}
+
+TEST_F(ConnectionPoolTest, ConnectIdleRetire) {
+  ConnectionPool pool("Test", 41, 0, _clientContexts);
+  ConnectedSocket *connections[3];
+
+  for (int i = 0; i < 3; ++i) {
+    Error error = pool.connectSocket(NULL, _server.clearAddress(), &connections[i]);
+    ASSERT_EQ(ESB_SUCCESS, error);
+    ASSERT_TRUE(connections[i]->connected());
+    ASSERT_EQ(ESB_SUCCESS, connections[i]->handshake());
+  }
+
+  ASSERT_EQ(0, pool.hits());
+  ASSERT_EQ(0, pool.misses());
+
+  for (int i = 0; i < 3; ++i) {
+    pool.release(connections[i]);
+  }
+
+  ASSERT_EQ(3, pool.idleSockets(NULL, _server.clearAddress()));
+  ASSERT_EQ(0, pool.idleSockets(NULL, _server.secureAddress()));
+
+  // The least recently released connection is retired first
+  ASSERT_EQ(2, pool.retireSockets(NULL, _server.clearAddress(), 1));
+  ASSERT_EQ(1, pool.idleSockets(NULL, _server.clearAddress()));
+  ASSERT_EQ(0, pool.retireSockets(NULL, _server.clearAddress(), 1));
+
+  ConnectedSocket *connection = NULL;
+  bool reused = false;
+  Error error = pool.acquireClearSocket(_server.clearAddress(), &connection, &reused);
+  ASSERT_EQ(ESB_SUCCESS, error);
+  ASSERT_TRUE(reused);
+  ASSERT_EQ(connections[2], connection);
+
+  useConnection(connection);
+  destroyConnection(connection);
+}
+
+TEST_F(ConnectionPoolTest, StolenConnectionOutlivesOwner) {
+  ConnectionPool::Group group(2);
+  ConnectionPool thief("Thief", 41, 0, _clientContexts, SystemAllocator::Instance(), &group);
+  ConnectedSocket *connection = NULL;
+  ConnectedSocket *other = NULL;
+  bool reused = false;
+
+  {
+    // Like a multiplexer's allocator, which frees everything at once when the multiplexer goes away
+    DiscardAllocator ownerAllocator(64 * 1024);
+    ConnectionPool owner("Owner", 41, 0, _clientContexts, ownerAllocator, &group);
+
+    // The thief finds nothing, so the owner hands off the connection it releases next
+    ASSERT_EQ(ESB_SUCCESS, owner.acquireClearSocket(_server.clearAddress(), &connection, &reused));
+    ASSERT_EQ(ESB_SUCCESS, thief.acquireClearSocket(_server.clearAddress(), &other, &reused));
+    ASSERT_FALSE(reused);
+    useConnection(connection);
+    owner.release(connection);
+
+    ASSERT_EQ(ESB_SUCCESS, thief.acquireClearSocket(_server.clearAddress(), &connection, &reused));
+    ASSERT_TRUE(reused);
+    ASSERT_EQ(1, thief.steals());
+  }
+
+  ASSERT_EQ(1U, group.size());
+  useConnection(connection);
+
+  // The thief recycles the stolen connection's memory for its next connection
+  connection->close();
+  thief.release(connection);
+  ASSERT_EQ(ESB_SUCCESS, thief.acquireClearSocket(_server.clearAddress(), &connection, &reused));
+  ASSERT_FALSE(reused);
+  useConnection(connection);
+  thief.release(connection);
+  useConnection(other);
+  thief.release(other);
+  ASSERT_EQ(2, thief.size());
+}
+
 TEST_F(ConnectionPoolTest, AcquireCloseRelease) {
   ConnectionPool pool("Test", 41, 0, _clientContexts);
   ConnectedSocket *connection = NULL;
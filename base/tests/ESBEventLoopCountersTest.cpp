@@ -0,0 +1,90 @@
+#ifndef ESB_EVENT_LOOP_COUNTERS_H
+#include <ESBEventLoopCounters.h>
+#endif
+
+#include <gtest/gtest.h>
+
+using namespace ESB;
+
+TEST(EventLoopCounters, Wakeups) {
+  EventLoopCounters counters("loop-test");
+
+  counters.recordWait(Date(10, 0), Date(11, 0), 0U);
+  counters.recordWait(Date(11, 0), Date(11, 500), 3U);
+  counters.recordWait(Date(11, 500), Date(11, 600), 7U);
+  counters.recordWait(Date(11, 600), Date(11, 700), 2U);
+
+  EXPECT_EQ(4U, counters.wakeups());
+  EXPECT_EQ(12U, counters.events());
+  EXPECT_EQ(7U, counters.maxEvents());
+  EXPECT_EQ(4U, counters.wait().queries());
+  EXPECT_DOUBLE_EQ(1000.0, counters.wait().maxMSec());
+  EXPECT_DOUBLE_EQ(0.1, counters.wait().minMSec());
+}
+
+TEST(EventLoopCounters, Handlers) {
+  EventLoopCounters counters("loop-test");
+
+  counters.recordAccept(Date(10, 0), Date(10, 10), "listener");
+  counters.recordConnect(Date(10, 0), Date(10, 20), "client");
+  counters.recordReadable(Date(10, 0), Date(10, 30), "server");
+  counters.recordReadable(Date(10, 0), Date(10, 40), "server");
+  counters.recordWritable(Date(10, 0), Date(10, 50), "server");
+  counters.recordCleanup(Date(10, 0), Date(10, 60));
+  counters.recordBusy(Date(10, 0), Date(10, 70));
+
+  EXPECT_EQ(1U, counters.accept().queries());
+  EXPECT_EQ(1U, counters.connect().queries());
+  EXPECT_EQ(2U, counters.readable().queries());
+  EXPECT_EQ(1U, counters.writable().queries());
+  EXPECT_EQ(1U, counters.cleanup().queries());
+  EXPECT_EQ(1U, counters.busy().queries());
+  EXPECT_NEAR(0.035, counters.readable().meanMSec(), 0.0001);
+  EXPECT_EQ(0U, counters.stalls());
+
+  // A clock that went backwards counts as an instant handler
+  counters.recordWritable(Date(10, 50), Date(10, 0), "server");
+  EXPECT_EQ(2U, counters.writable().queries());
+  EXPECT_DOUBLE_EQ(0.0, counters.writable().minMSec());
+}
+
+TEST(EventLoopCounters, Lag) {
+  EventLoopCounters counters("loop-test");
+
+  EXPECT_EQ(0U, counters.lagMicroSeconds());
+
+  for (int i = 0; i < 100; ++i) {
+    counters.recordBusy(Date(10, 0), Date(10, 8000));
+  }
+
+  EXPECT_NEAR(8000.0, (double)counters.lagMicroSeconds(), 10.0);
+
+  for (int i = 0; i < 100; ++i) {
+    counters.recordBusy(Date(10, 0), Date(10, 0));
+  }
+
+  EXPECT_GT(10U, counters.lagMicroSeconds());
+}
+
+TEST(EventLoopCounters, Stalls) {
+  EventLoopCounters counters("loop-test");
+
+  counters.recordReadable(Date(10, 0), Date(10, ESB_EVENT_LOOP_STALL_USEC), "server");
+  EXPECT_EQ(0U, counters.stalls());
+
+  counters.recordReadable(Date(10, 0), Date(12, 0), "server");
+  counters.recordWritable(Date(10, 0), Date(13, 0), "server");
+  EXPECT_EQ(2U, counters.stalls());
+  EXPECT_DOUBLE_EQ(3000.0, counters.writable().maxMSec());
+}
+
+TEST(EventLoopCounters, SpuriousEvents) {
+  EventLoopCounters counters("loop-test");
+
+  counters.countSpuriousReadable();
+  counters.countSpuriousWritable();
+  counters.countSpuriousWritable();
+
+  EXPECT_EQ(1U, counters.spuriousReadable());
+  EXPECT_EQ(2U, counters.spuriousWritable());
+}
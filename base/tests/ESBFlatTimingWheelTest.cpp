@@ -2,6 +2,14 @@
 #include <ESBFlatTimingWheel.h>
 #endif
 
+#ifndef ESB_HIERARCHICAL_TIMING_WHEEL_H
+#include <ESBHierarchicalTimingWheel.h>
+#endif
+
+#ifndef ESB_RAND_H
+#include <ESBRand.h>
+#endif
+
 #ifndef ESB_TIME_H
 #include <ESBTime.h>
 #endif
@@ -44,37 +52,44 @@ class CleanupTimer : public Timer {
   ESB_DISABLE_AUTO_COPY(CleanupTimer);
 };
 
-TEST(TimingWheelTest, Underflow) {
+// Every test runs against both implementations to show they behave the same.
+template <typename T>
+class TimingWheelTest : public ::testing::Test {};
+
+typedef ::testing::Types<FlatTimingWheel, HierarchicalTimingWheel> TimingWheelTypes;
+TYPED_TEST_SUITE(TimingWheelTest, TimingWheelTypes);
+
+TYPED_TEST(TimingWheelTest, Underflow) {
   Date now(Time::Instance().now().seconds(), 0);
   Timer timer;
   UInt32 ticks = 10;
   UInt32 tickMilliSeconds = 1;
-  FlatTimingWheel timingWheel(ticks, tickMilliSeconds, now);
+  TypeParam timingWheel(ticks, tickMilliSeconds, now);
 
   // Cannot schedule in the current tick
   Error error = timingWheel.insert(&timer, 0, now);
   EXPECT_EQ(ESB_UNDERFLOW, error);
 }
 
-TEST(TimingWheelTest, Overflow) {
+TYPED_TEST(TimingWheelTest, Overflow) {
   Date now(Time::Instance().now().seconds(), 0);
   Timer timer;
   UInt32 ticks = 10;
   UInt32 tickMilliSeconds = 1;
-  FlatTimingWheel timingWheel(ticks, tickMilliSeconds, now);
+  TypeParam timingWheel(ticks, tickMilliSeconds, now);
 
   // Cannot schedule past the timing wheel range
   Error error = timingWheel.insert(&timer, ticks * tickMilliSeconds, now);
   EXPECT_EQ(ESB_OVERFLOW, error);
 }
 
-TEST(TimingWheelTest, OnePerTick) {
+TYPED_TEST(TimingWheelTest, OnePerTick) {
   const UInt32 ticks = 5;
   const UInt32 tickMilliSeconds = 1;
   Date now(Time::Instance().now().seconds(), 0);
   const Date timeIncrement(0, tickMilliSeconds * 1000);
   CleanupTimer timers[ticks];
-  FlatTimingWheel timingWheel(ticks + 1, tickMilliSeconds, now);
+  TypeParam timingWheel(ticks + 1, tickMilliSeconds, now);
 
   // Schedule
 
@@ -108,14 +123,14 @@ TEST(TimingWheelTest, OnePerTick) {
   EXPECT_EQ(NULL, timer);
 }
 
-TEST(TimingWheelTest, ManyPerTick) {
+TYPED_TEST(TimingWheelTest, ManyPerTick) {
   const UInt32 ticks = 5;
   const UInt32 timersPerTick = 3;
   const UInt32 tickMilliSeconds = 1;
   Date now(Time::Instance().now().seconds(), 0);
   const Date timeIncrement(0, tickMilliSeconds * 1000);
   Timer timers[ticks][timersPerTick];
-  FlatTimingWheel timingWheel(ticks + 1, tickMilliSeconds, now);
+  TypeParam timingWheel(ticks + 1, tickMilliSeconds, now);
 
   // Schedule
 
@@ -153,14 +168,14 @@ TEST(TimingWheelTest, ManyPerTick) {
   EXPECT_EQ(NULL, timer);
 }
 
-TEST(TimingWheelTest, CompleteTick) {
+TYPED_TEST(TimingWheelTest, CompleteTick) {
   const UInt32 ticks = 5;
   const UInt32 timersPerTick = 3;
   const UInt32 tickMilliSeconds = 1;
   Date now(Time::Instance().now().seconds(), 0);
   const Date timeIncrement(0, 1000);
   Timer timers[ticks][timersPerTick];
-  FlatTimingWheel timingWheel(ticks + 1, tickMilliSeconds, now);
+  TypeParam timingWheel(ticks + 1, tickMilliSeconds, now);
 
   // Schedule
 
@@ -207,14 +222,14 @@ TEST(TimingWheelTest, CompleteTick) {
   EXPECT_EQ(NULL, timer);
 }
 
-TEST(TimingWheelTest, CatchupAfterNeglect) {
+TYPED_TEST(TimingWheelTest, CatchupAfterNeglect) {
   const UInt32 ticks = 6;
   const UInt32 timersPerTick = 3;
   const UInt32 tickMilliSeconds = 3;
   Date now(Time::Instance().now().seconds(), 0);
   const Date timeIncrement(0, tickMilliSeconds * ticks * 1000 / 2);
   Timer timers[ticks][timersPerTick];
-  FlatTimingWheel timingWheel(ticks + 1, tickMilliSeconds, now);
+  TypeParam timingWheel(ticks + 1, tickMilliSeconds, now);
 
   // Schedule
 
@@ -275,14 +290,14 @@ TEST(TimingWheelTest, CatchupAfterNeglect) {
   timingWheel.clear();
 }
 
-TEST(TimingWheelTest, Cancellation) {
+TYPED_TEST(TimingWheelTest, Cancellation) {
   const UInt32 ticks = 5;
   const UInt32 timersPerTick = 3;
   const UInt32 tickMilliSeconds = 1;
   Date now(Time::Instance().now().seconds(), 0);
   const Date timeIncrement(0, tickMilliSeconds * 1000);
   Timer timers[ticks][timersPerTick];
-  FlatTimingWheel timingWheel(ticks + 1, tickMilliSeconds, now);
+  TypeParam timingWheel(ticks + 1, tickMilliSeconds, now);
 
   // Schedule
 
@@ -330,14 +345,14 @@ TEST(TimingWheelTest, Cancellation) {
   EXPECT_EQ(NULL, timer);
 }
 
-TEST(TimingWheelTest, Clear) {
+TYPED_TEST(TimingWheelTest, Clear) {
   const UInt32 ticks = 5;
   const UInt32 timersPerTick = 3;
   const UInt32 tickMilliSeconds = 1;
   Date now(Time::Instance().now().seconds(), 0);
   const Date timeIncrement(0, tickMilliSeconds * 1000);
   Timer timers[ticks][timersPerTick];
-  FlatTimingWheel timingWheel(ticks + 1, tickMilliSeconds, now);
+  TypeParam timingWheel(ticks + 1, tickMilliSeconds, now);
 
   // Schedule
 
@@ -368,7 +383,7 @@ TEST(TimingWheelTest, Clear) {
   }
 }
 
-TEST(TimingWheelTest, CleanupHandlerClear) {
+TYPED_TEST(TimingWheelTest, CleanupHandlerClear) {
   TestCleanupHandler cleanupHandler;
   const UInt32 ticks = 5;
   const UInt32 timersPerTick = 3;
@@ -376,7 +391,7 @@ TEST(TimingWheelTest, CleanupHandlerClear) {
   Date now(Time::Instance().now().seconds(), 0);
   const Date timeIncrement(0, tickMilliSeconds * 1000);
   CleanupTimer timers[ticks][timersPerTick];
-  FlatTimingWheel timingWheel(ticks + 1, tickMilliSeconds, now);
+  TypeParam timingWheel(ticks + 1, tickMilliSeconds, now);
 
   // Schedule w. cleanup handlers
 
@@ -398,7 +413,7 @@ TEST(TimingWheelTest, CleanupHandlerClear) {
   EXPECT_EQ(ticks * timersPerTick, cleanupHandler.calls());
 }
 
-TEST(TimingWheelTest, CleanupHandlerDestructor) {
+TYPED_TEST(TimingWheelTest, CleanupHandlerDestructor) {
   TestCleanupHandler cleanupHandler;
   const UInt32 ticks = 5;
   const UInt32 timersPerTick = 3;
@@ -408,7 +423,7 @@ TEST(TimingWheelTest, CleanupHandlerDestructor) {
   CleanupTimer timers[ticks][timersPerTick];
 
   {
-    FlatTimingWheel timingWheel(ticks + 1, tickMilliSeconds, now);
+    TypeParam timingWheel(ticks + 1, tickMilliSeconds, now);
 
     // Schedule w. cleanup handlers
 
@@ -428,14 +443,14 @@ TEST(TimingWheelTest, CleanupHandlerDestructor) {
   EXPECT_EQ(ticks * timersPerTick, cleanupHandler.calls());
 }
 
-TEST(TimingWheelTest, AddTimeToTimer) {
+TYPED_TEST(TimingWheelTest, AddTimeToTimer) {
   const UInt32 ticks = 5;
   const UInt32 timersPerTick = 3;
   const UInt32 tickMilliSeconds = 1;
   Date now(Time::Instance().now().seconds(), 0);
   const Date timeIncrement(0, tickMilliSeconds * 1000);
   Timer timers[ticks][timersPerTick];
-  FlatTimingWheel timingWheel(ticks * 2 + 1, tickMilliSeconds, now);
+  TypeParam timingWheel(ticks * 2 + 1, tickMilliSeconds, now);
 
   // Schedule
 
@@ -495,14 +510,14 @@ TEST(TimingWheelTest, AddTimeToTimer) {
   EXPECT_EQ(NULL, timer);
 }
 
-TEST(TimingWheelTest, RemoveTimeFromTimer) {
+TYPED_TEST(TimingWheelTest, RemoveTimeFromTimer) {
   const UInt32 ticks = 5;
   const UInt32 timersPerTick = 3;
   const UInt32 tickMilliSeconds = 1;
   Date now(Time::Instance().now().seconds(), 0);
   const Date timeIncrement(0, tickMilliSeconds * 1000);
   Timer timers[ticks][timersPerTick];
-  FlatTimingWheel timingWheel(ticks * 2 + 1, tickMilliSeconds, now);
+  TypeParam timingWheel(ticks * 2 + 1, tickMilliSeconds, now);
 
   // Schedule
 
@@ -549,4 +564,90 @@ TEST(TimingWheelTest, RemoveTimeFromTimer) {
   now += timeIncrement;
   timer = timingWheel.nextExpired(now);
   EXPECT_EQ(NULL, timer);
-}
\ No newline at end of file
+}
+TEST(HierarchicalTimingWheelTest, LongDelays) {
+  const UInt32 ticks = 30 * 60 * 1000 * 2 / 10;
+  const UInt32 tickMilliSeconds = 10;
+  const UInt32 delays[] = {10, 630, 640, 650, 40950, 40960, 30 * 60 * 1000, 2621440, 2621450};
+  const UInt32 count = sizeof(delays) / sizeof(delays[0]);
+  Date now(Time::Instance().now().seconds(), 0);
+  Timer timers[count];
+  HierarchicalTimingWheel timingWheel(ticks, tickMilliSeconds, now);
+
+  for (UInt32 i = 0; i < count; ++i) {
+    EXPECT_EQ(ESB_SUCCESS, timingWheel.insert(&timers[i], delays[i], now));
+  }
+
+  // Each timer expires on its own tick, not one tick before
+  const Date start(now);
+  for (UInt32 i = 0; i < count; ++i) {
+    now = start + Date((delays[i] - tickMilliSeconds) / 1000, (delays[i] - tickMilliSeconds) % 1000 * 1000);
+    EXPECT_EQ(NULL, timingWheel.nextExpired(now));
+    now = start + Date(delays[i] / 1000, delays[i] % 1000 * 1000);
+    EXPECT_EQ(&timers[i], timingWheel.nextExpired(now));
+    EXPECT_EQ(NULL, timingWheel.nextExpired(now));
+  }
+}
+
+TEST(HierarchicalTimingWheelTest, MatchesFlatTimingWheel) {
+  const UInt32 ticks = 30 * 60 * 1000 * 2 / 10;
+  const UInt32 tickMilliSeconds = 10;
+  const UInt32 timerCount = 512;
+  const UInt32 steps = 20000;
+  Date now(Time::Instance().now().seconds(), 0);
+  Rand rand(42);
+  Timer flatTimers[timerCount];
+  Timer hierarchicalTimers[timerCount];
+  FlatTimingWheel flat(ticks, tickMilliSeconds, now);
+  HierarchicalTimingWheel hierarchical(ticks, tickMilliSeconds, now);
+  bool flatExpired[timerCount];
+  bool hierarchicalExpired[timerCount];
+
+  for (UInt32 step = 0; step < steps; ++step) {
+    const UInt32 i = rand.generate(0U, timerCount - 1);
+    // Mostly short delays like idle timeouts, sometimes very long ones, sometimes too long.
+    UInt32 delay = 0;
+    switch (rand.generate(0U, 9U)) {
+      case 0:
+        delay = rand.generate(0U, ticks * tickMilliSeconds + 1000U);
+        break;
+      case 1:
+        delay = rand.generate(0U, 100U);
+        break;
+      default:
+        delay = rand.generate(0U, 60000U);
+    }
+
+    switch (rand.generate(0U, 3U)) {
+      case 0:
+        if (flatTimers[i].inTimingWheel()) {
+          ASSERT_EQ(flat.remove(&flatTimers[i]), hierarchical.remove(&hierarchicalTimers[i]));
+        } else {
+          ASSERT_EQ(flat.insert(&flatTimers[i], delay, now), hierarchical.insert(&hierarchicalTimers[i], delay, now));
+        }
+        break;
+      case 1:
+        ASSERT_EQ(flat.update(&flatTimers[i], delay, now), hierarchical.update(&hierarchicalTimers[i], delay, now));
+        break;
+      default: {
+        // Advance time, occasionally by a lot, and compare what expired
+        UInt32 advance = rand.generate(0U, 19U) ? rand.generate(0U, 500U) : rand.generate(0U, 20U * 60 * 1000);
+        now += Date(advance / 1000, advance % 1000 * 1000);
+        memset(flatExpired, 0, sizeof(flatExpired));
+        memset(hierarchicalExpired, 0, sizeof(hierarchicalExpired));
+        for (Timer *timer = flat.nextExpired(now); timer; timer = flat.nextExpired(now)) {
+          flatExpired[timer - flatTimers] = true;
+        }
+        for (Timer *timer = hierarchical.nextExpired(now); timer; timer = hierarchical.nextExpired(now)) {
+          hierarchicalExpired[timer - hierarchicalTimers] = true;
+        }
+        ASSERT_EQ(0, memcmp(flatExpired, hierarchicalExpired, sizeof(flatExpired)));
+      }
+    }
+
+    ASSERT_EQ(flatTimers[i].inTimingWheel(), hierarchicalTimers[i].inTimingWheel());
+  }
+
+  flat.clear();
+  hierarchical.clear();
+}
@@ -0,0 +1,143 @@
+#ifndef ESB_HISTOGRAM_PERFORMANCE_COUNTER_H
+#include <ESBHistogramPerformanceCounter.h>
+#endif
+
+#ifndef ESB_THREAD_H
+#include <ESBThread.h>
+#endif
+
+#include <gtest/gtest.h>
+
+using namespace ESB;
+
+TEST(HistogramPerformanceCounter, Buckets) {
+  UInt32 previous = 0U;
+
+  for (UInt64 microSeconds = 0U; microSeconds < 1000000U; ++microSeconds) {
+    const UInt32 index = HistogramPerformanceCounter::BucketIndex(microSeconds);
+    ASSERT_LT(index, ESB_HISTOGRAM_BUCKETS);
+    ASSERT_LE(previous, index);
+    ASSERT_LE(microSeconds, HistogramPerformanceCounter::BucketValue(index));
+    // The bucket's upper bound is within 1/2^ESB_HISTOGRAM_SUB_BUCKET_BITS of every value it records
+    ASSERT_LE(HistogramPerformanceCounter::BucketValue(index) - microSeconds,
+              microSeconds >> ESB_HISTOGRAM_SUB_BUCKET_BITS);
+    previous = index;
+  }
+
+  ASSERT_EQ(ESB_HISTOGRAM_BUCKETS - 1, HistogramPerformanceCounter::BucketIndex(ESB_UINT32_MAX));
+  ASSERT_EQ(ESB_HISTOGRAM_BUCKETS - 1, HistogramPerformanceCounter::BucketIndex(ESB_UINT64_MAX));
+  ASSERT_EQ(ESB_UINT32_MAX, HistogramPerformanceCounter::BucketValue(ESB_HISTOGRAM_BUCKETS - 1));
+}
+
+TEST(HistogramPerformanceCounter, Percentiles) {
+  HistogramPerformanceCounter counter("histogram-test");
+
+  EXPECT_EQ(0U, counter.queries());
+  EXPECT_EQ(0.0, counter.percentileMSec(99.0));
+  EXPECT_EQ(0.0, counter.minMSec());
+
+  // 1..10000 microseconds
+  for (UInt64 microSeconds = 1U; microSeconds <= 10000U; ++microSeconds) {
+    counter.record(microSeconds);
+  }
+
+  EXPECT_EQ(10000U, counter.queries());
+  EXPECT_DOUBLE_EQ(0.001, counter.minMSec());
+  EXPECT_DOUBLE_EQ(10.0, counter.maxMSec());
+  EXPECT_NEAR(5.0005, counter.meanMSec(), 0.0001);
+  EXPECT_NEAR(5.0, counter.percentileMSec(50.0), 5.0 / ESB_HISTOGRAM_SUB_BUCKETS);
+  EXPECT_NEAR(9.0, counter.percentileMSec(90.0), 9.0 / ESB_HISTOGRAM_SUB_BUCKETS);
+  EXPECT_NEAR(9.9, counter.percentileMSec(99.0), 9.9 / ESB_HISTOGRAM_SUB_BUCKETS);
+  EXPECT_NEAR(9.99, counter.percentileMSec(99.9), 9.99 / ESB_HISTOGRAM_SUB_BUCKETS);
+  EXPECT_DOUBLE_EQ(10.0, counter.percentileMSec(100.0));
+  EXPECT_DOUBLE_EQ(0.001, counter.percentileMSec(0.0));
+}
+
+TEST(HistogramPerformanceCounter, Outlier) {
+  HistogramPerformanceCounter counter("histogram-test");
+
+  for (int i = 0; i < 999; ++i) {
+    counter.record(Date(10, 0), Date(10, 100));
+  }
+  counter.record(Date(10, 0), Date(12, 0));
+
+  EXPECT_EQ(1000U, counter.queries());
+  EXPECT_NEAR(0.1, counter.percentileMSec(50.0), 0.1 / ESB_HISTOGRAM_SUB_BUCKETS);
+  EXPECT_NEAR(0.1, counter.percentileMSec(99.9), 0.1 / ESB_HISTOGRAM_SUB_BUCKETS);
+  EXPECT_DOUBLE_EQ(2000.0, counter.percentileMSec(100.0));
+  EXPECT_DOUBLE_EQ(2000.0, counter.maxMSec());
+
+  // stop before start counts as 0
+  counter.record(Date(12, 0), Date(10, 0));
+  EXPECT_DOUBLE_EQ(0.0, counter.minMSec());
+}
+
+TEST(HistogramPerformanceCounter, Window) {
+  HistogramPerformanceCounter counter("histogram-test", Date(10, 0), Date(12, 0));
+
+  for (int i = 0; i < 50; ++i) {
+    counter.record(1000U);
+  }
+
+  EXPECT_DOUBLE_EQ(25.0, counter.queriesPerSec());
+  EXPECT_DOUBLE_EQ(1.0, counter.meanMSec());
+}
+
+TEST(HistogramPerformanceCounter, Snapshot) {
+  HistogramPerformanceCounter counter("histogram-test");
+  PerformanceCounter::Snapshot snapshot;
+
+  for (UInt64 microSeconds = 1U; microSeconds <= 1000U; ++microSeconds) {
+    counter.record(microSeconds);
+  }
+
+  counter.snapshot(&snapshot);
+  EXPECT_EQ(1000U, snapshot._queries);
+  EXPECT_NEAR(500.5, snapshot._sumMSec, 0.001);
+  EXPECT_TRUE(snapshot._hasPercentiles);
+  EXPECT_DOUBLE_EQ(counter.percentileMSec(50.0), snapshot._p50MSec);
+  EXPECT_DOUBLE_EQ(counter.percentileMSec(90.0), snapshot._p90MSec);
+  EXPECT_DOUBLE_EQ(counter.percentileMSec(99.0), snapshot._p99MSec);
+  EXPECT_DOUBLE_EQ(counter.percentileMSec(99.9), snapshot._p999MSec);
+}
+
+class RecordingThread : public Thread {
+ public:
+  RecordingThread(HistogramPerformanceCounter &counter, UInt32 offset) : _counter(counter), _offset(offset) {}
+  virtual ~RecordingThread() {}
+
+ protected:
+  virtual void run() {
+    for (UInt32 i = 0; i < 100000; ++i) {
+      _counter.record(_offset + i % 1000);
+    }
+  }
+
+ private:
+  HistogramPerformanceCounter &_counter;
+  const UInt32 _offset;
+
+  ESB_DISABLE_AUTO_COPY(RecordingThread);
+};
+
+TEST(HistogramPerformanceCounter, MergesThreads) {
+  HistogramPerformanceCounter counter("histogram-test", 4);
+  RecordingThread *threads[8];
+
+  for (UInt32 i = 0; i < sizeof(threads) / sizeof(threads[0]); ++i) {
+    threads[i] = new (SystemAllocator::Instance()) RecordingThread(counter, i * 1000);
+    ASSERT_EQ(ESB_SUCCESS, threads[i]->start());
+  }
+
+  for (UInt32 i = 0; i < sizeof(threads) / sizeof(threads[0]); ++i) {
+    threads[i]->join();
+    threads[i]->~RecordingThread();
+    SystemAllocator::Instance().deallocate(threads[i]);
+  }
+
+  EXPECT_EQ(800000U, counter.queries());
+  EXPECT_DOUBLE_EQ(0.0, counter.minMSec());
+  EXPECT_DOUBLE_EQ(7.999, counter.maxMSec());
+  EXPECT_NEAR(3.9995, counter.meanMSec(), 0.0001);
+  EXPECT_NEAR(4.0, counter.percentileMSec(50.0), 4.0 / ESB_HISTOGRAM_SUB_BUCKETS);
+}
@@ -0,0 +1,185 @@
+#ifndef ESB_KEYED_SLOT_COUNTER_H
+#include <ESBKeyedSlotCounter.h>
+#endif
+
+#ifndef ESB_THREAD_H
+#include <ESBThread.h>
+#endif
+
+#ifndef ESB_SHARED_INT_H
+#include <ESBSharedInt.h>
+#endif
+
+#include <gtest/gtest.h>
+
+using namespace ESB;
+
+TEST(KeyedSlotCounter, AcquireAndRelease) {
+  KeyedSlotCounter counter(5, 1024);
+  ASSERT_EQ(1024U, counter.capacity());
+
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(ESB_SUCCESS, counter.acquire(42, 1));
+  }
+  EXPECT_EQ(ESB_OVERFLOW, counter.acquire(42, 1));
+  EXPECT_EQ(5U, counter.inUse(42));
+
+  // Other keys have their own counts
+  EXPECT_EQ(ESB_SUCCESS, counter.acquire(43, 5));
+  EXPECT_EQ(ESB_OVERFLOW, counter.acquire(43, 1));
+  EXPECT_EQ(0U, counter.inUse(44));
+
+  counter.release(42, 2);
+  EXPECT_EQ(3U, counter.inUse(42));
+  EXPECT_EQ(ESB_OVERFLOW, counter.acquire(42, 3));
+  EXPECT_EQ(ESB_SUCCESS, counter.acquire(42, 2));
+
+  // Releasing more than is in use stops at 0
+  counter.release(43, 10);
+  EXPECT_EQ(0U, counter.inUse(43));
+  counter.release(44, 1);
+  EXPECT_EQ(0U, counter.inUse(44));
+
+  EXPECT_EQ(0U, counter.untracked());
+}
+
+TEST(KeyedSlotCounter, Untracked) {
+  // Every key shares the same probe window
+  KeyedSlotCounter counter(1, ESB_KEYED_SLOT_COUNTER_PROBES);
+  ASSERT_EQ(ESB_KEYED_SLOT_COUNTER_PROBES, counter.capacity());
+
+  for (UInt32 key = 1; key <= ESB_KEYED_SLOT_COUNTER_PROBES; ++key) {
+    ASSERT_EQ(ESB_SUCCESS, counter.acquire(key, 1));
+  }
+
+  // A key with nowhere to go is let through
+  const UInt32 key = ESB_KEYED_SLOT_COUNTER_PROBES + 1U;
+  bool tracked = true;
+  EXPECT_EQ(ESB_SUCCESS, counter.acquire(key, 1, &tracked));
+  EXPECT_FALSE(tracked);
+  EXPECT_EQ(ESB_SUCCESS, counter.acquire(key, 1));
+  EXPECT_EQ(2U, counter.untracked());
+  EXPECT_EQ(0U, counter.inUse(key));
+
+  // Until another key frees its entry
+  counter.release(3, 1);
+  EXPECT_EQ(ESB_SUCCESS, counter.acquire(key, 1, &tracked));
+  EXPECT_TRUE(tracked);
+  EXPECT_EQ(ESB_OVERFLOW, counter.acquire(key, 1));
+  EXPECT_EQ(1U, counter.inUse(key));
+  EXPECT_EQ(2U, counter.untracked());
+
+  EXPECT_EQ(ESB_SUCCESS, counter.acquire(3, 1));
+  EXPECT_EQ(3U, counter.untracked());
+}
+
+class KeyedSlotThread : public Thread {
+ public:
+  KeyedSlotThread(KeyedSlotCounter &counter, SharedInt &granted) : _counter(counter), _granted(granted) {}
+
+  virtual ~KeyedSlotThread() {}
+
+ protected:
+  virtual void run() {
+    for (UInt32 i = 0; i < 100000; ++i) {
+      // Key 7 is shared by every thread and never released, the others come and go
+      if (0 == i % 2) {
+        if (ESB_SUCCESS == _counter.acquire(7, 1)) {
+          _granted.inc();
+        }
+      } else if (ESB_SUCCESS == _counter.acquire(1000U + i % 10000U, 1)) {
+        _counter.release(1000U + i % 10000U, 1);
+      }
+    }
+  }
+
+ private:
+  KeyedSlotCounter &_counter;
+  SharedInt &_granted;
+};
+
+TEST(KeyedSlotCounter, Concurrent) {
+  KeyedSlotCounter counter(100, 1 << 16);
+  SharedInt granted;
+  const UInt32 count = 4;
+  KeyedSlotThread *threads[count];
+
+  for (UInt32 i = 0; i < count; ++i) {
+    threads[i] = new (SystemAllocator::Instance()) KeyedSlotThread(counter, granted);
+    ASSERT_EQ(ESB_SUCCESS, threads[i]->start());
+  }
+
+  for (UInt32 i = 0; i < count; ++i) {
+    ASSERT_EQ(ESB_SUCCESS, threads[i]->join());
+    threads[i]->~KeyedSlotThread();
+    SystemAllocator::Instance().deallocate(threads[i]);
+  }
+
+  // The shared key's slots were handed out exactly once no matter how the threads raced
+  EXPECT_EQ(100, granted.get());
+  EXPECT_EQ(100U, counter.inUse(7));
+  EXPECT_EQ(0U, counter.inUse(1000));
+  EXPECT_EQ(0U, counter.untracked());
+}
+
+class ExclusiveSlotThread : public Thread {
+ public:
+  ExclusiveSlotThread(KeyedSlotCounter &counter, SharedInt &holders, SharedInt &violations)
+      : _counter(counter), _holders(holders), _violations(violations) {}
+
+  virtual ~ExclusiveSlotThread() {}
+
+ protected:
+  virtual void run() {
+    for (UInt32 i = 0; i < 100000; ++i) {
+      if (0 == i % 2) {
+        if (ESB_SUCCESS == _counter.acquire(7, 1)) {
+          if (1U < _holders.inc()) {
+            _violations.inc();
+          }
+          _holders.dec();
+          _counter.release(7, 1);
+        }
+      } else {
+        // Other keys keep freeing and taking over entries in key 7's probe window
+        const UInt32 key = 100U + i % 8U;
+        if (ESB_SUCCESS == _counter.acquire(key, 1)) {
+          _counter.release(key, 1);
+        }
+      }
+    }
+  }
+
+ private:
+  KeyedSlotCounter &_counter;
+  SharedInt &_holders;
+  SharedInt &_violations;
+};
+
+TEST(KeyedSlotCounter, NoDuplicateEntries) {
+  // One probe window, so every key competes for the same entries
+  KeyedSlotCounter counter(1, ESB_KEYED_SLOT_COUNTER_PROBES);
+  SharedInt holders;
+  SharedInt violations;
+  const UInt32 count = 4;
+  ExclusiveSlotThread *threads[count];
+
+  for (UInt32 i = 0; i < count; ++i) {
+    threads[i] = new (SystemAllocator::Instance()) ExclusiveSlotThread(counter, holders, violations);
+    ASSERT_EQ(ESB_SUCCESS, threads[i]->start());
+  }
+
+  for (UInt32 i = 0; i < count; ++i) {
+    ASSERT_EQ(ESB_SUCCESS, threads[i]->join());
+    threads[i]->~ExclusiveSlotThread();
+    SystemAllocator::Instance().deallocate(threads[i]);
+  }
+
+  // Threads that took over two entries for the key at once would both have been let in, and one entry would be left
+  // counting a slot nobody holds
+  EXPECT_EQ(0U, violations.get());
+  EXPECT_EQ(0U, counter.inUse(7));
+  EXPECT_EQ(ESB_SUCCESS, counter.acquire(7, 1));
+  EXPECT_EQ(ESB_OVERFLOW, counter.acquire(7, 1));
+  EXPECT_EQ(0U, counter.untracked());
+}
@@ -0,0 +1,194 @@
+#ifndef ESB_LOG_RECORD_H
+#include <ESBLogRecord.h>
+#endif
+
+#ifndef ESB_LOG_DECODER_H
+#include <ESBLogDecoder.h>
+#endif
+
+#include <gtest/gtest.h>
+
+using namespace ESB;
+
+// Capture the arguments, render them, and compare with snprintf
+static void RoundTrip(const char *format, ...) __attribute__((format(printf, 1, 2)));
+
+static void RoundTrip(const char *format, ...) {
+  unsigned char record[1024];
+  char expected[1024];
+  char actual[1024];
+  va_list args;
+
+  va_start(args, format);
+  vsnprintf(expected, sizeof(expected), format, args);
+  va_end(args);
+
+  va_start(args, format);
+  const UInt32 size = LogRecord::EncodeArguments(record, sizeof(record), format, args);
+  va_end(args);
+
+  ASSERT_LT(0U, size) << format;
+  ASSERT_EQ(LogRecord::Arguments, LogRecord::RecordKind(record));
+  ASSERT_EQ(size, LogRecord::RecordSize(record));
+  ASSERT_EQ((UInt64)(UWord)format, LogRecord::FormatId(record));
+  ASSERT_EQ((int)strlen(expected), LogRecord::Render(actual, sizeof(actual), format, record)) << format;
+  ASSERT_STREQ(expected, actual);
+}
+
+static UInt32 Capture(unsigned char *record, UInt32 capacity, const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  const UInt32 size = LogRecord::EncodeArguments(record, capacity, format, args);
+  va_end(args);
+  return size;
+}
+
+TEST(LogRecord, Integers) {
+  RoundTrip("plain text\n");
+  RoundTrip("100%% %d %i %u\n", -42, 17, 4000000000U);
+  RoundTrip("%hhd %hd %hhu %hu\n", -3, -30000, 250, 65000);
+  RoundTrip("%ld %lu %lld %llu\n", -1L << 40, 1UL << 63, -1LL, 18446744073709551615ULL);
+  RoundTrip("%zu %zd %jd %td\n", (size_t)12345, (ssize_t)-5, (intmax_t)-7, (ptrdiff_t)-9);
+  RoundTrip("[%5d] [%-5d] [%05d] [%+d] [% d] [%.3d]\n", 1, 2, 3, 4, 5, 6);
+  RoundTrip("%x %X %#x %o %#o\n", 255U, 255U, 255U, 8U, 8U);
+  RoundTrip("[%*d] [%-*.*u]\n", 6, -12, 8, 4, 7U);
+  RoundTrip("%c%c%c\n", 'a', 'b', 'c');
+}
+
+TEST(LogRecord, Doubles) {
+  RoundTrip("%f %.2f %e %E %g %G\n", 3.14159, 2.71828, 6.02e23, 1.6e-19, 0.0001, 1e100);
+  RoundTrip("[%10.3f] [%-10.1e] [%a]\n", -1.5, 12345.678, 0.5);
+}
+
+TEST(LogRecord, Strings) {
+  RoundTrip("%s %s!\n", "hello", "world");
+  RoundTrip("[%10s] [%-10s] [%.3s] [%.*s]\n", "right", "left", "truncated", 2, "star");
+  RoundTrip("%s %d %p\n", "", 0, (void *)0x1234);
+}
+
+TEST(LogRecord, NullString) {
+  unsigned char record[1024];
+  char text[64];
+  const char *format = "[%s]\n";
+  ASSERT_LT(0U, Capture(record, sizeof(record), format, NULL));
+  ASSERT_EQ(9, LogRecord::Render(text, sizeof(text), format, record));
+  ASSERT_STREQ("[(null)]\n", text);
+}
+
+TEST(LogRecord, Uncapturable) {
+  unsigned char record[1024];
+  int count = 0;
+  ASSERT_EQ(0U, Capture(record, sizeof(record), "%d%n\n", 1, &count));
+  ASSERT_EQ(0U, Capture(record, sizeof(record), "%Lf\n", (long double)1.0));
+  ASSERT_EQ(0U, Capture(record, sizeof(record), "%ls\n", L"wide"));
+
+  // Arguments that do not fit
+  char padding[100];
+  memset(padding, 'x', sizeof(padding) - 1);
+  padding[sizeof(padding) - 1] = 0;
+  ASSERT_EQ(0U, Capture(record, 64, "%s\n", padding));
+  ASSERT_LT(0U, Capture(record, 128, "%s\n", padding));
+}
+
+TEST(LogRecord, Truncates) {
+  unsigned char record[1024];
+  char text[8];
+  const char *format = "%s %d\n";
+  ASSERT_LT(0U, Capture(record, sizeof(record), format, "truncated", 42));
+  ASSERT_EQ(7, LogRecord::Render(text, sizeof(text), format, record));
+  ASSERT_STREQ("truncat", text);
+
+  // Rendering with a different format fails instead of reading past the arguments
+  ASSERT_EQ(-1, LogRecord::Render(text, sizeof(text), "%s %d %d\n", record));
+}
+
+TEST(LogRecord, Text) {
+  unsigned char record[16];
+  UInt32 length = 0;
+  ASSERT_EQ(ESB_LOG_RECORD_HEADER_SIZE + 6U, LogRecord::EncodeText(record, sizeof(record), "hello\n", 6));
+  ASSERT_EQ(LogRecord::Text, LogRecord::RecordKind(record));
+  const char *text = LogRecord::TextString(record, &length);
+  ASSERT_EQ(6U, length);
+  ASSERT_EQ(0, memcmp("hello\n", text, length));
+
+  // Text that does not fit is truncated
+  ASSERT_EQ(sizeof(record), LogRecord::EncodeText(record, sizeof(record), "0123456789abcdefghij", 20));
+}
+
+TEST(LogDecoder, Decode) {
+  static const char *first = "first %d %s\n";
+  static const char *second = "second %.1f\n";
+  unsigned char record[1024];
+  UInt32 size = 0;
+
+  FILE *input = tmpfile();
+  ASSERT_TRUE(input);
+
+  size = LogRecord::EncodeHeader(record, sizeof(record));
+  fwrite(record, 1, size, input);
+  size = LogRecord::EncodeFormat(record, sizeof(record), first);
+  fwrite(record, 1, size, input);
+  size = Capture(record, sizeof(record), first, 1, "a");
+  fwrite(record, 1, size, input);
+  size = LogRecord::EncodeText(record, sizeof(record), "text\n", 5);
+  fwrite(record, 1, size, input);
+  size = LogRecord::EncodeFormat(record, sizeof(record), second);
+  fwrite(record, 1, size, input);
+  size = Capture(record, sizeof(record), second, 2.25);
+  fwrite(record, 1, size, input);
+  size = Capture(record, sizeof(record), first, 3, "c");
+  fwrite(record, 1, size, input);
+  rewind(input);
+
+  FILE *output = tmpfile();
+  ASSERT_TRUE(output);
+
+  LogDecoder decoder;
+  ASSERT_EQ(ESB_SUCCESS, decoder.decode(input, output));
+
+  char text[1024];
+  rewind(output);
+  size = fread(text, 1, sizeof(text) - 1, output);
+  text[size] = 0;
+  ASSERT_STREQ("first 1 a\ntext\nsecond 2.2\nfirst 3 c\n", text);
+
+  // A Header record forgets the format strings
+  rewind(input);
+  fclose(output);
+  output = tmpfile();
+  size = LogRecord::EncodeHeader(record, sizeof(record));
+  fseek(input, 0, SEEK_END);
+  fwrite(record, 1, size, input);
+  size = Capture(record, sizeof(record), first, 4, "d");
+  fwrite(record, 1, size, input);
+  rewind(input);
+  ASSERT_EQ(ESB_CANNOT_FIND, decoder.decode(input, output));
+
+  fclose(input);
+  fclose(output);
+}
+
+TEST(LogDecoder, RejectsMalformed) {
+  unsigned char record[1024];
+  LogDecoder decoder;
+
+  // Must start with a Header record
+  FILE *input = tmpfile();
+  ASSERT_TRUE(input);
+  UInt32 size = LogRecord::EncodeText(record, sizeof(record), "text\n", 5);
+  fwrite(record, 1, size, input);
+  rewind(input);
+  ASSERT_EQ(ESB_CANNOT_PARSE, decoder.decode(input, stdout));
+  fclose(input);
+
+  // Truncated record
+  input = tmpfile();
+  ASSERT_TRUE(input);
+  size = LogRecord::EncodeHeader(record, sizeof(record));
+  fwrite(record, 1, size, input);
+  size = LogRecord::EncodeText(record, sizeof(record), "text\n", 5);
+  fwrite(record, 1, size - 1, input);
+  rewind(input);
+  ASSERT_EQ(ESB_CANNOT_PARSE, decoder.decode(input, stdout));
+  fclose(input);
+}
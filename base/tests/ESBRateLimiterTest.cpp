@@ -0,0 +1,112 @@
+#ifndef ESB_RATE_LIMITER_H
+#include <ESBRateLimiter.h>
+#endif
+
+#ifndef ESB_THREAD_H
+#include <ESBThread.h>
+#endif
+
+#ifndef ESB_SHARED_INT_H
+#include <ESBSharedInt.h>
+#endif
+
+#include <gtest/gtest.h>
+
+using namespace ESB;
+
+TEST(RateLimiter, BurstAndRefill) {
+  // 10 tokens per 100 msec, so one token every 10 msec
+  RateLimiter limiter(10, 100000, 1024, 4);
+  ASSERT_EQ(4U, limiter.shards());
+  ASSERT_EQ(1024U, limiter.capacity());
+
+  const Date start(1000, 0);
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(ESB_SUCCESS, limiter.acquire(42, 1, start));
+  }
+  EXPECT_EQ(ESB_OVERFLOW, limiter.acquire(42, 1, start));
+
+  // Other keys have their own buckets
+  EXPECT_EQ(ESB_SUCCESS, limiter.acquire(43, 10, start));
+  EXPECT_EQ(ESB_OVERFLOW, limiter.acquire(43, 1, start));
+
+  // One token comes back every 10 msec
+  EXPECT_EQ(ESB_OVERFLOW, limiter.acquire(42, 1, Date(1000, 9000)));
+  EXPECT_EQ(ESB_SUCCESS, limiter.acquire(42, 1, Date(1000, 10000)));
+  EXPECT_EQ(ESB_OVERFLOW, limiter.acquire(42, 1, Date(1000, 10000)));
+  EXPECT_EQ(ESB_OVERFLOW, limiter.acquire(42, 3, Date(1000, 39999)));
+  EXPECT_EQ(ESB_SUCCESS, limiter.acquire(42, 3, Date(1000, 40000)));
+
+  // A full window refills the bucket but never beyond the limit
+  EXPECT_EQ(ESB_SUCCESS, limiter.acquire(42, 10, Date(1010, 0)));
+  EXPECT_EQ(ESB_OVERFLOW, limiter.acquire(42, 1, Date(1010, 0)));
+  EXPECT_EQ(ESB_OVERFLOW, limiter.acquire(42, 11, Date(2000, 0)));
+
+  EXPECT_EQ(0U, limiter.evictions());
+}
+
+TEST(RateLimiter, Eviction) {
+  RateLimiter limiter(1, 1000000, 64, 1);
+  ASSERT_EQ(64U, limiter.capacity());
+  const Date now(1000, 0);
+
+  // Far more distinct keys than slots, all of them still refilling, forces the CLOCK sweep to evict
+  for (UInt64 key = 1; key <= 10000; ++key) {
+    ASSERT_EQ(ESB_SUCCESS, limiter.acquire(key, 1, now));
+  }
+  EXPECT_LT(0U, limiter.evictions());
+
+  // The most recent key is still tracked
+  EXPECT_EQ(ESB_OVERFLOW, limiter.acquire(10000, 1, now));
+
+  // Once the buckets have refilled, new keys replace old ones without counting as evictions
+  const UInt64 evictions = limiter.evictions();
+  const Date later(1002, 0);
+  for (UInt64 key = 20001; key <= 20064; ++key) {
+    ASSERT_EQ(ESB_SUCCESS, limiter.acquire(key, 1, later));
+  }
+  EXPECT_GE(evictions + 64U, limiter.evictions());
+}
+
+class AcquireThread : public Thread {
+ public:
+  AcquireThread(RateLimiter &limiter, SharedInt &granted) : _limiter(limiter), _granted(granted) {}
+
+  virtual ~AcquireThread() {}
+
+ protected:
+  virtual void run() {
+    const Date now(1000, 0);
+    for (UInt64 i = 0; i < 100000; ++i) {
+      // Key 7 is shared by every thread, the others are spread across the table without filling it
+      if (ESB_SUCCESS == _limiter.acquire(0 == i % 2 ? 7U : 1000U + i % 10000U, 1, now) && 0 == i % 2) {
+        _granted.inc();
+      }
+    }
+  }
+
+ private:
+  RateLimiter &_limiter;
+  SharedInt &_granted;
+};
+
+TEST(RateLimiter, Concurrent) {
+  RateLimiter limiter(1000, 1000000, 1 << 16, 8);
+  SharedInt granted;
+  const UInt32 count = 4;
+  AcquireThread *threads[count];
+
+  for (UInt32 i = 0; i < count; ++i) {
+    threads[i] = new (SystemAllocator::Instance()) AcquireThread(limiter, granted);
+    ASSERT_EQ(ESB_SUCCESS, threads[i]->start());
+  }
+
+  for (UInt32 i = 0; i < count; ++i) {
+    ASSERT_EQ(ESB_SUCCESS, threads[i]->join());
+    threads[i]->~AcquireThread();
+    SystemAllocator::Instance().deallocate(threads[i]);
+  }
+
+  // The shared key's tokens were handed out exactly once no matter how the threads raced
+  EXPECT_EQ(1000, granted.get());
+}
@@ -0,0 +1,245 @@
+#ifndef ESB_SHARDED_BUFFER_POOL_H
+#include <ESBShardedBufferPool.h>
+#endif
+
+#ifndef ESB_THREAD_H
+#include <ESBThread.h>
+#endif
+
+#include <gtest/gtest.h>
+
+using namespace ESB;
+
+TEST(ShardedBufferPool, ReuseWithinShard) {
+  ShardedBufferPool pool(1024, 4);
+  ASSERT_EQ(4, pool.shards());
+
+  Buffer *buffer = pool.acquireBuffer(0);
+  ASSERT_TRUE(buffer);
+  EXPECT_EQ(1024, buffer->capacity());
+  EXPECT_EQ(1, pool.buffers());
+
+  buffer->putNext('x');
+  pool.releaseBuffer(0, buffer);
+  EXPECT_EQ(1, pool.cachedBuffers(0));
+
+  Buffer *again = pool.acquireBuffer(0);
+  EXPECT_EQ(buffer, again);
+  EXPECT_EQ(0, again->readable());
+  EXPECT_EQ(0, pool.cachedBuffers(0));
+
+  // Another shard does not see shard 0's cache
+  Buffer *other = pool.acquireBuffer(1);
+  ASSERT_TRUE(other);
+  EXPECT_NE(buffer, other);
+  EXPECT_EQ(2, pool.buffers());
+  EXPECT_EQ(2, pool.highWatermark());
+
+  pool.releaseBuffer(0, again);
+  pool.releaseBuffer(1, other);
+  EXPECT_EQ(0, pool.remoteReleases());
+}
+
+TEST(ShardedBufferPool, MaxBuffers) {
+  ShardedBufferPool pool(64, 2, 3);
+  Buffer *buffers[3];
+
+  buffers[0] = pool.acquireBuffer(0);
+  buffers[1] = pool.acquireBuffer(1);
+  buffers[2] = pool.acquireBuffer(1);
+  ASSERT_TRUE(buffers[0] && buffers[1] && buffers[2]);
+
+  EXPECT_EQ(NULL, pool.acquireBuffer(0));
+  EXPECT_EQ(NULL, pool.acquireBuffer(1));
+  EXPECT_EQ(3, pool.buffers());
+
+  // A cached buffer can be reused even though the pool is at capacity
+  pool.releaseBuffer(1, buffers[2]);
+  buffers[2] = pool.acquireBuffer(1);
+  EXPECT_TRUE(buffers[2]);
+
+  for (int i = 0; i < 3; ++i) {
+    pool.releaseBuffer(0 == i ? 0 : 1, buffers[i]);
+  }
+  EXPECT_EQ(3, pool.highWatermark());
+}
+
+TEST(ShardedBufferPool, MaxCachedBuffers) {
+  ShardedBufferPool pool(64, 1, 0, 2);
+  Buffer *buffers[4];
+
+  for (int i = 0; i < 4; ++i) {
+    buffers[i] = pool.acquireBuffer(0);
+    ASSERT_TRUE(buffers[i]);
+  }
+
+  for (int i = 0; i < 4; ++i) {
+    pool.releaseBuffer(0, buffers[i]);
+  }
+
+  EXPECT_EQ(2, pool.cachedBuffers(0));
+  EXPECT_EQ(2, pool.buffers());
+  EXPECT_EQ(4, pool.highWatermark());
+}
+
+TEST(ShardedBufferPool, RemoteReleaseGoesHome) {
+  ShardedBufferPool pool(64, 2);
+
+  Buffer *buffer = pool.acquireBuffer(0);
+  ASSERT_TRUE(buffer);
+
+  pool.releaseBuffer(1, buffer);
+  EXPECT_EQ(1, pool.remoteReleases());
+  EXPECT_EQ(0, pool.cachedBuffers(1));
+
+  // Shard 1 allocates its own buffer instead of keeping shard 0's
+  Buffer *other = pool.acquireBuffer(1);
+  EXPECT_NE(buffer, other);
+
+  EXPECT_EQ(buffer, pool.acquireBuffer(0));
+  EXPECT_EQ(2, pool.buffers());
+
+  pool.releaseBuffer(0, buffer);
+  pool.releaseBuffer(1, other);
+}
+
+TEST(ShardedBufferPool, ReclaimAtMaxBuffers) {
+  ShardedBufferPool pool(64, 3, 3);
+  Buffer *buffers[3];
+
+  for (int i = 0; i < 3; ++i) {
+    buffers[i] = pool.acquireBuffer(0);
+    ASSERT_TRUE(buffers[i]);
+  }
+  EXPECT_EQ(NULL, pool.acquireBuffer(1));
+
+  // Shard 0 has not taken these back yet, so shard 1 takes them over instead of failing
+  pool.releaseBuffer(2, buffers[1]);
+  pool.releaseBuffer(2, buffers[2]);
+  EXPECT_EQ(2, pool.remoteReleases());
+
+  Buffer *reclaimed = pool.acquireBuffer(1);
+  ASSERT_TRUE(reclaimed);
+  EXPECT_TRUE(reclaimed == buffers[1] || reclaimed == buffers[2]);
+  EXPECT_EQ(1, pool.cachedBuffers(1));
+  EXPECT_EQ(0, pool.cachedBuffers(0));
+  EXPECT_EQ(3, pool.buffers());
+
+  // The buffers belong to shard 1 now
+  Buffer *other = pool.acquireBuffer(1);
+  EXPECT_EQ(reclaimed == buffers[1] ? buffers[2] : buffers[1], other);
+  pool.releaseBuffer(1, reclaimed);
+  EXPECT_EQ(1, pool.cachedBuffers(1));
+  EXPECT_EQ(2, pool.remoteReleases());
+
+  // Nothing is left to take over
+  EXPECT_EQ(NULL, pool.acquireBuffer(0));
+  EXPECT_EQ(NULL, pool.acquireBuffer(2));
+
+  pool.releaseBuffer(0, buffers[0]);
+  pool.releaseBuffer(1, other);
+  EXPECT_EQ(2, pool.cachedBuffers(1));
+  EXPECT_EQ(2, pool.remoteReleases());
+}
+
+// Releases a batch of buffers that belong to shard 0 as if running on another shard.
+class RemoteReleaseThread : public Thread {
+ public:
+  RemoteReleaseThread(ShardedBufferPool &pool, UInt32 shard, Buffer **buffers, UInt32 count)
+      : _pool(pool), _shard(shard), _buffers(buffers), _count(count) {}
+
+  virtual ~RemoteReleaseThread() {}
+
+ protected:
+  virtual void run() {
+    for (UInt32 i = 0; i < _count; ++i) {
+      _pool.releaseBuffer(_shard, _buffers[i]);
+    }
+  }
+
+ private:
+  ShardedBufferPool &_pool;
+  const UInt32 _shard;
+  Buffer **_buffers;
+  const UInt32 _count;
+};
+
+// Owns shard 0 and keeps taking back buffers while the other threads return them.
+class OwnerThread : public Thread {
+ public:
+  OwnerThread(ShardedBufferPool &pool, SharedInt &remaining) : _pool(pool), _remaining(remaining), _failures(0) {}
+
+  virtual ~OwnerThread() {}
+
+  inline UInt32 failures() const { return _failures; }
+
+ protected:
+  virtual void run() {
+    while (0 < _remaining.get()) {
+      Buffer *buffer = _pool.acquireBuffer(0);
+      if (!buffer) {
+        continue;
+      }
+      if (0 != buffer->readable()) {
+        ++_failures;
+      }
+      buffer->putNext('x');
+      _pool.releaseBuffer(0, buffer);
+    }
+  }
+
+ private:
+  ShardedBufferPool &_pool;
+  SharedInt &_remaining;
+  UInt32 _failures;
+};
+
+TEST(ShardedBufferPool, ConcurrentRemoteReleases) {
+  const UInt32 releasers = 4;
+  const UInt32 count = 1000;
+  const UInt32 total = releasers * count;
+  ShardedBufferPool pool(64, releasers + 1, total);
+  Buffer **buffers = new Buffer *[total];
+
+  for (UInt32 i = 0; i < total; ++i) {
+    buffers[i] = pool.acquireBuffer(0);
+    ASSERT_TRUE(buffers[i]);
+  }
+  ASSERT_EQ(total, pool.buffers());
+
+  // The pool is full, so the owner can only ever get back buffers the other threads released
+  SharedInt remaining(releasers);
+  OwnerThread owner(pool, remaining);
+  ASSERT_EQ(ESB_SUCCESS, owner.start());
+
+  RemoteReleaseThread *threads[releasers];
+  for (UInt32 i = 0; i < releasers; ++i) {
+    threads[i] = new (SystemAllocator::Instance()) RemoteReleaseThread(pool, i + 1, buffers + i * count, count);
+    ASSERT_EQ(ESB_SUCCESS, threads[i]->start());
+  }
+
+  for (UInt32 i = 0; i < releasers; ++i) {
+    ASSERT_EQ(ESB_SUCCESS, threads[i]->join());
+    threads[i]->~RemoteReleaseThread();
+    SystemAllocator::Instance().deallocate(threads[i]);
+    remaining.dec();
+  }
+
+  ASSERT_EQ(ESB_SUCCESS, owner.join());
+  EXPECT_EQ(0, owner.failures());
+  EXPECT_EQ(total, pool.remoteReleases());
+
+  // Every buffer made it home
+  for (UInt32 i = 0; i < total; ++i) {
+    buffers[i] = pool.acquireBuffer(0);
+    ASSERT_TRUE(buffers[i]);
+  }
+  EXPECT_EQ(NULL, pool.acquireBuffer(0));
+  EXPECT_EQ(total, pool.buffers());
+  EXPECT_EQ(total, pool.highWatermark());
+
+  for (UInt32 i = 0; i < total; ++i) {
+    pool.releaseBuffer(0, buffers[i]);
+  }
+  delete[] buffers;
+}
@@ -164,3 +164,33 @@ TEST(SharedEmbeddedMap, InsertFindRemove) {
   // automatically using cleanup callbacks.  If it doesn't the leak detector
   // should catch it.
 }
+
+TEST(SharedEmbeddedMap, CountRemoveLast) {
+  Allocator &allocator = SystemAllocator::Instance();
+  SocketAddressCallbacks callbacks(allocator);
+  SharedEmbeddedMap map(callbacks, 1, 0, allocator);
+  SocketAddress first("10.0.0.1", 80, SocketAddress::TCP);
+  SocketAddress second("10.0.0.2", 80, SocketAddress::TCP);
+  FauxConnection *connections[3];
+
+  for (int i = 0; i < 3; ++i) {
+    connections[i] = new (allocator) FauxConnection(first, allocator.cleanupHandler());
+    EXPECT_EQ(ESB_SUCCESS, map.insert(connections[i]));
+  }
+  EXPECT_EQ(ESB_SUCCESS, map.insert(new (allocator) FauxConnection(second, allocator.cleanupHandler())));
+
+  EXPECT_EQ(3, map.count(&first));
+  EXPECT_EQ(1, map.count(&second));
+
+  // The first inserted is the last removed by remove() and the first removed by removeLast()
+  FauxConnection *connection = (FauxConnection *)map.removeLast(&first);
+  EXPECT_EQ(connections[0], connection);
+  connection->cleanupHandler()->destroy(connection);
+
+  connection = (FauxConnection *)map.remove(&first);
+  EXPECT_EQ(connections[2], connection);
+  connection->cleanupHandler()->destroy(connection);
+
+  EXPECT_EQ(1, map.count(&first));
+  EXPECT_EQ(2, map.size());
+}
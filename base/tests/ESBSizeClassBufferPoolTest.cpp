@@ -0,0 +1,68 @@
+#ifndef ESB_SIZE_CLASS_BUFFER_POOL_H
+#include <ESBSizeClassBufferPool.h>
+#endif
+
+#include <gtest/gtest.h>
+
+using namespace ESB;
+
+static const UInt32 BufferSizes[] = {1024, 4096, 16384};
+
+TEST(SizeClassBufferPool, AcquireFromEachClass) {
+  SizeClassBufferPool pool(BufferSizes, 3, 2);
+  ASSERT_EQ(3, pool.sizeClasses());
+
+  for (UInt32 i = 0; i < 3; ++i) {
+    EXPECT_EQ(BufferSizes[i], pool.bufferSize(i));
+    Buffer *buffer = pool.acquireBuffer(0, i);
+    ASSERT_TRUE(buffer);
+    EXPECT_EQ(BufferSizes[i], buffer->capacity());
+    pool.releaseBuffer(0, buffer);
+    EXPECT_EQ(1, pool.pool(i)->cachedBuffers(0));
+  }
+
+  // Out of range size classes get the largest buffers
+  EXPECT_EQ(16384, pool.bufferSize(7));
+  Buffer *buffer = pool.acquireBuffer(1, 7);
+  ASSERT_TRUE(buffer);
+  EXPECT_EQ(16384, buffer->capacity());
+  pool.releaseBuffer(1, buffer);
+  EXPECT_EQ(NULL, pool.pool(3));
+}
+
+TEST(SizeClassBufferPool, HitRate) {
+  SizeClassBufferPool pool(BufferSizes, 3, 1);
+
+  for (int i = 0; i < 4; ++i) {
+    Buffer *buffer = pool.acquireBuffer(0, 1);
+    ASSERT_TRUE(buffer);
+    pool.releaseBuffer(0, buffer);
+  }
+
+  EXPECT_EQ(3, pool.pool(1)->hits());
+  EXPECT_EQ(1, pool.pool(1)->misses());
+  EXPECT_EQ(0, pool.pool(0)->hits() + pool.pool(0)->misses());
+  EXPECT_EQ(0, pool.pool(2)->hits() + pool.pool(2)->misses());
+  pool.log(Logger::Instance(), Logger::Severity::Debug);
+}
+
+TEST(SizeClassBufferPool, SizesMustAscend) {
+  const UInt32 sizes[] = {4096, 4096, 1024};
+  SizeClassBufferPool pool(sizes, 3, 1);
+
+  // Only the classes before the first bad size are usable
+  EXPECT_EQ(1, pool.sizeClasses());
+}
+
+TEST(SizeClassBufferPool, ForeignBufferIsDestroyed) {
+  SizeClassBufferPool pool(BufferSizes, 3, 1);
+  Buffer *buffer = Buffer::Create(SystemAllocator::Instance(), 2048);
+  ASSERT_TRUE(buffer);
+
+  // Matches no size class, so it is freed instead of cached or leaked
+  pool.releaseBuffer(0, buffer);
+  for (UInt32 i = 0; i < 3; ++i) {
+    EXPECT_EQ(0, pool.pool(i)->buffers());
+    EXPECT_EQ(0, pool.pool(i)->cachedBuffers(0));
+  }
+}
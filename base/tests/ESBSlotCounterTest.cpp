@@ -0,0 +1,132 @@
+#ifndef ESB_SLOT_COUNTER_H
+#include <ESBSlotCounter.h>
+#endif
+
+#ifndef ESB_THREAD_H
+#include <ESBThread.h>
+#endif
+
+#ifndef ESB_SHARED_INT_H
+#include <ESBSharedInt.h>
+#endif
+
+#include <gtest/gtest.h>
+
+using namespace ESB;
+
+TEST(SlotCounter, Strict) {
+  // Too small to lease to 4 shards
+  SlotCounter counter(5, 4);
+  ASSERT_TRUE(counter.isStrict());
+  ASSERT_EQ(4U, counter.shards());
+
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(ESB_SUCCESS, counter.acquire(1));
+  }
+  EXPECT_EQ(ESB_OVERFLOW, counter.acquire(1));
+  EXPECT_EQ(5U, counter.inUse());
+
+  counter.release(2);
+  EXPECT_EQ(3U, counter.inUse());
+  EXPECT_EQ(ESB_OVERFLOW, counter.acquire(3));
+  EXPECT_EQ(ESB_SUCCESS, counter.acquire(2));
+  EXPECT_EQ(ESB_OVERFLOW, counter.acquire(6));
+}
+
+TEST(SlotCounter, Leased) {
+  SlotCounter counter(1024, 4);
+  ASSERT_FALSE(counter.isStrict());
+  ASSERT_EQ(16U, counter.lease());
+
+  // Every slot can be taken even though the first acquire leased extra slots to this thread's shard
+  for (int i = 0; i < 1024; ++i) {
+    ASSERT_EQ(ESB_SUCCESS, counter.acquire(1));
+  }
+  EXPECT_EQ(ESB_OVERFLOW, counter.acquire(1));
+  EXPECT_EQ(1024U, counter.inUse());
+
+  for (int i = 0; i < 1024; ++i) {
+    counter.release(1);
+  }
+  EXPECT_EQ(0U, counter.inUse());
+
+  // Releasing keeps at most two leases in the shard
+  counter.reconcile();
+  EXPECT_EQ(0U, counter.inUse());
+  EXPECT_EQ(ESB_SUCCESS, counter.acquire(1024));
+  EXPECT_EQ(ESB_OVERFLOW, counter.acquire(1));
+}
+
+class SlotThread : public Thread {
+ public:
+  SlotThread(SlotCounter &counter, UInt32 acquisitions, bool release, SharedInt &granted)
+      : _counter(counter), _acquisitions(acquisitions), _release(release), _granted(granted) {}
+
+  virtual ~SlotThread() {}
+
+ protected:
+  virtual void run() {
+    for (UInt32 i = 0; i < _acquisitions; ++i) {
+      if (ESB_SUCCESS == _counter.acquire(1)) {
+        _granted.inc();
+        if (_release) {
+          _counter.release(1);
+        }
+      }
+    }
+  }
+
+ private:
+  SlotCounter &_counter;
+  const UInt32 _acquisitions;
+  const bool _release;
+  SharedInt &_granted;
+};
+
+static void RunThreads(SlotCounter &counter, UInt32 threads, UInt32 acquisitions, bool release, SharedInt &granted) {
+  SlotThread *workers[8];
+  ASSERT_GE(8U, threads);
+
+  for (UInt32 i = 0; i < threads; ++i) {
+    workers[i] = new (SystemAllocator::Instance()) SlotThread(counter, acquisitions, release, granted);
+    ASSERT_EQ(ESB_SUCCESS, workers[i]->start());
+  }
+
+  for (UInt32 i = 0; i < threads; ++i) {
+    ASSERT_EQ(ESB_SUCCESS, workers[i]->join());
+    workers[i]->~SlotThread();
+    SystemAllocator::Instance().deallocate(workers[i]);
+  }
+}
+
+TEST(SlotCounter, ReconcileOtherThreads) {
+  SlotCounter counter(1024, 4);
+  SharedInt granted;
+
+  // The other threads finish holding leases in their shards
+  RunThreads(counter, 4, 100, true, granted);
+  EXPECT_EQ(400, granted.get());
+  EXPECT_EQ(0U, counter.inUse());
+
+  // Which this thread takes back when it runs out
+  EXPECT_EQ(ESB_SUCCESS, counter.acquire(1024));
+  EXPECT_EQ(ESB_OVERFLOW, counter.acquire(1));
+}
+
+TEST(SlotCounter, Concurrent) {
+  SlotCounter counter(1000, 4);
+  SharedInt granted;
+
+  // Every slot is handed out exactly once no matter how the threads race
+  RunThreads(counter, 4, 100000, false, granted);
+  EXPECT_EQ(1000, granted.get());
+  EXPECT_EQ(1000U, counter.inUse());
+
+  granted.set(0);
+  for (int i = 0; i < 1000; ++i) {
+    counter.release(1);
+  }
+  RunThreads(counter, 4, 100000, true, granted);
+  EXPECT_EQ(400000, granted.get());
+  EXPECT_EQ(0U, counter.inUse());
+}
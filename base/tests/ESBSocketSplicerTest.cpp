@@ -0,0 +1,150 @@
+#ifndef ESB_SOCKET_SPLICER_H
+#include <ESBSocketSplicer.h>
+#endif
+
+#include <gtest/gtest.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace ESB;
+
+class SocketSplicerTest : public ::testing::Test {
+ public:
+  SocketSplicerTest() {}
+
+  virtual void SetUp() {
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, _source));
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, _destination));
+  }
+
+  virtual void TearDown() {
+    for (int i = 0; i < 2; ++i) {
+      close(_source[i]);
+      close(_destination[i]);
+    }
+  }
+
+ protected:
+  int _source[2];
+  int _destination[2];
+};
+
+TEST_F(SocketSplicerTest, FillAndDrain) {
+  if (!SocketSplicer::Supported()) {
+    GTEST_SKIP();
+  }
+
+  const char message[] = "The quick brown fox jumps over the lazy dog";
+  ASSERT_EQ(sizeof(message), write(_source[0], message, sizeof(message)));
+
+  SocketSplicer splicer;
+  UInt64 bytesFilled = 0;
+  ASSERT_EQ(ESB_SUCCESS, splicer.fill(_source[1], sizeof(message), &bytesFilled));
+  ASSERT_EQ(sizeof(message), bytesFilled);
+  ASSERT_EQ(sizeof(message), splicer.buffered());
+
+  UInt64 bytesDrained = 0;
+  ASSERT_EQ(ESB_SUCCESS, splicer.drain(_destination[0], &bytesDrained));
+  ASSERT_EQ(sizeof(message), bytesDrained);
+  ASSERT_EQ(0, splicer.buffered());
+
+  char buffer[sizeof(message)];
+  ASSERT_EQ(sizeof(buffer), read(_destination[1], buffer, sizeof(buffer)));
+  ASSERT_EQ(0, memcmp(message, buffer, sizeof(message)));
+}
+
+TEST_F(SocketSplicerTest, FillRespectsLimit) {
+  if (!SocketSplicer::Supported()) {
+    GTEST_SKIP();
+  }
+
+  const char message[] = "0123456789";
+  ASSERT_EQ(sizeof(message), write(_source[0], message, sizeof(message)));
+
+  SocketSplicer splicer;
+  UInt64 bytesFilled = 0;
+  ASSERT_EQ(ESB_SUCCESS, splicer.fill(_source[1], 4, &bytesFilled));
+  ASSERT_EQ(4, bytesFilled);
+
+  // The rest is still in the source socket
+  char buffer[sizeof(message)];
+  ASSERT_EQ(sizeof(message) - 4, read(_source[1], buffer, sizeof(buffer)));
+  ASSERT_EQ(0, memcmp(message + 4, buffer, sizeof(message) - 4));
+}
+
+TEST_F(SocketSplicerTest, FillEmptySource) {
+  if (!SocketSplicer::Supported()) {
+    GTEST_SKIP();
+  }
+
+  SocketSplicer splicer;
+  UInt64 bytesFilled = 0;
+  ASSERT_EQ(ESB_AGAIN, splicer.fill(_source[1], 1024, &bytesFilled));
+  ASSERT_EQ(0, bytesFilled);
+}
+
+TEST_F(SocketSplicerTest, FillClosedSource) {
+  if (!SocketSplicer::Supported()) {
+    GTEST_SKIP();
+  }
+
+  shutdown(_source[0], SHUT_WR);
+
+  SocketSplicer splicer;
+  UInt64 bytesFilled = 0;
+  ASSERT_EQ(ESB_CLOSED, splicer.fill(_source[1], 1024, &bytesFilled));
+}
+
+TEST_F(SocketSplicerTest, PipePool) {
+  if (!SocketSplicer::Supported()) {
+    GTEST_SKIP();
+  }
+
+  const char message[] = "0123456789";
+  SocketSplicer::PipePool pool;
+  UInt64 bytes = 0;
+
+  // An emptied pipe goes back to the pool
+  {
+    SocketSplicer splicer(&pool);
+    ASSERT_EQ(sizeof(message), write(_source[0], message, sizeof(message)));
+    ASSERT_EQ(ESB_SUCCESS, splicer.fill(_source[1], sizeof(message), &bytes));
+    ASSERT_EQ(ESB_SUCCESS, splicer.drain(_destination[0], &bytes));
+  }
+  ASSERT_EQ(1U, pool.size());
+
+  // A pipe with bytes left in it is closed instead, and reused pipes work like new ones
+  {
+    SocketSplicer splicer(&pool);
+    ASSERT_EQ(sizeof(message), write(_source[0], message, sizeof(message)));
+    ASSERT_EQ(ESB_SUCCESS, splicer.fill(_source[1], sizeof(message), &bytes));
+    ASSERT_EQ(0U, pool.size());
+  }
+  ASSERT_EQ(0U, pool.size());
+
+  {
+    SocketSplicer splicer(&pool);
+    ASSERT_EQ(sizeof(message), write(_source[0], message, sizeof(message)));
+    ASSERT_EQ(ESB_SUCCESS, splicer.fill(_source[1], sizeof(message), &bytes));
+    ASSERT_EQ(ESB_SUCCESS, splicer.drain(_destination[0], &bytes));
+    ASSERT_EQ(sizeof(message), bytes);
+  }
+  ASSERT_EQ(1U, pool.size());
+
+  {
+    SocketSplicer splicer(&pool);
+    ASSERT_EQ(sizeof(message), write(_source[0], message, sizeof(message)));
+    ASSERT_EQ(ESB_SUCCESS, splicer.fill(_source[1], sizeof(message), &bytes));
+    ASSERT_EQ(0U, pool.size());
+    ASSERT_EQ(ESB_SUCCESS, splicer.drain(_destination[0], &bytes));
+  }
+  ASSERT_EQ(1U, pool.size());
+
+  // Only the bytes spliced through the pool's pipes reach the destination
+  char buffer[sizeof(message) * 4];
+  ASSERT_EQ(sizeof(message) * 3, read(_destination[1], buffer, sizeof(buffer)));
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(0, memcmp(message, buffer + i * sizeof(message), sizeof(message)));
+  }
+}
@@ -0,0 +1,133 @@
+#ifndef ESB_SPACE_SAVING_H
+#include <ESBSpaceSaving.h>
+#endif
+
+#ifndef ESB_RAND_H
+#include <ESBRand.h>
+#endif
+
+#include <gtest/gtest.h>
+
+using namespace ESB;
+
+// Every counter can be found through the index, and the counts add up to everything that was added
+static void Verify(const SpaceSaving &summary) {
+  UInt64 total = 0U;
+  for (UInt32 i = 0; i < summary.size(); ++i) {
+    UInt64 count = 0U;
+    UInt64 error = 0U;
+    ASSERT_EQ(ESB_SUCCESS, summary.find(summary.key(i), &count, &error));
+    ASSERT_EQ(summary.count(i), count);
+    ASSERT_EQ(summary.error(i), error);
+    ASSERT_LE(error, count);
+    ASSERT_LE(summary.minimum(), count);
+    total += count;
+  }
+  ASSERT_EQ(summary.total(), total);
+}
+
+TEST(SpaceSaving, Exact) {
+  SpaceSaving summary(8);
+  ASSERT_EQ(8U, summary.capacity());
+
+  for (UInt64 key = 1; key <= 8; ++key) {
+    EXPECT_EQ(key, summary.add(key, key));
+  }
+  EXPECT_EQ(9U, summary.add(3, 6));
+  EXPECT_EQ(1U, summary.minimum());
+
+  UInt64 count = 0U;
+  UInt64 error = 0U;
+  ASSERT_EQ(ESB_SUCCESS, summary.find(3, &count, &error));
+  EXPECT_EQ(9U, count);
+  EXPECT_EQ(0U, error);
+  ASSERT_EQ(ESB_SUCCESS, summary.find(8, &count, &error));
+  EXPECT_EQ(8U, count);
+  EXPECT_EQ(ESB_CANNOT_FIND, summary.find(9, &count, &error));
+  Verify(summary);
+}
+
+TEST(SpaceSaving, Replace) {
+  SpaceSaving summary(2);
+
+  summary.add(1, 3);
+  summary.add(2);
+  EXPECT_EQ(1U, summary.minimum());
+
+  // Key 3 takes over key 2's counter and count
+  EXPECT_EQ(1U, summary.add(3));
+  UInt64 count = 0U;
+  UInt64 error = 0U;
+  EXPECT_EQ(ESB_CANNOT_FIND, summary.find(2, &count, &error));
+  ASSERT_EQ(ESB_SUCCESS, summary.find(3, &count, &error));
+  EXPECT_EQ(2U, count);
+  EXPECT_EQ(1U, error);
+  EXPECT_EQ(2U, summary.minimum());
+  Verify(summary);
+
+  summary.clear();
+  EXPECT_EQ(0U, summary.size());
+  EXPECT_EQ(0U, summary.total());
+  EXPECT_EQ(ESB_CANNOT_FIND, summary.find(1, &count, &error));
+  EXPECT_EQ(1U, summary.add(2));
+  Verify(summary);
+}
+
+TEST(SpaceSaving, HeavyHitters) {
+  SpaceSaving summary(16);
+  Rand rand(42);
+
+  // Keys 1-4 are 10% of the stream each, the rest is spread over many keys
+  for (UInt32 i = 0; i < 100000; ++i) {
+    const UInt64 key = i % 10 < 4 ? 1U + i % 10 : 1000U + rand.generate(1, 100000);
+    summary.add(key);
+  }
+  Verify(summary);
+
+  for (UInt64 key = 1; key <= 4; ++key) {
+    UInt64 count = 0U;
+    UInt64 error = 0U;
+    ASSERT_EQ(ESB_SUCCESS, summary.find(key, &count, &error));
+    EXPECT_LE(10000U, count);
+    EXPECT_GE(10000U, count - error);
+  }
+}
+
+TEST(SpaceSaving, Merge) {
+  SpaceSaving left(8);
+  SpaceSaving right(8);
+  Rand rand(7);
+
+  for (UInt32 i = 0; i < 10000; ++i) {
+    left.add(0 == i % 2 ? 1U : rand.generate(100, 1000));
+    right.add(0 == i % 3 ? 1U : rand.generate(100, 1000), 2);
+  }
+
+  SpaceSaving merged(8);
+  merged.merge(left);
+  merged.merge(right);
+  Verify(merged);
+  EXPECT_EQ(left.total() + right.total(), merged.total());
+
+  // Key 1 was seen 5000 times on the left and 3334 times, twice each, on the right
+  UInt64 count = 0U;
+  UInt64 error = 0U;
+  ASSERT_EQ(ESB_SUCCESS, merged.find(1, &count, &error));
+  EXPECT_LE(11668U, count);
+  EXPECT_GE(11668U, count - error);
+}
+
+TEST(SpaceSaving, Churn) {
+  SpaceSaving summary(64);
+  Rand rand(1);
+
+  // Replacing keys over and over exercises the index's deletions and the bucket list
+  for (UInt32 i = 0; i < 200000; ++i) {
+    summary.add(rand.generate(1, 5000), rand.generate(1, 3));
+    if (0 == i % 10000) {
+      Verify(summary);
+    }
+  }
+  Verify(summary);
+  EXPECT_EQ(64U, summary.size());
+}
@@ -2,6 +2,14 @@
 #include <ESBServerTLSContextIndex.h>
 #endif
 
+#ifndef ESB_TIME_H
+#include <ESBTime.h>
+#endif
+
+#ifndef ESB_SYSTEM_TIME_SOURCE_H
+#include <ESBSystemTimeSource.h>
+#endif
+
 #include <gtest/gtest.h>
 
 using namespace ESB;
@@ -213,3 +221,111 @@ TEST(ServerTLSContextTest, KeyCertMismatch) {
   ASSERT_TRUE(context.isNull());
   SystemAllocator::Instance().deallocate(block);
 }
+
+TEST(ServerTLSContextTest, RotateTicketKeys) {
+  FakeTimeSource timeSource(Date(1000, 0));
+  Time::Instance().setTimeSource(timeSource);
+
+  TLSContextPointer context;
+  TLSContext::Params params;
+  TLSContext *memory = NULL;
+  ASSERT_EQ(ESB_SUCCESS, SystemAllocator::Instance().allocate(sizeof(TLSContext), (void **)&memory));
+  ASSERT_EQ(ESB_SUCCESS, TLSContext::Create(context, params.privateKeyPath("foo.key").certificatePath("foo.crt"),
+                                            memory, &SystemAllocator::Instance().cleanupHandler()));
+  ASSERT_FALSE(context.isNull());
+  ASSERT_EQ(ESB_SUCCESS, context->enableTicketKeyRotation(60));
+
+  EVP_CIPHER_CTX *cipher = EVP_CIPHER_CTX_new();
+#ifdef ESB_TLS_TICKET_EVP_MAC
+  EVP_MAC *mac = EVP_MAC_fetch(NULL, OSSL_MAC_NAME_HMAC, NULL);
+  ASSERT_TRUE(mac);
+  EVP_MAC_CTX *hmac = EVP_MAC_CTX_new(mac);
+#else
+  HMAC_CTX *hmac = HMAC_CTX_new();
+#endif
+  ASSERT_TRUE(hmac);
+  unsigned char name[ESB_TLS_TICKET_KEY_NAME_SIZE];
+  unsigned char first[ESB_TLS_TICKET_KEY_NAME_SIZE];
+  unsigned char iv[EVP_MAX_IV_LENGTH];
+
+  ASSERT_EQ(1, context->ticketKey(first, iv, cipher, hmac, true));
+  ASSERT_EQ(1, context->ticketKey(first, iv, cipher, hmac, false));
+#ifdef ESB_TLS_TICKET_EVP_MAC
+  // Keyed for HMAC-SHA256
+  ASSERT_EQ(32U, EVP_MAC_CTX_get_mac_size(hmac));
+#endif
+
+  // Tickets encrypted with the previous keys are accepted but replaced
+  for (int i = 1; i < ESB_TLS_TICKET_KEYS; ++i) {
+    timeSource.addSeconds(60);
+    ASSERT_EQ(1, context->ticketKey(name, iv, cipher, hmac, true));
+    ASSERT_NE(0, memcmp(name, first, sizeof(name)));
+    ASSERT_EQ(1, context->ticketKey(name, iv, cipher, hmac, false));
+    ASSERT_EQ(2, context->ticketKey(first, iv, cipher, hmac, false));
+  }
+
+  // Until the key is retired
+  timeSource.addSeconds(60);
+  ASSERT_EQ(1, context->ticketKey(name, iv, cipher, hmac, true));
+  ASSERT_EQ(0, context->ticketKey(first, iv, cipher, hmac, false));
+
+#ifdef ESB_TLS_TICKET_EVP_MAC
+  EVP_MAC_CTX_free(hmac);
+  EVP_MAC_free(mac);
+#else
+  HMAC_CTX_free(hmac);
+#endif
+  EVP_CIPHER_CTX_free(cipher);
+  Time::Instance().setTimeSource(SystemTimeSource::Instance());
+}
+
+TEST(ServerTLSContextTest, RetireTicketKeysWithoutIssuing) {
+  FakeTimeSource timeSource(Date(1000, 0));
+  Time::Instance().setTimeSource(timeSource);
+
+  TLSContextPointer context;
+  TLSContext::Params params;
+  TLSContext *memory = NULL;
+  ASSERT_EQ(ESB_SUCCESS, SystemAllocator::Instance().allocate(sizeof(TLSContext), (void **)&memory));
+  ASSERT_EQ(ESB_SUCCESS, TLSContext::Create(context, params.privateKeyPath("foo.key").certificatePath("foo.crt"),
+                                            memory, &SystemAllocator::Instance().cleanupHandler()));
+  ASSERT_FALSE(context.isNull());
+  ASSERT_EQ(ESB_SUCCESS, context->enableTicketKeyRotation(60));
+
+  EVP_CIPHER_CTX *cipher = EVP_CIPHER_CTX_new();
+#ifdef ESB_TLS_TICKET_EVP_MAC
+  EVP_MAC *mac = EVP_MAC_fetch(NULL, OSSL_MAC_NAME_HMAC, NULL);
+  ASSERT_TRUE(mac);
+  EVP_MAC_CTX *hmac = EVP_MAC_CTX_new(mac);
+#else
+  HMAC_CTX *hmac = HMAC_CTX_new();
+#endif
+  ASSERT_TRUE(hmac);
+  unsigned char name[ESB_TLS_TICKET_KEY_NAME_SIZE];
+  unsigned char first[ESB_TLS_TICKET_KEY_NAME_SIZE];
+  unsigned char iv[EVP_MAX_IV_LENGTH];
+
+  ASSERT_EQ(1, context->ticketKey(first, iv, cipher, hmac, true));
+
+  // Every session is resumed, so no ticket is encrypted to rotate the key.  The expired key still gets its clients
+  // new tickets...
+  timeSource.addSeconds(60);
+  ASSERT_EQ(2, context->ticketKey(first, iv, cipher, hmac, false));
+
+  // ...and stops decrypting once it would have been retired
+  timeSource.addSeconds(60 * (ESB_TLS_TICKET_KEYS - 1));
+  ASSERT_EQ(0, context->ticketKey(first, iv, cipher, hmac, false));
+
+  ASSERT_EQ(1, context->ticketKey(name, iv, cipher, hmac, true));
+  ASSERT_NE(0, memcmp(name, first, sizeof(name)));
+  ASSERT_EQ(1, context->ticketKey(name, iv, cipher, hmac, false));
+
+#ifdef ESB_TLS_TICKET_EVP_MAC
+  EVP_MAC_CTX_free(hmac);
+  EVP_MAC_free(mac);
+#else
+  HMAC_CTX_free(hmac);
+#endif
+  EVP_CIPHER_CTX_free(cipher);
+  Time::Instance().setTimeSource(SystemTimeSource::Instance());
+}
@@ -0,0 +1,112 @@
+#ifndef ESB_TLS_SESSION_CACHE_H
+#include <ESBTLSSessionCache.h>
+#endif
+
+#include <gtest/gtest.h>
+
+using namespace ESB;
+
+static SSL_SESSION *CreateSession(unsigned char id, int version) {
+  SSL_SESSION *session = SSL_SESSION_new();
+  if (!session) {
+    return NULL;
+  }
+  SSL_SESSION_set1_id(session, &id, sizeof(id));
+  SSL_SESSION_set_protocol_version(session, version);
+  SSL_SESSION_set_time(session, 1000);
+  SSL_SESSION_set_timeout(session, 300);
+  return session;
+}
+
+TEST(TLSSessionCache, FindInsert) {
+  TLSSessionCache cache(100, 7);
+  const SocketAddress peer("127.0.0.1", 443, SocketAddress::TLS);
+  const SocketAddress otherPeer("127.0.0.1", 8443, SocketAddress::TLS);
+  const Date now(1100, 0);
+
+  ASSERT_TRUE(NULL == cache.find("foo.everscale.com", peer, now));
+  ASSERT_EQ(1, cache.misses());
+
+  SSL_SESSION *session = CreateSession(1, TLS1_3_VERSION);
+  ASSERT_TRUE(session);
+  ASSERT_EQ(ESB_SUCCESS, cache.insert("foo.everscale.com", peer, session));
+  ASSERT_EQ(1, cache.size());
+
+  for (int i = 0; i < 3; ++i) {
+    SSL_SESSION *found = cache.find("FOO.everscale.com", peer, now);
+    ASSERT_EQ(session, found);
+    SSL_SESSION_free(found);
+  }
+  ASSERT_EQ(3, cache.hits());
+
+  ASSERT_TRUE(NULL == cache.find("bar.everscale.com", peer, now));
+  ASSERT_TRUE(NULL == cache.find("foo.everscale.com", otherPeer, now));
+  ASSERT_EQ(3, cache.misses());
+
+  // A newer session replaces the older one
+  SSL_SESSION *newer = CreateSession(2, TLS1_2_VERSION);
+  ASSERT_TRUE(newer);
+  ASSERT_EQ(ESB_SUCCESS, cache.insert("foo.everscale.com", peer, newer));
+  ASSERT_EQ(1, cache.size());
+  SSL_SESSION *found = cache.find("foo.everscale.com", peer, now);
+  ASSERT_EQ(newer, found);
+  SSL_SESSION_free(found);
+
+  cache.clear();
+  ASSERT_EQ(0, cache.size());
+}
+
+TEST(TLSSessionCache, Expired) {
+  TLSSessionCache cache(100, 7);
+  const SocketAddress peer("127.0.0.1", 443, SocketAddress::TLS);
+
+  SSL_SESSION *session = CreateSession(1, TLS1_2_VERSION);
+  ASSERT_TRUE(session);
+  ASSERT_EQ(ESB_SUCCESS, cache.insert("foo.everscale.com", peer, session));
+
+  ASSERT_TRUE(NULL == cache.find("foo.everscale.com", peer, Date(1300, 0)));
+  ASSERT_EQ(0, cache.size());
+  ASSERT_EQ(0, cache.hits());
+  ASSERT_EQ(1, cache.misses());
+}
+
+TEST(TLSSessionCache, EvictLeastRecentlyUsed) {
+  TLSSessionCache cache(2, 1);
+  const SocketAddress peer("127.0.0.1", 443, SocketAddress::TLS);
+  const Date now(1100, 0);
+
+  ASSERT_EQ(2, cache.maxSessions());
+  ASSERT_EQ(ESB_SUCCESS, cache.insert("a.everscale.com", peer, CreateSession(1, TLS1_2_VERSION)));
+  ASSERT_EQ(ESB_SUCCESS, cache.insert("b.everscale.com", peer, CreateSession(2, TLS1_2_VERSION)));
+
+  SSL_SESSION *found = cache.find("a.everscale.com", peer, now);
+  ASSERT_TRUE(found);
+  SSL_SESSION_free(found);
+
+  ASSERT_EQ(ESB_SUCCESS, cache.insert("c.everscale.com", peer, CreateSession(3, TLS1_2_VERSION)));
+  ASSERT_EQ(2, cache.size());
+  ASSERT_EQ(1, cache.evictions());
+
+  ASSERT_TRUE(NULL == cache.find("b.everscale.com", peer, now));
+
+  found = cache.find("a.everscale.com", peer, now);
+  ASSERT_TRUE(found);
+  SSL_SESSION_free(found);
+
+  found = cache.find("c.everscale.com", peer, now);
+  ASSERT_TRUE(found);
+  SSL_SESSION_free(found);
+}
+
+TEST(TLSSessionCache, Disabled) {
+  TLSSessionCache cache(0, 7);
+  const SocketAddress peer("127.0.0.1", 443, SocketAddress::TLS);
+
+  SSL_SESSION *session = CreateSession(1, TLS1_2_VERSION);
+  ASSERT_TRUE(session);
+  ASSERT_EQ(ESB_INVALID_STATE, cache.insert("foo.everscale.com", peer, session));
+  SSL_SESSION_free(session);
+
+  ASSERT_EQ(0, cache.maxSessions());
+  ASSERT_TRUE(NULL == cache.find("foo.everscale.com", peer, Date(1100, 0)));
+}
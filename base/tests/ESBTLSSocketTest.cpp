@@ -80,6 +80,69 @@ TEST_F(TLSSocketTest, EchoMessage) {
   ASSERT_TRUE(0 == strcmp(_message, buffer));
 }
 
+TEST_F(TLSSocketTest, EchoVectoredMessage) {
+  ClientTLSSocket client("test.server.everscale.com", _server.secureAddress(), "test", _clientContexts.defaultContext(),
+                         true);
+
+  Error error = client.connect();
+  ASSERT_EQ(ESB_SUCCESS, error);
+  ASSERT_TRUE(client.connected());
+  ASSERT_TRUE(client.secure());
+
+  struct iovec segments[3];
+  segments[0].iov_base = _message;
+  segments[0].iov_len = 10;
+  segments[1].iov_base = _message + 10;
+  segments[1].iov_len = 1;
+  segments[2].iov_base = _message + 11;
+  segments[2].iov_len = sizeof(_message) - 11;
+
+  ConnectedSocket &socket = client;
+  SSize result = socket.send(segments, 3);
+  ASSERT_EQ(result, sizeof(_message));
+
+  char buffer[sizeof(_message)];
+  result = client.receive(buffer, sizeof(buffer));
+  ASSERT_EQ(result, sizeof(buffer));
+
+  ASSERT_TRUE(0 == strcmp(_message, buffer));
+}
+
+TEST_F(TLSSocketTest, ResumeSession) {
+  for (int i = 0; i < 3; ++i) {
+    ClientTLSSocket client("test.server.everscale.com", _server.secureAddress(), "test",
+                           _clientContexts.defaultContext(), true);
+
+    Error error = client.connect();
+    ASSERT_EQ(ESB_SUCCESS, error);
+
+    SSize result = client.send(_message, sizeof(_message));
+    ASSERT_EQ(result, sizeof(_message));
+
+    // The server issues sessions after the handshake, so they are received along with the echo.
+    char buffer[sizeof(_message)];
+    result = client.receive(buffer, sizeof(buffer));
+    ASSERT_EQ(result, sizeof(buffer));
+    ASSERT_TRUE(0 == strcmp(_message, buffer));
+  }
+
+  // Only the first connection needs a full handshake
+  ASSERT_EQ(1, _clientContexts.defaultContext()->fullHandshakes());
+  ASSERT_EQ(2, _clientContexts.defaultContext()->resumedHandshakes());
+  ASSERT_EQ(2, _clientContexts.sessionCache().hits());
+  ASSERT_EQ(1, _server.contextIndex().defaultContext()->fullHandshakes());
+  ASSERT_EQ(2, _server.contextIndex().defaultContext()->resumedHandshakes());
+
+  // Sessions are not shared with other fqdns
+  ClientTLSSocket client("other.server.everscale.com", _server.secureAddress(), "test",
+                         _clientContexts.defaultContext(), true);
+  ASSERT_EQ(ESB_SUCCESS, client.connect());
+  ASSERT_EQ(sizeof(_message), client.send(_message, sizeof(_message)));
+  char buffer[sizeof(_message)];
+  ASSERT_EQ(sizeof(buffer), client.receive(buffer, sizeof(buffer)));
+  ASSERT_EQ(2, _clientContexts.defaultContext()->fullHandshakes());
+}
+
 TEST_F(TLSSocketTest, HostnameMismatch) {
   ClientTLSSocket client("mismatch.everscale.com", _server.secureAddress(), "test", _clientContexts.defaultContext(),
                          true);
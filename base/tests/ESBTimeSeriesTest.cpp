@@ -2,8 +2,12 @@
 #include <ESBTimeSeries.h>
 #endif
 
-#ifndef ESB_SIMPLE_PERFORMANCE_COUNTER_H
-#include <ESBSimplePerformanceCounter.h>
+#ifndef ESB_HISTOGRAM_PERFORMANCE_COUNTER_H
+#include <ESBHistogramPerformanceCounter.h>
+#endif
+
+#ifndef ESB_MONOTONIC_TIME_SOURCE_H
+#include <ESBMonotonicTimeSource.h>
 #endif
 
 #include <gtest/gtest.h>
@@ -23,7 +27,7 @@ TEST(TimeSeries, Basic) {
   }
 
   EXPECT_EQ(timeSeries.counters()->size(), 1);
-  SimplePerformanceCounter *first = (SimplePerformanceCounter *)timeSeries.counters()->first();
+  HistogramPerformanceCounter *first = (HistogramPerformanceCounter *)timeSeries.counters()->first();
   EXPECT_EQ(first->queries(), queries);
 }
 
@@ -40,7 +44,7 @@ TEST(TimeSeries, MultipleWindows) {
   }
 
   EXPECT_EQ(timeSeries.counters()->size(), 1);
-  SimplePerformanceCounter *first = (SimplePerformanceCounter *)timeSeries.counters()->first();
+  HistogramPerformanceCounter *first = (HistogramPerformanceCounter *)timeSeries.counters()->first();
   EXPECT_EQ(first->queries(), queries);
 
   stop += windowSizeSec;
@@ -50,9 +54,9 @@ TEST(TimeSeries, MultipleWindows) {
   }
 
   EXPECT_EQ(timeSeries.counters()->size(), 2);
-  first = (SimplePerformanceCounter *)timeSeries.counters()->first();
+  first = (HistogramPerformanceCounter *)timeSeries.counters()->first();
   EXPECT_EQ(first->queries(), queries);
-  SimplePerformanceCounter *second = (SimplePerformanceCounter *)first->next();
+  HistogramPerformanceCounter *second = (HistogramPerformanceCounter *)first->next();
   EXPECT_EQ(second->queries(), queries);
 }
 
@@ -69,7 +73,7 @@ TEST(TimeSeries, ExceedMaxWindows) {
   }
 
   EXPECT_EQ(timeSeries.counters()->size(), 1);
-  SimplePerformanceCounter *first = (SimplePerformanceCounter *)timeSeries.counters()->first();
+  HistogramPerformanceCounter *first = (HistogramPerformanceCounter *)timeSeries.counters()->first();
   EXPECT_EQ(first->queries(), queries);
 
   stop += windowSizeSec;
@@ -79,6 +83,37 @@ TEST(TimeSeries, ExceedMaxWindows) {
   }
 
   EXPECT_EQ(timeSeries.counters()->size(), 1);
-  first = (SimplePerformanceCounter *)timeSeries.counters()->first();
+  first = (HistogramPerformanceCounter *)timeSeries.counters()->first();
   EXPECT_EQ(first->queries(), queries);
-}
\ No newline at end of file
+}
+
+TEST(TimeSeries, Snapshot) {
+  const UInt16 maxWindows = 2;
+  const UInt16 windowSizeSec = 1;
+  TimeSeries timeSeries("ts-test", maxWindows, windowSizeSec);
+  PerformanceCounter::Snapshot snapshot;
+
+  timeSeries.snapshot(&snapshot);
+  EXPECT_EQ(0U, snapshot._queries);
+  EXPECT_DOUBLE_EQ(0.0, snapshot._sumMSec);
+
+  // Windows that closed in the past: the snapshot's percentiles come from the last one.
+  Date start(MonotonicTimeSource::Instance().now().seconds() - 10, 0);
+
+  for (int i = 0; i < 10; ++i) {
+    timeSeries.record(start, Date(start.seconds(), 1000));
+  }
+
+  start += windowSizeSec;
+
+  for (int i = 0; i < 10; ++i) {
+    timeSeries.record(start, Date(start.seconds(), 2000));
+  }
+
+  timeSeries.snapshot(&snapshot);
+  EXPECT_EQ(20U, snapshot._queries);
+  EXPECT_NEAR(30.0, snapshot._sumMSec, 0.001);
+  EXPECT_TRUE(snapshot._hasPercentiles);
+  EXPECT_NEAR(2.0, snapshot._p50MSec, 2.0 / ESB_HISTOGRAM_SUB_BUCKETS);
+  EXPECT_NEAR(2.0, snapshot._p999MSec, 2.0 / ESB_HISTOGRAM_SUB_BUCKETS);
+}
@@ -10,6 +10,14 @@
 #include <ESBSystemTimeSource.h>
 #endif
 
+#ifndef ESB_MONOTONIC_TIME_SOURCE_H
+#include <ESBMonotonicTimeSource.h>
+#endif
+
+#ifndef ESB_THREAD_H
+#include <ESBThread.h>
+#endif
+
 #include <gtest/gtest.h>
 
 using namespace ESB;
@@ -39,3 +47,74 @@ TEST(Time, CachedMonotonicTime) {
   error = timeSourceCache.join();
   EXPECT_EQ(ESB_SUCCESS, error);
 }
+
+TEST(MonotonicTimeSource, TracksWallClock) {
+  MonotonicTimeSource &source = MonotonicTimeSource::Instance();
+  Date wall = SystemTimeSource::Instance().now();
+  Date monotonic = source.read();
+
+  // Starts at the wall clock time and stays close to it while the wall clock is not set
+  Date skew = monotonic < wall ? wall - monotonic : monotonic - wall;
+  EXPECT_GE(1U, skew.seconds());
+
+  Date first = source.now();
+  usleep(1000);
+  Date second = source.now();
+  EXPECT_LT(first, second);
+  EXPECT_LE(Date(0, 1000), second - first);
+}
+
+TEST(MonotonicTimeSource, CachesWhenUpdated) {
+  MonotonicTimeSource &source = MonotonicTimeSource::Instance();
+
+  Date cached = source.update();
+  usleep(1000);
+  EXPECT_EQ(cached, source.now());
+  EXPECT_LT(cached, source.read());
+
+  Date updated = source.update();
+  EXPECT_LT(cached, updated);
+  EXPECT_EQ(updated, source.now());
+
+  source.reset();
+  usleep(1000);
+  EXPECT_LT(updated, source.now());
+}
+
+class CachingThread : public Thread {
+ public:
+  CachingThread() : _cached(), _now() {}
+
+  virtual ~CachingThread() {}
+
+  inline const Date &cached() const { return _cached; }
+
+  inline const Date &now() const { return _now; }
+
+ protected:
+  virtual void run() {
+    _cached = MonotonicTimeSource::Instance().update();
+    usleep(10000);
+    _now = MonotonicTimeSource::Instance().now();
+  }
+
+ private:
+  Date _cached;
+  Date _now;
+};
+
+TEST(MonotonicTimeSource, CachesPerThread) {
+  MonotonicTimeSource &source = MonotonicTimeSource::Instance();
+  source.reset();
+
+  CachingThread thread;
+  ASSERT_EQ(ESB_SUCCESS, thread.start());
+  usleep(5000);
+  Date now = source.now();
+  ASSERT_EQ(ESB_SUCCESS, thread.join());
+
+  // The other thread's cache does not affect this thread
+  EXPECT_EQ(thread.cached(), thread.now());
+  EXPECT_LT(thread.cached(), now);
+  EXPECT_LT(thread.now(), source.now());
+}
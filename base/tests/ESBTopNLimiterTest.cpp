@@ -0,0 +1,99 @@
+#ifndef ESB_TOP_N_LIMITER_H
+#include <ESBTopNLimiter.h>
+#endif
+
+#ifndef ESB_THREAD_H
+#include <ESBThread.h>
+#endif
+
+#include <gtest/gtest.h>
+
+using namespace ESB;
+
+TEST(TopNLimiter, Threshold) {
+  TopNLimiter limiter(8, 100, 1000000, 1);
+  ASSERT_EQ(1U, limiter.shards());
+  const Date now(1000, 0);
+
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_EQ(ESB_SUCCESS, limiter.acquire(42, 1, now));
+  }
+  EXPECT_EQ(ESB_OVERFLOW, limiter.acquire(42, 1, now));
+  EXPECT_EQ(ESB_SUCCESS, limiter.acquire(43, 100, now));
+  EXPECT_EQ(ESB_OVERFLOW, limiter.acquire(43, 1, now));
+
+  // Many light keys never push anyone over
+  for (UInt64 key = 1000; key < 2000; ++key) {
+    ASSERT_EQ(ESB_SUCCESS, limiter.acquire(key, 1, now));
+  }
+}
+
+TEST(TopNLimiter, Window) {
+  TopNLimiter limiter(8, 100, 1000000, 1);
+
+  for (int i = 0; i < 101; ++i) {
+    limiter.acquire(42, 1, Date(1000, 0));
+  }
+  EXPECT_EQ(ESB_OVERFLOW, limiter.acquire(42, 1, Date(1000, 999999)));
+
+  // The first acquire after the window ends merges, and the key stays non-conforming for the whole next window
+  EXPECT_EQ(ESB_OVERFLOW, limiter.acquire(42, 1, Date(1001, 0)));
+  EXPECT_EQ(1U, limiter.heavyHitters());
+  EXPECT_EQ(ESB_SUCCESS, limiter.acquire(43, 1, Date(1001, 500000)));
+  EXPECT_EQ(ESB_OVERFLOW, limiter.acquire(42, 1, Date(1001, 999999)));
+
+  // It only took 2 slots that window
+  EXPECT_EQ(ESB_SUCCESS, limiter.acquire(42, 1, Date(1002, 0)));
+  EXPECT_EQ(0U, limiter.heavyHitters());
+}
+
+class TopNThread : public Thread {
+ public:
+  TopNThread(TopNLimiter &limiter) : _limiter(limiter), _overflows(0U) {}
+
+  virtual ~TopNThread() {}
+
+  inline UInt32 overflows() const { return _overflows; }
+
+ protected:
+  virtual void run() {
+    const Date now(1000, 0);
+    for (UInt32 i = 0; i < 10000; ++i) {
+      // Key 7 takes a tenth of every thread's traffic, never enough in any one shard to cross the threshold
+      if (ESB_SUCCESS != _limiter.acquire(0 == i % 10 ? 7U : 1000U + i, 1, now)) {
+        ++_overflows;
+      }
+    }
+  }
+
+ private:
+  TopNLimiter &_limiter;
+  UInt32 _overflows;
+};
+
+TEST(TopNLimiter, MergeShards) {
+  const UInt32 count = 4;
+  TopNLimiter limiter(16, 1500, 1000000, count);
+  TopNThread *threads[count];
+
+  for (UInt32 i = 0; i < count; ++i) {
+    threads[i] = new (SystemAllocator::Instance()) TopNThread(limiter);
+    ASSERT_EQ(ESB_SUCCESS, threads[i]->start());
+  }
+
+  for (UInt32 i = 0; i < count; ++i) {
+    ASSERT_EQ(ESB_SUCCESS, threads[i]->join());
+  }
+
+  // Together the threads saw key 7 4000 times, which only the merge finds
+  limiter.merge();
+  EXPECT_EQ(1U, limiter.heavyHitters());
+  const Date now(1000, 500000);
+  EXPECT_EQ(ESB_OVERFLOW, limiter.acquire(7, 1, now));
+  EXPECT_EQ(ESB_SUCCESS, limiter.acquire(8, 1, now));
+
+  for (UInt32 i = 0; i < count; ++i) {
+    threads[i]->~TopNThread();
+    SystemAllocator::Instance().deallocate(threads[i]);
+  }
+}
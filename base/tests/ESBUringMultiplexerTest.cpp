@@ -0,0 +1,179 @@
+#ifndef ESB_URING_MULTIPLEXER_H
+#include <ESBUringMultiplexer.h>
+#endif
+
+#ifndef ESB_MULTIPLEXED_SOCKET_H
+#include <ESBMultiplexedSocket.h>
+#endif
+
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace ESB;
+
+#ifdef HAVE_IO_URING
+
+// One end of a socket pair that reads a byte per readable event and stops the multiplexer after enough reads
+class PairSocket : public MultiplexedSocket {
+ public:
+  PairSocket(int fd, SharedInt &isRunning, SharedInt &reads, UInt32 stopAfter)
+      : _fd(fd),
+        _isRunning(isRunning),
+        _reads(reads),
+        _stopAfter(stopAfter),
+        _readable(0U),
+        _remoteCloses(0U),
+        _removes(0U),
+        _dead(false) {}
+  virtual ~PairSocket() {}
+
+  virtual CleanupHandler *cleanupHandler() { return NULL; }
+  virtual const void *key() const { return this; }
+  virtual bool permanent() { return true; }
+  virtual bool wantAccept() { return false; }
+  virtual bool wantConnect() { return false; }
+  virtual bool wantRead() { return true; }
+  virtual bool wantWrite() { return false; }
+  virtual Error handleAccept() { return ESB_NOT_IMPLEMENTED; }
+  virtual Error handleConnect() { return ESB_NOT_IMPLEMENTED; }
+
+  virtual Error handleReadable() {
+    char byte = 0;
+    if (1 != read(_fd, &byte, 1)) {
+      return LastError();
+    }
+    ++_readable;
+    if (_reads.inc() >= _stopAfter) {
+      _isRunning.set(0);
+    }
+    return ESB_AGAIN;
+  }
+
+  virtual Error handleWritable() { return ESB_NOT_IMPLEMENTED; }
+  virtual void handleError(Error error) {}
+
+  virtual void handleRemoteClose() {
+    ++_remoteCloses;
+    if (_reads.inc() >= _stopAfter) {
+      _isRunning.set(0);
+    }
+  }
+
+  virtual void handleIdle() {}
+  virtual void handleRemove() { ++_removes; }
+  virtual SOCKET socketDescriptor() const { return _fd; }
+  virtual const char *name() const { return "pair"; }
+  virtual void markDead() { _dead = true; }
+  virtual bool dead() const { return _dead; }
+
+  inline UInt32 readable() const { return _readable; }
+  inline UInt32 remoteCloses() const { return _remoteCloses; }
+  inline UInt32 removes() const { return _removes; }
+
+ private:
+  int _fd;
+  SharedInt &_isRunning;
+  SharedInt &_reads;
+  const UInt32 _stopAfter;
+  UInt32 _readable;
+  UInt32 _remoteCloses;
+  UInt32 _removes;
+  bool _dead;
+};
+
+class UringMultiplexerTest : public ::testing::Test {
+ public:
+  UringMultiplexerTest() : _isRunning(), _reads() {}
+
+  virtual void SetUp() {
+    if (!UringMultiplexer::Available()) {
+      GTEST_SKIP() << "io_uring is not available";
+    }
+
+    for (UInt32 i = 0; i < Pairs; ++i) {
+      ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, _pairs[i]));
+    }
+    _isRunning.set(1);
+  }
+
+  virtual void TearDown() {
+    if (!UringMultiplexer::Available()) {
+      return;
+    }
+
+    for (UInt32 i = 0; i < Pairs; ++i) {
+      close(_pairs[i][0]);
+      if (0 <= _pairs[i][1]) {
+        close(_pairs[i][1]);
+      }
+    }
+  }
+
+ protected:
+  static const UInt32 Pairs = 256U;
+
+  int _pairs[Pairs][2];
+  SharedInt _isRunning;
+  SharedInt _reads;
+};
+
+const UInt32 UringMultiplexerTest::Pairs;
+
+// Every socket is readable before the loop starts, so the first wait completes a poll for each of them at once
+TEST_F(UringMultiplexerTest, EverySocketReadable) {
+  UringMultiplexer multiplexer("test", 0, Pairs);
+  PairSocket *sockets[Pairs];
+
+  for (UInt32 i = 0; i < Pairs; ++i) {
+    sockets[i] = new (SystemAllocator::Instance()) PairSocket(_pairs[i][0], _isRunning, _reads, Pairs);
+    ASSERT_EQ(ESB_SUCCESS, multiplexer.addMultiplexedSocket(sockets[i]));
+    ASSERT_EQ(1, write(_pairs[i][1], "x", 1));
+  }
+  EXPECT_EQ((int)Pairs, multiplexer.currentSockets());
+
+  // The multiplexer is full
+  PairSocket extra(_pairs[0][1], _isRunning, _reads, Pairs);
+  EXPECT_EQ(ESB_OVERFLOW, multiplexer.addMultiplexedSocket(&extra));
+
+  multiplexer.run(&_isRunning);
+
+  EXPECT_EQ(Pairs, _reads.get());
+  for (UInt32 i = 0; i < Pairs; ++i) {
+    EXPECT_EQ(1U, sockets[i]->readable());
+    // run() removes every socket when it stops
+    EXPECT_EQ(1U, sockets[i]->removes());
+    EXPECT_TRUE(sockets[i]->dead());
+    sockets[i]->~PairSocket();
+    SystemAllocator::Instance().deallocate(sockets[i]);
+  }
+  EXPECT_EQ(0, multiplexer.currentSockets());
+  EXPECT_LE(Pairs, multiplexer.submissions());
+}
+
+// Closing the peer reports a remote close and removes the socket
+TEST_F(UringMultiplexerTest, RemoteCloseRemoves) {
+  UringMultiplexer multiplexer("test", 0, Pairs);
+  PairSocket *sockets[Pairs];
+
+  for (UInt32 i = 0; i < Pairs; ++i) {
+    sockets[i] = new (SystemAllocator::Instance()) PairSocket(_pairs[i][0], _isRunning, _reads, Pairs);
+    ASSERT_EQ(ESB_SUCCESS, multiplexer.addMultiplexedSocket(sockets[i]));
+    close(_pairs[i][1]);
+    _pairs[i][1] = -1;
+  }
+
+  multiplexer.run(&_isRunning);
+
+  EXPECT_EQ(Pairs, _reads.get());
+  for (UInt32 i = 0; i < Pairs; ++i) {
+    EXPECT_EQ(0U, sockets[i]->readable());
+    EXPECT_EQ(1U, sockets[i]->remoteCloses());
+    EXPECT_EQ(1U, sockets[i]->removes());
+    sockets[i]->~PairSocket();
+    SystemAllocator::Instance().deallocate(sockets[i]);
+  }
+  EXPECT_EQ(0, multiplexer.currentSockets());
+}
+
+#endif
@@ -49,6 +49,12 @@ int main () {
   return 2 == counter;
 }" HAVE_GCC_ATOMIC_INTRINSICS)
 
+check_cxx_source_compiles("
+static __thread int counter = 0;
+int main () {
+  return counter;
+}" HAVE_THREAD_LOCAL_STORAGE)
+
 check_include_file("sys/types.h" HAVE_SYS_TYPES_H)
 check_type_size("off_t" HAVE_OFF_T)
 check_type_size("size_t" HAVE_SIZE_T)
@@ -118,6 +124,8 @@ check_symbol_exists(sys_siglist "signal.h" HAVE_SYS_SIGLIST)
 check_include_file("stdio.h" HAVE_STDIO_H)
 check_symbol_exists(vfprintf "stdio.h" HAVE_VFPRINTF)
 check_symbol_exists(snprintf "stdio.h" HAVE_SNPRINTF)
+check_symbol_exists(vsnprintf "stdio.h" HAVE_VSNPRINTF)
+check_symbol_exists(fwrite "stdio.h" HAVE_FWRITE)
 check_symbol_exists(fflush "stdio.h" HAVE_FFLUSH)
 check_symbol_exists(fopen "stdio.h" HAVE_FOPEN)
 check_symbol_exists(fread "stdio.h" HAVE_FREAD)
@@ -235,6 +243,7 @@ endif ()
 check_include_file("sys/param.h" HAVE_SYS_PARAM_H)
 # use 255 across all platforms. check_symbol_exists(MAXHOSTNAMELEN "sys/param.h" HAVE_MAXHOSTNAMELEN)
 
+check_include_file("stddef.h" HAVE_STDDEF_H)
 check_include_file("stdint.h" HAVE_STDINT_H)
 check_include_file("inttypes.h" HAVE_INTTYPES_H)
 
@@ -249,6 +258,8 @@ check_symbol_exists(getsockname "sys/socket.h" HAVE_GETSOCKNAME)
 check_symbol_exists(accept "sys/socket.h" HAVE_ACCEPT)
 check_symbol_exists(connect "sys/socket.h" HAVE_CONNECT)
 check_symbol_exists(send "sys/socket.h" HAVE_SEND)
+check_include_file("sys/uio.h" HAVE_SYS_UIO_H)
+check_symbol_exists(writev "sys/uio.h" HAVE_WRITEV)
 check_symbol_exists(recv "sys/socket.h" HAVE_RECV)
 check_symbol_exists(getpeername "sys/socket.h" HAVE_GETPEERNAME)
 check_symbol_exists(setsockopt "sys/socket.h" HAVE_SETSOCKOPT)
@@ -282,6 +293,8 @@ check_symbol_exists(gettimeofday "sys/time.h" HAVE_GETTIMEOFDAY)
 check_include_file("time.h" HAVE_TIME_H)
 check_struct_has_member("struct timespec" tv_nsec "time.h" HAVE_TIMESPEC_T)
 check_symbol_exists(nanosleep "time.h" HAVE_NANOSLEEP)
+check_symbol_exists(clock_gettime "time.h" HAVE_CLOCK_GETTIME)
+check_symbol_exists(CLOCK_MONOTONIC "time.h" HAVE_CLOCK_MONOTONIC)
 check_type_size(time_t HAVE_TIME_T)
 check_symbol_exists(time "time.h" HAVE_TIME)
 
@@ -299,6 +312,19 @@ check_symbol_exists(epoll_create "sys/epoll.h" HAVE_EPOLL_CREATE)
 check_symbol_exists(epoll_ctl "sys/epoll.h" HAVE_EPOLL_CTL)
 check_symbol_exists(epoll_wait "sys/epoll.h" HAVE_EPOLL_WAIT)
 
+check_include_file("poll.h" HAVE_POLL_H)
+check_include_file("linux/io_uring.h" HAVE_LINUX_IO_URING_H)
+check_cxx_source_compiles("
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+int main () {
+  struct io_uring_sqe sqe;
+  sqe.opcode = IORING_OP_POLL_ADD;
+  sqe.poll32_events = 0;
+  return syscall(__NR_io_uring_setup, 1, (struct io_uring_params *)0) + IORING_OP_POLL_REMOVE + IORING_OP_TIMEOUT;
+}" HAVE_IO_URING)
+
 check_include_file("sys/resource.h" HAVE_SYS_RESOURCE_H)
 check_struct_has_member("struct rlimit" rlim_max "sys/resource.h" HAVE_STRUCT_RLIMIT)
 check_symbol_exists(getrlimit "sys/resource.h" HAVE_GETRLIMIT)
@@ -307,6 +333,9 @@ check_symbol_exists(setrlimit "sys/resource.h" HAVE_SETRLIMIT)
 check_include_file("sys/stat.h" HAVE_SYS_STAT_H)
 
 check_include_file("fcntl.h" HAVE_FCNTL_H)
+check_cxx_symbol_exists(splice "fcntl.h" HAVE_SPLICE)
+check_cxx_symbol_exists(pipe2 "unistd.h" HAVE_PIPE2)
+check_cxx_symbol_exists(SPLICE_F_NONBLOCK "fcntl.h" HAVE_SPLICE_F_NONBLOCK)
 
 check_include_file("sys/mman.h" HAVE_SYS_MMAN_H)
 check_symbol_exists(mmap "sys/mman.h" HAVE_MMAP)
@@ -323,6 +352,8 @@ int main () {
 
 check_include_file("sys/eventfd.h" HAVE_SYS_EVENTFD_H)
 check_symbol_exists(eventfd "sys/eventfd.h" HAVE_EVENTFD)
+check_include_file("sys/timerfd.h" HAVE_SYS_TIMERFD_H)
+check_symbol_exists(timerfd_create "sys/timerfd.h" HAVE_TIMERFD_CREATE)
 
 check_cxx_source_compiles("
 #define likely(expr) __builtin_expect(!!(expr),1)
@@ -337,5 +368,25 @@ int main () {
     return 0;
 }" HAVE_BUILTIN_EXPECT)
 
+# x86 SIMD code paths compiled with per-function target attributes and chosen at runtime via CPUID
+check_cxx_source_compiles("
+#include <immintrin.h>
+__attribute__((target(\"sse4.2\"))) static int sse42(const char *p) {
+  __m128i a = _mm_loadu_si128((const __m128i *)p);
+  return _mm_cmpestri(a, 2, a, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES);
+}
+__attribute__((target(\"avx2\"))) static int avx2(const char *p) {
+  __m256i a = _mm256_loadu_si256((const __m256i *)p);
+  return _mm256_movemask_epi8(_mm256_shuffle_epi8(a, a));
+}
+int main () {
+  char p[32] = {0};
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports(\"avx2\")) {
+    return avx2(p);
+  }
+  return __builtin_cpu_supports(\"sse4.2\") ? sse42(p) : 0;
+}" HAVE_X86_SIMD_DISPATCH)
+
 configure_file(config.h.in base/include/ESBConfig.h @ONLY)
 configure_file(config.h.in unit-tf/include/ESTFConfig.h @ONLY)
@@ -99,6 +99,77 @@ class SendResponseAction : public Action {
   ESB_DEFAULT_FUNCS(SendResponseAction);
 };
 
+class CloseConnectionAction : public Action {
+ public:
+  static ESB::Error Build(const ESB::AST::Map &map, ESB::Allocator &allocator, Action **action);
+
+  virtual ~CloseConnectionAction();
+
+  virtual Type type() const;
+
+ private:
+  // Use Build()
+  CloseConnectionAction(ESB::Allocator &allocator);
+
+  ESB_DEFAULT_FUNCS(CloseConnectionAction);
+};
+
+class ReleaseSlotAction : public Action {
+ public:
+  /**
+   * Build a new ReleaseSlotAction.  Executing the action returns slots to a limit entity, typically in a cleanup rule
+   * list guarded by the mark set when an AcquireSlotCondition took them.
+   *
+   * @param map A map of config options.  "limit" is the mandatory id of the limit entity and "slots" the optional
+   * number of slots to return (1 by default).  Both must match the condition that took the slots.
+   * @param allocator The allocator to be used for the action
+   * @param action Will be set to a pointer to the created action
+   * @return ESB_SUCCESS if successful, another error code otherwise.
+   */
+  static ESB::Error Build(const ESB::AST::Map &map, ESB::Allocator &allocator, Action **action);
+
+  virtual ~ReleaseSlotAction();
+
+  virtual Type type() const;
+
+  inline const ESB::UniqueId &limit() const { return _limit; }
+
+  inline ESB::UInt32 slots() const { return _slots; }
+
+ private:
+  // Use Build()
+  ReleaseSlotAction(ESB::Allocator &allocator, const ESB::UniqueId &limit, ESB::UInt32 slots);
+
+  ESB::UniqueId _limit;
+  ESB::UInt32 _slots;
+
+  ESB_DEFAULT_FUNCS(ReleaseSlotAction);
+};
+
+class MarkAction : public Action {
+ public:
+  static ESB::Error Build(const ESB::AST::Map &map, ESB::Allocator &allocator, Action **action);
+
+  virtual ~MarkAction();
+
+  virtual Type type() const;
+
+  /**
+   * Get the mark this action sets.  Later MarkConditions in the same transaction that name it will match.
+   *
+   * @return The mark's name
+   */
+  inline const char *mark() const { return _mark; }
+
+ private:
+  // Use Build()
+  MarkAction(ESB::Allocator &allocator, char *mark);
+
+  char *_mark;
+
+  ESB_DEFAULT_FUNCS(MarkAction);
+};
+
 class TransitionAction : public Action {
  public:
   static ESB::Error Build(const ESB::AST::Map &map, ESB::Allocator &allocator, Action **action);
@@ -9,11 +9,15 @@
 #include <ASTMap.h>
 #endif
 
+#ifndef ESB_UNIQUE_ID_H
+#include <ESBUniqueId.h>
+#endif
+
 namespace ES {
 
 class Condition : public ESB::EmbeddedListElement {
  public:
-  enum Type { UNKNOWN, ACQUIRE_SLOT, PROPERTY_MATCH, RESULT_MATCH, MARK_MARK, WAF_MATCH };
+  enum Type { UNKNOWN, ACQUIRE_SLOT, PROPERTY_MATCH, RESULT_MATCH, MARK_MATCH, WAF_MATCH };
 
   static ESB::Error Build(const ESB::AST::Map &map, ESB::Allocator &allocator, Condition **condition);
 
@@ -27,12 +31,83 @@ class Condition : public ESB::EmbeddedListElement {
   // Use Build()
   Condition(ESB::Allocator &allocator);
 
- private:
   ESB::Allocator &_allocator;
 
   ESB_DEFAULT_FUNCS(Condition);
 };
 
+class MarkCondition : public Condition {
+ public:
+  /**
+   * Build a new MarkCondition.  The condition is true if any of its marks has been set by a MarkAction.
+   *
+   * @param map A map of config options.  "values" is a mandatory, non-empty list of mark names.
+   * @param allocator The allocator to be used for copies, etc.
+   * @param condition Will be set to a pointer to the created condition
+   * @return ESB_SUCCESS if successful, another error code otherwise.
+   */
+  static ESB::Error Build(const ESB::AST::Map &map, ESB::Allocator &allocator, Condition **condition);
+
+  virtual ~MarkCondition();
+
+  virtual Type type() const;
+
+  inline const char *const *marks() const { return _marks; }
+
+  inline ESB::UInt32 numMarks() const { return _numMarks; }
+
+ private:
+  // Use Build()
+  MarkCondition(ESB::Allocator &allocator, char **marks, ESB::UInt32 numMarks);
+
+  char **_marks;
+  ESB::UInt32 _numMarks;
+
+  ESB_DEFAULT_FUNCS(MarkCondition);
+};
+
+class AcquireSlotCondition : public Condition {
+ public:
+  enum Result { CONFORMING = 1 << 0, NON_CONFORMING = 1 << 1 };
+
+  /**
+   * Build a new AcquireSlotCondition.  Evaluating the condition takes slots from a limit entity, and the condition is
+   * true if the outcome is one of its values.
+   *
+   * @param map A map of config options.  "limit" is the mandatory id of the limit entity, "slots" the optional number
+   * of slots to take (1 by default), and "values" a mandatory list of CONFORMING and/or NON_CONFORMING.
+   * @param allocator The allocator to be used for the condition
+   * @param condition Will be set to a pointer to the created condition
+   * @return ESB_SUCCESS if successful, another error code otherwise.
+   */
+  static ESB::Error Build(const ESB::AST::Map &map, ESB::Allocator &allocator, Condition **condition);
+
+  virtual ~AcquireSlotCondition();
+
+  virtual Type type() const;
+
+  inline const ESB::UniqueId &limit() const { return _limit; }
+
+  inline ESB::UInt32 slots() const { return _slots; }
+
+  /**
+   * Get the outcomes that make this condition true.
+   *
+   * @return A bitmask of Result values
+   */
+  inline ESB::UInt32 results() const { return _results; }
+
+ private:
+  // Use Build()
+  AcquireSlotCondition(ESB::Allocator &allocator, const ESB::UniqueId &limit, ESB::UInt32 slots, ESB::UInt32 results);
+
+  ESB::UniqueId _limit;
+  ESB::UInt32 _slots;
+  ESB::UInt32 _results;
+
+  ESB_DEFAULT_FUNCS(AcquireSlotCondition);
+};
+
 }  // namespace ES
 
 #endif
@@ -17,6 +17,52 @@
 #include <ESBTLSContext.h>
 #endif
 
+#ifndef ESB_EMBEDDED_LIST_H
+#include <ESBEmbeddedList.h>
+#endif
+
+#ifndef ESB_RATE_LIMITER_H
+#include <ESBRateLimiter.h>
+#endif
+
+#ifndef ESB_SLOT_COUNTER_H
+#include <ESBSlotCounter.h>
+#endif
+
+#ifndef ESB_KEYED_SLOT_COUNTER_H
+#include <ESBKeyedSlotCounter.h>
+#endif
+
+#ifndef ESB_TOP_N_LIMITER_H
+#include <ESBTopNLimiter.h>
+#endif
+
+#ifndef ESB_CIDR_TABLE_H
+#include <ESBCidrTable.h>
+#endif
+
+#ifndef ESB_SOCKET_ADDRESS_H
+#include <ESBSocketAddress.h>
+#endif
+
+/** RATE_LIMIT entities track this many keys unless they set max_keys.
+ */
+#ifndef ES_RATE_LIMIT_MAX_KEYS
+#define ES_RATE_LIMIT_MAX_KEYS (1U << 20)
+#endif
+
+/** MAX_LIMIT entities with a key track this many keys unless they set max_keys.
+ */
+#ifndef ES_MAX_LIMIT_MAX_KEYS
+#define ES_MAX_LIMIT_MAX_KEYS (1U << 20)
+#endif
+
+/** TOP_N_LIMIT entities count each key's slots over this window unless they set time.
+ */
+#ifndef ES_TOP_N_LIMIT_WINDOW_MICROSECONDS
+#define ES_TOP_N_LIMIT_WINDOW_MICROSECONDS ESB_UINT64_C(60000000)
+#endif
+
 namespace ES {
 
 class Entity : public ESB::EmbeddedMapElement {
@@ -153,6 +199,331 @@ class TLSContextIndexEntity : public Entity {
   ESB_DEFAULT_FUNCS(TLSContextIndexEntity);
 };
 
+/** Common base for the entities that ACQUIRE_SLOT conditions take slots from.
+ */
+class LimitEntity : public Entity {
+ public:
+  enum KeyType { KEY_NONE = 0, KEY_IP_ADDRESS = 1, KEY_STRING = 2 };
+
+  virtual ~LimitEntity();
+
+  /**
+   * Get what the limit is counted per.
+   *
+   * @return KEY_NONE if there is one count for everyone, otherwise the type of key there is a count for.
+   */
+  inline KeyType keyType() const { return _keyType; }
+
+ protected:
+  // Use Build()
+  LimitEntity(ESB::Allocator &allocator, ESB::UniqueId &id, KeyType keyType);
+
+  /**
+   * Parse the mandatory "key" field.
+   *
+   * @param map A map of config options
+   * @param keyType Will be set to the key type
+   * @return ESB_SUCCESS if successful, another error code otherwise.
+   */
+  static ESB::Error ParseKeyType(const ESB::AST::Map &map, KeyType *keyType);
+
+  KeyType _keyType;
+
+  ESB_DISABLE_AUTO_COPY(LimitEntity);
+};
+
+/** Limits the rate at which each key, e.g. each client IP address, may take slots.  Every key may take up to limit
+ *  slots per time window, all at once if it likes.  The buckets are shared by every thread.
+ */
+class RateLimitEntity : public LimitEntity {
+ public:
+  /**
+   * Build a new RateLimitEntity.
+   *
+   * @param map A map of config options.  "key" (NONE or IP_ADDRESS), "limit" and "time" ({ value, unit }) are
+   * mandatory.  "max_keys" optionally sizes the table of keys, ES_RATE_LIMIT_MAX_KEYS by default, and "shards"
+   * optionally splits it, by default into one shard per core.
+   * @param allocator The allocator to be used for the entity and its table
+   * @param id The id of the entity to create
+   * @param entity Will be set to a pointer to the created entity
+   * @return ESB_SUCCESS if successful, another error code otherwise.
+   */
+  static ESB::Error Build(const ESB::AST::Map &map, ESB::Allocator &allocator, ESB::UniqueId &id, Entity **entity);
+
+  virtual ~RateLimitEntity();
+
+  virtual Type type() const;
+
+  /**
+   * Take slots from the bucket of the key the address maps to.
+   *
+   * @param address The peer address.  Ignored if the key type is KEY_NONE.
+   * @param slots The number of slots to take
+   * @param now The current time
+   * @return ESB_SUCCESS if the slots were taken, ESB_OVERFLOW if the key is over its limit, another error code
+   * otherwise.
+   */
+  ESB::Error acquire(const ESB::SocketAddress *address, ESB::UInt32 slots, const ESB::Date &now);
+
+  inline ESB::UInt32 limit() const { return _limiter.limit(); }
+
+  inline ESB::UInt64 windowMicroSeconds() const { return _windowMicroSeconds; }
+
+  inline const ESB::RateLimiter &limiter() const { return _limiter; }
+
+ private:
+  // Use Build()
+  RateLimitEntity(ESB::Allocator &allocator, ESB::UniqueId &id, KeyType keyType, ESB::UInt32 limit,
+                  ESB::UInt64 windowMicroSeconds, ESB::UInt32 maxKeys, ESB::UInt32 shards);
+
+  const ESB::UInt64 _windowMicroSeconds;
+  ESB::RateLimiter _limiter;
+
+  ESB_DEFAULT_FUNCS(RateLimitEntity);
+};
+
+/** Limits the number of slots, e.g. connections, in use at once by each key or by everyone.  Slots taken by
+ *  ACQUIRE_SLOT conditions must be returned by RELEASE_SLOT actions.  The counts are shared by every thread.
+ *
+ *  Without a key, each thread leases a batch of slots at a time so admission does not bounce the shared count between
+ *  cores, unless the entity is strict or the limit is too small to lease.  Per key counts are always strict.
+ */
+class MaxLimitEntity : public LimitEntity {
+ public:
+  /**
+   * Build a new MaxLimitEntity.
+   *
+   * @param map A map of config options.  "key" (NONE or IP_ADDRESS) and "limit" are mandatory.  "strict" optionally
+   * disables leasing for NONE.  "max_keys" optionally sizes the table of keys for IP_ADDRESS, ES_MAX_LIMIT_MAX_KEYS by
+   * default, and "shards" optionally sets the number of leases for NONE, by default one per core.
+   * @param allocator The allocator to be used for the entity and its counts
+   * @param id The id of the entity to create
+   * @param entity Will be set to a pointer to the created entity
+   * @return ESB_SUCCESS if successful, another error code otherwise.
+   */
+  static ESB::Error Build(const ESB::AST::Map &map, ESB::Allocator &allocator, ESB::UniqueId &id, Entity **entity);
+
+  virtual ~MaxLimitEntity();
+
+  virtual Type type() const;
+
+  /**
+   * Take slots from the count of the key the address maps to.
+   *
+   * @param address The peer address.  Ignored if the key type is KEY_NONE.
+   * @param slots The number of slots to take
+   * @param tracked If not NULL, set to false if the key's table was full and the slots were let through uncounted.
+   * Those slots must not be released.
+   * @return ESB_SUCCESS if the slots were taken, ESB_OVERFLOW if the key is at its limit, another error code otherwise.
+   */
+  ESB::Error acquire(const ESB::SocketAddress *address, ESB::UInt32 slots, bool *tracked = NULL);
+
+  /**
+   * Return slots taken by acquire().
+   *
+   * @param address The peer address.  Ignored if the key type is KEY_NONE.
+   * @param slots The number of slots to return
+   */
+  void release(const ESB::SocketAddress *address, ESB::UInt32 slots);
+
+  /**
+   * Get the number of slots in use by the key the address maps to.
+   *
+   * @param address The peer address.  Ignored if the key type is KEY_NONE.
+   * @return The number of slots in use
+   */
+  ESB::UInt32 inUse(const ESB::SocketAddress *address) const;
+
+  inline ESB::UInt32 limit() const { return _limit; }
+
+  inline bool isStrict() const { return !_counter || _counter->isStrict(); }
+
+ private:
+  // Use Build()
+  MaxLimitEntity(ESB::Allocator &allocator, ESB::UniqueId &id, KeyType keyType, ESB::UInt32 limit,
+                 ESB::SlotCounter *counter, ESB::KeyedSlotCounter *keyedCounter);
+
+  const ESB::UInt32 _limit;
+  // Exactly one of these is set, depending on the key type
+  ESB::SlotCounter *_counter;
+  ESB::KeyedSlotCounter *_keyedCounter;
+
+  ESB_DEFAULT_FUNCS(MaxLimitEntity);
+};
+
+/** Finds the few keys, e.g. client IP addresses, that take a grossly disproportionate share of the slots without
+ *  tracking every key.  A key that takes more than threshold slots in a time window is non-conforming for the rest of
+ *  that window and all of the next.  The counts are shared by every thread, see ESB::TopNLimiter.
+ */
+class TopNLimitEntity : public LimitEntity {
+ public:
+  /**
+   * Build a new TopNLimitEntity.
+   *
+   * @param map A map of config options.  "key" (IP_ADDRESS), "n" (the number of keys tracked per thread) and
+   * "threshold" are mandatory.  "time" ({ value, unit }) optionally sets the window, ES_TOP_N_LIMIT_WINDOW_MICROSECONDS
+   * by default, and "shards" optionally sets the number of summaries, by default one per core.
+   * @param allocator The allocator to be used for the entity and its summaries
+   * @param id The id of the entity to create
+   * @param entity Will be set to a pointer to the created entity
+   * @return ESB_SUCCESS if successful, another error code otherwise.
+   */
+  static ESB::Error Build(const ESB::AST::Map &map, ESB::Allocator &allocator, ESB::UniqueId &id, Entity **entity);
+
+  virtual ~TopNLimitEntity();
+
+  virtual Type type() const;
+
+  /**
+   * Count slots taken by the key the address maps to.
+   *
+   * @param address The peer address
+   * @param slots The number of slots to take
+   * @param now The current time
+   * @return ESB_SUCCESS if the key is conforming, ESB_OVERFLOW if it is over the threshold, another error code
+   * otherwise.
+   */
+  ESB::Error acquire(const ESB::SocketAddress *address, ESB::UInt32 slots, const ESB::Date &now);
+
+  inline ESB::UInt32 n() const { return _limiter.n(); }
+
+  inline ESB::UInt64 threshold() const { return _limiter.threshold(); }
+
+  inline ESB::UInt64 windowMicroSeconds() const { return _windowMicroSeconds; }
+
+  inline ESB::TopNLimiter &limiter() { return _limiter; }
+
+ private:
+  // Use Build()
+  TopNLimitEntity(ESB::Allocator &allocator, ESB::UniqueId &id, KeyType keyType, ESB::UInt32 n,
+                  ESB::UInt32 threshold, ESB::UInt64 windowMicroSeconds, ESB::UInt32 shards);
+
+  const ESB::UInt64 _windowMicroSeconds;
+  ESB::TopNLimiter _limiter;
+
+  ESB_DEFAULT_FUNCS(TopNLimitEntity);
+};
+
+/** A list of rules evaluated in order until an action transitions to another entity or ends the transaction.  Rule
+ *  lists make up the inbound connection, inbound request, outbound and cleanup DAGs.
+ */
+class RuleListEntity : public Entity {
+ public:
+  /**
+   * Build a new RuleListEntity.
+   *
+   * @param map A map of config options.  "rules" is a mandatory list of rules.
+   * @param allocator The allocator to be used for the entity and its rules
+   * @param id The id of the entity to create
+   * @param type One of the *_RULE_LIST or *_CLEANUP types
+   * @param entity Will be set to a pointer to the created entity
+   * @return ESB_SUCCESS if successful, another error code otherwise.
+   */
+  static ESB::Error Build(const ESB::AST::Map &map, ESB::Allocator &allocator, ESB::UniqueId &id, Type type,
+                          Entity **entity);
+
+  /** Destroys the entity's rules.
+   */
+  virtual ~RuleListEntity();
+
+  virtual Type type() const;
+
+  inline const ESB::EmbeddedList &rules() const { return _rules; }
+
+ private:
+  // Use Build()
+  RuleListEntity(ESB::Allocator &allocator, ESB::UniqueId &id, Type type);
+
+  Type _type;
+  ESB::EmbeddedList _rules;
+
+  ESB_DEFAULT_FUNCS(RuleListEntity);
+};
+
+/** Picks a list of rules by the longest CIDR block in its rule map that contains the peer's IPv4 address.  The blocks
+ *  are compiled into an ESB::CidrTable when the entity is built, so classifying a connection takes a few loads no
+ *  matter how many blocks there are, and the entity can be shared by every thread without locks.
+ */
+class CidrMapEntity : public Entity {
+ public:
+  /**
+   * Build a new CidrMapEntity.
+   *
+   * @param map A map of config options.  "rule_map" is a mandatory map of CIDR blocks like "10.0.0.0/8" to lists of
+   * rules, and "default_rules" is an optional list of rules.  "attribute" and "component" may only be PEER_ADDRESS
+   * and IP_ADDRESS.
+   * @param allocator The allocator to be used for the entity, its rules and its table
+   * @param id The id of the entity to create
+   * @param type INBOUND_CONNECTION_CIDR_MAP or OUTBOUND_CONNECTION_CIDR_MAP
+   * @param entity Will be set to a pointer to the created entity
+   * @return ESB_SUCCESS if successful, ESB_INVALID_FIELD if a CIDR block is malformed, ESB_UNIQUENESS_VIOLATION if
+   * two CIDR blocks are the same, another error code otherwise.
+   */
+  static ESB::Error Build(const ESB::AST::Map &map, ESB::Allocator &allocator, ESB::UniqueId &id, Type type,
+                          Entity **entity);
+
+  /** Destroys the entity's rules.
+   */
+  virtual ~CidrMapEntity();
+
+  virtual Type type() const;
+
+  /**
+   * Find the longest CIDR block containing an address.
+   *
+   * @param address The peer address
+   * @param block Will be set to the block's index, see rules()
+   * @return ESB_SUCCESS if a CIDR block contains the address, ESB_NULL_POINTER if the address is NULL, ESB_CANNOT_FIND
+   * otherwise.
+   */
+  inline ESB::Error find(const ESB::SocketAddress *address, ESB::UInt32 *block) const {
+    if (!address) {
+      return ESB_NULL_POINTER;
+    }
+    return _table.find(ntohl(address->primitiveAddress()->sin_addr.s_addr), block);
+  }
+
+  /**
+   * Find the rules for the longest CIDR block containing an address.  When a RuleGraph evaluates the map, the default
+   * rules run if no CIDR block contains the address or the block's rules neither transition nor end the transaction.
+   *
+   * @param address The peer address
+   * @return The rules, or NULL if the address is NULL or no CIDR block contains it.
+   */
+  inline const ESB::EmbeddedList *find(const ESB::SocketAddress *address) const {
+    ESB::UInt32 block = 0U;
+    return ESB_SUCCESS == find(address, &block) ? &_ruleMap[block] : NULL;
+  }
+
+  /** Get the rules for a CIDR block.
+   *
+   * @param block The block's index, less than size()
+   * @return The rules
+   */
+  inline const ESB::EmbeddedList &rules(ESB::UInt32 block) const { return _ruleMap[block]; }
+
+  inline const ESB::EmbeddedList &defaultRules() const { return _defaultRules; }
+
+  /** Get the number of CIDR blocks in the rule map.
+   *
+   * @return The number of CIDR blocks
+   */
+  inline ESB::UInt32 size() const { return _size; }
+
+ private:
+  // Use Build()
+  CidrMapEntity(ESB::Allocator &allocator, ESB::UniqueId &id, Type type, ESB::EmbeddedList *ruleMap,
+                ESB::UInt32 size);
+
+  Type _type;
+  const ESB::UInt32 _size;
+  ESB::EmbeddedList *_ruleMap;  // the rules for each CIDR block, indexed by the table's values
+  ESB::EmbeddedList _defaultRules;
+  ESB::CidrTable _table;
+
+  ESB_DEFAULT_FUNCS(CidrMapEntity);
+};
+
 }  // namespace ES
 
 #endif
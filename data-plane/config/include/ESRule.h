@@ -9,12 +9,32 @@
 #include <ESBEmbeddedList.h>
 #endif
 
+#ifndef ESB_AST_MAP_H
+#include <ASTMap.h>
+#endif
+
 namespace ES {
 
+/** A list of conditions and the actions to take if any of them is true.  A rule without conditions always takes its
+ *  actions.
+ */
 class Rule : public ESB::EmbeddedListElement {
  public:
+  /**
+   * Build a new Rule.
+   *
+   * @param map A map of config options.  "conditions" is an optional list of conditions, "actions" a mandatory list of
+   * actions.
+   * @param allocator The allocator to be used for the rule, its conditions and its actions
+   * @param rule Will be set to a pointer to the created rule
+   * @return ESB_SUCCESS if successful, another error code otherwise.
+   */
+  static ESB::Error Build(const ESB::AST::Map &map, ESB::Allocator &allocator, Rule **rule);
+
   Rule(ESB::Allocator &allocator);
 
+  /** Destroys the rule's conditions and actions.
+   */
   virtual ~Rule();
 
   virtual ESB::CleanupHandler *cleanupHandler();
@@ -0,0 +1,237 @@
+#ifndef ES_RULE_GRAPH_H
+#define ES_RULE_GRAPH_H
+
+#ifndef ES_ENTITY_H
+#include <ESEntity.h>
+#endif
+
+#ifndef ES_ACTION_H
+#include <ESAction.h>
+#endif
+
+#ifndef ES_CONDITION_H
+#include <ESCondition.h>
+#endif
+
+#ifndef ESB_SYSTEM_ALLOCATOR_H
+#include <ESBSystemAllocator.h>
+#endif
+
+namespace ES {
+
+/** A set of rule list and CIDR map entities compiled into flat arrays for evaluation on the data path.
+ *
+ *  Compilation resolves every TransitionAction's destination to a node index and every AcquireSlotCondition's and
+ *  ReleaseSlotAction's limit to its entity, interns MarkAction and MarkCondition names to bits, and lays the nodes out
+ *  in topological order so every transition jumps forward.  Nodes, rules, conditions and actions each live in one
+ *  contiguous array in a single allocation, and evaluation switches on compact type codes without hash lookups or
+ *  virtual calls.
+ *
+ *  The hit counters are updated with relaxed loads and stores instead of locked instructions.  Several threads may
+ *  execute the same graph, but then the counts may come out slightly low, so compile a copy per multiplexer where exact
+ *  counts matter.  Limits belong to their entities and are shared by every copy.
+ *
+ *  @ingroup config
+ */
+class RuleGraph {
+ public:
+  enum Outcome {
+    NONE = 0,             /**< The last node ran out of rules, so the transaction proceeds */
+    SEND_RESPONSE = 1,    /**< Context::response() should be sent */
+    CLOSE_CONNECTION = 2  /**< The connection should be closed */
+  };
+
+  /** The state one transaction carries through the graph.  Keep a connection's context until its cleanup rule list
+   *  has run, and start each request's context with inheritMarks() so marks set on the connection are visible to the
+   *  request's conditions.
+   */
+  class Context {
+   public:
+    Context() : _marks(0U), _untracked(0U), _response(NULL), _peerAddress(NULL), _now() {}
+
+    virtual ~Context() {}
+
+    inline ESB::UInt64 marks() const { return _marks; }
+
+    /** Add the marks another context has set, usually the context of the connection a request arrived on.
+     *
+     * @param context The other context
+     */
+    inline void inheritMarks(const Context &context) { _marks |= context._marks; }
+
+    /** Set the client's address, which limits keyed by IP_ADDRESS count against.
+     *
+     * @param address The address.  It must outlive every execute() call with this context.
+     */
+    inline void setPeerAddress(const ESB::SocketAddress *address) { _peerAddress = address; }
+
+    /** Set the time that limits refill their buckets up to.  Usually the time the multiplexer cached from
+     * ESB::MonotonicTimeSource.  Wall clock time must not be used since setting the clock back would stall the limits.
+     *
+     * @param now The current monotonic time
+     */
+    inline void setNow(const ESB::Date &now) { _now = now; }
+
+    /** Get the response chosen by a SEND_RESPONSE action.
+     *
+     * @return The response if the graph returned SEND_RESPONSE, NULL otherwise
+     */
+    inline const SendResponseAction *response() const { return _response; }
+
+    inline void reset() {
+      _marks = 0U;
+      _untracked = 0U;
+      _response = NULL;
+    }
+
+   private:
+    ESB::UInt64 _marks;
+    ESB::UInt64 _untracked;  // Keyed max limits that let this context's slots through uncounted, by limit bit
+    const SendResponseAction *_response;
+    const ESB::SocketAddress *_peerAddress;
+    ESB::Date _now;
+
+    friend class RuleGraph;
+
+    ESB_DEFAULT_FUNCS(Context);
+  };
+
+  RuleGraph(ESB::Allocator &allocator = ESB::SystemAllocator::Instance());
+
+  virtual ~RuleGraph();
+
+  /** Compile a set of entities, replacing any previous graph.  Rule lists and CIDR maps become nodes, and other
+   *  entities are ignored unless a transition names them.
+   *
+   * @param entities The entities.  The rule lists, CIDR maps, limits and SendResponseActions must outlive the graph.
+   * @param numEntities The number of entities
+   * @return ESB_SUCCESS if successful, ESB_UNIQUENESS_VIOLATION if two nodes share an id, ESB_CANNOT_FIND if a
+   * transition or condition names a missing entity, ESB_INVALID_ARGUMENT if transitions form a cycle, ESB_OVERFLOW if
+   * there are more than 64 distinct marks or 64 distinct per key max limits, ESB_NOT_IMPLEMENTED if a rule uses a
+   * condition, action, limit or transition destination that cannot be compiled yet, another error code otherwise.
+   */
+  ESB::Error compile(Entity *const *entities, ESB::UInt32 numEntities);
+
+  /** Free the compiled graph.
+   */
+  void clear();
+
+  /** Find the node compiled from a rule list or CIDR map.  Resolve roots like the inbound connection and inbound
+   *  request rule lists once after compiling rather than per transaction.
+   *
+   * @param id The rule list's or CIDR map's id
+   * @param node Will be set to the node's index
+   * @return ESB_SUCCESS if successful, ESB_CANNOT_FIND if no node has that id.
+   */
+  ESB::Error find(const ESB::UniqueId &id, ESB::UInt32 *node) const;
+
+  /** Evaluate the graph from a node.  Each node's rules run in order.  A rule fires if any of its conditions is true or
+   *  it has none, and its actions then run in order until one of them transitions to another node or ends the
+   *  transaction.  A CIDR map node runs the rules of the longest CIDR block containing the peer address, then its
+   *  default rules if none of those transitioned.
+   *
+   * @param node The index of the first node, usually from find()
+   * @param context The transaction's state
+   * @return What the transaction should do next
+   */
+  Outcome execute(ESB::UInt32 node, Context &context);
+
+  inline ESB::UInt32 numNodes() const { return _numNodes; }
+
+  inline ESB::UInt32 numRules() const { return _numRules; }
+
+  /** Get the number of times evaluation entered a node.
+   *
+   * @param node The node's index
+   * @return The number of hits
+   */
+  inline ESB::UInt64 nodeHits(ESB::UInt32 node) const {
+    return node < _numNodes ? __atomic_load_n(&_nodes[node].hits, __ATOMIC_RELAXED) : 0U;
+  }
+
+  /** Get the number of times a rule fired.  A node's rules are numbered consecutively, in config order, starting at
+   *  firstRule(node).  A CIDR map's rules are numbered block by block, followed by its default rules.
+   *
+   * @param rule The rule's index
+   * @return The number of hits
+   */
+  inline ESB::UInt64 ruleHits(ESB::UInt32 rule) const {
+    return rule < _numRules ? __atomic_load_n(&_rules[rule].hits, __ATOMIC_RELAXED) : 0U;
+  }
+
+  inline ESB::UInt32 firstRule(ESB::UInt32 node) const { return node < _numNodes ? _nodes[node].firstRule : 0U; }
+
+  inline const Entity *entity(ESB::UInt32 node) const { return node < _numNodes ? _nodes[node].entity : NULL; }
+
+ private:
+  struct Node {
+    ESB::UInt32 firstRule;
+    ESB::UInt32 numRules;
+    ESB::UInt32 firstBlock;  // the node's first entry in _blocks if it is a CIDR map
+    const Entity *entity;
+    const CidrMapEntity *cidrMap;  // NULL unless the node is a CIDR map
+    ESB::UInt64 hits;
+  };
+
+  struct RuleEntry {
+    ESB::UInt32 firstCondition;
+    ESB::UInt32 numConditions;
+    ESB::UInt32 firstAction;
+    ESB::UInt32 numActions;
+    ESB::UInt64 hits;
+  };
+
+  struct ConditionEntry {
+    ESB::UInt32 type;
+    ESB::UInt32 slots;
+    ESB::UInt32 results;
+    ESB::UInt64 marks;
+    ESB::UInt32 limitType;  // the Entity::Type of limit
+    ESB::UInt64 limitBit;   // the limit's bit in Context::_untracked if it is a per key max limit, else 0
+    LimitEntity *limit;
+  };
+
+  struct ActionEntry {
+    ESB::UInt32 type;
+    ESB::UInt32 node;
+    ESB::UInt32 slots;
+    ESB::UInt64 marks;
+    const SendResponseAction *response;
+    // NULL for RELEASE_SLOT on a rate limit
+    MaxLimitEntity *maxLimit;
+    ESB::UInt64 limitBit;
+  };
+
+  ESB::Error compileLists(Entity *const *entities, ESB::UInt32 numEntities, const Entity **lists,
+                          ESB::UInt32 numLists);
+
+  ESB::Error layout(Entity *const *entities, ESB::UInt32 numEntities, const Entity **lists, ESB::UInt32 numLists,
+                    ESB::UInt32 numTransitions, ESB::UInt32 numBlocks, const char **marks, ESB::UInt32 numMarks,
+                    ESB::UInt32 *scratch);
+
+  // Returns NONE unless an action ended the transaction.  next is set if an action transitioned.
+  Outcome executeRule(ESB::UInt32 rule, Context &context, ESB::UInt32 *next);
+
+  // A relaxed load and store avoids a locked instruction.  Concurrent executions may lose an increment.
+  static inline void Increment(ESB::UInt64 *value) {
+    __atomic_store_n(value, __atomic_load_n(value, __ATOMIC_RELAXED) + 1U, __ATOMIC_RELAXED);
+  }
+
+  ESB::UInt32 _numNodes;
+  ESB::UInt32 _numRules;
+  ESB::UInt32 _numConditions;
+  ESB::UInt32 _numActions;
+  Node *_nodes;
+  RuleEntry *_rules;
+  ConditionEntry *_conditions;
+  ActionEntry *_actions;
+  ESB::UInt32 *_byId;    // node indices sorted by entity id
+  ESB::UInt32 *_blocks;  // for each CIDR map node, the first rule of each block and then of its default rules
+  ESB::Allocator &_allocator;
+
+  ESB_DEFAULT_FUNCS(RuleGraph);
+};
+
+}  // namespace ES
+
+#endif
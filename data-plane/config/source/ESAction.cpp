@@ -64,6 +64,12 @@ ESB::Error Action::Build(const ESB::AST::Map &map, ESB::Allocator &allocator, Ac
   switch (type) {
     case SEND_RESPONSE:
       return SendResponseAction::Build(map, allocator, action);
+    case CLOSE_CONNECTION:
+      return CloseConnectionAction::Build(map, allocator, action);
+    case RELEASE_SLOT:
+      return ReleaseSlotAction::Build(map, allocator, action);
+    case MARK:
+      return MarkAction::Build(map, allocator, action);
     case TRANSITION:
       return TransitionAction::Build(map, allocator, action);
     default:
@@ -91,6 +97,72 @@ ESB::Error TransitionAction::Build(const ESB::AST::Map &map, ESB::Allocator &all
   return ESB_SUCCESS;
 }
 
+CloseConnectionAction::CloseConnectionAction(ESB::Allocator &allocator) : Action(allocator) {}
+CloseConnectionAction::~CloseConnectionAction() {}
+Action::Type CloseConnectionAction::type() const { return Action::CLOSE_CONNECTION; }
+
+ESB::Error CloseConnectionAction::Build(const ESB::AST::Map &map, ESB::Allocator &allocator, Action **action) {
+  *action = new (allocator) CloseConnectionAction(allocator);
+  if (!*action) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  return ESB_SUCCESS;
+}
+
+ReleaseSlotAction::ReleaseSlotAction(ESB::Allocator &allocator, const ESB::UniqueId &limit, ESB::UInt32 slots)
+    : Action(allocator), _limit(limit), _slots(slots) {}
+ReleaseSlotAction::~ReleaseSlotAction() {}
+Action::Type ReleaseSlotAction::type() const { return Action::RELEASE_SLOT; }
+
+ESB::Error ReleaseSlotAction::Build(const ESB::AST::Map &map, ESB::Allocator &allocator, Action **action) {
+  ESB::UniqueId limit;
+  ESB::Error error = map.find("limit", limit);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  ESB::UInt32 slots = 1U;
+  error = map.find("slots", &slots, true);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  *action = new (allocator) ReleaseSlotAction(allocator, limit, slots);
+  if (!*action) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  return ESB_SUCCESS;
+}
+
+MarkAction::MarkAction(ESB::Allocator &allocator, char *mark) : Action(allocator), _mark(mark) {}
+
+MarkAction::~MarkAction() {
+  if (_mark) {
+    _allocator.deallocate(_mark);
+    _mark = NULL;
+  }
+}
+
+Action::Type MarkAction::type() const { return Action::MARK; }
+
+ESB::Error MarkAction::Build(const ESB::AST::Map &map, ESB::Allocator &allocator, Action **action) {
+  char *mark = NULL;
+  ESB::Error error = map.findAndDuplicate(allocator, "mark", &mark);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  *action = new (allocator) MarkAction(allocator, mark);
+  if (!*action) {
+    allocator.deallocate(mark);
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  return ESB_SUCCESS;
+}
+
 SendResponseAction::SendResponseAction(ESB::Allocator &allocator, ESB::UInt16 statusCode, char *reasonPhrase)
     : Action(allocator), _statusCode(statusCode), _reasonPhrase(reasonPhrase) {}
 
@@ -2,6 +2,14 @@
 #include <ESCondition.h>
 #endif
 
+#ifndef ESB_AST_STRING_H
+#include <ASTString.h>
+#endif
+
+#ifndef ESB_STRING_H
+#include <ESBString.h>
+#endif
+
 namespace ES {
 
 // Must be in same order as ConditionType
@@ -49,9 +57,128 @@ ESB::Error Condition::Build(const ESB::AST::Map &map, ESB::Allocator &allocator,
   }
 
   switch (type) {
+    case ACQUIRE_SLOT:
+      return AcquireSlotCondition::Build(map, allocator, condition);
+    case MARK_MATCH:
+      return MarkCondition::Build(map, allocator, condition);
     default:
       return ESB_NOT_IMPLEMENTED;
   }
 }
 
+MarkCondition::MarkCondition(ESB::Allocator &allocator, char **marks, ESB::UInt32 numMarks)
+    : Condition(allocator), _marks(marks), _numMarks(numMarks) {}
+
+MarkCondition::~MarkCondition() {
+  if (_marks) {
+    for (ESB::UInt32 i = 0; i < _numMarks; ++i) {
+      _allocator.deallocate(_marks[i]);
+    }
+    _allocator.deallocate(_marks);
+    _marks = NULL;
+  }
+}
+
+Condition::Type MarkCondition::type() const { return Condition::MARK_MATCH; }
+
+ESB::Error MarkCondition::Build(const ESB::AST::Map &map, ESB::Allocator &allocator, Condition **condition) {
+  const ESB::AST::List *values = NULL;
+  ESB::Error error = map.find("values", &values);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  const ESB::UInt32 numMarks = values->size();
+  if (0 == numMarks) {
+    return ESB_INVALID_FIELD;
+  }
+
+  char **marks = NULL;
+  error = allocator.allocate(sizeof(char *) * numMarks, (void **)&marks);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  ESB::UInt32 copied = 0;
+  for (const ESB::AST::Element *current = values->first(); current && copied < numMarks;
+       current = (const ESB::AST::Element *)current->next()) {
+    if (ESB::AST::Element::STRING != current->type()) {
+      error = ESB_INVALID_FIELD;
+      break;
+    }
+
+    error = ESB::Duplicate(((const ESB::AST::String *)current)->value(), allocator, &marks[copied]);
+    if (ESB_SUCCESS != error) {
+      break;
+    }
+    ++copied;
+  }
+
+  if (ESB_SUCCESS == error) {
+    *condition = new (allocator) MarkCondition(allocator, marks, numMarks);
+    if (*condition) {
+      return ESB_SUCCESS;
+    }
+    error = ESB_OUT_OF_MEMORY;
+  }
+
+  for (ESB::UInt32 i = 0; i < copied; ++i) {
+    allocator.deallocate(marks[i]);
+  }
+  allocator.deallocate(marks);
+  return error;
+}
+
+AcquireSlotCondition::AcquireSlotCondition(ESB::Allocator &allocator, const ESB::UniqueId &limit, ESB::UInt32 slots,
+                                           ESB::UInt32 results)
+    : Condition(allocator), _limit(limit), _slots(slots), _results(results) {}
+
+AcquireSlotCondition::~AcquireSlotCondition() {}
+
+Condition::Type AcquireSlotCondition::type() const { return Condition::ACQUIRE_SLOT; }
+
+ESB::Error AcquireSlotCondition::Build(const ESB::AST::Map &map, ESB::Allocator &allocator, Condition **condition) {
+  ESB::UniqueId limit;
+  ESB::Error error = map.find("limit", limit);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  ESB::UInt32 slots = 1U;
+  error = map.find("slots", &slots, true);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  const ESB::AST::List *values = NULL;
+  error = map.find("values", &values);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  ESB::UInt32 results = 0U;
+  for (const ESB::AST::Element *current = values->first(); current;
+       current = (const ESB::AST::Element *)current->next()) {
+    if (ESB::AST::Element::STRING != current->type()) {
+      return ESB_INVALID_FIELD;
+    }
+
+    const char *value = ((const ESB::AST::String *)current)->value();
+    if (0 == strcasecmp(value, "CONFORMING")) {
+      results |= CONFORMING;
+    } else if (0 == strcasecmp(value, "NON_CONFORMING")) {
+      results |= NON_CONFORMING;
+    } else {
+      return ESB_INVALID_FIELD;
+    }
+  }
+
+  if (0U == results) {
+    return ESB_INVALID_FIELD;
+  }
+
+  *condition = new (allocator) AcquireSlotCondition(allocator, limit, slots, results);
+  return *condition ? ESB_SUCCESS : ESB_OUT_OF_MEMORY;
+}
+
 }  // namespace ES
@@ -2,6 +2,14 @@
 #include <ESEntity.h>
 #endif
 
+#ifndef ES_RULE_H
+#include <ESRule.h>
+#endif
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
 namespace ES {
 
 // Must be in same order as Entity::Type
@@ -95,6 +103,28 @@ ESB::Error Entity::Build(const ESB::AST::Map &map, ESB::Allocator &allocator, En
       return TLSContextEntity::Build(map, allocator, id, entity);
     case TLS_IDX:
       return TLSContextIndexEntity::Build(map, allocator, id, entity);
+    case MAX_LIMIT:
+      return MaxLimitEntity::Build(map, allocator, id, entity);
+    case RATE_LIMIT:
+      return RateLimitEntity::Build(map, allocator, id, entity);
+    case TOP_N_LIMIT:
+      return TopNLimitEntity::Build(map, allocator, id, entity);
+    case INBOUND_CONNECTION_CIDR_MAP:
+    case OUTBOUND_CONNECTION_CIDR_MAP:
+      return CidrMapEntity::Build(map, allocator, id, type, entity);
+    case INBOUND_CONNECTION_RULE_LIST:
+    case INBOUND_CONNECTION_CLEANUP:
+    case INBOUND_REQUEST_RULE_LIST:
+    case INBOUND_REQUEST_CLEANUP:
+    case OUTBOUND_CONNECTION_RULE_LIST:
+    case OUTBOUND_CONNECTION_CLEANUP:
+    case OUTBOUND_REQUEST_RULE_LIST:
+    case OUTBOUND_REQUEST_CLEANUP:
+    case OUTBOUND_RESPONSE_RULE_LIST:
+    case OUTBOUND_RESPONSE_CLEANUP:
+    case INBOUND_RESPONSE_RULE_LIST:
+    case INBOUND_RESPONSE_CLEANUP:
+      return RuleListEntity::Build(map, allocator, id, type, entity);
     default:
       return ESB_NOT_IMPLEMENTED;
   }
@@ -275,4 +305,534 @@ ESB::Error TLSContextIndexEntity::Build(const ESB::AST::Map &map, ESB::Allocator
 
 Entity::Type TLSContextIndexEntity::type() const { return Entity::TLS_IDX; }
 
+// Parses a list of rules onto the end of a list
+static ESB::Error ParseRules(const ESB::AST::List &rules, ESB::Allocator &allocator, ESB::EmbeddedList &list) {
+  for (const ESB::AST::Element *current = rules.first(); current;
+       current = (const ESB::AST::Element *)current->next()) {
+    if (ESB::AST::Element::MAP != current->type()) {
+      return ESB_INVALID_FIELD;
+    }
+
+    Rule *rule = NULL;
+    ESB::Error error = Rule::Build(*(const ESB::AST::Map *)current, allocator, &rule);
+    if (ESB_SUCCESS != error) {
+      return error;
+    }
+    list.addLast(rule);
+  }
+
+  return ESB_SUCCESS;
+}
+
+RuleListEntity::RuleListEntity(ESB::Allocator &allocator, ESB::UniqueId &id, Type type)
+    : Entity(allocator, id), _type(type), _rules() {}
+
+RuleListEntity::~RuleListEntity() { _rules.clear(); }
+
+Entity::Type RuleListEntity::type() const { return _type; }
+
+ESB::Error RuleListEntity::Build(const ESB::AST::Map &map, ESB::Allocator &allocator, ESB::UniqueId &id, Type type,
+                                 Entity **entity) {
+  const ESB::AST::List *rules = NULL;
+  ESB::Error error = map.find("rules", &rules);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  RuleListEntity *list = new (allocator) RuleListEntity(allocator, id, type);
+  if (!list) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  error = ParseRules(*rules, allocator, list->_rules);
+  if (ESB_SUCCESS != error) {
+    list->cleanupHandler()->destroy(list);
+    return error;
+  }
+
+  *entity = list;
+  return ESB_SUCCESS;
+}
+
+// Fields that only have one legal value so far may be left out
+static ESB::Error CheckField(const ESB::AST::Map &map, const char *key, const char *value) {
+  const char *str = NULL;
+  ESB::Error error = map.find(key, &str);
+
+  switch (error) {
+    case ESB_SUCCESS:
+      return 0 == strcasecmp(value, str) ? ESB_SUCCESS : ESB_INVALID_FIELD;
+    case ESB_MISSING_FIELD:
+      return ESB_SUCCESS;
+    default:
+      return error;
+  }
+}
+
+CidrMapEntity::CidrMapEntity(ESB::Allocator &allocator, ESB::UniqueId &id, Type type, ESB::EmbeddedList *ruleMap,
+                             ESB::UInt32 size)
+    : Entity(allocator, id), _type(type), _size(size), _ruleMap(ruleMap), _defaultRules(), _table(allocator) {}
+
+CidrMapEntity::~CidrMapEntity() {
+  for (ESB::UInt32 i = 0; i < _size; ++i) {
+    _ruleMap[i].clear();
+    _ruleMap[i].~EmbeddedList();
+  }
+
+  if (_ruleMap) {
+    _allocator.deallocate(_ruleMap);
+    _ruleMap = NULL;
+  }
+
+  _defaultRules.clear();
+}
+
+Entity::Type CidrMapEntity::type() const { return _type; }
+
+ESB::Error CidrMapEntity::Build(const ESB::AST::Map &map, ESB::Allocator &allocator, ESB::UniqueId &id, Type type,
+                                Entity **entity) {
+  ESB::Error error = CheckField(map, "attribute", "PEER_ADDRESS");
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  error = CheckField(map, "component", "IP_ADDRESS");
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  const ESB::AST::Map *blocks = NULL;
+  error = map.find("rule_map", &blocks);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  const ESB::AST::List *defaultRules = NULL;
+  switch (error = map.find("default_rules", &defaultRules)) {
+    case ESB_SUCCESS:
+    case ESB_MISSING_FIELD:
+      break;
+    default:
+      return error;
+  }
+
+  const ESB::UInt32 size = blocks->size();
+  ESB::EmbeddedList *ruleMap = NULL;
+
+  if (0U < size) {
+    error = allocator.allocate(size * sizeof(ESB::EmbeddedList), (void **)&ruleMap);
+    if (ESB_SUCCESS != error) {
+      return error;
+    }
+
+    for (ESB::UInt32 i = 0; i < size; ++i) {
+      new (ruleMap + i) ESB::EmbeddedList();
+    }
+  }
+
+  CidrMapEntity *cidrMap = new (allocator) CidrMapEntity(allocator, id, type, ruleMap, size);
+  if (!cidrMap) {
+    for (ESB::UInt32 i = 0; i < size; ++i) {
+      ruleMap[i].~EmbeddedList();
+    }
+    if (ruleMap) {
+      allocator.deallocate(ruleMap);
+    }
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  // The iterator does not modify the map
+  ESB::UInt32 i = 0U;
+  for (ESB::AST::MapIterator it = ((ESB::AST::Map *)blocks)->iterator(); !it.isNull(); ++it, ++i) {
+    const ESB::AST::Scalar *key = it.key();
+    const ESB::AST::Element *value = it.value();
+
+    if (ESB::AST::Element::STRING != key->type() || !value || ESB::AST::Element::LIST != value->type()) {
+      cidrMap->cleanupHandler()->destroy(cidrMap);
+      return ESB_INVALID_FIELD;
+    }
+
+    error = cidrMap->_table.insert(((const ESB::AST::String *)key)->value(), i);
+    if (ESB_SUCCESS == error) {
+      error = ParseRules(*(const ESB::AST::List *)value, allocator, ruleMap[i]);
+    } else if (ESB_CANNOT_PARSE == error) {
+      error = ESB_INVALID_FIELD;
+    }
+
+    if (ESB_SUCCESS != error) {
+      cidrMap->cleanupHandler()->destroy(cidrMap);
+      return error;
+    }
+  }
+
+  if (defaultRules) {
+    error = ParseRules(*defaultRules, allocator, cidrMap->_defaultRules);
+    if (ESB_SUCCESS != error) {
+      cidrMap->cleanupHandler()->destroy(cidrMap);
+      return error;
+    }
+  }
+
+  error = cidrMap->_table.build();
+  if (ESB_SUCCESS != error) {
+    cidrMap->cleanupHandler()->destroy(cidrMap);
+    return error;
+  }
+
+  *entity = cidrMap;
+  return ESB_SUCCESS;
+}
+
+// Must be in same order as LimitEntity::KeyType
+static const char *KeyTypeStrings[] = {"NONE", "IP_ADDRESS", "STRING"};
+
+LimitEntity::LimitEntity(ESB::Allocator &allocator, ESB::UniqueId &id, KeyType keyType)
+    : Entity(allocator, id), _keyType(keyType) {}
+
+LimitEntity::~LimitEntity() {}
+
+ESB::Error LimitEntity::ParseKeyType(const ESB::AST::Map &map, KeyType *keyType) {
+  const char *str = NULL;
+  ESB::Error error = map.find("key", &str);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  for (int i = 0; i < sizeof(KeyTypeStrings) / sizeof(char *); ++i) {
+    if (0 == strcasecmp(str, KeyTypeStrings[i])) {
+      *keyType = (KeyType)i;
+      return ESB_SUCCESS;
+    }
+  }
+
+  return ESB_INVALID_FIELD;
+}
+
+// Parses { value: 100, unit: MILLISECOND }
+static ESB::Error ParseWindow(const ESB::AST::Map &map, ESB::UInt64 *microSeconds) {
+  const ESB::AST::Map *time = NULL;
+  ESB::Error error = map.find("time", &time);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  ESB::UInt32 value = 0;
+  error = time->find("value", &value);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  const char *unit = NULL;
+  error = time->find("unit", &unit);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  ESB::UInt64 multiplier = 0;
+  if (0 == strcasecmp(unit, "MILLISECOND")) {
+    multiplier = ESB_UINT64_C(1000);
+  } else if (0 == strcasecmp(unit, "SECOND")) {
+    multiplier = ESB_UINT64_C(1000000);
+  } else if (0 == strcasecmp(unit, "MINUTE")) {
+    multiplier = ESB_UINT64_C(60000000);
+  } else if (0 == strcasecmp(unit, "HOUR")) {
+    multiplier = ESB_UINT64_C(3600000000);
+  } else {
+    return ESB_INVALID_FIELD;
+  }
+
+  if (0 == value) {
+    return ESB_INVALID_FIELD;
+  }
+
+  *microSeconds = value * multiplier;
+  return ESB_SUCCESS;
+}
+
+RateLimitEntity::RateLimitEntity(ESB::Allocator &allocator, ESB::UniqueId &id, KeyType keyType, ESB::UInt32 limit,
+                                 ESB::UInt64 windowMicroSeconds, ESB::UInt32 maxKeys, ESB::UInt32 shards)
+    : LimitEntity(allocator, id, keyType),
+      _windowMicroSeconds(windowMicroSeconds),
+      _limiter(limit, windowMicroSeconds, maxKeys, shards, allocator) {}
+
+RateLimitEntity::~RateLimitEntity() {}
+
+Entity::Type RateLimitEntity::type() const { return RATE_LIMIT; }
+
+ESB::Error RateLimitEntity::Build(const ESB::AST::Map &map, ESB::Allocator &allocator, ESB::UniqueId &id,
+                                  Entity **entity) {
+  KeyType keyType = KEY_NONE;
+  ESB::Error error = ParseKeyType(map, &keyType);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  if (KEY_STRING == keyType) {
+    return ESB_NOT_IMPLEMENTED;
+  }
+
+  ESB::UInt32 limit = 0;
+  error = map.find("limit", &limit);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  ESB::UInt64 windowMicroSeconds = 0;
+  error = ParseWindow(map, &windowMicroSeconds);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  // Without a key there is only ever one bucket
+  ESB::UInt32 maxKeys = KEY_NONE == keyType ? 1U : ES_RATE_LIMIT_MAX_KEYS;
+  error = map.find("max_keys", &maxKeys, true);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  ESB::UInt32 shards = KEY_NONE == keyType ? 1U : (ESB::UInt32)MAX(sysconf(_SC_NPROCESSORS_ONLN), 1L);
+  error = map.find("shards", &shards, true);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  RateLimitEntity *rateLimit =
+      new (allocator) RateLimitEntity(allocator, id, keyType, limit, windowMicroSeconds, maxKeys, shards);
+  if (!rateLimit) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  if (0U == rateLimit->_limiter.capacity()) {
+    rateLimit->cleanupHandler()->destroy(rateLimit);
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  *entity = rateLimit;
+  return ESB_SUCCESS;
+}
+
+ESB::Error RateLimitEntity::acquire(const ESB::SocketAddress *address, ESB::UInt32 slots, const ESB::Date &now) {
+  ESB::UInt64 key = 0U;
+
+  if (KEY_IP_ADDRESS == _keyType) {
+    if (!address) {
+      return ESB_NULL_POINTER;
+    }
+    key = address->primitiveAddress()->sin_addr.s_addr;
+  }
+
+  return _limiter.acquire(key, slots, now);
+}
+
+MaxLimitEntity::MaxLimitEntity(ESB::Allocator &allocator, ESB::UniqueId &id, KeyType keyType, ESB::UInt32 limit,
+                               ESB::SlotCounter *counter, ESB::KeyedSlotCounter *keyedCounter)
+    : LimitEntity(allocator, id, keyType), _limit(limit), _counter(counter), _keyedCounter(keyedCounter) {}
+
+MaxLimitEntity::~MaxLimitEntity() {
+  if (_counter) {
+    _counter->~SlotCounter();
+    _allocator.deallocate(_counter);
+    _counter = NULL;
+  }
+
+  if (_keyedCounter) {
+    _keyedCounter->~KeyedSlotCounter();
+    _allocator.deallocate(_keyedCounter);
+    _keyedCounter = NULL;
+  }
+}
+
+Entity::Type MaxLimitEntity::type() const { return MAX_LIMIT; }
+
+ESB::Error MaxLimitEntity::Build(const ESB::AST::Map &map, ESB::Allocator &allocator, ESB::UniqueId &id,
+                                 Entity **entity) {
+  KeyType keyType = KEY_NONE;
+  ESB::Error error = ParseKeyType(map, &keyType);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  if (KEY_STRING == keyType) {
+    return ESB_NOT_IMPLEMENTED;
+  }
+
+  ESB::UInt32 limit = 0;
+  error = map.find("limit", &limit);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  bool strict = false;
+  error = map.find("strict", &strict, true);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  ESB::UInt32 maxKeys = ES_MAX_LIMIT_MAX_KEYS;
+  error = map.find("max_keys", &maxKeys, true);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  ESB::UInt32 shards = (ESB::UInt32)MAX(sysconf(_SC_NPROCESSORS_ONLN), 1L);
+  error = map.find("shards", &shards, true);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  ESB::SlotCounter *counter = NULL;
+  ESB::KeyedSlotCounter *keyedCounter = NULL;
+
+  if (KEY_NONE == keyType) {
+    counter = new (allocator) ESB::SlotCounter(limit, shards, strict, allocator);
+    if (!counter) {
+      return ESB_OUT_OF_MEMORY;
+    }
+    if (0U == counter->shards()) {
+      counter->~SlotCounter();
+      allocator.deallocate(counter);
+      return ESB_OUT_OF_MEMORY;
+    }
+  } else {
+    keyedCounter = new (allocator) ESB::KeyedSlotCounter(limit, maxKeys, allocator);
+    if (!keyedCounter) {
+      return ESB_OUT_OF_MEMORY;
+    }
+    if (0U == keyedCounter->capacity()) {
+      keyedCounter->~KeyedSlotCounter();
+      allocator.deallocate(keyedCounter);
+      return ESB_OUT_OF_MEMORY;
+    }
+  }
+
+  // The entity owns the counter from here on
+  MaxLimitEntity *maxLimit = new (allocator) MaxLimitEntity(allocator, id, keyType, limit, counter, keyedCounter);
+  if (!maxLimit) {
+    if (counter) {
+      counter->~SlotCounter();
+      allocator.deallocate(counter);
+    }
+    if (keyedCounter) {
+      keyedCounter->~KeyedSlotCounter();
+      allocator.deallocate(keyedCounter);
+    }
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  *entity = maxLimit;
+  return ESB_SUCCESS;
+}
+
+ESB::Error MaxLimitEntity::acquire(const ESB::SocketAddress *address, ESB::UInt32 slots, bool *tracked) {
+  if (tracked) {
+    *tracked = true;
+  }
+
+  if (_counter) {
+    return _counter->acquire(slots);
+  }
+
+  if (!address) {
+    return ESB_NULL_POINTER;
+  }
+
+  return _keyedCounter->acquire(address->primitiveAddress()->sin_addr.s_addr, slots, tracked);
+}
+
+void MaxLimitEntity::release(const ESB::SocketAddress *address, ESB::UInt32 slots) {
+  if (_counter) {
+    _counter->release(slots);
+  } else if (address) {
+    _keyedCounter->release(address->primitiveAddress()->sin_addr.s_addr, slots);
+  }
+}
+
+ESB::UInt32 MaxLimitEntity::inUse(const ESB::SocketAddress *address) const {
+  if (_counter) {
+    return _counter->inUse();
+  }
+
+  return address ? _keyedCounter->inUse(address->primitiveAddress()->sin_addr.s_addr) : 0U;
+}
+
+TopNLimitEntity::TopNLimitEntity(ESB::Allocator &allocator, ESB::UniqueId &id, KeyType keyType, ESB::UInt32 n,
+                                 ESB::UInt32 threshold, ESB::UInt64 windowMicroSeconds, ESB::UInt32 shards)
+    : LimitEntity(allocator, id, keyType),
+      _windowMicroSeconds(windowMicroSeconds),
+      _limiter(n, threshold, windowMicroSeconds, shards, allocator) {}
+
+TopNLimitEntity::~TopNLimitEntity() {}
+
+Entity::Type TopNLimitEntity::type() const { return TOP_N_LIMIT; }
+
+ESB::Error TopNLimitEntity::Build(const ESB::AST::Map &map, ESB::Allocator &allocator, ESB::UniqueId &id,
+                                  Entity **entity) {
+  KeyType keyType = KEY_NONE;
+  ESB::Error error = ParseKeyType(map, &keyType);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  // With one key there is nothing to rank
+  if (KEY_NONE == keyType) {
+    return ESB_INVALID_FIELD;
+  }
+
+  if (KEY_STRING == keyType) {
+    return ESB_NOT_IMPLEMENTED;
+  }
+
+  ESB::UInt32 n = 0;
+  error = map.find("n", &n);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  if (0U == n) {
+    return ESB_INVALID_FIELD;
+  }
+
+  ESB::UInt32 threshold = 0;
+  error = map.find("threshold", &threshold);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  ESB::UInt64 windowMicroSeconds = ES_TOP_N_LIMIT_WINDOW_MICROSECONDS;
+  if (map.find("time")) {
+    error = ParseWindow(map, &windowMicroSeconds);
+    if (ESB_SUCCESS != error) {
+      return error;
+    }
+  }
+
+  ESB::UInt32 shards = (ESB::UInt32)MAX(sysconf(_SC_NPROCESSORS_ONLN), 1L);
+  error = map.find("shards", &shards, true);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  TopNLimitEntity *topNLimit =
+      new (allocator) TopNLimitEntity(allocator, id, keyType, n, threshold, windowMicroSeconds, shards);
+  if (!topNLimit) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  if (0U == topNLimit->_limiter.shards()) {
+    topNLimit->cleanupHandler()->destroy(topNLimit);
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  *entity = topNLimit;
+  return ESB_SUCCESS;
+}
+
+ESB::Error TopNLimitEntity::acquire(const ESB::SocketAddress *address, ESB::UInt32 slots, const ESB::Date &now) {
+  if (!address) {
+    return ESB_NULL_POINTER;
+  }
+
+  return _limiter.acquire(address->primitiveAddress()->sin_addr.s_addr, slots, now);
+}
+
 }  // namespace ES
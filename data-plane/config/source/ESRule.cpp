@@ -2,12 +2,92 @@
 #include <ESRule.h>
 #endif
 
+#ifndef ES_CONDITION_H
+#include <ESCondition.h>
+#endif
+
+#ifndef ES_ACTION_H
+#include <ESAction.h>
+#endif
+
 namespace ES {
 
 Rule::Rule(ESB::Allocator &allocator) : _allocator(allocator) {}
 
-Rule::~Rule() {}
+Rule::~Rule() {
+  _conditions.clear();
+  _actions.clear();
+}
 
 ESB::CleanupHandler *Rule::cleanupHandler() { return &_allocator.cleanupHandler(); }
 
+ESB::Error Rule::Build(const ESB::AST::Map &map, ESB::Allocator &allocator, Rule **rule) {
+  if (!rule) {
+    return ESB_NULL_POINTER;
+  }
+
+  const ESB::AST::List *conditions = NULL;
+  ESB::Error error = map.find("conditions", &conditions);
+  switch (error) {
+    case ESB_SUCCESS:
+    case ESB_MISSING_FIELD:
+      break;
+    default:
+      return error;
+  }
+
+  const ESB::AST::List *actions = NULL;
+  error = map.find("actions", &actions);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  Rule *newRule = new (allocator) Rule(allocator);
+  if (!newRule) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  if (conditions) {
+    for (const ESB::AST::Element *current = conditions->first(); current;
+         current = (const ESB::AST::Element *)current->next()) {
+      if (ESB::AST::Element::MAP != current->type()) {
+        error = ESB_INVALID_FIELD;
+        break;
+      }
+
+      Condition *condition = NULL;
+      error = Condition::Build(*(const ESB::AST::Map *)current, allocator, &condition);
+      if (ESB_SUCCESS != error) {
+        break;
+      }
+      newRule->_conditions.addLast(condition);
+    }
+  }
+
+  if (ESB_SUCCESS == error) {
+    for (const ESB::AST::Element *current = actions->first(); current;
+         current = (const ESB::AST::Element *)current->next()) {
+      if (ESB::AST::Element::MAP != current->type()) {
+        error = ESB_INVALID_FIELD;
+        break;
+      }
+
+      Action *action = NULL;
+      error = Action::Build(*(const ESB::AST::Map *)current, allocator, &action);
+      if (ESB_SUCCESS != error) {
+        break;
+      }
+      newRule->_actions.addLast(action);
+    }
+  }
+
+  if (ESB_SUCCESS != error) {
+    newRule->cleanupHandler()->destroy(newRule);
+    return error;
+  }
+
+  *rule = newRule;
+  return ESB_SUCCESS;
+}
+
 }  // namespace ES
@@ -0,0 +1,679 @@
+#ifndef ES_RULE_GRAPH_H
+#include <ESRuleGraph.h>
+#endif
+
+#ifndef ES_RULE_H
+#include <ESRule.h>
+#endif
+
+#ifndef ES_CONDITION_H
+#include <ESCondition.h>
+#endif
+
+#ifndef ESB_CONFIG_H
+#include <ESBConfig.h>
+#endif
+
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#define ES_RULE_GRAPH_MAX_MARKS 64U
+#define ES_RULE_GRAPH_MAX_KEYED_LIMITS 64U
+
+namespace ES {
+
+static bool IsRuleList(Entity::Type type) {
+  switch (type) {
+    case Entity::INBOUND_CONNECTION_RULE_LIST:
+    case Entity::INBOUND_CONNECTION_CLEANUP:
+    case Entity::INBOUND_REQUEST_RULE_LIST:
+    case Entity::INBOUND_REQUEST_CLEANUP:
+    case Entity::OUTBOUND_CONNECTION_RULE_LIST:
+    case Entity::OUTBOUND_CONNECTION_CLEANUP:
+    case Entity::OUTBOUND_REQUEST_RULE_LIST:
+    case Entity::OUTBOUND_REQUEST_CLEANUP:
+    case Entity::OUTBOUND_RESPONSE_RULE_LIST:
+    case Entity::OUTBOUND_RESPONSE_CLEANUP:
+    case Entity::INBOUND_RESPONSE_RULE_LIST:
+    case Entity::INBOUND_RESPONSE_CLEANUP:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static bool IsCidrMap(Entity::Type type) {
+  return Entity::INBOUND_CONNECTION_CIDR_MAP == type || Entity::OUTBOUND_CONNECTION_CIDR_MAP == type;
+}
+
+// A rule list has one list of rules.  A CIDR map has one per block followed by its default rules.
+static ESB::UInt32 NumRuleLists(const Entity *node) {
+  return IsCidrMap(node->type()) ? ((const CidrMapEntity *)node)->size() + 1U : 1U;
+}
+
+static const ESB::EmbeddedList &RuleList(const Entity *node, ESB::UInt32 i) {
+  if (!IsCidrMap(node->type())) {
+    return ((const RuleListEntity *)node)->rules();
+  }
+  const CidrMapEntity *cidrMap = (const CidrMapEntity *)node;
+  return i < cidrMap->size() ? cidrMap->rules(i) : cidrMap->defaultRules();
+}
+
+static int CompareIds(const void *a, const void *b) {
+  return (*(const Entity **)a)->id().compare((*(const Entity **)b)->id());
+}
+
+// Returns numLists if there is no rule list or CIDR map with that id
+static ESB::UInt32 FindList(const Entity **lists, ESB::UInt32 numLists, const ESB::UniqueId &id) {
+  ESB::UInt32 low = 0U;
+  ESB::UInt32 high = numLists;
+
+  while (low < high) {
+    const ESB::UInt32 mid = low + (high - low) / 2U;
+    const int result = id.compare(lists[mid]->id());
+    if (0 == result) {
+      return mid;
+    }
+    if (0 > result) {
+      high = mid;
+    } else {
+      low = mid + 1U;
+    }
+  }
+
+  return numLists;
+}
+
+// Returns NULL if there is no entity with that id
+static Entity *FindEntity(Entity *const *entities, ESB::UInt32 numEntities, const ESB::UniqueId &id) {
+  for (ESB::UInt32 i = 0U; i < numEntities; ++i) {
+    if (entities[i]->id() == id) {
+      return entities[i];
+    }
+  }
+  return NULL;
+}
+
+static bool IsLimit(const Entity *entity) {
+  switch (entity->type()) {
+    case Entity::MAX_LIMIT:
+    case Entity::RATE_LIMIT:
+    case Entity::TOP_N_LIMIT:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static ESB::Error InternMark(const char *mark, const char **marks, ESB::UInt32 *numMarks, ESB::UInt64 *bit) {
+  for (ESB::UInt32 i = 0U; i < *numMarks; ++i) {
+    if (0 == strcmp(mark, marks[i])) {
+      *bit = ESB_UINT64_C(1) << i;
+      return ESB_SUCCESS;
+    }
+  }
+
+  if (ES_RULE_GRAPH_MAX_MARKS <= *numMarks) {
+    return ESB_OVERFLOW;
+  }
+
+  marks[*numMarks] = mark;
+  *bit = ESB_UINT64_C(1) << *numMarks;
+  ++*numMarks;
+  return ESB_SUCCESS;
+}
+
+// Per key max limits get a bit so a context can remember which of them did not count its slots.  Other limits never
+// leave slots uncounted and get 0.
+static ESB::Error InternLimit(const Entity *limit, const Entity **limits, ESB::UInt32 *numLimits, ESB::UInt64 *bit) {
+  *bit = 0U;
+  if (Entity::MAX_LIMIT != limit->type() || LimitEntity::KEY_NONE == ((const LimitEntity *)limit)->keyType()) {
+    return ESB_SUCCESS;
+  }
+
+  for (ESB::UInt32 i = 0U; i < *numLimits; ++i) {
+    if (limit == limits[i]) {
+      *bit = ESB_UINT64_C(1) << i;
+      return ESB_SUCCESS;
+    }
+  }
+
+  if (ES_RULE_GRAPH_MAX_KEYED_LIMITS <= *numLimits) {
+    return ESB_OVERFLOW;
+  }
+
+  limits[*numLimits] = limit;
+  *bit = ESB_UINT64_C(1) << *numLimits;
+  ++*numLimits;
+  return ESB_SUCCESS;
+}
+
+RuleGraph::RuleGraph(ESB::Allocator &allocator)
+    : _numNodes(0U),
+      _numRules(0U),
+      _numConditions(0U),
+      _numActions(0U),
+      _nodes(NULL),
+      _rules(NULL),
+      _conditions(NULL),
+      _actions(NULL),
+      _byId(NULL),
+      _blocks(NULL),
+      _allocator(allocator) {}
+
+RuleGraph::~RuleGraph() { clear(); }
+
+void RuleGraph::clear() {
+  if (_nodes) {
+    _allocator.deallocate(_nodes);
+  }
+
+  _numNodes = 0U;
+  _numRules = 0U;
+  _numConditions = 0U;
+  _numActions = 0U;
+  _nodes = NULL;
+  _rules = NULL;
+  _conditions = NULL;
+  _actions = NULL;
+  _byId = NULL;
+  _blocks = NULL;
+}
+
+ESB::Error RuleGraph::compile(Entity *const *entities, ESB::UInt32 numEntities) {
+  if (!entities && 0U < numEntities) {
+    return ESB_NULL_POINTER;
+  }
+
+  clear();
+
+  ESB::UInt32 numLists = 0U;
+  for (ESB::UInt32 i = 0U; i < numEntities; ++i) {
+    if (IsRuleList(entities[i]->type()) || IsCidrMap(entities[i]->type())) {
+      ++numLists;
+    }
+  }
+
+  if (0U == numLists) {
+    return ESB_SUCCESS;
+  }
+
+  const Entity **lists = NULL;
+  ESB::Error error = _allocator.allocate(numLists * sizeof(Entity *), (void **)&lists);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  for (ESB::UInt32 i = 0U, j = 0U; i < numEntities; ++i) {
+    if (IsRuleList(entities[i]->type()) || IsCidrMap(entities[i]->type())) {
+      lists[j++] = entities[i];
+    }
+  }
+
+  qsort(lists, numLists, sizeof(Entity *), CompareIds);
+
+  for (ESB::UInt32 i = 1U; i < numLists; ++i) {
+    if (lists[i - 1]->id() == lists[i]->id()) {
+      _allocator.deallocate(lists);
+      return ESB_UNIQUENESS_VIOLATION;
+    }
+  }
+
+  error = compileLists(entities, numEntities, lists, numLists);
+  _allocator.deallocate(lists);
+  if (ESB_SUCCESS != error) {
+    clear();
+  }
+  return error;
+}
+
+ESB::Error RuleGraph::compileLists(Entity *const *entities, ESB::UInt32 numEntities, const Entity **lists,
+                                   ESB::UInt32 numLists) {
+  const char *marks[ES_RULE_GRAPH_MAX_MARKS];
+  ESB::UInt32 numMarks = 0U;
+  const Entity *limits[ES_RULE_GRAPH_MAX_KEYED_LIMITS];
+  ESB::UInt32 numLimits = 0U;
+  ESB::UInt32 numTransitions = 0U;
+  ESB::UInt32 numBlocks = 0U;
+  ESB::UInt64 bit = 0U;
+  ESB::Error error = ESB_SUCCESS;
+
+  // Validate everything and size the arrays before allocating them
+
+  for (ESB::UInt32 i = 0U; i < numLists; ++i) {
+    if (IsCidrMap(lists[i]->type())) {
+      numBlocks += NumRuleLists(lists[i]);
+    }
+
+    for (ESB::UInt32 l = 0U; l < NumRuleLists(lists[i]); ++l) {
+      for (const Rule *rule = (const Rule *)RuleList(lists[i], l).first(); rule; rule = (const Rule *)rule->next()) {
+        ++_numRules;
+
+        for (const Condition *condition = (const Condition *)rule->conditions().first(); condition;
+             condition = (const Condition *)condition->next()) {
+          ++_numConditions;
+
+          switch (condition->type()) {
+            case Condition::MARK_MATCH: {
+              const MarkCondition *mark = (const MarkCondition *)condition;
+              for (ESB::UInt32 j = 0U; j < mark->numMarks(); ++j) {
+                error = InternMark(mark->marks()[j], marks, &numMarks, &bit);
+                if (ESB_SUCCESS != error) {
+                  return error;
+                }
+              }
+            } break;
+            case Condition::ACQUIRE_SLOT: {
+              const Entity *limit =
+                  FindEntity(entities, numEntities, ((const AcquireSlotCondition *)condition)->limit());
+              if (!limit) {
+                return ESB_CANNOT_FIND;
+              }
+              if (!IsLimit(limit)) {
+                return ESB_NOT_IMPLEMENTED;
+              }
+              error = InternLimit(limit, limits, &numLimits, &bit);
+              if (ESB_SUCCESS != error) {
+                return error;
+              }
+            } break;
+            default:
+              return ESB_NOT_IMPLEMENTED;
+          }
+        }
+
+        for (const Action *action = (const Action *)rule->actions().first(); action;
+             action = (const Action *)action->next()) {
+          ++_numActions;
+
+          switch (action->type()) {
+            case Action::SEND_RESPONSE:
+            case Action::CLOSE_CONNECTION:
+              break;
+            case Action::RELEASE_SLOT: {
+              const Entity *limit = FindEntity(entities, numEntities, ((const ReleaseSlotAction *)action)->limit());
+              if (!limit) {
+                return ESB_CANNOT_FIND;
+              }
+              if (!IsLimit(limit)) {
+                return ESB_NOT_IMPLEMENTED;
+              }
+              error = InternLimit(limit, limits, &numLimits, &bit);
+              if (ESB_SUCCESS != error) {
+                return error;
+              }
+            } break;
+            case Action::MARK:
+              error = InternMark(((const MarkAction *)action)->mark(), marks, &numMarks, &bit);
+              if (ESB_SUCCESS != error) {
+                return error;
+              }
+              break;
+            case Action::TRANSITION: {
+              const ESB::UniqueId &destination = ((const TransitionAction *)action)->destination();
+              if (numLists <= FindList(lists, numLists, destination)) {
+                for (ESB::UInt32 j = 0U; j < numEntities; ++j) {
+                  if (entities[j]->id() == destination) {
+                    return ESB_NOT_IMPLEMENTED;
+                  }
+                }
+                return ESB_CANNOT_FIND;
+              }
+              ++numTransitions;
+            } break;
+            default:
+              return ESB_NOT_IMPLEMENTED;
+          }
+        }
+      }
+    }
+  }
+
+  // edge offsets (numLists + 1), edge targets (numTransitions), in-degrees, topological order and ranks (numLists each)
+  ESB::UInt32 *scratch = NULL;
+  error = _allocator.allocate((numLists * 4U + 1U + numTransitions) * sizeof(ESB::UInt32), (void **)&scratch);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  error = layout(entities, numEntities, lists, numLists, numTransitions, numBlocks, marks, numMarks, scratch);
+  _allocator.deallocate(scratch);
+  return error;
+}
+
+ESB::Error RuleGraph::layout(Entity *const *entities, ESB::UInt32 numEntities, const Entity **lists,
+                             ESB::UInt32 numLists, ESB::UInt32 numTransitions, ESB::UInt32 numBlocks,
+                             const char **marks, ESB::UInt32 numMarks, ESB::UInt32 *scratch) {
+  ESB::UInt32 *edgeStart = scratch;
+  ESB::UInt32 *targets = edgeStart + numLists + 1U;
+  ESB::UInt32 *inDegree = targets + numTransitions;
+  ESB::UInt32 *order = inDegree + numLists;
+  ESB::UInt32 *rank = order + numLists;
+
+  memset(inDegree, 0, numLists * sizeof(ESB::UInt32));
+
+  for (ESB::UInt32 i = 0U, edge = 0U; i < numLists; ++i) {
+    edgeStart[i] = edge;
+    for (ESB::UInt32 l = 0U; l < NumRuleLists(lists[i]); ++l) {
+      for (const Rule *rule = (const Rule *)RuleList(lists[i], l).first(); rule; rule = (const Rule *)rule->next()) {
+        for (const Action *action = (const Action *)rule->actions().first(); action;
+             action = (const Action *)action->next()) {
+          if (Action::TRANSITION == action->type()) {
+            targets[edge] = FindList(lists, numLists, ((const TransitionAction *)action)->destination());
+            ++inDegree[targets[edge]];
+            ++edge;
+          }
+        }
+      }
+    }
+    edgeStart[i + 1] = edge;
+  }
+
+  // Kahn's algorithm.  Nodes that no transition reaches come first, and a node left over is on a cycle.
+
+  ESB::UInt32 tail = 0U;
+  for (ESB::UInt32 i = 0U; i < numLists; ++i) {
+    if (0U == inDegree[i]) {
+      order[tail++] = i;
+    }
+  }
+
+  for (ESB::UInt32 head = 0U; head < tail; ++head) {
+    const ESB::UInt32 i = order[head];
+    rank[i] = head;
+    for (ESB::UInt32 edge = edgeStart[i]; edge < edgeStart[i + 1]; ++edge) {
+      if (0U == --inDegree[targets[edge]]) {
+        order[tail++] = targets[edge];
+      }
+    }
+  }
+
+  if (tail < numLists) {
+    return ESB_INVALID_ARGUMENT;
+  }
+
+  // Every array holds types whose alignment divides sizeof(Node), so they can share one allocation in this order
+  const ESB::Size nodesSize = numLists * sizeof(Node);
+  const ESB::Size rulesSize = _numRules * sizeof(RuleEntry);
+  const ESB::Size conditionsSize = _numConditions * sizeof(ConditionEntry);
+  const ESB::Size actionsSize = _numActions * sizeof(ActionEntry);
+  const ESB::Size byIdSize = numLists * sizeof(ESB::UInt32);
+  const ESB::Size blocksSize = numBlocks * sizeof(ESB::UInt32);
+
+  char *block = NULL;
+  ESB::Error error = _allocator.allocate(nodesSize + rulesSize + conditionsSize + actionsSize + byIdSize + blocksSize,
+                                         (void **)&block);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  _nodes = (Node *)block;
+  _rules = (RuleEntry *)(block + nodesSize);
+  _conditions = (ConditionEntry *)(block + nodesSize + rulesSize);
+  _actions = (ActionEntry *)(block + nodesSize + rulesSize + conditionsSize);
+  _byId = (ESB::UInt32 *)(block + nodesSize + rulesSize + conditionsSize + actionsSize);
+  _blocks = _byId + numLists;
+  _numNodes = numLists;
+
+  ESB::UInt32 ruleIdx = 0U;
+  ESB::UInt32 conditionIdx = 0U;
+  ESB::UInt32 actionIdx = 0U;
+  ESB::UInt32 blockIdx = 0U;
+  ESB::UInt64 bit = 0U;
+  const Entity *limits[ES_RULE_GRAPH_MAX_KEYED_LIMITS];
+  ESB::UInt32 numLimits = 0U;
+
+  for (ESB::UInt32 n = 0U; n < numLists; ++n) {
+    const ESB::UInt32 i = order[n];
+    ESB::UInt32 edge = edgeStart[i];
+    Node &node = _nodes[n];
+    node.firstRule = ruleIdx;
+    node.numRules = 0U;
+    node.firstBlock = blockIdx;
+    node.entity = lists[i];
+    node.cidrMap = IsCidrMap(lists[i]->type()) ? (const CidrMapEntity *)lists[i] : NULL;
+    node.hits = 0U;
+    _byId[i] = n;
+
+    for (ESB::UInt32 l = 0U; l < NumRuleLists(lists[i]); ++l) {
+      if (node.cidrMap) {
+        // The first rule of each block, and after the last block the first default rule
+        _blocks[blockIdx++] = ruleIdx;
+      }
+
+      for (const Rule *rule = (const Rule *)RuleList(lists[i], l).first(); rule; rule = (const Rule *)rule->next()) {
+        RuleEntry &ruleEntry = _rules[ruleIdx++];
+        ruleEntry.firstCondition = conditionIdx;
+        ruleEntry.numConditions = 0U;
+        ruleEntry.firstAction = actionIdx;
+        ruleEntry.numActions = 0U;
+        ruleEntry.hits = 0U;
+        ++node.numRules;
+
+        for (const Condition *condition = (const Condition *)rule->conditions().first(); condition;
+             condition = (const Condition *)condition->next()) {
+          ConditionEntry &conditionEntry = _conditions[conditionIdx++];
+          conditionEntry.type = condition->type();
+          conditionEntry.slots = 0U;
+          conditionEntry.results = 0U;
+          conditionEntry.marks = 0U;
+          conditionEntry.limitType = Entity::UNKNOWN;
+          conditionEntry.limitBit = 0U;
+          conditionEntry.limit = NULL;
+          ++ruleEntry.numConditions;
+
+          switch (condition->type()) {
+            case Condition::MARK_MATCH: {
+              const MarkCondition *mark = (const MarkCondition *)condition;
+              for (ESB::UInt32 j = 0U; j < mark->numMarks(); ++j) {
+                InternMark(mark->marks()[j], marks, &numMarks, &bit);
+                conditionEntry.marks |= bit;
+              }
+            } break;
+            case Condition::ACQUIRE_SLOT: {
+              const AcquireSlotCondition *acquire = (const AcquireSlotCondition *)condition;
+              conditionEntry.slots = acquire->slots();
+              conditionEntry.results = acquire->results();
+              conditionEntry.limit = (LimitEntity *)FindEntity(entities, numEntities, acquire->limit());
+              conditionEntry.limitType = conditionEntry.limit->type();
+              InternLimit(conditionEntry.limit, limits, &numLimits, &conditionEntry.limitBit);
+            } break;
+            default:
+              break;
+          }
+        }
+
+        for (const Action *action = (const Action *)rule->actions().first(); action;
+             action = (const Action *)action->next()) {
+          ActionEntry &actionEntry = _actions[actionIdx++];
+          actionEntry.type = action->type();
+          actionEntry.node = 0U;
+          actionEntry.marks = 0U;
+          actionEntry.slots = 0U;
+          actionEntry.response = NULL;
+          actionEntry.maxLimit = NULL;
+          actionEntry.limitBit = 0U;
+          ++ruleEntry.numActions;
+
+          switch (action->type()) {
+            case Action::SEND_RESPONSE:
+              actionEntry.response = (const SendResponseAction *)action;
+              break;
+            case Action::RELEASE_SLOT: {
+              // Rate and top n limits count slots taken over time, so releasing them does nothing
+              const ReleaseSlotAction *release = (const ReleaseSlotAction *)action;
+              Entity *limit = FindEntity(entities, numEntities, release->limit());
+              if (Entity::MAX_LIMIT == limit->type()) {
+                actionEntry.slots = release->slots();
+                actionEntry.maxLimit = (MaxLimitEntity *)limit;
+                InternLimit(limit, limits, &numLimits, &actionEntry.limitBit);
+              }
+            } break;
+            case Action::MARK:
+              InternMark(((const MarkAction *)action)->mark(), marks, &numMarks, &bit);
+              actionEntry.marks = bit;
+              break;
+            case Action::TRANSITION:
+              actionEntry.node = rank[targets[edge++]];
+              break;
+            default:
+              break;
+          }
+        }
+      }
+    }
+  }
+
+  return ESB_SUCCESS;
+}
+
+ESB::Error RuleGraph::find(const ESB::UniqueId &id, ESB::UInt32 *node) const {
+  if (!node) {
+    return ESB_NULL_POINTER;
+  }
+
+  ESB::UInt32 low = 0U;
+  ESB::UInt32 high = _numNodes;
+
+  while (low < high) {
+    const ESB::UInt32 mid = low + (high - low) / 2U;
+    const int result = id.compare(_nodes[_byId[mid]].entity->id());
+    if (0 == result) {
+      *node = _byId[mid];
+      return ESB_SUCCESS;
+    }
+    if (0 > result) {
+      high = mid;
+    } else {
+      low = mid + 1U;
+    }
+  }
+
+  return ESB_CANNOT_FIND;
+}
+
+RuleGraph::Outcome RuleGraph::execute(ESB::UInt32 node, Context &context) {
+  // Transitions always jump forward, so this terminates
+  while (node < _numNodes) {
+    Node &current = _nodes[node];
+    ESB::UInt32 next = ESB_UINT32_MAX;
+    const ESB::UInt32 lastRule = current.firstRule + current.numRules;
+    ESB::UInt32 r = current.firstRule;
+    Increment(&current.hits);
+
+    if (current.cidrMap) {
+      // Run the longest matching block's rules, then the default rules if none of them transitioned
+      const ESB::UInt32 *blocks = _blocks + current.firstBlock;
+      const ESB::UInt32 defaultRule = blocks[current.cidrMap->size()];
+      ESB::UInt32 block = 0U;
+      if (ESB_SUCCESS == current.cidrMap->find(context._peerAddress, &block)) {
+        for (r = blocks[block]; r < blocks[block + 1] && ESB_UINT32_MAX == next; ++r) {
+          const Outcome outcome = executeRule(r, context, &next);
+          if (NONE != outcome) {
+            return outcome;
+          }
+        }
+      }
+      r = defaultRule;
+    }
+
+    for (; r < lastRule && ESB_UINT32_MAX == next; ++r) {
+      const Outcome outcome = executeRule(r, context, &next);
+      if (NONE != outcome) {
+        return outcome;
+      }
+    }
+
+    if (ESB_UINT32_MAX == next) {
+      return NONE;
+    }
+
+    node = next;
+  }
+
+  return NONE;
+}
+
+RuleGraph::Outcome RuleGraph::executeRule(ESB::UInt32 r, Context &context, ESB::UInt32 *next) {
+  RuleEntry &rule = _rules[r];
+  bool matched = 0U == rule.numConditions;
+
+  for (ESB::UInt32 c = rule.firstCondition, lastCondition = c + rule.numConditions; c < lastCondition && !matched;
+       ++c) {
+    const ConditionEntry &condition = _conditions[c];
+    switch (condition.type) {
+      case Condition::MARK_MATCH:
+        matched = 0U != (context._marks & condition.marks);
+        break;
+      case Condition::ACQUIRE_SLOT: {
+        // If the limit cannot be evaluated, let the transaction through rather than failing closed
+        ESB::Error error = ESB_SUCCESS;
+        switch (condition.limitType) {
+          case Entity::MAX_LIMIT: {
+            bool tracked = true;
+            error = ((MaxLimitEntity *)condition.limit)->acquire(context._peerAddress, condition.slots, &tracked);
+            if (!tracked) {
+              context._untracked |= condition.limitBit;
+            }
+          } break;
+          case Entity::RATE_LIMIT:
+            error = ((RateLimitEntity *)condition.limit)->acquire(context._peerAddress, condition.slots, context._now);
+            break;
+          case Entity::TOP_N_LIMIT:
+            error = ((TopNLimitEntity *)condition.limit)->acquire(context._peerAddress, condition.slots, context._now);
+            break;
+          default:
+            break;
+        }
+        const ESB::UInt32 result =
+            ESB_OVERFLOW == error ? AcquireSlotCondition::NON_CONFORMING : AcquireSlotCondition::CONFORMING;
+        matched = 0U != (condition.results & result);
+      } break;
+      default:
+        break;
+    }
+  }
+
+  if (!matched) {
+    return NONE;
+  }
+
+  Increment(&rule.hits);
+
+  for (ESB::UInt32 a = rule.firstAction, lastAction = a + rule.numActions; a < lastAction && ESB_UINT32_MAX == *next;
+       ++a) {
+    const ActionEntry &action = _actions[a];
+    switch (action.type) {
+      case Action::MARK:
+        context._marks |= action.marks;
+        break;
+      case Action::RELEASE_SLOT:
+        if (context._untracked & action.limitBit) {
+          // The limit never counted this context's slots, so there are none to give back
+          context._untracked &= ~action.limitBit;
+        } else if (action.maxLimit) {
+          action.maxLimit->release(context._peerAddress, action.slots);
+        }
+        break;
+      case Action::TRANSITION:
+        *next = action.node;
+        break;
+      case Action::SEND_RESPONSE:
+        context._response = action.response;
+        return SEND_RESPONSE;
+      case Action::CLOSE_CONNECTION:
+        return CLOSE_CONNECTION;
+      default:
+        break;
+    }
+  }
+
+  return NONE;
+}
+
+}  // namespace ES
@@ -179,4 +179,238 @@ TEST_F(EntityTest, ParseTLSContextIndex3) {
   ASSERT_FALSE(tlsContextIdx->contexts());
 
   entity->cleanupHandler()->destroy(entity);
-}
\ No newline at end of file
+}
+TEST_F(EntityTest, ParseRateLimit) {
+  const char *conf =
+      "            {"
+      "              \"id\": \"" UUID1
+      "\","
+      "              \"type\": \"RATE_LIMIT\","
+      "              \"key\": \"IP_ADDRESS\","
+      "              \"limit\": 42,"
+      "              \"time\": { \"value\": 100, \"unit\": \"MILLISECOND\" },"
+      "              \"max_keys\": 1024,"
+      "              \"shards\": 2"
+      "            }";
+  ESB::AST::Tree tree;
+  ASSERT_EQ(ESB_SUCCESS, parseString(conf, tree));
+  ASSERT_TRUE(tree.root());
+  ASSERT_EQ(tree.root()->type(), ESB::AST::Element::MAP);
+  ESB::AST::Map &map = *(ESB::AST::Map *)tree.root();
+
+  Entity *entity = NULL;
+  ASSERT_EQ(ESB_SUCCESS, Entity::Build(map, ESB::SystemAllocator::Instance(), &entity));
+  ASSERT_TRUE(entity);
+  ASSERT_EQ(_uuid1, entity->id());
+  ASSERT_EQ(Entity::RATE_LIMIT, entity->type());
+
+  RateLimitEntity *rateLimit = (RateLimitEntity *)entity;
+  ASSERT_EQ(LimitEntity::KEY_IP_ADDRESS, rateLimit->keyType());
+  ASSERT_EQ(42, rateLimit->limit());
+  ASSERT_EQ(100000, rateLimit->windowMicroSeconds());
+  ASSERT_EQ(1024, rateLimit->limiter().capacity());
+  ASSERT_EQ(2, rateLimit->limiter().shards());
+
+  ESB::SocketAddress address("10.0.0.1", 80, ESB::SocketAddress::TCP);
+  ESB::SocketAddress other("10.0.0.2", 80, ESB::SocketAddress::TCP);
+  const ESB::Date now(1000, 0);
+  ASSERT_EQ(ESB_SUCCESS, rateLimit->acquire(&address, 42, now));
+  ASSERT_EQ(ESB_OVERFLOW, rateLimit->acquire(&address, 1, now));
+  ASSERT_EQ(ESB_SUCCESS, rateLimit->acquire(&other, 1, now));
+
+  entity->cleanupHandler()->destroy(entity);
+}
+
+TEST_F(EntityTest, ParseMaxLimit) {
+  const char *conf =
+      "            ["
+      "              {"
+      "                \"id\": \"" UUID1
+      "\","
+      "                \"type\": \"MAX_LIMIT\","
+      "                \"key\": \"IP_ADDRESS\","
+      "                \"limit\": 5,"
+      "                \"max_keys\": 1024"
+      "              },"
+      "              {"
+      "                \"id\": \"" UUID2
+      "\","
+      "                \"type\": \"MAX_LIMIT\","
+      "                \"key\": \"NONE\","
+      "                \"limit\": 32768,"
+      "                \"shards\": 4"
+      "              }"
+      "            ]";
+  ESB::AST::Tree tree;
+  ASSERT_EQ(ESB_SUCCESS, parseString(conf, tree));
+  ASSERT_TRUE(tree.root());
+  ASSERT_EQ(tree.root()->type(), ESB::AST::Element::LIST);
+  ESB::AST::List &list = *(ESB::AST::List *)tree.root();
+  ESB::AST::Map *perKey = (ESB::AST::Map *)list.first();
+  ESB::AST::Map *total = (ESB::AST::Map *)list.last();
+
+  Entity *entity = NULL;
+  ASSERT_EQ(ESB_SUCCESS, Entity::Build(*perKey, ESB::SystemAllocator::Instance(), &entity));
+  ASSERT_EQ(_uuid1, entity->id());
+  ASSERT_EQ(Entity::MAX_LIMIT, entity->type());
+
+  MaxLimitEntity *maxLimit = (MaxLimitEntity *)entity;
+  ASSERT_EQ(LimitEntity::KEY_IP_ADDRESS, maxLimit->keyType());
+  ASSERT_EQ(5, maxLimit->limit());
+  ASSERT_TRUE(maxLimit->isStrict());
+
+  ESB::SocketAddress address("10.0.0.1", 80, ESB::SocketAddress::TCP);
+  ESB::SocketAddress other("10.0.0.2", 80, ESB::SocketAddress::TCP);
+  ASSERT_EQ(ESB_SUCCESS, maxLimit->acquire(&address, 5));
+  ASSERT_EQ(ESB_OVERFLOW, maxLimit->acquire(&address, 1));
+  ASSERT_EQ(ESB_SUCCESS, maxLimit->acquire(&other, 1));
+  maxLimit->release(&address, 1);
+  ASSERT_EQ(4, maxLimit->inUse(&address));
+  ASSERT_EQ(ESB_SUCCESS, maxLimit->acquire(&address, 1));
+  ASSERT_EQ(ESB_NULL_POINTER, maxLimit->acquire(NULL, 1));
+
+  entity->cleanupHandler()->destroy(entity);
+
+  ASSERT_EQ(ESB_SUCCESS, Entity::Build(*total, ESB::SystemAllocator::Instance(), &entity));
+  ASSERT_EQ(_uuid2, entity->id());
+  ASSERT_EQ(Entity::MAX_LIMIT, entity->type());
+
+  maxLimit = (MaxLimitEntity *)entity;
+  ASSERT_EQ(LimitEntity::KEY_NONE, maxLimit->keyType());
+  ASSERT_EQ(32768, maxLimit->limit());
+  ASSERT_FALSE(maxLimit->isStrict());
+
+  ASSERT_EQ(ESB_SUCCESS, maxLimit->acquire(&address, 32767));
+  ASSERT_EQ(ESB_SUCCESS, maxLimit->acquire(&other, 1));
+  ASSERT_EQ(ESB_OVERFLOW, maxLimit->acquire(NULL, 1));
+  ASSERT_EQ(32768, maxLimit->inUse(NULL));
+  maxLimit->release(NULL, 32768);
+  ASSERT_EQ(0, maxLimit->inUse(NULL));
+
+  entity->cleanupHandler()->destroy(entity);
+}
+
+TEST_F(EntityTest, ParseTopNLimit) {
+  const char *conf =
+      "            {"
+      "              \"id\": \"" UUID1
+      "\","
+      "              \"type\": \"TOP_N_LIMIT\","
+      "              \"key\": \"IP_ADDRESS\","
+      "              \"n\": 42,"
+      "              \"threshold\": 3,"
+      "              \"time\": { \"value\": 10, \"unit\": \"SECOND\" },"
+      "              \"shards\": 1"
+      "            }";
+  ESB::AST::Tree tree;
+  ASSERT_EQ(ESB_SUCCESS, parseString(conf, tree));
+  ASSERT_TRUE(tree.root());
+  ASSERT_EQ(tree.root()->type(), ESB::AST::Element::MAP);
+  ESB::AST::Map &map = *(ESB::AST::Map *)tree.root();
+
+  Entity *entity = NULL;
+  ASSERT_EQ(ESB_SUCCESS, Entity::Build(map, ESB::SystemAllocator::Instance(), &entity));
+  ASSERT_TRUE(entity);
+  ASSERT_EQ(_uuid1, entity->id());
+  ASSERT_EQ(Entity::TOP_N_LIMIT, entity->type());
+
+  TopNLimitEntity *topNLimit = (TopNLimitEntity *)entity;
+  ASSERT_EQ(LimitEntity::KEY_IP_ADDRESS, topNLimit->keyType());
+  ASSERT_EQ(42, topNLimit->n());
+  ASSERT_EQ(3, topNLimit->threshold());
+  ASSERT_EQ(10000000, topNLimit->windowMicroSeconds());
+  ASSERT_EQ(1, topNLimit->limiter().shards());
+
+  ESB::SocketAddress address("10.0.0.1", 80, ESB::SocketAddress::TCP);
+  ESB::SocketAddress other("10.0.0.2", 80, ESB::SocketAddress::TCP);
+  const ESB::Date now(1000, 0);
+  ASSERT_EQ(ESB_SUCCESS, topNLimit->acquire(&address, 3, now));
+  ASSERT_EQ(ESB_OVERFLOW, topNLimit->acquire(&address, 1, now));
+  ASSERT_EQ(ESB_SUCCESS, topNLimit->acquire(&other, 1, now));
+  ASSERT_EQ(ESB_NULL_POINTER, topNLimit->acquire(NULL, 1, now));
+
+  entity->cleanupHandler()->destroy(entity);
+}
+
+TEST_F(EntityTest, ParseCidrMap) {
+  const char *conf =
+      "            {"
+      "              \"id\": \"" UUID1
+      "\","
+      "              \"type\": \"INBOUND_CONNECTION_CIDR_MAP\","
+      "              \"attribute\": \"PEER_ADDRESS\","
+      "              \"component\": \"IP_ADDRESS\","
+      "              \"rule_map\": {"
+      "                \"10.0.0.0/8\": [ { \"actions\": [ { \"type\": \"TRANSITION\", \"destination\": \"" UUID2
+      "\" } ] } ],"
+      "                \"10.1.0.0/16\": ["
+      "                  { \"actions\": [ { \"type\": \"TRANSITION\", \"destination\": \"" UUID3
+      "\" } ] },"
+      "                  { \"actions\": [ { \"type\": \"TRANSITION\", \"destination\": \"" UUID4
+      "\" } ] }"
+      "                ]"
+      "              },"
+      "              \"default_rules\": [ { \"actions\": [ { \"type\": \"TRANSITION\", \"destination\": \"" UUID5
+      "\" } ] } ]"
+      "            }";
+  ESB::AST::Tree tree;
+  ASSERT_EQ(ESB_SUCCESS, parseString(conf, tree));
+  ASSERT_TRUE(tree.root());
+  ASSERT_EQ(tree.root()->type(), ESB::AST::Element::MAP);
+  ESB::AST::Map &map = *(ESB::AST::Map *)tree.root();
+
+  Entity *entity = NULL;
+  ASSERT_EQ(ESB_SUCCESS, Entity::Build(map, ESB::SystemAllocator::Instance(), &entity));
+  ASSERT_TRUE(entity);
+  ASSERT_EQ(_uuid1, entity->id());
+  ASSERT_EQ(Entity::INBOUND_CONNECTION_CIDR_MAP, entity->type());
+
+  CidrMapEntity *cidrMap = (CidrMapEntity *)entity;
+  ASSERT_EQ(2, cidrMap->size());
+  ASSERT_EQ(1, cidrMap->defaultRules().size());
+
+  ESB::SocketAddress wide("10.2.0.1", 80, ESB::SocketAddress::TCP);
+  ESB::SocketAddress narrow("10.1.255.255", 80, ESB::SocketAddress::TCP);
+  ESB::SocketAddress outside("192.168.0.1", 80, ESB::SocketAddress::TCP);
+
+  const ESB::EmbeddedList *rules = cidrMap->find(&wide);
+  ASSERT_TRUE(rules);
+  ASSERT_EQ(1, rules->size());
+  rules = cidrMap->find(&narrow);
+  ASSERT_TRUE(rules);
+  ASSERT_EQ(2, rules->size());
+  ASSERT_FALSE(cidrMap->find(&outside));
+  ASSERT_FALSE(cidrMap->find(NULL));
+
+  entity->cleanupHandler()->destroy(entity);
+}
+
+TEST_F(EntityTest, ParseBadCidrMap) {
+  const char *malformed =
+      "            {"
+      "              \"id\": \"" UUID1
+      "\","
+      "              \"type\": \"OUTBOUND_CONNECTION_CIDR_MAP\","
+      "              \"rule_map\": { \"10.0.0.0/33\": [] }"
+      "            }";
+  const char *duplicate =
+      "            {"
+      "              \"id\": \"" UUID1
+      "\","
+      "              \"type\": \"OUTBOUND_CONNECTION_CIDR_MAP\","
+      "              \"rule_map\": { \"10.0.0.0/8\": [], \"10.1.2.3/8\": [] }"
+      "            }";
+  const char *confs[] = {malformed, duplicate};
+  const ESB::Error errors[] = {ESB_INVALID_FIELD, ESB_UNIQUENESS_VIOLATION};
+
+  for (int i = 0; i < 2; ++i) {
+    ESB::AST::Tree tree;
+    ASSERT_EQ(ESB_SUCCESS, parseString(confs[i], tree));
+    ASSERT_TRUE(tree.root());
+    ASSERT_EQ(tree.root()->type(), ESB::AST::Element::MAP);
+
+    Entity *entity = NULL;
+    ASSERT_EQ(errors[i], Entity::Build(*(ESB::AST::Map *)tree.root(), ESB::SystemAllocator::Instance(), &entity));
+    ASSERT_FALSE(entity);
+  }
+}
@@ -0,0 +1,562 @@
+#ifndef ES_RULE_GRAPH_H
+#include <ESRuleGraph.h>
+#endif
+
+#ifndef ES_CONFIG_TEST_H
+#include "ESConfigTest.h"
+#endif
+
+#ifndef ESB_AST_LIST_H
+#include <ASTList.h>
+#endif
+
+#include <gtest/gtest.h>
+
+using namespace ES;
+
+#define UUID1 "ec23c29b-605e-4b0b-8bae-a4c4692e6164"
+#define UUID2 "518aa91c-1b06-4364-a0bd-850a04563fa9"
+#define UUID3 "cdad51ab-9f54-4b9a-bbb5-38568f978019"
+#define UUID4 "81607fb3-7453-4372-995a-5e1f1317fd23"
+
+#define MAX_ENTITIES 512
+
+class RuleGraphTest : public ConfigTest {
+ public:
+  RuleGraphTest() : _numEntities(0U) {}
+  virtual ~RuleGraphTest() {}
+
+  virtual void SetUp() {
+    ASSERT_EQ(ESB_SUCCESS, ESB::UniqueId::Parse(UUID1, _uuid1));
+    ASSERT_EQ(ESB_SUCCESS, ESB::UniqueId::Parse(UUID2, _uuid2));
+    ASSERT_EQ(ESB_SUCCESS, ESB::UniqueId::Parse(UUID3, _uuid3));
+  }
+
+  virtual void TearDown() {
+    _graph.clear();
+    for (ESB::UInt32 i = 0; i < _numEntities; ++i) {
+      _entities[i]->cleanupHandler()->destroy(_entities[i]);
+    }
+    _numEntities = 0U;
+  }
+
+ protected:
+  ESB::Error build(const char *conf) {
+    ESB::AST::Tree tree;
+    ESB::Error error = parseString(conf, tree);
+    if (ESB_SUCCESS != error) {
+      return error;
+    }
+
+    if (!tree.root() || ESB::AST::Element::LIST != tree.root()->type()) {
+      return ESB_INVALID_FIELD;
+    }
+
+    for (const ESB::AST::Element *element = ((ESB::AST::List *)tree.root())->first(); element;
+         element = (const ESB::AST::Element *)element->next()) {
+      if (MAX_ENTITIES <= _numEntities || ESB::AST::Element::MAP != element->type()) {
+        return ESB_INVALID_FIELD;
+      }
+      error = Entity::Build(*(const ESB::AST::Map *)element, ESB::SystemAllocator::Instance(),
+                            &_entities[_numEntities]);
+      if (ESB_SUCCESS != error) {
+        return error;
+      }
+      ++_numEntities;
+    }
+
+    return ESB_SUCCESS;
+  }
+
+  ESB::UniqueId _uuid1;
+  ESB::UniqueId _uuid2;
+  ESB::UniqueId _uuid3;
+  RuleGraph _graph;
+  Entity *_entities[MAX_ENTITIES];
+  ESB::UInt32 _numEntities;
+
+  ESB_DISABLE_AUTO_COPY(RuleGraphTest);
+};
+
+static const char *Graph =
+    "["
+    "  {"
+    "    \"id\": \"" UUID1
+    "\","
+    "    \"type\": \"INBOUND_CONNECTION_RULE_LIST\","
+    "    \"rules\": ["
+    "      { \"actions\": [ { \"type\": \"MARK\", \"mark\": \"trusted\" } ] },"
+    "      { \"actions\": [ { \"type\": \"TRANSITION\", \"destination\": \"" UUID2
+    "\" } ] }"
+    "    ]"
+    "  },"
+    "  {"
+    "    \"id\": \"" UUID4
+    "\","
+    "    \"type\": \"TLS_CTX\","
+    "    \"ca_path\": \"/ca.crt\""
+    "  },"
+    "  {"
+    "    \"id\": \"" UUID2
+    "\","
+    "    \"type\": \"INBOUND_REQUEST_RULE_LIST\","
+    "    \"rules\": ["
+    "      {"
+    "        \"conditions\": [ { \"type\": \"MARK_MATCH\", \"values\": [ \"blocked\" ] } ],"
+    "        \"actions\": [ { \"type\": \"SEND_RESPONSE\", \"status_code\": 403, \"reason_phrase\": \"Forbidden\" } ]"
+    "      },"
+    "      {"
+    "        \"conditions\": [ { \"type\": \"MARK_MATCH\", \"values\": [ \"banned\", \"trusted\" ] } ],"
+    "        \"actions\": [ { \"type\": \"TRANSITION\", \"destination\": \"" UUID3
+    "\" } ]"
+    "      }"
+    "    ]"
+    "  },"
+    "  {"
+    "    \"id\": \"" UUID3
+    "\","
+    "    \"type\": \"INBOUND_REQUEST_RULE_LIST\","
+    "    \"rules\": ["
+    "      { \"actions\": [ { \"type\": \"MARK\", \"mark\": \"blocked\" }, { \"type\": \"CLOSE_CONNECTION\" } ] }"
+    "    ]"
+    "  }"
+    "]";
+
+TEST_F(RuleGraphTest, Execute) {
+  ASSERT_EQ(ESB_SUCCESS, build(Graph));
+  ASSERT_EQ(ESB_SUCCESS, _graph.compile(_entities, _numEntities));
+  ASSERT_EQ(3U, _graph.numNodes());
+  ASSERT_EQ(5U, _graph.numRules());
+
+  ESB::UInt32 connection = 0;
+  ESB::UInt32 request = 0;
+  ESB::UInt32 close = 0;
+  ASSERT_EQ(ESB_SUCCESS, _graph.find(_uuid1, &connection));
+  ASSERT_EQ(ESB_SUCCESS, _graph.find(_uuid2, &request));
+  ASSERT_EQ(ESB_SUCCESS, _graph.find(_uuid3, &close));
+  ASSERT_EQ(_uuid2, _graph.entity(request)->id());
+
+  // Transitions always jump forward
+  EXPECT_LT(connection, request);
+  EXPECT_LT(request, close);
+
+  // The connection's mark carries into the request graph and matches the second condition
+  RuleGraph::Context context;
+  EXPECT_EQ(RuleGraph::CLOSE_CONNECTION, _graph.execute(connection, context));
+  EXPECT_EQ(NULL, context.response());
+  EXPECT_EQ(1U, _graph.nodeHits(connection));
+  EXPECT_EQ(1U, _graph.nodeHits(request));
+  EXPECT_EQ(1U, _graph.nodeHits(close));
+  EXPECT_EQ(0U, _graph.ruleHits(_graph.firstRule(request)));
+  EXPECT_EQ(1U, _graph.ruleHits(_graph.firstRule(request) + 1));
+
+  // The last node marked the context blocked, so the next request is refused
+  EXPECT_EQ(RuleGraph::SEND_RESPONSE, _graph.execute(request, context));
+  ASSERT_TRUE(context.response());
+  EXPECT_EQ(403, context.response()->statusCode());
+  EXPECT_EQ(2U, _graph.nodeHits(request));
+  EXPECT_EQ(1U, _graph.ruleHits(_graph.firstRule(request)));
+
+  // Without marks no rule in the request graph fires
+  context.reset();
+  EXPECT_EQ(RuleGraph::NONE, _graph.execute(request, context));
+  EXPECT_EQ(3U, _graph.nodeHits(request));
+  EXPECT_EQ(1U, _graph.nodeHits(close));
+}
+
+TEST_F(RuleGraphTest, MissingDestination) {
+  const char *conf =
+      "[ { \"id\": \"" UUID1
+      "\", \"type\": \"INBOUND_REQUEST_RULE_LIST\","
+      "    \"rules\": [ { \"actions\": [ { \"type\": \"TRANSITION\", \"destination\": \"" UUID2 "\" } ] } ] } ]";
+  ASSERT_EQ(ESB_SUCCESS, build(conf));
+  EXPECT_EQ(ESB_CANNOT_FIND, _graph.compile(_entities, _numEntities));
+  EXPECT_EQ(0U, _graph.numNodes());
+}
+
+TEST_F(RuleGraphTest, Cycle) {
+  const char *conf =
+      "[ { \"id\": \"" UUID1
+      "\", \"type\": \"INBOUND_REQUEST_RULE_LIST\","
+      "    \"rules\": [ { \"actions\": [ { \"type\": \"TRANSITION\", \"destination\": \"" UUID2
+      "\" } ] } ] },"
+      "  { \"id\": \"" UUID2
+      "\", \"type\": \"INBOUND_REQUEST_RULE_LIST\","
+      "    \"rules\": [ { \"actions\": [ { \"type\": \"TRANSITION\", \"destination\": \"" UUID1 "\" } ] } ] } ]";
+  ASSERT_EQ(ESB_SUCCESS, build(conf));
+  EXPECT_EQ(ESB_INVALID_ARGUMENT, _graph.compile(_entities, _numEntities));
+}
+
+TEST_F(RuleGraphTest, DuplicateId) {
+  const char *conf =
+      "[ { \"id\": \"" UUID1
+      "\", \"type\": \"INBOUND_REQUEST_RULE_LIST\","
+      "    \"rules\": [ { \"actions\": [ { \"type\": \"CLOSE_CONNECTION\" } ] } ] },"
+      "  { \"id\": \"" UUID1
+      "\", \"type\": \"INBOUND_REQUEST_CLEANUP\","
+      "    \"rules\": [ { \"actions\": [ { \"type\": \"CLOSE_CONNECTION\" } ] } ] } ]";
+  ASSERT_EQ(ESB_SUCCESS, build(conf));
+  EXPECT_EQ(ESB_UNIQUENESS_VIOLATION, _graph.compile(_entities, _numEntities));
+}
+
+TEST_F(RuleGraphTest, LongChain) {
+  // Declared last to first so compilation has to reorder them
+  const ESB::Size size = MAX_ENTITIES * 512;
+  char *conf = (char *)malloc(size);
+  ASSERT_TRUE(conf);
+  int length = snprintf(conf, size, "[");
+  for (int i = MAX_ENTITIES - 1; i >= 0; --i) {
+    length += snprintf(conf + length, size - length,
+                       "%s{\"id\": \"00000000-0000-0000-0000-%012x\", \"type\": \"INBOUND_REQUEST_RULE_LIST\", "
+                       "\"rules\": [{\"conditions\": [{\"type\": \"MARK_MATCH\", \"values\": [\"never\"]}], "
+                       "\"actions\": [{\"type\": \"CLOSE_CONNECTION\"}]}",
+                       i == MAX_ENTITIES - 1 ? "" : ",", i);
+    if (i < MAX_ENTITIES - 1) {
+      length += snprintf(conf + length, size - length,
+                         ", {\"actions\": [{\"type\": \"TRANSITION\", \"destination\": "
+                         "\"00000000-0000-0000-0000-%012x\"}]}",
+                         i + 1);
+    }
+    length += snprintf(conf + length, size - length, "]}");
+  }
+  snprintf(conf + length, size - length, "]");
+
+  ESB::Error error = build(conf);
+  free(conf);
+  ASSERT_EQ(ESB_SUCCESS, error);
+  ASSERT_EQ(ESB_SUCCESS, _graph.compile(_entities, _numEntities));
+  ASSERT_EQ(MAX_ENTITIES, _graph.numNodes());
+
+  ESB::UniqueId first;
+  ASSERT_EQ(ESB_SUCCESS, ESB::UniqueId::Parse("00000000-0000-0000-0000-000000000000", first));
+  ESB::UInt32 root = MAX_ENTITIES;
+  ASSERT_EQ(ESB_SUCCESS, _graph.find(first, &root));
+  EXPECT_EQ(0U, root);
+
+  RuleGraph::Context context;
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_EQ(RuleGraph::NONE, _graph.execute(root, context));
+  }
+
+  for (ESB::UInt32 i = 0; i < _graph.numNodes(); ++i) {
+    EXPECT_EQ(1000U, _graph.nodeHits(i));
+  }
+}
+
+TEST_F(RuleGraphTest, AcquireSlot) {
+  // Two connections per client per second, the third is closed
+  const char *conf =
+      "[ { \"id\": \"" UUID4
+      "\", \"type\": \"RATE_LIMIT\", \"key\": \"IP_ADDRESS\", \"limit\": 2,"
+      "    \"time\": { \"value\": 1, \"unit\": \"SECOND\" }, \"max_keys\": 64 },"
+      "  { \"id\": \"" UUID1
+      "\", \"type\": \"INBOUND_CONNECTION_RULE_LIST\","
+      "    \"rules\": ["
+      "      { \"conditions\": [ { \"type\": \"ACQUIRE_SLOT\", \"limit\": \"" UUID4
+      "\", \"values\": [ \"NON_CONFORMING\" ] } ],"
+      "        \"actions\": [ { \"type\": \"CLOSE_CONNECTION\" } ] } ] } ]";
+  ASSERT_EQ(ESB_SUCCESS, build(conf));
+  ASSERT_EQ(ESB_SUCCESS, _graph.compile(_entities, _numEntities));
+
+  ESB::UInt32 root = 0;
+  ASSERT_EQ(ESB_SUCCESS, _graph.find(_uuid1, &root));
+
+  ESB::SocketAddress address("10.0.0.1", 443, ESB::SocketAddress::TCP);
+  ESB::SocketAddress other("10.0.0.2", 443, ESB::SocketAddress::TCP);
+  RuleGraph::Context context;
+  context.setPeerAddress(&address);
+  context.setNow(ESB::Date(1000, 0));
+
+  EXPECT_EQ(RuleGraph::NONE, _graph.execute(root, context));
+  EXPECT_EQ(RuleGraph::NONE, _graph.execute(root, context));
+  EXPECT_EQ(RuleGraph::CLOSE_CONNECTION, _graph.execute(root, context));
+
+  context.setPeerAddress(&other);
+  EXPECT_EQ(RuleGraph::NONE, _graph.execute(root, context));
+
+  context.setPeerAddress(&address);
+  context.setNow(ESB::Date(1000, 500000));
+  EXPECT_EQ(RuleGraph::NONE, _graph.execute(root, context));
+  EXPECT_EQ(RuleGraph::CLOSE_CONNECTION, _graph.execute(root, context));
+  EXPECT_EQ(2U, _graph.ruleHits(_graph.firstRule(root)));
+}
+
+TEST_F(RuleGraphTest, ReleaseSlot) {
+  // Two concurrent connections per client.  Cleanup returns the slot of every connection that got one.
+  const char *conf =
+      "[ { \"id\": \"" UUID4
+      "\", \"type\": \"MAX_LIMIT\", \"key\": \"IP_ADDRESS\", \"limit\": 2, \"max_keys\": 64 },"
+      "  { \"id\": \"" UUID1
+      "\", \"type\": \"INBOUND_CONNECTION_RULE_LIST\","
+      "    \"rules\": ["
+      "      { \"conditions\": [ { \"type\": \"ACQUIRE_SLOT\", \"limit\": \"" UUID4
+      "\", \"values\": [ \"NON_CONFORMING\" ] } ],"
+      "        \"actions\": [ { \"type\": \"CLOSE_CONNECTION\" } ] },"
+      "      { \"actions\": [ { \"type\": \"MARK\", \"mark\": \"has_slot\" } ] } ] },"
+      "  { \"id\": \"" UUID2
+      "\", \"type\": \"INBOUND_CONNECTION_CLEANUP\","
+      "    \"rules\": ["
+      "      { \"conditions\": [ { \"type\": \"MARK_MATCH\", \"values\": [ \"has_slot\" ] } ],"
+      "        \"actions\": [ { \"type\": \"RELEASE_SLOT\", \"limit\": \"" UUID4
+      "\", \"slots\": 1 } ] } ] } ]";
+  ASSERT_EQ(ESB_SUCCESS, build(conf));
+  ASSERT_EQ(ESB_SUCCESS, _graph.compile(_entities, _numEntities));
+
+  ESB::UInt32 root = 0;
+  ASSERT_EQ(ESB_SUCCESS, _graph.find(_uuid1, &root));
+  ESB::UInt32 cleanup = 0;
+  ASSERT_EQ(ESB_SUCCESS, _graph.find(_uuid2, &cleanup));
+
+  ESB::SocketAddress address("10.0.0.1", 443, ESB::SocketAddress::TCP);
+  RuleGraph::Context first;
+  RuleGraph::Context second;
+  RuleGraph::Context third;
+  first.setPeerAddress(&address);
+  second.setPeerAddress(&address);
+  third.setPeerAddress(&address);
+
+  EXPECT_EQ(RuleGraph::NONE, _graph.execute(root, first));
+  EXPECT_EQ(RuleGraph::NONE, _graph.execute(root, second));
+  EXPECT_EQ(RuleGraph::CLOSE_CONNECTION, _graph.execute(root, third));
+
+  const MaxLimitEntity *limit = (const MaxLimitEntity *)_entities[0];
+  ASSERT_EQ(Entity::MAX_LIMIT, limit->type());
+  EXPECT_EQ(2U, limit->inUse(&address));
+
+  // The rejected connection had no slot to give back
+  EXPECT_EQ(RuleGraph::NONE, _graph.execute(cleanup, third));
+  EXPECT_EQ(2U, limit->inUse(&address));
+
+  EXPECT_EQ(RuleGraph::NONE, _graph.execute(cleanup, first));
+  EXPECT_EQ(1U, limit->inUse(&address));
+
+  third.reset();
+  EXPECT_EQ(RuleGraph::NONE, _graph.execute(root, third));
+  EXPECT_EQ(2U, limit->inUse(&address));
+
+  EXPECT_EQ(RuleGraph::NONE, _graph.execute(cleanup, second));
+  EXPECT_EQ(RuleGraph::NONE, _graph.execute(cleanup, third));
+  EXPECT_EQ(0U, limit->inUse(&address));
+}
+
+TEST_F(RuleGraphTest, UntrackedSlot) {
+  // A client that found no room in the limit's table was let in without a slot, so its cleanup must not take back
+  // the slot another connection from the same client later got.
+  const char *conf =
+      "[ { \"id\": \"" UUID4
+      "\", \"type\": \"MAX_LIMIT\", \"key\": \"IP_ADDRESS\", \"limit\": 1, \"max_keys\": 16 },"
+      "  { \"id\": \"" UUID1
+      "\", \"type\": \"INBOUND_CONNECTION_RULE_LIST\","
+      "    \"rules\": ["
+      "      { \"conditions\": [ { \"type\": \"ACQUIRE_SLOT\", \"limit\": \"" UUID4
+      "\", \"values\": [ \"NON_CONFORMING\" ] } ],"
+      "        \"actions\": [ { \"type\": \"CLOSE_CONNECTION\" } ] },"
+      "      { \"actions\": [ { \"type\": \"MARK\", \"mark\": \"has_slot\" } ] } ] },"
+      "  { \"id\": \"" UUID2
+      "\", \"type\": \"INBOUND_CONNECTION_CLEANUP\","
+      "    \"rules\": ["
+      "      { \"conditions\": [ { \"type\": \"MARK_MATCH\", \"values\": [ \"has_slot\" ] } ],"
+      "        \"actions\": [ { \"type\": \"RELEASE_SLOT\", \"limit\": \"" UUID4
+      "\", \"slots\": 1 } ] } ] } ]";
+  ASSERT_EQ(ESB_SUCCESS, build(conf));
+  ASSERT_EQ(ESB_SUCCESS, _graph.compile(_entities, _numEntities));
+
+  ESB::UInt32 root = 0;
+  ASSERT_EQ(ESB_SUCCESS, _graph.find(_uuid1, &root));
+  ESB::UInt32 cleanup = 0;
+  ASSERT_EQ(ESB_SUCCESS, _graph.find(_uuid2, &cleanup));
+
+  const MaxLimitEntity *limit = (const MaxLimitEntity *)_entities[0];
+  ASSERT_EQ(Entity::MAX_LIMIT, limit->type());
+
+  // Fill every entry of the table with another client
+  const ESB::UInt32 others = ESB_KEYED_SLOT_COUNTER_PROBES;
+  ESB::SocketAddress addresses[others];
+  RuleGraph::Context contexts[others];
+  for (ESB::UInt32 i = 0; i < others; ++i) {
+    char dottedIP[16];
+    snprintf(dottedIP, sizeof(dottedIP), "10.0.1.%u", i + 1U);
+    addresses[i] = ESB::SocketAddress(dottedIP, 443, ESB::SocketAddress::TCP);
+    contexts[i].setPeerAddress(&addresses[i]);
+    ASSERT_EQ(RuleGraph::NONE, _graph.execute(root, contexts[i]));
+    ASSERT_EQ(1U, limit->inUse(&addresses[i]));
+  }
+
+  ESB::SocketAddress address("10.0.0.1", 443, ESB::SocketAddress::TCP);
+  RuleGraph::Context untracked;
+  RuleGraph::Context tracked;
+  RuleGraph::Context rejected;
+  untracked.setPeerAddress(&address);
+  tracked.setPeerAddress(&address);
+  rejected.setPeerAddress(&address);
+
+  EXPECT_EQ(RuleGraph::NONE, _graph.execute(root, untracked));
+  EXPECT_EQ(0U, limit->inUse(&address));
+
+  // Once another client leaves there is room for this one
+  EXPECT_EQ(RuleGraph::NONE, _graph.execute(cleanup, contexts[0]));
+  EXPECT_EQ(RuleGraph::NONE, _graph.execute(root, tracked));
+  EXPECT_EQ(1U, limit->inUse(&address));
+
+  EXPECT_EQ(RuleGraph::NONE, _graph.execute(cleanup, untracked));
+  EXPECT_EQ(1U, limit->inUse(&address));
+  EXPECT_EQ(RuleGraph::CLOSE_CONNECTION, _graph.execute(root, rejected));
+
+  EXPECT_EQ(RuleGraph::NONE, _graph.execute(cleanup, tracked));
+  EXPECT_EQ(0U, limit->inUse(&address));
+
+  for (ESB::UInt32 i = 1; i < others; ++i) {
+    EXPECT_EQ(RuleGraph::NONE, _graph.execute(cleanup, contexts[i]));
+  }
+}
+
+TEST_F(RuleGraphTest, InheritMarks) {
+  ASSERT_EQ(ESB_SUCCESS, build(Graph));
+  ASSERT_EQ(ESB_SUCCESS, _graph.compile(_entities, _numEntities));
+
+  ESB::UInt32 request = 0;
+  ESB::UInt32 close = 0;
+  ASSERT_EQ(ESB_SUCCESS, _graph.find(_uuid2, &request));
+  ASSERT_EQ(ESB_SUCCESS, _graph.find(_uuid3, &close));
+
+  // The last node marks the connection blocked
+  RuleGraph::Context connection;
+  EXPECT_EQ(RuleGraph::CLOSE_CONNECTION, _graph.execute(close, connection));
+
+  // Every request on the connection starts with its marks, so each one is refused
+  for (int i = 0; i < 2; ++i) {
+    RuleGraph::Context context;
+    context.inheritMarks(connection);
+    EXPECT_EQ(connection.marks(), context.marks());
+    EXPECT_EQ(RuleGraph::SEND_RESPONSE, _graph.execute(request, context));
+  }
+  EXPECT_EQ(2U, _graph.ruleHits(_graph.firstRule(request)));
+
+  // A request without them is not
+  RuleGraph::Context other;
+  EXPECT_EQ(RuleGraph::NONE, _graph.execute(request, other));
+  EXPECT_EQ(2U, _graph.ruleHits(_graph.firstRule(request)));
+}
+
+TEST_F(RuleGraphTest, TopNLimit) {
+  // Clients that open more than 3 connections in 10 seconds are cut off
+  const char *conf =
+      "[ { \"id\": \"" UUID4
+      "\", \"type\": \"TOP_N_LIMIT\", \"key\": \"IP_ADDRESS\", \"n\": 8, \"threshold\": 3,"
+      "    \"time\": { \"value\": 10, \"unit\": \"SECOND\" }, \"shards\": 1 },"
+      "  { \"id\": \"" UUID1
+      "\", \"type\": \"INBOUND_CONNECTION_RULE_LIST\","
+      "    \"rules\": ["
+      "      { \"conditions\": [ { \"type\": \"ACQUIRE_SLOT\", \"limit\": \"" UUID4
+      "\", \"values\": [ \"NON_CONFORMING\" ] } ],"
+      "        \"actions\": [ { \"type\": \"CLOSE_CONNECTION\" } ] } ] } ]";
+  ASSERT_EQ(ESB_SUCCESS, build(conf));
+  ASSERT_EQ(ESB_SUCCESS, _graph.compile(_entities, _numEntities));
+
+  ESB::UInt32 root = 0;
+  ASSERT_EQ(ESB_SUCCESS, _graph.find(_uuid1, &root));
+
+  ESB::SocketAddress address("10.0.0.1", 443, ESB::SocketAddress::TCP);
+  ESB::SocketAddress other("10.0.0.2", 443, ESB::SocketAddress::TCP);
+  RuleGraph::Context context;
+  context.setPeerAddress(&address);
+  context.setNow(ESB::Date(1000, 0));
+
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(RuleGraph::NONE, _graph.execute(root, context));
+  }
+  EXPECT_EQ(RuleGraph::CLOSE_CONNECTION, _graph.execute(root, context));
+
+  context.setPeerAddress(&other);
+  EXPECT_EQ(RuleGraph::NONE, _graph.execute(root, context));
+
+  // Still cut off for the whole next window
+  context.setPeerAddress(&address);
+  context.setNow(ESB::Date(1015, 0));
+  EXPECT_EQ(RuleGraph::CLOSE_CONNECTION, _graph.execute(root, context));
+  context.setNow(ESB::Date(1030, 0));
+  EXPECT_EQ(RuleGraph::NONE, _graph.execute(root, context));
+}
+
+TEST_F(RuleGraphTest, MissingLimit) {
+  const char *conf =
+      "[ { \"id\": \"" UUID1
+      "\", \"type\": \"INBOUND_CONNECTION_RULE_LIST\","
+      "    \"rules\": ["
+      "      { \"conditions\": [ { \"type\": \"ACQUIRE_SLOT\", \"limit\": \"" UUID4
+      "\", \"values\": [ \"CONFORMING\" ] } ],"
+      "        \"actions\": [ { \"type\": \"CLOSE_CONNECTION\" } ] } ] } ]";
+  ASSERT_EQ(ESB_SUCCESS, build(conf));
+  EXPECT_EQ(ESB_CANNOT_FIND, _graph.compile(_entities, _numEntities));
+}
+
+TEST_F(RuleGraphTest, CidrMap) {
+  // Private and loopback clients go on to the next rule list, everyone else is closed.  Clients in 10.1.0.0/16 only
+  // get a mark and are left to the default rules.
+  const char *conf =
+      "[ { \"id\": \"" UUID1
+      "\", \"type\": \"INBOUND_CONNECTION_RULE_LIST\","
+      "    \"rules\": [ { \"actions\": [ { \"type\": \"TRANSITION\", \"destination\": \"" UUID2
+      "\" } ] } ] },"
+      "  { \"id\": \"" UUID2
+      "\", \"type\": \"INBOUND_CONNECTION_CIDR_MAP\", \"attribute\": \"PEER_ADDRESS\", \"component\": \"IP_ADDRESS\","
+      "    \"rule_map\": {"
+      "      \"10.0.0.0/8\": [ { \"actions\": [ { \"type\": \"TRANSITION\", \"destination\": \"" UUID3
+      "\" } ] } ],"
+      "      \"172.16.0.0/12\": [ { \"actions\": [ { \"type\": \"TRANSITION\", \"destination\": \"" UUID3
+      "\" } ] } ],"
+      "      \"192.168.0.0/16\": [ { \"actions\": [ { \"type\": \"TRANSITION\", \"destination\": \"" UUID3
+      "\" } ] } ],"
+      "      \"127.0.0.0/8\": [ { \"actions\": [ { \"type\": \"TRANSITION\", \"destination\": \"" UUID3
+      "\" } ] } ],"
+      "      \"10.1.0.0/16\": [ { \"actions\": [ { \"type\": \"MARK\", \"mark\": \"lab\" } ] } ]"
+      "    },"
+      "    \"default_rules\": ["
+      "      { \"conditions\": [ { \"type\": \"MARK_MATCH\", \"values\": [ \"lab\" ] } ],"
+      "        \"actions\": [ { \"type\": \"TRANSITION\", \"destination\": \"" UUID3
+      "\" } ] },"
+      "      { \"actions\": [ { \"type\": \"CLOSE_CONNECTION\" } ] } ] },"
+      "  { \"id\": \"" UUID3
+      "\", \"type\": \"INBOUND_CONNECTION_RULE_LIST\","
+      "    \"rules\": [ { \"actions\": [ { \"type\": \"MARK\", \"mark\": \"internal\" } ] } ] } ]";
+  ASSERT_EQ(ESB_SUCCESS, build(conf));
+  ASSERT_EQ(ESB_SUCCESS, _graph.compile(_entities, _numEntities));
+  ASSERT_EQ(3U, _graph.numNodes());
+  ASSERT_EQ(9U, _graph.numRules());
+
+  ESB::UInt32 root = 0;
+  ESB::UInt32 cidrMap = 0;
+  ESB::UInt32 internal = 0;
+  ASSERT_EQ(ESB_SUCCESS, _graph.find(_uuid1, &root));
+  ASSERT_EQ(ESB_SUCCESS, _graph.find(_uuid2, &cidrMap));
+  ASSERT_EQ(ESB_SUCCESS, _graph.find(_uuid3, &internal));
+  ASSERT_EQ(Entity::INBOUND_CONNECTION_CIDR_MAP, _graph.entity(cidrMap)->type());
+  EXPECT_LT(root, cidrMap);
+  EXPECT_LT(cidrMap, internal);
+
+  ESB::SocketAddress privateAddress("172.20.1.1", 443, ESB::SocketAddress::TCP);
+  RuleGraph::Context context;
+  context.setPeerAddress(&privateAddress);
+  EXPECT_EQ(RuleGraph::NONE, _graph.execute(root, context));
+  EXPECT_EQ(1U, _graph.nodeHits(cidrMap));
+  EXPECT_EQ(1U, _graph.nodeHits(internal));
+
+  // The longer block's rules fall through to the default rules, which see the mark they set
+  ESB::SocketAddress labAddress("10.1.2.3", 443, ESB::SocketAddress::TCP);
+  context.reset();
+  context.setPeerAddress(&labAddress);
+  EXPECT_EQ(RuleGraph::NONE, _graph.execute(root, context));
+  EXPECT_EQ(2U, _graph.nodeHits(internal));
+
+  ESB::SocketAddress publicAddress("8.8.8.8", 443, ESB::SocketAddress::TCP);
+  context.reset();
+  context.setPeerAddress(&publicAddress);
+  EXPECT_EQ(RuleGraph::CLOSE_CONNECTION, _graph.execute(root, context));
+  EXPECT_EQ(2U, _graph.nodeHits(internal));
+
+  // Without an address only the default rules run
+  RuleGraph::Context anonymous;
+  EXPECT_EQ(RuleGraph::CLOSE_CONNECTION, _graph.execute(cidrMap, anonymous));
+  EXPECT_EQ(4U, _graph.nodeHits(cidrMap));
+  EXPECT_EQ(2U, _graph.nodeHits(internal));
+}
@@ -5,6 +5,10 @@
 #include <ESHttpStream.h>
 #endif
 
+#ifndef ESB_SOCKET_SPLICER_H
+#include <ESBSocketSplicer.h>
+#endif
+
 namespace ES {
 
 class HttpClientStream : public HttpStream {
@@ -59,6 +63,19 @@ class HttpClientStream : public HttpStream {
    */
   virtual ESB::Error readResponseBody(unsigned char *body, ESB::UInt64 bytesRequested, ESB::UInt64 *bytesRead) = 0;
 
+  /**
+   * Move response body bytes from the underlying socket into a splicer's pipe without copying them into user space.
+   * This is only possible once all buffered response body bytes have been read.
+   *
+   * @param splicer The splicer that will hold the body bytes
+   * @param bytesRead The number of body bytes moved into the pipe
+   * @return ESB_SUCCESS + 0 bytesRead means the whole body has been read, ESB_SUCCESS + 1+ bytesRead means body data
+   * was moved, ESB_AGAIN means there is no data to be read on the underlying socket, ESB_OPERATION_NOT_SUPPORTED means
+   * the body must be read with readResponseBody() (e.g., the stream is secure, the body is chunked, or body bytes are
+   * still buffered), another error code otherwise.
+   */
+  virtual ESB::Error spliceResponseBody(ESB::SocketSplicer &splicer, ESB::UInt64 *bytesRead) = 0;
+
   ESB_DISABLE_AUTO_COPY(HttpClientStream);
 };
 
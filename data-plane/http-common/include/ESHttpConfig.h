@@ -5,17 +5,258 @@
 #include <ESBCommon.h>
 #endif
 
+#ifndef ESB_SOCKET_SPLICER_H
+#include <ESBSocketSplicer.h>
+#endif
+
+#ifndef ESB_SIZE_CLASS_BUFFER_POOL_H
+#include <ESBSizeClassBufferPool.h>
+#endif
+
+#ifndef ESB_SOCKET_ADDRESS_H
+#include <ESBSocketAddress.h>
+#endif
+
+#define ES_HTTP_MAX_WARM_DESTINATIONS 32
+
 namespace ES {
 
 class HttpConfig {
  public:
+  typedef enum { ES_HTTP_EPOLL_MULTIPLEXER = 0, ES_HTTP_URING_MULTIPLEXER = 1 } MultiplexerType;
+
   static inline HttpConfig &Instance() { return _Instance; }
   virtual ~HttpConfig();
-  inline ESB::UInt32 ioBufferSize() const { return _ioBufferSize; }
+  inline ESB::UInt32 ioBufferSize() const { return _ioBufferSizes[_ioBufferSizeClasses - 1]; }
+  inline ESB::UInt32 ioBufferSizeClasses() const { return _ioBufferSizeClasses; }
+  inline const ESB::UInt32 *ioBufferSizes() const { return _ioBufferSizes; }
   inline ESB::UInt32 ioBufferChunkSize() const { return _ioBufferChunkSize; }
   inline ESB::UInt32 connectionPoolBuckets() const { return _connectionPoolBuckets; };
   inline ESB::UInt32 tlsContextBuckets() const { return _connectionPoolBuckets; };
   inline ESB::UInt32 tlsContextLocks() const { return MIN(47, _connectionPoolBuckets); };
+  /** A destination that client multiplexers keep idle connections open to.
+   */
+  class WarmDestination {
+   public:
+    inline const char *hostname() const { return _hostname; }
+
+    inline ESB::UInt16 port() const { return _port; }
+
+    inline bool secure() const { return _secure; }
+
+    inline ESB::UInt32 minIdle() const { return _minIdle; }
+
+    inline ESB::UInt32 maxIdle() const { return _maxIdle; }
+
+   private:
+    char _hostname[ESB_MAX_HOSTNAME + 1];
+    ESB::UInt16 _port;
+    bool _secure;
+    ESB::UInt32 _minIdle;
+    ESB::UInt32 _maxIdle;
+
+    friend class HttpConfig;
+  };
+
+  inline ESB::UInt32 warmDestinations() const { return _warmDestinations; }
+
+  inline const WarmDestination &warmDestination(ESB::UInt32 index) const { return _warmDestination[index]; }
+
+  /** Have each client and proxy multiplexer started after this call open connections to a destination ahead of
+   * demand, complete their TCP and TLS handshakes, and keep them in its connection pool.  The least recently used
+   * idle connections beyond the maximum are closed.
+   *
+   * @param hostname The destination's hostname or IPv4 address.  For secure destinations this is also the TLS server
+   * name.
+   * @param port The destination's port
+   * @param secure true for TLS connections, false for clear text connections
+   * @param minIdle The number of idle connections each multiplexer keeps open to the destination
+   * @param maxIdle The number of idle connections each multiplexer keeps at most, or 0 for no limit
+   * @return ESB_SUCCESS if successful, ESB_OVERFLOW if there are already ES_HTTP_MAX_WARM_DESTINATIONS destinations,
+   * ESB_INVALID_ARGUMENT if the hostname is too long or maxIdle is less than minIdle, another error code otherwise.
+   */
+  ESB::Error addWarmDestination(const char *hostname, ESB::UInt16 port, bool secure, ESB::UInt32 minIdle,
+                                ESB::UInt32 maxIdle = 0U);
+
+  /** Stop keeping connections open to all warm destinations in multiplexers started after this call.
+   *
+   * @return this config
+   */
+  inline HttpConfig &clearWarmDestinations() {
+    _warmDestinations = 0U;
+    return *this;
+  }
+
+  inline ESB::UInt32 warmIntervalMsec() const { return _warmIntervalMsec; }
+
+  /** Set how often multiplexers top up and trim their connections to warm destinations.
+   *
+   * @param msec The time between checks
+   * @return this config
+   */
+  inline HttpConfig &setWarmIntervalMsec(ESB::UInt32 msec) {
+    _warmIntervalMsec = MAX(msec, 10U);
+    return *this;
+  }
+
+  inline MultiplexerType multiplexerType() const { return _multiplexerType; }
+
+  /** Select the socket multiplexer implementation used by multiplexers created after this call.  If io_uring is
+   * selected but not supported by the build or the running kernel, the epoll multiplexer is used instead.
+   *
+   * @param type The multiplexer implementation
+   * @return this config
+   */
+  inline HttpConfig &setMultiplexerType(MultiplexerType type) {
+    _multiplexerType = type;
+    return *this;
+  }
+
+  inline bool spliceResponseBodies() const { return _spliceResponseBodies; }
+
+  /** Let proxies move Content-Length response bodies from cleartext origin connections to cleartext client
+   * connections with splice(2) instead of copying them through the connections' buffers.  Ignored if the platform
+   * does not support splicing.
+   *
+   * @param splice true to splice response bodies, false to copy them
+   * @return this config
+   */
+  inline HttpConfig &setSpliceResponseBodies(bool splice) {
+    _spliceResponseBodies = splice && ESB::SocketSplicer::Supported();
+    return *this;
+  }
+
+  inline bool acceptBalancing() const { return _acceptBalancing; }
+
+  /** Let servers and proxies started after this call hand connections accepted by a busy multiplexer to a less loaded
+   * one instead of keeping every connection on the multiplexer whose listening socket accepted it.
+   *
+   * @param balance true to balance accepted connections by load, false to keep them where they are accepted
+   * @return this config
+   */
+  inline HttpConfig &setAcceptBalancing(bool balance) {
+    _acceptBalancing = balance;
+    return *this;
+  }
+
+  /** Set the sizes of the I/O buffer size classes used by servers, proxies and clients created after this call.
+   * Connections start with buffers from the smallest class, move up a class when their buffers keep filling, and move
+   * back down when their traffic would fit in a smaller class.  ioBufferSize() is the largest size.
+   *
+   * @param sizes The buffer sizes in bytes in strictly ascending order
+   * @param sizeClasses The number of sizes, at most ESB_MAX_BUFFER_SIZE_CLASSES
+   * @return ESB_SUCCESS if successful, ESB_INVALID_ARGUMENT if the sizes are not strictly ascending or there are too
+   * few or too many.
+   */
+  ESB::Error setIoBufferSizes(const ESB::UInt32 *sizes, ESB::UInt32 sizeClasses);
+
+  inline ESB::UInt32 maxIoBuffersPerClass() const { return _maxIoBuffersPerClass; }
+
+  /** Cap the number of I/O buffers of each size class, in use or cached, across all of a server's, proxy's or
+   * client's multiplexers.  Each size class has its own cap, so up to ioBufferSizeClasses() times this many buffers
+   * may be allocated in total.  Connections that cannot get a buffer once the cap is reached are closed.
+   *
+   * @param maxBuffers The maximum number of I/O buffers per size class or 0 for no limit
+   * @return this config
+   */
+  inline HttpConfig &setMaxIoBuffersPerClass(ESB::UInt32 maxBuffers) {
+    _maxIoBuffersPerClass = maxBuffers;
+    return *this;
+  }
+
+  inline ESB::UInt32 maxCachedIoBuffers() const { return _maxCachedIoBuffers; }
+
+  /** Limit the number of free I/O buffers of each size class that each multiplexer keeps for reuse.  Buffers released
+   * beyond this limit are returned to the system.
+   *
+   * @param maxBuffers The maximum number of free I/O buffers per size class and multiplexer or 0 for no limit
+   * @return this config
+   */
+  inline HttpConfig &setMaxCachedIoBuffers(ESB::UInt32 maxBuffers) {
+    _maxCachedIoBuffers = maxBuffers;
+    return *this;
+  }
+
+  inline ESB::UInt32 dnsCacheSize() const { return _dnsCacheSize; }
+
+  /** Limit the number of hostnames each server, proxy or client caches lookups for.
+   *
+   * @param size The maximum number of cached hostnames or 0 to disable caching
+   * @return this config
+   */
+  inline HttpConfig &setDnsCacheSize(ESB::UInt32 size) {
+    _dnsCacheSize = size;
+    return *this;
+  }
+
+  inline ESB::UInt32 dnsMaxTtlSeconds() const { return _dnsMaxTtlSeconds; }
+
+  /** Cache successful lookups for no longer than this, even if their DNS records have a longer TTL.
+   *
+   * @param seconds The longest time to cache a successful lookup
+   * @return this config
+   */
+  inline HttpConfig &setDnsMaxTtlSeconds(ESB::UInt32 seconds) {
+    _dnsMaxTtlSeconds = seconds;
+    return *this;
+  }
+
+  inline ESB::UInt32 dnsNegativeTtlSeconds() const { return _dnsNegativeTtlSeconds; }
+
+  /** Cache lookups of hostnames that do not exist for no longer than this, even if the resolver allows longer.
+   *
+   * @param seconds The longest time to cache a failed lookup
+   * @return this config
+   */
+  inline HttpConfig &setDnsNegativeTtlSeconds(ESB::UInt32 seconds) {
+    _dnsNegativeTtlSeconds = seconds;
+    return *this;
+  }
+
+  inline ESB::UInt32 tlsSessionCacheSize() const { return _tlsSessionCacheSize; }
+
+  /** Limit the number of TLS sessions each client or proxy caches so new connections to an origin can resume a session
+   * instead of doing a full handshake.  Takes effect for clients and proxies created after this call.
+   *
+   * @param size The maximum number of cached sessions or 0 to disable client session resumption
+   * @return this config
+   */
+  inline HttpConfig &setTlsSessionCacheSize(ESB::UInt32 size) {
+    _tlsSessionCacheSize = size;
+    return *this;
+  }
+
+  inline ESB::UInt32 tlsTicketKeyLifetimeSeconds() const { return _tlsTicketKeyLifetimeSeconds; }
+
+  /** Set how long each server or proxy encrypts new TLS session tickets with a key before generating a new one.
+   * Tickets encrypted with the few keys before it are still accepted.  Takes effect for servers and proxies created
+   * after this call.
+   *
+   * @param seconds The lifetime of each session ticket key or 0 to disable session tickets
+   * @return this config
+   */
+  inline HttpConfig &setTlsTicketKeyLifetimeSeconds(ESB::UInt32 seconds) {
+    _tlsTicketKeyLifetimeSeconds = seconds;
+    return *this;
+  }
+
+  /** Get the resolver multiplexers send DNS queries to.  If none has been set, the first IPv4 nameserver in
+   * /etc/resolv.conf is used, or 127.0.0.1 if there is none.
+   *
+   * @return The resolver's address
+   */
+  const ESB::SocketAddress &dnsResolver();
+
+  /** Set the resolver multiplexers created after this call send DNS queries to.
+   *
+   * @param resolver The resolver's address
+   * @return this config
+   */
+  inline HttpConfig &setDnsResolver(const ESB::SocketAddress &resolver) {
+    _dnsResolver = resolver;
+    _dnsResolver.setType(ESB::SocketAddress::UDP);
+    return *this;
+  }
 
  private:
   // Singleton
@@ -28,10 +269,25 @@ class HttpConfig {
     return *this;
   }
 
-  ESB::UInt32 _ioBufferSize;
+  ESB::UInt32 _ioBufferSizes[ESB_MAX_BUFFER_SIZE_CLASSES];
+  ESB::UInt32 _ioBufferSizeClasses;
   ESB::UInt32 _ioBufferChunkSize;
+  ESB::UInt32 _maxIoBuffersPerClass;
+  ESB::UInt32 _maxCachedIoBuffers;
+  ESB::UInt32 _dnsCacheSize;
+  ESB::UInt32 _dnsMaxTtlSeconds;
+  ESB::UInt32 _dnsNegativeTtlSeconds;
+  ESB::SocketAddress _dnsResolver;
+  ESB::UInt32 _tlsSessionCacheSize;
+  ESB::UInt32 _tlsTicketKeyLifetimeSeconds;
   ESB::UInt32 _connectionPoolBuckets;
+  ESB::UInt32 _warmDestinations;
+  ESB::UInt32 _warmIntervalMsec;
+  WarmDestination _warmDestination[ES_HTTP_MAX_WARM_DESTINATIONS];
   ESB::UInt32 _idleTimeoutSeconds;
+  MultiplexerType _multiplexerType;
+  bool _spliceResponseBodies;
+  bool _acceptBalancing;
   static HttpConfig _Instance;
 
   ESB_DEFAULT_FUNCS(HttpConfig);
@@ -5,14 +5,74 @@
 #include <ESBEmbeddedListElement.h>
 #endif
 
+#ifndef ESB_CONFIG_H
+#include <ESBConfig.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
 namespace ES {
 
 class HttpHeader : public ESB::EmbeddedListElement {
  public:
+  /** Interned ids for well-known field names.  Messages index their headers by these ids so the common headers can be
+   * found without comparing field names.
+   */
+  typedef enum {
+    ES_HTTP_FIELD_UNKNOWN = 0, /**< Any field name not listed below */
+    ES_HTTP_FIELD_ACCEPT,
+    ES_HTTP_FIELD_CONNECTION,
+    ES_HTTP_FIELD_CONTENT_LENGTH,
+    ES_HTTP_FIELD_CONTENT_TYPE,
+    ES_HTTP_FIELD_DATE,
+    ES_HTTP_FIELD_EXPECT,
+    ES_HTTP_FIELD_HOST,
+    ES_HTTP_FIELD_KEEP_ALIVE,
+    ES_HTTP_FIELD_PROXY_CONNECTION,
+    ES_HTTP_FIELD_SERVER,
+    ES_HTTP_FIELD_TE,
+    ES_HTTP_FIELD_TRAILER,
+    ES_HTTP_FIELD_TRANSFER_ENCODING,
+    ES_HTTP_FIELD_UPGRADE,
+    ES_HTTP_FIELD_USER_AGENT,
+    ES_HTTP_FIELD_VIA,
+    ES_HTTP_FIELD_X_FORWARDED_FOR,
+    ES_HTTP_FIELD_COUNT /**< Not a field, the number of field ids */
+  } FieldToken;
+
   HttpHeader(const char *fieldName, const char *fieldValue = NULL);
   HttpHeader(const unsigned char *fieldName, const unsigned char *fieldValue = NULL);
+
+  /** Construct a header whose field name has already been tokenized.
+   *
+   * @param fieldName The field name
+   * @param fieldToken The field name's id, as returned by Tokenize()
+   * @param fieldValue The field value, if known
+   */
+  HttpHeader(const unsigned char *fieldName, FieldToken fieldToken, const unsigned char *fieldValue = NULL);
   virtual ~HttpHeader();
 
+  /**
+   * Map a field name to its id.  Field names are compared case-insensitively.
+   *
+   * @param fieldName The field name.  Need not be NULL-terminated.
+   * @param length The length of the field name in bytes
+   * @return The field name's id or ES_HTTP_FIELD_UNKNOWN if it is not a well-known field name.
+   */
+  static FieldToken Tokenize(const unsigned char *fieldName, ESB::UInt32 length);
+
+  /**
+   * Map a NULL-terminated field name to its id.
+   *
+   * @param fieldName The field name
+   * @return The field name's id or ES_HTTP_FIELD_UNKNOWN if it is not a well-known field name.
+   */
+  static inline FieldToken Tokenize(const char *fieldName) {
+    return fieldName ? Tokenize((const unsigned char *)fieldName, strlen(fieldName)) : ES_HTTP_FIELD_UNKNOWN;
+  }
+
   /**
    * Get the field name.  This will always be present in a parsed header.
    *
@@ -20,6 +80,13 @@ class HttpHeader : public ESB::EmbeddedListElement {
    */
   inline const unsigned char *fieldName() const { return _fieldName; }
 
+  /**
+   * Get the field name's id.
+   *
+   * @return the field name's id or ES_HTTP_FIELD_UNKNOWN if the field name is not well-known.
+   */
+  inline FieldToken fieldToken() const { return _fieldToken; }
+
   /**
    * Get the field value, if present.
    *
@@ -27,17 +94,22 @@ class HttpHeader : public ESB::EmbeddedListElement {
    */
   inline const unsigned char *fieldValue() const { return _fieldValue; }
 
-  /** Set the field name.  Caller controls the memory for this value.
+  /** Set the field name.  Caller controls the memory for this value.  Headers that have already been added to a
+   * message must be renamed with HttpMessage::renameHeader() instead so the message's index stays current.
    *
    * @param name The field name.
    */
-  inline void setFieldName(const char *fieldName) { _fieldName = (const unsigned char *)fieldName; }
+  inline void setFieldName(const char *fieldName) {
+    _fieldName = (const unsigned char *)fieldName;
+    _fieldToken = Tokenize(fieldName);
+  }
 
-  /** Set the field name.  Caller controls the memory for this value.
+  /** Set the field name.  Caller controls the memory for this value.  Headers that have already been added to a
+   * message must be renamed with HttpMessage::renameHeader() instead so the message's index stays current.
    *
    * @param name The field name.
    */
-  inline void setFieldName(const unsigned char *fieldName) { _fieldName = fieldName; }
+  inline void setFieldName(const unsigned char *fieldName) { setFieldName((const char *)fieldName); }
 
   /**
    * Set the field value.  Caller controls the memory for this value.
@@ -63,6 +135,7 @@ class HttpHeader : public ESB::EmbeddedListElement {
  private:
   const unsigned char *_fieldName;
   const unsigned char *_fieldValue;
+  FieldToken _fieldToken;
 
   ESB_DEFAULT_FUNCS(HttpHeader);
 };
@@ -24,12 +24,63 @@ class HttpMessage {
 
   virtual ~HttpMessage();
 
-  inline ESB::EmbeddedList &headers() { return _headers; }
-
+  /**
+   * Get the message's headers.  The list is read-only so that every change to it goes through the message and keeps
+   * the header index current.
+   *
+   * @return The headers in the order they were added
+   */
   inline const ESB::EmbeddedList &headers() const { return _headers; }
 
+  /**
+   * Get the most recently added header, e.g., to append a continuation line to its value.  Rename it with
+   * renameHeader(), not HttpHeader::setFieldName().
+   *
+   * @return The last header or NULL if the message has no headers.
+   */
+  inline HttpHeader *lastHeader() { return (HttpHeader *)_headers.last(); }
+
+  /**
+   * Find the first header with the given field name.  Well-known field names are found with a single index lookup,
+   * other field names with a scan of the unindexed headers.
+   *
+   * @param fieldName The field name, compared case-insensitively.
+   * @return The first matching header or NULL if the message has no such header.
+   */
   const HttpHeader *findHeader(const char *fieldName) const;
 
+  /**
+   * Find the first header with the given well-known field name.
+   *
+   * @param fieldToken The field name's id.  Must not be ES_HTTP_FIELD_UNKNOWN.
+   * @return The first matching header or NULL if the message has no such header.
+   */
+  inline const HttpHeader *findHeader(HttpHeader::FieldToken fieldToken) const {
+    assert(HttpHeader::ES_HTTP_FIELD_UNKNOWN < fieldToken && HttpHeader::ES_HTTP_FIELD_COUNT > fieldToken);
+    return _index[fieldToken];
+  }
+
+  /**
+   * Add a header to the end of the message's header list and index it.  Caller controls the memory for the header.
+   *
+   * @param header The header
+   */
+  inline void appendHeader(HttpHeader *header) {
+    assert(header);
+    _headers.addLast(header);
+    if (HttpHeader::ES_HTTP_FIELD_UNKNOWN != header->fieldToken() && !_index[header->fieldToken()]) {
+      _index[header->fieldToken()] = header;
+    }
+  }
+
+  /**
+   * Change the field name of a header already in this message and update the index to match.
+   *
+   * @param header A header in this message
+   * @param fieldName The new field name.  Caller controls the memory for this value.
+   */
+  void renameHeader(HttpHeader *header, const char *fieldName);
+
   inline ESB::Error addHeader(const HttpHeader *header, ESB::Allocator &allocator) {
     return addHeader((const char *)header->fieldName(), (const char *)header->fieldValue(), allocator);
   }
@@ -79,6 +130,7 @@ class HttpMessage {
   inline void reset() {
     _version = 110;
     _headers.clear();
+    memset(_index, 0, sizeof(_index));
   }
 
   inline void setHasBody(bool hasBody) {
@@ -117,9 +169,14 @@ class HttpMessage {
   inline void setFlags(int flags) { _flags = flags; }
 
  private:
+  // Point each well-known field name at the first header with that name
+  void reindex();
+
   int _flags;
   int _version;  // 110 is 1.1, 100 is 1.0, etc.
   ESB::EmbeddedList _headers;
+  // The first header with each well-known field name, indexed by field id.  Index 0 (unknown) is never used.
+  const HttpHeader *_index[HttpHeader::ES_HTTP_FIELD_COUNT];
 
   ESB_DISABLE_AUTO_COPY(HttpMessage);
 };
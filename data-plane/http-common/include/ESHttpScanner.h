@@ -0,0 +1,102 @@
+#ifndef ES_HTTP_SCANNER_H
+#define ES_HTTP_SCANNER_H
+
+#ifndef ESB_CONFIG_H
+#include <ESBConfig.h>
+#endif
+
+#ifndef ESB_ERROR_H
+#include <ESBError.h>
+#endif
+
+namespace ES {
+
+/**
+ * Finds the end of runs of valid octets in HTTP/1 message headers many octets at a time.  The fastest implementation
+ * the CPU supports is chosen when the process starts.  Every implementation returns exactly what the scalar
+ * implementation would, so callers can treat the octet at the returned position (if any) with their usual
+ * one-octet-at-a-time logic.
+ */
+class HttpScanner {
+ public:
+  typedef enum {
+    ES_HTTP_SCANNER_SCALAR = 0, /**< One octet at a time using HttpUtil's bitmasks */
+    ES_HTTP_SCANNER_SSE42 = 1,  /**< 16 octets at a time using SSE4.2 string instructions */
+    ES_HTTP_SCANNER_AVX2 = 2    /**< 32 octets at a time using AVX2 */
+  } Implementation;
+
+  /**
+   * Skip a run of token octets (RFC 2616 section 2.2).
+   *
+   * @param start The first octet to examine
+   * @param end One past the last octet to examine
+   * @return The first octet that is not a token octet or end if all octets were token octets.
+   */
+  inline static const unsigned char *SkipToken(const unsigned char *start, const unsigned char *end) {
+    return _SkipToken(start, end);
+  }
+
+  /**
+   * Skip a run of field-content octets that need no further interpretation: everything but control characters, DEL,
+   * and linear whitespace.
+   *
+   * @param start The first octet to examine
+   * @param end One past the last octet to examine
+   * @return The first octet that is a control character, DEL, SP or HT or end if there were none.
+   */
+  inline static const unsigned char *SkipFieldContent(const unsigned char *start, const unsigned char *end) {
+    return _SkipFieldContent(start, end);
+  }
+
+  /**
+   * Get the fastest implementation the CPU supports.
+   *
+   * @return The fastest supported implementation
+   */
+  static Implementation Best();
+
+  /**
+   * Determine whether the CPU supports an implementation.
+   *
+   * @param implementation The implementation
+   * @return true if the implementation can be used, false otherwise.
+   */
+  static bool Supported(Implementation implementation);
+
+  /**
+   * Switch to another implementation.  This is meant for tests and benchmarks and is not thread-safe.
+   *
+   * @param implementation The implementation
+   * @return ESB_SUCCESS if successful, ESB_OPERATION_NOT_SUPPORTED if the CPU does not support the implementation.
+   */
+  static ESB::Error Select(Implementation implementation);
+
+  /**
+   * Get the implementation currently in use.
+   *
+   * @return The current implementation
+   */
+  inline static Implementation Selected() { return _Selected; }
+
+  /**
+   * Get a printable name for an implementation.
+   *
+   * @param implementation The implementation
+   * @return The implementation's name
+   */
+  static const char *Name(Implementation implementation);
+
+ private:
+  // Disabled
+  HttpScanner();
+
+  typedef const unsigned char *(*SkipFunction)(const unsigned char *start, const unsigned char *end);
+
+  static SkipFunction _SkipToken;
+  static SkipFunction _SkipFieldContent;
+  static Implementation _Selected;
+};
+
+}  // namespace ES
+
+#endif
@@ -5,6 +5,10 @@
 #include <ESHttpStream.h>
 #endif
 
+#ifndef ESB_SOCKET_SPLICER_H
+#include <ESBSocketSplicer.h>
+#endif
+
 namespace ES {
 
 class HttpServerStream : public HttpStream {
@@ -54,6 +58,17 @@ class HttpServerStream : public HttpStream {
   virtual ESB::Error sendResponseBody(unsigned const char *body, ESB::UInt64 bytesOffered,
                                       ESB::UInt64 *bytesConsumed) = 0;
 
+  /**
+   * Send response body bytes held in a splicer's pipe directly to the underlying socket.  Any buffered response bytes
+   * are flushed first so the spliced bytes follow them on the wire.
+   *
+   * @param splicer The splicer holding the body bytes
+   * @param bytesSent The number of body bytes moved from the pipe to the underlying socket
+   * @return ESB_SUCCESS if the pipe was emptied, ESB_AGAIN if the underlying socket send buffer is full,
+   * ESB_OPERATION_NOT_SUPPORTED if the stream is secure or the response body is chunked, another error code otherwise.
+   */
+  virtual ESB::Error spliceResponseBody(ESB::SocketSplicer &splicer, ESB::UInt64 *bytesSent) = 0;
+
   /**
    * Determine how many bytes of request body data can be read without blocking.
    * This may trigger a read from the underlying socket as a side effect.
@@ -79,6 +94,32 @@ class HttpServerStream : public HttpStream {
    */
   virtual ESB::Error readRequestBody(unsigned char *body, ESB::UInt64 bytesRequested, ESB::UInt64 *bytesRead) = 0;
 
+  /**
+   * Associate an application-specific context with the connection.  Unlike
+   * the stream's context, it is kept across every transaction on the
+   * connection.
+   *
+   * @param context The application-specific context to associate with the
+   * connection.
+   */
+  virtual void setConnectionContext(void *context) = 0;
+
+  /**
+   * Get the connection's application-specific context.
+   *
+   * @return Any application-specific context associated with the connection,
+   * or NULL if no context has been associated.
+   */
+  virtual void *connectionContext() = 0;
+
+  /**
+   * Get the connection's application-specific context.
+   *
+   * @return Any application-specific context associated with the connection,
+   * or NULL if no context has been associated.
+   */
+  virtual const void *connectionContext() const = 0;
+
   ESB_DISABLE_AUTO_COPY(HttpServerStream);
 };
 
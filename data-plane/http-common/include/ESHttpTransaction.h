@@ -33,8 +33,8 @@
 #include <ESBPerformanceCounter.h>
 #endif
 
-#ifndef ESB_TIME_H
-#include <ESBTime.h>
+#ifndef ESB_MONOTONIC_TIME_SOURCE_H
+#include <ESBMonotonicTimeSource.h>
 #endif
 
 namespace ES {
@@ -86,7 +86,7 @@ class HttpTransaction : public ESB::EmbeddedListElement {
 
   inline unsigned char *duplicate(unsigned char *value) { return HttpUtil::Duplicate(&_allocator, value); }
 
-  inline void setStartTime() { _start = ESB::Time::Instance().now(); }
+  inline void setStartTime() { _start = ESB::MonotonicTimeSource::Instance().now(); }
 
   inline const ESB::Date &startTime() const { return _start; }
 
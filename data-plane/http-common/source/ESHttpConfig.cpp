@@ -10,8 +10,24 @@
 #include <ESBDiscardAllocator.h>
 #endif
 
-#ifndef ESB_BUFFER_POOL_H
-#include <ESBBufferPool.h>
+#ifndef ESB_BUFFER_H
+#include <ESBBuffer.h>
+#endif
+
+#ifndef ESB_ASYNC_DNS_CLIENT_H
+#include <ESBAsyncDnsClient.h>
+#endif
+
+#ifndef ESB_CLIENT_TLS_CONTEXT_INDEX_H
+#include <ESBClientTLSContextIndex.h>
+#endif
+
+#ifndef ESB_SERVER_TLS_CONTEXT_INDEX_H
+#include <ESBServerTLSContextIndex.h>
+#endif
+
+#ifndef ESB_TLS_SOCKET_H
+#include <ESBTLSSocket.h>
 #endif
 
 #include <cmath>
@@ -20,17 +36,92 @@ namespace ES {
 
 HttpConfig HttpConfig::_Instance;
 
-HttpConfig::HttpConfig() : _connectionPoolBuckets(7919U), _idleTimeoutSeconds(60) {
+HttpConfig::HttpConfig()
+    : _ioBufferSizeClasses(3U),
+      _maxIoBuffersPerClass(0U),
+      _maxCachedIoBuffers(0U),
+      _dnsCacheSize(10000U),
+      _dnsMaxTtlSeconds(300U),
+      _dnsNegativeTtlSeconds(30U),
+      _dnsResolver(),
+      _tlsSessionCacheSize(ESB::ClientTLSContextIndex::DefaultMaxSessions),
+      _tlsTicketKeyLifetimeSeconds(ESB::ServerTLSContextIndex::DefaultTicketKeyLifetimeSeconds),
+      _connectionPoolBuckets(7919U),
+      _warmDestinations(0U),
+      _warmIntervalMsec(1000U),
+      _idleTimeoutSeconds(60),
+      _multiplexerType(ES_HTTP_EPOLL_MULTIPLEXER),
+      _spliceResponseBodies(false),
+      _acceptBalancing(false) {
   const ESB::UInt32 bufsz = ESB_PAGE_SIZE * 8U;
   const ESB::UInt32 bufs = 1000U;
   const ESB::UInt32 chunksz = ESB::DiscardAllocator::SizeofChunk(ESB_CACHE_LINE_SIZE);
   const ESB::UInt32 bufOverhead = ESB_ALIGN(sizeof(ESB::Buffer), ESB_CACHE_LINE_SIZE);
   const ESB::UInt32 chunkOverhead = (ESB::UInt32)ceil((double)chunksz / bufs);
 
-  _ioBufferSize = bufsz - bufOverhead - chunkOverhead;
+  // Roughly 4K and 32K including each buffer's bookkeeping, and in between exactly one full TLS record so TLS
+  // connections, whose receive buffers must hold a record, do not start in the largest class.
+  _ioBufferSizes[0] = ESB_PAGE_SIZE - bufOverhead;
+  _ioBufferSizes[1] = ESB_TLS_MAX_RECORD_SIZE;
+  _ioBufferSizes[2] = bufsz - bufOverhead - chunkOverhead;
   _ioBufferChunkSize = bufs * bufsz - chunksz;
 }
 
+ESB::Error HttpConfig::setIoBufferSizes(const ESB::UInt32 *sizes, ESB::UInt32 sizeClasses) {
+  if (!sizes) {
+    return ESB_NULL_POINTER;
+  }
+
+  if (0 == sizeClasses || ESB_MAX_BUFFER_SIZE_CLASSES < sizeClasses || 0 == sizes[0]) {
+    return ESB_INVALID_ARGUMENT;
+  }
+
+  for (ESB::UInt32 i = 1; i < sizeClasses; ++i) {
+    if (sizes[i - 1] >= sizes[i]) {
+      return ESB_INVALID_ARGUMENT;
+    }
+  }
+
+  memcpy(_ioBufferSizes, sizes, sizeClasses * sizeof(ESB::UInt32));
+  _ioBufferSizeClasses = sizeClasses;
+  return ESB_SUCCESS;
+}
+
+ESB::Error HttpConfig::addWarmDestination(const char *hostname, ESB::UInt16 port, bool secure, ESB::UInt32 minIdle,
+                                          ESB::UInt32 maxIdle) {
+  if (!hostname) {
+    return ESB_NULL_POINTER;
+  }
+
+  if (ESB_MAX_HOSTNAME < strlen(hostname) || (0 < maxIdle && maxIdle < minIdle)) {
+    return ESB_INVALID_ARGUMENT;
+  }
+
+  if (ES_HTTP_MAX_WARM_DESTINATIONS <= _warmDestinations) {
+    return ESB_OVERFLOW;
+  }
+
+  WarmDestination &destination = _warmDestination[_warmDestinations++];
+  strcpy(destination._hostname, hostname);
+  destination._port = port;
+  destination._secure = secure;
+  destination._minIdle = minIdle;
+  destination._maxIdle = maxIdle;
+  return ESB_SUCCESS;
+}
+
+const ESB::SocketAddress &HttpConfig::dnsResolver() {
+  if (ESB::SocketAddress::NONE != _dnsResolver.type()) {
+    return _dnsResolver;
+  }
+
+  if (ESB_SUCCESS != ESB::AsyncDnsClient::SystemResolver(_dnsResolver)) {
+    _dnsResolver = ESB::SocketAddress("127.0.0.1", 53, ESB::SocketAddress::UDP);
+  }
+
+  return _dnsResolver;
+}
+
 HttpConfig::~HttpConfig() {}
 
 }  // namespace ES
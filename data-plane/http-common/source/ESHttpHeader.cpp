@@ -7,13 +7,81 @@ namespace ES {
 HttpHeader::HttpHeader(const char *fieldName, const char *fieldValue)
     : ESB::EmbeddedListElement(),
       _fieldName((const unsigned char *)fieldName),
-      _fieldValue((const unsigned char *)fieldValue) {}
+      _fieldValue((const unsigned char *)fieldValue),
+      _fieldToken(Tokenize(fieldName)) {}
 
 HttpHeader::HttpHeader(const unsigned char *fieldName, const unsigned char *fieldValue)
-    : ESB::EmbeddedListElement(), _fieldName(fieldName), _fieldValue(fieldValue) {}
+    : ESB::EmbeddedListElement(),
+      _fieldName(fieldName),
+      _fieldValue(fieldValue),
+      _fieldToken(Tokenize((const char *)fieldName)) {}
+
+HttpHeader::HttpHeader(const unsigned char *fieldName, FieldToken fieldToken, const unsigned char *fieldValue)
+    : ESB::EmbeddedListElement(), _fieldName(fieldName), _fieldValue(fieldValue), _fieldToken(fieldToken) {
+  assert(fieldToken == Tokenize((const char *)fieldName));
+}
 
 HttpHeader::~HttpHeader() {}
 
 ESB::CleanupHandler *HttpHeader::cleanupHandler() { return NULL; }
 
+#define ES_HTTP_MATCH_FIELD(NAME, TOKEN)                                   \
+  if (0 == strncasecmp((const char *)fieldName, NAME, sizeof(NAME) - 1)) { \
+    return TOKEN;                                                          \
+  }
+
+HttpHeader::FieldToken HttpHeader::Tokenize(const unsigned char *fieldName, ESB::UInt32 length) {
+  if (!fieldName) {
+    return ES_HTTP_FIELD_UNKNOWN;
+  }
+
+  // Dispatch on the length first so at most a few names are compared.
+
+  switch (length) {
+    case 2:
+      ES_HTTP_MATCH_FIELD("TE", ES_HTTP_FIELD_TE);
+      break;
+    case 3:
+      ES_HTTP_MATCH_FIELD("Via", ES_HTTP_FIELD_VIA);
+      break;
+    case 4:
+      ES_HTTP_MATCH_FIELD("Host", ES_HTTP_FIELD_HOST);
+      ES_HTTP_MATCH_FIELD("Date", ES_HTTP_FIELD_DATE);
+      break;
+    case 6:
+      ES_HTTP_MATCH_FIELD("Accept", ES_HTTP_FIELD_ACCEPT);
+      ES_HTTP_MATCH_FIELD("Expect", ES_HTTP_FIELD_EXPECT);
+      ES_HTTP_MATCH_FIELD("Server", ES_HTTP_FIELD_SERVER);
+      break;
+    case 7:
+      ES_HTTP_MATCH_FIELD("Upgrade", ES_HTTP_FIELD_UPGRADE);
+      ES_HTTP_MATCH_FIELD("Trailer", ES_HTTP_FIELD_TRAILER);
+      break;
+    case 10:
+      ES_HTTP_MATCH_FIELD("Connection", ES_HTTP_FIELD_CONNECTION);
+      ES_HTTP_MATCH_FIELD("User-Agent", ES_HTTP_FIELD_USER_AGENT);
+      ES_HTTP_MATCH_FIELD("Keep-Alive", ES_HTTP_FIELD_KEEP_ALIVE);
+      break;
+    case 12:
+      ES_HTTP_MATCH_FIELD("Content-Type", ES_HTTP_FIELD_CONTENT_TYPE);
+      break;
+    case 14:
+      ES_HTTP_MATCH_FIELD("Content-Length", ES_HTTP_FIELD_CONTENT_LENGTH);
+      break;
+    case 15:
+      ES_HTTP_MATCH_FIELD("X-Forwarded-For", ES_HTTP_FIELD_X_FORWARDED_FOR);
+      break;
+    case 16:
+      ES_HTTP_MATCH_FIELD("Proxy-Connection", ES_HTTP_FIELD_PROXY_CONNECTION);
+      break;
+    case 17:
+      ES_HTTP_MATCH_FIELD("Transfer-Encoding", ES_HTTP_FIELD_TRANSFER_ENCODING);
+      break;
+    default:
+      break;
+  }
+
+  return ES_HTTP_FIELD_UNKNOWN;
+}
+
 }  // namespace ES
@@ -12,7 +12,7 @@
 
 namespace ES {
 
-HttpMessage::HttpMessage() : _flags(0x00), _version(110), _headers() {}
+HttpMessage::HttpMessage() : _flags(0x00), _version(110), _headers() { memset(_index, 0, sizeof(_index)); }
 
 HttpMessage::~HttpMessage() {}
 
@@ -21,9 +21,18 @@ const HttpHeader *HttpMessage::findHeader(const char *fieldName) const {
     return 0;
   }
 
+  const HttpHeader::FieldToken fieldToken = HttpHeader::Tokenize(fieldName);
+
+  if (HttpHeader::ES_HTTP_FIELD_UNKNOWN != fieldToken) {
+    return _index[fieldToken];
+  }
+
+  // An unknown field name can only match headers whose field names are also unknown.
+
   for (const HttpHeader *header = (const HttpHeader *)_headers.first(); header;
        header = (const HttpHeader *)header->next()) {
-    if (0 == strcasecmp(fieldName, (const char *)header->fieldName())) {
+    if (HttpHeader::ES_HTTP_FIELD_UNKNOWN == header->fieldToken() &&
+        0 == strcasecmp(fieldName, (const char *)header->fieldName())) {
       return header;
     }
   }
@@ -31,6 +40,31 @@ const HttpHeader *HttpMessage::findHeader(const char *fieldName) const {
   return 0;
 }
 
+void HttpMessage::renameHeader(HttpHeader *header, const char *fieldName) {
+  assert(header);
+  if (!header) {
+    return;
+  }
+
+  const HttpHeader::FieldToken oldToken = header->fieldToken();
+  header->setFieldName(fieldName);
+
+  if (oldToken != header->fieldToken()) {
+    reindex();
+  }
+}
+
+void HttpMessage::reindex() {
+  memset(_index, 0, sizeof(_index));
+
+  for (const HttpHeader *header = (const HttpHeader *)_headers.first(); header;
+       header = (const HttpHeader *)header->next()) {
+    if (HttpHeader::ES_HTTP_FIELD_UNKNOWN != header->fieldToken() && !_index[header->fieldToken()]) {
+      _index[header->fieldToken()] = header;
+    }
+  }
+}
+
 ESB::Error HttpMessage::addHeader(const char *fieldName, const char *fieldValue, ESB::Allocator &allocator) {
   if (!fieldName) {
     return ESB_NULL_POINTER;
@@ -51,9 +85,10 @@ ESB::Error HttpMessage::addHeader(const char *fieldName, const char *fieldValue,
   memcpy(block + sizeof(HttpHeader) + fieldNameLength + 1, fieldValue, fieldValueLength);
   block[sizeof(HttpHeader) + fieldNameLength + fieldValueLength + 1] = 0;
 
-  HttpHeader *header =
-      new (block) HttpHeader(block + sizeof(HttpHeader), block + sizeof(HttpHeader) + fieldNameLength + 1);
-  _headers.addLast(header);
+  const unsigned char *name = block + sizeof(HttpHeader);
+  HttpHeader *header = new (block)
+      HttpHeader(name, HttpHeader::Tokenize(name, fieldNameLength), block + sizeof(HttpHeader) + fieldNameLength + 1);
+  appendHeader(header);
 
   return ESB_SUCCESS;
 }
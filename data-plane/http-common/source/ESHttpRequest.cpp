@@ -98,7 +98,7 @@ ESB::Error HttpRequest::parsePeerAddress(char *hostname, int size, ESB::UInt16 *
     return ESB_SUCCESS;
   }
 
-  const HttpHeader *header = findHeader("Host");
+  const HttpHeader *header = findHeader(HttpHeader::ES_HTTP_FIELD_HOST);
 
   if (!header || !header->fieldValue()) {
     return ESB_INVALID_ARGUMENT;
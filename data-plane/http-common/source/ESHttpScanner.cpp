@@ -0,0 +1,227 @@
+#ifndef ES_HTTP_SCANNER_H
+#include <ESHttpScanner.h>
+#endif
+
+#ifndef ES_HTTP_UTIL_H
+#include <ESHttpUtil.h>
+#endif
+
+#ifdef HAVE_X86_SIMD_DISPATCH
+#include <immintrin.h>
+#endif
+
+namespace ES {
+
+static inline bool IsFieldContent(unsigned char octet) { return ' ' < octet && 0x7F != octet; }
+
+static const unsigned char *SkipTokenScalar(const unsigned char *start, const unsigned char *end) {
+  while (start < end && HttpUtil::IsToken(*start)) {
+    ++start;
+  }
+  return start;
+}
+
+static const unsigned char *SkipFieldContentScalar(const unsigned char *start, const unsigned char *end) {
+  while (start < end && IsFieldContent(*start)) {
+    ++start;
+  }
+  return start;
+}
+
+#ifdef HAVE_X86_SIMD_DISPATCH
+
+// pcmpestri accepts at most 8 ranges but the octets that end a token form 10.  '*', '+' and '|' are token octets
+// that fall inside the merged ranges, so every hit is confirmed with the scalar bitmask.
+static const char TokenStopRanges[16] __attribute__((aligned(16))) = {
+    '\x00', ' ', '"', '"', '(', ',', '/', '/', ':', '@', '[', ']', '{', '}', '\x7F', '\xFF'};
+
+// An octet is a token octet if bit (octet >> 4) of TokenLowNibbles[octet & 0x0F] is set.  TokenHighNibbles maps the
+// high nibble to that bit.  Octets >= 0x80 map to no bit and so are never token octets.
+static const unsigned char TokenLowNibbles[16] __attribute__((aligned(16))) = {
+    0xE8, 0xFC, 0xF8, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xF8, 0xF8, 0xF4, 0x54, 0xD0, 0x54, 0xF4, 0x70};
+
+static const unsigned char TokenHighNibbles[16] __attribute__((aligned(16))) = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20,
+                                                                                0x40, 0x80, 0x00, 0x00, 0x00, 0x00,
+                                                                                0x00, 0x00, 0x00, 0x00};
+
+static const char FieldContentStopRanges[16] __attribute__((aligned(16))) = {'\x00', ' ', '\x7F', '\x7F'};
+
+// The 16 octet loops are always inlined so the AVX2 functions get VEX-encoded copies and avoid SSE/AVX transitions.
+
+__attribute__((target("sse4.2"), always_inline)) static inline const unsigned char *SkipTokenBlocks(
+    const unsigned char *start, const unsigned char *end) {
+  const __m128i ranges = _mm_load_si128((const __m128i *)TokenStopRanges);
+
+  while (16 <= end - start) {
+    const __m128i octets = _mm_loadu_si128((const __m128i *)start);
+    const int index =
+        _mm_cmpestri(ranges, 16, octets, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+
+    if (16 == index) {
+      start += 16;
+      continue;
+    }
+
+    start += index;
+
+    if (!HttpUtil::IsToken(*start)) {
+      return start;
+    }
+
+    ++start;
+  }
+
+  return SkipTokenScalar(start, end);
+}
+
+__attribute__((target("sse4.2"), always_inline)) static inline const unsigned char *SkipFieldContentBlocks(
+    const unsigned char *start, const unsigned char *end) {
+  const __m128i ranges = _mm_load_si128((const __m128i *)FieldContentStopRanges);
+
+  while (16 <= end - start) {
+    const __m128i octets = _mm_loadu_si128((const __m128i *)start);
+    const int index =
+        _mm_cmpestri(ranges, 4, octets, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_LEAST_SIGNIFICANT);
+
+    if (16 != index) {
+      return start + index;
+    }
+
+    start += 16;
+  }
+
+  return SkipFieldContentScalar(start, end);
+}
+
+__attribute__((target("sse4.2"))) static const unsigned char *SkipTokenSSE42(const unsigned char *start,
+                                                                             const unsigned char *end) {
+  return SkipTokenBlocks(start, end);
+}
+
+__attribute__((target("sse4.2"))) static const unsigned char *SkipFieldContentSSE42(const unsigned char *start,
+                                                                                    const unsigned char *end) {
+  return SkipFieldContentBlocks(start, end);
+}
+
+__attribute__((target("avx2"))) static const unsigned char *SkipTokenAVX2(const unsigned char *start,
+                                                                          const unsigned char *end) {
+  const __m256i lowNibbles = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)TokenLowNibbles));
+  const __m256i highNibbles = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)TokenHighNibbles));
+  const __m256i nibbleMask = _mm256_set1_epi8(0x0F);
+  const __m256i zero = _mm256_setzero_si256();
+
+  while (32 <= end - start) {
+    const __m256i octets = _mm256_loadu_si256((const __m256i *)start);
+    const __m256i low = _mm256_shuffle_epi8(lowNibbles, _mm256_and_si256(octets, nibbleMask));
+    const __m256i high = _mm256_shuffle_epi8(highNibbles, _mm256_and_si256(_mm256_srli_epi16(octets, 4), nibbleMask));
+    const ESB::UInt32 stops = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(low, high), zero));
+
+    if (stops) {
+      return start + __builtin_ctz(stops);
+    }
+
+    start += 32;
+  }
+
+  return SkipTokenBlocks(start, end);
+}
+
+__attribute__((target("avx2"))) static const unsigned char *SkipFieldContentAVX2(const unsigned char *start,
+                                                                                 const unsigned char *end) {
+  const __m256i space = _mm256_set1_epi8(' ');
+  const __m256i del = _mm256_set1_epi8(0x7F);
+
+  while (32 <= end - start) {
+    const __m256i octets = _mm256_loadu_si256((const __m256i *)start);
+    // octet <= ' ' (unsigned) iff min(octet, ' ') == octet
+    const __m256i controls = _mm256_cmpeq_epi8(_mm256_min_epu8(octets, space), octets);
+    const ESB::UInt32 stops = _mm256_movemask_epi8(_mm256_or_si256(controls, _mm256_cmpeq_epi8(octets, del)));
+
+    if (stops) {
+      return start + __builtin_ctz(stops);
+    }
+
+    start += 32;
+  }
+
+  return SkipFieldContentBlocks(start, end);
+}
+
+#endif
+
+HttpScanner::SkipFunction HttpScanner::_SkipToken = SkipTokenScalar;
+HttpScanner::SkipFunction HttpScanner::_SkipFieldContent = SkipFieldContentScalar;
+HttpScanner::Implementation HttpScanner::_Selected = ES_HTTP_SCANNER_SCALAR;
+
+// Upgrade from the scalar implementation once the process starts.
+static ESB::Error Selection = HttpScanner::Select(HttpScanner::Best());
+
+HttpScanner::Implementation HttpScanner::Best() {
+  if (Supported(ES_HTTP_SCANNER_AVX2)) {
+    return ES_HTTP_SCANNER_AVX2;
+  }
+
+  if (Supported(ES_HTTP_SCANNER_SSE42)) {
+    return ES_HTTP_SCANNER_SSE42;
+  }
+
+  return ES_HTTP_SCANNER_SCALAR;
+}
+
+bool HttpScanner::Supported(Implementation implementation) {
+  switch (implementation) {
+    case ES_HTTP_SCANNER_SCALAR:
+      return true;
+#ifdef HAVE_X86_SIMD_DISPATCH
+    case ES_HTTP_SCANNER_SSE42:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("sse4.2");
+    case ES_HTTP_SCANNER_AVX2:
+      __builtin_cpu_init();
+      return __builtin_cpu_supports("sse4.2") && __builtin_cpu_supports("avx2");
+#endif
+    default:
+      return false;
+  }
+}
+
+ESB::Error HttpScanner::Select(Implementation implementation) {
+  if (!Supported(implementation)) {
+    return ESB_OPERATION_NOT_SUPPORTED;
+  }
+
+  switch (implementation) {
+#ifdef HAVE_X86_SIMD_DISPATCH
+    case ES_HTTP_SCANNER_AVX2:
+      _SkipToken = SkipTokenAVX2;
+      _SkipFieldContent = SkipFieldContentAVX2;
+      break;
+    case ES_HTTP_SCANNER_SSE42:
+      _SkipToken = SkipTokenSSE42;
+      _SkipFieldContent = SkipFieldContentSSE42;
+      break;
+#endif
+    default:
+      _SkipToken = SkipTokenScalar;
+      _SkipFieldContent = SkipFieldContentScalar;
+      break;
+  }
+
+  _Selected = implementation;
+  return ESB_SUCCESS;
+}
+
+const char *HttpScanner::Name(Implementation implementation) {
+  switch (implementation) {
+    case ES_HTTP_SCANNER_SCALAR:
+      return "scalar";
+    case ES_HTTP_SCANNER_SSE42:
+      return "sse4.2";
+    case ES_HTTP_SCANNER_AVX2:
+      return "avx2";
+    default:
+      return "unknown";
+  }
+}
+
+}  // namespace ES
@@ -0,0 +1,108 @@
+#ifndef ES_HTTP_REQUEST_H
+#include <ESHttpRequest.h>
+#endif
+
+#ifndef ESB_DISCARD_ALLOCATOR_H
+#include <ESBDiscardAllocator.h>
+#endif
+
+#include <gtest/gtest.h>
+
+using namespace ES;
+
+TEST(HttpHeader, Tokenize) {
+  EXPECT_EQ(HttpHeader::ES_HTTP_FIELD_HOST, HttpHeader::Tokenize("Host"));
+  EXPECT_EQ(HttpHeader::ES_HTTP_FIELD_HOST, HttpHeader::Tokenize("hOST"));
+  EXPECT_EQ(HttpHeader::ES_HTTP_FIELD_CONTENT_LENGTH, HttpHeader::Tokenize("content-length"));
+  EXPECT_EQ(HttpHeader::ES_HTTP_FIELD_TRANSFER_ENCODING, HttpHeader::Tokenize("Transfer-Encoding"));
+  EXPECT_EQ(HttpHeader::ES_HTTP_FIELD_TE, HttpHeader::Tokenize("te"));
+  EXPECT_EQ(HttpHeader::ES_HTTP_FIELD_UNKNOWN, HttpHeader::Tokenize("Hosts"));
+  EXPECT_EQ(HttpHeader::ES_HTTP_FIELD_UNKNOWN, HttpHeader::Tokenize("X-Custom"));
+  EXPECT_EQ(HttpHeader::ES_HTTP_FIELD_UNKNOWN, HttpHeader::Tokenize(""));
+  EXPECT_EQ(HttpHeader::ES_HTTP_FIELD_UNKNOWN, HttpHeader::Tokenize((const char *)NULL));
+
+  // Field names need not be NULL-terminated
+  EXPECT_EQ(HttpHeader::ES_HTTP_FIELD_CONNECTION, HttpHeader::Tokenize((const unsigned char *)"Connection: close", 10));
+
+  HttpHeader header("Content-Type", "text/plain");
+  EXPECT_EQ(HttpHeader::ES_HTTP_FIELD_CONTENT_TYPE, header.fieldToken());
+  header.setFieldName("X-Custom");
+  EXPECT_EQ(HttpHeader::ES_HTTP_FIELD_UNKNOWN, header.fieldToken());
+}
+
+TEST(HttpMessage, FindHeader) {
+  ESB::DiscardAllocator allocator(1024, sizeof(ESB::Word), 1, ESB::SystemAllocator::Instance(), true);
+  HttpRequest request;
+
+  EXPECT_EQ(NULL, request.findHeader("Host"));
+  EXPECT_EQ(NULL, request.findHeader(HttpHeader::ES_HTTP_FIELD_HOST));
+
+  EXPECT_EQ(ESB_SUCCESS, request.addHeader("X-Custom", "a", allocator));
+  EXPECT_EQ(ESB_SUCCESS, request.addHeader("host", "foo.com", allocator));
+  EXPECT_EQ(ESB_SUCCESS, request.addHeader("Connection", "keep-alive", allocator));
+  EXPECT_EQ(ESB_SUCCESS, request.addHeader("HOST", "bar.com", allocator));
+  EXPECT_EQ(ESB_SUCCESS, request.addHeader("x-custom", "b", allocator));
+
+  // The first header with a given field name wins, regardless of case
+
+  const HttpHeader *header = request.findHeader("Host");
+  ASSERT_TRUE(header);
+  EXPECT_STREQ("foo.com", (const char *)header->fieldValue());
+  EXPECT_EQ(header, request.findHeader(HttpHeader::ES_HTTP_FIELD_HOST));
+
+  header = request.findHeader(HttpHeader::ES_HTTP_FIELD_CONNECTION);
+  ASSERT_TRUE(header);
+  EXPECT_STREQ("keep-alive", (const char *)header->fieldValue());
+
+  header = request.findHeader("X-CUSTOM");
+  ASSERT_TRUE(header);
+  EXPECT_STREQ("a", (const char *)header->fieldValue());
+
+  EXPECT_EQ(NULL, request.findHeader("Content-Length"));
+  EXPECT_EQ(NULL, request.findHeader("X-Missing"));
+
+  // Copies are indexed too
+
+  HttpRequest copy;
+  EXPECT_EQ(ESB_SUCCESS, copy.copy(&request, allocator));
+  header = copy.findHeader(HttpHeader::ES_HTTP_FIELD_HOST);
+  ASSERT_TRUE(header);
+  EXPECT_STREQ("foo.com", (const char *)header->fieldValue());
+
+  request.reset();
+  EXPECT_EQ(NULL, request.findHeader("Host"));
+  EXPECT_EQ(NULL, request.findHeader(HttpHeader::ES_HTTP_FIELD_CONNECTION));
+  EXPECT_EQ(NULL, request.findHeader("X-Custom"));
+}
+
+TEST(HttpMessage, RenameHeader) {
+  ESB::DiscardAllocator allocator(1024, sizeof(ESB::Word), 1, ESB::SystemAllocator::Instance(), true);
+  HttpRequest request;
+
+  EXPECT_EQ(ESB_SUCCESS, request.addHeader("Host", "foo.com", allocator));
+  EXPECT_EQ(ESB_SUCCESS, request.addHeader("X-Host", "bar.com", allocator));
+  EXPECT_EQ(ESB_SUCCESS, request.addHeader("Host", "baz.com", allocator));
+
+  // The next header with the old field name takes over the index
+  request.renameHeader((HttpHeader *)request.findHeader(HttpHeader::ES_HTTP_FIELD_HOST), "X-Old-Host");
+  const HttpHeader *header = request.findHeader(HttpHeader::ES_HTTP_FIELD_HOST);
+  ASSERT_TRUE(header);
+  EXPECT_STREQ("baz.com", (const char *)header->fieldValue());
+  header = request.findHeader("X-Old-Host");
+  ASSERT_TRUE(header);
+  EXPECT_STREQ("foo.com", (const char *)header->fieldValue());
+
+  // A header renamed to a well-known field name is indexed if it comes first
+  request.renameHeader((HttpHeader *)request.findHeader("X-Host"), "Host");
+  header = request.findHeader("Host");
+  ASSERT_TRUE(header);
+  EXPECT_STREQ("bar.com", (const char *)header->fieldValue());
+  EXPECT_EQ(NULL, request.findHeader("X-Host"));
+
+  request.renameHeader(request.lastHeader(), "Content-Type");
+  header = request.findHeader(HttpHeader::ES_HTTP_FIELD_CONTENT_TYPE);
+  ASSERT_TRUE(header);
+  EXPECT_STREQ("baz.com", (const char *)header->fieldValue());
+  EXPECT_EQ(request.findHeader("Host"), request.findHeader(HttpHeader::ES_HTTP_FIELD_HOST));
+  EXPECT_STREQ("bar.com", (const char *)request.findHeader("Host")->fieldValue());
+}
@@ -0,0 +1,95 @@
+#ifndef ES_HTTP_SCANNER_H
+#include <ESHttpScanner.h>
+#endif
+
+#ifndef ES_HTTP_UTIL_H
+#include <ESHttpUtil.h>
+#endif
+
+#ifndef ESB_RAND_H
+#include <ESBRand.h>
+#endif
+
+#include <gtest/gtest.h>
+
+using namespace ES;
+
+static const HttpScanner::Implementation Implementations[] = {
+    HttpScanner::ES_HTTP_SCANNER_SCALAR, HttpScanner::ES_HTTP_SCANNER_SSE42, HttpScanner::ES_HTTP_SCANNER_AVX2};
+
+static bool IsFieldContent(unsigned char octet) {
+  return (HttpUtil::IsToken(octet) || HttpUtil::IsSeparator(octet) || HttpUtil::IsText(octet)) &&
+         !HttpUtil::IsLWS(octet);
+}
+
+class HttpScannerTest : public ::testing::TestWithParam<HttpScanner::Implementation> {
+ public:
+  virtual void SetUp() {
+    if (!HttpScanner::Supported(GetParam())) {
+      GTEST_SKIP() << HttpScanner::Name(GetParam()) << " is not supported by this CPU";
+    }
+    ASSERT_EQ(ESB_SUCCESS, HttpScanner::Select(GetParam()));
+  }
+
+  virtual void TearDown() { HttpScanner::Select(HttpScanner::Best()); }
+};
+
+INSTANTIATE_TEST_SUITE_P(Implementations, HttpScannerTest, ::testing::ValuesIn(Implementations));
+
+TEST_P(HttpScannerTest, EveryOctetAtEveryPosition) {
+  unsigned char buffer[80];
+
+  for (ESB::UInt32 length = 1; length <= sizeof(buffer); ++length) {
+    for (ESB::UInt32 position = 0; position < length; ++position) {
+      for (int octet = 0; octet < 256; ++octet) {
+        memset(buffer, 'a', sizeof(buffer));
+        buffer[position] = octet;
+
+        const unsigned char *expected = HttpUtil::IsToken(octet) ? buffer + length : buffer + position;
+        ASSERT_EQ(expected, HttpScanner::SkipToken(buffer, buffer + length)) << "octet " << octet << " at " << position;
+
+        expected = IsFieldContent(octet) ? buffer + length : buffer + position;
+        ASSERT_EQ(expected, HttpScanner::SkipFieldContent(buffer, buffer + length))
+            << "octet " << octet << " at " << position;
+      }
+    }
+  }
+}
+
+TEST_P(HttpScannerTest, RandomRuns) {
+  // Mostly valid octets with an occasional stop octet, so runs span multiple blocks
+  const char *valid = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_.!#$%&'*+^`|~";
+  const char *stops = ":;()<>@,\\\"/[]?={} \t\r\n\x7F\x80";
+  const ESB::UInt32 validLength = strlen(valid);
+  const ESB::UInt32 stopsLength = strlen(stops);
+  const ESB::UInt32 bufferLength = 256;
+  ESB::Rand rand(42);
+  unsigned char buffer[bufferLength];
+
+  for (int i = 0; i < 10000; ++i) {
+    for (ESB::UInt32 j = 0; j < bufferLength; ++j) {
+      buffer[j] = 1 == rand.generate(1, 64) ? stops[rand.generate(0U, stopsLength - 1)]
+                                            : valid[rand.generate(0U, validLength - 1)];
+    }
+
+    const ESB::UInt32 start = rand.generate(0U, bufferLength - 1);
+    const ESB::UInt32 end = rand.generate(start, bufferLength);
+
+    const unsigned char *expected = buffer + start;
+    while (expected < buffer + end && HttpUtil::IsToken(*expected)) {
+      ++expected;
+    }
+    ASSERT_EQ(expected, HttpScanner::SkipToken(buffer + start, buffer + end));
+
+    expected = buffer + start;
+    while (expected < buffer + end && IsFieldContent(*expected)) {
+      ++expected;
+    }
+    ASSERT_EQ(expected, HttpScanner::SkipFieldContent(buffer + start, buffer + end));
+  }
+}
+
+TEST(HttpScanner, BestIsSupported) {
+  EXPECT_TRUE(HttpScanner::Supported(HttpScanner::Best()));
+  EXPECT_EQ(HttpScanner::Best(), HttpScanner::Selected());
+}
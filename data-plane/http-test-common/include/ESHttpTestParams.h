@@ -40,6 +40,11 @@ class HttpTestParams {
     return *this;
   }
 
+  inline HttpTestParams &metricsPort(ESB::UInt16 port) {
+    _metricsPort = port;
+    return *this;
+  }
+
   inline HttpTestParams &destinationPort(ESB::UInt16 port) {
     _destinationPort = port;
     return *this;
@@ -60,6 +65,12 @@ class HttpTestParams {
     return *this;
   }
 
+  // The number of proxy threads that accept connections, 0 for all of them
+  inline HttpTestParams &proxyListeners(ESB::UInt32 proxyListeners) {
+    _proxyListeners = proxyListeners;
+    return *this;
+  }
+
   inline HttpTestParams &connections(ESB::UInt32 connections) {
     _connections = connections;
     return *this;
@@ -156,6 +167,8 @@ class HttpTestParams {
 
   inline ESB::UInt16 originPort() const { return _originPort; }
 
+  inline ESB::UInt16 metricsPort() const { return _metricsPort; }
+
   inline ESB::UInt16 destinationPort() const { return _destinationPort; }
 
   inline ESB::UInt32 clientThreads() const { return _clientThreads; }
@@ -164,6 +177,8 @@ class HttpTestParams {
 
   inline ESB::UInt32 proxyThreads() const { return _proxyThreads; }
 
+  inline ESB::UInt32 proxyListeners() const { return _proxyListeners; }
+
   inline ESB::UInt32 connections() const { return _connections; }
 
   inline ESB::UInt32 requestsPerConnection() const { return _requestsPerConnection; }
@@ -253,10 +268,12 @@ class HttpTestParams {
  private:
   ESB::UInt16 _proxyPort;
   ESB::UInt16 _originPort;
+  ESB::UInt16 _metricsPort;
   ESB::UInt16 _destinationPort;
   ESB::UInt32 _clientThreads;
   ESB::UInt32 _originThreads;
   ESB::UInt32 _proxyThreads;
+  ESB::UInt32 _proxyListeners;
   ESB::UInt32 _connections;
   ESB::UInt32 _requestsPerConnection;
   ESB::UInt64 _requestSize;
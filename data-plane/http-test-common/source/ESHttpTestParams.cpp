@@ -24,9 +24,11 @@ namespace ES {
 HttpTestParams::HttpTestParams()
     : _proxyPort(0),
       _originPort(0),
+      _metricsPort(0),
       _clientThreads(1),
       _originThreads(1),
       _proxyThreads(1),
+      _proxyListeners(0),
       _connections(1),
       _requestsPerConnection(1),
       _requestSize(0),
@@ -63,6 +65,7 @@ void HttpTestParams::printUsage(const char *progName) const {
   fprintf(stderr, "\t--requestsPerConnection <number, default %u>\n", requestsPerConnection());
   fprintf(stderr, "\t--proxyPort <number, default %u (0 means use any free ephemeral)>\n", proxyPort());
   fprintf(stderr, "\t--originPort <number, default %u (0 means use any free ephemeral)>\n", originPort());
+  fprintf(stderr, "\t--metricsPort <number, default %u (0 means do not serve metrics)>\n", metricsPort());
   fprintf(stderr, "\t--destinationAddress <IP addr, default %s>\n", destinationAddress());
   fprintf(stderr, "\t--destinationPort <number, default %u (0 means use any free ephemeral)>\n", destinationPort());
   fprintf(stderr, "\t--reuseConnections <number, default %u>\n", reuseConnections());
@@ -117,6 +120,7 @@ ESB::Error HttpTestParams::override(int argc, char **argv) {
                                       {"port", required_argument, NULL, 't'},
                                       {"proxyPort", required_argument, NULL, 0},
                                       {"originPort", required_argument, NULL, 0},
+                                      {"metricsPort", required_argument, NULL, 0},
                                       {"destinationPort", required_argument, NULL, 0},
                                       {"destinationAddress", required_argument, NULL, 0},
                                       {"secure", required_argument, NULL, 0},
@@ -152,6 +156,8 @@ ESB::Error HttpTestParams::override(int argc, char **argv) {
           proxyPort(atoi(optarg));
         } else if (0 == strcasecmp("originPort", options[idx].name)) {
           originPort(atoi(optarg));
+        } else if (0 == strcasecmp("metricsPort", options[idx].name)) {
+          metricsPort(atoi(optarg));
         } else if (0 == strcasecmp("destinationPort", options[idx].name)) {
           destinationPort(atoi(optarg));
         } else if (0 == strcasecmp("destinationAddress", options[idx].name)) {
@@ -242,10 +248,10 @@ void HttpTestParams::dump() {
       "[params] clientThreads=%u, proxyThreads=%u, originThreads=%u, connections=%u, requestsPerConnection=%u, "
       "secure=%s, reuseConnection=%s, requestSize=%lu, responseSize=%lu, destination=%s:%u, caPath=%s, "
       "serverKeyPath=%s, "
-      "serverCertPath=%s, proxyPort=%u, originPort=%u",
+      "serverCertPath=%s, proxyPort=%u, originPort=%u, metricsPort=%u",
       _clientThreads, _proxyThreads, _originThreads, _connections, _requestsPerConnection, _secure ? "true" : "false",
       _reuseConnections ? "true" : "false", _requestSize, _responseSize, _destinationAddress, _destinationPort, _caPath,
-      _serverKeyPath, _serverCertPath, _proxyPort, _originPort);
+      _serverKeyPath, _serverCertPath, _proxyPort, _originPort, _metricsPort);
 }
 
 const char *HttpTestParams::DescribeDisruptTransaction(HttpTestParams::DisruptTransaction code) {
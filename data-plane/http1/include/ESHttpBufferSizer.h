@@ -0,0 +1,95 @@
+#ifndef ES_HTTP_BUFFER_SIZER_H
+#define ES_HTTP_BUFFER_SIZER_H
+
+#ifndef ES_HTTP_MULTIPLEXER_EXTENDED_H
+#include <ESHttpMultiplexerExtended.h>
+#endif
+
+namespace ES {
+
+/**
+ * Picks the size class of one of a connection's i/o buffers.  Connections start in the smallest size class.  A
+ * buffer moves up a size class when it is jammed or keeps filling up, and moves back down once enough i/o in a row
+ * would have fit in the next smaller size class.  Unread bytes move exactly as Buffer::compact() would move them, so
+ * callers that tolerate compaction tolerate a buffer changing size.
+ */
+class HttpBufferSizer {
+ public:
+  HttpBufferSizer();
+
+  virtual ~HttpBufferSizer();
+
+  inline ESB::UInt32 sizeClass() const { return _sizeClass; }
+
+  /**
+   * Get a buffer from the current size class.
+   *
+   * @param multiplexer The multiplexer that owns the buffers
+   * @return A buffer or NULL if none could be allocated
+   */
+  inline ESB::Buffer *acquire(HttpMultiplexerExtended &multiplexer) { return multiplexer.acquireBuffer(_sizeClass); }
+
+  /**
+   * Never use a size class whose buffers are smaller than this.
+   *
+   * @param multiplexer The multiplexer that owns the buffers
+   * @param bytes The minimum buffer size or 0 for no minimum.  If no size class is large enough, the largest is used.
+   */
+  void setMinimumSize(HttpMultiplexerExtended &multiplexer, ESB::UInt32 bytes);
+
+  /**
+   * Note how full a buffer is after a receive or before a flush.
+   *
+   * @param buffer The buffer
+   */
+  inline void record(const ESB::Buffer *buffer) {
+    // Formatters leave a little room at the end, so close enough to full counts as full
+    if (buffer->writable() <= buffer->capacity() / 8) {
+      ++_fills;
+      _smallUses = 0;
+      return;
+    }
+
+    _fills = 0;
+    if (buffer->readable() <= _smallerSize) {
+      ++_smallUses;
+    } else {
+      _smallUses = 0;
+    }
+  }
+
+  /**
+   * Swap a buffer that has no room left for one from the next larger size class.  The unread bytes are copied to the
+   * start of the new buffer as Buffer::compact() would leave them.
+   *
+   * @param multiplexer The multiplexer that owns the buffers
+   * @param buffer The buffer, replaced on success
+   * @param jammed true if the buffer must grow for the caller to make any progress, false to only grow if the buffer
+   * keeps filling up.
+   * @return true if the buffer was replaced, false if it should be compacted instead.
+   */
+  bool grow(HttpMultiplexerExtended &multiplexer, ESB::Buffer **buffer, bool jammed);
+
+  /**
+   * Swap an empty buffer for one from the next smaller size class if recent i/o would have fit in it.
+   *
+   * @param multiplexer The multiplexer that owns the buffers
+   * @param buffer The buffer, replaced on success
+   */
+  void shrink(HttpMultiplexerExtended &multiplexer, ESB::Buffer **buffer);
+
+ private:
+  void setSizeClass(HttpMultiplexerExtended &multiplexer, ESB::UInt32 sizeClass);
+
+  ESB::UInt32 _sizeClass;
+  ESB::UInt32 _minSizeClass;
+  ESB::UInt32 _smallerSize;
+  ESB::UInt32 _fills;
+  ESB::UInt32 _smallUses;
+
+  ESB_DEFAULT_FUNCS(HttpBufferSizer);
+};
+
+}  // namespace ES
+
+#endif
@@ -27,6 +27,21 @@ class HttpClientCounters {
 
   virtual const ESB::PerformanceCounter *getFailures() const = 0;
 
+  /**
+   * Latency from the start of a transaction until its connection is established.  Transactions that reuse a pooled
+   * connection are not recorded.
+   */
+  virtual ESB::PerformanceCounter *getConnects() = 0;
+
+  virtual const ESB::PerformanceCounter *getConnects() const = 0;
+
+  /**
+   * Latency from the start of a transaction until its response headers have been received.
+   */
+  virtual ESB::PerformanceCounter *getTimeToFirstByte() = 0;
+
+  virtual const ESB::PerformanceCounter *getTimeToFirstByte() const = 0;
+
   ESB_DISABLE_AUTO_COPY(HttpClientCounters);
 };
 
@@ -98,6 +98,19 @@ class HttpClientHandler {
                                          const unsigned char *body, ESB::UInt64 bytesOffered,
                                          ESB::UInt64 *bytesConsumed) = 0;
 
+  /**
+   * Optionally move the response body from the origin to its destination without copying it through the client
+   * stream's receive buffer (e.g., with splice(2)).  Called before consumeResponseBody() whenever the client stream's
+   * receive buffer is empty.  The default implementation declines.
+   *
+   * @param multiplexer An API for the thread's multiplexer
+   * @param clientStream The client stream, including request and response objects
+   * @return ESB_SUCCESS if the entire body was moved, ESB_OPERATION_NOT_SUPPORTED to fall back to
+   * consumeResponseBody(), ESB_AGAIN or ESB_PAUSE if more of the body cannot be moved yet, another error code
+   * otherwise.  Any other error code will abort the current transaction.
+   */
+  virtual ESB::Error spliceResponseBody(HttpMultiplexer &multiplexer, HttpClientStream &clientStream);
+
   /**
    * Handle the end of a request (request body has been fully sent)
    *
@@ -35,9 +35,19 @@ class HttpClientHistoricalCounters : public HttpClientCounters {
 
   virtual const ESB::PerformanceCounter *getFailures() const;
 
+  virtual ESB::PerformanceCounter *getConnects();
+
+  virtual const ESB::PerformanceCounter *getConnects() const;
+
+  virtual ESB::PerformanceCounter *getTimeToFirstByte();
+
+  virtual const ESB::PerformanceCounter *getTimeToFirstByte() const;
+
  private:
   ESB::TimeSeries _successes;
   ESB::TimeSeries _failures;
+  ESB::TimeSeries _connects;
+  ESB::TimeSeries _timeToFirstByte;
 
   ESB_DEFAULT_FUNCS(HttpClientHistoricalCounters);
 };
@@ -5,8 +5,8 @@
 #include <ESHttpClientCounters.h>
 #endif
 
-#ifndef ESB_SIMPLE_PERFORMANCE_COUNTER_H
-#include <ESBSimplePerformanceCounter.h>
+#ifndef ESB_HISTOGRAM_PERFORMANCE_COUNTER_H
+#include <ESBHistogramPerformanceCounter.h>
 #endif
 
 namespace ES {
@@ -27,9 +27,19 @@ class HttpClientSimpleCounters : public HttpClientCounters {
 
   virtual const ESB::PerformanceCounter *getFailures() const;
 
+  virtual ESB::PerformanceCounter *getConnects();
+
+  virtual const ESB::PerformanceCounter *getConnects() const;
+
+  virtual ESB::PerformanceCounter *getTimeToFirstByte();
+
+  virtual const ESB::PerformanceCounter *getTimeToFirstByte() const;
+
  private:
-  ESB::SimplePerformanceCounter _successes;
-  ESB::SimplePerformanceCounter _failures;
+  ESB::HistogramPerformanceCounter _successes;
+  ESB::HistogramPerformanceCounter _failures;
+  ESB::HistogramPerformanceCounter _connects;
+  ESB::HistogramPerformanceCounter _timeToFirstByte;
 
   ESB_DEFAULT_FUNCS(HttpClientSimpleCounters);
 };
@@ -29,6 +29,10 @@
 #include <ESHttpMultiplexerExtended.h>
 #endif
 
+#ifndef ES_HTTP_BUFFER_SIZER_H
+#include <ESHttpBufferSizer.h>
+#endif
+
 namespace ES {
 
 /** A socket that receives and echoes back HTTP requests
@@ -144,6 +148,7 @@ class HttpClientSocket : public HttpSocket, public HttpClientStream {
   virtual ESB::Error sendRequestBody(unsigned const char *chunk, ESB::UInt64 bytesOffered, ESB::UInt64 *bytesConsumed);
   virtual ESB::Error responseBodyAvailable(ESB::UInt64 *bytesAvailable);
   virtual ESB::Error readResponseBody(unsigned char *chunk, ESB::UInt64 bytesRequested, ESB::UInt64 *bytesRead);
+  virtual ESB::Error spliceResponseBody(ESB::SocketSplicer &splicer, ESB::UInt64 *bytesRead);
 
   //
   // ESB::EmbeddedMapElement (for connection pool lookups)
@@ -241,6 +246,8 @@ class HttpClientSocket : public HttpSocket, public HttpClientStream {
   ESB::CleanupHandler &_cleanupHandler;
   ESB::Buffer *_recvBuffer;
   ESB::Buffer *_sendBuffer;
+  HttpBufferSizer _recvBufferSizer;
+  HttpBufferSizer _sendBufferSizer;
   ESB::ConnectedSocket *_socket;
   static bool _ReuseConnections;
 
@@ -45,10 +45,12 @@ class HttpClientSocketFactory {
  public:
   /** Constructor
    *
+   * @param connectionPools If not NULL, the factory's connection pool joins this group and may take idle connections
+   * from the pools of other multiplexers.
    */
   HttpClientSocketFactory(HttpMultiplexerExtended &multiplexer, HttpClientHandler &handler,
                           HttpClientCounters &counters, ESB::ClientTLSContextIndex &contextIndex,
-                          ESB::Allocator &allocator);
+                          ESB::ConnectionPool::Group *connectionPools, ESB::Allocator &allocator);
 
   /** Destructor.
    */
@@ -84,6 +86,8 @@ class HttpClientSocketFactory {
    */
   void release(HttpClientSocket *socket);
 
+  inline ESB::ConnectionPool &connectionPool() { return _connectionPool; }
+
  private:
   const char *name() const;
 
@@ -0,0 +1,161 @@
+#ifndef ES_HTTP_CONNECTION_WARMER_H
+#define ES_HTTP_CONNECTION_WARMER_H
+
+#ifndef ES_HTTP_MULTIPLEXER_EXTENDED_H
+#include <ESHttpMultiplexerExtended.h>
+#endif
+
+#ifndef ES_HTTP_CONFIG_H
+#include <ESHttpConfig.h>
+#endif
+
+#ifndef ESB_CONNECTION_POOL_H
+#include <ESBConnectionPool.h>
+#endif
+
+#ifndef ESB_MULTIPLEXED_SOCKET_H
+#include <ESBMultiplexedSocket.h>
+#endif
+
+#ifndef ESB_TIMER_H
+#include <ESBTimer.h>
+#endif
+
+#ifndef ESB_EMBEDDED_LIST_H
+#include <ESBEmbeddedList.h>
+#endif
+
+namespace ES {
+
+/** Keeps a multiplexer's connection pool stocked with established connections to HttpConfig's warm destinations, so
+ * the first requests to them after startup or a quiet period do not wait for TCP and TLS handshakes.
+ *
+ * A periodic timer opens connections until each destination has its minimum number of idle and establishing
+ * connections, and closes the least recently used idle connections beyond its maximum.  Connections are handed to the
+ * connection pool once their handshakes complete.  Hostnames are resolved with the multiplexer's DNS client, so a
+ * destination is only warmed once its address is cached.
+ *
+ * All functions must be called from the multiplexer's thread.
+ */
+class HttpConnectionWarmer : public ESB::Timer {
+ public:
+  /** Constructor.
+   *
+   * @param multiplexer The multiplexer that will drive the handshakes
+   * @param connectionPool The connection pool to stock
+   * @param allocator The allocator to use for in-flight connections
+   */
+  HttpConnectionWarmer(HttpMultiplexerExtended &multiplexer, ESB::ConnectionPool &connectionPool,
+                       ESB::Allocator &allocator);
+
+  /** Destructor.  Connections still establishing must already have been removed from the multiplexer.
+   */
+  virtual ~HttpConnectionWarmer();
+
+  /** Warm the destinations configured in HttpConfig.  Does nothing if there are none.
+   *
+   * @return ESB_SUCCESS if successful, another error code otherwise.
+   */
+  ESB::Error start();
+
+  /** The number of connections opened ahead of demand that are still completing their handshakes.
+   *
+   * @return The number of establishing connections
+   */
+  inline ESB::UInt32 pendingConnections() const { return _pendingConnections; }
+
+  inline ESB::UInt32 openedConnections() const { return _openedConnections; }
+
+  inline ESB::UInt32 retiredConnections() const { return _retiredConnections; }
+
+  //
+  // ESB::Timer
+  //
+
+  virtual void handleExpiration();
+
+ private:
+  // Drives a new connection's TCP and TLS handshakes, then returns it to the connection pool.
+  class WarmingSocket : public ESB::MultiplexedSocket {
+   public:
+    WarmingSocket(HttpConnectionWarmer &warmer, ESB::UInt32 destination, ESB::ConnectedSocket *socket);
+    virtual ~WarmingSocket();
+
+    inline ESB::UInt32 destination() const { return _destination; }
+
+    inline ESB::ConnectedSocket *socket() const { return _socket; }
+
+    inline bool established() const { return _established; }
+
+    virtual bool permanent();
+    virtual bool wantAccept();
+    virtual bool wantConnect();
+    virtual bool wantRead();
+    virtual bool wantWrite();
+    virtual ESB::Error handleAccept();
+    virtual ESB::Error handleConnect();
+    virtual ESB::Error handleReadable();
+    virtual ESB::Error handleWritable();
+    virtual void handleError(ESB::Error error);
+    virtual void handleRemoteClose();
+    virtual void handleIdle();
+    virtual void handleRemove();
+    virtual SOCKET socketDescriptor() const;
+    virtual ESB::CleanupHandler *cleanupHandler();
+    virtual const void *key() const;
+    virtual const char *name() const;
+    virtual void markDead();
+    virtual bool dead() const;
+
+   private:
+    ESB::Error handshake();
+
+    HttpConnectionWarmer &_warmer;
+    const ESB::UInt32 _destination;
+    ESB::ConnectedSocket *_socket;
+    bool _connecting;
+    bool _established;
+    bool _dead;
+
+    ESB_DEFAULT_FUNCS(WarmingSocket);
+  };
+
+  // Returns warming sockets to the warmer for reuse
+  class CleanupHandler : public ESB::CleanupHandler {
+   public:
+    CleanupHandler(HttpConnectionWarmer &warmer);
+    virtual ~CleanupHandler();
+
+    virtual void destroy(ESB::Object *object);
+
+   private:
+    HttpConnectionWarmer &_warmer;
+
+    ESB_DISABLE_AUTO_COPY(CleanupHandler);
+  };
+
+  void warm(ESB::UInt32 index, const HttpConfig::WarmDestination &destination);
+
+  ESB::Error open(ESB::UInt32 index, const char *fqdn, const ESB::SocketAddress &address);
+
+  void release(WarmingSocket *socket);
+
+  const char *name() const;
+
+  HttpMultiplexerExtended &_multiplexer;
+  ESB::ConnectionPool &_connectionPool;
+  ESB::Allocator &_allocator;
+  ESB::UInt32 _destinations;
+  ESB::UInt32 _pendingConnections;
+  ESB::UInt32 _openedConnections;
+  ESB::UInt32 _retiredConnections;
+  ESB::UInt32 _pending[ES_HTTP_MAX_WARM_DESTINATIONS];
+  ESB::EmbeddedList _deconstructedSockets;
+  CleanupHandler _cleanupHandler;
+
+  ESB_DEFAULT_FUNCS(HttpConnectionWarmer);
+};
+
+}  // namespace ES
+
+#endif
@@ -93,6 +93,14 @@ class HttpMessageFormatter {
    */
   ESB::Error endBody(ESB::Buffer *outputBuffer);
 
+  /**
+   * Determine whether the body is being formatted without any transfer encoding, so body bytes can be written to the
+   * socket as is.
+   *
+   * @return true if the headers have been formatted and the body is not chunked, false otherwise.
+   */
+  bool unencodedBody() const;
+
  protected:
   virtual ESB::Error formatStartLine(ESB::Buffer *outputBuffer, const HttpMessage &message) = 0;
 
@@ -78,6 +78,25 @@ class HttpMessageParser {
 
   ESB::Error consumeBody(ESB::Buffer *inputBuffer, ESB::UInt64 bytesConsumed);
 
+  /**
+   * Get the number of body bytes that have not been consumed yet, if the body length was given by a Content-Length
+   * header.
+   *
+   * @param bytesRemaining If ESB_SUCCESS is returned, this will be set to the number of body bytes still to be read
+   * @return ESB_SUCCESS if successful, ESB_OPERATION_NOT_SUPPORTED if the body is chunked, multipart, or delimited by
+   * the connection close, another error code otherwise.
+   */
+  ESB::Error bodyBytesRemaining(ESB::UInt64 *bytesRemaining) const;
+
+  /**
+   * Account for Content-Length body bytes that were read from the socket without passing through the input buffer
+   * (e.g., spliced directly to another socket).
+   *
+   * @param bytesSkipped The number of body bytes read.  Must be <= the result of bodyBytesRemaining().
+   * @return ESB_SUCCESS if successful, another error code otherwise.
+   */
+  ESB::Error skipBody(ESB::UInt64 bytesSkipped);
+
   /**
    * Skips any body trailer.  Necessary only if the connection will be reused.
    *
@@ -137,6 +156,15 @@ class HttpMessageParser {
 
   ESB::Error postParse(HttpMessage &message);
 
+  /**
+   * Move a run of octets that need no further interpretation from the input buffer into the working buffer in bulk.
+   *
+   * @param inputBuffer The input buffer
+   * @param skip Finds the end of the run, e.g., HttpScanner::SkipToken
+   */
+  void copyRun(ESB::Buffer *inputBuffer,
+               const unsigned char *(*skip)(const unsigned char *start, const unsigned char *end));
+
   ESB_DISABLE_AUTO_COPY(HttpMessageParser);
 };
 
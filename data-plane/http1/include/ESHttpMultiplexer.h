@@ -5,6 +5,14 @@
 #include <ESHttpClientTransaction.h>
 #endif
 
+#ifndef ESB_DNS_CLIENT_H
+#include <ESBDnsClient.h>
+#endif
+
+#ifndef ESB_SOCKET_SPLICER_H
+#include <ESBSocketSplicer.h>
+#endif
+
 namespace ES {
 
 class HttpMultiplexer {
@@ -37,6 +45,22 @@ class HttpMultiplexer {
 
   virtual void destroyClientTransaction(HttpClientTransaction *transaction) = 0;
 
+  /**
+   * Get the multiplexer's DNS client.  Lookups that cannot be answered from
+   * its cache complete asynchronously in the multiplexer's thread.
+   *
+   * @return The DNS client
+   */
+  virtual ESB::DnsClient &dnsClient() = 0;
+
+  /**
+   * Get the multiplexer's idle splice pipes, which transactions running in
+   * the multiplexer's thread share instead of each creating a pipe.
+   *
+   * @return The pipe pool
+   */
+  virtual ESB::SocketSplicer::PipePool &splicePipes() = 0;
+
   ESB_DISABLE_AUTO_COPY(HttpMultiplexer);
 };
 
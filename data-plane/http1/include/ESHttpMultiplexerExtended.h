@@ -37,14 +37,26 @@ class HttpMultiplexerExtended : public HttpMultiplexer {
   virtual ~HttpMultiplexerExtended();
 
   /** Get a buffer suitable for i/o operations.
+   *
+   * @param sizeClass The buffer's size class.  0 is the smallest.  Larger values than bufferSizeClasses() - 1 get the
+   * largest buffers.
+   * @return A buffer or NULL if none could be allocated
    */
-  virtual ESB::Buffer *acquireBuffer() = 0;
+  virtual ESB::Buffer *acquireBuffer(ESB::UInt32 sizeClass) = 0;
 
   /**
-   * Return an i/o buffer for later reuse.
+   * Return an i/o buffer of any size class for later reuse.
    */
   virtual void releaseBuffer(ESB::Buffer *buffer) = 0;
 
+  /** Get the number of i/o buffer size classes.
+   */
+  virtual ESB::UInt32 bufferSizeClasses() const = 0;
+
+  /** Get the capacity of the i/o buffers in a size class.
+   */
+  virtual ESB::UInt32 bufferSize(ESB::UInt32 sizeClass) const = 0;
+
   virtual HttpServerTransaction *createServerTransaction() = 0;
 
   virtual void destroyServerTransaction(HttpServerTransaction *transaction) = 0;
@@ -55,10 +67,21 @@ class HttpMultiplexerExtended : public HttpMultiplexer {
    * Construct a new server socket and immediately add it to a multiplexer.
    *
    * @param state The os-level socket state including a live file descriptor.
-   * @return ESB_SUCCESS if successful, another error code otherwise.
+   * @return ESB_SUCCESS if successful, ESB_CLOSED if the server handler's beginConnection() rejected the connection,
+   * another error code otherwise.
    */
   virtual ESB::Error addServerSocket(ESB::Socket::State &state) = 0;
 
+  /**
+   * Take a connection that was just accepted by one of this multiplexer's listening sockets.  The multiplexer may add
+   * it to itself or hand it to another multiplexer that is less loaded.
+   *
+   * @param state The os-level socket state including a live file descriptor.
+   * @return ESB_SUCCESS if successful, ESB_CLOSED if the server handler's beginConnection() rejected the connection,
+   * another error code otherwise.
+   */
+  virtual ESB::Error acceptServerSocket(ESB::Socket::State &state) = 0;
+
   /**
    * Construct a new listening socket and immediately add it to the multiplexer
    *
@@ -30,6 +30,13 @@ class HttpServerCounters {
 
   virtual const ESB::PerformanceCounter *getSuccessfulTransactions() const = 0;
 
+  /**
+   * Latency from the start of a transaction until its response headers have been sent.
+   */
+  virtual ESB::PerformanceCounter *getTimeToFirstByte() = 0;
+
+  virtual const ESB::PerformanceCounter *getTimeToFirstByte() const = 0;
+
   virtual ESB::PerformanceCounter *getRequestHeaderErrors() = 0;
 
   virtual const ESB::PerformanceCounter *getRequestHeaderErrors() const = 0;
@@ -40,6 +40,33 @@ class HttpServerHandler {
    */
   virtual ESB::Error acceptConnection(HttpMultiplexer &multiplexer, ESB::SocketAddress *address) = 0;
 
+  /**
+   * Handle the beginning of a connection.  This is called once the accepted
+   * connection has a server stream on the multiplexer that will run it, before
+   * that stream is added to the multiplexer.  Put per-connection
+   * initialization here and keep its state in the stream's connection context.
+   * The default implementation does nothing.
+   *
+   * @param multiplexer An API for the thread's multiplexer
+   * @param serverStream The server stream.  Only its connection context and
+   * addresses may be used since no transaction has begun.
+   * @return ESB_SUCCESS to continue processing, or any other value to
+   * immediately close the socket.  endConnection() is not called if this
+   * fails, so clean up before returning an error.
+   */
+  virtual ESB::Error beginConnection(HttpMultiplexer &multiplexer, HttpServerStream &serverStream);
+
+  /**
+   * Handle the end of a connection.  This is called once for every connection
+   * that beginConnection() accepted, after its last transaction has ended.
+   * The default implementation does nothing.
+   *
+   * @param multiplexer An API for the thread's multiplexer
+   * @param serverStream The server stream.  Only its connection context and
+   * addresses may be used.
+   */
+  virtual void endConnection(HttpMultiplexer &multiplexer, HttpServerStream &serverStream);
+
   /**
    * Handle the beginning of a transaction.  This will be called 1+ times after
    * a connection has been accepted (>1 when connections are reused).  Put your
@@ -13,8 +13,8 @@
 #include <ESHttpServerCounters.h>
 #endif
 
-#ifndef ES_SIMPLE_PERFORMANCE_COUNTER_H
-#include <ESBSimplePerformanceCounter.h>
+#ifndef ESB_HISTOGRAM_PERFORMANCE_COUNTER_H
+#include <ESBHistogramPerformanceCounter.h>
 #endif
 
 namespace ES {
@@ -31,6 +31,10 @@ class HttpServerSimpleCounters : public HttpServerCounters {
 
   virtual const ESB::PerformanceCounter *getSuccessfulTransactions() const;
 
+  virtual ESB::PerformanceCounter *getTimeToFirstByte();
+
+  virtual const ESB::PerformanceCounter *getTimeToFirstByte() const;
+
   virtual ESB::PerformanceCounter *getRequestHeaderErrors();
 
   virtual const ESB::PerformanceCounter *getRequestHeaderErrors() const;
@@ -88,20 +92,21 @@ class HttpServerSimpleCounters : public HttpServerCounters {
   virtual const ESB::SharedAveragingCounter *getAverageTransactionsPerConnection() const;
 
  private:
-  ESB::SimplePerformanceCounter _successfulTransactions;
-
-  ESB::SimplePerformanceCounter _requestHeaderErrors;
-  ESB::SimplePerformanceCounter _requestHeaderFailures;
-  ESB::SimplePerformanceCounter _requestHeaderTimeouts;
-  ESB::SimplePerformanceCounter _requestBodyErrors;
-  ESB::SimplePerformanceCounter _requestBodyFailures;
-  ESB::SimplePerformanceCounter _requestBodyTimeouts;
-  ESB::SimplePerformanceCounter _responseHeaderErrors;
-  ESB::SimplePerformanceCounter _responseHeaderFailures;
-  ESB::SimplePerformanceCounter _responseHeaderTimeouts;
-  ESB::SimplePerformanceCounter _responseBodyErrors;
-  ESB::SimplePerformanceCounter _responseBodyFailures;
-  ESB::SimplePerformanceCounter _responseBodyTimeouts;
+  ESB::HistogramPerformanceCounter _successfulTransactions;
+  ESB::HistogramPerformanceCounter _timeToFirstByte;
+
+  ESB::HistogramPerformanceCounter _requestHeaderErrors;
+  ESB::HistogramPerformanceCounter _requestHeaderFailures;
+  ESB::HistogramPerformanceCounter _requestHeaderTimeouts;
+  ESB::HistogramPerformanceCounter _requestBodyErrors;
+  ESB::HistogramPerformanceCounter _requestBodyFailures;
+  ESB::HistogramPerformanceCounter _requestBodyTimeouts;
+  ESB::HistogramPerformanceCounter _responseHeaderErrors;
+  ESB::HistogramPerformanceCounter _responseHeaderFailures;
+  ESB::HistogramPerformanceCounter _responseHeaderTimeouts;
+  ESB::HistogramPerformanceCounter _responseBodyErrors;
+  ESB::HistogramPerformanceCounter _responseBodyFailures;
+  ESB::HistogramPerformanceCounter _responseBodyTimeouts;
 
   ESB::SharedInt _totalConnections;
   ESB::SharedAveragingCounter _averageTransactionsPerConnection;
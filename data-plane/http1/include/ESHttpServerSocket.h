@@ -25,6 +25,10 @@
 #include <ESHttpMultiplexerExtended.h>
 #endif
 
+#ifndef ES_HTTP_BUFFER_SIZER_H
+#include <ESHttpBufferSizer.h>
+#endif
+
 #ifndef ES_HTTP_SERVER_STREAM_H
 #include <ESHttpServerStream.h>
 #endif
@@ -133,8 +137,12 @@ class HttpServerSocket : public HttpSocket, public HttpServerStream {
                                   HttpMessage::HeaderCopyFilter filter = HttpMessage::HeaderCopyAll);
 
   virtual ESB::Error sendResponseBody(unsigned const char *chunk, ESB::UInt64 bytesOffered, ESB::UInt64 *bytesConsumed);
+  virtual ESB::Error spliceResponseBody(ESB::SocketSplicer &splicer, ESB::UInt64 *bytesSent);
   virtual ESB::Error requestBodyAvailable(ESB::UInt64 *bytesAvailable);
   virtual ESB::Error readRequestBody(unsigned char *chunk, ESB::UInt64 bytesRequested, ESB::UInt64 *bytesRead);
+  virtual void setConnectionContext(void *context);
+  virtual void *connectionContext();
+  virtual const void *connectionContext() const;
 
  private:
   // State machine argument flags
@@ -242,10 +250,13 @@ class HttpServerSocket : public HttpSocket, public HttpServerStream {
   HttpMultiplexerExtended &_multiplexer;
   HttpServerHandler &_handler;
   HttpServerTransaction *_transaction;
+  void *_connectionContext;
   HttpServerCounters &_counters;
   ESB::CleanupHandler &_cleanupHandler;
   ESB::Buffer *_recvBuffer;
   ESB::Buffer *_sendBuffer;
+  HttpBufferSizer _recvBufferSizer;
+  HttpBufferSizer _sendBufferSizer;
   ESB::ConnectedSocket *_socket;
 
   ESB_DEFAULT_FUNCS(HttpServerSocket);
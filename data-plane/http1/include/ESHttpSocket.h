@@ -5,6 +5,18 @@
 #include <ESBMultiplexedSocket.h>
 #endif
 
+#ifndef ESB_CONNECTED_SOCKET_H
+#include <ESBConnectedSocket.h>
+#endif
+
+#ifndef ES_HTTP_MESSAGE_FORMATTER_H
+#include <ESHttpMessageFormatter.h>
+#endif
+
+#ifndef ES_HTTP_MULTIPLEXER_EXTENDED_H
+#include <ESHttpMultiplexerExtended.h>
+#endif
+
 namespace ES {
 
 /**
@@ -20,6 +32,28 @@ class HttpSocket : public ESB::MultiplexedSocket {
    */
   virtual ~HttpSocket();
 
+ protected:
+  /**
+   * Send a chunked body.  A chunk that does not fit in the send buffer would force a flush anyway.  Instead of copying
+   * it in piecemeal, whatever is already buffered (headers, chunk framing) is sent together with the chunk itself in
+   * one vectored send.  Only the part of the chunk the socket did not accept is copied into the send buffer.
+   *
+   * @param multiplexer The multiplexer that owns the socket
+   * @param socket The connected socket
+   * @param formatter The message's formatter, which frames each chunk
+   * @param sendBuffer The send buffer
+   * @param chunk The body data
+   * @param bytesOffered The size of the body data
+   * @param bytesConsumed On return, how much of the body data was sent or copied into the send buffer.  Once this
+   * falls short of bytesOffered, the rest must go through the send buffer.
+   * @param bytesSent On return, how many bytes the socket accepted, including buffered bytes
+   * @return ESB_SUCCESS if successful, another error code otherwise.
+   */
+  static ESB::Error SendBodyVectored(HttpMultiplexerExtended &multiplexer, ESB::ConnectedSocket *socket,
+                                     HttpMessageFormatter *formatter, ESB::Buffer *sendBuffer,
+                                     unsigned const char *chunk, ESB::UInt64 bytesOffered,
+                                     ESB::UInt64 *bytesConsumed, ESB::UInt64 *bytesSent);
+
   ESB_DISABLE_AUTO_COPY(HttpSocket);
 };
 
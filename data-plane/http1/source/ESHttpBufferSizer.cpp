@@ -0,0 +1,79 @@
+#ifndef ES_HTTP_BUFFER_SIZER_H
+#include <ESHttpBufferSizer.h>
+#endif
+
+namespace ES {
+
+// Grow after this many full buffers in a row
+static const ESB::UInt32 GrowAfterFills = 2U;
+// Shrink after this many buffers in a row that would have fit in the next smaller size class
+static const ESB::UInt32 ShrinkAfterSmallUses = 16U;
+
+HttpBufferSizer::HttpBufferSizer() : _sizeClass(0U), _minSizeClass(0U), _smallerSize(0U), _fills(0U), _smallUses(0U) {}
+
+HttpBufferSizer::~HttpBufferSizer() {}
+
+void HttpBufferSizer::setMinimumSize(HttpMultiplexerExtended &multiplexer, ESB::UInt32 bytes) {
+  _minSizeClass = 0U;
+  while (_minSizeClass + 1 < multiplexer.bufferSizeClasses() && multiplexer.bufferSize(_minSizeClass) < bytes) {
+    ++_minSizeClass;
+  }
+
+  if (_sizeClass < _minSizeClass) {
+    setSizeClass(multiplexer, _minSizeClass);
+  }
+}
+
+bool HttpBufferSizer::grow(HttpMultiplexerExtended &multiplexer, ESB::Buffer **buffer, bool jammed) {
+  assert(buffer && *buffer);
+
+  if (_sizeClass + 1 >= multiplexer.bufferSizeClasses()) {
+    return false;
+  }
+
+  if (!jammed && GrowAfterFills > _fills) {
+    return false;
+  }
+
+  ESB::Buffer *larger = multiplexer.acquireBuffer(_sizeClass + 1);
+  if (!larger) {
+    // Fall back to compaction
+    return false;
+  }
+
+  const ESB::UInt32 readable = (*buffer)->readable();
+  assert(readable <= larger->capacity());
+  memcpy(larger->buffer(), (*buffer)->buffer() + (*buffer)->readPosition(), readable);
+  larger->setWritePosition(readable);
+
+  multiplexer.releaseBuffer(*buffer);
+  *buffer = larger;
+  setSizeClass(multiplexer, _sizeClass + 1);
+  return true;
+}
+
+void HttpBufferSizer::shrink(HttpMultiplexerExtended &multiplexer, ESB::Buffer **buffer) {
+  assert(buffer && *buffer);
+
+  if (_minSizeClass >= _sizeClass || ShrinkAfterSmallUses > _smallUses || (*buffer)->isReadable()) {
+    return;
+  }
+
+  ESB::Buffer *smaller = multiplexer.acquireBuffer(_sizeClass - 1);
+  if (!smaller) {
+    return;
+  }
+
+  multiplexer.releaseBuffer(*buffer);
+  *buffer = smaller;
+  setSizeClass(multiplexer, _sizeClass - 1);
+}
+
+void HttpBufferSizer::setSizeClass(HttpMultiplexerExtended &multiplexer, ESB::UInt32 sizeClass) {
+  _sizeClass = sizeClass;
+  _smallerSize = 0 == sizeClass ? 0U : multiplexer.bufferSize(sizeClass - 1);
+  _fills = 0U;
+  _smallUses = 0U;
+}
+
+}  // namespace ES
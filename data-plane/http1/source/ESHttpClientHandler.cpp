@@ -5,4 +5,8 @@
 namespace ES {
 HttpClientHandler::HttpClientHandler() {}
 HttpClientHandler::~HttpClientHandler() {}
+
+ESB::Error HttpClientHandler::spliceResponseBody(HttpMultiplexer &multiplexer, HttpClientStream &clientStream) {
+  return ESB_OPERATION_NOT_SUPPORTED;
+}
 }  // namespace ES
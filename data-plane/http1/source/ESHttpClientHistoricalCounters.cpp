@@ -7,13 +7,17 @@ namespace ES {
 HttpClientHistoricalCounters::HttpClientHistoricalCounters(ESB::UInt16 maxWindows, ESB::UInt16 windowSizeSec,
                                                            ESB::Allocator &allocator)
     : _successes("CLIENT TRANS SUCCESS", maxWindows, windowSizeSec, allocator),
-      _failures("CLIENT TRANS FAILURE", maxWindows, windowSizeSec, allocator) {}
+      _failures("CLIENT TRANS FAILURE", maxWindows, windowSizeSec, allocator),
+      _connects("CLIENT CONNECT", maxWindows, windowSizeSec, allocator),
+      _timeToFirstByte("CLIENT TIME TO FIRST BYTE", maxWindows, windowSizeSec, allocator) {}
 
 HttpClientHistoricalCounters::~HttpClientHistoricalCounters() {}
 
 void HttpClientHistoricalCounters::log(ESB::Logger &logger, ESB::Logger::Severity severity) const {
   _successes.log(logger, severity);
   _failures.log(logger, severity);
+  _connects.log(logger, severity);
+  _timeToFirstByte.log(logger, severity);
 }
 
 ESB::PerformanceCounter *HttpClientHistoricalCounters::getSuccesses() { return &_successes; }
@@ -24,4 +28,12 @@ ESB::PerformanceCounter *HttpClientHistoricalCounters::getFailures() { return &_
 
 const ESB::PerformanceCounter *HttpClientHistoricalCounters::getFailures() const { return &_failures; }
 
+ESB::PerformanceCounter *HttpClientHistoricalCounters::getConnects() { return &_connects; }
+
+const ESB::PerformanceCounter *HttpClientHistoricalCounters::getConnects() const { return &_connects; }
+
+ESB::PerformanceCounter *HttpClientHistoricalCounters::getTimeToFirstByte() { return &_timeToFirstByte; }
+
+const ESB::PerformanceCounter *HttpClientHistoricalCounters::getTimeToFirstByte() const { return &_timeToFirstByte; }
+
 }  // namespace ES
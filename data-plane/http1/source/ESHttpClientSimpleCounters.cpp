@@ -5,13 +5,18 @@
 namespace ES {
 
 HttpClientSimpleCounters::HttpClientSimpleCounters()
-    : _successes("CLIENT TRANS SUCCESS"), _failures("CLIENT TRANS FAILURE") {}
+    : _successes("CLIENT TRANS SUCCESS"),
+      _failures("CLIENT TRANS FAILURE"),
+      _connects("CLIENT CONNECT"),
+      _timeToFirstByte("CLIENT TIME TO FIRST BYTE") {}
 
 HttpClientSimpleCounters::~HttpClientSimpleCounters() {}
 
 void HttpClientSimpleCounters::log(ESB::Logger &logger, ESB::Logger::Severity severity) const {
   _successes.log(logger, severity);
   _failures.log(logger, severity);
+  _connects.log(logger, severity);
+  _timeToFirstByte.log(logger, severity);
 }
 
 ESB::PerformanceCounter *HttpClientSimpleCounters::getSuccesses() { return &_successes; }
@@ -22,4 +27,12 @@ ESB::PerformanceCounter *HttpClientSimpleCounters::getFailures() { return &_fail
 
 const ESB::PerformanceCounter *HttpClientSimpleCounters::getFailures() const { return &_failures; }
 
+ESB::PerformanceCounter *HttpClientSimpleCounters::getConnects() { return &_connects; }
+
+const ESB::PerformanceCounter *HttpClientSimpleCounters::getConnects() const { return &_connects; }
+
+ESB::PerformanceCounter *HttpClientSimpleCounters::getTimeToFirstByte() { return &_timeToFirstByte; }
+
+const ESB::PerformanceCounter *HttpClientSimpleCounters::getTimeToFirstByte() const { return &_timeToFirstByte; }
+
 }  // namespace ES
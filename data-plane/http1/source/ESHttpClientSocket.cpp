@@ -2,6 +2,14 @@
 #include <ESHttpClientSocket.h>
 #endif
 
+#ifndef ESB_TLS_SOCKET_H
+#include <ESBTLSSocket.h>
+#endif
+
+#ifndef ESB_MONOTONIC_TIME_SOURCE_H
+#include <ESBMonotonicTimeSource.h>
+#endif
+
 namespace ES {
 
 // TODO - add performance counters
@@ -190,6 +198,8 @@ HttpClientSocket::HttpClientSocket(bool reused, HttpClientTransaction *transacti
       _cleanupHandler(cleanupHandler),
       _recvBuffer(NULL),
       _sendBuffer(NULL),
+      _recvBufferSizer(),
+      _sendBufferSizer(),
       _socket(socket) {
   if (reused) {
     assert(connected());
@@ -260,6 +270,7 @@ ESB::Error HttpClientSocket::handleConnect() {
   assert(_socket->connected());
 
   ESB_LOG_INFO("[%s] connected to peer", _socket->name());
+  _counters.getConnects()->record(_transaction->startTime(), ESB::MonotonicTimeSource::Instance().now());
 
   stateTransition(TRANSACTION_BEGIN);
   return handleWritable();
@@ -321,6 +332,56 @@ ESB::Error HttpClientSocket::readResponseBody(unsigned char *chunk, ESB::UInt64
   return error;
 }
 
+ESB::Error HttpClientSocket::spliceResponseBody(ESB::SocketSplicer &splicer, ESB::UInt64 *bytesRead) {
+  if (!bytesRead) {
+    return ESB_NULL_POINTER;
+  }
+
+  *bytesRead = 0;
+
+  if (!_transaction) {
+    return ESB_INVALID_STATE;
+  }
+
+  // The last chunk and bytes already in the recv buffer have to go through the copy path
+  if (!(_state & PARSING_BODY) || _state & LAST_CHUNK_RECEIVED || _socket->secure() || 0 < _bytesAvailable ||
+      (_recvBuffer && _recvBuffer->isReadable()) || !_transaction->response().hasBody()) {
+    return ESB_OPERATION_NOT_SUPPORTED;
+  }
+
+  ESB::UInt64 bytesRemaining = 0U;
+  ESB::Error error = _transaction->getParser()->bodyBytesRemaining(&bytesRemaining);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  if (0 == bytesRemaining) {
+    return ESB_SUCCESS;
+  }
+
+  switch (error = splicer.fill(_socket->socketDescriptor(), bytesRemaining, bytesRead)) {
+    case ESB_SUCCESS:
+      break;
+    case ESB_AGAIN:
+      return ESB_AGAIN;
+    case ESB_CLOSED:
+      ESB_LOG_DEBUG("[%s] connection closed during response body splice", _socket->name());
+      return ESB_CLOSED;
+    default:
+      ESB_LOG_DEBUG_ERRNO(error, "[%s] cannot splice response body", _socket->name());
+      return error;
+  }
+
+  if (ESB_SUCCESS != (error = _transaction->getParser()->skipBody(*bytesRead))) {
+    ESB_LOG_DEBUG_ERRNO(error, "[%s] cannot skip %lu spliced response body bytes", _socket->name(), *bytesRead);
+    return error;
+  }
+
+  ESB_LOG_DEBUG("[%s] spliced %lu response body bytes, %lu bytes remaining", _socket->name(), *bytesRead,
+                bytesRemaining - *bytesRead);
+  return ESB_SUCCESS;
+}
+
 ESB::Error HttpClientSocket::handleReadable() {
   assert(wantRead());
   assert(_socket->connected());
@@ -330,6 +391,22 @@ ESB::Error HttpClientSocket::handleReadable() {
     return ESB_INVALID_STATE;
   }
 
+  if (_state & PARSING_BODY && !(_state & LAST_CHUNK_RECEIVED) && 0 == _bytesAvailable &&
+      !(_recvBuffer && _recvBuffer->isReadable())) {
+    switch (ESB::Error error = _handler.spliceResponseBody(_multiplexer, *this)) {
+      case ESB_OPERATION_NOT_SUPPORTED:
+        break;
+      case ESB_SUCCESS:
+        // The body has been moved, let the handler see the last chunk
+        return advanceStateMachine(_handler, ADVANCE_RECV | ADVANCE_SEND);
+      case ESB_CLOSED:
+        handleRemoteClose();
+        return ESB_CLOSED;
+      default:
+        return error;
+    }
+  }
+
   return advanceStateMachine(_handler, INITIAL_FILL_RECV_BUFFER | ADVANCE_RECV | ADVANCE_SEND);
 }
 
@@ -343,10 +420,28 @@ ESB::Error HttpClientSocket::sendRequestBody(unsigned const char *chunk, ESB::UI
     return ESB_INVALID_STATE;
   }
 
-  HttpRequestBodyProducer adaptor(chunk, bytesOffered);
+  ESB::UInt64 bytesSent = 0U;
+  ESB::UInt64 socketBytesSent = 0U;
+  ESB::Error error = SendBodyVectored(_multiplexer, _socket, _transaction->getFormatter(), _sendBuffer, chunk,
+                                      bytesOffered, &bytesSent, &socketBytesSent);
+  _bodyBytesWritten += bytesSent;
+  if (0U < socketBytesSent) {
+    clearFlag(FIRST_USE_AFTER_REUSE);
+  }
+  if (ESB_SUCCESS != error) {
+    *bytesConsumed = bytesSent;
+    return error;
+  }
+
+  if (0 < bytesOffered && bytesSent == bytesOffered) {
+    *bytesConsumed = bytesSent;
+    return ESB_SUCCESS;
+  }
 
-  ESB::Error error = advanceStateMachine(adaptor, UPDATE_MULTIPLEXER | ADVANCE_SEND);
-  *bytesConsumed = adaptor.bytesProduced();
+  HttpRequestBodyProducer adaptor(chunk + bytesSent, bytesOffered - bytesSent);
+
+  error = advanceStateMachine(adaptor, UPDATE_MULTIPLEXER | ADVANCE_SEND);
+  *bytesConsumed = bytesSent + adaptor.bytesProduced();
   return error;
 }
 
@@ -427,40 +522,40 @@ void HttpClientSocket::handleRemove() {
   switch (state) {
     case TRANSACTION_BEGIN:
       assert(_transaction);
-      _counters.getFailures()->record(_transaction->startTime(), ESB::Time::Instance().now());
+      _counters.getFailures()->record(_transaction->startTime(), ESB::MonotonicTimeSource::Instance().now());
       _handler.endTransaction(_multiplexer, *this, HttpClientHandler::ES_HTTP_CLIENT_HANDLER_BEGIN);
       break;
     case CONNECTING:
       assert(_transaction);
-      _counters.getFailures()->record(_transaction->startTime(), ESB::Time::Instance().now());
+      _counters.getFailures()->record(_transaction->startTime(), ESB::MonotonicTimeSource::Instance().now());
       _handler.endTransaction(_multiplexer, *this, HttpClientHandler::ES_HTTP_CLIENT_HANDLER_CONNECT);
       break;
     case FORMATTING_HEADERS:
       assert(_transaction);
-      _counters.getFailures()->record(_transaction->startTime(), ESB::Time::Instance().now());
+      _counters.getFailures()->record(_transaction->startTime(), ESB::MonotonicTimeSource::Instance().now());
       _handler.endTransaction(_multiplexer, *this, HttpClientHandler::ES_HTTP_CLIENT_HANDLER_SEND_REQUEST_HEADERS);
       break;
     case FORMATTING_BODY:
     case FLUSHING_BODY:
       assert(_transaction);
-      _counters.getFailures()->record(_transaction->startTime(), ESB::Time::Instance().now());
+      _counters.getFailures()->record(_transaction->startTime(), ESB::MonotonicTimeSource::Instance().now());
       _handler.endTransaction(_multiplexer, *this, HttpClientHandler::ES_HTTP_CLIENT_HANDLER_SEND_REQUEST_BODY);
       break;
     case PARSING_HEADERS:
       assert(_transaction);
-      _counters.getFailures()->record(_transaction->startTime(), ESB::Time::Instance().now());
+      _counters.getFailures()->record(_transaction->startTime(), ESB::MonotonicTimeSource::Instance().now());
       _handler.endTransaction(_multiplexer, *this, HttpClientHandler::ES_HTTP_CLIENT_HANDLER_RECV_RESPONSE_HEADERS);
       break;
     case PARSING_BODY:
       assert(_transaction);
-      _counters.getFailures()->record(_transaction->startTime(), ESB::Time::Instance().now());
+      _counters.getFailures()->record(_transaction->startTime(), ESB::MonotonicTimeSource::Instance().now());
       _handler.endTransaction(_multiplexer, *this, HttpClientHandler::ES_HTTP_CLIENT_HANDLER_RECV_RESPONSE_BODY);
       break;
     case TRANSACTION_END:
       assert(_transaction);
-      _counters.getSuccesses()->record(_transaction->startTime(), ESB::Time::Instance().now());
+      _counters.getSuccesses()->record(_transaction->startTime(), ESB::MonotonicTimeSource::Instance().now());
       if (GetReuseConnections() && !(_state & ABORTED)) {
-        const HttpHeader *header = _transaction->response().findHeader("Connection");
+        const HttpHeader *header = _transaction->response().findHeader(HttpHeader::ES_HTTP_FIELD_CONNECTION);
         reuseConnection = !(header && header->fieldValue() && !strcasecmp("close", (const char *)header->fieldValue()));
       }
       _handler.endTransaction(_multiplexer, *this, HttpClientHandler::ES_HTTP_CLIENT_HANDLER_END);
@@ -597,7 +692,8 @@ ESB::Error HttpClientSocket::advanceStateMachine(HttpClientHandler &handler, int
 
 ESB::Error HttpClientSocket::stateBeginTransaction() {
   // TODO make connection reuse more configurable
-  if (!HttpClientSocket::GetReuseConnections() && !_transaction->request().findHeader("Connection")) {
+  if (!HttpClientSocket::GetReuseConnections() &&
+      !_transaction->request().findHeader(HttpHeader::ES_HTTP_FIELD_CONNECTION)) {
     ESB::Error error = _transaction->request().addHeader("Connection", "close", _transaction->allocator());
 
     if (ESB_SUCCESS != error) {
@@ -621,7 +717,7 @@ ESB::Error HttpClientSocket::stateBeginTransaction() {
 
 ESB::Error HttpClientSocket::stateSendRequestHeaders() {
   if (!_sendBuffer) {
-    _sendBuffer = _multiplexer.acquireBuffer();
+    _sendBuffer = _sendBufferSizer.acquire(_multiplexer);
     if (!_sendBuffer) {
       ESB_LOG_ERROR_ERRNO(ESB_OUT_OF_MEMORY, "[%s] Cannot create buffer", _socket->name());
       return ESB_OUT_OF_MEMORY;
@@ -747,12 +843,14 @@ ESB::Error HttpClientSocket::stateReceiveResponseHeaders() {
 
   // parse complete
 
+  _counters.getTimeToFirstByte()->record(_transaction->startTime(), ESB::MonotonicTimeSource::Instance().now());
+
   if (ESB_DEBUG_LOGGABLE) {
     ESB_LOG_DEBUG("[%s] status line: HTTP/%d.%d %d %s", _socket->name(), _transaction->response().httpVersion() / 100,
                   _transaction->response().httpVersion() % 100 / 10, _transaction->response().statusCode(),
                   ESB_SAFE_STR(_transaction->response().reasonPhrase()));
-    HttpHeader *header = (HttpHeader *)_transaction->response().headers().first();
-    for (; header; header = (HttpHeader *)header->next()) {
+    const HttpHeader *header = (const HttpHeader *)_transaction->response().headers().first();
+    for (; header; header = (const HttpHeader *)header->next()) {
       ESB_LOG_DEBUG("[%s] response header: %s: %s", _socket->name(), ESB_SAFE_STR(header->fieldName()),
                     ESB_SAFE_STR(header->fieldValue()));
     }
@@ -852,20 +950,30 @@ ESB::Error HttpClientSocket::fillReceiveBuffer() {
   }
 
   if (!_recvBuffer) {
-    _recvBuffer = _multiplexer.acquireBuffer();
+    // TLS decrypts whole records, so bytes of a record that do not fit in the recv buffer wait inside the TLS session
+    // where epoll cannot see them.
+    _recvBufferSizer.setMinimumSize(_multiplexer, _socket->secure() ? ESB_TLS_MAX_RECORD_SIZE : 0U);
+    _recvBuffer = _recvBufferSizer.acquire(_multiplexer);
     if (!_recvBuffer) {
       ESB_LOG_ERROR_ERRNO(ESB_OUT_OF_MEMORY, "[%s] Cannot create buffer", _socket->name());
       return ESB_OUT_OF_MEMORY;  // remove from multiplexer
     }
   }
 
-  // If there is no data in the recv buffer, read some more from the socket
-  // If there is no space left in the recv buffer, make room if possible
+  // If there is no data in the recv buffer, read some more from the socket, into a smaller buffer if the peer has
+  // been sending little.
+  // If there is no space left in the recv buffer, make room if possible, in a larger buffer if the parser is jammed
+  // or the peer keeps filling this one.
+  _recvBufferSizer.shrink(_multiplexer, &_recvBuffer);
   if (!_recvBuffer->isWritable()) {
-    ESB_LOG_DEBUG("[%s] compacting input buffer", _socket->name());
-    if (!_recvBuffer->compact()) {
-      ESB_LOG_INFO("[%s] parser jammed", _socket->name());
-      return ESB_OVERFLOW;
+    if (_recvBufferSizer.grow(_multiplexer, &_recvBuffer, 0 == _recvBuffer->readPosition())) {
+      ESB_LOG_DEBUG("[%s] grew input buffer to %u bytes", _socket->name(), _recvBuffer->capacity());
+    } else {
+      ESB_LOG_DEBUG("[%s] compacting input buffer", _socket->name());
+      if (!_recvBuffer->compact()) {
+        ESB_LOG_INFO("[%s] parser jammed", _socket->name());
+        return ESB_OVERFLOW;
+      }
     }
   }
 
@@ -884,6 +992,7 @@ ESB::Error HttpClientSocket::fillReceiveBuffer() {
     return ESB_CLOSED;
   }
 
+  _recvBufferSizer.record(_recvBuffer);
   ESB_LOG_DEBUG("[%s] read %ld bytes into client recv buffer", _socket->name(), result);
   return ESB_SUCCESS;
 }
@@ -892,10 +1001,17 @@ ESB::Error HttpClientSocket::flushSendBuffer() {
   ESB_LOG_DEBUG("[%s] flushing request output buffer", _socket->name());
 
   if (!_sendBuffer->isReadable()) {
+    // Nothing fit, so the formatter needs a larger buffer to make progress
+    if (_sendBufferSizer.grow(_multiplexer, &_sendBuffer, true)) {
+      ESB_LOG_DEBUG("[%s] grew output buffer to %u bytes", _socket->name(), _sendBuffer->capacity());
+      return ESB_SUCCESS;
+    }
     ESB_LOG_INFO("[%s] request formatter jammed", _socket->name());
     return ESB_OVERFLOW;  // remove from multiplexer
   }
 
+  _sendBufferSizer.record(_sendBuffer);
+
   bool flushed = false;
   while (!_multiplexer.shutdown() && _sendBuffer->isReadable()) {
     ESB::SSize bytesSent = _socket->send(_sendBuffer);
@@ -917,6 +1033,10 @@ ESB::Error HttpClientSocket::flushSendBuffer() {
     ESB_LOG_DEBUG("[%s] flushed %ld bytes from request output buffer", _socket->name(), bytesSent);
   }
 
+  if (!_sendBuffer->isReadable() && !_sendBufferSizer.grow(_multiplexer, &_sendBuffer, false)) {
+    _sendBufferSizer.shrink(_multiplexer, &_sendBuffer);
+  }
+
   return _multiplexer.shutdown() ? ESB_SHUTDOWN : ESB_SUCCESS;
 }
 
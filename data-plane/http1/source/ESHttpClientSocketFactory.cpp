@@ -6,6 +6,10 @@
 #include <ESBSystemConfig.h>
 #endif
 
+#ifndef ESB_MONOTONIC_TIME_SOURCE_H
+#include <ESBMonotonicTimeSource.h>
+#endif
+
 #ifndef ES_HTTP_CONFIG_H
 #include <ESHttpConfig.h>
 #endif
@@ -14,13 +18,14 @@ namespace ES {
 
 HttpClientSocketFactory::HttpClientSocketFactory(HttpMultiplexerExtended &multiplexer, HttpClientHandler &handler,
                                                  HttpClientCounters &counters, ESB::ClientTLSContextIndex &contextIndex,
+                                                 ESB::ConnectionPool::Group *connectionPools,
                                                  ESB::Allocator &allocator)
     : _multiplexer(multiplexer),
       _handler(handler),
       _counters(counters),
       _allocator(allocator),
       _connectionPool(multiplexer.multiplexer().name(), HttpConfig::Instance().connectionPoolBuckets(), 0,
-                      contextIndex),
+                      contextIndex, ESB::SystemAllocator::Instance(), connectionPools),
       _deconstructedHttpSockets(),
       _cleanupHandler(*this) {}
 
@@ -135,7 +140,7 @@ ESB::Error HttpClientSocketFactory::executeClientTransaction(HttpClientTransacti
   HttpClientSocket *socket = NULL;
   ESB::Error error = create(transaction, &socket);
   if (ESB_SUCCESS != error) {
-    _counters.getFailures()->record(transaction->startTime(), ESB::Time::Instance().now());
+    _counters.getFailures()->record(transaction->startTime(), ESB::MonotonicTimeSource::Instance().now());
     // transaction->getHandler()->end(transaction,
     //                               HttpClientHandler::ES_HTTP_CLIENT_HANDLER_CONNECT);
     ESB_LOG_CRITICAL_ERRNO(error, "[%s] cannot create new client socket", name());
@@ -154,7 +159,7 @@ ESB::Error HttpClientSocketFactory::executeClientTransaction(HttpClientTransacti
   } else {
     error = socket->connect();
     if (ESB_SUCCESS != error) {
-      _counters.getFailures()->record(transaction->startTime(), ESB::Time::Instance().now());
+      _counters.getFailures()->record(transaction->startTime(), ESB::MonotonicTimeSource::Instance().now());
       ESB_LOG_WARNING_ERRNO(error, "[%s] Cannot connect", socket->logAddress());
       // transaction->getHandler()->end(transaction,
       //                               HttpClientHandler::ES_HTTP_CLIENT_HANDLER_CONNECT);
@@ -168,7 +173,7 @@ ESB::Error HttpClientSocketFactory::executeClientTransaction(HttpClientTransacti
   error = _multiplexer.multiplexer().addMultiplexedSocket(socket);
 
   if (ESB_SUCCESS != error) {
-    _counters.getFailures()->record(transaction->startTime(), ESB::Time::Instance().now());
+    _counters.getFailures()->record(transaction->startTime(), ESB::MonotonicTimeSource::Instance().now());
     ESB_LOG_CRITICAL_ERRNO(error, "[%s] Cannot add client socket to multiplexer", socket->logAddress());
     // transaction->getHandler()->end(transaction,
     //                               HttpClientHandler::ES_HTTP_CLIENT_HANDLER_CONNECT);
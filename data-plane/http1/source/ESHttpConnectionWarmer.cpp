@@ -0,0 +1,244 @@
+#ifndef ES_HTTP_CONNECTION_WARMER_H
+#include <ESHttpConnectionWarmer.h>
+#endif
+
+#ifndef ESB_LOGGER_H
+#include <ESBLogger.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+namespace ES {
+
+HttpConnectionWarmer::HttpConnectionWarmer(HttpMultiplexerExtended &multiplexer, ESB::ConnectionPool &connectionPool,
+                                           ESB::Allocator &allocator)
+    : ESB::Timer(),
+      _multiplexer(multiplexer),
+      _connectionPool(connectionPool),
+      _allocator(allocator),
+      _destinations(0U),
+      _pendingConnections(0U),
+      _openedConnections(0U),
+      _retiredConnections(0U),
+      _deconstructedSockets(),
+      _cleanupHandler(*this) {
+  memset(_pending, 0, sizeof(_pending));
+}
+
+HttpConnectionWarmer::~HttpConnectionWarmer() {
+  assert(0 == _pendingConnections);
+
+  for (ESB::EmbeddedListElement *head = _deconstructedSockets.removeFirst(); head;
+       head = _deconstructedSockets.removeFirst()) {
+    _allocator.deallocate(head);
+  }
+}
+
+ESB::Error HttpConnectionWarmer::start() {
+  _destinations = MIN(HttpConfig::Instance().warmDestinations(), ES_HTTP_MAX_WARM_DESTINATIONS);
+  if (0 == _destinations) {
+    return ESB_SUCCESS;
+  }
+
+  // Start right away so the destinations' hostnames are looked up before the first requests arrive
+  handleExpiration();
+  return inTimingWheel() ? ESB_SUCCESS : ESB_OTHER_ERROR;
+}
+
+void HttpConnectionWarmer::handleExpiration() {
+  for (ESB::UInt32 i = 0; i < _destinations; ++i) {
+    warm(i, HttpConfig::Instance().warmDestination(i));
+  }
+
+  ESB::Error error = _multiplexer.multiplexer().addTimer(this, HttpConfig::Instance().warmIntervalMsec());
+  if (ESB_SUCCESS != error) {
+    ESB_LOG_WARNING_ERRNO(error, "[%s] cannot schedule connection warming, no longer warming connections", name());
+  }
+}
+
+void HttpConnectionWarmer::warm(ESB::UInt32 index, const HttpConfig::WarmDestination &destination) {
+  ESB::SocketAddress address;
+  ESB::Error error =
+      _multiplexer.dnsClient().resolve(address, destination.hostname(), destination.port(), destination.secure());
+
+  switch (error) {
+    case ESB_SUCCESS:
+      break;
+    case ESB_AGAIN:
+      // The lookup is in flight, try again on the next round
+      return;
+    default:
+      ESB_LOG_INFO_ERRNO(error, "[%s] cannot resolve warm destination %s", name(), destination.hostname());
+      return;
+  }
+
+  const char *fqdn = destination.hostname();
+  const ESB::UInt32 idle = _connectionPool.idleSockets(fqdn, address);
+
+  if (0 < destination.maxIdle() && idle > destination.maxIdle()) {
+    ESB::UInt32 retired = _connectionPool.retireSockets(fqdn, address, destination.maxIdle());
+    _retiredConnections += retired;
+    ESB_LOG_DEBUG("[%s] retired %u idle connections to %s:%u", name(), retired, fqdn, destination.port());
+    return;
+  }
+
+  for (ESB::UInt32 available = idle + _pending[index]; available < destination.minIdle(); ++available) {
+    error = open(index, fqdn, address);
+    if (ESB_SUCCESS != error) {
+      ESB_LOG_INFO_ERRNO(error, "[%s] cannot open warm connection to %s:%u", name(), fqdn, destination.port());
+      return;
+    }
+  }
+}
+
+ESB::Error HttpConnectionWarmer::open(ESB::UInt32 index, const char *fqdn, const ESB::SocketAddress &address) {
+  ESB::ConnectedSocket *connection = NULL;
+  ESB::Error error = _connectionPool.connectSocket(fqdn, address, &connection);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  WarmingSocket *socket = NULL;
+
+  {
+    WarmingSocket *memory = (WarmingSocket *)_deconstructedSockets.removeLast();
+    if (memory) {
+      socket = new (memory) WarmingSocket(*this, index, connection);
+    } else {
+      socket = new (_allocator) WarmingSocket(*this, index, connection);
+    }
+  }
+
+  if (!socket) {
+    connection->close();
+    _connectionPool.release(connection);
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  error = _multiplexer.multiplexer().addMultiplexedSocket(socket);
+  if (ESB_SUCCESS != error) {
+    connection->close();
+    _connectionPool.release(connection);
+    socket->~WarmingSocket();
+    _deconstructedSockets.addLast(socket);
+    return error;
+  }
+
+  ++_pending[index];
+  ++_pendingConnections;
+  ++_openedConnections;
+  return ESB_SUCCESS;
+}
+
+void HttpConnectionWarmer::release(WarmingSocket *socket) {
+  assert(0 < _pending[socket->destination()]);
+  assert(0 < _pendingConnections);
+  --_pending[socket->destination()];
+  --_pendingConnections;
+
+  if (socket->established()) {
+    ESB_LOG_DEBUG("[%s] returned warm connection to pool", socket->name());
+  } else {
+    socket->socket()->close();
+  }
+
+  _connectionPool.release(socket->socket());
+  socket->~WarmingSocket();
+  _deconstructedSockets.addLast(socket);
+}
+
+const char *HttpConnectionWarmer::name() const { return _multiplexer.multiplexer().name(); }
+
+HttpConnectionWarmer::WarmingSocket::WarmingSocket(HttpConnectionWarmer &warmer, ESB::UInt32 destination,
+                                                   ESB::ConnectedSocket *socket)
+    : ESB::MultiplexedSocket(),
+      _warmer(warmer),
+      _destination(destination),
+      _socket(socket),
+      _connecting(true),
+      _established(false),
+      _dead(false) {}
+
+HttpConnectionWarmer::WarmingSocket::~WarmingSocket() {}
+
+bool HttpConnectionWarmer::WarmingSocket::permanent() { return false; }
+
+bool HttpConnectionWarmer::WarmingSocket::wantAccept() { return false; }
+
+bool HttpConnectionWarmer::WarmingSocket::wantConnect() { return _connecting; }
+
+bool HttpConnectionWarmer::WarmingSocket::wantRead() { return !_connecting && _socket->wantRead(); }
+
+bool HttpConnectionWarmer::WarmingSocket::wantWrite() { return !_connecting && _socket->wantWrite(); }
+
+ESB::Error HttpConnectionWarmer::WarmingSocket::handleAccept() {
+  assert(!"function should not be called");
+  return ESB_OPERATION_NOT_SUPPORTED;
+}
+
+ESB::Error HttpConnectionWarmer::WarmingSocket::handleConnect() {
+  _connecting = false;
+  return handshake();
+}
+
+ESB::Error HttpConnectionWarmer::WarmingSocket::handleReadable() { return handshake(); }
+
+ESB::Error HttpConnectionWarmer::WarmingSocket::handleWritable() { return handshake(); }
+
+ESB::Error HttpConnectionWarmer::WarmingSocket::handshake() {
+  ESB::Error error = _socket->handshake();
+
+  switch (error) {
+    case ESB_SUCCESS:
+      // Cleaning up the socket after the multiplexer removes it hands the connection to the pool
+      _established = true;
+      return ESB_SUCCESS;
+    case ESB_AGAIN:
+      return ESB_AGAIN;
+    default:
+      ESB_LOG_INFO_ERRNO(error, "[%s] cannot establish warm connection", _socket->name());
+      return error;
+  }
+}
+
+void HttpConnectionWarmer::WarmingSocket::handleError(ESB::Error error) {
+  ESB_LOG_INFO_ERRNO(error, "[%s] error establishing warm connection", _socket->name());
+}
+
+void HttpConnectionWarmer::WarmingSocket::handleRemoteClose() {
+  ESB_LOG_INFO("[%s] peer closed warm connection", _socket->name());
+}
+
+void HttpConnectionWarmer::WarmingSocket::handleIdle() {
+  ESB_LOG_INFO("[%s] timed out establishing warm connection", _socket->name());
+}
+
+void HttpConnectionWarmer::WarmingSocket::handleRemove() {
+  // The multiplexer may still look at the socket until it is cleaned up, so the connection is given to the pool then
+  ESB_LOG_DEBUG("[%s] warming socket has been removed", _socket->name());
+}
+
+SOCKET HttpConnectionWarmer::WarmingSocket::socketDescriptor() const { return _socket->socketDescriptor(); }
+
+ESB::CleanupHandler *HttpConnectionWarmer::WarmingSocket::cleanupHandler() { return &_warmer._cleanupHandler; }
+
+const void *HttpConnectionWarmer::WarmingSocket::key() const { return &_socket->peerAddress(); }
+
+const char *HttpConnectionWarmer::WarmingSocket::name() const { return _socket->name(); }
+
+void HttpConnectionWarmer::WarmingSocket::markDead() { _dead = true; }
+
+bool HttpConnectionWarmer::WarmingSocket::dead() const { return _dead; }
+
+HttpConnectionWarmer::CleanupHandler::CleanupHandler(HttpConnectionWarmer &warmer)
+    : ESB::CleanupHandler(), _warmer(warmer) {}
+
+HttpConnectionWarmer::CleanupHandler::~CleanupHandler() {}
+
+void HttpConnectionWarmer::CleanupHandler::destroy(ESB::Object *object) {
+  _warmer.release((HttpConnectionWarmer::WarmingSocket *)object);
+}
+
+}  // namespace ES
@@ -67,7 +67,11 @@ ESB::Error HttpListeningSocket::handleAccept() {
     return ESB_AGAIN;  // keep calling accept until the OS returns EAGAIN
   }
 
-  error = _multiplexer.addServerSocket(state);
+  error = _multiplexer.acceptServerSocket(state);
+
+  if (ESB_CLOSED == error) {
+    return ESB_AGAIN;  // the multiplexer logged the handler's rejection and closed the connection
+  }
 
   if (ESB_SUCCESS != error) {
     ESB_LOG_ERROR_ERRNO(error, "[%s] cannot add accepted connection to multiplexer", _socket.name());
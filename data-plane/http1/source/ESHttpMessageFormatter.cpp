@@ -59,7 +59,7 @@ ESB::Error HttpMessageFormatter::formatHeaders(ESB::Buffer *outputBuffer, const
       return error;
     }
 
-    _currentHeader = (HttpHeader *)message.headers().first();
+    _currentHeader = (const HttpHeader *)message.headers().first();
 
     HttpUtil::Transition(&_state, outputBuffer, ES_FORMATTING_START_LINE, ES_FORMATTING_FIELD_NAME);
   }
@@ -102,11 +102,11 @@ ESB::Error HttpMessageFormatter::formatHeaders(ESB::Buffer *outputBuffer, const
         return error;
       }
 
-      if (0 == strcasecmp((const char *)_currentHeader->fieldName(), "Content-Length")) {
+      if (HttpHeader::ES_HTTP_FIELD_CONTENT_LENGTH == _currentHeader->fieldToken()) {
         _state |= ES_FOUND_CONTENT_LENGTH_HEADER;
       }
 
-      if (0 == strcasecmp((const char *)_currentHeader->fieldName(), "Transfer-Encoding")) {
+      if (HttpHeader::ES_HTTP_FIELD_TRANSFER_ENCODING == _currentHeader->fieldToken()) {
         // If a Transfer-Encoding header field (section 14.41) is present and
         // has any value other than "identity", then the transfer-length is
         // defined by use of the "chunked" transfer-coding (section 3.6),
@@ -348,6 +348,8 @@ ESB::Error HttpMessageFormatter::endBody(ESB::Buffer *outputBuffer) {
   return ESB_INVALID_STATE;
 }
 
+bool HttpMessageFormatter::unencodedBody() const { return ES_FORMATTING_UNENCODED_BODY & _state; }
+
 ESB::Error HttpMessageFormatter::beginChunk(ESB::Buffer *outputBuffer, ESB::UInt64 requestedSize,
                                             ESB::UInt64 *availableSize) {
   // chunk          = chunk-size [ chunk-extension ] CRLF
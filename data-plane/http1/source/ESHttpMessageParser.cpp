@@ -10,6 +10,10 @@
 #include <ESHttpError.h>
 #endif
 
+#ifndef ES_HTTP_SCANNER_H
+#include <ESHttpScanner.h>
+#endif
+
 namespace ES {
 
 #ifndef MIN
@@ -187,6 +191,8 @@ ESB::Error HttpMessageParser::parseFieldName(ESB::Buffer *inputBuffer, HttpMessa
   unsigned char octet;
 
   while (true) {
+    copyRun(inputBuffer, HttpScanner::SkipToken);
+
     if (!inputBuffer->isReadable()) {
       return ESB_AGAIN;
     }
@@ -204,7 +210,8 @@ ESB::Error HttpMessageParser::parseFieldName(ESB::Buffer *inputBuffer, HttpMessa
         return ESB_OUT_OF_MEMORY;
       }
 
-      HttpHeader *header = new (_allocator) HttpHeader(fieldName);
+      const HttpHeader::FieldToken fieldToken = HttpHeader::Tokenize(fieldName, _workingBuffer->writePosition());
+      HttpHeader *header = new (_allocator) HttpHeader(fieldName, fieldToken);
 
       if (!header) {
         _allocator.deallocate(fieldName);  // no-op
@@ -214,7 +221,7 @@ ESB::Error HttpMessageParser::parseFieldName(ESB::Buffer *inputBuffer, HttpMessa
 
       // The next production - parseFieldValue - may fill in in the value
 
-      message.headers().addLast(header);
+      message.appendHeader(header);
 
       return ESB_SUCCESS;
     }
@@ -245,6 +252,8 @@ ESB::Error HttpMessageParser::parseFieldValue(ESB::Buffer *inputBuffer, HttpMess
   unsigned char octet;
 
   while (true) {
+    copyRun(inputBuffer, HttpScanner::SkipFieldContent);
+
     if (!inputBuffer->isReadable()) {
       return ESB_AGAIN;
     }
@@ -281,7 +290,7 @@ ESB::Error HttpMessageParser::parseFieldValue(ESB::Buffer *inputBuffer, HttpMess
               return ESB_OUT_OF_MEMORY;
             }
 
-            HttpHeader *header = (HttpHeader *)message.headers().last();
+            HttpHeader *header = message.lastHeader();
 
             assert(header);
 
@@ -332,6 +341,20 @@ ESB::Error HttpMessageParser::parseFieldValue(ESB::Buffer *inputBuffer, HttpMess
   }
 }
 
+void HttpMessageParser::copyRun(ESB::Buffer *inputBuffer,
+                                const unsigned char *(*skip)(const unsigned char *start, const unsigned char *end)) {
+  const unsigned char *start = inputBuffer->buffer() + inputBuffer->readPosition();
+  const ESB::UInt32 length = skip(start, start + MIN(inputBuffer->readable(), _workingBuffer->writable())) - start;
+
+  if (0 == length) {
+    return;
+  }
+
+  memcpy(_workingBuffer->buffer() + _workingBuffer->writePosition(), start, length);
+  _workingBuffer->setWritePosition(_workingBuffer->writePosition() + length);
+  inputBuffer->skip(length);
+}
+
 ESB::Error HttpMessageParser::parseBody(ESB::Buffer *inputBuffer, ESB::UInt64 *startingPosition,
                                         ESB::UInt64 *chunkSize) {
   if (!inputBuffer || !startingPosition || !chunkSize) {
@@ -396,6 +419,45 @@ ESB::Error HttpMessageParser::consumeBody(ESB::Buffer *inputBuffer, ESB::UInt64
   return ESB_SUCCESS;
 }
 
+ESB::Error HttpMessageParser::bodyBytesRemaining(ESB::UInt64 *bytesRemaining) const {
+  if (!bytesRemaining) {
+    return ESB_NULL_POINTER;
+  }
+
+  if (!(ES_HEADER_PARSE_COMPLETE & _state)) {
+    return ESB_INVALID_STATE;
+  }
+
+  if (!(ES_PARSING_UNENCODED_BODY & _state)) {
+    return ESB_OPERATION_NOT_SUPPORTED;
+  }
+
+  *bytesRemaining = ES_BODY_PARSE_COMPLETE & _state ? 0 : _bodyBytesRemaining;
+  return ESB_SUCCESS;
+}
+
+ESB::Error HttpMessageParser::skipBody(ESB::UInt64 bytesSkipped) {
+  if (!(ES_HEADER_PARSE_COMPLETE & _state)) {
+    return ESB_INVALID_STATE;
+  }
+
+  if (!(ES_PARSING_UNENCODED_BODY & _state)) {
+    return ESB_OPERATION_NOT_SUPPORTED;
+  }
+
+  if (bytesSkipped > _bodyBytesRemaining) {
+    return ESB_INVALID_ARGUMENT;
+  }
+
+  _bodyBytesRemaining -= bytesSkipped;
+
+  if (0 == _bodyBytesRemaining) {
+    _state |= ES_BODY_PARSE_COMPLETE;
+  }
+
+  return ESB_SUCCESS;
+}
+
 ESB::Error HttpMessageParser::parseUnencodedBody(ESB::Buffer *inputBuffer, ESB::UInt64 *startingPosition,
                                                  ESB::UInt64 *chunkSize) {
   // chunk-data     = chunk-size(OCTET)
@@ -650,8 +712,9 @@ ESB::Error HttpMessageParser::postParse(HttpMessage &message) {
   message.setReuseConnection(1.1 <= message.httpVersion());
   message.setSend100Continue(false);
 
-  for (HttpHeader *header = (HttpHeader *)message.headers().first(); header; header = (HttpHeader *)header->next()) {
-    if (0 == strcasecmp((const char *)header->fieldName(), "Expect")) {
+  for (const HttpHeader *header = (const HttpHeader *)message.headers().first(); header;
+       header = (const HttpHeader *)header->next()) {
+    if (HttpHeader::ES_HTTP_FIELD_EXPECT == header->fieldToken()) {
       if (0 == header->fieldValue()) {
         continue;
       }
@@ -663,7 +726,7 @@ ESB::Error HttpMessageParser::postParse(HttpMessage &message) {
       continue;
     }
 
-    if (1.1 <= message.httpVersion() && 0 == strcasecmp((const char *)header->fieldName(), "Connection")) {
+    if (1.1 <= message.httpVersion() && HttpHeader::ES_HTTP_FIELD_CONNECTION == header->fieldToken()) {
       if (0 == header->fieldValue()) {
         continue;
       }
@@ -675,7 +738,7 @@ ESB::Error HttpMessageParser::postParse(HttpMessage &message) {
       continue;
     }
 
-    if (0 == strcasecmp((const char *)header->fieldName(), "Content-Length")) {
+    if (HttpHeader::ES_HTTP_FIELD_CONTENT_LENGTH == header->fieldToken()) {
       // 3.If a Content-Length header field (section 14.13) is present, its
       // decimal value in OCTETs represents both the entity-length and the
       // transfer-length. The Content-Length header field MUST NOT be sent
@@ -703,7 +766,7 @@ ESB::Error HttpMessageParser::postParse(HttpMessage &message) {
       continue;
     }
 
-    if (0 == strcasecmp((const char *)header->fieldName(), "Transfer-Encoding")) {
+    if (HttpHeader::ES_HTTP_FIELD_TRANSFER_ENCODING == header->fieldToken()) {
       // 2.If a Transfer-Encoding header field (section 14.41) is present and
       // has any value other than "identity", then the transfer-length is
       // defined by use of the "chunked" transfer-coding (section 3.6),
@@ -724,7 +787,7 @@ ESB::Error HttpMessageParser::postParse(HttpMessage &message) {
       continue;
     }
 
-    if (0 == strcasecmp((const char *)header->fieldName(), "Content-Type")) {
+    if (HttpHeader::ES_HTTP_FIELD_CONTENT_TYPE == header->fieldToken()) {
       // 4.If the message uses the media type "multipart/byteranges", and the
       // transfer-length is not otherwise specified, then this self-
       // delimiting media type defines the transfer-length. This media type
@@ -5,4 +5,10 @@
 namespace ES {
 HttpServerHandler::HttpServerHandler() {}
 HttpServerHandler::~HttpServerHandler() {}
+
+ESB::Error HttpServerHandler::beginConnection(HttpMultiplexer &multiplexer, HttpServerStream &serverStream) {
+  return ESB_SUCCESS;
+}
+
+void HttpServerHandler::endConnection(HttpMultiplexer &multiplexer, HttpServerStream &serverStream) {}
 }  // namespace ES
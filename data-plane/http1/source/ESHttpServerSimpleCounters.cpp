@@ -6,6 +6,7 @@ namespace ES {
 
 HttpServerSimpleCounters::HttpServerSimpleCounters()
     : _successfulTransactions("SERVER TRANS SUCCESS"),
+      _timeToFirstByte("SERVER TIME TO FIRST BYTE"),
       _requestHeaderErrors("SERVER TRANS REQUEST HEADER ERROR"),
       _requestHeaderFailures("SERVER TRANS REQUST HEADER FAILURE"),
       _requestHeaderTimeouts("SERVER TRANS REQUEST HEADER TIMEOUT"),
@@ -24,8 +25,9 @@ HttpServerSimpleCounters::HttpServerSimpleCounters()
 HttpServerSimpleCounters::~HttpServerSimpleCounters() {}
 
 void HttpServerSimpleCounters::log(ESB::Logger &logger, ESB::Logger::Severity severity) const {
-  /*_successfulTransactions.log(logger, severity);
-  _requestHeaderErrors.log(logger, severity);
+  _successfulTransactions.log(logger, severity);
+  _timeToFirstByte.log(logger, severity);
+  /*_requestHeaderErrors.log(logger, severity);
   _requestHeaderFailures.log(logger, severity);
   _requestHeaderTimeouts.log(logger, severity);
   _requestBodyErrors.log(logger, severity);
@@ -47,6 +49,10 @@ const ESB::PerformanceCounter *HttpServerSimpleCounters::getSuccessfulTransactio
   return &_successfulTransactions;
 }
 
+ESB::PerformanceCounter *HttpServerSimpleCounters::getTimeToFirstByte() { return &_timeToFirstByte; }
+
+const ESB::PerformanceCounter *HttpServerSimpleCounters::getTimeToFirstByte() const { return &_timeToFirstByte; }
+
 ESB::PerformanceCounter *HttpServerSimpleCounters::getRequestHeaderErrors() { return &_requestHeaderErrors; }
 
 const ESB::PerformanceCounter *HttpServerSimpleCounters::getRequestHeaderErrors() const {
@@ -6,9 +6,16 @@
 #include <ESHttpError.h>
 #endif
 
+#ifndef ESB_TLS_SOCKET_H
+#include <ESBTLSSocket.h>
+#endif
+
+#ifndef ESB_MONOTONIC_TIME_SOURCE_H
+#include <ESBMonotonicTimeSource.h>
+#endif
+
 namespace ES {
 
-// TODO - add performance counters
 // TODO - max requests per connection option (1 disables keepalives)
 // TODO - max header size option
 // TODO - max body size option
@@ -192,10 +199,13 @@ HttpServerSocket::HttpServerSocket(ESB::ConnectedSocket *socket, HttpServerHandl
       _multiplexer(multiplexer),
       _handler(handler),
       _transaction(NULL),
+      _connectionContext(NULL),
       _counters(counters),
       _cleanupHandler(cleanupHandler),
       _recvBuffer(NULL),
       _sendBuffer(NULL),
+      _recvBufferSizer(),
+      _sendBufferSizer(),
       _socket(socket) {}
 
 HttpServerSocket::~HttpServerSocket() {
@@ -331,13 +341,75 @@ ESB::Error HttpServerSocket::sendResponseBody(unsigned const char *chunk, ESB::U
     return ESB_INVALID_STATE;
   }
 
-  HttpResponseBodyProducer adaptor(chunk, bytesOffered);
+  ESB::UInt64 bytesSent = 0U;
+  ESB::UInt64 socketBytesSent = 0U;
+  ESB::Error error = SendBodyVectored(_multiplexer, _socket, _transaction->getFormatter(), _sendBuffer, chunk,
+                                      bytesOffered, &bytesSent, &socketBytesSent);
+  _bodyBytesWritten += bytesSent;
+  if (ESB_SUCCESS != error) {
+    *bytesConsumed = bytesSent;
+    return error;
+  }
 
-  ESB::Error error = advanceStateMachine(adaptor, SERVER_UPDATE_MULTIPLEXER | SERVER_ADVANCE_SEND);
-  *bytesConsumed = adaptor.bytesProduced();
+  if (0 < bytesOffered && bytesSent == bytesOffered) {
+    *bytesConsumed = bytesSent;
+    return ESB_SUCCESS;
+  }
+
+  HttpResponseBodyProducer adaptor(chunk + bytesSent, bytesOffered - bytesSent);
+
+  error = advanceStateMachine(adaptor, SERVER_UPDATE_MULTIPLEXER | SERVER_ADVANCE_SEND);
+  *bytesConsumed = bytesSent + adaptor.bytesProduced();
   return error;
 }
 
+ESB::Error HttpServerSocket::spliceResponseBody(ESB::SocketSplicer &splicer, ESB::UInt64 *bytesSent) {
+  if (!bytesSent) {
+    return ESB_NULL_POINTER;
+  }
+
+  *bytesSent = 0;
+
+  int state = _state & SERVER_STATE_MASK;
+  if (state == SERVER_FORMATTING_HEADERS) {
+    return ESB_AGAIN;
+  }
+
+  if (state != SERVER_FORMATTING_BODY || !_transaction) {
+    return ESB_INVALID_STATE;
+  }
+
+  if (_socket->secure() || !_transaction->getFormatter()->unencodedBody()) {
+    return ESB_OPERATION_NOT_SUPPORTED;
+  }
+
+  // Anything already formatted has to reach the socket before the spliced bytes
+  if (_sendBuffer && _sendBuffer->isReadable()) {
+    ESB::Error error = flushSendBuffer();
+    if (ESB_SUCCESS != error) {
+      return error;
+    }
+    if (_sendBuffer->isReadable()) {
+      return ESB_AGAIN;
+    }
+  }
+
+  ESB::Error error = splicer.drain(_socket->socketDescriptor(), bytesSent);
+  _bodyBytesWritten += *bytesSent;
+
+  switch (error) {
+    case ESB_SUCCESS:
+    case ESB_AGAIN:
+      if (0 < *bytesSent) {
+        ESB_LOG_DEBUG("[%s] spliced %lu response body bytes", _socket->name(), *bytesSent);
+      }
+      return error;
+    default:
+      ESB_LOG_INFO_ERRNO(error, "[%s] cannot splice response body", _socket->name());
+      return error;
+  }
+}
+
 ESB::Error HttpServerSocket::handleWritable() {
   assert(wantWrite());
   assert(_socket->connected());
@@ -425,6 +497,9 @@ void HttpServerSocket::handleRemove() {
     _transaction = NULL;
   }
 
+  _handler.endConnection(_multiplexer, *this);
+  _connectionContext = NULL;
+
   stateTransition(SERVER_INACTIVE);
   _counters.getAverageTransactionsPerConnection()->add(_requestsPerConnection);
   _requestsPerConnection = 0;
@@ -573,6 +648,12 @@ ESB::Error HttpServerSocket::stateReceiveRequestHeaders() {
   assert(_socket->connected());
   assert(SERVER_PARSING_HEADERS & _state);
 
+  // The transaction's latency starts with its first request bytes, not when the previous transaction on a persistent
+  // connection ended.
+  if (0 == _transaction->startTime().seconds()) {
+    _transaction->setStartTime();
+  }
+
   ESB::Error error = _transaction->getParser()->parseHeaders(_recvBuffer, _transaction->request());
 
   switch (error) {
@@ -619,8 +700,8 @@ ESB::Error HttpServerSocket::stateReceiveRequestHeaders() {
         break;
     }
 
-    HttpHeader *header = (HttpHeader *)_transaction->request().headers().first();
-    for (; header; header = (HttpHeader *)header->next()) {
+    const HttpHeader *header = (const HttpHeader *)_transaction->request().headers().first();
+    for (; header; header = (const HttpHeader *)header->next()) {
       ESB_LOG_DEBUG("[%s] request header: %s: %s", _socket->name(), ESB_SAFE_STR(header->fieldName()),
                     ESB_SAFE_STR(header->fieldValue()));
     }
@@ -755,7 +836,7 @@ ESB::Error HttpServerSocket::stateSendResponseHeaders() {
   assert(SERVER_FORMATTING_HEADERS & _state);
 
   if (!_sendBuffer) {
-    _sendBuffer = _multiplexer.acquireBuffer();
+    _sendBuffer = _sendBufferSizer.acquire(_multiplexer);
     if (!_sendBuffer) {
       ESB_LOG_ERROR_ERRNO(ESB_OUT_OF_MEMORY, "[%s] Cannot create buffer", _socket->name());
       return ESB_OUT_OF_MEMORY;  // remove from multiplexer
@@ -771,7 +852,8 @@ ESB::Error HttpServerSocket::stateSendResponseHeaders() {
     ESB_LOG_DEBUG("[%s] sending response status-line: HTTP%d/%d %d %s", _socket->name(), major, minor, statusCode,
                   reasonPhrase);
 
-    for (HttpHeader *header = (HttpHeader *)response.headers().first(); header; header = (HttpHeader *)header->next()) {
+    for (const HttpHeader *header = (const HttpHeader *)response.headers().first(); header;
+         header = (const HttpHeader *)header->next()) {
       ESB_LOG_DEBUG("[%s] response header: %s: %s", _socket->name(), ESB_SAFE_STR(header->fieldName()),
                     ESB_SAFE_STR(header->fieldValue()));
     }
@@ -782,6 +864,9 @@ ESB::Error HttpServerSocket::stateSendResponseHeaders() {
   switch (error) {
     case ESB_SUCCESS:
       ESB_LOG_DEBUG("[%s] formatted response headers", _socket->name());
+      if (0 < _transaction->startTime().seconds()) {
+        _counters.getTimeToFirstByte()->record(_transaction->startTime(), ESB::MonotonicTimeSource::Instance().now());
+      }
       stateTransition(SERVER_FORMATTING_BODY);
       return ESB_SUCCESS;
     case ESB_AGAIN:
@@ -873,9 +958,12 @@ ESB::Error HttpServerSocket::stateFlushResponseBody() {
   assert(_sendBuffer);
   assert(SERVER_FLUSHING_BODY & _state);
 
-  ESB::Error error = flushSendBuffer();
-  if (unlikely(ESB_SUCCESS != error)) {
-    return error;
+  // A spliced body bypasses the send buffer, so there may be nothing left to flush
+  if (_sendBuffer->isReadable()) {
+    ESB::Error error = flushSendBuffer();
+    if (unlikely(ESB_SUCCESS != error)) {
+      return error;
+    }
   }
 
   stateTransition(SERVER_TRANSACTION_END);
@@ -886,6 +974,10 @@ ESB::Error HttpServerSocket::stateEndTransaction() {
   assert(_state & SERVER_TRANSACTION_END);
 
   ++_requestsPerConnection;
+  if (0 < _transaction->startTime().seconds()) {
+    _counters.getSuccessfulTransactions()->record(_transaction->startTime(),
+                                                  ESB::MonotonicTimeSource::Instance().now());
+  }
   _handler.endTransaction(_multiplexer, *this, HttpServerHandler::ES_HTTP_SERVER_HANDLER_END);
 
   if (SERVER_CANNOT_REUSE_CONNECTION & _state) {
@@ -969,7 +1061,10 @@ ESB::Error HttpServerSocket::formatEndChunk() {
 ESB::Error HttpServerSocket::fillReceiveBuffer() {
   if (!_recvBuffer) {
     // TODO peek for received data. If no data in socket, then return EAGAIN before allocating the recv buffer
-    _recvBuffer = _multiplexer.acquireBuffer();
+    // TLS decrypts whole records, so bytes of a record that do not fit in the recv buffer wait inside the TLS session
+    // where epoll cannot see them.
+    _recvBufferSizer.setMinimumSize(_multiplexer, _socket->secure() ? ESB_TLS_MAX_RECORD_SIZE : 0U);
+    _recvBuffer = _recvBufferSizer.acquire(_multiplexer);
     if (!_recvBuffer) {
       ESB_LOG_ERROR_ERRNO(ESB_OUT_OF_MEMORY, "[%s] Cannot create buffer", _socket->name());
       return ESB_OUT_OF_MEMORY;  // remove from multiplexer
@@ -985,13 +1080,20 @@ ESB::Error HttpServerSocket::fillReceiveBuffer() {
     }
   }
 
-  // If there is no data in the recv buffer, read some more from the socket
-  // If there is no space left in the recv buffer, make room if possible
+  // If there is no data in the recv buffer, read some more from the socket, into a smaller buffer if the peer has
+  // been sending little.
+  // If there is no space left in the recv buffer, make room if possible, in a larger buffer if the parser is jammed
+  // or the peer keeps filling this one.
+  _recvBufferSizer.shrink(_multiplexer, &_recvBuffer);
   if (!_recvBuffer->isWritable()) {
-    ESB_LOG_DEBUG("[%s] compacting input buffer", _socket->name());
-    if (!_recvBuffer->compact()) {
-      ESB_LOG_INFO("[%s] parser jammed", _socket->name());
-      return ESB_OVERFLOW;
+    if (_recvBufferSizer.grow(_multiplexer, &_recvBuffer, 0 == _recvBuffer->readPosition())) {
+      ESB_LOG_DEBUG("[%s] grew input buffer to %u bytes", _socket->name(), _recvBuffer->capacity());
+    } else {
+      ESB_LOG_DEBUG("[%s] compacting input buffer", _socket->name());
+      if (!_recvBuffer->compact()) {
+        ESB_LOG_INFO("[%s] parser jammed", _socket->name());
+        return ESB_OVERFLOW;
+      }
     }
   }
 
@@ -1010,6 +1112,7 @@ ESB::Error HttpServerSocket::fillReceiveBuffer() {
     return ESB_CLOSED;
   }
 
+  _recvBufferSizer.record(_recvBuffer);
   ESB_LOG_DEBUG("[%s] read %ld bytes into recv buffer", _socket->name(), result);
   return ESB_SUCCESS;
 }
@@ -1021,10 +1124,17 @@ ESB::Error HttpServerSocket::flushSendBuffer() {
   ESB_LOG_DEBUG("[%s] flushing response output buffer", _socket->name());
 
   if (!_sendBuffer->isReadable()) {
+    // Nothing fit, so the formatter needs a larger buffer to make progress
+    if (_sendBufferSizer.grow(_multiplexer, &_sendBuffer, true)) {
+      ESB_LOG_DEBUG("[%s] grew output buffer to %u bytes", _socket->name(), _sendBuffer->capacity());
+      return ESB_SUCCESS;
+    }
     ESB_LOG_INFO("[%s] response formatter jammed", _socket->name());
     return ESB_OVERFLOW;  // remove from multiplexer
   }
 
+  _sendBufferSizer.record(_sendBuffer);
+
   bool flushed = false;
   while (!_multiplexer.shutdown() && _sendBuffer->isReadable()) {
     ESB::SSize bytesSent = _socket->send(_sendBuffer);
@@ -1045,6 +1155,10 @@ ESB::Error HttpServerSocket::flushSendBuffer() {
     ESB_LOG_DEBUG("[%s] flushed %ld bytes from response output buffer", _socket->name(), bytesSent);
   }
 
+  if (!_sendBuffer->isReadable() && !_sendBufferSizer.grow(_multiplexer, &_sendBuffer, false)) {
+    _sendBufferSizer.shrink(_multiplexer, &_sendBuffer);
+  }
+
   return _multiplexer.shutdown() ? ESB_SHUTDOWN : ESB_SUCCESS;
 }
 
@@ -1233,6 +1347,12 @@ void *HttpServerSocket::context() { return _transaction ? _transaction->context(
 
 const void *HttpServerSocket::context() const { return _transaction ? _transaction->context() : NULL; }
 
+void HttpServerSocket::setConnectionContext(void *context) { _connectionContext = context; }
+
+void *HttpServerSocket::connectionContext() { return _connectionContext; }
+
+const void *HttpServerSocket::connectionContext() const { return _connectionContext; }
+
 const ESB::SocketAddress &HttpServerSocket::peerAddress() const { return _socket->peerAddress(); }
 
 const char *HttpServerSocket::name() const { return _socket->name(); }
@@ -2,10 +2,79 @@
 #include <ESHttpSocket.h>
 #endif
 
+#ifndef ESB_LOGGER_H
+#include <ESBLogger.h>
+#endif
+
 namespace ES {
 
 HttpSocket::HttpSocket() {}
 
 HttpSocket::~HttpSocket() {}
 
+ESB::Error HttpSocket::SendBodyVectored(HttpMultiplexerExtended &multiplexer, ESB::ConnectedSocket *socket,
+                                        HttpMessageFormatter *formatter, ESB::Buffer *sendBuffer,
+                                        unsigned const char *chunk, ESB::UInt64 bytesOffered,
+                                        ESB::UInt64 *bytesConsumed, ESB::UInt64 *bytesSent) {
+  assert(socket);
+  assert(formatter);
+  assert(sendBuffer);
+  *bytesConsumed = 0U;
+  *bytesSent = 0U;
+
+  while (!multiplexer.shutdown() && bytesOffered - *bytesConsumed > sendBuffer->writable()) {
+    ESB::UInt64 chunkSize = 0U;
+    ESB::Error error = formatter->beginBlock(sendBuffer, bytesOffered - *bytesConsumed, &chunkSize);
+
+    switch (error) {
+      case ESB_SUCCESS:
+        break;
+      case ESB_AGAIN:
+        return ESB_SUCCESS;  // no room for framing, let the state machine flush the send buffer first
+      default:
+        ESB_LOG_INFO_ERRNO(error, "[%s] cannot format chunk start block", socket->name());
+        return error;
+    }
+
+    const ESB::UInt32 buffered = sendBuffer->readable();
+    unsigned const char *body = chunk + *bytesConsumed;
+    ESB::SSize result = socket->send(sendBuffer, (const char *)body, chunkSize);
+    ESB::UInt64 bodyBytesSent = 0U;
+
+    if (0 > result) {
+      error = ESB::LastError();
+      if (ESB_AGAIN != error) {
+        ESB_LOG_INFO_ERRNO(error, "[%s] error sending body", socket->name());
+        return error;  // remove from multiplexer
+      }
+    } else {
+      *bytesSent += result;
+      if (buffered < (ESB::UInt64)result) {
+        bodyBytesSent = result - buffered;
+      }
+    }
+
+    // beginBlock reserved space for the whole chunk, and sending can only free more
+    if (bodyBytesSent < chunkSize) {
+      memcpy(sendBuffer->buffer() + sendBuffer->writePosition(), body + bodyBytesSent, chunkSize - bodyBytesSent);
+      sendBuffer->setWritePosition(sendBuffer->writePosition() + chunkSize - bodyBytesSent);
+    }
+
+    if (ESB_SUCCESS != (error = formatter->endBlock(sendBuffer))) {
+      ESB_LOG_INFO_ERRNO(error, "[%s] cannot format chunk end block", socket->name());
+      return error;
+    }
+
+    *bytesConsumed += chunkSize;
+    ESB_LOG_DEBUG("[%s] sent %lu/%lu bytes of chunk directly", socket->name(), bodyBytesSent, chunkSize);
+
+    if (bodyBytesSent < chunkSize) {
+      // The socket's send buffer is full, the rest goes through the send buffer
+      return ESB_SUCCESS;
+    }
+  }
+
+  return ESB_SUCCESS;
+}
+
 }  // namespace ES
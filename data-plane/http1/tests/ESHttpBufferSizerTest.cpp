@@ -0,0 +1,232 @@
+#ifndef ES_HTTP_BUFFER_SIZER_H
+#include <ESHttpBufferSizer.h>
+#endif
+
+#ifndef ES_HTTP_SERVER_SIMPLE_COUNTERS_H
+#include <ESHttpServerSimpleCounters.h>
+#endif
+
+#ifndef ES_HTTP_CONFIG_H
+#include <ESHttpConfig.h>
+#endif
+
+#ifndef ESB_SIZE_CLASS_BUFFER_POOL_H
+#include <ESBSizeClassBufferPool.h>
+#endif
+
+#ifndef ESB_SYSTEM_DNS_CLIENT_H
+#include <ESBSystemDnsClient.h>
+#endif
+
+#ifndef ESB_EPOLL_MULTIPLEXER_H
+#include <ESBEpollMultiplexer.h>
+#endif
+
+#ifndef ESB_TLS_SOCKET_H
+#include <ESBTLSSocket.h>
+#endif
+
+#include <gtest/gtest.h>
+
+using namespace ES;
+
+static const ESB::UInt32 Sizes[] = {1024U, 4096U, 16384U};
+
+// Only the buffer pool is used by HttpBufferSizer
+class BufferSizerMultiplexer : public HttpMultiplexerExtended {
+ public:
+  BufferSizerMultiplexer(const ESB::UInt32 *sizes = Sizes, ESB::UInt32 sizeClasses = 3U)
+      : _pool(sizes, sizeClasses, 1U), _counters(), _dnsClient(), _splicePipes(), _multiplexer("test", 0, 1) {}
+  virtual ~BufferSizerMultiplexer() {}
+
+  virtual ESB::Buffer *acquireBuffer(ESB::UInt32 sizeClass) { return _pool.acquireBuffer(0U, sizeClass); }
+  virtual void releaseBuffer(ESB::Buffer *buffer) { _pool.releaseBuffer(0U, buffer); }
+  virtual ESB::UInt32 bufferSizeClasses() const { return _pool.sizeClasses(); }
+  virtual ESB::UInt32 bufferSize(ESB::UInt32 sizeClass) const { return _pool.bufferSize(sizeClass); }
+
+  virtual bool shutdown() { return false; }
+  virtual HttpClientTransaction *createClientTransaction() { return NULL; }
+  virtual ESB::Error executeClientTransaction(HttpClientTransaction *transaction) { return ESB_NOT_IMPLEMENTED; }
+  virtual void destroyClientTransaction(HttpClientTransaction *transaction) {}
+  virtual ESB::DnsClient &dnsClient() { return _dnsClient; }
+  virtual ESB::SocketSplicer::PipePool &splicePipes() { return _splicePipes; }
+  virtual HttpServerTransaction *createServerTransaction() { return NULL; }
+  virtual void destroyServerTransaction(HttpServerTransaction *transaction) {}
+  virtual HttpServerCounters &serverCounters() { return _counters; }
+  virtual ESB::Error addServerSocket(ESB::Socket::State &state) { return ESB_NOT_IMPLEMENTED; }
+  virtual ESB::Error acceptServerSocket(ESB::Socket::State &state) { return ESB_NOT_IMPLEMENTED; }
+  virtual ESB::Error addListeningSocket(ESB::ListeningSocket &socket) { return ESB_NOT_IMPLEMENTED; }
+  virtual ESB::SocketMultiplexer &multiplexer() { return _multiplexer; }
+
+ private:
+  ESB::SizeClassBufferPool _pool;
+  HttpServerSimpleCounters _counters;
+  ESB::SystemDnsClient _dnsClient;
+  ESB::SocketSplicer::PipePool _splicePipes;
+  ESB::EpollMultiplexer _multiplexer;
+};
+
+// Leave bytes readable with the given amount of room after them
+static void Fill(ESB::Buffer *buffer, ESB::UInt32 readable, ESB::UInt32 writable) {
+  ASSERT_LE(readable + writable, buffer->capacity());
+  const ESB::UInt32 start = buffer->capacity() - writable - readable;
+  for (ESB::UInt32 i = 0; i < readable; ++i) {
+    buffer->buffer()[start + i] = (unsigned char)i;
+  }
+  buffer->setReadPosition(start);
+  buffer->setWritePosition(start + readable);
+}
+
+TEST(HttpBufferSizer, GrowWhenJammed) {
+  BufferSizerMultiplexer multiplexer;
+  HttpBufferSizer sizer;
+  ESB::Buffer *buffer = sizer.acquire(multiplexer);
+  ASSERT_TRUE(buffer);
+  EXPECT_EQ(0U, sizer.sizeClass());
+  EXPECT_EQ(Sizes[0], buffer->capacity());
+
+  Fill(buffer, 1000U, 0U);
+  ASSERT_TRUE(sizer.grow(multiplexer, &buffer, true));
+  EXPECT_EQ(1U, sizer.sizeClass());
+  EXPECT_EQ(Sizes[1], buffer->capacity());
+
+  // The unread bytes are moved to the start as compaction would leave them
+  EXPECT_EQ(0U, buffer->readPosition());
+  EXPECT_EQ(1000U, buffer->readable());
+  for (ESB::UInt32 i = 0; i < 1000U; ++i) {
+    ASSERT_EQ((unsigned char)i, buffer->buffer()[i]);
+  }
+
+  ASSERT_TRUE(sizer.grow(multiplexer, &buffer, true));
+  EXPECT_EQ(2U, sizer.sizeClass());
+
+  // There is no larger class to grow into
+  EXPECT_FALSE(sizer.grow(multiplexer, &buffer, true));
+  EXPECT_EQ(2U, sizer.sizeClass());
+  EXPECT_EQ(Sizes[2], buffer->capacity());
+
+  multiplexer.releaseBuffer(buffer);
+}
+
+TEST(HttpBufferSizer, GrowAfterTwoFills) {
+  BufferSizerMultiplexer multiplexer;
+  HttpBufferSizer sizer;
+  ESB::Buffer *buffer = sizer.acquire(multiplexer);
+  ASSERT_TRUE(buffer);
+
+  Fill(buffer, Sizes[0] - 10U, 10U);
+  sizer.record(buffer);
+  EXPECT_FALSE(sizer.grow(multiplexer, &buffer, false));
+
+  // A buffer with plenty of room in between starts the count over
+  Fill(buffer, 100U, Sizes[0] / 2U);
+  sizer.record(buffer);
+  Fill(buffer, Sizes[0] - 10U, 10U);
+  sizer.record(buffer);
+  EXPECT_FALSE(sizer.grow(multiplexer, &buffer, false));
+  EXPECT_EQ(0U, sizer.sizeClass());
+
+  sizer.record(buffer);
+  ASSERT_TRUE(sizer.grow(multiplexer, &buffer, false));
+  EXPECT_EQ(1U, sizer.sizeClass());
+  EXPECT_EQ(Sizes[1], buffer->capacity());
+  EXPECT_EQ(Sizes[0] - 10U, buffer->readable());
+
+  // Growing starts the count over too
+  Fill(buffer, Sizes[1] - 10U, 10U);
+  sizer.record(buffer);
+  EXPECT_FALSE(sizer.grow(multiplexer, &buffer, false));
+
+  multiplexer.releaseBuffer(buffer);
+}
+
+TEST(HttpBufferSizer, ShrinkAfterSmallUses) {
+  BufferSizerMultiplexer multiplexer;
+  HttpBufferSizer sizer;
+  ESB::Buffer *buffer = sizer.acquire(multiplexer);
+  ASSERT_TRUE(buffer);
+  ASSERT_TRUE(sizer.grow(multiplexer, &buffer, true));
+  ASSERT_TRUE(sizer.grow(multiplexer, &buffer, true));
+  ASSERT_EQ(2U, sizer.sizeClass());
+
+  // 15 uses that would have fit in the next smaller class are not enough
+  for (int i = 0; i < 15; ++i) {
+    Fill(buffer, Sizes[1], 4000U);
+    sizer.record(buffer);
+  }
+  buffer->clear();
+  sizer.shrink(multiplexer, &buffer);
+  EXPECT_EQ(2U, sizer.sizeClass());
+
+  // A use that would not have fit starts the count over
+  Fill(buffer, Sizes[1] + 1U, 4000U);
+  sizer.record(buffer);
+  for (int i = 0; i < 15; ++i) {
+    Fill(buffer, 100U, 4000U);
+    sizer.record(buffer);
+  }
+  buffer->clear();
+  sizer.shrink(multiplexer, &buffer);
+  EXPECT_EQ(2U, sizer.sizeClass());
+
+  // The 16th small use in a row is enough, but only once the buffer is empty
+  Fill(buffer, 100U, 4000U);
+  sizer.record(buffer);
+  sizer.shrink(multiplexer, &buffer);
+  EXPECT_EQ(2U, sizer.sizeClass());
+
+  buffer->clear();
+  sizer.shrink(multiplexer, &buffer);
+  EXPECT_EQ(1U, sizer.sizeClass());
+  EXPECT_EQ(Sizes[1], buffer->capacity());
+
+  // Shrinking starts the count over
+  buffer->clear();
+  sizer.shrink(multiplexer, &buffer);
+  EXPECT_EQ(1U, sizer.sizeClass());
+
+  multiplexer.releaseBuffer(buffer);
+}
+
+TEST(HttpBufferSizer, MinimumSize) {
+  BufferSizerMultiplexer multiplexer;
+  HttpBufferSizer sizer;
+
+  sizer.setMinimumSize(multiplexer, Sizes[0] + 1U);
+  EXPECT_EQ(1U, sizer.sizeClass());
+
+  ESB::Buffer *buffer = sizer.acquire(multiplexer);
+  ASSERT_TRUE(buffer);
+  EXPECT_EQ(Sizes[1], buffer->capacity());
+
+  // Never shrinks below the minimum
+  for (int i = 0; i < 32; ++i) {
+    Fill(buffer, 10U, 1000U);
+    sizer.record(buffer);
+  }
+  buffer->clear();
+  sizer.shrink(multiplexer, &buffer);
+  EXPECT_EQ(1U, sizer.sizeClass());
+  multiplexer.releaseBuffer(buffer);
+
+  // Too large for every class picks the largest
+  HttpBufferSizer large;
+  large.setMinimumSize(multiplexer, Sizes[2] + 1U);
+  EXPECT_EQ(2U, large.sizeClass());
+}
+
+// The default size classes fit one TLS record without starting TLS connections in the largest class
+TEST(HttpBufferSizer, DefaultSizesFitTLSRecord) {
+  const HttpConfig &config = HttpConfig::Instance();
+  ASSERT_LT(2U, config.ioBufferSizeClasses());
+
+  BufferSizerMultiplexer multiplexer(config.ioBufferSizes(), config.ioBufferSizeClasses());
+  HttpBufferSizer sizer;
+  sizer.setMinimumSize(multiplexer, ESB_TLS_MAX_RECORD_SIZE);
+  EXPECT_LT(sizer.sizeClass() + 1U, multiplexer.bufferSizeClasses());
+
+  ESB::Buffer *buffer = sizer.acquire(multiplexer);
+  ASSERT_TRUE(buffer);
+  EXPECT_LE((ESB::UInt32)ESB_TLS_MAX_RECORD_SIZE, buffer->capacity());
+  multiplexer.releaseBuffer(buffer);
+}
@@ -0,0 +1,279 @@
+#ifndef ES_HTTP_CONNECTION_WARMER_H
+#include <ESHttpConnectionWarmer.h>
+#endif
+
+#ifndef ES_HTTP_SERVER_SIMPLE_COUNTERS_H
+#include <ESHttpServerSimpleCounters.h>
+#endif
+
+#ifndef ES_HTTP_CONFIG_H
+#include <ESHttpConfig.h>
+#endif
+
+#ifndef ESB_SYSTEM_DNS_CLIENT_H
+#include <ESBSystemDnsClient.h>
+#endif
+
+#ifndef ESB_LISTENING_SOCKET_H
+#include <ESBListeningSocket.h>
+#endif
+
+#ifndef ESB_MULTIPLEXED_SOCKET_H
+#include <ESBMultiplexedSocket.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <gtest/gtest.h>
+
+using namespace ES;
+
+#define MAX_WARMING_SOCKETS 16
+
+// Records the warmer's sockets and timers so the test can drive the handshakes itself
+class WarmerSocketMultiplexer : public ESB::SocketMultiplexer {
+ public:
+  WarmerSocketMultiplexer() : _sockets(0U), _timer(NULL), _delayMsec(0U) {
+    memset(_socket, 0, sizeof(_socket));
+  }
+  virtual ~WarmerSocketMultiplexer() {}
+
+  virtual ESB::Error addMultiplexedSocket(ESB::MultiplexedSocket *socket) {
+    if (MAX_WARMING_SOCKETS <= _sockets) {
+      return ESB_OVERFLOW;
+    }
+    _socket[_sockets++] = socket;
+    return ESB_SUCCESS;
+  }
+
+  virtual ESB::Error updateMultiplexedSocket(ESB::MultiplexedSocket *socket) { return ESB_SUCCESS; }
+  virtual ESB::Error removeMultiplexedSocket(ESB::MultiplexedSocket *socket) { return ESB_NOT_IMPLEMENTED; }
+
+  virtual ESB::Error addTimer(ESB::Timer *timer, ESB::UInt32 delayMsec) {
+    timer->setTick(0);
+    _timer = timer;
+    _delayMsec = delayMsec;
+    return ESB_SUCCESS;
+  }
+
+  virtual ESB::Error updateTimer(ESB::Timer *timer, ESB::UInt32 delayMsec) { return addTimer(timer, delayMsec); }
+
+  virtual ESB::Error removeTimer(ESB::Timer *timer) {
+    timer->remove();
+    _timer = NULL;
+    return ESB_SUCCESS;
+  }
+
+  virtual int currentSockets() const { return _sockets; }
+  virtual int maximumSockets() const { return MAX_WARMING_SOCKETS; }
+  virtual bool isRunning() const { return true; }
+  virtual const char *name() const { return "warmer-test"; }
+  virtual bool run(ESB::SharedInt *isRunning) { return false; }
+  virtual ESB::CleanupHandler *cleanupHandler() { return NULL; }
+
+  // Complete every socket's handshake, then remove and clean it up as the event loop would
+  ESB::UInt32 establish() {
+    const ESB::UInt32 established = _sockets;
+    for (ESB::UInt32 i = 0; i < _sockets; ++i) {
+      ESB::MultiplexedSocket *socket = _socket[i];
+      EXPECT_TRUE(socket->wantConnect());
+      EXPECT_EQ(ESB_SUCCESS, socket->handleConnect());
+      socket->handleRemove();
+      socket->cleanupHandler()->destroy(socket);
+      _socket[i] = NULL;
+    }
+    _sockets = 0U;
+    return established;
+  }
+
+  inline ESB::Timer *timer() const { return _timer; }
+
+  inline ESB::UInt32 delayMsec() const { return _delayMsec; }
+
+ private:
+  ESB::UInt32 _sockets;
+  ESB::MultiplexedSocket *_socket[MAX_WARMING_SOCKETS];
+  ESB::Timer *_timer;
+  ESB::UInt32 _delayMsec;
+
+  ESB_DISABLE_AUTO_COPY(WarmerSocketMultiplexer);
+};
+
+// Only the socket multiplexer and dns client are used by HttpConnectionWarmer
+class WarmerMultiplexer : public HttpMultiplexerExtended {
+ public:
+  WarmerMultiplexer() : _counters(), _dnsClient(), _splicePipes(), _multiplexer() {}
+  virtual ~WarmerMultiplexer() {}
+
+  virtual ESB::Buffer *acquireBuffer(ESB::UInt32 sizeClass) { return NULL; }
+  virtual void releaseBuffer(ESB::Buffer *buffer) {}
+  virtual ESB::UInt32 bufferSizeClasses() const { return 0U; }
+  virtual ESB::UInt32 bufferSize(ESB::UInt32 sizeClass) const { return 0U; }
+
+  virtual bool shutdown() { return false; }
+  virtual HttpClientTransaction *createClientTransaction() { return NULL; }
+  virtual ESB::Error executeClientTransaction(HttpClientTransaction *transaction) { return ESB_NOT_IMPLEMENTED; }
+  virtual void destroyClientTransaction(HttpClientTransaction *transaction) {}
+  virtual ESB::DnsClient &dnsClient() { return _dnsClient; }
+  virtual ESB::SocketSplicer::PipePool &splicePipes() { return _splicePipes; }
+  virtual HttpServerTransaction *createServerTransaction() { return NULL; }
+  virtual void destroyServerTransaction(HttpServerTransaction *transaction) {}
+  virtual HttpServerCounters &serverCounters() { return _counters; }
+  virtual ESB::Error addServerSocket(ESB::Socket::State &state) { return ESB_NOT_IMPLEMENTED; }
+  virtual ESB::Error acceptServerSocket(ESB::Socket::State &state) { return ESB_NOT_IMPLEMENTED; }
+  virtual ESB::Error addListeningSocket(ESB::ListeningSocket &socket) { return ESB_NOT_IMPLEMENTED; }
+  virtual ESB::SocketMultiplexer &multiplexer() { return _multiplexer; }
+
+  inline WarmerSocketMultiplexer &sockets() { return _multiplexer; }
+
+ private:
+  HttpServerSimpleCounters _counters;
+  ESB::SystemDnsClient _dnsClient;
+  ESB::SocketSplicer::PipePool _splicePipes;
+  WarmerSocketMultiplexer _multiplexer;
+};
+
+// Connections to the listener complete in the kernel's backlog, so nothing has to accept them
+class HttpConnectionWarmerTest : public ::testing::Test {
+ public:
+  HttpConnectionWarmerTest()
+      : _listener("warm-listener", ESB::SocketAddress("127.0.0.1", 0, ESB::SocketAddress::TCP), ESB_UINT16_MAX),
+        _contexts(42, 3, ESB::SystemAllocator::Instance()),
+        _pool("warmer-test", 41, 0, _contexts),
+        _multiplexer(),
+        _warmer(_multiplexer, _pool, ESB::SystemAllocator::Instance()) {}
+
+  virtual void SetUp() {
+    ASSERT_EQ(ESB_SUCCESS, _listener.bind());
+    ASSERT_EQ(ESB_SUCCESS, _listener.listen());
+    _address = ESB::SocketAddress("127.0.0.1", _listener.listeningAddress().port(), ESB::SocketAddress::TCP);
+  }
+
+  virtual void TearDown() {
+    HttpConfig::Instance().clearWarmDestinations();
+    _pool.clear();
+  }
+
+ protected:
+  inline ESB::UInt32 idle() { return _pool.idleSockets("127.0.0.1", _address); }
+
+  ESB::ListeningSocket _listener;
+  ESB::SocketAddress _address;
+  ESB::ClientTLSContextIndex _contexts;
+  ESB::ConnectionPool _pool;
+  WarmerMultiplexer _multiplexer;
+  HttpConnectionWarmer _warmer;
+
+  ESB_DISABLE_AUTO_COPY(HttpConnectionWarmerTest);
+};
+
+TEST_F(HttpConnectionWarmerTest, WarmToMinimum) {
+  ASSERT_EQ(ESB_SUCCESS, HttpConfig::Instance().addWarmDestination("127.0.0.1", _address.port(), false, 3U, 5U));
+  ASSERT_EQ(ESB_SUCCESS, _warmer.start());
+
+  // The first round runs right away and schedules the next
+  EXPECT_EQ(&_warmer, _multiplexer.sockets().timer());
+  EXPECT_EQ(HttpConfig::Instance().warmIntervalMsec(), _multiplexer.sockets().delayMsec());
+  EXPECT_EQ(3U, _warmer.pendingConnections());
+  EXPECT_EQ(3U, _warmer.openedConnections());
+  EXPECT_EQ(0U, idle());
+
+  // Connections still establishing count towards the minimum
+  _warmer.handleExpiration();
+  EXPECT_EQ(3U, _warmer.pendingConnections());
+  EXPECT_EQ(3U, _warmer.openedConnections());
+
+  EXPECT_EQ(3U, _multiplexer.sockets().establish());
+  EXPECT_EQ(0U, _warmer.pendingConnections());
+  EXPECT_EQ(3U, idle());
+
+  // Established connections are reused instead of counting as misses
+  ESB::ConnectedSocket *connection = NULL;
+  bool reused = false;
+  ASSERT_EQ(ESB_SUCCESS, _pool.acquireClearSocket(_address, &connection, &reused));
+  EXPECT_TRUE(reused);
+  EXPECT_EQ(1, _pool.hits());
+  EXPECT_EQ(0, _pool.misses());
+  _pool.release(connection);
+
+  _warmer.handleExpiration();
+  EXPECT_EQ(0U, _warmer.pendingConnections());
+  EXPECT_EQ(3U, _warmer.openedConnections());
+  EXPECT_EQ(0U, _warmer.retiredConnections());
+}
+
+TEST_F(HttpConnectionWarmerTest, RefillAfterUse) {
+  ASSERT_EQ(ESB_SUCCESS, HttpConfig::Instance().addWarmDestination("127.0.0.1", _address.port(), false, 3U, 5U));
+  ASSERT_EQ(ESB_SUCCESS, _warmer.start());
+  EXPECT_EQ(3U, _multiplexer.sockets().establish());
+
+  ESB::ConnectedSocket *connections[2] = {NULL, NULL};
+  bool reused = false;
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_EQ(ESB_SUCCESS, _pool.acquireClearSocket(_address, &connections[i], &reused));
+    EXPECT_TRUE(reused);
+  }
+  EXPECT_EQ(1U, idle());
+
+  // Only the connections taken from the pool are replaced
+  _warmer.handleExpiration();
+  EXPECT_EQ(2U, _warmer.pendingConnections());
+  EXPECT_EQ(5U, _warmer.openedConnections());
+  EXPECT_EQ(2U, _multiplexer.sockets().establish());
+  EXPECT_EQ(3U, idle());
+
+  for (int i = 0; i < 2; ++i) {
+    _pool.release(connections[i]);
+  }
+  EXPECT_EQ(5U, idle());
+
+  // Within the maximum nothing is opened or retired
+  _warmer.handleExpiration();
+  EXPECT_EQ(0U, _warmer.pendingConnections());
+  EXPECT_EQ(5U, _warmer.openedConnections());
+  EXPECT_EQ(0U, _warmer.retiredConnections());
+  EXPECT_EQ(5U, idle());
+}
+
+TEST_F(HttpConnectionWarmerTest, RetireLeastRecentlyUsed) {
+  ASSERT_EQ(ESB_SUCCESS, HttpConfig::Instance().addWarmDestination("127.0.0.1", _address.port(), false, 2U, 3U));
+  ASSERT_EQ(ESB_SUCCESS, _warmer.start());
+  EXPECT_EQ(2U, _multiplexer.sockets().establish());
+
+  // Use both warm connections and add two more, so the pool holds four in the order they were last used
+  ESB::ConnectedSocket *connections[4] = {NULL, NULL, NULL, NULL};
+  bool reused = false;
+  for (int i = 0; i < 4; ++i) {
+    ASSERT_EQ(ESB_SUCCESS, _pool.acquireClearSocket(_address, &connections[i], &reused));
+    EXPECT_EQ(i < 2, reused);
+  }
+  for (int i = 0; i < 4; ++i) {
+    _pool.release(connections[i]);
+  }
+  EXPECT_EQ(4U, idle());
+
+  _warmer.handleExpiration();
+  EXPECT_EQ(1U, _warmer.retiredConnections());
+  EXPECT_EQ(0U, _warmer.pendingConnections());
+  EXPECT_EQ(2U, _warmer.openedConnections());
+  EXPECT_EQ(3U, idle());
+
+  // The connection released first is the one that was closed
+  ESB::ConnectedSocket *remaining[3] = {NULL, NULL, NULL};
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(ESB_SUCCESS, _pool.acquireClearSocket(_address, &remaining[i], &reused));
+    EXPECT_TRUE(reused);
+    EXPECT_NE(connections[0], remaining[i]);
+  }
+  EXPECT_EQ(0U, idle());
+  for (int i = 0; i < 3; ++i) {
+    _pool.release(remaining[i]);
+  }
+
+  // Down to the maximum, so the next round leaves the rest alone
+  _warmer.handleExpiration();
+  EXPECT_EQ(1U, _warmer.retiredConnections());
+  EXPECT_EQ(3U, idle());
+}
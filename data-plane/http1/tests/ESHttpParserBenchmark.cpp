@@ -0,0 +1,160 @@
+#ifndef ES_HTTP_REQUEST_PARSER_H
+#include <ESHttpRequestParser.h>
+#endif
+
+#ifndef ES_HTTP_RESPONSE_PARSER_H
+#include <ESHttpResponseParser.h>
+#endif
+
+#ifndef ES_HTTP_SCANNER_H
+#include <ESHttpScanner.h>
+#endif
+
+#ifndef ESB_SYSTEM_TIME_SOURCE_H
+#include <ESBSystemTimeSource.h>
+#endif
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+//
+// Measures header parsing throughput over the ESHttpParserFormatterTest corpus with each scanner implementation the
+// CPU supports.
+//
+// Usage: http1-parser-benchmark [corpus directory] [iterations]
+//
+
+using namespace ES;
+
+struct CorpusFile {
+  const char *_name;
+  bool _isRequest;
+  unsigned char _data[16384];
+  ESB::UInt32 _size;
+};
+
+static CorpusFile Corpus[] = {
+    {"TestAsteriskRequest.in", true},    {"TestComplexRequestUri.in", true}, {"TestContentLength.in", false},
+    {"TestHexEncoding.in", true},        {"TestHttp10.in", true},            {"TestMissingCarriageReturn.in", false},
+    {"TestNoBody.in", true},             {"TestSIP.in", true},               {"TestSoap.in", true},
+    {"TestTinyChunks.in", false},        {"TestTomcat.in", false},           {"TestWhitespace.in", true}};
+
+static const int CorpusSize = sizeof(Corpus) / sizeof(CorpusFile);
+
+static ESB::Error ReadCorpus(const char *directory) {
+  for (int i = 0; i < CorpusSize; ++i) {
+    char path[ESB_MAX_FILENAME + 1];
+    snprintf(path, sizeof(path), "%s/%s", directory, Corpus[i]._name);
+
+    int fd = open(path, O_RDONLY);
+    if (0 > fd) {
+      fprintf(stderr, "cannot open %s\n", path);
+      return ESB::LastError();
+    }
+
+    ESB::SSize result = read(fd, Corpus[i]._data, sizeof(Corpus[i]._data));
+    close(fd);
+
+    if (0 >= result) {
+      fprintf(stderr, "cannot read %s\n", path);
+      return ESB_CLOSED;
+    }
+
+    Corpus[i]._size = result;
+  }
+
+  return ESB_SUCCESS;
+}
+
+// Parse the headers of every corpus file iterations times and return the number of header bytes parsed.
+static ESB::Error ParseCorpus(int iterations, ESB::UInt64 *bytesParsed) {
+  unsigned char workingStorage[4096];
+  ESB::Buffer workingBuffer(workingStorage, sizeof(workingStorage));
+  ESB::DiscardAllocator allocator(4096, sizeof(ESB::UWord), 1, ESB::SystemAllocator::Instance(), true);
+  HttpRequestParser requestParser(&workingBuffer, allocator);
+  HttpResponseParser responseParser(&workingBuffer, allocator);
+  HttpRequest request;
+  HttpResponse response;
+
+  *bytesParsed = 0;
+
+  for (int i = 0; i < iterations; ++i) {
+    for (int j = 0; j < CorpusSize; ++j) {
+      ESB::Buffer inputBuffer(Corpus[j]._data, sizeof(Corpus[j]._data));
+      inputBuffer.setWritePosition(Corpus[j]._size);
+
+      // Headers live in the allocator, so forget them before discarding its memory
+      request.reset();
+      response.reset();
+      allocator.reset();
+
+      ESB::Error error = ESB_SUCCESS;
+
+      if (Corpus[j]._isRequest) {
+        requestParser.reset();
+        error = requestParser.parseHeaders(&inputBuffer, request);
+      } else {
+        responseParser.reset();
+        error = responseParser.parseHeaders(&inputBuffer, response);
+      }
+
+      if (ESB_SUCCESS != error) {
+        fprintf(stderr, "cannot parse %s: %d\n", Corpus[j]._name, error);
+        return error;
+      }
+
+      *bytesParsed += inputBuffer.readPosition();
+    }
+  }
+
+  return ESB_SUCCESS;
+}
+
+int main(int argc, char **argv) {
+  const char *directory = 1 < argc ? argv[1] : ".";
+  const int iterations = 2 < argc ? atoi(argv[2]) : 100000;
+
+  ESB::Error error = ReadCorpus(directory);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  const HttpScanner::Implementation implementations[] = {
+      HttpScanner::ES_HTTP_SCANNER_SCALAR, HttpScanner::ES_HTTP_SCANNER_SSE42, HttpScanner::ES_HTTP_SCANNER_AVX2};
+  double baseline = 0.0;
+
+  for (ESB::UInt32 i = 0; i < sizeof(implementations) / sizeof(implementations[0]); ++i) {
+    if (ESB_SUCCESS != HttpScanner::Select(implementations[i])) {
+      printf("%-8s not supported\n", HttpScanner::Name(implementations[i]));
+      continue;
+    }
+
+    // Warm up caches and branch predictors
+    ESB::UInt64 bytesParsed = 0;
+    error = ParseCorpus(iterations / 10 + 1, &bytesParsed);
+    if (ESB_SUCCESS != error) {
+      return error;
+    }
+
+    const ESB::Date start = ESB::SystemTimeSource::Instance().now();
+    error = ParseCorpus(iterations, &bytesParsed);
+    if (ESB_SUCCESS != error) {
+      return error;
+    }
+    const ESB::Date elapsed = ESB::SystemTimeSource::Instance().now() - start;
+
+    const double seconds = elapsed.seconds() + elapsed.microSeconds() / 1000000.0;
+    const double megabytesPerSecond = 0 < seconds ? bytesParsed / seconds / (1024 * 1024) : 0;
+    if (0 == baseline) {
+      baseline = megabytesPerSecond;
+    }
+
+    printf("%-8s %10.1f MiB/sec %10.0f messages/sec %6.2fx\n", HttpScanner::Name(implementations[i]),
+           megabytesPerSecond, 0 < seconds ? iterations * CorpusSize / seconds : 0,
+           0 < baseline ? megabytesPerSecond / baseline : 0);
+  }
+
+  HttpScanner::Select(HttpScanner::Best());
+  return ESB_SUCCESS;
+}
@@ -606,7 +606,8 @@ ESB::Error ParserFormatterTest::parseRequest(const char *filename, HttpRequest &
 
     ESB_LOG_DEBUG("Version: HTTP/%d.%d", request.httpVersion() / 100, request.httpVersion() % 100 / 10);
     ESB_LOG_DEBUG("Headers");
-    for (HttpHeader *header = (HttpHeader *)request.headers().first(); header; header = (HttpHeader *)header->next()) {
+    for (const HttpHeader *header = (const HttpHeader *)request.headers().first(); header;
+         header = (const HttpHeader *)header->next()) {
       ESB_LOG_DEBUG("   %s: %s\n", (const char *)header->fieldName(),
                     !header->fieldValue() ? "null" : (const char *)header->fieldValue());
     }
@@ -636,7 +637,8 @@ ESB::Error ParserFormatterTest::parseResponse(const char *filename, HttpResponse
     ESB_LOG_DEBUG("ReasonPhrase: %s", response.reasonPhrase());
     ESB_LOG_DEBUG("Version: HTTP/%d.%d", response.httpVersion() / 100, response.httpVersion() % 100 / 10);
     ESB_LOG_DEBUG("Headers");
-    for (HttpHeader *header = (HttpHeader *)response.headers().first(); header; header = (HttpHeader *)header->next()) {
+    for (const HttpHeader *header = (const HttpHeader *)response.headers().first(); header;
+         header = (const HttpHeader *)header->next()) {
       ESB_LOG_DEBUG("   %s: %s", (const char *)header->fieldName(),
                     !header->fieldValue() ? "null" : (const char *)header->fieldValue());
     }
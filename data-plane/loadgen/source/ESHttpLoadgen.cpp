@@ -10,8 +10,8 @@
 #include <ESHttpLoadgenSeedCommand.h>
 #endif
 
-#ifndef ESB_SIMPLE_FILE_LOGGER_H
-#include <ESBSimpleFileLogger.h>
+#ifndef ESB_ASYNC_FILE_LOGGER_H
+#include <ESBAsyncFileLogger.h>
 #endif
 
 #ifndef ESB_SYSTEM_ALLOCATOR_H
@@ -63,7 +63,12 @@ int main(int argc, char **argv) {
     return error;
   }
 
-  ESB::SimpleFileLogger logger(stdout, params.logLevel(), timeCache);
+  ESB::AsyncFileLogger logger(stdout, params.logLevel(), timeCache);
+  error = logger.start();
+  if (ESB_SUCCESS != error) {
+    ESB_LOG_ERROR_ERRNO(error, "Cannot start logger thread");
+    return error;
+  }
   ESB::Logger::SetInstance(&logger);
 
   error = ESB::SignalHandler::Instance().initialize();
@@ -127,6 +132,7 @@ int main(int argc, char **argv) {
   }
 
   client.clientCounters().log(ESB::Logger::Instance(), ESB::Logger::Severity::Notice);
+  client.ioBufferPool().log(ESB::Logger::Instance(), ESB::Logger::Severity::Notice);
   client.destroy();
 
   error = timeCache.join();
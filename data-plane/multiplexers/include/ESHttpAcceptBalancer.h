@@ -0,0 +1,147 @@
+#ifndef ES_HTTP_ACCEPT_BALANCER_H
+#define ES_HTTP_ACCEPT_BALANCER_H
+
+#ifndef ES_HTTP_SERVER_COMMAND_H
+#include <ESHttpServerCommand.h>
+#endif
+
+#ifndef ESB_SOCKET_H
+#include <ESBSocket.h>
+#endif
+
+#ifndef ESB_RAND_H
+#include <ESBRand.h>
+#endif
+
+#ifndef ESB_READ_WRITE_LOCK_H
+#include <ESBReadWriteLock.h>
+#endif
+
+#ifndef ESB_SYSTEM_ALLOCATOR_H
+#include <ESBSystemAllocator.h>
+#endif
+
+/** A multiplexer keeps every connection it accepts until its load reaches this, so lightly loaded servers never pay
+ *  for a handoff.
+ */
+#ifndef ES_HTTP_ACCEPT_BALANCE_MIN_LOAD
+#define ES_HTTP_ACCEPT_BALANCE_MIN_LOAD 16U
+#endif
+
+/** A connection is handed to another multiplexer only if the acceptor's load exceeds the other's by this percentage.
+ */
+#ifndef ES_HTTP_ACCEPT_BALANCE_THRESHOLD_PERCENT
+#define ES_HTTP_ACCEPT_BALANCE_THRESHOLD_PERCENT 25U
+#endif
+
+/** A multiplexer whose event loop takes this many microseconds on average to get back to waiting counts its load
+ *  twice, at twice this lag three times, and so on.
+ */
+#ifndef ES_HTTP_ACCEPT_BALANCE_LAG_USEC
+#define ES_HTTP_ACCEPT_BALANCE_LAG_USEC 1000U
+#endif
+
+namespace ES {
+
+class HttpProxyMultiplexer;
+
+/** Spreads accepted connections across a server's multiplexers by load.  SO_REUSEPORT hashes new connections to
+ *  listening sockets without regard to how busy each multiplexer thread is, so a multiplexer that accepts a connection
+ *  while much busier than another one hands it over through the other's server command socket.
+ *
+ *  Load combines a multiplexer's sockets, its I/O buffers in use and the connections already on their way to it,
+ *  scaled up by its event loop lag.  The acceptor compares itself against the lighter of two random other
+ *  multiplexers, so no multiplexer is polled more than twice per accept and a single light multiplexer is not flooded.
+ *
+ *  @ingroup http
+ */
+class HttpAcceptBalancer {
+ public:
+  /** Constructor.
+   *
+   * @param maxMultiplexers The maximum number of multiplexers, typically the server's number of threads.
+   * @param allocator The allocator to use for the multiplexer table
+   */
+  HttpAcceptBalancer(ESB::UInt32 maxMultiplexers, ESB::Allocator &allocator = ESB::SystemAllocator::Instance());
+
+  virtual ~HttpAcceptBalancer();
+
+  /** Let a multiplexer receive connections accepted by the others and hand its own connections to them.
+   *
+   * @param multiplexer The multiplexer.  It must stay alive until it is detached.
+   * @return ESB_SUCCESS if successful, ESB_OVERFLOW if the table is full, another error code otherwise.
+   */
+  ESB::Error attach(HttpProxyMultiplexer *multiplexer);
+
+  /** Stop balancing to and from a multiplexer.
+   *
+   * @param multiplexer The multiplexer
+   */
+  void detach(HttpProxyMultiplexer *multiplexer);
+
+  /** The number of multiplexers currently attached.
+   *
+   * @return The number of multiplexers
+   */
+  inline ESB::UInt32 size() const { return _size; }
+
+  /** Hand a freshly accepted connection to a less loaded multiplexer if there is one.  Called on the accepting
+   *  multiplexer's thread.
+   *
+   * @param source The multiplexer that accepted the connection
+   * @param state The accepted connection.  Ownership of its descriptor moves to the other multiplexer on success.
+   * @param rand The accepting multiplexer's random number generator
+   * @return ESB_SUCCESS if another multiplexer will add the connection, ESB_CANNOT_FIND if the source should keep it,
+   * another error code if the handoff failed and the source should keep it.
+   */
+  ESB::Error handoff(HttpProxyMultiplexer &source, ESB::Socket::State &state, ESB::Rand &rand);
+
+  /** Decide whether a connection accepted by a multiplexer should go to another one.
+   *
+   * @param load The accepting multiplexer's load
+   * @param targetLoad The other multiplexer's load
+   * @return true if the acceptor is loaded enough to balance at all and busier than the other by more than the
+   * threshold, false otherwise.
+   */
+  static bool ShouldHandoff(ESB::UInt32 load, ESB::UInt32 targetLoad);
+
+ private:
+  /** Carries an accepted connection to the multiplexer chosen for it.
+   */
+  class HandoffCommand : public HttpServerCommand {
+   public:
+    HandoffCommand(HttpProxyMultiplexer &target, ESB::Socket::State &state);
+
+    /** Closes the connection if the target never ran the command, e.g., because it was shutting down.
+     */
+    virtual ~HandoffCommand();
+
+    virtual ESB::Error run(HttpMultiplexerExtended &multiplexer);
+
+    virtual ESB::CleanupHandler *cleanupHandler();
+
+    virtual const char *name();
+
+    /** Give the connection back to the acceptor so the command's destructor does not close it.
+     */
+    inline void disown() { _state.setSocketDescriptor(INVALID_SOCKET); }
+
+   private:
+    HttpProxyMultiplexer &_target;
+    ESB::Socket::State _state;
+
+    ESB_DEFAULT_FUNCS(HandoffCommand);
+  };
+
+  const ESB::UInt32 _maxMultiplexers;
+  ESB::UInt32 _size;
+  HttpProxyMultiplexer **_multiplexers;
+  mutable ESB::ReadWriteLock _lock;
+  ESB::Allocator &_allocator;
+
+  ESB_DEFAULT_FUNCS(HttpAcceptBalancer);
+};
+
+}  // namespace ES
+
+#endif
@@ -17,6 +17,18 @@
 #include <ESBSharedInt.h>
 #endif
 
+#ifndef ESB_SIZE_CLASS_BUFFER_POOL_H
+#include <ESBSizeClassBufferPool.h>
+#endif
+
+#ifndef ESB_DNS_CACHE_H
+#include <ESBDnsCache.h>
+#endif
+
+#ifndef ESB_CONNECTION_POOL_H
+#include <ESBConnectionPool.h>
+#endif
+
 #ifndef ESB_THREAD_POOL_H
 #include <ESBThreadPool.h>
 #endif
@@ -75,6 +87,12 @@ class HttpClient {
 
   inline const HttpClientCounters &clientCounters() const { return _clientCounters; }
 
+  inline const ESB::SizeClassBufferPool &ioBufferPool() const { return _ioBufferPool; }
+
+  inline ESB::DnsCache &dnsCache() { return _dnsCache; }
+
+  inline const ESB::ConnectionPool::Group &connectionPools() const { return _connectionPools; }
+
  private:
   typedef enum {
     ES_HTTP_CLIENT_IS_INITIALIZED = 0,
@@ -91,6 +109,9 @@ class HttpClient {
   HttpClientHandler &_clientHandler;
   ESB::List _multiplexers;
   ESB::ThreadPool _threadPool;
+  ESB::SizeClassBufferPool _ioBufferPool;
+  ESB::DnsCache _dnsCache;
+  ESB::ConnectionPool::Group _connectionPools;
   ESB::Rand _rand;
   ESB::ClientTLSContextIndex _clientContextIndex;
   HttpClientHistoricalCounters _clientCounters;
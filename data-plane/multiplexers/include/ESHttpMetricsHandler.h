@@ -0,0 +1,102 @@
+#ifndef ES_HTTP_METRICS_HANDLER_H
+#define ES_HTTP_METRICS_HANDLER_H
+
+#ifndef ES_HTTP_SERVER_HANDLER_H
+#include <ESHttpServerHandler.h>
+#endif
+
+#ifndef ES_HTTP_SERVER_H
+#include <ESHttpServer.h>
+#endif
+
+#ifndef ES_HTTP_PROXY_H
+#include <ESHttpProxy.h>
+#endif
+
+/** The first guess at the size of a rendered scrape.  Larger scrapes are rendered twice.
+ */
+#ifndef ES_HTTP_METRICS_BUFFER_SIZE
+#define ES_HTTP_METRICS_BUFFER_SIZE 16384
+#endif
+
+/** Event loop metrics are exported for at most this many multiplexers.
+ */
+#ifndef ES_HTTP_METRICS_MAX_MULTIPLEXERS
+#define ES_HTTP_METRICS_MAX_MULTIPLEXERS 256U
+#endif
+
+namespace ES {
+
+/** Serves the counters of an HttpServer or HttpProxy in the Prometheus text exposition format at GET /metrics.
+ *
+ *  Run it on its own HttpServer with a dedicated listener so scrapes never run on the data path's threads.  Rendering
+ *  only reads the data path's counters: latency histograms are merged lock-free, and the client time series and the
+ *  connection pool group are read under locks that recording threads hold only briefly.
+ */
+class HttpMetricsHandler : public HttpServerHandler {
+ public:
+  /**
+   * Serve the counters of an HTTP server.
+   *
+   * @param server The server.  It must outlive the handler.
+   */
+  HttpMetricsHandler(HttpServer &server);
+
+  /**
+   * Serve the counters of an HTTP proxy, including its client counters and connection pools.
+   *
+   * @param proxy The proxy.  It must outlive the handler.
+   */
+  HttpMetricsHandler(HttpProxy &proxy);
+
+  virtual ~HttpMetricsHandler();
+
+  /**
+   * Render the counters in the Prometheus text exposition format.
+   *
+   * @param buffer The text will be written here and NULL terminated, truncating if necessary.
+   * @param size The size of the buffer
+   * @return The length of the text, not counting the NULL terminator.  If this is >= size the text was truncated.
+   */
+  ESB::UInt32 render(char *buffer, ESB::UInt32 size);
+
+  //
+  // ES::HttpServerHandler
+  //
+
+  virtual ESB::Error acceptConnection(HttpMultiplexer &multiplexer, ESB::SocketAddress *address);
+  virtual ESB::Error beginTransaction(HttpMultiplexer &multiplexer, HttpServerStream &stream);
+  virtual ESB::Error receiveRequestHeaders(HttpMultiplexer &multiplexer, HttpServerStream &stream);
+  virtual ESB::Error consumeRequestBody(HttpMultiplexer &multiplexer, HttpServerStream &stream,
+                                        unsigned const char *chunk, ESB::UInt64 chunkSize, ESB::UInt64 *bytesConsumed);
+  virtual ESB::Error offerResponseBody(HttpMultiplexer &multiplexer, HttpServerStream &stream,
+                                       ESB::UInt64 *bytesAvailable);
+  virtual ESB::Error produceResponseBody(HttpMultiplexer &multiplexer, HttpServerStream &stream, unsigned char *chunk,
+                                         ESB::UInt64 bytesRequested);
+  virtual void endTransaction(HttpMultiplexer &multiplexer, HttpServerStream &stream, State state);
+
+ private:
+  // Per-transaction state, allocated from the transaction's allocator
+  class Context {
+   public:
+    Context() : _found(false), _body(NULL), _bodySize(0U), _bytesSent(0U) {}
+
+    virtual ~Context() {}
+
+    bool _found;
+    char *_body;
+    ESB::UInt32 _bodySize;
+    ESB::UInt32 _bytesSent;
+
+    ESB_DEFAULT_FUNCS(Context);
+  };
+
+  HttpServer &_server;
+  HttpProxy *_proxy;
+
+  ESB_DEFAULT_FUNCS(HttpMetricsHandler);
+};
+
+}  // namespace ES
+
+#endif
@@ -21,6 +21,10 @@
 #include <ESBClientTLSContextIndex.h>
 #endif
 
+#ifndef ESB_CONNECTION_POOL_H
+#include <ESBConnectionPool.h>
+#endif
+
 namespace ES {
 
 class HttpProxy : public HttpServer {
@@ -51,13 +55,16 @@ class HttpProxy : public HttpServer {
 
   inline const HttpClientCounters &clientCounters() const { return _clientCounters; }
 
+  inline const ESB::ConnectionPool::Group &connectionPools() const { return _connectionPools; }
+
  protected:
-  virtual ESB::SocketMultiplexer *createMultiplexer();
+  virtual ESB::SocketMultiplexer *createMultiplexer(ESB::UInt32 idx);
 
  private:
   HttpProxyHandler &_proxyHandler;
   ESB::ClientTLSContextIndex _clientContextIndex;
   HttpClientHistoricalCounters _clientCounters;
+  ESB::ConnectionPool::Group _connectionPools;
 
   ESB_DEFAULT_FUNCS(HttpProxy);
 };
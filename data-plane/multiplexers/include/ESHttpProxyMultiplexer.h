@@ -25,6 +25,14 @@
 #include <ESHttpClientCommandSocket.h>
 #endif
 
+#ifndef ES_HTTP_CONNECTION_WARMER_H
+#include <ESHttpConnectionWarmer.h>
+#endif
+
+#ifndef ES_HTTP_CONFIG_H
+#include <ESHttpConfig.h>
+#endif
+
 #ifndef ES_HTTP_SERVER_HANDLER_H
 #include <ESHttpServerHandler.h>
 #endif
@@ -57,47 +65,80 @@
 #include <ESBEpollMultiplexer.h>
 #endif
 
-#ifndef ESB_BUFFER_POOL_H
-#include <ESBBufferPool.h>
+#ifndef ESB_URING_MULTIPLEXER_H
+#include <ESBUringMultiplexer.h>
+#endif
+
+#ifndef ESB_SIZE_CLASS_BUFFER_POOL_H
+#include <ESBSizeClassBufferPool.h>
+#endif
+
+#ifndef ESB_ASYNC_DNS_CLIENT_H
+#include <ESBAsyncDnsClient.h>
+#endif
+
+#ifndef ESB_SHARED_INT_H
+#include <ESBSharedInt.h>
+#endif
+
+#ifndef ESB_RAND_H
+#include <ESBRand.h>
 #endif
 
 namespace ES {
 
+class HttpAcceptBalancer;
+
 class HttpProxyMultiplexer : public ESB::SocketMultiplexer, public HttpMultiplexerExtended {
  public:
   /**
    * Create a proxy-mode (client + server) multiplexer.
    *
    * @param maxSockets
+   * @param ioBufferPool The I/O buffer pool shared by all multiplexers
+   * @param ioBufferShard This multiplexer's shard of the I/O buffer pool
+   * @param dnsCache The DNS cache shared by all multiplexers
+   * @param connectionPools The connection pools of all multiplexers, which may take idle connections from each other
    * @param clientHandler
    * @param serverHandler
    * @param clientCounters
    * @param serverCounters
    */
   HttpProxyMultiplexer(const char *namePrefix, ESB::UInt32 maxSockets, ESB::UInt32 idleTimeoutMsec,
-                       HttpClientHandler &clientHandler, HttpServerHandler &serverHandler,
-                       HttpClientCounters &clientCounters, HttpServerCounters &serverCounters,
-                       ESB::ClientTLSContextIndex &clientContextIndex, ESB::ServerTLSContextIndex &serverContextIndex);
+                       ESB::SizeClassBufferPool &ioBufferPool, ESB::UInt32 ioBufferShard, ESB::DnsCache &dnsCache,
+                       ESB::ConnectionPool::Group &connectionPools, HttpClientHandler &clientHandler,
+                       HttpServerHandler &serverHandler, HttpClientCounters &clientCounters,
+                       HttpServerCounters &serverCounters, ESB::ClientTLSContextIndex &clientContextIndex,
+                       ESB::ServerTLSContextIndex &serverContextIndex);
 
   /**
    * Create a client-only multiplexer.
    *
    * @param maxSockets
+   * @param ioBufferPool The I/O buffer pool shared by all multiplexers
+   * @param ioBufferShard This multiplexer's shard of the I/O buffer pool
+   * @param dnsCache The DNS cache shared by all multiplexers
+   * @param connectionPools The connection pools of all multiplexers, which may take idle connections from each other
    * @param clientHandler
    * @param clientCounters
    */
   HttpProxyMultiplexer(const char *namePrefix, ESB::UInt32 maxSockets, ESB::UInt32 idleTimeoutMsec,
-                       HttpClientHandler &clientHandler, HttpClientCounters &clientCounters,
-                       ESB::ClientTLSContextIndex &clientContextIndex);
+                       ESB::SizeClassBufferPool &ioBufferPool, ESB::UInt32 ioBufferShard, ESB::DnsCache &dnsCache,
+                       ESB::ConnectionPool::Group &connectionPools, HttpClientHandler &clientHandler,
+                       HttpClientCounters &clientCounters, ESB::ClientTLSContextIndex &clientContextIndex);
 
   /**
    * Create a server-only multiplexer
    *
    * @param maxSockets
+   * @param ioBufferPool The I/O buffer pool shared by all multiplexers
+   * @param ioBufferShard This multiplexer's shard of the I/O buffer pool
+   * @param dnsCache The DNS cache shared by all multiplexers
    * @param serverHandler
    * @param serverCounters
    */
   HttpProxyMultiplexer(const char *namePrefix, ESB::UInt32 maxSockets, ESB::UInt32 idleTimeoutMsec,
+                       ESB::SizeClassBufferPool &ioBufferPool, ESB::UInt32 ioBufferShard, ESB::DnsCache &dnsCache,
                        HttpServerHandler &serverHandler, HttpServerCounters &serverCounters,
                        ESB::ServerTLSContextIndex &serverContextIndex);
 
@@ -123,6 +164,45 @@ class HttpProxyMultiplexer : public ESB::SocketMultiplexer, public HttpMultiplex
    */
   inline ESB::Error pushServerCommand(HttpServerCommand *command) { return _serverCommandSocket.push(command); }
 
+  /**
+   * Let this multiplexer hand connections it accepts to other multiplexers.  Must be called before the multiplexer
+   * starts running.
+   *
+   * @param balancer The balancer shared by the multiplexers, or NULL to keep every accepted connection
+   */
+  inline void setAcceptBalancer(HttpAcceptBalancer *balancer) { _acceptBalancer = balancer; }
+
+  /**
+   * Estimate how loaded this multiplexer is for accept balancing.  Safe to call from any thread.
+   *
+   * @return The multiplexer's sockets, I/O buffers in use and pending handoffs, scaled up by its event loop lag
+   */
+  ESB::UInt32 acceptLoad() const;
+
+  /**
+   * Get the number of accepted connections this multiplexer handed to other multiplexers.  Safe to call from any
+   * thread.
+   *
+   * @return The number of handoffs
+   */
+  inline ESB::UInt64 acceptHandoffs() const { return __atomic_load_n(&_acceptHandoffs, __ATOMIC_RELAXED); }
+
+  /**
+   * Get the number of connections other multiplexers handed to this multiplexer that it has not added yet.  Safe to
+   * call from any thread.
+   *
+   * @return The number of pending handoffs
+   */
+  inline ESB::UInt32 pendingHandoffs() const { return _pendingHandoffs.get(); }
+
+  /**
+   * Get the kind of socket multiplexer this multiplexer runs on, which is epoll if io_uring was configured but is
+   * unavailable.
+   *
+   * @return The multiplexer type
+   */
+  inline HttpConfig::MultiplexerType multiplexerType() const { return _multiplexerType; }
+
   //
   // ESB::Command
   //
@@ -138,47 +218,82 @@ class HttpProxyMultiplexer : public ESB::SocketMultiplexer, public HttpMultiplex
   virtual ESB::Error addMultiplexedSocket(ESB::MultiplexedSocket *multiplexedSocket);
   virtual ESB::Error updateMultiplexedSocket(ESB::MultiplexedSocket *socket);
   virtual ESB::Error removeMultiplexedSocket(ESB::MultiplexedSocket *socket);
+  virtual ESB::Error addTimer(ESB::Timer *timer, ESB::UInt32 delayMsec);
+  virtual ESB::Error updateTimer(ESB::Timer *timer, ESB::UInt32 delayMsec);
+  virtual ESB::Error removeTimer(ESB::Timer *timer);
   virtual int currentSockets() const;
   virtual int maximumSockets() const;
   virtual bool isRunning() const;
 
+  virtual const ESB::EventLoopCounters *eventLoopCounters() const;
+
   //
   //
   // ES::HttpMultiplexer
   //
 
   virtual bool shutdown();
-  virtual ESB::Buffer *acquireBuffer();
+  virtual ESB::Buffer *acquireBuffer(ESB::UInt32 sizeClass);
   virtual void releaseBuffer(ESB::Buffer *buffer);
+  virtual ESB::UInt32 bufferSizeClasses() const;
+  virtual ESB::UInt32 bufferSize(ESB::UInt32 sizeClass) const;
 
   virtual HttpClientTransaction *createClientTransaction();
   virtual ESB::Error executeClientTransaction(HttpClientTransaction *transaction);
   virtual void destroyClientTransaction(HttpClientTransaction *transaction);
+  virtual ESB::DnsClient &dnsClient();
+  virtual ESB::SocketSplicer::PipePool &splicePipes();
 
   virtual HttpServerTransaction *createServerTransaction();
   virtual void destroyServerTransaction(HttpServerTransaction *transaction);
 
   virtual ESB::Error addServerSocket(ESB::Socket::State &state);
+  virtual ESB::Error acceptServerSocket(ESB::Socket::State &state);
   virtual ESB::Error addListeningSocket(ESB::ListeningSocket &socket);
   virtual HttpServerCounters &serverCounters();
 
   virtual ESB::SocketMultiplexer &multiplexer();
 
  private:
-  ESB::DiscardAllocator _ioBufferPoolAllocator;
-  ESB::BufferPool _ioBufferPool;
+  friend class HttpAcceptBalancer;
+
+  // Only this multiplexer's thread counts, so a relaxed load and store is enough
+  inline void countAcceptHandoff() {
+    __atomic_store_n(&_acceptHandoffs, __atomic_load_n(&_acceptHandoffs, __ATOMIC_RELAXED) + 1U, __ATOMIC_RELAXED);
+  }
+
+  /** Create the socket multiplexer selected by HttpConfig, falling back to epoll if io_uring is unavailable.
+   *
+   * @param type Will be set to the type of the multiplexer created
+   * @return The multiplexer or NULL if it could not be allocated
+   */
+  static ESB::SocketMultiplexer *CreateMultiplexer(const char *namePrefix, ESB::UInt32 maxSockets,
+                                                   ESB::UInt32 idleTimeoutMsec, HttpConfig::MultiplexerType *type);
+
+  ESB::SizeClassBufferPool &_ioBufferPool;
+  const ESB::UInt32 _ioBufferShard;
+  ESB::SocketSplicer::PipePool _splicePipes;  // outlives the transactions that borrow its pipes
   ESB::DiscardAllocator _factoryAllocator;
-  ESB::EpollMultiplexer _multiplexer;
+  HttpConfig::MultiplexerType _multiplexerType;  // set by CreateMultiplexer(), so declared before _multiplexer
+  ESB::SocketMultiplexer *_multiplexer;
+  ESB::AsyncDnsClient _dnsClient;
   HttpServerSocketFactory _serverSocketFactory;
   HttpServerTransactionFactory _serverTransactionFactory;
   HttpServerCommandSocket _serverCommandSocket;
   HttpClientSocketFactory _clientSocketFactory;
   HttpClientTransactionFactory _clientTransactionFactory;
   HttpClientCommandSocket _clientCommandSocket;
+  HttpConnectionWarmer _connectionWarmer;
   HttpClientHandler &_clientHandler;
   HttpServerHandler &_serverHandler;
   HttpClientCounters &_clientCounters;
   HttpServerCounters &_serverCounters;
+  HttpAcceptBalancer *_acceptBalancer;
+  ESB::Rand _rand;
+  ESB::SharedInt _pendingHandoffs;
+  ESB::UInt64 _acceptHandoffs;
+  // Connections stolen from another multiplexer's pool release buffers they acquired there, so this may go negative
+  ESB::Int32 _buffersInUse;
 
   ESB_DEFAULT_FUNCS(HttpProxyMultiplexer);
 };
@@ -13,6 +13,14 @@
 #include <ESHttpServerCommand.h>
 #endif
 
+#ifndef ES_HTTP_ACCEPT_BALANCER_H
+#include <ESHttpAcceptBalancer.h>
+#endif
+
+#ifndef ES_HTTP_CONFIG_H
+#include <ESHttpConfig.h>
+#endif
+
 #ifndef ESB_SHARED_INT_H
 #include <ESBSharedInt.h>
 #endif
@@ -21,6 +29,14 @@
 #include <ESBThreadPool.h>
 #endif
 
+#ifndef ESB_SIZE_CLASS_BUFFER_POOL_H
+#include <ESBSizeClassBufferPool.h>
+#endif
+
+#ifndef ESB_DNS_CACHE_H
+#include <ESBDnsCache.h>
+#endif
+
 #ifndef ESB_LIST_H
 #include <ESBList.h>
 #endif
@@ -29,6 +45,10 @@
 #include <ESBRand.h>
 #endif
 
+#ifndef ESB_EVENT_LOOP_COUNTERS_H
+#include <ESBEventLoopCounters.h>
+#endif
+
 #ifndef ESB_SERVER_TLS_CONTEXT_INDEX_H
 #include <ESBServerTLSContextIndex.h>
 #endif
@@ -67,9 +87,11 @@ class HttpServer {
    * call listen on it.
    *
    * @param listener A listening socket to add to each multiplexer thread
+   * @param threads Accept only on this many multiplexer threads, starting from the first, or 0 to accept on all of
+   * them.  With accept balancing the other threads still receive connections.
    * @return ESB_SUCCESS if successful, another error code otherwise.
    */
-  ESB::Error addListener(ESB::ListeningSocket &listener);
+  ESB::Error addListener(ESB::ListeningSocket &listener, ESB::UInt32 threads = 0U);
 
   /**
    * Get the number of multiplexer threads (1 multiplexer per thread).
@@ -78,6 +100,39 @@ class HttpServer {
    */
   inline ESB::UInt32 threads() { return _threads; }
 
+  /**
+   * Get the number of sockets a multiplexer is currently handling.  Safe to call from any thread after start().
+   *
+   * @param idx the index of a multiplexer ranging from 0 to threads()-1 inclusive.
+   * @return The number of sockets or 0 if there is no such multiplexer
+   */
+  ESB::UInt32 currentSockets(ESB::UInt32 idx);
+
+  /**
+   * Get the counters that describe a multiplexer's event loop.  Safe to call from any thread after start().
+   *
+   * @param idx the index of a multiplexer ranging from 0 to threads()-1 inclusive.
+   * @return The event loop counters or NULL if there is no such multiplexer or it does not keep them.
+   */
+  const ESB::EventLoopCounters *eventLoopCounters(ESB::UInt32 idx);
+
+  /**
+   * Get the number of accepted connections a multiplexer handed to a less loaded one.  Safe to call from any thread
+   * after start().
+   *
+   * @param idx the index of a multiplexer ranging from 0 to threads()-1 inclusive.
+   * @return The number of handoffs or 0 if there is no such multiplexer
+   */
+  ESB::UInt64 acceptHandoffs(ESB::UInt32 idx);
+
+  /**
+   * Get the kind of socket multiplexer a multiplexer runs on.  Safe to call from any thread after start().
+   *
+   * @param idx the index of a multiplexer ranging from 0 to threads()-1 inclusive.
+   * @return The multiplexer type, or epoll if there is no such multiplexer
+   */
+  HttpConfig::MultiplexerType multiplexerType(ESB::UInt32 idx);
+
   ESB::Error initialize();
 
   ESB::Error start();
@@ -90,6 +145,10 @@ class HttpServer {
 
   inline const HttpServerCounters &serverCounters() const { return _serverCounters; }
 
+  inline const ESB::SizeClassBufferPool &ioBufferPool() const { return _ioBufferPool; }
+
+  inline ESB::DnsCache &dnsCache() { return _dnsCache; }
+
   class AddListeningSocketCommand : public HttpServerCommand {
    public:
     AddListeningSocketCommand(ESB::ListeningSocket &socket, ESB::CleanupHandler &cleanupHandler)
@@ -111,7 +170,7 @@ class HttpServer {
   };
 
  protected:
-  virtual ESB::SocketMultiplexer *createMultiplexer();
+  virtual ESB::SocketMultiplexer *createMultiplexer(ESB::UInt32 idx);
 
   virtual void destroyMultiplexer(ESB::SocketMultiplexer *multiplexer);
 
@@ -130,7 +189,10 @@ class HttpServer {
   HttpServerHandler &_serverHandler;
   ESB::List _multiplexers;
   ESB::ThreadPool _threadPool;
+  ESB::SizeClassBufferPool _ioBufferPool;
+  ESB::DnsCache _dnsCache;
   ESB::Rand _rand;
+  HttpAcceptBalancer _acceptBalancer;
   ESB::ServerTLSContextIndex _serverContextIndex;
   HttpServerSimpleCounters _serverCounters;
   char _name[ESB_NAME_PREFIX_SIZE];
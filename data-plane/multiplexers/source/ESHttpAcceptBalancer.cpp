@@ -0,0 +1,168 @@
+#ifndef ES_HTTP_ACCEPT_BALANCER_H
+#include <ESHttpAcceptBalancer.h>
+#endif
+
+#ifndef ES_HTTP_PROXY_MULTIPLEXER_H
+#include <ESHttpProxyMultiplexer.h>
+#endif
+
+#ifndef ESB_READ_SCOPE_LOCK_H
+#include <ESBReadScopeLock.h>
+#endif
+
+#ifndef ESB_WRITE_SCOPE_LOCK_H
+#include <ESBWriteScopeLock.h>
+#endif
+
+namespace ES {
+
+HttpAcceptBalancer::HttpAcceptBalancer(ESB::UInt32 maxMultiplexers, ESB::Allocator &allocator)
+    : _maxMultiplexers(maxMultiplexers), _size(0U), _multiplexers(NULL), _lock(), _allocator(allocator) {
+  ESB::Error error = _allocator.allocate(_maxMultiplexers * sizeof(HttpProxyMultiplexer *), (void **)&_multiplexers);
+  if (ESB_SUCCESS != error) {
+    // _multiplexers will be checked in later functions
+    _multiplexers = NULL;
+  }
+}
+
+HttpAcceptBalancer::~HttpAcceptBalancer() {
+  if (_multiplexers) {
+    _allocator.deallocate(_multiplexers);
+    _multiplexers = NULL;
+  }
+}
+
+ESB::Error HttpAcceptBalancer::attach(HttpProxyMultiplexer *multiplexer) {
+  if (!multiplexer) {
+    return ESB_NULL_POINTER;
+  }
+
+  ESB::WriteScopeLock lock(_lock);
+
+  if (!_multiplexers) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  if (_size >= _maxMultiplexers) {
+    return ESB_OVERFLOW;
+  }
+
+  _multiplexers[_size++] = multiplexer;
+  return ESB_SUCCESS;
+}
+
+void HttpAcceptBalancer::detach(HttpProxyMultiplexer *multiplexer) {
+  ESB::WriteScopeLock lock(_lock);
+
+  for (ESB::UInt32 i = 0; i < _size; ++i) {
+    if (_multiplexers[i] == multiplexer) {
+      _multiplexers[i] = _multiplexers[--_size];
+      return;
+    }
+  }
+}
+
+bool HttpAcceptBalancer::ShouldHandoff(ESB::UInt32 load, ESB::UInt32 targetLoad) {
+  return ES_HTTP_ACCEPT_BALANCE_MIN_LOAD <= load &&
+         (ESB::UInt64)load * 100U > (ESB::UInt64)targetLoad * (100U + ES_HTTP_ACCEPT_BALANCE_THRESHOLD_PERCENT);
+}
+
+ESB::Error HttpAcceptBalancer::handoff(HttpProxyMultiplexer &source, ESB::Socket::State &state, ESB::Rand &rand) {
+  const ESB::UInt32 load = source.acceptLoad();
+
+  if (!ShouldHandoff(load, 0U)) {
+    return ESB_CANNOT_FIND;
+  }
+
+  HttpProxyMultiplexer *target = NULL;
+
+  {
+    ESB::ReadScopeLock lock(_lock);
+
+    if (2U > _size) {
+      return ESB_CANNOT_FIND;
+    }
+
+    // Power of two choices among the other multiplexers.  Both endpoints of the range are inclusive, and the last
+    // multiplexer stands in for the source when it is drawn so every draw lands on another multiplexer.
+    ESB::UInt32 targetLoad = ESB_UINT32_MAX;
+    for (int i = 0; i < 2; ++i) {
+      HttpProxyMultiplexer *candidate = _multiplexers[rand.generate(0U, _size - 2)];
+      if (candidate == &source) {
+        candidate = _multiplexers[_size - 1];
+      }
+      if (candidate == target || !candidate->isRunning()) {
+        continue;
+      }
+      const ESB::UInt32 candidateLoad = candidate->acceptLoad();
+      if (candidateLoad < targetLoad) {
+        target = candidate;
+        targetLoad = candidateLoad;
+      }
+    }
+
+    if (!target || !ShouldHandoff(load, targetLoad)) {
+      return ESB_CANNOT_FIND;
+    }
+
+    // Count the connection against the target now so concurrent acceptors see it before the target adds it
+    target->_pendingHandoffs.inc();
+  }
+
+  HandoffCommand *command = new (ESB::SystemAllocator::Instance()) HandoffCommand(*target, state);
+
+  if (!command) {
+    target->_pendingHandoffs.dec();
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  ESB::Error error = target->pushServerCommand(command);
+
+  if (ESB_SHUTDOWN == error) {
+    // The caller keeps the connection, so the command must not close it
+    command->disown();
+    command->~HandoffCommand();
+    ESB::SystemAllocator::Instance().deallocate(command);
+    return error;
+  }
+
+  if (ESB_SUCCESS != error) {
+    // The command is queued even if the target could not be woken, and it will add or close the connection
+    ESB_LOG_WARNING_ERRNO(error, "[%s] cannot wake multiplexer for handed off connection", target->name());
+  }
+
+  source.countAcceptHandoff();
+  return ESB_SUCCESS;
+}
+
+HttpAcceptBalancer::HandoffCommand::HandoffCommand(HttpProxyMultiplexer &target, ESB::Socket::State &state)
+    : _target(target),
+      _state(state.isBlocking(), state.socketDescriptor(), state.localAddress(), state.peerAddress()) {}
+
+HttpAcceptBalancer::HandoffCommand::~HandoffCommand() {
+  if (INVALID_SOCKET != _state.socketDescriptor()) {
+    ESB::Socket::Close(_state.socketDescriptor());
+    _state.setSocketDescriptor(INVALID_SOCKET);
+  }
+  _target._pendingHandoffs.dec();
+}
+
+ESB::Error HttpAcceptBalancer::HandoffCommand::run(HttpMultiplexerExtended &multiplexer) {
+  ESB::Error error = multiplexer.addServerSocket(_state);
+
+  if (ESB_SUCCESS != error && ESB_CLOSED != error) {
+    ESB_LOG_ERROR_ERRNO(error, "[%s] cannot add handed off connection to multiplexer", _target.name());
+  }
+
+  // The server socket owns the descriptor now, or has already closed it
+  _state.setSocketDescriptor(INVALID_SOCKET);
+  return error;
+}
+
+ESB::CleanupHandler *HttpAcceptBalancer::HandoffCommand::cleanupHandler() {
+  return &ESB::SystemAllocator::Instance().cleanupHandler();
+}
+
+const char *HttpAcceptBalancer::HandoffCommand::name() { return "accept handoff"; }
+
+}  // namespace ES
@@ -0,0 +1,506 @@
+#ifndef ES_HTTP_METRICS_HANDLER_H
+#include <ESHttpMetricsHandler.h>
+#endif
+
+#ifndef ESB_SYSTEM_ALLOCATOR_H
+#include <ESBSystemAllocator.h>
+#endif
+
+#ifdef HAVE_STDARG_H
+#include <stdarg.h>
+#endif
+
+#ifdef HAVE_STDIO_H
+#include <stdio.h>
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+namespace ES {
+
+// Append to the buffer like snprintf, tracking the length the text would have if the buffer were large enough
+static void Append(char *buffer, ESB::UInt32 size, ESB::UInt32 *length, const char *format, ...)
+    __attribute__((format(printf, 4, 5)));
+
+static void Append(char *buffer, ESB::UInt32 size, ESB::UInt32 *length, const char *format, ...) {
+  const ESB::UInt32 offset = MIN(*length, size);
+  va_list args;
+  va_start(args, format);
+  const int bytes = vsnprintf(buffer + offset, size - offset, format, args);
+  va_end(args);
+
+  if (0 < bytes) {
+    *length += bytes;
+  }
+}
+
+static void AppendMetadata(char *buffer, ESB::UInt32 size, ESB::UInt32 *length, const char *name, const char *type,
+                           const char *help) {
+  Append(buffer, size, length, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void AppendValue(char *buffer, ESB::UInt32 size, ESB::UInt32 *length, const char *name, const char *type,
+                        const char *help, ESB::UInt64 value) {
+  AppendMetadata(buffer, size, length, name, type, help);
+  Append(buffer, size, length, "%s %lu\n", name, (unsigned long)value);
+}
+
+// Append one summary's samples.  labels is either empty or a comma-separated list of label="value" pairs.
+static void AppendSummarySamples(char *buffer, ESB::UInt32 size, ESB::UInt32 *length, const char *name,
+                                 const char *labels, const ESB::PerformanceCounter &counter) {
+  ESB::PerformanceCounter::Snapshot snapshot;
+  counter.snapshot(&snapshot);
+
+  const char *separator = *labels ? "," : "";
+
+  if (snapshot._hasPercentiles) {
+    Append(buffer, size, length,
+           "%s{%s%squantile=\"0.5\"} %.6f\n%s{%s%squantile=\"0.9\"} %.6f\n%s{%s%squantile=\"0.99\"} %.6f\n"
+           "%s{%s%squantile=\"0.999\"} %.6f\n",
+           name, labels, separator, snapshot._p50MSec / 1000.0, name, labels, separator, snapshot._p90MSec / 1000.0,
+           name, labels, separator, snapshot._p99MSec / 1000.0, name, labels, separator, snapshot._p999MSec / 1000.0);
+  }
+
+  if (*labels) {
+    Append(buffer, size, length, "%s_sum{%s} %.6f\n%s_count{%s} %lu\n", name, labels, snapshot._sumMSec / 1000.0, name,
+           labels, (unsigned long)snapshot._queries);
+  } else {
+    Append(buffer, size, length, "%s_sum %.6f\n%s_count %lu\n", name, snapshot._sumMSec / 1000.0, name,
+           (unsigned long)snapshot._queries);
+  }
+}
+
+static void AppendSummary(char *buffer, ESB::UInt32 size, ESB::UInt32 *length, const char *name, const char *help,
+                          const ESB::PerformanceCounter &counter) {
+  AppendMetadata(buffer, size, length, name, "summary", help);
+  AppendSummarySamples(buffer, size, length, name, "", counter);
+}
+
+HttpMetricsHandler::HttpMetricsHandler(HttpServer &server) : _server(server), _proxy(NULL) {}
+
+HttpMetricsHandler::HttpMetricsHandler(HttpProxy &proxy) : _server(proxy), _proxy(&proxy) {}
+
+HttpMetricsHandler::~HttpMetricsHandler() {}
+
+ESB::UInt32 HttpMetricsHandler::render(char *buffer, ESB::UInt32 size) {
+  ESB::UInt32 length = 0U;
+
+  if (0 < size) {
+    buffer[0] = 0;
+  }
+
+  //
+  // Server
+  //
+
+  const HttpServerCounters &server = _server.serverCounters();
+
+  AppendValue(buffer, size, &length, "es_server_connections_total", "counter", "Connections accepted.",
+              server.getTotalConnections()->get());
+  AppendMetadata(buffer, size, &length, "es_server_transactions_per_connection", "gauge",
+                 "Mean transactions per closed connection.");
+  Append(buffer, size, &length, "es_server_transactions_per_connection %.6f\n",
+         server.getAverageTransactionsPerConnection()->mean());
+  AppendSummary(buffer, size, &length, "es_server_transaction_seconds",
+                "Latency of successful transactions from the first request byte.", *server.getSuccessfulTransactions());
+  AppendSummary(buffer, size, &length, "es_server_time_to_first_byte_seconds",
+                "Latency from the first request byte until the response headers are sent.",
+                *server.getTimeToFirstByte());
+
+  AppendMetadata(buffer, size, &length, "es_server_transaction_failures_total", "counter",
+                 "Transactions that did not complete by phase and cause.");
+  {
+    static const char *Phases[] = {"request_headers", "request_body", "response_headers", "response_body"};
+    const ESB::PerformanceCounter *failures[][3] = {
+        {server.getRequestHeaderErrors(), server.getRequestHeaderFailures(), server.getRequestHeaderTimeouts()},
+        {server.getRequestBodyErrors(), server.getRequestBodyFailures(), server.getRequestBodyTimeouts()},
+        {server.getResponseHeaderErrors(), server.getResponseHeaderFailures(), server.getResponseHeaderTimeouts()},
+        {server.getResponseBodyErrors(), server.getResponseBodyFailures(), server.getResponseBodyTimeouts()}};
+
+    for (ESB::UInt32 i = 0; i < sizeof(Phases) / sizeof(Phases[0]); ++i) {
+      Append(buffer, size, &length,
+             "es_server_transaction_failures_total{phase=\"%s\",cause=\"error\"} %u\n"
+             "es_server_transaction_failures_total{phase=\"%s\",cause=\"failure\"} %u\n"
+             "es_server_transaction_failures_total{phase=\"%s\",cause=\"timeout\"} %u\n",
+             Phases[i], failures[i][0]->queries(), Phases[i], failures[i][1]->queries(), Phases[i],
+             failures[i][2]->queries());
+    }
+  }
+
+  {
+    // Every server handshake is counted by the default context, even when the client's SNI selects another one
+    ESB::TLSContextPointer &context = _server.serverTlsContextIndex().defaultContext();
+
+    AppendMetadata(buffer, size, &length, "es_server_tls_handshakes_total", "counter",
+                   "Completed TLS handshakes with clients by whether a session was resumed.");
+    Append(buffer, size, &length,
+           "es_server_tls_handshakes_total{result=\"full\"} %u\n"
+           "es_server_tls_handshakes_total{result=\"resumed\"} %u\n",
+           context.isNull() ? 0U : context->fullHandshakes(), context.isNull() ? 0U : context->resumedHandshakes());
+  }
+
+  //
+  // Multiplexers
+  //
+
+  AppendMetadata(buffer, size, &length, "es_multiplexer_sockets", "gauge", "Sockets handled by each multiplexer.");
+  for (ESB::UInt32 i = 0; i < _server.threads(); ++i) {
+    Append(buffer, size, &length, "es_multiplexer_sockets{multiplexer=\"%u\"} %u\n", i, _server.currentSockets(i));
+  }
+
+  AppendMetadata(buffer, size, &length, "es_accept_handoffs_total", "counter",
+                 "Accepted connections each multiplexer handed to a less loaded one.");
+  for (ESB::UInt32 i = 0; i < _server.threads(); ++i) {
+    Append(buffer, size, &length, "es_accept_handoffs_total{multiplexer=\"%u\"} %lu\n", i,
+           (unsigned long)_server.acceptHandoffs(i));
+  }
+
+  //
+  // Event loops
+  //
+
+  {
+    // Resolve each multiplexer once so every metric family below sees the same set
+    const ESB::EventLoopCounters *loops[ES_HTTP_METRICS_MAX_MULTIPLEXERS];
+    const ESB::UInt32 threads = MIN(_server.threads(), ES_HTTP_METRICS_MAX_MULTIPLEXERS);
+    char labels[64];
+
+    for (ESB::UInt32 i = 0; i < threads; ++i) {
+      loops[i] = _server.eventLoopCounters(i);
+    }
+
+    AppendMetadata(buffer, size, &length, "es_event_loop_wait_seconds", "summary",
+                   "Time each multiplexer spent waiting for events.");
+    for (ESB::UInt32 i = 0; i < threads; ++i) {
+      if (loops[i]) {
+        snprintf(labels, sizeof(labels), "multiplexer=\"%u\"", i);
+        AppendSummarySamples(buffer, size, &length, "es_event_loop_wait_seconds", labels, loops[i]->wait());
+      }
+    }
+
+    AppendMetadata(buffer, size, &length, "es_event_loop_busy_seconds", "summary",
+                   "Time each multiplexer spent handling one batch of events, from wakeup until it waited again.");
+    for (ESB::UInt32 i = 0; i < threads; ++i) {
+      if (loops[i]) {
+        snprintf(labels, sizeof(labels), "multiplexer=\"%u\"", i);
+        AppendSummarySamples(buffer, size, &length, "es_event_loop_busy_seconds", labels, loops[i]->busy());
+      }
+    }
+
+    AppendMetadata(buffer, size, &length, "es_event_loop_lag_seconds", "gauge",
+                   "Moving average of the time each multiplexer takes to handle a batch of events.");
+    for (ESB::UInt32 i = 0; i < threads; ++i) {
+      if (loops[i]) {
+        Append(buffer, size, &length, "es_event_loop_lag_seconds{multiplexer=\"%u\"} %.6f\n", i,
+               loops[i]->lagMicroSeconds() / 1000000.0);
+      }
+    }
+
+    AppendMetadata(buffer, size, &length, "es_event_loop_handler_seconds", "summary",
+                   "Time spent in each kind of socket handler and in dead socket cleanup.");
+    for (ESB::UInt32 i = 0; i < threads; ++i) {
+      if (!loops[i]) {
+        continue;
+      }
+      const char *handlers[] = {"accept", "connect", "readable", "writable", "cleanup"};
+      const ESB::HistogramPerformanceCounter *counters[] = {&loops[i]->accept(), &loops[i]->connect(),
+                                                            &loops[i]->readable(), &loops[i]->writable(),
+                                                            &loops[i]->cleanup()};
+      for (ESB::UInt32 j = 0; j < sizeof(handlers) / sizeof(handlers[0]); ++j) {
+        snprintf(labels, sizeof(labels), "multiplexer=\"%u\",handler=\"%s\"", i, handlers[j]);
+        AppendSummarySamples(buffer, size, &length, "es_event_loop_handler_seconds", labels, *counters[j]);
+      }
+    }
+
+    AppendMetadata(buffer, size, &length, "es_event_loop_wakeups_total", "counter",
+                   "Returns from the wait for events, including timeouts.");
+    for (ESB::UInt32 i = 0; i < threads; ++i) {
+      if (loops[i]) {
+        Append(buffer, size, &length, "es_event_loop_wakeups_total{multiplexer=\"%u\"} %lu\n", i,
+               (unsigned long)loops[i]->wakeups());
+      }
+    }
+
+    AppendMetadata(buffer, size, &length, "es_event_loop_events_total", "counter", "Events delivered by all wakeups.");
+    for (ESB::UInt32 i = 0; i < threads; ++i) {
+      if (loops[i]) {
+        Append(buffer, size, &length, "es_event_loop_events_total{multiplexer=\"%u\"} %lu\n", i,
+               (unsigned long)loops[i]->events());
+      }
+    }
+
+    AppendMetadata(buffer, size, &length, "es_event_loop_max_events", "gauge",
+                   "Most events delivered by a single wakeup.");
+    for (ESB::UInt32 i = 0; i < threads; ++i) {
+      if (loops[i]) {
+        Append(buffer, size, &length, "es_event_loop_max_events{multiplexer=\"%u\"} %lu\n", i,
+               (unsigned long)loops[i]->maxEvents());
+      }
+    }
+
+    AppendMetadata(buffer, size, &length, "es_event_loop_spurious_events_total", "counter",
+                   "Readiness events delivered to sockets that no longer wanted them.");
+    for (ESB::UInt32 i = 0; i < threads; ++i) {
+      if (loops[i]) {
+        Append(buffer, size, &length,
+               "es_event_loop_spurious_events_total{multiplexer=\"%u\",event=\"readable\"} %lu\n"
+               "es_event_loop_spurious_events_total{multiplexer=\"%u\",event=\"writable\"} %lu\n",
+               i, (unsigned long)loops[i]->spuriousReadable(), i, (unsigned long)loops[i]->spuriousWritable());
+      }
+    }
+
+    AppendMetadata(buffer, size, &length, "es_event_loop_stalls_total", "counter",
+                   "Handler calls that kept the event loop busy for too long.");
+    for (ESB::UInt32 i = 0; i < threads; ++i) {
+      if (loops[i]) {
+        Append(buffer, size, &length, "es_event_loop_stalls_total{multiplexer=\"%u\"} %lu\n", i,
+               (unsigned long)loops[i]->stalls());
+      }
+    }
+  }
+
+  //
+  // Buffer pool
+  //
+
+  {
+    const ESB::SizeClassBufferPool &pool = _server.ioBufferPool();
+
+    AppendMetadata(buffer, size, &length, "es_buffer_pool_buffers", "gauge",
+                   "Buffers currently allocated, in use or cached, by buffer size.");
+    for (ESB::UInt32 i = 0; i < pool.sizeClasses(); ++i) {
+      Append(buffer, size, &length, "es_buffer_pool_buffers{size=\"%u\"} %u\n", pool.bufferSize(i),
+             pool.pool(i)->buffers());
+    }
+
+    AppendMetadata(buffer, size, &length, "es_buffer_pool_high_watermark", "gauge",
+                   "Most buffers allocated at the same time, by buffer size.");
+    for (ESB::UInt32 i = 0; i < pool.sizeClasses(); ++i) {
+      Append(buffer, size, &length, "es_buffer_pool_high_watermark{size=\"%u\"} %u\n", pool.bufferSize(i),
+             pool.pool(i)->highWatermark());
+    }
+
+    AppendMetadata(buffer, size, &length, "es_buffer_pool_acquisitions_total", "counter",
+                   "Buffer acquisitions by buffer size and whether a free buffer was found.");
+    for (ESB::UInt32 i = 0; i < pool.sizeClasses(); ++i) {
+      Append(buffer, size, &length,
+             "es_buffer_pool_acquisitions_total{size=\"%u\",result=\"hit\"} %lu\n"
+             "es_buffer_pool_acquisitions_total{size=\"%u\",result=\"miss\"} %lu\n",
+             pool.bufferSize(i), (unsigned long)pool.pool(i)->hits(), pool.bufferSize(i),
+             (unsigned long)pool.pool(i)->misses());
+    }
+  }
+
+  if (!_proxy) {
+    return length;
+  }
+
+  //
+  // Client
+  //
+
+  const HttpClientCounters &client = _proxy->clientCounters();
+
+  AppendSummary(buffer, size, &length, "es_client_transaction_seconds", "Latency of successful client transactions.",
+                *client.getSuccesses());
+  AppendSummary(buffer, size, &length, "es_client_failed_transaction_seconds",
+                "Latency of failed client transactions.", *client.getFailures());
+  AppendSummary(buffer, size, &length, "es_client_connect_seconds", "Latency of new upstream connections.",
+                *client.getConnects());
+  AppendSummary(buffer, size, &length, "es_client_time_to_first_byte_seconds",
+                "Latency until upstream response headers are received.", *client.getTimeToFirstByte());
+
+  //
+  // Connection pools
+  //
+
+  {
+    ESB::UInt64 hits = 0U;
+    ESB::UInt64 misses = 0U;
+    ESB::UInt64 steals = 0U;
+    _proxy->connectionPools().counters(&hits, &misses, &steals);
+
+    AppendMetadata(buffer, size, &length, "es_connection_pool_acquisitions_total", "counter",
+                   "Upstream connection acquisitions by whether an idle connection was reused.");
+    Append(buffer, size, &length,
+           "es_connection_pool_acquisitions_total{result=\"hit\"} %lu\n"
+           "es_connection_pool_acquisitions_total{result=\"miss\"} %lu\n"
+           "es_connection_pool_acquisitions_total{result=\"steal\"} %lu\n",
+           (unsigned long)hits, (unsigned long)misses, (unsigned long)steals);
+  }
+
+  //
+  // Client TLS
+  //
+
+  {
+    const ESB::TLSSessionCache &cache = _proxy->clientTlsContextIndex().sessionCache();
+
+    AppendMetadata(buffer, size, &length, "es_client_tls_handshakes_total", "counter",
+                   "Completed TLS handshakes with upstream servers by whether a session was resumed.");
+    Append(buffer, size, &length,
+           "es_client_tls_handshakes_total{result=\"full\"} %u\n"
+           "es_client_tls_handshakes_total{result=\"resumed\"} %u\n",
+           cache.fullHandshakes(), cache.resumedHandshakes());
+
+    AppendMetadata(buffer, size, &length, "es_client_tls_session_cache_lookups_total", "counter",
+                   "TLS session cache lookups by whether a resumable session was found.");
+    Append(buffer, size, &length,
+           "es_client_tls_session_cache_lookups_total{result=\"hit\"} %u\n"
+           "es_client_tls_session_cache_lookups_total{result=\"miss\"} %u\n",
+           cache.hits(), cache.misses());
+
+    AppendValue(buffer, size, &length, "es_client_tls_session_cache_evictions_total", "counter",
+                "Cached TLS sessions evicted to make room for newer ones.", cache.evictions());
+  }
+
+  return length;
+}
+
+ESB::Error HttpMetricsHandler::acceptConnection(HttpMultiplexer &multiplexer, ESB::SocketAddress *address) {
+  return ESB_SUCCESS;
+}
+
+ESB::Error HttpMetricsHandler::beginTransaction(HttpMultiplexer &multiplexer, HttpServerStream &stream) {
+  Context *context = new (stream.allocator()) Context();
+  if (!context) {
+    ESB_LOG_WARNING_ERRNO(ESB_OUT_OF_MEMORY, "[%s] Cannot allocate new transaction", stream.logAddress());
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  assert(!stream.context());
+  stream.setContext(context);
+  return ESB_SUCCESS;
+}
+
+ESB::Error HttpMetricsHandler::receiveRequestHeaders(HttpMultiplexer &multiplexer, HttpServerStream &stream) {
+  Context *context = (Context *)stream.context();
+  assert(context);
+  if (!context) {
+    return ESB_INVALID_STATE;
+  }
+
+  const HttpRequest &request = stream.request();
+  context->_found = request.method() && 0 == strcmp((const char *)request.method(), "GET") &&
+                    request.requestUri().absPath() &&
+                    0 == strcmp((const char *)request.requestUri().absPath(), "/metrics");
+  return ESB_SUCCESS;
+}
+
+ESB::Error HttpMetricsHandler::consumeRequestBody(HttpMultiplexer &multiplexer, HttpServerStream &stream,
+                                                  unsigned const char *chunk, ESB::UInt64 chunkSize,
+                                                  ESB::UInt64 *bytesConsumed) {
+  assert(bytesConsumed);
+  Context *context = (Context *)stream.context();
+  assert(context);
+  if (!context) {
+    return ESB_INVALID_STATE;
+  }
+
+  *bytesConsumed = chunkSize;
+
+  if (0 < chunkSize) {
+    return ESB_SUCCESS;
+  }
+
+  HttpResponse &response = stream.response();
+  ESB::Allocator &allocator = stream.allocator();
+
+  if (!context->_found) {
+    response.setStatusCode(404);
+    response.setReasonPhrase("Not Found");
+    ESB::Error error = response.addHeader("Content-Length", "0", allocator);
+    return ESB_SUCCESS == error ? ESB_SEND_RESPONSE : error;
+  }
+
+  // The body outgrows the transaction's allocator chunks, so it comes from the system allocator.  Counters can grow
+  // between the renders, so leave some slack the second time.
+  ESB::UInt32 size = ES_HTTP_METRICS_BUFFER_SIZE;
+  for (int i = 0; i < 2; ++i) {
+    ESB::Error error = ESB::SystemAllocator::Instance().allocate(size, (void **)&context->_body);
+    if (ESB_SUCCESS != error) {
+      ESB_LOG_WARNING_ERRNO(error, "[%s] Cannot allocate metrics", stream.logAddress());
+      return error;
+    }
+
+    const ESB::UInt32 length = render(context->_body, size);
+    if (length < size) {
+      context->_bodySize = length;
+      break;
+    }
+
+    ESB::SystemAllocator::Instance().deallocate(context->_body);
+    context->_body = NULL;
+    size = length + length / 4 + 1;
+  }
+
+  if (!context->_body) {
+    ESB_LOG_WARNING_ERRNO(ESB_OVERFLOW, "[%s] Cannot render metrics", stream.logAddress());
+    return ESB_OVERFLOW;
+  }
+
+  response.setStatusCode(200);
+  response.setReasonPhrase("OK");
+
+  ESB::Error error = response.addHeader("Content-Type", "text/plain; version=0.0.4", allocator);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  error = response.addHeader(allocator, "Content-Length", "%u", context->_bodySize);
+  if (ESB_SUCCESS != error) {
+    return error;
+  }
+
+  return ESB_SEND_RESPONSE;
+}
+
+ESB::Error HttpMetricsHandler::offerResponseBody(HttpMultiplexer &multiplexer, HttpServerStream &stream,
+                                                 ESB::UInt64 *bytesAvailable) {
+  assert(bytesAvailable);
+  Context *context = (Context *)stream.context();
+  assert(context);
+  if (!context) {
+    return ESB_INVALID_STATE;
+  }
+
+  assert(context->_bytesSent <= context->_bodySize);
+  *bytesAvailable = context->_bodySize - context->_bytesSent;
+  return ESB_SUCCESS;
+}
+
+ESB::Error HttpMetricsHandler::produceResponseBody(HttpMultiplexer &multiplexer, HttpServerStream &stream,
+                                                   unsigned char *chunk, ESB::UInt64 bytesRequested) {
+  assert(chunk);
+  Context *context = (Context *)stream.context();
+  assert(context);
+  if (!context) {
+    return ESB_INVALID_STATE;
+  }
+
+  assert(bytesRequested <= context->_bodySize - context->_bytesSent);
+  memcpy(chunk, context->_body + context->_bytesSent, bytesRequested);
+  context->_bytesSent += bytesRequested;
+  return ESB_SUCCESS;
+}
+
+void HttpMetricsHandler::endTransaction(HttpMultiplexer &multiplexer, HttpServerStream &stream, State state) {
+  Context *context = (Context *)stream.context();
+  if (!context) {
+    return;
+  }
+
+  ESB::Allocator &allocator = stream.allocator();
+
+  if (context->_body) {
+    ESB::SystemAllocator::Instance().deallocate(context->_body);
+  }
+
+  context->~Context();
+  allocator.deallocate(context);
+  stream.setContext(NULL);
+}
+
+}  // namespace ES
@@ -21,8 +21,9 @@ HttpProxy::HttpProxy(const char *namePrefix, ESB::UInt32 threads, ESB::UInt32 id
     : HttpServer(namePrefix, threads, idleTimeoutMsec, proxyHandler, allocator),
       _proxyHandler(proxyHandler),
       _clientContextIndex(HttpConfig::Instance().tlsContextBuckets(), HttpConfig::Instance().tlsContextLocks(),
-                          _allocator),
-      _clientCounters(60, 1, _allocator) {}
+                          _allocator, HttpConfig::Instance().tlsSessionCacheSize()),
+      _clientCounters(60, 1, _allocator),
+      _connectionPools(_threads, _allocator) {}
 
 HttpProxy::~HttpProxy() {}
 
@@ -52,10 +53,11 @@ ESB::Error HttpProxy::push(HttpClientCommand *command, int idx) {
   return ESB_SUCCESS;
 }
 
-ESB::SocketMultiplexer *HttpProxy::createMultiplexer() {
-  return new (_allocator)
-      HttpProxyMultiplexer(_name, ESB::SystemConfig::Instance().socketSoftMax(), _idleTimeoutMsec, _proxyHandler,
-                           _proxyHandler, _clientCounters, _serverCounters, _clientContextIndex, _serverContextIndex);
+ESB::SocketMultiplexer *HttpProxy::createMultiplexer(ESB::UInt32 idx) {
+  return new (_allocator) HttpProxyMultiplexer(_name, ESB::SystemConfig::Instance().socketSoftMax(), _idleTimeoutMsec,
+                                               _ioBufferPool, idx, _dnsCache, _connectionPools, _proxyHandler,
+                                               _proxyHandler, _clientCounters, _serverCounters, _clientContextIndex,
+                                               _serverContextIndex);
 }
 
 }  // namespace ES
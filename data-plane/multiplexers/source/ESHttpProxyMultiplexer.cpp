@@ -6,6 +6,14 @@
 #include <ESHttpConfig.h>
 #endif
 
+#ifndef ES_HTTP_ACCEPT_BALANCER_H
+#include <ESHttpAcceptBalancer.h>
+#endif
+
+#ifndef ESB_EVENT_LOOP_COUNTERS_H
+#include <ESBEventLoopCounters.h>
+#endif
+
 namespace ES {
 
 class HttpNullClientHandler : public HttpClientHandler {
@@ -114,6 +122,26 @@ class HttpNullClientCounters : public HttpClientCounters {
     assert(0 == "HttpNullClientCounters called");
     return NULL;
   }
+
+  virtual ESB::PerformanceCounter *getConnects() {
+    assert(0 == "HttpNullClientCounters called");
+    return NULL;
+  }
+
+  virtual const ESB::PerformanceCounter *getConnects() const {
+    assert(0 == "HttpNullClientCounters called");
+    return NULL;
+  }
+
+  virtual ESB::PerformanceCounter *getTimeToFirstByte() {
+    assert(0 == "HttpNullClientCounters called");
+    return NULL;
+  }
+
+  virtual const ESB::PerformanceCounter *getTimeToFirstByte() const {
+    assert(0 == "HttpNullClientCounters called");
+    return NULL;
+  }
 };
 
 class HttpNullServerCounters : public HttpServerCounters {
@@ -129,6 +157,14 @@ class HttpNullServerCounters : public HttpServerCounters {
     assert(0 == "HttpNullServerCounters called");
     return NULL;
   }
+  virtual ESB::PerformanceCounter *getTimeToFirstByte() {
+    assert(0 == "HttpNullServerCounters called");
+    return NULL;
+  }
+  virtual const ESB::PerformanceCounter *getTimeToFirstByte() const {
+    assert(0 == "HttpNullServerCounters called");
+    return NULL;
+  }
   virtual ESB::PerformanceCounter *getRequestHeaderErrors() {
     assert(0 == "HttpNullServerCounters called");
     return NULL;
@@ -247,118 +283,242 @@ static HttpNullClientHandler HttpNullClientHandler;
 static HttpNullServerHandler HttpNullServerHandler;
 static HttpNullClientCounters HttpNullClientCounters;
 static HttpNullServerCounters HttpNullServerCounters;
-static ESB::ClientTLSContextIndex EmptyClientContextIndex(0, 0, ESB::SystemAllocator::Instance());
+static ESB::ClientTLSContextIndex EmptyClientContextIndex(0, 0, ESB::SystemAllocator::Instance(), 0);
 static ESB::ServerTLSContextIndex EmptyServerContextIndex(0, 0, ESB::SystemAllocator::Instance());
 
 HttpProxyMultiplexer::HttpProxyMultiplexer(const char *namePrefix, ESB::UInt32 maxSockets, ESB::UInt32 idleTimeoutMsec,
+                                           ESB::SizeClassBufferPool &ioBufferPool, ESB::UInt32 ioBufferShard,
+                                           ESB::DnsCache &dnsCache, ESB::ConnectionPool::Group &connectionPools,
                                            HttpClientHandler &clientHandler, HttpServerHandler &serverHandler,
                                            HttpClientCounters &clientCounters, HttpServerCounters &serverCounters,
                                            ESB::ClientTLSContextIndex &clientContextIndex,
                                            ESB::ServerTLSContextIndex &serverContextIndex)
-    : _ioBufferPoolAllocator(HttpConfig::Instance().ioBufferChunkSize(), ESB_CACHE_LINE_SIZE, ESB_PAGE_SIZE,
-                             ESB::SystemAllocator::Instance()),
-      _ioBufferPool(HttpConfig::Instance().ioBufferSize(), 0, ESB::NullLock::Instance(), _ioBufferPoolAllocator),
+    : _ioBufferPool(ioBufferPool),
+      _ioBufferShard(ioBufferShard),
+      _splicePipes(),
       _factoryAllocator(ESB_PAGE_SIZE * 1000 - ESB::DiscardAllocator::SizeofChunk(ESB_CACHE_LINE_SIZE),
                         ESB_CACHE_LINE_SIZE, ESB_PAGE_SIZE, ESB::SystemAllocator::Instance()),
-      _multiplexer(namePrefix, idleTimeoutMsec, maxSockets, ESB::SystemAllocator::Instance()),
+      _multiplexerType(HttpConfig::ES_HTTP_EPOLL_MULTIPLEXER),
+      _multiplexer(CreateMultiplexer(namePrefix, maxSockets, idleTimeoutMsec, &_multiplexerType)),
+      _dnsClient(namePrefix, *this, dnsCache, HttpConfig::Instance().dnsResolver()),
       _serverSocketFactory(*this, serverHandler, serverCounters, serverContextIndex, _factoryAllocator),
       _serverTransactionFactory(_factoryAllocator),
       _serverCommandSocket(namePrefix, *this),
-      _clientSocketFactory(*this, clientHandler, clientCounters, clientContextIndex, _factoryAllocator),
+      _clientSocketFactory(*this, clientHandler, clientCounters, clientContextIndex, &connectionPools,
+                           _factoryAllocator),
       _clientTransactionFactory(_factoryAllocator),
       _clientCommandSocket(namePrefix, *this),
+      _connectionWarmer(*this, _clientSocketFactory.connectionPool(), _factoryAllocator),
       _clientHandler(clientHandler),
       _serverHandler(serverHandler),
       _clientCounters(clientCounters),
-      _serverCounters(serverCounters) {}
+      _serverCounters(serverCounters),
+      _acceptBalancer(NULL),
+      _rand(),
+      _pendingHandoffs(),
+      _acceptHandoffs(0U),
+      _buffersInUse(0) {}
 
 HttpProxyMultiplexer::HttpProxyMultiplexer(const char *namePrefix, ESB::UInt32 maxSockets, ESB::UInt32 idleTimeoutMsec,
+                                           ESB::SizeClassBufferPool &ioBufferPool, ESB::UInt32 ioBufferShard,
+                                           ESB::DnsCache &dnsCache, ESB::ConnectionPool::Group &connectionPools,
                                            HttpClientHandler &clientHandler, HttpClientCounters &clientCounters,
                                            ESB::ClientTLSContextIndex &clientContextIndex)
-    : _ioBufferPoolAllocator(HttpConfig::Instance().ioBufferChunkSize(), ESB_CACHE_LINE_SIZE, ESB_PAGE_SIZE,
-                             ESB::SystemAllocator::Instance()),
-      _ioBufferPool(HttpConfig::Instance().ioBufferSize(), 0, ESB::NullLock::Instance(), _ioBufferPoolAllocator),
+    : _ioBufferPool(ioBufferPool),
+      _ioBufferShard(ioBufferShard),
+      _splicePipes(),
       _factoryAllocator(ESB_PAGE_SIZE * 1000 - ESB::DiscardAllocator::SizeofChunk(ESB_CACHE_LINE_SIZE),
                         ESB_CACHE_LINE_SIZE, ESB_PAGE_SIZE, ESB::SystemAllocator::Instance()),
-      _multiplexer(namePrefix, idleTimeoutMsec, maxSockets, ESB::SystemAllocator::Instance()),
+      _multiplexerType(HttpConfig::ES_HTTP_EPOLL_MULTIPLEXER),
+      _multiplexer(CreateMultiplexer(namePrefix, maxSockets, idleTimeoutMsec, &_multiplexerType)),
+      _dnsClient(namePrefix, *this, dnsCache, HttpConfig::Instance().dnsResolver()),
       _serverSocketFactory(*this, HttpNullServerHandler, HttpNullServerCounters, EmptyServerContextIndex,
                            _factoryAllocator),
       _serverTransactionFactory(_factoryAllocator),
       _serverCommandSocket(namePrefix, *this),
-      _clientSocketFactory(*this, clientHandler, clientCounters, clientContextIndex, _factoryAllocator),
+      _clientSocketFactory(*this, clientHandler, clientCounters, clientContextIndex, &connectionPools,
+                           _factoryAllocator),
       _clientTransactionFactory(_factoryAllocator),
       _clientCommandSocket(namePrefix, *this),
+      _connectionWarmer(*this, _clientSocketFactory.connectionPool(), _factoryAllocator),
       _clientHandler(clientHandler),
       _serverHandler(HttpNullServerHandler),
       _clientCounters(clientCounters),
-      _serverCounters(HttpNullServerCounters) {}
+      _serverCounters(HttpNullServerCounters),
+      _acceptBalancer(NULL),
+      _rand(),
+      _pendingHandoffs(),
+      _acceptHandoffs(0U),
+      _buffersInUse(0) {}
 
 HttpProxyMultiplexer::HttpProxyMultiplexer(const char *namePrefix, ESB::UInt32 maxSockets, ESB::UInt32 idleTimeoutMsec,
+                                           ESB::SizeClassBufferPool &ioBufferPool, ESB::UInt32 ioBufferShard,
+                                           ESB::DnsCache &dnsCache,
                                            HttpServerHandler &serverHandler, HttpServerCounters &serverCounters,
                                            ESB::ServerTLSContextIndex &serverContextIndex)
-    : _ioBufferPoolAllocator(HttpConfig::Instance().ioBufferChunkSize(), ESB_CACHE_LINE_SIZE, ESB_PAGE_SIZE,
-                             ESB::SystemAllocator::Instance()),
-      _ioBufferPool(HttpConfig::Instance().ioBufferSize(), 0, ESB::NullLock::Instance(), _ioBufferPoolAllocator),
+    : _ioBufferPool(ioBufferPool),
+      _ioBufferShard(ioBufferShard),
+      _splicePipes(),
       _factoryAllocator(ESB_PAGE_SIZE * 1000 - ESB::DiscardAllocator::SizeofChunk(ESB_CACHE_LINE_SIZE),
                         ESB_CACHE_LINE_SIZE, ESB_PAGE_SIZE, ESB::SystemAllocator::Instance()),
-      _multiplexer(namePrefix, idleTimeoutMsec, maxSockets, ESB::SystemAllocator::Instance()),
+      _multiplexerType(HttpConfig::ES_HTTP_EPOLL_MULTIPLEXER),
+      _multiplexer(CreateMultiplexer(namePrefix, maxSockets, idleTimeoutMsec, &_multiplexerType)),
+      _dnsClient(namePrefix, *this, dnsCache, HttpConfig::Instance().dnsResolver()),
       _serverSocketFactory(*this, serverHandler, serverCounters, serverContextIndex, _factoryAllocator),
       _serverTransactionFactory(_factoryAllocator),
       _serverCommandSocket(namePrefix, *this),
-      _clientSocketFactory(*this, HttpNullClientHandler, HttpNullClientCounters, EmptyClientContextIndex,
+      _clientSocketFactory(*this, HttpNullClientHandler, HttpNullClientCounters, EmptyClientContextIndex, NULL,
                            _factoryAllocator),
       _clientTransactionFactory(_factoryAllocator),
       _clientCommandSocket(namePrefix, *this),
+      _connectionWarmer(*this, _clientSocketFactory.connectionPool(), _factoryAllocator),
       _clientHandler(HttpNullClientHandler),
       _serverHandler(serverHandler),
       _clientCounters(HttpNullClientCounters),
-      _serverCounters(serverCounters) {}
+      _serverCounters(serverCounters),
+      _acceptBalancer(NULL),
+      _rand(),
+      _pendingHandoffs(),
+      _acceptHandoffs(0U),
+      _buffersInUse(0) {}
+
+HttpProxyMultiplexer::~HttpProxyMultiplexer() {
+  if (_multiplexer) {
+    _multiplexer->~SocketMultiplexer();
+    ESB::SystemAllocator::Instance().deallocate(_multiplexer);
+    _multiplexer = NULL;
+  }
+}
 
-HttpProxyMultiplexer::~HttpProxyMultiplexer() {}
+ESB::SocketMultiplexer *HttpProxyMultiplexer::CreateMultiplexer(const char *namePrefix, ESB::UInt32 maxSockets,
+                                                                ESB::UInt32 idleTimeoutMsec,
+                                                                HttpConfig::MultiplexerType *type) {
+  ESB::SocketMultiplexer *multiplexer = NULL;
+  *type = HttpConfig::ES_HTTP_EPOLL_MULTIPLEXER;
+
+  if (HttpConfig::ES_HTTP_URING_MULTIPLEXER == HttpConfig::Instance().multiplexerType()) {
+#ifdef HAVE_IO_URING
+    if (ESB::UringMultiplexer::Available()) {
+      multiplexer = new (ESB::SystemAllocator::Instance())
+          ESB::UringMultiplexer(namePrefix, idleTimeoutMsec, maxSockets, ESB::SystemAllocator::Instance());
+      if (multiplexer) {
+        *type = HttpConfig::ES_HTTP_URING_MULTIPLEXER;
+      }
+    } else
+#endif
+    {
+      ESB_LOG_WARNING("[%s] io_uring is not available, using epoll", namePrefix);
+    }
+  }
+
+  if (!multiplexer) {
+    multiplexer = new (ESB::SystemAllocator::Instance())
+        ESB::EpollMultiplexer(namePrefix, idleTimeoutMsec, maxSockets, ESB::SystemAllocator::Instance());
+  }
+
+  if (!multiplexer) {
+    ESB_LOG_CRITICAL_ERRNO(ESB_OUT_OF_MEMORY, "[%s] cannot create multiplexer", namePrefix);
+  }
+
+  return multiplexer;
+}
 
 ESB::Error HttpProxyMultiplexer::addMultiplexedSocket(ESB::MultiplexedSocket *multiplexedSocket) {
-  return _multiplexer.addMultiplexedSocket(multiplexedSocket);
+  if (!_multiplexer) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  return _multiplexer->addMultiplexedSocket(multiplexedSocket);
 }
 
 ESB::Error HttpProxyMultiplexer::updateMultiplexedSocket(ESB::MultiplexedSocket *socket) {
-  return _multiplexer.updateMultiplexedSocket(socket);
+  if (!_multiplexer) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  return _multiplexer->updateMultiplexedSocket(socket);
 }
 
 ESB::Error HttpProxyMultiplexer::removeMultiplexedSocket(ESB::MultiplexedSocket *socket) {
-  return _multiplexer.removeMultiplexedSocket(socket);
+  if (!_multiplexer) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  return _multiplexer->removeMultiplexedSocket(socket);
 }
 
-int HttpProxyMultiplexer::currentSockets() const { return _multiplexer.currentSockets(); }
+ESB::Error HttpProxyMultiplexer::addTimer(ESB::Timer *timer, ESB::UInt32 delayMsec) {
+  if (!_multiplexer) {
+    return ESB_OUT_OF_MEMORY;
+  }
 
-int HttpProxyMultiplexer::maximumSockets() const { return _multiplexer.maximumSockets(); }
+  return _multiplexer->addTimer(timer, delayMsec);
+}
 
-bool HttpProxyMultiplexer::isRunning() const { return _multiplexer.isRunning(); }
+ESB::Error HttpProxyMultiplexer::updateTimer(ESB::Timer *timer, ESB::UInt32 delayMsec) {
+  if (!_multiplexer) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  return _multiplexer->updateTimer(timer, delayMsec);
+}
+
+ESB::Error HttpProxyMultiplexer::removeTimer(ESB::Timer *timer) {
+  return _multiplexer ? _multiplexer->removeTimer(timer) : ESB_OUT_OF_MEMORY;
+}
+
+int HttpProxyMultiplexer::currentSockets() const { return _multiplexer ? _multiplexer->currentSockets() : 0; }
+
+int HttpProxyMultiplexer::maximumSockets() const { return _multiplexer ? _multiplexer->maximumSockets() : 0; }
+
+bool HttpProxyMultiplexer::isRunning() const { return _multiplexer && _multiplexer->isRunning(); }
+
+const ESB::EventLoopCounters *HttpProxyMultiplexer::eventLoopCounters() const {
+  return _multiplexer ? _multiplexer->eventLoopCounters() : NULL;
+}
 
 bool HttpProxyMultiplexer::run(ESB::SharedInt *isRunning) {
-  ESB::Error error = _multiplexer.addMultiplexedSocket(&_clientCommandSocket);
+  if (!_multiplexer) {
+    ESB_LOG_CRITICAL_ERRNO(ESB_OUT_OF_MEMORY, "Cannot run without a multiplexer");
+    return false;
+  }
+
+  ESB::Error error = _multiplexer->addMultiplexedSocket(&_clientCommandSocket);
 
   if (ESB_SUCCESS != error) {
     ESB_LOG_CRITICAL_ERRNO(error, "Cannot add command socket to multiplexer");
     return false;
   }
 
-  error = _multiplexer.addMultiplexedSocket(&_serverCommandSocket);
+  error = _multiplexer->addMultiplexedSocket(&_serverCommandSocket);
 
   if (ESB_SUCCESS != error) {
     ESB_LOG_CRITICAL_ERRNO(error, "Cannot add command socket to multiplexer");
     return false;
   }
 
-  return _multiplexer.run(isRunning);
+  if (&_clientHandler != &HttpNullClientHandler) {
+    error = _connectionWarmer.start();
+
+    if (ESB_SUCCESS != error) {
+      ESB_LOG_WARNING_ERRNO(error, "Cannot start warming connections");
+    }
+  }
+
+  return _multiplexer->run(isRunning);
 }
 
-const char *HttpProxyMultiplexer::name() const { return _multiplexer.name(); }
+const char *HttpProxyMultiplexer::name() const { return _multiplexer ? _multiplexer->name() : ""; }
 
 ESB::CleanupHandler *HttpProxyMultiplexer::cleanupHandler() { return NULL; }
 
 HttpClientTransaction *HttpProxyMultiplexer::createClientTransaction() { return _clientTransactionFactory.create(); }
 
 ESB::Error HttpProxyMultiplexer::executeClientTransaction(HttpClientTransaction *transaction) {
+  if (!_multiplexer) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
   return _clientSocketFactory.executeClientTransaction(transaction);
 }
 
@@ -366,20 +526,52 @@ void HttpProxyMultiplexer::destroyClientTransaction(HttpClientTransaction *trans
   return _clientTransactionFactory.release(transaction);
 }
 
-ESB::Buffer *HttpProxyMultiplexer::acquireBuffer() { return _ioBufferPool.acquireBuffer(); }
+ESB::DnsClient &HttpProxyMultiplexer::dnsClient() { return _dnsClient; }
+
+ESB::SocketSplicer::PipePool &HttpProxyMultiplexer::splicePipes() { return _splicePipes; }
+
+ESB::Buffer *HttpProxyMultiplexer::acquireBuffer(ESB::UInt32 sizeClass) {
+  ESB::Buffer *buffer = _ioBufferPool.acquireBuffer(_ioBufferShard, sizeClass);
+  if (buffer) {
+    __atomic_store_n(&_buffersInUse, __atomic_load_n(&_buffersInUse, __ATOMIC_RELAXED) + 1, __ATOMIC_RELAXED);
+  }
+  return buffer;
+}
+
+void HttpProxyMultiplexer::releaseBuffer(ESB::Buffer *buffer) {
+  if (buffer) {
+    __atomic_store_n(&_buffersInUse, __atomic_load_n(&_buffersInUse, __ATOMIC_RELAXED) - 1, __ATOMIC_RELAXED);
+  }
+  _ioBufferPool.releaseBuffer(_ioBufferShard, buffer);
+}
+
+ESB::UInt32 HttpProxyMultiplexer::bufferSizeClasses() const { return _ioBufferPool.sizeClasses(); }
 
-void HttpProxyMultiplexer::releaseBuffer(ESB::Buffer *buffer) { _ioBufferPool.releaseBuffer(buffer); }
+ESB::UInt32 HttpProxyMultiplexer::bufferSize(ESB::UInt32 sizeClass) const { return _ioBufferPool.bufferSize(sizeClass); }
 
 ESB::Error HttpProxyMultiplexer::addServerSocket(ESB::Socket::State &state) {
+  if (!_multiplexer) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
   HttpServerSocket *socket = _serverSocketFactory.create(state);
 
   if (!socket) {
     return ESB_OUT_OF_MEMORY;
   }
 
-  ESB::Error error = _multiplexer.addMultiplexedSocket(socket);
+  ESB::Error error = _serverHandler.beginConnection(*this, *socket);
 
   if (ESB_SUCCESS != error) {
+    ESB_LOG_INFO_ERRNO(error, "[%s] Handler rejected connection", socket->logAddress());
+    _serverSocketFactory.release(socket);
+    return ESB_CLOSED;
+  }
+
+  error = _multiplexer->addMultiplexedSocket(socket);
+
+  if (ESB_SUCCESS != error) {
+    _serverHandler.endConnection(*this, *socket);
     _serverSocketFactory.release(socket);
     return error;
   }
@@ -387,7 +579,39 @@ ESB::Error HttpProxyMultiplexer::addServerSocket(ESB::Socket::State &state) {
   return ESB_SUCCESS;
 }
 
+ESB::Error HttpProxyMultiplexer::acceptServerSocket(ESB::Socket::State &state) {
+  if (_acceptBalancer) {
+    ESB::Error error = _acceptBalancer->handoff(*this, state, _rand);
+
+    if (ESB_SUCCESS == error) {
+      return ESB_SUCCESS;
+    }
+
+    if (ESB_CANNOT_FIND != error) {
+      ESB_LOG_DEBUG_ERRNO(error, "[%s] cannot hand off accepted connection, keeping it", name());
+    }
+  }
+
+  return addServerSocket(state);
+}
+
+ESB::UInt32 HttpProxyMultiplexer::acceptLoad() const {
+  const ESB::Int32 buffers = __atomic_load_n(&_buffersInUse, __ATOMIC_RELAXED);
+  ESB::UInt64 load = MAX(0, currentSockets()) + MAX(0, buffers) + _pendingHandoffs.get();
+
+  const ESB::EventLoopCounters *counters = eventLoopCounters();
+  if (counters) {
+    load = load * (ES_HTTP_ACCEPT_BALANCE_LAG_USEC + counters->lagMicroSeconds()) / ES_HTTP_ACCEPT_BALANCE_LAG_USEC;
+  }
+
+  return MIN(load, (ESB::UInt64)ESB_UINT32_MAX);
+}
+
 ESB::Error HttpProxyMultiplexer::addListeningSocket(ESB::ListeningSocket &socket) {
+  if (!_multiplexer) {
+    return ESB_OUT_OF_MEMORY;
+  }
+
   HttpListeningSocket *listener =
       new (_factoryAllocator) HttpListeningSocket(*this, _serverHandler, _factoryAllocator.cleanupHandler());
 
@@ -404,7 +628,7 @@ ESB::Error HttpProxyMultiplexer::addListeningSocket(ESB::ListeningSocket &socket
     return error;
   }
 
-  error = _multiplexer.addMultiplexedSocket(listener);
+  error = _multiplexer->addMultiplexedSocket(listener);
 
   if (ESB_SUCCESS != error) {
     ESB_LOG_ERROR_ERRNO(error, "Cannot add listener on %s to multiplexer", socket.name());
@@ -423,8 +647,12 @@ void HttpProxyMultiplexer::destroyServerTransaction(HttpServerTransaction *trans
   _serverTransactionFactory.release(transaction);
 }
 
-ESB::SocketMultiplexer &HttpProxyMultiplexer::multiplexer() { return _multiplexer; }
+ESB::SocketMultiplexer &HttpProxyMultiplexer::multiplexer() {
+  // Sockets, the only callers, cannot be added without a multiplexer
+  assert(_multiplexer);
+  return *_multiplexer;
+}
 
-bool HttpProxyMultiplexer::shutdown() { return !_multiplexer.isRunning(); }
+bool HttpProxyMultiplexer::shutdown() { return !isRunning(); }
 
 }  // namespace ES
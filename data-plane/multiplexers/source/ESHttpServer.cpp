@@ -25,9 +25,14 @@ HttpServer::HttpServer(const char *namePrefix, ESB::UInt32 threads, ESB::UInt32
       _serverHandler(serverHandler),
       _multiplexers(),
       _threadPool(namePrefix, _threads),
+      _ioBufferPool(HttpConfig::Instance().ioBufferSizes(), HttpConfig::Instance().ioBufferSizeClasses(), _threads,
+                    HttpConfig::Instance().maxIoBuffersPerClass(), HttpConfig::Instance().maxCachedIoBuffers()),
+      _dnsCache(HttpConfig::Instance().dnsCacheSize(), HttpConfig::Instance().dnsMaxTtlSeconds(),
+                HttpConfig::Instance().dnsNegativeTtlSeconds()),
       _rand(),
+      _acceptBalancer(_threads, _allocator),
       _serverContextIndex(HttpConfig::Instance().tlsContextBuckets(), HttpConfig::Instance().tlsContextLocks(),
-                          _allocator),
+                          _allocator, HttpConfig::Instance().tlsTicketKeyLifetimeSeconds()),
       _serverCounters() {
   strncpy(_name, namePrefix, sizeof(_name));
   _name[sizeof(_name) - 1] = 0;
@@ -67,7 +72,7 @@ ESB::Error HttpServer::push(HttpServerCommand *command, int idx) {
   return ESB_SUCCESS;
 }
 
-ESB::Error HttpServer::addListener(ESB::ListeningSocket &listener) {
+ESB::Error HttpServer::addListener(ESB::ListeningSocket &listener, ESB::UInt32 threads) {
   if (ESB::ListeningSocket::SocketState::BOUND != listener.state()) {
     return ESB_INVALID_ARGUMENT;
   }
@@ -80,7 +85,11 @@ ESB::Error HttpServer::addListener(ESB::ListeningSocket &listener) {
   }
 #endif
 
-  for (int i = 0; i < _threads; ++i) {
+  if (0U == threads || _threads < threads) {
+    threads = _threads;
+  }
+
+  for (ESB::UInt32 i = 0; i < threads; ++i) {
     AddListeningSocketCommand *command = new (ESB::SystemAllocator::Instance())
         AddListeningSocketCommand(listener, ESB::SystemAllocator::Instance().cleanupHandler());
     ESB::Error error = push(command, i);
@@ -93,6 +102,42 @@ ESB::Error HttpServer::addListener(ESB::ListeningSocket &listener) {
   return ESB_SUCCESS;
 }
 
+ESB::UInt32 HttpServer::currentSockets(ESB::UInt32 idx) {
+  if (ES_HTTP_SERVER_IS_STARTED != _state.get()) {
+    return 0U;
+  }
+
+  ESB::SocketMultiplexer *multiplexer = (ESB::SocketMultiplexer *)_multiplexers.index(idx);
+  return multiplexer ? multiplexer->currentSockets() : 0U;
+}
+
+const ESB::EventLoopCounters *HttpServer::eventLoopCounters(ESB::UInt32 idx) {
+  if (ES_HTTP_SERVER_IS_STARTED != _state.get()) {
+    return NULL;
+  }
+
+  ESB::SocketMultiplexer *multiplexer = (ESB::SocketMultiplexer *)_multiplexers.index(idx);
+  return multiplexer ? multiplexer->eventLoopCounters() : NULL;
+}
+
+ESB::UInt64 HttpServer::acceptHandoffs(ESB::UInt32 idx) {
+  if (ES_HTTP_SERVER_IS_STARTED != _state.get()) {
+    return 0U;
+  }
+
+  HttpProxyMultiplexer *multiplexer = (HttpProxyMultiplexer *)_multiplexers.index(idx);
+  return multiplexer ? multiplexer->acceptHandoffs() : 0U;
+}
+
+HttpConfig::MultiplexerType HttpServer::multiplexerType(ESB::UInt32 idx) {
+  if (ES_HTTP_SERVER_IS_STARTED != _state.get()) {
+    return HttpConfig::ES_HTTP_EPOLL_MULTIPLEXER;
+  }
+
+  HttpProxyMultiplexer *multiplexer = (HttpProxyMultiplexer *)_multiplexers.index(idx);
+  return multiplexer ? multiplexer->multiplexerType() : HttpConfig::ES_HTTP_EPOLL_MULTIPLEXER;
+}
+
 ESB::Error HttpServer::initialize() {
   assert(ES_HTTP_SERVER_IS_DESTROYED == _state.get());
   _state.set(ES_HTTP_SERVER_IS_INITIALIZED);
@@ -110,13 +155,26 @@ ESB::Error HttpServer::start() {
   }
 
   for (ESB::UInt32 i = 0; i < _threads; ++i) {
-    ESB::SocketMultiplexer *multiplexer = createMultiplexer();
+    ESB::SocketMultiplexer *multiplexer = createMultiplexer(i);
 
     if (!multiplexer) {
       ESB_LOG_CRITICAL_ERRNO(ESB_OUT_OF_MEMORY, "[%s] cannot initialize multiplexer", _name);
       return ESB_OUT_OF_MEMORY;
     }
 
+    if (HttpConfig::Instance().acceptBalancing()) {
+      HttpProxyMultiplexer *proxyMultiplexer = (HttpProxyMultiplexer *)multiplexer;
+      error = _acceptBalancer.attach(proxyMultiplexer);
+
+      if (ESB_SUCCESS != error) {
+        ESB_LOG_CRITICAL_ERRNO(error, "[%s] cannot balance accepts on multiplexer", _name);
+        destroyMultiplexer(multiplexer);
+        return error;
+      }
+
+      proxyMultiplexer->setAcceptBalancer(&_acceptBalancer);
+    }
+
     error = _threadPool.execute(multiplexer);
 
     if (ESB_SUCCESS != error) {
@@ -161,15 +219,17 @@ void HttpServer::destroy() {
   _state.set(ES_HTTP_SERVER_IS_DESTROYED);
 
   for (ESB::ListIterator it = _multiplexers.frontIterator(); !it.isNull(); it = it.next()) {
+    _acceptBalancer.detach((HttpProxyMultiplexer *)it.value());
     destroyMultiplexer((HttpProxyMultiplexer *)it.value());
   }
 
   _multiplexers.clear();
 }
 
-ESB::SocketMultiplexer *HttpServer::createMultiplexer() {
-  return new (_allocator) HttpProxyMultiplexer(_name, ESB::SystemConfig::Instance().socketSoftMax(), _idleTimeoutMsec,
-                                               _serverHandler, _serverCounters, _serverContextIndex);
+ESB::SocketMultiplexer *HttpServer::createMultiplexer(ESB::UInt32 idx) {
+  return new (_allocator)
+      HttpProxyMultiplexer(_name, ESB::SystemConfig::Instance().socketSoftMax(), _idleTimeoutMsec, _ioBufferPool, idx,
+                           _dnsCache, _serverHandler, _serverCounters, _serverContextIndex);
 }
 
 void HttpServer::destroyMultiplexer(ESB::SocketMultiplexer *multiplexer) {
@@ -1,5 +1,5 @@
-#ifndef ESB_SIMPLE_FILE_LOGGER_H
-#include <ESBSimpleFileLogger.h>
+#ifndef ESB_ASYNC_FILE_LOGGER_H
+#include <ESBAsyncFileLogger.h>
 #endif
 
 #ifndef ES_HTTP_TEST_PARAMS_H
@@ -55,7 +55,12 @@ int main(int argc, char **argv) {
     return error;
   }
 
-  ESB::SimpleFileLogger logger(stdout, params.logLevel(), timeCache);
+  ESB::AsyncFileLogger logger(stdout, params.logLevel(), timeCache);
+  error = logger.start();
+  if (ESB_SUCCESS != error) {
+    ESB_LOG_ERROR_ERRNO(error, "Cannot start logger thread");
+    return error;
+  }
   ESB::Logger::SetInstance(&logger);
 
   error = ESB::SignalHandler::Instance().initialize();
@@ -148,6 +153,7 @@ int main(int argc, char **argv) {
   }
 
   server.serverCounters().log(ESB::Logger::Instance(), ESB::Logger::Severity::Notice);
+  server.ioBufferPool().log(ESB::Logger::Instance(), ESB::Logger::Severity::Notice);
   server.destroy();
 
   error = timeCache.join();
@@ -0,0 +1,45 @@
+#ifndef ES_DNS_HTTP_ROUTER_H
+#define ES_DNS_HTTP_ROUTER_H
+
+#ifndef ES_HTTP_ROUTER_H
+#include <ESHttpRouter.h>
+#endif
+
+namespace ES {
+
+/**
+ * This router forwards requests to the host named in the request, resolving
+ * it with the multiplexer's asynchronous DNS client.
+ */
+class DnsHttpRouter : public HttpRouter {
+ public:
+  DnsHttpRouter();
+
+  virtual ~DnsHttpRouter();
+
+  /**
+   * Given an inbound stream with a populated server transaction, populate the
+   * request headers in an empty outbound client transaction and set the
+   * destination address for the outbound client request.
+   *
+   * @param multiplexer The multiplexer whose DNS client resolves the host
+   * @param serverStream A HttpStream with a populated inbound HttpRequest
+   * @param clientTransaction A HttpClientTransaction with an outbound
+   * HttpRequest to be populated by this implementation
+   * @param destination An empty destination to be populated by this
+   * implementation with the destination IP address
+   * @param callback Called with the destination if the host is not cached
+   * @return ESB_SUCCESS if successful, ESB_INPROGRESS if the callback will be
+   * called with the destination, another error code otherwise.
+   */
+  virtual ESB::Error route(HttpMultiplexer &multiplexer, const HttpServerStream &serverStream,
+                           HttpClientTransaction &clientTransaction, ESB::SocketAddress &destination,
+                           ESB::DnsClient::Callback &callback);
+
+ private:
+  ESB_DEFAULT_FUNCS(DnsHttpRouter);
+};
+
+}  // namespace ES
+
+#endif
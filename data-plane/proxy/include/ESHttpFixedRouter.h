@@ -15,8 +15,9 @@ class HttpFixedRouter : public HttpRouter {
   HttpFixedRouter(ESB::SocketAddress destination);
   virtual ~HttpFixedRouter();
 
-  virtual ESB::Error route(const HttpServerStream &serverStream, HttpClientTransaction &clientTransaction,
-                           ESB::SocketAddress &destination);
+  virtual ESB::Error route(HttpMultiplexer &multiplexer, const HttpServerStream &serverStream,
+                           HttpClientTransaction &clientTransaction, ESB::SocketAddress &destination,
+                           ESB::DnsClient::Callback &callback);
 
  private:
   ESB::SocketAddress _destination;
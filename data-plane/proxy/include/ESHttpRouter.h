@@ -9,10 +9,18 @@
 #include <ESHttpServerStream.h>
 #endif
 
+#ifndef ES_HTTP_MULTIPLEXER_H
+#include <ESHttpMultiplexer.h>
+#endif
+
 #ifndef ESB_SOCKET_ADDRESS_H
 #include <ESBSocketAddress.h>
 #endif
 
+#ifndef ESB_DNS_CLIENT_H
+#include <ESBDnsClient.h>
+#endif
+
 namespace ES {
 
 class HttpRouter {
@@ -24,17 +32,25 @@ class HttpRouter {
   /**
    * Given an inbound stream with a populated server transaction, populate the
    * request headers in an empty outbound client transaction and set the
-   * destination address for the outbound client request.
+   * destination address for the outbound client request.  Routers that
+   * have to look up the destination must not block the multiplexer's
+   * thread: they return ESB_INPROGRESS and deliver the destination to
+   * the callback later.
    *
+   * @param multiplexer The multiplexer running the inbound stream
    * @param serverStream A HttpStream with a populated inbound HttpRequest
    * @param clientTransaction A HttpClientTransaction with an outbound
    * HttpRequest to be populated by this implementation
    * @param destination An empty destination to be populated by this
    * implementation with the destination IP address
-   * @return ESB_SUCCESS if successful, another error code otherwise.
+   * @param callback Called with the destination if ESB_INPROGRESS is
+   * returned
+   * @return ESB_SUCCESS if successful, ESB_INPROGRESS if the callback
+   * will be called with the destination, another error code otherwise.
    */
-  virtual ESB::Error route(const HttpServerStream &serverStream, HttpClientTransaction &clientTransaction,
-                           ESB::SocketAddress &destination) = 0;
+  virtual ESB::Error route(HttpMultiplexer &multiplexer, const HttpServerStream &serverStream,
+                           HttpClientTransaction &clientTransaction, ESB::SocketAddress &destination,
+                           ESB::DnsClient::Callback &callback) = 0;
 
   ESB_DISABLE_AUTO_COPY(HttpRouter);
 };
@@ -13,11 +13,28 @@
 #include <ESBAllocator.h>
 #endif
 
+#ifndef ESB_SOCKET_SPLICER_H
+#include <ESBSocketSplicer.h>
+#endif
+
+#ifndef ES_HTTP_MULTIPLEXER_H
+#include <ESHttpMultiplexer.h>
+#endif
+
+#ifndef ESB_DNS_CLIENT_H
+#include <ESBDnsClient.h>
+#endif
+
 namespace ES {
 
-class HttpRoutingProxyContext {
+class HttpRoutingProxyContext : public ESB::DnsClient::Callback {
  public:
-  HttpRoutingProxyContext();
+  /**
+   * Constructor.
+   *
+   * @param splicePipes If not NULL, spliced bodies are forwarded through a pipe from this pool
+   */
+  HttpRoutingProxyContext(ESB::SocketSplicer::PipePool *splicePipes);
 
   virtual ~HttpRoutingProxyContext();
 
@@ -44,12 +61,37 @@ class HttpRoutingProxyContext {
     _responseBodyBytesForwarded += responseBodyBytesSent;
   }
 
+  inline ESB::SocketSplicer &splicer() { return _splicer; }
+
+  inline HttpClientTransaction *pendingTransaction() { return _pendingTransaction; }
+
+  /**
+   * Hold a routed client transaction until its destination is resolved.
+   *
+   * @param multiplexer The multiplexer to execute the transaction on
+   * @param transaction The transaction or NULL if none is pending
+   */
+  inline void setPendingTransaction(HttpMultiplexer *multiplexer, HttpClientTransaction *transaction) {
+    _multiplexer = multiplexer;
+    _pendingTransaction = transaction;
+  }
+
+  /**
+   * Execute the pending client transaction once its destination is resolved,
+   * or abort the server stream if it cannot be.  The context may be destroyed
+   * by the time this returns.
+   */
+  virtual void resolved(ESB::Error result, const ESB::SocketAddress &address);
+
  private:
+  HttpMultiplexer *_multiplexer;
+  HttpClientTransaction *_pendingTransaction;
   HttpServerStream *_serverStream;
   HttpClientStream *_clientStream;
   int _flags;
   ESB::UInt64 _requestBodyBytesForwarded;
   ESB::UInt64 _responseBodyBytesForwarded;
+  ESB::SocketSplicer _splicer;
 
   ESB_DEFAULT_FUNCS(HttpRoutingProxyContext);
 };
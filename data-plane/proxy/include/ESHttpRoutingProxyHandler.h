@@ -9,19 +9,72 @@
 #include <ESHttpRouter.h>
 #endif
 
+#ifndef ES_RULE_GRAPH_H
+#include <ESRuleGraph.h>
+#endif
+
 namespace ES {
 
+class HttpRoutingProxyContext;
+
 class HttpRoutingProxyHandler : public HttpProxyHandler {
  public:
   HttpRoutingProxyHandler(HttpRouter &router);
 
   virtual ~HttpRoutingProxyHandler();
 
+  /** Evaluate an inbound connection rule list for every new connection.  Connections for which it returns anything
+   *  but RuleGraph::NONE, e.g. because an ACQUIRE_SLOT condition found the client over its limit, are closed before
+   *  they are added to a multiplexer.  The connection's context, including its marks, is kept until the connection
+   *  closes.
+   *
+   * @param rules The compiled rules or NULL to accept every connection.  They must outlive the handler.
+   * @param root The node to start from, usually from RuleGraph::find()
+   */
+  inline void setInboundConnectionRules(RuleGraph *rules, ESB::UInt32 root) {
+    _connectionRules = rules;
+    _connectionRoot = root;
+  }
+
+  /** Evaluate an inbound connection cleanup rule list with the context of every connection the inbound connection rule
+   *  list ran on, once the connection closes or is rejected.  This is where RELEASE_SLOT actions return the MAX_LIMIT
+   *  slots taken when the connection was accepted.
+   *
+   * @param rules The compiled rules or NULL to skip cleanup.  They must outlive the handler.
+   * @param root The node to start from, usually from RuleGraph::find()
+   */
+  inline void setInboundConnectionCleanupRules(RuleGraph *rules, ESB::UInt32 root) {
+    _cleanupRules = rules;
+    _cleanupRoot = root;
+  }
+
+  /** Evaluate an inbound request rule list for every request before it is routed.  Its context starts with the marks of
+   *  the connection the request arrived on.  SEND_RESPONSE sends the chosen response instead of routing the request and
+   *  CLOSE_CONNECTION closes the connection.  There is no request cleanup rule list, so the rules should not take
+   *  MAX_LIMIT slots.
+   *
+   * @param rules The compiled rules or NULL to route every request.  They must outlive the handler.
+   * @param root The node to start from, usually from RuleGraph::find()
+   */
+  inline void setInboundRequestRules(RuleGraph *rules, ESB::UInt32 root) {
+    _requestRules = rules;
+    _requestRoot = root;
+  }
+
+  /** Get the number of response body bytes spliced from origin connections to client connections so far, across every
+   *  multiplexer using the handler.
+   *
+   * @return The number of spliced response body bytes
+   */
+  inline ESB::UInt64 splicedResponseBodyBytes() const { return __atomic_load_n(&_splicedBytes, __ATOMIC_RELAXED); }
+
   //
   // ES:HttpServerHandler via ES::HttpProxyHandler
   //
 
   virtual ESB::Error acceptConnection(HttpMultiplexer &multiplexer, ESB::SocketAddress *address);
+  virtual ESB::Error beginConnection(HttpMultiplexer &multiplexer, HttpServerStream &serverStream);
+  virtual void endConnection(HttpMultiplexer &multiplexer, HttpServerStream &serverStream);
   virtual ESB::Error beginTransaction(HttpMultiplexer &multiplexer, HttpServerStream &serverStream);
   virtual ESB::Error receiveRequestHeaders(HttpMultiplexer &multiplexer, HttpServerStream &serverStream);
   virtual ESB::Error consumeRequestBody(HttpMultiplexer &multiplexer, HttpServerStream &serverStream,
@@ -47,6 +100,7 @@ class HttpRoutingProxyHandler : public HttpProxyHandler {
   virtual ESB::Error consumeResponseBody(HttpMultiplexer &multiplexer, HttpClientStream &clientStream,
                                          const unsigned char *body, ESB::UInt64 bytesOffered,
                                          ESB::UInt64 *bytesConsumed);
+  virtual ESB::Error spliceResponseBody(HttpMultiplexer &multiplexer, HttpClientStream &clientStream);
   virtual void endTransaction(HttpMultiplexer &multiplexer, HttpClientStream &clientStream,
                               HttpClientHandler::State state);
   virtual ESB::Error endRequest(HttpMultiplexer &multiplexer, HttpClientStream &clientStream);
@@ -56,8 +110,17 @@ class HttpRoutingProxyHandler : public HttpProxyHandler {
   ESB::Error onServerRecvBlocked(HttpServerStream &serverStream, HttpClientStream &clientStream);
   ESB::Error onClientSendBlocked(HttpServerStream &serverStream, HttpClientStream &clientStream);
   ESB::Error onServerSendBlocked(HttpServerStream &serverStream, HttpClientStream &clientStream);
+  ESB::Error forwardSplicedResponseBody(HttpRoutingProxyContext &context, HttpServerStream &serverStream,
+                                        HttpClientStream &clientStream);
 
   HttpRouter &_router;
+  RuleGraph *_connectionRules;
+  ESB::UInt32 _connectionRoot;
+  RuleGraph *_cleanupRules;
+  ESB::UInt32 _cleanupRoot;
+  RuleGraph *_requestRules;
+  ESB::UInt32 _requestRoot;
+  ESB::UInt64 _splicedBytes;
 
   ESB_DEFAULT_FUNCS(HttpRoutingProxyHandler);
 };
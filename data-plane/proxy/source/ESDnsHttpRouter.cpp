@@ -0,0 +1,33 @@
+#ifndef ES_DNS_HTTP_ROUTER_H
+#include <ESDnsHttpRouter.h>
+#endif
+
+#ifndef ESB_TYPES_H
+#include <ESBTypes.h>
+#endif
+
+namespace ES {
+
+DnsHttpRouter::DnsHttpRouter() {}
+
+DnsHttpRouter::~DnsHttpRouter() {}
+
+ESB::Error DnsHttpRouter::route(HttpMultiplexer &multiplexer, const HttpServerStream &serverStream,
+                                HttpClientTransaction &clientTransaction, ESB::SocketAddress &destination,
+                                ESB::DnsClient::Callback &callback) {
+  char hostname[ESB_MAX_HOSTNAME + 1];
+  hostname[0] = 0;
+  ESB::UInt16 port = 0;
+  bool isSecure = false;
+
+  ESB::Error error = clientTransaction.request().parsePeerAddress(hostname, sizeof(hostname), &port, &isSecure);
+
+  if (ESB_SUCCESS != error) {
+    ESB_LOG_DEBUG("Cannot extract hostname from request");
+    return error;
+  }
+
+  return multiplexer.dnsClient().resolve(destination, hostname, port, isSecure, callback);
+}
+
+}  // namespace ES
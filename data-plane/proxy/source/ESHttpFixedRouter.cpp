@@ -8,8 +8,9 @@ HttpFixedRouter::HttpFixedRouter(ESB::SocketAddress destination) : _destination(
 
 HttpFixedRouter::~HttpFixedRouter() {}
 
-ESB::Error HttpFixedRouter::route(const HttpServerStream &serverStream, HttpClientTransaction &clientTransaction,
-                                  ESB::SocketAddress &destination) {
+ESB::Error HttpFixedRouter::route(HttpMultiplexer &multiplexer, const HttpServerStream &serverStream,
+                                  HttpClientTransaction &clientTransaction, ESB::SocketAddress &destination,
+                                  ESB::DnsClient::Callback &callback) {
 #ifndef NDEBUG
   if (serverStream.secure()) {
     assert(ESB::SocketAddress::TLS == _destination.type());
@@ -1,5 +1,5 @@
-#ifndef ESB_SIMPLE_FILE_LOGGER_H
-#include <ESBSimpleFileLogger.h>
+#ifndef ESB_ASYNC_FILE_LOGGER_H
+#include <ESBAsyncFileLogger.h>
 #endif
 
 #ifndef ES_HTTP_TEST_PARAMS_H
@@ -30,6 +30,10 @@
 #include <ESBSignalHandler.h>
 #endif
 
+#ifndef ES_HTTP_METRICS_HANDLER_H
+#include <ESHttpMetricsHandler.h>
+#endif
+
 #ifndef ES_HTTP_FIXED_ROUTER_H
 #include "ESHttpFixedRouter.h"
 #endif
@@ -63,6 +67,12 @@ int main(int argc, char **argv) {
     return 1;
   }
 
+  if (0 < params.metricsPort() &&
+      (params.metricsPort() == params.proxyPort() || params.metricsPort() == params.originPort())) {
+    fprintf(stderr, "--metricsPort must differ from --proxyPort and --originPort\n");
+    return 1;
+  }
+
   ESB::TimeSourceCache timeCache(ESB::SystemTimeSource::Instance());
   error = timeCache.start();
   if (ESB_SUCCESS != error) {
@@ -70,7 +80,12 @@ int main(int argc, char **argv) {
     return error;
   }
 
-  ESB::SimpleFileLogger logger(stdout, params.logLevel(), timeCache);
+  ESB::AsyncFileLogger logger(stdout, params.logLevel(), timeCache);
+  error = logger.start();
+  if (ESB_SUCCESS != error) {
+    ESB_LOG_ERROR_ERRNO(error, "Cannot start logger thread");
+    return error;
+  }
   ESB::Logger::SetInstance(&logger);
 
   error = ESB::SignalHandler::Instance().initialize();
@@ -106,6 +121,20 @@ int main(int argc, char **argv) {
 
   ESB_LOG_NOTICE("[%s] bound to port %u", listener.name(), listener.listeningAddress().port());
 
+  ESB::ListeningSocket metricsListener("metrics-listener",
+                                       ESB::SocketAddress("0.0.0.0", params.metricsPort(), ESB::SocketAddress::TCP),
+                                       ESB_UINT8_MAX);
+
+  if (0 < params.metricsPort()) {
+    error = metricsListener.bind();
+    if (ESB_SUCCESS != error) {
+      ESB_LOG_CRITICAL_ERRNO(error, "[main] cannot bind to port %u", metricsListener.listeningAddress().port());
+      return error;
+    }
+
+    ESB_LOG_NOTICE("[%s] bound to port %u", metricsListener.name(), metricsListener.listeningAddress().port());
+  }
+
   // Init
 
   ESB::SocketAddress originAddress(params.destinationAddress(), params.originPort(),
@@ -114,6 +143,10 @@ int main(int argc, char **argv) {
   HttpRoutingProxyHandler handler(router);
   HttpProxy proxy("prox", params.proxyThreads(), params.proxyTimeoutMsec(), handler);
 
+  // Metrics are served by their own thread so scrapes never delay proxied transactions
+  HttpMetricsHandler metricsHandler(proxy);
+  HttpServer metricsServer("metr", 1, params.proxyTimeoutMsec(), metricsHandler);
+
   error = proxy.initialize();
   if (ESB_SUCCESS != error) {
     ESB_LOG_CRITICAL_ERRNO(error, "[main] cannot initialize proxy");
@@ -154,6 +187,26 @@ int main(int argc, char **argv) {
     return error;
   }
 
+  if (0 < params.metricsPort()) {
+    error = metricsServer.initialize();
+    if (ESB_SUCCESS != error) {
+      ESB_LOG_CRITICAL_ERRNO(error, "[main] cannot initialize metrics server");
+      return error;
+    }
+
+    error = metricsServer.start();
+    if (ESB_SUCCESS != error) {
+      ESB_LOG_CRITICAL_ERRNO(error, "[main] cannot start metrics server");
+      return error;
+    }
+
+    error = metricsServer.addListener(metricsListener);
+    if (ESB_SUCCESS != error) {
+      ESB_LOG_CRITICAL_ERRNO(error, "[main] cannot add metrics listener");
+      return error;
+    }
+  }
+
   // Wait for ctrl-C
 
   while (ESB::SignalHandler::Instance().running()) {
@@ -162,6 +215,16 @@ int main(int argc, char **argv) {
 
   // Stop server
 
+  if (0 < params.metricsPort()) {
+    metricsServer.stop();
+    error = metricsServer.join();
+    if (ESB_SUCCESS != error) {
+      ESB_LOG_CRITICAL_ERRNO(error, "[main] cannot join metrics server");
+      return error;
+    }
+    metricsServer.destroy();
+  }
+
   proxy.stop();
   timeCache.stop();
 
@@ -172,6 +235,7 @@ int main(int argc, char **argv) {
   }
 
   proxy.serverCounters().log(ESB::Logger::Instance(), ESB::Logger::Severity::Notice);
+  proxy.ioBufferPool().log(ESB::Logger::Instance(), ESB::Logger::Severity::Notice);
   proxy.destroy();
 
   error = timeCache.join();
@@ -6,16 +6,21 @@ namespace ES {
 
 #define ESB_PROXY_RECEIVED_OUTBOUND_RESPONSE (1 << 0)
 
-HttpRoutingProxyContext::HttpRoutingProxyContext()
-    : _serverStream(NULL),
+HttpRoutingProxyContext::HttpRoutingProxyContext(ESB::SocketSplicer::PipePool *splicePipes)
+    : ESB::DnsClient::Callback(),
+      _multiplexer(NULL),
+      _pendingTransaction(NULL),
+      _serverStream(NULL),
       _clientStream(NULL),
       _flags(0),
       _requestBodyBytesForwarded(0U),
-      _responseBodyBytesForwarded(0U) {}
+      _responseBodyBytesForwarded(0U),
+      _splicer(splicePipes) {}
 
 HttpRoutingProxyContext::~HttpRoutingProxyContext() {
   assert(!_serverStream);
   assert(!_clientStream);
+  assert(!_pendingTransaction);
 }
 
 bool HttpRoutingProxyContext::receivedOutboundResponse() const { return _flags & ESB_PROXY_RECEIVED_OUTBOUND_RESPONSE; }
@@ -28,4 +33,70 @@ void HttpRoutingProxyContext::setReceivedOutboundResponse(bool receivedOutboundR
   }
 }
 
+void HttpRoutingProxyContext::resolved(ESB::Error result, const ESB::SocketAddress &address) {
+  HttpMultiplexer *multiplexer = _multiplexer;
+  HttpClientTransaction *transaction = _pendingTransaction;
+  _multiplexer = NULL;
+  _pendingTransaction = NULL;
+
+  assert(multiplexer);
+  assert(transaction);
+  assert(_serverStream);
+  if (!multiplexer || !transaction || !_serverStream) {
+    return;
+  }
+
+  HttpServerStream &serverStream = *_serverStream;
+  const bool notFound = ESB_CANNOT_FIND == result;
+
+  if (ESB_SUCCESS == result) {
+    transaction->setPeerAddress(address);
+    transaction->setContext(this);
+
+    result = multiplexer->executeClientTransaction(transaction);
+    if (ESB_SUCCESS == result) {
+      return;
+    }
+    ESB_LOG_WARNING_ERRNO(result, "[%s] Cannot execute client transaction", serverStream.logAddress());
+  } else {
+    ESB_LOG_DEBUG_ERRNO(result, "[%s] Cannot resolve destination", serverStream.logAddress());
+  }
+
+  multiplexer->destroyClientTransaction(transaction);
+
+  // Send the same response as when the lookup fails synchronously, e.g. on a negative cache hit.  Ending the server
+  // transaction destroys this context, so nothing below may touch it.
+  ESB::Error error = serverStream.resumeRecv(false);
+  if (ESB_SUCCESS == error) {
+    error = notFound ? serverStream.sendEmptyResponse(404, "Not Found")
+                     : serverStream.sendEmptyResponse(500, "Internal Server Error");
+  }
+
+  switch (error) {
+    case ESB_SUCCESS:
+      // The response has been fully sent, so wait for the next request
+      error = serverStream.pauseSend(true);
+      break;
+    case ESB_AGAIN:
+      // The multiplexer finishes sending the response
+      error = serverStream.resumeSend(true);
+      break;
+    default:
+      break;
+  }
+
+  if (ESB_SUCCESS == error) {
+    return;
+  }
+
+  if (ESB_CLEANUP != error) {
+    ESB_LOG_DEBUG_ERRNO(error, "[%s] Cannot send response", serverStream.logAddress());
+  }
+
+  error = serverStream.abort();
+  if (ESB_SUCCESS != error) {
+    ESB_LOG_WARNING_ERRNO(error, "[%s] Cannot abort server stream", serverStream.logAddress());
+  }
+}
+
 }  // namespace ES
@@ -6,9 +6,25 @@
 #include <ESHttpRoutingProxyContext.h>
 #endif
 
+#ifndef ES_HTTP_CONFIG_H
+#include <ESHttpConfig.h>
+#endif
+
+#ifndef ESB_MONOTONIC_TIME_SOURCE_H
+#include <ESBMonotonicTimeSource.h>
+#endif
+
 namespace ES {
 
-HttpRoutingProxyHandler::HttpRoutingProxyHandler(HttpRouter &router) : _router(router) {}
+HttpRoutingProxyHandler::HttpRoutingProxyHandler(HttpRouter &router)
+    : _router(router),
+      _connectionRules(NULL),
+      _connectionRoot(0U),
+      _cleanupRules(NULL),
+      _cleanupRoot(0U),
+      _requestRules(NULL),
+      _requestRoot(0U),
+      _splicedBytes(0U) {}
 
 HttpRoutingProxyHandler::~HttpRoutingProxyHandler() {}
 
@@ -16,8 +32,52 @@ ESB::Error HttpRoutingProxyHandler::acceptConnection(HttpMultiplexer &multiplexe
   return ESB_SUCCESS;
 }
 
+ESB::Error HttpRoutingProxyHandler::beginConnection(HttpMultiplexer &multiplexer, HttpServerStream &serverStream) {
+  if (!_connectionRules) {
+    return ESB_SUCCESS;
+  }
+
+  // Connections can outlive any transaction's allocator and the handler is shared by every multiplexer
+  RuleGraph::Context *context = new (ESB::SystemAllocator::Instance()) RuleGraph::Context();
+
+  if (!context) {
+    ESB_LOG_WARNING_ERRNO(ESB_OUT_OF_MEMORY, "[%s] Cannot create connection context", serverStream.logAddress());
+    return ESB_OUT_OF_MEMORY;
+  }
+
+  context->setPeerAddress(&serverStream.peerAddress());
+  context->setNow(ESB::MonotonicTimeSource::Instance().now());
+  serverStream.setConnectionContext(context);
+
+  if (RuleGraph::NONE == _connectionRules->execute(_connectionRoot, *context)) {
+    return ESB_SUCCESS;
+  }
+
+  // Give back anything the rules took before rejecting the connection
+  endConnection(multiplexer, serverStream);
+  return ESB_CLOSED;
+}
+
+void HttpRoutingProxyHandler::endConnection(HttpMultiplexer &multiplexer, HttpServerStream &serverStream) {
+  RuleGraph::Context *context = (RuleGraph::Context *)serverStream.connectionContext();
+
+  if (!context) {
+    return;
+  }
+
+  serverStream.setConnectionContext(NULL);
+
+  if (_cleanupRules) {
+    context->setNow(ESB::MonotonicTimeSource::Instance().now());
+    _cleanupRules->execute(_cleanupRoot, *context);
+  }
+
+  context->~Context();
+  ESB::SystemAllocator::Instance().deallocate(context);
+}
+
 ESB::Error HttpRoutingProxyHandler::beginTransaction(HttpMultiplexer &multiplexer, HttpServerStream &serverStream) {
-  HttpRoutingProxyContext *context = new (serverStream.allocator()) HttpRoutingProxyContext();
+  HttpRoutingProxyContext *context = new (serverStream.allocator()) HttpRoutingProxyContext(&multiplexer.splicePipes());
 
   if (!context) {
     ESB_LOG_WARNING_ERRNO(ESB_OUT_OF_MEMORY, "[%s] Cannot create proxy context", serverStream.logAddress());
@@ -42,6 +102,34 @@ ESB::Error HttpRoutingProxyHandler::receiveRequestHeaders(HttpMultiplexer &multi
     return ESB_INVALID_STATE;
   }
 
+  if (_requestRules) {
+    RuleGraph::Context rules;
+    rules.setPeerAddress(&serverStream.peerAddress());
+    rules.setNow(ESB::MonotonicTimeSource::Instance().now());
+
+    const RuleGraph::Context *connection = (const RuleGraph::Context *)serverStream.connectionContext();
+    if (connection) {
+      rules.inheritMarks(*connection);
+    }
+
+    switch (_requestRules->execute(_requestRoot, rules)) {
+      case RuleGraph::NONE:
+        break;
+      case RuleGraph::SEND_RESPONSE: {
+        const SendResponseAction *response = rules.response();
+        assert(response);
+        const int statusCode = response->statusCode();
+        const char *reasonPhrase = response->reasonPhrase();
+        ESB_LOG_DEBUG("[%s] Request rules sent a %d response", serverStream.logAddress(), statusCode);
+        return serverStream.sendEmptyResponse(
+            statusCode, reasonPhrase ? reasonPhrase : serverStream.response().DefaultReasonPhrase(statusCode));
+      }
+      default:
+        ESB_LOG_DEBUG("[%s] Request rules closed the connection", serverStream.logAddress());
+        return ESB_CLOSED;
+    }
+  }
+
   HttpClientTransaction *clientTransaction = multiplexer.createClientTransaction();
 
   if (!clientTransaction) {
@@ -66,34 +154,51 @@ ESB::Error HttpRoutingProxyHandler::receiveRequestHeaders(HttpMultiplexer &multi
   }
 
   ESB::SocketAddress destination;
-  error = _router.route(serverStream, *clientTransaction, destination);
+  error = _router.route(multiplexer, serverStream, *clientTransaction, destination, *context);
 
-  if (ESB_SUCCESS != error) {
-    switch (error) {
-      case ESB_CANNOT_FIND:
-        ESB_LOG_DEBUG_ERRNO(error, "[%s] Cannot route request", serverStream.logAddress());
-        return serverStream.sendEmptyResponse(404, "Not Found");
-      case ESB_NOT_OWNER:
-        ESB_LOG_DEBUG_ERRNO(error, "[%s] Cannot route request", serverStream.logAddress());
-        return serverStream.sendEmptyResponse(403, "Forbidden");
-      default:
-        ESB_LOG_WARNING_ERRNO(error, "[%s] Cannot route request", serverStream.logAddress());
-        return serverStream.sendEmptyResponse(500, "Internal Server Error");
-    }
+  switch (error) {
+    case ESB_SUCCESS:
+    case ESB_INPROGRESS:
+      break;
+    case ESB_CANNOT_FIND:
+      multiplexer.destroyClientTransaction(clientTransaction);
+      ESB_LOG_DEBUG_ERRNO(error, "[%s] Cannot route request", serverStream.logAddress());
+      return serverStream.sendEmptyResponse(404, "Not Found");
+    case ESB_NOT_OWNER:
+      multiplexer.destroyClientTransaction(clientTransaction);
+      ESB_LOG_DEBUG_ERRNO(error, "[%s] Cannot route request", serverStream.logAddress());
+      return serverStream.sendEmptyResponse(403, "Forbidden");
+    default:
+      multiplexer.destroyClientTransaction(clientTransaction);
+      ESB_LOG_WARNING_ERRNO(error, "[%s] Cannot route request", serverStream.logAddress());
+      return serverStream.sendEmptyResponse(500, "Internal Server Error");
   }
 
+  const bool resolving = ESB_INPROGRESS == error;
+
   // Pause the server transaction until we get the response from the client transaction
   error = serverStream.pauseRecv(false);
   if (ESB_SUCCESS == error) {
     error = serverStream.pauseSend(true);
   }
   if (ESB_SUCCESS != error) {
+    if (resolving) {
+      multiplexer.dnsClient().cancel(*context);
+    }
     multiplexer.destroyClientTransaction(clientTransaction);
     ESB_LOG_WARNING_ERRNO(error, "[%s] cannot pause server stream", serverStream.logAddress());
     return error;
   }
 
   ESB_LOG_DEBUG("[%s] paused server stream", serverStream.logAddress());
+
+  if (resolving) {
+    // The context executes the client transaction once the destination is resolved
+    ESB_LOG_DEBUG("[%s] resolving destination", serverStream.logAddress());
+    context->setPendingTransaction(&multiplexer, clientTransaction);
+    return ESB_PAUSE;
+  }
+
   clientTransaction->setPeerAddress(destination);
   clientTransaction->setContext(context);
 
@@ -258,6 +363,25 @@ ESB::Error HttpRoutingProxyHandler::offerResponseBody(HttpMultiplexer &multiplex
 
   HttpClientStream &clientStream = *context->clientStream();
 
+  switch (ESB::Error error = forwardSplicedResponseBody(*context, serverStream, clientStream)) {
+    case ESB_SUCCESS:
+    case ESB_OPERATION_NOT_SUPPORTED:
+      // Let the copy path handle the last chunk or whatever could not be spliced
+      break;
+    case ESB_PAUSE:
+      if (ESB_SUCCESS != (error = onServerSendBlocked(serverStream, clientStream))) {
+        return error == ESB_AGAIN ? ESB_OTHER_ERROR : error;
+      }
+      return ESB_PAUSE;
+    case ESB_AGAIN:
+      if (ESB_SUCCESS != (error = onClientRecvBlocked(serverStream, clientStream))) {
+        return error == ESB_AGAIN ? ESB_OTHER_ERROR : error;
+      }
+      return ESB_AGAIN;
+    default:
+      return error;
+  }
+
   switch (ESB::Error error = clientStream.responseBodyAvailable(bytesAvailable)) {
     case ESB_SUCCESS:
       ESB_LOG_DEBUG("[%s] %lu response body bytes are available", clientStream.logAddress(), *bytesAvailable);
@@ -296,6 +420,7 @@ ESB::Error HttpRoutingProxyHandler::produceResponseBody(HttpMultiplexer &multipl
   }
 
   HttpClientStream &clientStream = *context->clientStream();
+  assert(0 == context->splicer().buffered());
   ESB::UInt64 bytesRead = 0U;
   ESB::Error error = clientStream.readResponseBody(body, bytesRequested, &bytesRead);
 
@@ -420,6 +545,7 @@ ESB::Error HttpRoutingProxyHandler::consumeResponseBody(HttpMultiplexer &multipl
   }
 
   HttpServerStream &serverStream = *context->serverStream();
+  assert(0 == context->splicer().buffered());
 
   *bytesConsumed = 0;
   ESB::Error error = serverStream.sendResponseBody(body, bytesOffered, bytesConsumed);
@@ -454,6 +580,32 @@ ESB::Error HttpRoutingProxyHandler::consumeResponseBody(HttpMultiplexer &multipl
   }
 }
 
+ESB::Error HttpRoutingProxyHandler::spliceResponseBody(HttpMultiplexer &multiplexer, HttpClientStream &clientStream) {
+  HttpRoutingProxyContext *context = (HttpRoutingProxyContext *)clientStream.context();
+  assert(context);
+  assert(context->serverStream());
+  if (!context || !context->serverStream()) {
+    return ESB_INVALID_STATE;
+  }
+
+  HttpServerStream &serverStream = *context->serverStream();
+
+  switch (ESB::Error error = forwardSplicedResponseBody(*context, serverStream, clientStream)) {
+    case ESB_PAUSE:
+      if (ESB_SUCCESS != (error = onServerSendBlocked(serverStream, clientStream))) {
+        return error == ESB_AGAIN ? ESB_OTHER_ERROR : error;
+      }
+      return ESB_PAUSE;
+    case ESB_AGAIN:
+      if (ESB_SUCCESS != (error = onClientRecvBlocked(serverStream, clientStream))) {
+        return error == ESB_AGAIN ? ESB_OTHER_ERROR : error;
+      }
+      return ESB_AGAIN;
+    default:
+      return error;
+  }
+}
+
 void HttpRoutingProxyHandler::endTransaction(HttpMultiplexer &multiplexer, HttpClientStream &clientStream,
                                              HttpClientHandler::State state) {
   switch (state) {
@@ -548,6 +700,13 @@ void HttpRoutingProxyHandler::endTransaction(HttpMultiplexer &multiplexer, HttpS
   context->setServerStream(NULL);
   serverStream.setContext(NULL);
 
+  if (context->pendingTransaction()) {
+    // The server stream ended while its destination was being resolved
+    multiplexer.dnsClient().cancel(*context);
+    multiplexer.destroyClientTransaction(context->pendingTransaction());
+    context->setPendingTransaction(NULL, NULL);
+  }
+
   if (ES_HTTP_SERVER_HANDLER_END != state) {
     HttpClientStream *clientStream = context->clientStream();
     if (clientStream) {
@@ -647,4 +806,54 @@ ESB::Error HttpRoutingProxyHandler::onServerSendBlocked(HttpServerStream &server
   return ESB_SUCCESS;
 }
 
+ESB::Error HttpRoutingProxyHandler::forwardSplicedResponseBody(HttpRoutingProxyContext &context,
+                                                               HttpServerStream &serverStream,
+                                                               HttpClientStream &clientStream) {
+  if (!HttpConfig::Instance().spliceResponseBodies() || serverStream.secure() || clientStream.secure()) {
+    return ESB_OPERATION_NOT_SUPPORTED;
+  }
+
+  //
+  // Alternate between draining the pipe into the server stream and filling it from the client stream until the
+  // server send blocks (ESB_PAUSE), the client recv blocks (ESB_AGAIN), or the body has been forwarded (ESB_SUCCESS).
+  // The server stream is drained first so anything left in the pipe from a previous call is sent before more is read.
+  //
+
+  ESB::SocketSplicer &splicer = context.splicer();
+
+  while (true) {
+    ESB::UInt64 bytesSent = 0U;
+    ESB::Error error = serverStream.spliceResponseBody(splicer, &bytesSent);
+
+    if (0 < bytesSent) {
+      context.addResponseBodyBytesForwarded(bytesSent);
+      __atomic_add_fetch(&_splicedBytes, bytesSent, __ATOMIC_RELAXED);
+      ESB_LOG_DEBUG("[%s] spliced %lu/%lu response body bytes", serverStream.logAddress(), bytesSent,
+                    context.responseBodyBytesForwarded());
+    }
+
+    switch (error) {
+      case ESB_SUCCESS:
+        break;
+      case ESB_AGAIN:
+        return ESB_PAUSE;
+      default:
+        return error;
+    }
+
+    ESB::UInt64 bytesRead = 0U;
+    switch (error = clientStream.spliceResponseBody(splicer, &bytesRead)) {
+      case ESB_SUCCESS:
+        if (0 == bytesRead) {
+          return ESB_SUCCESS;
+        }
+        break;
+      case ESB_AGAIN:
+        return ESB_AGAIN;
+      default:
+        return error;
+    }
+  }
+}
+
 }  // namespace ES
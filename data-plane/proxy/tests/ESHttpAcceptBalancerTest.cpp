@@ -0,0 +1,254 @@
+#ifndef ES_HTTP_ACCEPT_BALANCER_H
+#include <ESHttpAcceptBalancer.h>
+#endif
+
+#ifndef ES_HTTP_PROXY_MULTIPLEXER_H
+#include <ESHttpProxyMultiplexer.h>
+#endif
+
+#ifndef ES_HTTP_ORIGIN_HANDLER_H
+#include <ESHttpOriginHandler.h>
+#endif
+
+#ifndef ES_HTTP_SERVER_SIMPLE_COUNTERS_H
+#include <ESHttpServerSimpleCounters.h>
+#endif
+
+#ifndef ES_HTTP_CONFIG_H
+#include <ESHttpConfig.h>
+#endif
+
+#ifndef ESB_THREAD_H
+#include <ESBThread.h>
+#endif
+
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace ES;
+
+TEST(HttpAcceptBalancer, MinimumLoad) {
+  EXPECT_FALSE(HttpAcceptBalancer::ShouldHandoff(ES_HTTP_ACCEPT_BALANCE_MIN_LOAD - 1U, 0U));
+  EXPECT_TRUE(HttpAcceptBalancer::ShouldHandoff(ES_HTTP_ACCEPT_BALANCE_MIN_LOAD, 0U));
+}
+
+TEST(HttpAcceptBalancer, Threshold) {
+  const ESB::UInt32 load = 100U + ES_HTTP_ACCEPT_BALANCE_THRESHOLD_PERCENT;
+
+  // Exactly the threshold busier is not enough
+  EXPECT_FALSE(HttpAcceptBalancer::ShouldHandoff(load, 100U));
+  EXPECT_TRUE(HttpAcceptBalancer::ShouldHandoff(load + 1U, 100U));
+  EXPECT_FALSE(HttpAcceptBalancer::ShouldHandoff(load, load));
+  EXPECT_FALSE(HttpAcceptBalancer::ShouldHandoff(load, load * 2U));
+
+  // Loads are multiplied without overflowing
+  EXPECT_FALSE(HttpAcceptBalancer::ShouldHandoff(ESB_UINT32_MAX, ESB_UINT32_MAX));
+  EXPECT_TRUE(HttpAcceptBalancer::ShouldHandoff(ESB_UINT32_MAX, ESB_UINT32_MAX / 2U));
+}
+
+// Runs a multiplexer until stopped
+class MultiplexerThread : public ESB::Thread {
+ public:
+  MultiplexerThread(HttpProxyMultiplexer &multiplexer) : _multiplexer(multiplexer) {}
+  virtual ~MultiplexerThread() {}
+
+ protected:
+  virtual void run() { _multiplexer.run(&_isRunning); }
+
+ private:
+  HttpProxyMultiplexer &_multiplexer;
+
+  ESB_DISABLE_AUTO_COPY(MultiplexerThread);
+};
+
+// Holds a multiplexer's thread in a command until released, so commands queued behind it stay pending
+class BlockingCommand : public HttpServerCommand {
+ public:
+  BlockingCommand() : _blocked(1U), _running(0U) {}
+  virtual ~BlockingCommand() {}
+
+  virtual ESB::Error run(HttpMultiplexerExtended &multiplexer) {
+    _running.set(1U);
+    while (_blocked.get()) {
+      usleep(100);
+    }
+    return ESB_SUCCESS;
+  }
+
+  virtual ESB::CleanupHandler *cleanupHandler() { return NULL; }
+
+  virtual const char *name() { return "blocking"; }
+
+  inline bool running() const { return _running.get(); }
+
+  inline void release() { _blocked.set(0U); }
+
+ private:
+  ESB::SharedInt _blocked;
+  ESB::SharedInt _running;
+
+  ESB_DISABLE_AUTO_COPY(BlockingCommand);
+};
+
+// The source only accepts and never runs, and the target runs so the balancer will consider it
+class HttpAcceptBalancerTest : public ::testing::Test {
+ public:
+  HttpAcceptBalancerTest()
+      : _params(),
+        _handler(_params),
+        _counters(),
+        _pool(HttpConfig::Instance().ioBufferSizes(), HttpConfig::Instance().ioBufferSizeClasses(), 2U),
+        _dnsCache(16U, 60U, 60U),
+        _contextIndex(0, 0, ESB::SystemAllocator::Instance()),
+        _source("src", 64U, 60000U, _pool, 0U, _dnsCache, _handler, _counters, _contextIndex),
+        _target("tgt", 64U, 60000U, _pool, 1U, _dnsCache, _handler, _counters, _contextIndex),
+        _targetThread(_target),
+        _targetRunning(false),
+        _balancer(2U),
+        _rand(42),
+        _sourceBuffers(0U),
+        _targetBuffers(0U) {
+    _pairs[0] = _pairs[1] = INVALID_SOCKET;
+  }
+
+  virtual void SetUp() {
+    ASSERT_EQ(ESB_SUCCESS, _balancer.attach(&_source));
+    ASSERT_EQ(ESB_SUCCESS, _balancer.attach(&_target));
+    ASSERT_EQ(ESB_SUCCESS, _targetThread.start());
+    _targetRunning = true;
+    for (int i = 0; i < 10000 && !_target.isRunning(); ++i) {
+      usleep(100);
+    }
+    ASSERT_TRUE(_target.isRunning());
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, _pairs));
+  }
+
+  virtual void TearDown() {
+    stopTarget();
+
+    for (ESB::UInt32 i = 0; i < _sourceBuffers; ++i) {
+      _source.releaseBuffer(_buffers[0][i]);
+    }
+    for (ESB::UInt32 i = 0; i < _targetBuffers; ++i) {
+      _target.releaseBuffer(_buffers[1][i]);
+    }
+
+    // The target closed its end when it stopped if the handoff went through
+    for (int i = 0; i < 2; ++i) {
+      if (INVALID_SOCKET != _pairs[i]) {
+        close(_pairs[i]);
+      }
+    }
+  }
+
+ protected:
+  static const ESB::UInt32 MaxBuffers = 64U;
+
+  void stopTarget() {
+    if (_targetRunning) {
+      _targetThread.stop();
+      _targetThread.join();
+      _targetRunning = false;
+    }
+  }
+
+  // Buffers in use count towards a multiplexer's load
+  void loadSource(ESB::UInt32 buffers) {
+    for (ESB::UInt32 i = 0; i < buffers; ++i) {
+      _buffers[0][_sourceBuffers++] = _source.acquireBuffer(0U);
+    }
+  }
+
+  void loadTarget(ESB::UInt32 buffers) {
+    for (ESB::UInt32 i = 0; i < buffers; ++i) {
+      _buffers[1][_targetBuffers++] = _target.acquireBuffer(0U);
+    }
+  }
+
+  ESB::Error handoff() {
+    ESB::SocketAddress address("127.0.0.1", 0, ESB::SocketAddress::TransportType::TCP);
+    ESB::Socket::State state(false, _pairs[0], address, address);
+    ESB::Error error = _balancer.handoff(_source, state, _rand);
+    if (ESB_SUCCESS == error) {
+      _pairs[0] = INVALID_SOCKET;
+    }
+    return error;
+  }
+
+  HttpTestParams _params;
+  HttpOriginHandler _handler;
+  HttpServerSimpleCounters _counters;
+  ESB::SizeClassBufferPool _pool;
+  ESB::DnsCache _dnsCache;
+  ESB::ServerTLSContextIndex _contextIndex;
+  HttpProxyMultiplexer _source;
+  HttpProxyMultiplexer _target;
+  MultiplexerThread _targetThread;
+  bool _targetRunning;
+  HttpAcceptBalancer _balancer;
+  ESB::Rand _rand;
+  ESB::UInt32 _sourceBuffers;
+  ESB::UInt32 _targetBuffers;
+  ESB::Buffer *_buffers[2][MaxBuffers];
+  SOCKET _pairs[2];
+};
+
+const ESB::UInt32 HttpAcceptBalancerTest::MaxBuffers;
+
+TEST_F(HttpAcceptBalancerTest, KeepsBelowMinimumLoad) {
+  loadSource(ES_HTTP_ACCEPT_BALANCE_MIN_LOAD - 1U);
+  ASSERT_EQ(ES_HTTP_ACCEPT_BALANCE_MIN_LOAD - 1U, _source.acceptLoad());
+
+  EXPECT_EQ(ESB_CANNOT_FIND, handoff());
+  EXPECT_EQ(0U, _source.acceptHandoffs());
+  EXPECT_EQ(0U, _target.pendingHandoffs());
+
+  loadSource(1U);
+  EXPECT_EQ(ESB_SUCCESS, handoff());
+  EXPECT_EQ(1U, _source.acceptHandoffs());
+}
+
+// A handoff counts against the target until the target adds the connection, so the next acceptor sees it
+TEST_F(HttpAcceptBalancerTest, PendingHandoffs) {
+  BlockingCommand blocker;
+  ASSERT_EQ(ESB_SUCCESS, _target.pushServerCommand(&blocker));
+  for (int i = 0; i < 10000 && !blocker.running(); ++i) {
+    usleep(100);
+  }
+  ASSERT_TRUE(blocker.running());
+
+  // The target's load holds still while its thread is blocked
+  loadTarget(ES_HTTP_ACCEPT_BALANCE_MIN_LOAD);
+  const ESB::UInt32 targetLoad = _target.acceptLoad();
+  const int targetSockets = _target.currentSockets();
+
+  // Just busy enough to hand one connection to the target, but not two
+  const ESB::UInt32 load = (targetLoad + 1U) * (100U + ES_HTTP_ACCEPT_BALANCE_THRESHOLD_PERCENT) / 100U;
+  ASSERT_TRUE(HttpAcceptBalancer::ShouldHandoff(load, targetLoad));
+  ASSERT_FALSE(HttpAcceptBalancer::ShouldHandoff(load, targetLoad + 1U));
+  ASSERT_GE(MaxBuffers, load);
+  loadSource(load);
+
+  EXPECT_EQ(ESB_SUCCESS, handoff());
+  EXPECT_EQ(1U, _target.pendingHandoffs());
+  EXPECT_LE(targetLoad + 1U, _target.acceptLoad());
+  EXPECT_EQ(1U, _source.acceptHandoffs());
+
+  EXPECT_EQ(ESB_CANNOT_FIND, handoff());
+  EXPECT_EQ(1U, _target.pendingHandoffs());
+  EXPECT_EQ(1U, _source.acceptHandoffs());
+
+  // Once the target runs the handoff, the connection counts as one of its sockets instead
+  blocker.release();
+  for (int i = 0; i < 10000 && 0U < _target.pendingHandoffs(); ++i) {
+    usleep(100);
+  }
+  EXPECT_EQ(0U, _target.pendingHandoffs());
+  EXPECT_EQ(targetSockets + 1, _target.currentSockets());
+
+  // A stopped target is never chosen
+  stopTarget();
+  EXPECT_EQ(ESB_CANNOT_FIND, handoff());
+  EXPECT_EQ(1U, _source.acceptHandoffs());
+}
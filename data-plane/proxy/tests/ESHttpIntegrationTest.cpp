@@ -134,7 +134,9 @@ HttpIntegrationTest::HttpIntegrationTest(const HttpTestParams &testParams, ESB::
       _client("load", _params.clientThreads(), _params.clientTimeoutMsec(), _clientHandler),
       _proxy("prox", _params.proxyThreads(), _params.proxyTimeoutMsec(), _proxyHandler),
       _origin("orig", _params.originThreads(), _params.originTimeoutMsec(), _originHandler),
-      _timeout(ESB::Time::Instance().now() + timeoutSec) {
+      _timeout(ESB::Time::Instance().now() + timeoutSec),
+      _proxyUringMultiplexers(0U),
+      _proxyAcceptHandoffs(0U) {
   HttpClientSocket::SetReuseConnections(_params.reuseConnections());
 }
 
@@ -222,7 +224,7 @@ ESB::Error HttpIntegrationTest::run() {
       return error;
     }
 
-    error = _proxy.addListener(_proxyListener);
+    error = _proxy.addListener(_proxyListener, _params.proxyListeners());
     if (ESB_SUCCESS != error) {
       ESB_LOG_CRITICAL_ERRNO(error, "cannot add proxy listener");
       return error;
@@ -271,6 +273,15 @@ ESB::Error HttpIntegrationTest::run() {
 
   ESB_LOG_NOTICE("[test] finished");
 
+  // The proxy's multiplexers can only be inspected while it is running
+
+  for (ESB::UInt32 i = 0; i < _proxy.threads(); ++i) {
+    if (HttpConfig::ES_HTTP_URING_MULTIPLEXER == _proxy.multiplexerType(i)) {
+      ++_proxyUringMultiplexers;
+    }
+    _proxyAcceptHandoffs += _proxy.acceptHandoffs(i);
+  }
+
   //
   // Stop client, server, and proxy
   //
@@ -54,6 +54,12 @@ class HttpIntegrationTest {
   inline HttpServer &origin() { return _origin; }
   inline const HttpServer &origin() const { return _origin; }
 
+  // The number of proxy multiplexers that ran on io_uring, sampled by run() before it stops the proxy
+  inline ESB::UInt32 proxyUringMultiplexers() const { return _proxyUringMultiplexers; }
+
+  // The number of connections the proxy's multiplexers handed to each other, sampled by run() before it stops the proxy
+  inline ESB::UInt64 proxyAcceptHandoffs() const { return _proxyAcceptHandoffs; }
+
  private:
   const HttpTestParams &_params;
   ESB::ListeningSocket &_proxyListener;
@@ -65,6 +71,8 @@ class HttpIntegrationTest {
   HttpProxy _proxy;
   HttpServer _origin;
   ESB::Date _timeout;
+  ESB::UInt32 _proxyUringMultiplexers;
+  ESB::UInt64 _proxyAcceptHandoffs;
 
   ESB_DISABLE_AUTO_COPY(HttpIntegrationTest);
 };
@@ -26,6 +26,10 @@
 #include "ESHttpFixedRouter.h"
 #endif
 
+#ifndef ES_HTTP_METRICS_HANDLER_H
+#include <ESHttpMetricsHandler.h>
+#endif
+
 #ifndef ES_HTTP_LOADGEN_CONTEXT_H
 #include <ESHttpLoadgenContext.h>
 #endif
@@ -54,6 +58,10 @@
 #include <ESBSystemTimeSource.h>
 #endif
 
+#ifndef ESB_URING_MULTIPLEXER_H
+#include <ESBUringMultiplexer.h>
+#endif
+
 #include <gtest/gtest.h>
 
 using namespace ES;
@@ -143,6 +151,276 @@ TEST_P(HttpProxyTest, ClientToProxyToServer) {
   ASSERT_EQ(0, test.client().clientCounters().getFailures()->queries());
 }
 
+// Counts the connections the proxy begins and ends and checks each keeps its connection context until it ends
+class ConnectionCountingHandler : public HttpRoutingProxyHandler {
+ public:
+  ConnectionCountingHandler(HttpRouter &router) : HttpRoutingProxyHandler(router), _begun(), _ended(), _lost() {}
+  virtual ~ConnectionCountingHandler() {}
+
+  virtual ESB::Error beginConnection(HttpMultiplexer &multiplexer, HttpServerStream &serverStream) {
+    ESB::Error error = HttpRoutingProxyHandler::beginConnection(multiplexer, serverStream);
+    if (ESB_SUCCESS == error) {
+      _begun.inc();
+      serverStream.setConnectionContext(this);
+    }
+    return error;
+  }
+
+  virtual ESB::Error beginTransaction(HttpMultiplexer &multiplexer, HttpServerStream &serverStream) {
+    if (this != serverStream.connectionContext()) {
+      _lost.inc();
+    }
+    return HttpRoutingProxyHandler::beginTransaction(multiplexer, serverStream);
+  }
+
+  virtual void endConnection(HttpMultiplexer &multiplexer, HttpServerStream &serverStream) {
+    if (this != serverStream.connectionContext()) {
+      _lost.inc();
+    }
+    _ended.inc();
+    serverStream.setConnectionContext(NULL);
+    HttpRoutingProxyHandler::endConnection(multiplexer, serverStream);
+  }
+
+  inline ESB::UInt32 begun() const { return _begun.get(); }
+  inline ESB::UInt32 ended() const { return _ended.get(); }
+  inline ESB::UInt32 lost() const { return _lost.get(); }
+
+ private:
+  ESB::SharedInt _begun;
+  ESB::SharedInt _ended;
+  ESB::SharedInt _lost;
+
+  ESB_DISABLE_AUTO_COPY(ConnectionCountingHandler);
+};
+
+TEST_P(HttpProxyTest, ConnectionLifecycle) {
+  HttpTestParams params;
+  params.connections(20)
+      .requestsPerConnection(20)
+      .clientThreads(1)
+      .proxyThreads(2)
+      .originThreads(1)
+      .requestSize(1024)
+      .responseSize(1024)
+      .hostHeader("test.server.everscale.com")
+      .secure(std::get<0>(GetParam()))
+      .logLevel(ESB::Logger::Warning);
+
+  EphemeralListener originListener("origin-listener", params.secure());
+  EphemeralListener proxyListener("proxy-listener", params.secure());
+  HttpFixedRouter router(originListener.localDestination());
+  HttpLoadgenHandler loadgenHandler(params);
+  ConnectionCountingHandler proxyHandler(router);
+  HttpOriginHandler originHandler(params);
+  HttpIntegrationTest test(params, originListener, proxyListener, loadgenHandler, proxyHandler, originHandler);
+
+  ASSERT_EQ(ESB_SUCCESS, test.loadDefaultTLSContexts());
+  ASSERT_EQ(ESB_SUCCESS, test.run());
+  ASSERT_EQ(params.connections() * params.requestsPerConnection(),
+            test.client().clientCounters().getSuccesses()->queries());
+
+  // Every connection ends once the proxy stops, whether the client or the proxy closed it
+  EXPECT_LE(params.connections(), proxyHandler.begun());
+  EXPECT_EQ(proxyHandler.begun(), proxyHandler.ended());
+  EXPECT_EQ(0U, proxyHandler.lost());
+}
+
+TEST_P(HttpProxyTest, Metrics) {
+  HttpTestParams params;
+  params.connections(10)
+      .requestsPerConnection(10)
+      .clientThreads(1)
+      .proxyThreads(1)
+      .originThreads(1)
+      .requestSize(1024)
+      .responseSize(1024)
+      .hostHeader("test.server.everscale.com")
+      .secure(std::get<0>(GetParam()))
+      .logLevel(ESB::Logger::Warning);
+
+  EphemeralListener originListener("origin-listener", params.secure());
+  EphemeralListener proxyListener("proxy-listener", params.secure());
+  HttpFixedRouter router(originListener.localDestination());
+  HttpLoadgenHandler loadgenHandler(params);
+  HttpRoutingProxyHandler proxyHandler(router);
+  HttpOriginHandler originHandler(params);
+  HttpIntegrationTest test(params, originListener, proxyListener, loadgenHandler, proxyHandler, originHandler);
+
+  ASSERT_EQ(ESB_SUCCESS, test.loadDefaultTLSContexts());
+  ASSERT_EQ(ESB_SUCCESS, test.run());
+
+  HttpMetricsHandler metricsHandler(test.proxy());
+  char buffer[ES_HTTP_METRICS_BUFFER_SIZE];
+  const ESB::UInt32 length = metricsHandler.render(buffer, sizeof(buffer));
+  ASSERT_LT(length, sizeof(buffer));
+  ASSERT_EQ(length, strlen(buffer));
+
+  EXPECT_TRUE(strstr(buffer, "# TYPE es_server_transaction_seconds summary\n"));
+  EXPECT_TRUE(strstr(buffer, "es_server_transaction_seconds_count 100\n"));
+  EXPECT_TRUE(strstr(buffer, "es_server_transaction_seconds{quantile=\"0.99\"} "));
+  EXPECT_TRUE(strstr(buffer, "\nes_server_connections_total "));
+  EXPECT_TRUE(strstr(buffer, "es_client_transaction_seconds_count 100\n"));
+  EXPECT_TRUE(strstr(buffer, "es_connection_pool_acquisitions_total{result=\"hit\"} "));
+  EXPECT_TRUE(strstr(buffer, "es_accept_handoffs_total{multiplexer=\"0\"} 0\n"));
+  EXPECT_TRUE(strstr(buffer, "# TYPE es_event_loop_lag_seconds gauge\n"));
+
+  unsigned int accepted = 0U, serverFull = 0U, serverResumed = 0U;
+  unsigned int clientFull = 0U, clientResumed = 0U, hits = 0U, misses = 0U;
+  const char *p = strstr(buffer, "\nes_server_connections_total ");
+  ASSERT_TRUE(p);
+  ASSERT_EQ(1, sscanf(p, "\nes_server_connections_total %u\n", &accepted));
+  p = strstr(buffer, "es_server_tls_handshakes_total{result=\"full\"} ");
+  ASSERT_TRUE(p);
+  ASSERT_EQ(2, sscanf(p,
+                      "es_server_tls_handshakes_total{result=\"full\"} %u\n"
+                      "es_server_tls_handshakes_total{result=\"resumed\"} %u\n",
+                      &serverFull, &serverResumed));
+  p = strstr(buffer, "es_client_tls_handshakes_total{result=\"full\"} ");
+  ASSERT_TRUE(p);
+  ASSERT_EQ(2, sscanf(p,
+                      "es_client_tls_handshakes_total{result=\"full\"} %u\n"
+                      "es_client_tls_handshakes_total{result=\"resumed\"} %u\n",
+                      &clientFull, &clientResumed));
+  p = strstr(buffer, "es_client_tls_session_cache_lookups_total{result=\"hit\"} ");
+  ASSERT_TRUE(p);
+  ASSERT_EQ(2, sscanf(p,
+                      "es_client_tls_session_cache_lookups_total{result=\"hit\"} %u\n"
+                      "es_client_tls_session_cache_lookups_total{result=\"miss\"} %u\n",
+                      &hits, &misses));
+  EXPECT_TRUE(strstr(buffer, "\nes_client_tls_session_cache_evictions_total "));
+
+  if (params.secure()) {
+    // Every accepted connection completes a handshake before sending its first request
+    EXPECT_EQ(accepted, serverFull + serverResumed);
+    EXPECT_LT(0U, clientFull + clientResumed);
+    EXPECT_LE(clientFull + clientResumed, hits + misses);
+    EXPECT_LE(clientResumed, hits);
+  } else {
+    EXPECT_EQ(0U, serverFull + serverResumed + clientFull + clientResumed + hits + misses);
+  }
+
+  // Truncated renders still report the full length
+  char small[64];
+  EXPECT_EQ(length, metricsHandler.render(small, sizeof(small)));
+  EXPECT_EQ(sizeof(small) - 1, strlen(small));
+}
+
+TEST_P(HttpProxyTest, ClientToProxyToServerUring) {
+  HttpTestParams params;
+  params.connections(50)
+      .requestsPerConnection(50)
+      .clientThreads(2)
+      .proxyThreads(2)
+      .originThreads(2)
+      .requestSize(1024)
+      .responseSize(1024)
+      .hostHeader("test.server.everscale.com")
+      .secure(std::get<0>(GetParam()))
+      .logLevel(ESB::Logger::Warning);
+
+#ifdef HAVE_IO_URING
+  const bool uring = ESB::UringMultiplexer::Available();
+#else
+  const bool uring = false;
+#endif
+  if (!uring) {
+    ESB_LOG_WARNING("io_uring is not available, the proxy will fall back to epoll");
+  }
+
+  HttpConfig::Instance().setMultiplexerType(HttpConfig::ES_HTTP_URING_MULTIPLEXER);
+
+  EphemeralListener originListener("origin-listener", params.secure());
+  EphemeralListener proxyListener("proxy-listener", params.secure());
+  HttpFixedRouter router(originListener.localDestination());
+  HttpLoadgenHandler loadgenHandler(params);
+  HttpRoutingProxyHandler proxyHandler(router);
+  HttpOriginHandler originHandler(params);
+  HttpIntegrationTest test(params, originListener, proxyListener, loadgenHandler, proxyHandler, originHandler);
+
+  ASSERT_EQ(ESB_SUCCESS, test.loadDefaultTLSContexts());
+  ESB::Error error = test.run();
+  HttpConfig::Instance().setMultiplexerType(HttpConfig::ES_HTTP_EPOLL_MULTIPLEXER);
+  ASSERT_EQ(ESB_SUCCESS, error);
+  ASSERT_EQ(uring ? params.proxyThreads() : 0U, test.proxyUringMultiplexers());
+  ASSERT_EQ(params.connections() * params.requestsPerConnection(),
+            test.client().clientCounters().getSuccesses()->queries());
+  ASSERT_EQ(0, test.client().clientCounters().getFailures()->queries());
+}
+
+TEST_P(HttpProxyTest, ClientToProxyToServerBalanced) {
+  HttpTestParams params;
+  params.connections(50)
+      .requestsPerConnection(50)
+      .clientThreads(2)
+      .proxyThreads(4)
+      .proxyListeners(1)
+      .originThreads(2)
+      .requestSize(1024)
+      .responseSize(1024)
+      .hostHeader("test.server.everscale.com")
+      .secure(std::get<0>(GetParam()))
+      .logLevel(ESB::Logger::Warning);
+
+  // Only the first proxy thread accepts, so the others get connections only if it hands them over
+  HttpConfig::Instance().setAcceptBalancing(true);
+
+  EphemeralListener originListener("origin-listener", params.secure());
+  EphemeralListener proxyListener("proxy-listener", params.secure());
+  HttpFixedRouter router(originListener.localDestination());
+  HttpLoadgenHandler loadgenHandler(params);
+  HttpRoutingProxyHandler proxyHandler(router);
+  HttpOriginHandler originHandler(params);
+  HttpIntegrationTest test(params, originListener, proxyListener, loadgenHandler, proxyHandler, originHandler);
+
+  ASSERT_EQ(ESB_SUCCESS, test.loadDefaultTLSContexts());
+  ESB::Error error = test.run();
+  HttpConfig::Instance().setAcceptBalancing(false);
+  ASSERT_EQ(ESB_SUCCESS, error);
+  ASSERT_EQ(params.connections() * params.requestsPerConnection(),
+            test.client().clientCounters().getSuccesses()->queries());
+  ASSERT_EQ(0, test.client().clientCounters().getFailures()->queries());
+  ASSERT_LT(0U, test.proxyAcceptHandoffs());
+}
+
+TEST_P(HttpProxyTest, ClientToProxyToServerWarm) {
+  HttpTestParams params;
+  params.connections(50)
+      .requestsPerConnection(50)
+      .clientThreads(2)
+      .proxyThreads(2)
+      .originThreads(2)
+      .requestSize(1024)
+      .responseSize(1024)
+      .hostHeader("test.server.everscale.com")
+      .secure(std::get<0>(GetParam()))
+      .logLevel(ESB::Logger::Warning);
+
+  EphemeralListener originListener("origin-listener", params.secure());
+  EphemeralListener proxyListener("proxy-listener", params.secure());
+  HttpFixedRouter router(originListener.localDestination());
+  HttpLoadgenHandler loadgenHandler(params);
+  HttpRoutingProxyHandler proxyHandler(router);
+  HttpOriginHandler originHandler(params);
+  HttpIntegrationTest test(params, originListener, proxyListener, loadgenHandler, proxyHandler, originHandler);
+
+  // Warm connections are keyed by the destination's hostname, which for TLS must match the origin's certificate
+  char origin[ESB_IPV6_PRESENTATION_SIZE];
+  originListener.localDestination().presentationAddress(origin, sizeof(origin));
+  if (!params.secure()) {
+    ASSERT_EQ(ESB_SUCCESS, HttpConfig::Instance().addWarmDestination(origin, originListener.localDestination().port(),
+                                                                     false, 10, 20));
+  }
+
+  ASSERT_EQ(ESB_SUCCESS, test.loadDefaultTLSContexts());
+  ESB::Error error = test.run();
+  HttpConfig::Instance().clearWarmDestinations();
+  ASSERT_EQ(ESB_SUCCESS, error);
+  ASSERT_EQ(params.connections() * params.requestsPerConnection(),
+            test.client().clientCounters().getSuccesses()->queries());
+  ASSERT_EQ(0, test.client().clientCounters().getFailures()->queries());
+}
+
 TEST_P(HttpProxyTest, LargeResponse) {
   HttpTestParams params;
   params.connections(1)
@@ -357,3 +635,47 @@ TEST_P(HttpProxyTestMessageBody, BodySizes) {
             test.client().clientCounters().getSuccesses()->queries());
   ASSERT_EQ(0, test.client().clientCounters().getFailures()->queries());
 }
+
+TEST_P(HttpProxyTestMessageBody, SplicedBodySizes) {
+  HttpTestParams params;
+  params.connections(50)
+      .requestsPerConnection(50)
+      .clientThreads(2)
+      .proxyThreads(2)
+      .originThreads(2)
+      .requestSize(std::get<0>(GetParam()))
+      .responseSize(std::get<0>(GetParam()))
+      .useContentLengthHeader(std::get<1>(GetParam()))
+      .hostHeader("test.server.everscale.com")
+      .secure(std::get<2>(GetParam()))
+      .originTimeoutMsec(60 * 1000)
+      .proxyTimeoutMsec(60 * 1000)
+      .clientTimeoutMsec(60 * 1000)
+      .logLevel(ESB::Logger::Warning);
+
+  // Only cleartext Content-Length bodies are spliced, everything else should fall back to copying
+  HttpConfig::Instance().setSpliceResponseBodies(true);
+
+  EphemeralListener originListener("origin-listener", params.secure());
+  EphemeralListener proxyListener("proxy-listener", params.secure());
+  HttpFixedRouter router(originListener.localDestination());
+  HttpLoadgenHandler loadgenHandler(params);
+  HttpRoutingProxyHandler proxyHandler(router);
+  HttpOriginHandler originHandler(params);
+  HttpIntegrationTest test(params, originListener, proxyListener, loadgenHandler, proxyHandler, originHandler);
+
+  ASSERT_EQ(ESB_SUCCESS, test.loadDefaultTLSContexts());
+  ESB::Error error = test.run();
+  HttpConfig::Instance().setSpliceResponseBodies(false);
+  ASSERT_EQ(ESB_SUCCESS, error);
+  ASSERT_EQ(params.connections() * params.requestsPerConnection(),
+            test.client().clientCounters().getSuccesses()->queries());
+  ASSERT_EQ(0, test.client().clientCounters().getFailures()->queries());
+
+  // Bodies larger than the recv buffer cannot arrive with their headers, so the rest of them must have been spliced
+  if (params.secure()) {
+    EXPECT_EQ(0U, proxyHandler.splicedResponseBodyBytes());
+  } else if (params.useContentLengthHeader() && params.responseSize() > HttpConfig::Instance().ioBufferSize()) {
+    EXPECT_LT(0U, proxyHandler.splicedResponseBodyBytes());
+  }
+}